@@ -0,0 +1,177 @@
+#include "AssetCache.h"
+#include <cstdio>
+#include <fstream>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/stat.h>
+#endif
+
+namespace
+{
+	// Marks the start of every blob - "BLOB"
+	const unsigned int BlobMagic = 0x424F4C42;
+
+	// Bumped if the header itself ever changes
+	const unsigned int BlobFormat = 1;
+
+	// --------------------------------------------------------
+	// Start of every blob.  32 bytes, so the payload keeps the
+	// 16 byte alignment of the mapping.
+	// --------------------------------------------------------
+	struct BlobHeader
+	{
+		unsigned int Magic;
+		unsigned int Format;
+		unsigned long long Key;
+		unsigned long long PayloadSize;
+		unsigned long long Reserved;
+	};
+}
+
+
+AssetCache::AssetCache(const char * directory)
+{
+	this->directory = directory;
+	stats = AssetCacheStats();
+
+#ifdef _WIN32
+	CreateDirectoryA(directory, 0);
+#else
+	mkdir(directory, 0755);
+#endif
+}
+
+AssetCache::~AssetCache()
+{
+}
+
+bool AssetCache::Load(const char * name, unsigned long long key, AssetBlob & blob)
+{
+	blob.data = 0;
+	blob.size = 0;
+
+	std::string path = GetPath(name);
+	if (!blob.file.Open(path.c_str()) || blob.file.GetSize() < sizeof(BlobHeader))
+	{
+		blob.file.Close();
+		std::lock_guard<std::mutex> lock(statsMutex);
+		stats.Misses++;
+		return false;
+	}
+
+	// Stale or damaged blobs are just misses - the next
+	// store replaces them
+	const BlobHeader* header = (const BlobHeader*)blob.file.GetData();
+	if (header->Magic != BlobMagic || header->Format != BlobFormat || header->Key != key ||
+		header->PayloadSize != blob.file.GetSize() - sizeof(BlobHeader))
+	{
+		blob.file.Close();
+		std::lock_guard<std::mutex> lock(statsMutex);
+		stats.Misses++;
+		return false;
+	}
+
+	blob.data = header + 1;
+	blob.size = (size_t)header->PayloadSize;
+
+	std::lock_guard<std::mutex> lock(statsMutex);
+	stats.Hits++;
+	stats.BytesLoaded += blob.size;
+	return true;
+}
+
+bool AssetCache::Store(const char * name, unsigned long long key, const AssetChunk * chunks, int chunkCount)
+{
+	BlobHeader header = {};
+	header.Magic = BlobMagic;
+	header.Format = BlobFormat;
+	header.Key = key;
+	for (int i = 0; i < chunkCount; i++)
+		header.PayloadSize += chunks[i].Size;
+
+	std::string path = GetPath(name);
+	std::string temporaryPath = path + ".tmp";
+	{
+		std::ofstream out(temporaryPath.c_str(), std::ios::binary);
+		if (!out)
+			return false;
+
+		out.write((const char*)&header, sizeof(header));
+		for (int i = 0; i < chunkCount; i++)
+			out.write((const char*)chunks[i].Data, chunks[i].Size);
+
+		if (!out.good())
+		{
+			out.close();
+			remove(temporaryPath.c_str());
+			return false;
+		}
+	}
+
+#ifdef _WIN32
+	bool moved = MoveFileExA(temporaryPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	bool moved = rename(temporaryPath.c_str(), path.c_str()) == 0;
+#endif
+	if (!moved)
+	{
+		remove(temporaryPath.c_str());
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(statsMutex);
+	stats.Stores++;
+	stats.BytesStored += (size_t)header.PayloadSize;
+	return true;
+}
+
+AssetCacheStats AssetCache::GetStats()
+{
+	std::lock_guard<std::mutex> lock(statsMutex);
+	return stats;
+}
+
+bool AssetCache::Store(const char * name, unsigned long long key, const void * data, size_t size)
+{
+	AssetChunk chunk = { data, size };
+	return Store(name, key, &chunk, 1);
+}
+
+unsigned long long AssetCache::Hash(const void * data, size_t size, unsigned long long hash)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+bool AssetCache::HashFile(const char * file, unsigned long long & hash)
+{
+	MappedFile mapped;
+	if (!mapped.Open(file))
+		return false;
+
+	hash = Hash(mapped.GetData(), mapped.GetSize());
+	return true;
+}
+
+// --------------------------------------------------------
+// Blob names can be source paths, so anything that isn't
+// safe in a file name becomes an underscore
+// --------------------------------------------------------
+std::string AssetCache::GetPath(const char * name) const
+{
+	std::string path = directory + "/";
+	for (const char* c = name; *c; c++)
+	{
+		bool safe = (*c >= 'a' && *c <= 'z') || (*c >= 'A' && *c <= 'Z') || (*c >= '0' && *c <= '9') ||
+			*c == '.' || *c == '-' || *c == '_';
+		path += safe ? *c : '_';
+	}
+	return path + ".blob";
+}
\ No newline at end of file
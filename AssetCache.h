@@ -0,0 +1,98 @@
+#pragma once
+#include "MappedFile.h"
+#include <mutex>
+#include <string>
+
+// --------------------------------------------------------
+// One piece of a blob being stored
+// --------------------------------------------------------
+struct AssetChunk
+{
+	const void* Data;
+	size_t Size;
+};
+
+// --------------------------------------------------------
+// A blob loaded from an AssetCache.  The payload points
+// into the mapped file and stays valid until the blob is
+// destroyed or loaded into again.
+// --------------------------------------------------------
+class AssetBlob
+{
+public:
+	AssetBlob() : data(0), size(0) {}
+
+	const void* GetData() const { return data; }
+	size_t GetSize() const { return size; }
+
+private:
+	friend class AssetCache;
+
+	MappedFile file;
+	const void* data;
+	size_t size;
+};
+
+// Hits and misses since the cache was created
+struct AssetCacheStats
+{
+	unsigned int Hits;
+	unsigned int Misses;
+	unsigned int Stores;
+	size_t BytesLoaded;
+	size_t BytesStored;
+};
+
+// --------------------------------------------------------
+// A directory of baked assets, so expensive processing only
+// happens once per input
+//
+// Each blob is stored under a name and a key.  Callers build
+// the key by hashing the source data along with everything
+// that affects the result - settings and a version number
+// for the processing code.  Loading a name whose key doesn't
+// match is a miss, and storing the fresh result replaces the
+// stale blob, so nothing ever needs clearing by hand.
+//
+// Loads map the blob rather than reading it, so the payload
+// can be passed straight to buffer and texture creation.
+// Blobs with different names can be loaded and stored from
+// any number of threads at once.
+// --------------------------------------------------------
+class AssetCache
+{
+public:
+	// Creates the directory if it isn't there yet
+	AssetCache(const char* directory);
+	~AssetCache();
+
+	// Returns false on a miss
+	bool Load(const char* name, unsigned long long key, AssetBlob& blob);
+
+	// Writes to a temporary file first, so an interrupted
+	// store never leaves a half written blob behind
+	bool Store(const char* name, unsigned long long key, const AssetChunk* chunks, int chunkCount);
+	bool Store(const char* name, unsigned long long key, const void* data, size_t size);
+
+	AssetCacheStats GetStats();
+
+	// Key building - FNV-1a, continuing from a previous hash
+	static const unsigned long long HashSeed = 14695981039346656037ULL;
+	static unsigned long long Hash(const void* data, size_t size, unsigned long long hash = HashSeed);
+	template <typename T>
+	static unsigned long long HashValue(const T& value, unsigned long long hash = HashSeed)
+	{
+		return Hash(&value, sizeof(T), hash);
+	}
+
+	// Hashes a file's contents - returns false if it can't be read
+	static bool HashFile(const char* file, unsigned long long& hash);
+
+private:
+	std::string directory;
+
+	std::mutex statsMutex;
+	AssetCacheStats stats;
+
+	std::string GetPath(const char* name) const;
+};
\ No newline at end of file
@@ -0,0 +1,313 @@
+#include "AssetLoader.h"
+#include "FrameProfiler.h"
+#include <cstdio>
+
+
+AssetLoader::AssetLoader(JobSystem & jobs, bool headless)
+	: jobs(jobs)
+{
+	this->headless = headless;
+	start = std::chrono::steady_clock::now();
+}
+
+AssetLoader::~AssetLoader()
+{
+	// Queued jobs still point at this loader
+	for (size_t i = 0; i < assets.size(); i++)
+	{
+		if (assets[i].Job)
+			jobs.Wait(assets[i].Job);
+	}
+}
+
+AssetHandle AssetLoader::Load(const char * name, std::function<bool()> work, std::function<bool()> finish, std::initializer_list<AssetHandle> dependencies)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	AssetHandle handle = (AssetHandle)assets.size();
+	assets.push_back(Asset());
+	Asset& asset = assets.back();
+	asset.Work = work;
+	asset.Finish = finish;
+	asset.PendingDependencies = 0;
+	asset.State = AssetState::Waiting;
+	asset.Job = 0;
+
+	asset.Timing = AssetTiming();
+	asset.Timing.Name = name;
+	asset.Timing.WorkerThread = -1;
+	asset.Timing.Queued = Now();
+
+	// Only dependencies still working hold this asset back
+	bool failed = false;
+	for (AssetHandle dependency : dependencies)
+	{
+		if (dependency < 0 || dependency >= handle || assets[dependency].State == AssetState::Failed)
+		{
+			failed = true;
+			continue;
+		}
+
+		asset.Dependencies.push_back(dependency);
+		AssetState state = assets[dependency].State;
+		if (state == AssetState::Waiting || state == AssetState::Queued || state == AssetState::Working)
+		{
+			asset.PendingDependencies++;
+			assets[dependency].Dependents.push_back(handle);
+		}
+	}
+
+	if (failed)
+		Fail(handle);
+	else if (asset.PendingDependencies == 0)
+		Enqueue(handle);
+	return handle;
+}
+
+// --------------------------------------------------------
+// Finishes assets in the order they were queued, skipping
+// any whose dependencies haven't finished yet, and runs
+// jobs whenever nothing can make progress without them
+// --------------------------------------------------------
+void AssetLoader::Finish()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true)
+	{
+		bool progress = false;
+		bool pending = false;
+		JobHandle working = 0;
+
+		for (size_t i = 0; i < assets.size(); i++)
+		{
+			Asset& asset = assets[i];
+			if (asset.State == AssetState::Done || asset.State == AssetState::Failed)
+				continue;
+			if (asset.State != AssetState::Worked)
+			{
+				// Anything waiting on dependencies waits on one of these
+				if (!working && asset.Job)
+					working = asset.Job;
+				pending = true;
+				continue;
+			}
+
+			bool ready = true;
+			bool dependencyFailed = false;
+			for (size_t d = 0; d < asset.Dependencies.size(); d++)
+			{
+				AssetState state = assets[asset.Dependencies[d]].State;
+				dependencyFailed |= state == AssetState::Failed;
+				ready &= state == AssetState::Done;
+			}
+
+			if (dependencyFailed)
+			{
+				Fail((AssetHandle)i);
+				progress = true;
+				continue;
+			}
+			if (!ready)
+			{
+				pending = true;
+				continue;
+			}
+
+			bool succeeded = true;
+			if (asset.Finish && !headless)
+			{
+				asset.Timing.FinishStart = Now();
+				lock.unlock();
+				succeeded = asset.Finish();
+				lock.lock();
+				asset.Timing.FinishEnd = Now();
+			}
+
+			if (succeeded)
+			{
+				asset.State = AssetState::Done;
+				asset.Timing.Succeeded = true;
+			}
+			else
+			{
+				Fail((AssetHandle)i);
+			}
+			progress = true;
+		}
+
+		if (!pending)
+			break;
+		if (!progress && working)
+		{
+			lock.unlock();
+			jobs.Wait(working);
+			lock.lock();
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Runs the asset's job, or first that of a dependency it is
+// still waiting on
+// --------------------------------------------------------
+bool AssetLoader::Wait(AssetHandle asset)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	if (asset < 0 || asset >= (AssetHandle)assets.size())
+		return false;
+
+	while (true)
+	{
+		AssetState state = assets[asset].State;
+		if (state == AssetState::Worked || state == AssetState::Done || state == AssetState::Failed)
+			break;
+
+		if (state != AssetState::Waiting)
+		{
+			JobHandle job = assets[asset].Job;
+			lock.unlock();
+			jobs.Wait(job);
+			lock.lock();
+			continue;
+		}
+
+		AssetHandle dependency = InvalidAssetHandle;
+		for (AssetHandle d : assets[asset].Dependencies)
+		{
+			AssetState dependencyState = assets[d].State;
+			if (dependencyState == AssetState::Waiting || dependencyState == AssetState::Queued || dependencyState == AssetState::Working)
+			{
+				dependency = d;
+				break;
+			}
+		}
+		lock.unlock();
+		Wait(dependency);
+		lock.lock();
+	}
+	return assets[asset].State != AssetState::Failed;
+}
+
+bool AssetLoader::Succeeded(AssetHandle asset)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return asset >= 0 && asset < (AssetHandle)assets.size() && assets[asset].State == AssetState::Done;
+}
+
+std::vector<AssetTiming> AssetLoader::GetTimings()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	std::vector<AssetTiming> timings;
+	for (size_t i = 0; i < assets.size(); i++)
+		timings.push_back(assets[i].Timing);
+	return timings;
+}
+
+#if defined(DEBUG) || defined(_DEBUG)
+void AssetLoader::PrintTimings()
+{
+	std::vector<AssetTiming> timings = GetTimings();
+
+	double end = 0.0;
+	double workTotal = 0.0;
+	double finishTotal = 0.0;
+	printf("\n%-44s %6s %9s %9s %9s", "Asset", "Thread", "Wait ms", "Work ms", "Finish ms");
+	for (size_t i = 0; i < timings.size(); i++)
+	{
+		const AssetTiming& timing = timings[i];
+		double work = timing.WorkEnd - timing.WorkStart;
+		double finish = timing.FinishEnd - timing.FinishStart;
+		double wait = timing.WorkerThread >= 0 ? timing.WorkStart - timing.Queued : 0.0;
+
+		printf("\n%-44s %6d %9.2f %9.2f %9.2f%s",
+			timing.Name.c_str(), timing.WorkerThread, wait, work, finish,
+			timing.Succeeded ? "" : "  FAILED");
+
+		workTotal += work;
+		finishTotal += finish;
+		if (timing.WorkEnd > end) end = timing.WorkEnd;
+		if (timing.FinishEnd > end) end = timing.FinishEnd;
+	}
+
+	printf("\n%u assets in %.2f ms on %d threads - %.2f ms of work, %.2f ms finishing",
+		(unsigned int)timings.size(), end, jobs.GetThreadCount(), workTotal, finishTotal);
+}
+#endif
+
+void AssetLoader::RunWork(AssetHandle handle)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
+	// Assets live in a deque, so this stays valid while unlocked
+	Asset& asset = assets[handle];
+	asset.State = AssetState::Working;
+	asset.Timing.WorkerThread = jobs.GetCurrentThread();
+	asset.Timing.WorkStart = Now();
+
+	lock.unlock();
+	bool succeeded;
+	{
+		PROFILE_SCOPE("Load asset");
+		succeeded = asset.Work();
+	}
+	lock.lock();
+
+	asset.Timing.WorkEnd = Now();
+	CompleteWork(handle, succeeded);
+}
+
+// --------------------------------------------------------
+// Called with the mutex held from here down
+// --------------------------------------------------------
+void AssetLoader::Enqueue(AssetHandle handle)
+{
+	Asset& asset = assets[handle];
+	if (!asset.Work)
+	{
+		CompleteWork(handle, true);
+		return;
+	}
+
+	asset.State = AssetState::Queued;
+	asset.Job = jobs.Schedule("Load asset", [this, handle]() { RunWork(handle); });
+}
+
+void AssetLoader::CompleteWork(AssetHandle handle, bool succeeded)
+{
+	if (!succeeded)
+	{
+		Fail(handle);
+		return;
+	}
+
+	Asset& asset = assets[handle];
+	asset.State = AssetState::Worked;
+
+	// Release anything that was only waiting on this
+	for (size_t i = 0; i < asset.Dependents.size(); i++)
+	{
+		Asset& dependent = assets[asset.Dependents[i]];
+		if (dependent.State == AssetState::Waiting && --dependent.PendingDependencies == 0)
+			Enqueue(asset.Dependents[i]);
+	}
+}
+
+void AssetLoader::Fail(AssetHandle handle)
+{
+	Asset& asset = assets[handle];
+	asset.State = AssetState::Failed;
+	asset.Timing.Succeeded = false;
+
+	// Dependents still waiting will never be able to start
+	for (size_t i = 0; i < asset.Dependents.size(); i++)
+	{
+		if (assets[asset.Dependents[i]].State == AssetState::Waiting)
+			Fail(asset.Dependents[i]);
+	}
+}
+
+double AssetLoader::Now() const
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
\ No newline at end of file
@@ -0,0 +1,121 @@
+#pragma once
+#include "JobSystem.h"
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------
+// Identifies an asset queued on an AssetLoader
+// --------------------------------------------------------
+typedef int AssetHandle;
+const AssetHandle InvalidAssetHandle = -1;
+
+// Where one asset's load time went, in milliseconds since
+// the loader was created
+struct AssetTiming
+{
+	std::string Name;
+	int WorkerThread;		// Job system thread, -1 if it had no work step
+	double Queued;
+	double WorkStart;
+	double WorkEnd;
+	double FinishStart;
+	double FinishEnd;
+	bool Succeeded;
+};
+
+// --------------------------------------------------------
+// Loads assets as jobs on a job system
+//
+// Each asset has up to two steps:
+// - work runs as a job, for anything that doesn't touch
+//   the immediate context - reading files, parsing, decoding
+// - finish runs on the thread that owns the loader, during
+//   Finish(), for resource creation that must stay there
+// Either step returns false to fail the asset.
+//
+// An asset can depend on earlier ones.  Its work starts once
+// theirs is done, its finish runs after theirs, and it fails
+// without running if any of them failed.
+//
+// Finish() and Wait() run jobs while they wait, so the
+// owning thread helps with the loading too.  It must be the
+// thread that created the job system, and the job system
+// must not be Reset() while assets are still working.
+//
+// A headless loader never runs finish steps, so the work
+// side can be run and timed without a graphics device.
+// --------------------------------------------------------
+class AssetLoader
+{
+public:
+	AssetLoader(JobSystem& jobs, bool headless = false);
+	~AssetLoader();
+
+	AssetHandle Load(const char* name, std::function<bool()> work, std::function<bool()> finish,
+		std::initializer_list<AssetHandle> dependencies = {});
+
+	// Runs finish steps on this thread as work completes, and
+	// returns once every queued asset is done
+	void Finish();
+
+	// Runs jobs until one asset's work is done - returns
+	// whether it succeeded so far
+	bool Wait(AssetHandle asset);
+
+	bool Succeeded(AssetHandle asset);
+	int GetThreadCount() const { return jobs.GetThreadCount(); }
+
+	// One entry per asset, in the order they were queued
+	std::vector<AssetTiming> GetTimings();
+
+#if defined(DEBUG) || defined(_DEBUG)
+	// Prints GetTimings() as a table - debug builds only, which
+	// are the ones with a console
+	void PrintTimings();
+#endif
+
+private:
+	enum class AssetState
+	{
+		Waiting,	// For dependencies
+		Queued,		// For its job to run
+		Working,
+		Worked,		// Waiting to finish
+		Done,
+		Failed
+	};
+
+	struct Asset
+	{
+		std::function<bool()> Work;
+		std::function<bool()> Finish;
+		std::vector<AssetHandle> Dependencies;
+		std::vector<AssetHandle> Dependents;
+		int PendingDependencies;
+		AssetState State;
+		JobHandle Job;			// Once queued
+		AssetTiming Timing;
+	};
+
+	AssetLoader(const AssetLoader&) = delete;
+	AssetLoader& operator=(const AssetLoader&) = delete;
+
+	JobSystem& jobs;
+	bool headless;
+	std::chrono::steady_clock::time_point start;
+
+	// Everything below is guarded by the mutex
+	std::mutex mutex;
+	std::deque<Asset> assets;
+
+	void RunWork(AssetHandle handle);
+	void Enqueue(AssetHandle handle);
+	void CompleteWork(AssetHandle handle, bool succeeded);
+	void Fail(AssetHandle handle);
+	double Now() const;
+};
\ No newline at end of file
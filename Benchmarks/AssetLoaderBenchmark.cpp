@@ -0,0 +1,105 @@
+#include "AssetLoader.h"
+#include "Benchmark.h"
+#include "Mesh.h"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// --------------------------------------------------------
+	// Writes a grid of quads as an OBJ file and returns its size
+	// --------------------------------------------------------
+	long WriteGrid(const char* file, int quadsPerSide)
+	{
+		FILE* f = fopen(file, "wb");
+		if (!f)
+			return 0;
+
+		int side = quadsPerSide + 1;
+		for (int y = 0; y < side; y++)
+			for (int x = 0; x < side; x++)
+				fprintf(f, "v %f %f %f\nvt %f %f\nvn 0.000000 0.000000 1.000000\n",
+					x * 0.01f, y * 0.01f, 0.001f * ((x * 7 + y * 3) % 13),
+					(float)x / quadsPerSide, (float)y / quadsPerSide);
+		for (int y = 0; y < quadsPerSide; y++)
+			for (int x = 0; x < quadsPerSide; x++)
+			{
+				int a = y * side + x + 1;
+				int b = a + 1;
+				int c = a + side + 1;
+				int d = a + side;
+				fprintf(f, "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, b, b, b, c, c, c, d, d, d);
+			}
+
+		long size = ftell(f);
+		fclose(f);
+		return size;
+	}
+}
+
+// --------------------------------------------------------
+// Usage: AssetLoaderBenchmark [meshes] [quads per side]
+//
+// Load throughput without a graphics device: 32 OBJ files
+// of 128 x 128 quads by default, parsed and given tangents
+// one after another on this thread, then as assets on a
+// headless loader
+// --------------------------------------------------------
+int main(int argc, char* argv[])
+{
+	int meshCount = argc > 1 ? atoi(argv[1]) : 32;
+	int quadsPerSide = argc > 2 ? atoi(argv[2]) : 128;
+
+	std::vector<std::string> files;
+	long bytes = 0;
+	for (int i = 0; i < meshCount; i++)
+	{
+		char name[64];
+		snprintf(name, sizeof(name), "AssetLoaderBenchmark_%d.obj", i);
+		files.push_back(name);
+		bytes += WriteGrid(name, quadsPerSide);
+	}
+
+	// MeshData can't be reassigned, so each run starts afresh
+	double serial = Benchmark::BestOf(3, [&]()
+	{
+		std::vector<MeshData> meshes(meshCount);
+		for (int i = 0; i < meshCount; i++)
+			Mesh::LoadObj(files[i].c_str(), 0, meshes[i]);
+	});
+
+	JobSystem jobs;
+	int failed = 0;
+	double loaded = Benchmark::BestOf(3, [&]()
+	{
+		std::vector<MeshData> meshes(meshCount);
+		AssetLoader loader(jobs, true);
+		std::vector<AssetHandle> handles;
+		for (int i = 0; i < meshCount; i++)
+		{
+			MeshData* data = &meshes[i];
+			const char* file = files[i].c_str();
+			handles.push_back(loader.Load(file, [file, data, &jobs]() { return Mesh::LoadObj(file, 0, *data, &jobs); }, nullptr));
+		}
+		loader.Finish();
+
+		failed = 0;
+		for (size_t i = 0; i < handles.size(); i++)
+			failed += !loader.Succeeded(handles[i]);
+		jobs.Reset();
+	});
+
+	for (size_t i = 0; i < files.size(); i++)
+		remove(files[i].c_str());
+
+	double megabytes = bytes / (1024.0 * 1024.0);
+	printf("%d meshes, %.1f MB of OBJ, %d threads\n", meshCount, megabytes, jobs.GetThreadCount());
+	printf("%10s %10s %12s %10s\n", "", "ms", "meshes/s", "MB/s");
+	printf("%10s %10.2f %12.1f %10.1f\n", "serial", serial * 1000.0, meshCount / serial, megabytes / serial);
+	printf("%10s %10.2f %12.1f %10.1f\n", "loader", loaded * 1000.0, meshCount / loaded, megabytes / loaded);
+	if (failed)
+		printf("%d meshes failed to load\n", failed);
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <chrono>
+
+// --------------------------------------------------------
+// Timing shared by the benchmarks
+// --------------------------------------------------------
+namespace Benchmark
+{
+	// Runs the work the given number of times and returns the
+	// fastest run in seconds, which is the least noisy figure
+	template<typename Work>
+	double BestOf(int runs, Work work)
+	{
+		double best = 1e30;
+		for (int i = 0; i < runs; i++)
+		{
+			std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+			work();
+			std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+			if (elapsed.count() < best)
+				best = elapsed.count();
+		}
+		return best;
+	}
+}
@@ -0,0 +1,73 @@
+#include "Benchmark.h"
+#include "CullingReference.h"
+#include "CullingSystem.h"
+#include "TransformReference.h"
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Usage: CullingBenchmark [instances]
+//
+// Culls per second at 1M instances by default, through the
+// BVH and by testing every instance, plus the cost of a
+// refit after 1% of the instances moved
+// --------------------------------------------------------
+int main(int argc, char* argv[])
+{
+	size_t count = argc > 1 ? (size_t)atol(argv[1]) : 1000000;
+	unsigned int seed = 99;
+
+	// Instances spread through a 2km cube
+	TransformSystem transforms;
+	CullingSystem culling;
+	std::vector<BoundingBox> local(count, BoundingBox(XMFLOAT3(0, 0, 0), XMFLOAT3(1, 1, 1)));
+	transforms.Reserve(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		TransformId id = transforms.Create();
+		transforms.SetPosition(id,
+			TransformReference::Random(seed, -1000, 1000),
+			TransformReference::Random(seed, -1000, 1000),
+			TransformReference::Random(seed, -1000, 1000));
+		culling.Add(local[i], id);
+	}
+	transforms.Update();
+	culling.Update(transforms);
+
+	std::vector<BoundingBox> world(count);
+	for (size_t i = 0; i < count; i++)
+		CullingReference::WorldBounds(local[i], transforms.GetWorldMatrix((TransformId)i), world[i]);
+
+	// From the middle looking out, and from outside looking in
+	XMFLOAT4X4 views[2], projections[2];
+	CullingReference::MakeCamera(XMFLOAT3(0, 0, 0), XMFLOAT3(1, 0.2f, 0.5f), 500.0f, views[0], projections[0]);
+	CullingReference::MakeCamera(XMFLOAT3(0, 0, -1500), XMFLOAT3(0, 0, 1), 3000.0f, views[1], projections[1]);
+
+	printf("%u instances\n", (unsigned int)count);
+	printf("%8s %10s %14s %16s\n", "camera", "visible", "BVH culls/s", "brute culls/s");
+	for (int c = 0; c < 2; c++)
+	{
+		std::vector<unsigned int> visible;
+		double bvh = Benchmark::BestOf(10, [&]() { culling.Cull(views[c], projections[c], visible); });
+		size_t bvhVisible = visible.size();
+
+		CullingReference::Frustum frustum = CullingReference::MakeFrustum(views[c], projections[c]);
+		double brute = Benchmark::BestOf(3, [&]() { CullingReference::Cull(frustum, world, visible); });
+
+		printf("%8d %10u %14.1f %16.1f\n", c, (unsigned int)bvhVisible, 1.0 / bvh, 1.0 / brute);
+	}
+
+	// Refit cost when a few things move each frame
+	double refit = Benchmark::BestOf(5, [&]()
+	{
+		for (size_t i = 0; i < count; i += 100)
+			transforms.Move((TransformId)i, 0.5f, 0.0f, 0.0f);
+		transforms.Update();
+		culling.Update(transforms);
+	});
+	printf("move 1%% + refit: %.2f ms\n", refit * 1000.0);
+	return 0;
+}
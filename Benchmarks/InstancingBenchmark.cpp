@@ -0,0 +1,88 @@
+#include "Benchmark.h"
+#include "RenderQueue.h"
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+	// Stand-ins for the mesh/material pairs - the queue only
+	// compares the pointers
+	char materialObjects[64];
+	char meshObjects[64];
+	char shaderObject;
+
+	// Submits count draws spread evenly over the pairs, in an
+	// order that interleaves them like an unsorted scene
+	void Submit(RenderQueue& queue, size_t count, int pairs)
+	{
+		queue.Clear();
+		for (size_t i = 0; i < count; i++)
+		{
+			int pair = (int)(i % pairs);
+			DrawCall draw = {};
+			draw.VertexShader = (SimpleVertexShader*)&shaderObject;
+			draw.PixelShader = (SimplePixelShader*)&shaderObject;
+			draw.DrawMaterial = (Material*)&materialObjects[pair];
+			draw.DrawMesh = (Mesh*)&meshObjects[pair];
+			draw.World._41 = (float)i;
+			queue.Submit(draw, (float)((i * 7919) % count) / count);
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Usage: InstancingBenchmark [instances...]
+//
+// Times recording, sorting and replaying a frame through
+// the RenderQueue for 1k to 1M instances by default, over
+// one and 64 mesh/material pairs, and counts the draws with
+// and without instancing
+// --------------------------------------------------------
+int main(int argc, char* argv[])
+{
+	std::vector<size_t> counts;
+	for (int i = 1; i < argc; i++)
+		counts.push_back((size_t)atol(argv[i]));
+	if (counts.empty())
+	{
+		counts.push_back(1000);
+		counts.push_back(10000);
+		counts.push_back(100000);
+		counts.push_back(1000000);
+	}
+
+	int pairCounts[] = { 1, 64 };
+	printf("%10s %6s %10s %10s %12s %12s %10s %12s\n",
+		"instances", "pairs", "submit ms", "sort ms", "instanced ms", "single ms", "draws", "single draws");
+	for (size_t c = 0; c < counts.size(); c++)
+	{
+		for (int p = 0; p < 2; p++)
+		{
+			RenderQueue queue;
+			int runs = counts[c] >= 1000000 ? 3 : 10;
+
+			double submit = Benchmark::BestOf(runs, [&]() { Submit(queue, counts[c], pairCounts[p]); });
+
+			// Sorting works in place, so each run starts from a fresh submission
+			double sort = 1e30;
+			for (int r = 0; r < runs; r++)
+			{
+				Submit(queue, counts[c], pairCounts[p]);
+				double time = Benchmark::BestOf(1, [&]() { queue.Sort(); });
+				if (time < sort)
+					sort = time;
+			}
+
+			RecordingRenderBackend instancing(true);
+			double instanced = Benchmark::BestOf(runs, [&]() { instancing.Reset(); queue.Execute(&instancing); });
+
+			RecordingRenderBackend single(false);
+			double singles = Benchmark::BestOf(runs, [&]() { single.Reset(); queue.Execute(&single); });
+
+			printf("%10u %6d %10.3f %10.3f %12.3f %12.3f %10u %12u\n", (unsigned int)counts[c], pairCounts[p],
+				submit * 1000.0, sort * 1000.0, instanced * 1000.0, singles * 1000.0, instancing.Draws, single.Draws);
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,90 @@
+#include "Benchmark.h"
+#include "JobSystem.h"
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	// Some floating point work per element, enough that a
+	// range costs far more than scheduling it
+	void Compute(std::vector<float>& values, size_t first, size_t last)
+	{
+		for (size_t i = first; i < last; i++)
+		{
+			float x = values[i];
+			for (int k = 0; k < 32; k++)
+				x = sqrtf(x * x + 1.0f) * 0.5f;
+			values[i] = x;
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Usage: JobSystemBenchmark [max workers]
+//
+// Times the same work on 1 worker up to one per core by
+// default (plus the main thread, which runs jobs while it
+// waits), with the speedup over a plain loop:
+//  - one ParallelFor over 4M elements of arithmetic
+//  - 10k empty jobs, which is all scheduling overhead
+//  - a chain of 64 ParallelFors, each after the last
+// --------------------------------------------------------
+int main(int argc, char* argv[])
+{
+	int maxWorkers = argc > 1 ? atoi(argv[1]) : (int)std::thread::hardware_concurrency() - 1;
+	if (maxWorkers < 1)
+		maxWorkers = 1;
+
+	const size_t elements = 4 * 1024 * 1024;
+	const int emptyJobs = 10000;
+	const int chainLength = 64;
+	std::vector<float> values(elements, 1.0f);
+
+	// The chain does the same work as the loop, so one serial
+	// time is the baseline for both
+	double serial = Benchmark::BestOf(5, [&]() { Compute(values, 0, elements); });
+	printf("%8s %10.3f\n", "serial", serial * 1000.0);
+
+	printf("%8s %10s %8s %12s %10s %10s %8s\n", "workers", "loop ms", "speedup", "empty us/job", "chain ms", "speedup", "ranges");
+	for (int workers = 1; workers <= maxWorkers; workers++)
+	{
+		JobSystem jobs(workers);
+
+		double loop = Benchmark::BestOf(5, [&]() {
+			jobs.Wait(jobs.ParallelFor("Compute", elements, 4096, [&](size_t first, size_t last) { Compute(values, first, last); }));
+			jobs.Reset();
+		});
+
+		double empty = Benchmark::BestOf(5, [&]() {
+			std::atomic<int> runs(0);
+			std::vector<JobHandle> handles(emptyJobs);
+			for (int i = 0; i < emptyJobs; i++)
+				handles[i] = jobs.Schedule("Empty", [&]() { runs++; });
+			for (int i = 0; i < emptyJobs; i++)
+				jobs.Wait(handles[i]);
+			jobs.Reset();
+		});
+
+		size_t ranges = 0;
+		double chain = Benchmark::BestOf(5, [&]() {
+			JobHandle previous = 0;
+			for (int i = 0; i < chainLength; i++)
+			{
+				previous = jobs.ParallelFor("Chain", elements / chainLength, 1024, [&](size_t first, size_t last) {
+					Compute(values, first, last);
+				}, { previous });
+			}
+			jobs.Wait(previous);
+			ranges = jobs.GetTimings().size();
+			jobs.Reset();
+		});
+
+		printf("%8d %10.3f %8.2f %12.3f %10.3f %10.2f %8u\n", workers, loop * 1000.0, serial / loop,
+			empty * 1e6 / emptyJobs, chain * 1000.0, serial / chain, (unsigned int)ranges);
+	}
+	return 0;
+}
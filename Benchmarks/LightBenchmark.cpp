@@ -0,0 +1,62 @@
+#include "Benchmark.h"
+#include "CullingReference.h"
+#include "LightReference.h"
+#include "LightSystem.h"
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Usage: LightBenchmark [lights...]
+//
+// Times binning on one thread and on the jobs against
+// testing every light against every cluster, from 1k to 64k
+// lights by default.  The lights fill a cube around the
+// camera, so most are in view.
+// --------------------------------------------------------
+int main(int argc, char* argv[])
+{
+	std::vector<int> counts;
+	for (int i = 1; i < argc; i++)
+		counts.push_back(atoi(argv[i]));
+	if (counts.empty())
+	{
+		counts.push_back(1000);
+		counts.push_back(4000);
+		counts.push_back(16000);
+		counts.push_back(64000);
+	}
+
+	XMFLOAT4X4 view, projection;
+	CullingReference::MakeCamera(XMFLOAT3(0, 0, -100), XMFLOAT3(0, 0, 1), 300.0f, view, projection);
+	std::vector<LightReference::Cluster> clusters;
+	LightReference::MakeClusters(projection, clusters);
+
+	JobSystem jobs;
+	printf("%8s %12s %12s %12s %12s %9s\n", "lights", "per cluster", "brute ms", "serial ms", "jobs ms", "speedup");
+	for (size_t c = 0; c < counts.size(); c++)
+	{
+		std::vector<Light> lights;
+		LightReference::MakeLights(counts[c], 150.0f, 1234, lights);
+		LightSystem system;
+		for (size_t i = 0; i < lights.size(); i++)
+			system.Add(lights[i]);
+
+		std::vector<std::vector<unsigned int> > binned;
+		double brute = Benchmark::BestOf(1, [&]() { LightReference::Bin(lights, view, clusters, binned); });
+
+		int runs = counts[c] >= 16000 ? 5 : 20;
+		double serial = Benchmark::BestOf(runs, [&]() { system.Update(view, projection); });
+		double parallel = Benchmark::BestOf(runs, [&]()
+		{
+			system.Update(view, projection, &jobs);
+			jobs.Reset();
+		});
+
+		double perCluster = (double)system.GetLightIndices().size() / LightSystem::ClusterCount;
+		printf("%8d %12.2f %12.2f %12.3f %12.3f %8.2fx\n", counts[c], perCluster, brute * 1000.0, serial * 1000.0, parallel * 1000.0, brute / parallel);
+	}
+	return 0;
+}
@@ -0,0 +1,141 @@
+#include "Benchmark.h"
+#include "ObjLoader.h"
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// --------------------------------------------------------
+	// A grid of quads with every index form spelled out, which
+	// is all the old reader understood
+	// --------------------------------------------------------
+	std::string MakeGrid(int quadsPerSide)
+	{
+		std::string text;
+		char line[128];
+		int side = quadsPerSide + 1;
+		for (int y = 0; y < side; y++)
+			for (int x = 0; x < side; x++)
+			{
+				snprintf(line, sizeof(line), "v %f %f %f\nvt %f %f\nvn 0.000000 0.000000 1.000000\n",
+					x * 0.01f, y * 0.01f, 0.001f * ((x * 7 + y * 3) % 13),
+					(float)x / quadsPerSide, (float)y / quadsPerSide);
+				text += line;
+			}
+		for (int y = 0; y < quadsPerSide; y++)
+			for (int x = 0; x < quadsPerSide; x++)
+			{
+				int a = y * side + x + 1;
+				int b = a + 1;
+				int c = a + side + 1;
+				int d = a + side;
+				snprintf(line, sizeof(line), "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, b, b, b, c, c, c, d, d, d);
+				text += line;
+			}
+		return text;
+	}
+
+	// --------------------------------------------------------
+	// The reader ObjLoader replaced - 100 characters per line,
+	// one sscanf per line and one vertex per corner
+	// --------------------------------------------------------
+	void ParseLegacy(const std::string& text, std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+	{
+		std::istringstream obj(text);
+		std::vector<XMFLOAT3> positions;
+		std::vector<XMFLOAT3> normals;
+		std::vector<XMFLOAT2> uvs;
+		unsigned int vertCounter = 0;
+		char chars[100];
+
+		while (obj.good())
+		{
+			obj.getline(chars, 100);
+
+			if (chars[0] == 'v' && chars[1] == 'n')
+			{
+				XMFLOAT3 norm;
+				sscanf(chars, "vn %f %f %f", &norm.x, &norm.y, &norm.z);
+				normals.push_back(norm);
+			}
+			else if (chars[0] == 'v' && chars[1] == 't')
+			{
+				XMFLOAT2 uv;
+				sscanf(chars, "vt %f %f", &uv.x, &uv.y);
+				uvs.push_back(uv);
+			}
+			else if (chars[0] == 'v')
+			{
+				XMFLOAT3 pos;
+				sscanf(chars, "v %f %f %f", &pos.x, &pos.y, &pos.z);
+				positions.push_back(pos);
+			}
+			else if (chars[0] == 'f')
+			{
+				unsigned int i[12];
+				int facesRead = sscanf(chars,
+					"f %u/%u/%u %u/%u/%u %u/%u/%u %u/%u/%u",
+					&i[0], &i[1], &i[2], &i[3], &i[4], &i[5],
+					&i[6], &i[7], &i[8], &i[9], &i[10], &i[11]);
+
+				Vertex v[4] = {};
+				for (int c = 0; c < facesRead / 3; c++)
+				{
+					v[c].Position = positions[i[c * 3] - 1];
+					v[c].UV = uvs[i[c * 3 + 1] - 1];
+					v[c].Normal = normals[i[c * 3 + 2] - 1];
+					v[c].UV.y = 1.0f - v[c].UV.y;
+					v[c].Position.z *= -1.0f;
+					v[c].Normal.z *= -1.0f;
+				}
+
+				verts.push_back(v[0]); verts.push_back(v[2]); verts.push_back(v[1]);
+				indices.push_back(vertCounter++); indices.push_back(vertCounter++); indices.push_back(vertCounter++);
+				if (facesRead == 12)
+				{
+					verts.push_back(v[0]); verts.push_back(v[3]); verts.push_back(v[2]);
+					indices.push_back(vertCounter++); indices.push_back(vertCounter++); indices.push_back(vertCounter++);
+				}
+			}
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Usage: ObjLoaderBenchmark [quads per side]
+// --------------------------------------------------------
+int main(int argc, char* argv[])
+{
+	int quadsPerSide = argc > 1 ? atoi(argv[1]) : 1000;
+	std::string text = MakeGrid(quadsPerSide);
+	double megabytes = text.size() / (1024.0 * 1024.0);
+	printf("%d triangles, %.1f MB of OBJ text\n", quadsPerSide * quadsPerSide * 2, megabytes);
+
+	size_t legacyVerts = 0;
+	double legacy = Benchmark::BestOf(3, [&]()
+	{
+		std::vector<Vertex> verts;
+		std::vector<unsigned int> indices;
+		ParseLegacy(text, verts, indices);
+		legacyVerts = verts.size();
+	});
+
+	size_t weldedVerts = 0;
+	double tokenizer = Benchmark::BestOf(3, [&]()
+	{
+		std::vector<Vertex> verts;
+		std::vector<unsigned int> indices;
+		ObjLoader::Parse(text.c_str(), text.size(), verts, indices);
+		weldedVerts = verts.size();
+	});
+
+	printf("getline + sscanf: %8.1f ms  %7.1f MB/s  %u verts\n", legacy * 1000.0, megabytes / legacy, (unsigned int)legacyVerts);
+	printf("ObjLoader:        %8.1f ms  %7.1f MB/s  %u verts\n", tokenizer * 1000.0, megabytes / tokenizer, (unsigned int)weldedVerts);
+	printf("speedup:          %8.2fx\n", legacy / tokenizer);
+	return 0;
+}
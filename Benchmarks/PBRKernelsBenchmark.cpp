@@ -0,0 +1,131 @@
+#include "Benchmark.h"
+#include "PBRKernels.h"
+#include "LightSystem.h"
+#include <DirectXMath.h>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// A surface per sample, spread over a patch in front of
+	// the lights, in SoA arrays
+	struct Surfaces
+	{
+		std::vector<float> Position[3], View[3], Normal[3], Albedo[3], F0[3];
+		std::vector<float> Metallic, Roughness, NdotV;
+
+		Surfaces(size_t count)
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				float t = (float)i / count;
+				float angle = t * 40.0f;
+				Position[0].push_back(cosf(angle) * 2.0f);
+				Position[1].push_back(sinf(angle) * 2.0f);
+				Position[2].push_back(t);
+				View[0].push_back(0.0f); View[1].push_back(0.0f); View[2].push_back(-1.0f);
+				Normal[0].push_back(cosf(angle) * 0.6f); Normal[1].push_back(sinf(angle) * 0.6f); Normal[2].push_back(-0.8f);
+				for (int c = 0; c < 3; c++)
+				{
+					Albedo[c].push_back(0.5f + 0.1f * c);
+					F0[c].push_back(0.04f + 0.5f * t);
+				}
+				Metallic.push_back(t);
+				Roughness.push_back(0.1f + 0.9f * (1.0f - t));
+				NdotV.push_back(0.8f);
+			}
+		}
+
+		static KernelFloat3 In(const std::vector<float> v[3])
+		{
+			KernelFloat3 k = { &v[0][0], &v[1][0], &v[2][0] };
+			return k;
+		}
+	};
+}
+
+// --------------------------------------------------------
+// Usage: PBRKernelsBenchmark [samples...]
+//
+// Samples per second through each kernel path the CPU has,
+// for 1k to 1M samples by default: the four light radiance
+// the software rasterizer shades with, and the ambient
+// Fresnel term on its own
+// --------------------------------------------------------
+int main(int argc, char* argv[])
+{
+	std::vector<size_t> counts;
+	for (int i = 1; i < argc; i++)
+		counts.push_back((size_t)atol(argv[i]));
+	if (counts.empty())
+	{
+		counts.push_back(1000);
+		counts.push_back(100000);
+		counts.push_back(1000000);
+	}
+
+	// The game's four corner lights
+	LightSystem lightSystem;
+	XMFLOAT3 lightPositions[4] = { XMFLOAT3(10, 10, -10), XMFLOAT3(10, -10, -10), XMFLOAT3(-10, 10, -10), XMFLOAT3(-10, -10, -10) };
+	for (int i = 0; i < 4; i++)
+	{
+		Light light = {};
+		light.Type = LightType::Point;
+		light.Position = lightPositions[i];
+		light.Color = XMFLOAT3(300, 300, 300);
+		light.Range = 1000.0f;
+		lightSystem.Add(light);
+	}
+	const ShaderLight* shaderLights = &lightSystem.GetShaderLights()[0];
+	KernelPath paths[] = { KernelPath::Scalar, KernelPath::AVX2, KernelPath::AVX512 };
+	KernelPath original = PBRKernels::GetPath();
+
+	printf("%10s %8s %16s %9s %16s %9s\n", "samples", "path", "4 lights Ms/s", "speedup", "fresnel Ms/s", "speedup");
+	for (size_t c = 0; c < counts.size(); c++)
+	{
+		size_t count = counts[c];
+		Surfaces s(count);
+		std::vector<float> out[3];
+		for (int i = 0; i < 3; i++)
+			out[i].resize(count);
+		KernelFloat3Out radiance = { &out[0][0], &out[1][0], &out[2][0] };
+
+		// Enough repeats that small counts still take a while
+		int repeats = (int)(10000000 / count) + 1;
+		double scalarRadiance = 0.0, scalarFresnel = 0.0;
+		for (int p = 0; p < 3; p++)
+		{
+			if (!PBRKernels::SetPath(paths[p]))
+				continue;
+
+			double lights = Benchmark::BestOf(5, [&]() {
+				for (int r = 0; r < repeats; r++)
+				{
+					PBRKernels::AccumulateRadiance(count, Surfaces::In(s.Position), Surfaces::In(s.View), Surfaces::In(s.Normal),
+						Surfaces::In(s.Albedo), &s.Metallic[0], &s.Roughness[0], Surfaces::In(s.F0), shaderLights, 4, radiance);
+				}
+			});
+			double fresnel = Benchmark::BestOf(5, [&]() {
+				for (int r = 0; r < repeats; r++)
+					PBRKernels::FresnelSchlickRoughness(count, &s.NdotV[0], Surfaces::In(s.F0), &s.Roughness[0], radiance);
+			});
+
+			double lightRate = count * repeats / lights / 1e6;
+			double fresnelRate = count * repeats / fresnel / 1e6;
+			if (paths[p] == KernelPath::Scalar)
+			{
+				scalarRadiance = lightRate;
+				scalarFresnel = fresnelRate;
+			}
+			printf("%10u %8s %16.1f %8.2fx %16.1f %8.2fx\n", (unsigned int)count, PBRKernels::GetPathName(paths[p]),
+				lightRate, lightRate / scalarRadiance, fresnelRate, fresnelRate / scalarFresnel);
+		}
+	}
+
+	PBRKernels::SetPath(original);
+	return 0;
+}
@@ -0,0 +1,56 @@
+#include "Benchmark.h"
+#include "JobSystem.h"
+#include "TangentGenerator.h"
+#include "TangentReference.h"
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+// --------------------------------------------------------
+// Usage: TangentBenchmark [triangles...]
+//
+// Times TangentGenerator, on one thread and on the jobs,
+// against the one-triangle-at-a-time reference, from 10k to
+// 10M triangles by default
+// --------------------------------------------------------
+int main(int argc, char* argv[])
+{
+	std::vector<int> counts;
+	for (int i = 1; i < argc; i++)
+		counts.push_back(atoi(argv[i]));
+	if (counts.empty())
+	{
+		counts.push_back(10000);
+		counts.push_back(100000);
+		counts.push_back(1000000);
+		counts.push_back(10000000);
+	}
+
+	JobSystem jobs;
+	printf("%12s %12s %12s %12s %9s\n", "triangles", "reference ms", "SoA ms", "SoA jobs ms", "speedup");
+	for (size_t c = 0; c < counts.size(); c++)
+	{
+		std::vector<Vertex> verts;
+		std::vector<unsigned int> indices;
+		TangentReference::MakeSurface(counts[c], verts, indices);
+		int runs = counts[c] >= 1000000 ? 2 : 5;
+
+		double reference = Benchmark::BestOf(runs, [&]()
+		{
+			TangentReference::Generate(&verts[0], (int)verts.size(), &indices[0], (int)indices.size());
+		});
+		double soa = Benchmark::BestOf(runs, [&]()
+		{
+			TangentGenerator::Generate(&verts[0], (int)verts.size(), &indices[0], (int)indices.size());
+		});
+
+		double soaJobs = Benchmark::BestOf(runs, [&]()
+		{
+			TangentGenerator::Generate(&verts[0], (int)verts.size(), &indices[0], (int)indices.size(), &jobs);
+			jobs.Reset();
+		});
+
+		printf("%12d %12.2f %12.2f %12.2f %8.2fx\n", counts[c], reference * 1000.0, soa * 1000.0, soaJobs * 1000.0, reference / soaJobs);
+	}
+	return 0;
+}
@@ -0,0 +1,59 @@
+#include "Benchmark.h"
+#include "TransformReference.h"
+#include "TransformSystem.h"
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+	// Moves every nth transform, so that share of them is dirty
+	void MoveEvery(TransformSystem& system, size_t step)
+	{
+		size_t count = system.GetCount();
+		for (size_t i = 0; i < count; i += step)
+			system.Move((TransformId)i, 0.001f, 0.0f, 0.0f);
+	}
+}
+
+// --------------------------------------------------------
+// Usage: TransformBenchmark [entities...]
+//
+// Times one frame of transform updates for 1k, 100k and 1M
+// entities by default: the per-entity reference rebuilding
+// everything, and TransformSystem with every transform and
+// with 1% of them moving, on one thread and on the jobs
+// --------------------------------------------------------
+int main(int argc, char* argv[])
+{
+	std::vector<size_t> counts;
+	for (int i = 1; i < argc; i++)
+		counts.push_back((size_t)atol(argv[i]));
+	if (counts.empty())
+	{
+		counts.push_back(1000);
+		counts.push_back(100000);
+		counts.push_back(1000000);
+	}
+
+	JobSystem jobs;
+	printf("%10s %12s %12s %12s %12s %12s\n", "entities", "reference ms", "all ms", "all jobs ms", "1% ms", "1% jobs ms");
+	for (size_t c = 0; c < counts.size(); c++)
+	{
+		std::vector<TransformReference::Transform> reference;
+		TransformSystem system;
+		TransformReference::MakeTransforms(counts[c], false, reference, system);
+		system.Update();
+		int runs = counts[c] >= 1000000 ? 3 : 10;
+
+		double referenceTime = Benchmark::BestOf(runs, [&]() { TransformReference::Update(reference); });
+		double all = Benchmark::BestOf(runs, [&]() { MoveEvery(system, 1); system.Update(); });
+		double allJobs = Benchmark::BestOf(runs, [&]() { MoveEvery(system, 1); system.Update(&jobs); });
+		double some = Benchmark::BestOf(runs, [&]() { MoveEvery(system, 100); system.Update(); });
+		double someJobs = Benchmark::BestOf(runs, [&]() { MoveEvery(system, 100); system.Update(&jobs); });
+
+		printf("%10u %12.3f %12.3f %12.3f %12.3f %12.3f\n", (unsigned int)counts[c],
+			referenceTime * 1000.0, all * 1000.0, allJobs * 1000.0, some * 1000.0, someJobs * 1000.0);
+	}
+	return 0;
+}
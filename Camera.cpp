@@ -1,5 +1,5 @@
 #include "Camera.h"
-#include <Windows.h>
+#include <algorithm>
 
 using namespace DirectX;
 
@@ -11,6 +11,8 @@ Camera::Camera(float x, float y, float z)
 	XMStoreFloat4(&rotation, XMQuaternionIdentity());
 	xRotation = 0;
 	yRotation = 0;
+	nearClip = 0.1f;
+	farClip = 100.0f;
 
 	XMStoreFloat4x4(&viewMatrix, XMMatrixIdentity());
 	XMStoreFloat4x4(&projMatrix, XMMatrixIdentity());
@@ -45,32 +47,32 @@ void Camera::Rotate(float x, float y)
 	xRotation += x;
 	yRotation += y;
 
-	xRotation = max(min(xRotation, XM_PIDIV2), -XM_PIDIV2);
+	xRotation = std::max(std::min(xRotation, XM_PIDIV2), -XM_PIDIV2);
 
 	// Recreate the quaternion
 	XMStoreFloat4(&rotation, XMQuaternionRotationRollPitchYaw(xRotation, yRotation, 0));
 }
 
-// Camera's update, which looks for key presses
-void Camera::Update(float dt)
+// Camera's update, which moves based on the keys held
+void Camera::Update(float dt, const CameraInput& input)
 {
 	// Current speed
 	float speed = dt * 3;
 
 	// Speed up or down as necessary
-	if (GetAsyncKeyState(VK_SHIFT)) { speed *= 5; }
-	if (GetAsyncKeyState(VK_CONTROL)) { speed *= 0.1f; }
+	if (input.Fast) { speed *= 5; }
+	if (input.Slow) { speed *= 0.1f; }
 
 	// Movement
-	if (GetAsyncKeyState('W') & 0x8000) { MoveRelative(0, 0, speed); }
-	if (GetAsyncKeyState('S') & 0x8000) { MoveRelative(0, 0, -speed); }
-	if (GetAsyncKeyState('A') & 0x8000) { MoveRelative(-speed, 0, 0); }
-	if (GetAsyncKeyState('D') & 0x8000) { MoveRelative(speed, 0, 0); }
-	if (GetAsyncKeyState('X') & 0x8000) { MoveAbsolute(0, -speed, 0); }
-	if (GetAsyncKeyState(' ') & 0x8000) { MoveAbsolute(0, speed, 0); }
+	if (input.Forward) { MoveRelative(0, 0, speed); }
+	if (input.Back) { MoveRelative(0, 0, -speed); }
+	if (input.Left) { MoveRelative(-speed, 0, 0); }
+	if (input.Right) { MoveRelative(speed, 0, 0); }
+	if (input.Down) { MoveAbsolute(0, -speed, 0); }
+	if (input.Up) { MoveAbsolute(0, speed, 0); }
 
 	// Check for reset
-	if (GetAsyncKeyState('R') & 0x8000)
+	if (input.Reset)
 	{
 		position = startPosition;
 		xRotation = 0;
@@ -103,7 +105,7 @@ void Camera::UpdateProjectionMatrix(float aspectRatio)
 	XMMATRIX P = XMMatrixPerspectiveFovLH(
 		0.25f * XM_PI,		// Field of View Angle
 		aspectRatio,		// Aspect ratio
-		0.1f,				// Near clip plane distance
-		100.0f);			// Far clip plane distance
+		nearClip,			// Near clip plane distance
+		farClip);			// Far clip plane distance
 	XMStoreFloat4x4(&projMatrix, XMMatrixTranspose(P)); // Transpose for HLSL!
 }
\ No newline at end of file
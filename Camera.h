@@ -1,6 +1,22 @@
 #pragma once
 #include <DirectXMath.h>
 
+// --------------------------------------------------------
+// Which movement keys are held this frame - filled in by
+// the app, so the camera never talks to the OS itself
+// --------------------------------------------------------
+struct CameraInput
+{
+	bool Forward;
+	bool Back;
+	bool Left;
+	bool Right;
+	bool Up;
+	bool Down;
+	bool Fast;
+	bool Slow;
+	bool Reset;
+};
 
 class Camera
 {
@@ -14,7 +30,7 @@ public:
 	void Rotate(float x, float y);
 
 	// Updating
-	void Update(float dt);
+	void Update(float dt, const CameraInput& input);
 	void UpdateViewMatrix();
 	void UpdateProjectionMatrix(float aspectRatio);
 
@@ -22,6 +38,8 @@ public:
 	DirectX::XMFLOAT3 GetPosition() { return position; }
 	DirectX::XMFLOAT4X4 GetView() { return viewMatrix; }
 	DirectX::XMFLOAT4X4 GetProjection() { return projMatrix; }
+	float GetNearClip() { return nearClip; }
+	float GetFarClip() { return farClip; }
 
 private:
 	// Camera matrices
@@ -34,5 +52,9 @@ private:
 	DirectX::XMFLOAT4 rotation;
 	float xRotation;
 	float yRotation;
+
+	// Clip plane distances
+	float nearClip;
+	float farClip;
 };
 
@@ -0,0 +1,72 @@
+#include "ConstantBufferData.h"
+#include <cstring>
+
+UpdateFrequency GetUpdateFrequency(const std::string & bufferName)
+{
+	if (bufferName == "perFrame")
+		return UpdateFrequency::PerFrame;
+	if (bufferName == "perMaterial")
+		return UpdateFrequency::PerMaterial;
+	return UpdateFrequency::PerDraw;
+}
+
+
+ConstantBufferData::ConstantBufferData()
+{
+	data = 0;
+	size = 0;
+	dirtyStart = 0;
+	dirtyEnd = 0;
+}
+
+ConstantBufferData::~ConstantBufferData()
+{
+	delete[] data;
+}
+
+void ConstantBufferData::Resize(unsigned int size)
+{
+	delete[] data;
+	data = new unsigned char[size];
+	memset(data, 0, size);
+	this->size = size;
+
+	dirtyStart = 0;
+	dirtyEnd = size;
+}
+
+bool ConstantBufferData::Write(unsigned int offset, const void * data, unsigned int size)
+{
+	if (offset > this->size || size > this->size - offset)
+		return false;
+
+	// Nothing to do if the value hasn't changed
+	unsigned char* dest = this->data + offset;
+	if (memcmp(dest, data, size) == 0)
+		return false;
+
+	memcpy(dest, data, size);
+
+	// Grow the dirty range to cover it
+	if (offset < dirtyStart)
+		dirtyStart = offset;
+	if (offset + size > dirtyEnd)
+		dirtyEnd = offset + size;
+	return true;
+}
+
+bool ConstantBufferData::BeginUpload(SimpleShaderUploadStats & stats)
+{
+	if (!IsDirty())
+	{
+		stats.SkippedUploads++;
+		return false;
+	}
+
+	stats.Uploads++;
+	stats.BytesUploaded += size;
+
+	dirtyStart = size;
+	dirtyEnd = 0;
+	return true;
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <string>
+
+// --------------------------------------------------------
+// How often a constant buffer's data is expected to change,
+// taken from the buffer's name in the shader: "perFrame",
+// "perMaterial" or "perDraw".  Any other name is treated
+// as per draw.
+// --------------------------------------------------------
+enum class UpdateFrequency
+{
+	PerFrame,
+	PerMaterial,
+	PerDraw
+};
+
+UpdateFrequency GetUpdateFrequency(const std::string& bufferName);
+
+// --------------------------------------------------------
+// Running totals of constant buffer uploads
+// --------------------------------------------------------
+struct SimpleShaderUploadStats
+{
+	unsigned long long BytesUploaded;
+	unsigned int Uploads;
+	unsigned int SkippedUploads;
+};
+
+// --------------------------------------------------------
+// The CPU copy of a constant buffer, and which of its bytes
+// differ from the GPU copy
+//
+// Kept apart from SimpleShader, which needs D3D11, so the
+// dirty tracking can be tested on any platform
+// --------------------------------------------------------
+class ConstantBufferData
+{
+public:
+	ConstantBufferData();
+	~ConstantBufferData();
+
+	// Zeroes the data at the given size.  Nothing has been
+	// uploaded yet, so all of it is dirty.
+	void Resize(unsigned int size);
+
+	// Copies bytes in at an offset, marking them dirty unless
+	// they already held that value.  Returns false if they did.
+	bool Write(unsigned int offset, const void* data, unsigned int size);
+
+	// Counts an upload and marks everything clean if any of
+	// the data changed since the last one, or counts a skipped
+	// upload.  Returns whether the caller needs to upload.
+	bool BeginUpload(SimpleShaderUploadStats& stats);
+
+	bool IsDirty() const { return dirtyStart < dirtyEnd; }
+	unsigned int GetDirtyStart() const { return dirtyStart; }
+	unsigned int GetDirtyEnd() const { return dirtyEnd; }
+
+	const unsigned char* GetData() const { return data; }
+	unsigned int GetSize() const { return size; }
+
+private:
+	unsigned char* data;
+	unsigned int size;
+	unsigned int dirtyStart;
+	unsigned int dirtyEnd;
+
+	// Owns its data, so no copies
+	ConstantBufferData(const ConstantBufferData&);
+	ConstantBufferData& operator=(const ConstantBufferData&);
+};
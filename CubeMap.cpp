@@ -0,0 +1,105 @@
+#include "CubeMap.h"
+#include <cmath>
+
+using namespace DirectX;
+
+const CubeFaceBasis CubeFaces[6] =
+{
+	{ {  0, 0, -1 }, { 0, -1,  0 }, {  1,  0,  0 } },	// +X
+	{ {  0, 0,  1 }, { 0, -1,  0 }, { -1,  0,  0 } },	// -X
+	{ {  1, 0,  0 }, { 0,  0,  1 }, {  0,  1,  0 } },	// +Y
+	{ {  1, 0,  0 }, { 0,  0, -1 }, {  0, -1,  0 } },	// -Y
+	{ {  1, 0,  0 }, { 0, -1,  0 }, {  0,  0,  1 } },	// +Z
+	{ { -1, 0,  0 }, { 0, -1,  0 }, {  0,  0, -1 } },	// -Z
+};
+
+XMFLOAT3 CubeMapData::Sample(float x, float y, float z) const
+{
+	// Pick the face from the largest axis
+	float ax = fabsf(x), ay = fabsf(y), az = fabsf(z);
+	int face;
+	float major;
+	if (ax >= ay && ax >= az) { face = x > 0 ? 0 : 1; major = ax; }
+	else if (ay >= az) { face = y > 0 ? 2 : 3; major = ay; }
+	else { face = z > 0 ? 4 : 5; major = az; }
+
+	// Project onto the face's axes
+	const CubeFaceBasis& basis = CubeFaces[face];
+	float u = (x * basis.U[0] + y * basis.U[1] + z * basis.U[2]) / major;
+	float v = (x * basis.V[0] + y * basis.V[1] + z * basis.V[2]) / major;
+
+	// Texel space, with texel centers on whole numbers
+	float tx = (u + 1.0f) * 0.5f * Size - 0.5f;
+	float ty = (v + 1.0f) * 0.5f * Size - 0.5f;
+	float maxCoord = (float)(Size - 1);
+	tx = tx < 0.0f ? 0.0f : (tx > maxCoord ? maxCoord : tx);
+	ty = ty < 0.0f ? 0.0f : (ty > maxCoord ? maxCoord : ty);
+
+	int x0 = (int)tx;
+	int y0 = (int)ty;
+	int x1 = x0 + 1 < Size ? x0 + 1 : x0;
+	int y1 = y0 + 1 < Size ? y0 + 1 : y0;
+	float fx = tx - x0;
+	float fy = ty - y0;
+
+	const XMFLOAT3* texels = &Faces[face][0];
+	const XMFLOAT3& a = texels[y0 * Size + x0];
+	const XMFLOAT3& b = texels[y0 * Size + x1];
+	const XMFLOAT3& c = texels[y1 * Size + x0];
+	const XMFLOAT3& d = texels[y1 * Size + x1];
+
+	float wa = (1 - fx) * (1 - fy);
+	float wb = fx * (1 - fy);
+	float wc = (1 - fx) * fy;
+	float wd = fx * fy;
+	return XMFLOAT3(
+		a.x * wa + b.x * wb + c.x * wc + d.x * wd,
+		a.y * wa + b.y * wb + c.y * wc + d.y * wd,
+		a.z * wa + b.z * wb + c.z * wc + d.z * wd);
+}
+
+void CubeMapData::Downsample(CubeMapData & half) const
+{
+	int halfSize = Size > 1 ? Size / 2 : 1;
+	half.Resize(halfSize);
+
+	for (int f = 0; f < 6; f++)
+	{
+		const XMFLOAT3* src = &Faces[f][0];
+		XMFLOAT3* dest = &half.Faces[f][0];
+		for (int y = 0; y < halfSize; y++)
+		{
+			for (int x = 0; x < halfSize; x++)
+			{
+				int sx = x * 2;
+				int sy = y * 2;
+				int sx1 = sx + 1 < Size ? sx + 1 : sx;
+				int sy1 = sy + 1 < Size ? sy + 1 : sy;
+
+				XMVECTOR sum =
+					XMLoadFloat3(&src[sy * Size + sx]) +
+					XMLoadFloat3(&src[sy * Size + sx1]) +
+					XMLoadFloat3(&src[sy1 * Size + sx]) +
+					XMLoadFloat3(&src[sy1 * Size + sx1]);
+				XMStoreFloat3(&dest[y * halfSize + x], sum * 0.25f);
+			}
+		}
+	}
+}
+
+XMFLOAT3 CubeMapData::TexelDirection(int face, int size, int x, int y)
+{
+	const CubeFaceBasis& basis = CubeFaces[face];
+	float u = (x + 0.5f) * 2.0f / size - 1.0f;
+	float v = (y + 0.5f) * 2.0f / size - 1.0f;
+
+	XMVECTOR dir = XMVectorSet(
+		basis.U[0] * u + basis.V[0] * v + basis.N[0],
+		basis.U[1] * u + basis.V[1] * v + basis.N[1],
+		basis.U[2] * u + basis.V[2] * v + basis.N[2],
+		0);
+
+	XMFLOAT3 result;
+	XMStoreFloat3(&result, XMVector3Normalize(dir));
+	return result;
+}
\ No newline at end of file
@@ -0,0 +1,46 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+
+// --------------------------------------------------------
+// Where a face's texels point: U * u + V * v + N for u and
+// v in [-1, 1] across and down the face
+// --------------------------------------------------------
+struct CubeFaceBasis
+{
+	float U[3];
+	float V[3];
+	float N[3];
+};
+
+// In D3D face order: +X, -X, +Y, -Y, +Z, -Z
+extern const CubeFaceBasis CubeFaces[6];
+
+// --------------------------------------------------------
+// Linear RGB cube map held on the CPU
+//
+// Faces are in D3D order (+X, -X, +Y, -Y, +Z, -Z), each
+// Size x Size texels stored row by row from the top.
+// --------------------------------------------------------
+struct CubeMapData
+{
+	int Size;
+	std::vector<DirectX::XMFLOAT3> Faces[6];
+
+	void Resize(int size)
+	{
+		Size = size;
+		for (int f = 0; f < 6; f++)
+			Faces[f].assign(size * size, DirectX::XMFLOAT3(0, 0, 0));
+	}
+
+	// Bilinear lookup in the direction given, which needn't
+	// be normalized - filtering stops at the face edges
+	DirectX::XMFLOAT3 Sample(float x, float y, float z) const;
+
+	// Averages each 2x2 block into a cube map half the size
+	void Downsample(CubeMapData& half) const;
+
+	// The direction through the center of a texel
+	static DirectX::XMFLOAT3 TexelDirection(int face, int size, int x, int y);
+};
\ No newline at end of file
@@ -0,0 +1,338 @@
+#include "CullingSystem.h"
+#include <algorithm>
+#include <functional>
+
+using namespace DirectX;
+
+namespace
+{
+	// Most objects a leaf holds before it is split
+	const unsigned int MaxLeafObjects = 4;
+
+	// Parent of the root node
+	const unsigned int NoNode = 0xFFFFFFFF;
+
+	// Below this many objects per job, jobs cost more than they save
+	const size_t MinObjectsPerJob = 1024;
+
+	enum Containment
+	{
+		Outside,
+		Intersects,
+		Inside
+	};
+
+	// --------------------------------------------------------
+	// The six frustum planes, split by component so one vector
+	// holds the same component of four planes
+	// --------------------------------------------------------
+	struct FrustumPlanes
+	{
+		XMVECTOR X[2];
+		XMVECTOR Y[2];
+		XMVECTOR Z[2];
+		XMVECTOR W[2];
+	};
+
+	// --------------------------------------------------------
+	// Box against all six planes at once - the box is outside
+	// if it is entirely behind any plane, and inside if it is
+	// entirely in front of every plane
+	// --------------------------------------------------------
+	inline Containment Classify(const FrustumPlanes& planes, const XMFLOAT3& center, const XMFLOAT3& extents)
+	{
+		XMVECTOR cx = XMVectorReplicate(center.x);
+		XMVECTOR cy = XMVectorReplicate(center.y);
+		XMVECTOR cz = XMVectorReplicate(center.z);
+		XMVECTOR ex = XMVectorReplicate(extents.x);
+		XMVECTOR ey = XMVectorReplicate(extents.y);
+		XMVECTOR ez = XMVectorReplicate(extents.z);
+		XMVECTOR zero = XMVectorZero();
+
+		bool inside = true;
+		for (int i = 0; i < 2; i++)
+		{
+			XMVECTOR distance = planes.X[i] * cx + planes.Y[i] * cy + planes.Z[i] * cz + planes.W[i];
+			XMVECTOR radius = XMVectorAbs(planes.X[i]) * ex + XMVectorAbs(planes.Y[i]) * ey + XMVectorAbs(planes.Z[i]) * ez;
+
+			if (!XMVector4GreaterOrEqual(distance + radius, zero))
+				return Outside;
+			if (!XMVector4GreaterOrEqual(distance - radius, zero))
+				inside = false;
+		}
+		return inside ? Inside : Intersects;
+	}
+}
+
+
+CullingSystem::CullingSystem()
+{
+	needsRebuild = false;
+}
+
+CullingSystem::~CullingSystem()
+{
+}
+
+unsigned int CullingSystem::Add(const BoundingBox & bounds, TransformId transform)
+{
+	unsigned int object = (unsigned int)transformIds.size();
+
+	localBounds.push_back(bounds);
+	transformIds.push_back(transform);
+	worldCenters.push_back(bounds.Center);
+	worldExtents.push_back(bounds.Extents);
+	leafOf.push_back(0);
+
+	if (transform >= objectOfTransform.size())
+		objectOfTransform.resize(transform + 1, -1);
+	objectOfTransform[transform] = (int)object;
+
+	needsRebuild = true;
+	return object;
+}
+
+void CullingSystem::Update(TransformSystem & transforms, JobSystem* jobs)
+{
+	// New objects - start from scratch
+	if (needsRebuild)
+	{
+		movedObjects.resize(transformIds.size());
+		for (unsigned int i = 0; i < transformIds.size(); i++)
+			movedObjects[i] = i;
+		UpdateWorldBounds(transforms, jobs);
+
+		Build();
+		needsRebuild = false;
+		return;
+	}
+
+	movedObjects.clear();
+	const std::vector<TransformId>& changed = transforms.GetChanged();
+	for (size_t i = 0; i < changed.size(); i++)
+	{
+		TransformId transform = changed[i];
+		if (transform < objectOfTransform.size() && objectOfTransform[transform] >= 0)
+			movedObjects.push_back((unsigned int)objectOfTransform[transform]);
+	}
+	UpdateWorldBounds(transforms, jobs);
+
+	// Mark each moved object's leaf and its ancestors
+	for (size_t i = 0; i < movedObjects.size(); i++)
+	{
+		unsigned int object = movedObjects[i];
+		for (unsigned int node = leafOf[object]; node != NoNode && !nodeDirty[node]; node = nodes[node].Parent)
+		{
+			nodeDirty[node] = 1;
+			refitList.push_back(node);
+		}
+	}
+
+	// Children always come after their parents, so refitting
+	// from the back fixes every child before its parent
+	std::sort(refitList.begin(), refitList.end(), std::greater<unsigned int>());
+	for (size_t i = 0; i < refitList.size(); i++)
+	{
+		FitNode(refitList[i]);
+		nodeDirty[refitList[i]] = 0;
+	}
+	refitList.clear();
+}
+
+void CullingSystem::Cull(const XMFLOAT4X4 & view, const XMFLOAT4X4 & projection, std::vector<unsigned int>& visible)
+{
+	visible.clear();
+	if (nodes.empty())
+		return;
+
+	// Both matrices are transposed, so this is (view * projection)
+	// transposed and its rows are the columns the planes come from
+	XMMATRIX viewProj = XMMatrixMultiply(XMLoadFloat4x4(&projection), XMLoadFloat4x4(&view));
+	XMMATRIX first;
+	first.r[0] = viewProj.r[3] + viewProj.r[0];   // Left
+	first.r[1] = viewProj.r[3] - viewProj.r[0];   // Right
+	first.r[2] = viewProj.r[3] + viewProj.r[1];   // Bottom
+	first.r[3] = viewProj.r[3] - viewProj.r[1];   // Top
+	XMMATRIX second;
+	second.r[0] = viewProj.r[2];                  // Near
+	second.r[1] = viewProj.r[3] - viewProj.r[2];  // Far
+	second.r[2] = second.r[0];                    // Repeat to fill the vector
+	second.r[3] = second.r[1];
+
+	// Transposing puts each component of the planes in its own row
+	first = XMMatrixTranspose(first);
+	second = XMMatrixTranspose(second);
+	FrustumPlanes planes;
+	planes.X[0] = first.r[0]; planes.Y[0] = first.r[1]; planes.Z[0] = first.r[2]; planes.W[0] = first.r[3];
+	planes.X[1] = second.r[0]; planes.Y[1] = second.r[1]; planes.Z[1] = second.r[2]; planes.W[1] = second.r[3];
+
+	stack.clear();
+	stack.push_back(0);
+	while (!stack.empty())
+	{
+		unsigned int index = stack.back();
+		stack.pop_back();
+		const Node& node = nodes[index];
+
+		Containment containment = Classify(planes, node.Center, node.Extents);
+		if (containment == Outside)
+			continue;
+
+		// Everything below is visible - no more tests needed
+		if (containment == Inside)
+		{
+			visible.insert(visible.end(), objectOrder.begin() + node.First, objectOrder.begin() + node.First + node.Count);
+			continue;
+		}
+
+		// Partly visible leaf - test its objects one by one
+		if (node.Right == 0)
+		{
+			for (unsigned int i = node.First; i < node.First + node.Count; i++)
+			{
+				unsigned int object = objectOrder[i];
+				if (Classify(planes, worldCenters[object], worldExtents[object]) != Outside)
+					visible.push_back(object);
+			}
+			continue;
+		}
+
+		stack.push_back(node.Right);
+		stack.push_back(index + 1);
+	}
+}
+
+// --------------------------------------------------------
+// Every moved object's bounds are independent, so they are
+// spread across the jobs when there are enough of them
+// --------------------------------------------------------
+void CullingSystem::UpdateWorldBounds(TransformSystem & transforms, JobSystem* jobs)
+{
+	if (!jobs || movedObjects.size() < MinObjectsPerJob * 2)
+	{
+		for (size_t i = 0; i < movedObjects.size(); i++)
+			UpdateWorldBounds(movedObjects[i], transforms);
+		return;
+	}
+
+	jobs->Wait(jobs->ParallelFor("Update world bounds", movedObjects.size(), MinObjectsPerJob, [this, &transforms](size_t first, size_t last) {
+		for (size_t i = first; i < last; i++)
+			UpdateWorldBounds(movedObjects[i], transforms);
+	}));
+}
+
+void CullingSystem::UpdateWorldBounds(unsigned int object, TransformSystem & transforms)
+{
+	XMMATRIX world = XMMatrixTranspose(XMLoadFloat4x4(&transforms.GetWorldMatrix(transformIds[object])));
+
+	BoundingBox box;
+	localBounds[object].Transform(box, world);
+	worldCenters[object] = box.Center;
+	worldExtents[object] = box.Extents;
+}
+
+void CullingSystem::Build()
+{
+	nodes.clear();
+	objectOrder.resize(transformIds.size());
+	for (unsigned int i = 0; i < objectOrder.size(); i++)
+		objectOrder[i] = i;
+
+	if (!objectOrder.empty())
+		BuildNode(NoNode, 0, (unsigned int)objectOrder.size());
+
+	nodeDirty.assign(nodes.size(), 0);
+}
+
+// --------------------------------------------------------
+// Splits objects [first, first + count) at the median of
+// their centers along the longest axis of the range
+// --------------------------------------------------------
+unsigned int CullingSystem::BuildNode(unsigned int parent, unsigned int first, unsigned int count)
+{
+	unsigned int index = (unsigned int)nodes.size();
+	Node node = {};
+	node.Parent = parent;
+	node.First = first;
+	node.Count = count;
+	nodes.push_back(node);
+
+	if (count <= MaxLeafObjects)
+	{
+		for (unsigned int i = first; i < first + count; i++)
+			leafOf[objectOrder[i]] = index;
+		FitNode(index);
+		return index;
+	}
+
+	// Find the longest axis of the centers
+	XMVECTOR minCenter = XMLoadFloat3(&worldCenters[objectOrder[first]]);
+	XMVECTOR maxCenter = minCenter;
+	for (unsigned int i = first + 1; i < first + count; i++)
+	{
+		XMVECTOR center = XMLoadFloat3(&worldCenters[objectOrder[i]]);
+		minCenter = XMVectorMin(minCenter, center);
+		maxCenter = XMVectorMax(maxCenter, center);
+	}
+	XMFLOAT3 size;
+	XMStoreFloat3(&size, maxCenter - minCenter);
+	int axis = 0;
+	if (size.y > size.x) axis = 1;
+	if (size.z > (&size.x)[axis]) axis = 2;
+
+	// Half on each side
+	unsigned int half = count / 2;
+	const std::vector<XMFLOAT3>& centers = worldCenters;
+	std::nth_element(
+		objectOrder.begin() + first,
+		objectOrder.begin() + first + half,
+		objectOrder.begin() + first + count,
+		[&centers, axis](unsigned int a, unsigned int b) { return (&centers[a].x)[axis] < (&centers[b].x)[axis]; });
+
+	BuildNode(index, first, half);
+	unsigned int right = BuildNode(index, first + half, count - half);
+	nodes[index].Right = right;
+
+	FitNode(index);
+	return index;
+}
+
+// --------------------------------------------------------
+// Recomputes a node's box from its objects or its children
+// --------------------------------------------------------
+void CullingSystem::FitNode(unsigned int index)
+{
+	Node& node = nodes[index];
+	XMVECTOR minCorner, maxCorner;
+
+	if (node.Right == 0)
+	{
+		unsigned int object = objectOrder[node.First];
+		XMVECTOR center = XMLoadFloat3(&worldCenters[object]);
+		XMVECTOR extents = XMLoadFloat3(&worldExtents[object]);
+		minCorner = center - extents;
+		maxCorner = center + extents;
+		for (unsigned int i = node.First + 1; i < node.First + node.Count; i++)
+		{
+			object = objectOrder[i];
+			center = XMLoadFloat3(&worldCenters[object]);
+			extents = XMLoadFloat3(&worldExtents[object]);
+			minCorner = XMVectorMin(minCorner, center - extents);
+			maxCorner = XMVectorMax(maxCorner, center + extents);
+		}
+	}
+	else
+	{
+		const Node& left = nodes[index + 1];
+		const Node& right = nodes[node.Right];
+		XMVECTOR leftCenter = XMLoadFloat3(&left.Center);
+		XMVECTOR leftExtents = XMLoadFloat3(&left.Extents);
+		XMVECTOR rightCenter = XMLoadFloat3(&right.Center);
+		XMVECTOR rightExtents = XMLoadFloat3(&right.Extents);
+		minCorner = XMVectorMin(leftCenter - leftExtents, rightCenter - rightExtents);
+		maxCorner = XMVectorMax(leftCenter + leftExtents, rightCenter + rightExtents);
+	}
+
+	XMStoreFloat3(&node.Center, (minCorner + maxCorner) * 0.5f);
+	XMStoreFloat3(&node.Extents, (maxCorner - minCorner) * 0.5f);
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+#include <vector>
+#include "TransformSystem.h"
+
+// --------------------------------------------------------
+// Finds which objects are inside the camera's frustum
+//
+// Each object is a local bounding box attached to a
+// transform.  World space boxes are kept in a bounding
+// volume hierarchy that is built once and then refit
+// bottom-up for just the objects that moved.
+//
+// Culling walks the hierarchy testing each node against
+// all six frustum planes at once, and skips the tests for
+// everything under a node that is entirely inside.
+// --------------------------------------------------------
+class CullingSystem
+{
+public:
+	CullingSystem();
+	~CullingSystem();
+
+	// Adds an object and returns its index, which is what Cull()
+	// reports.  Only one object per transform is supported.
+	unsigned int Add(const DirectX::BoundingBox& localBounds, TransformId transform);
+
+	// Catches up with anything the last TransformSystem::Update()
+	// moved, rebuilding the tree if objects were added.  New
+	// world bounds are spread across the jobs if given.
+	void Update(TransformSystem& transforms, JobSystem* jobs = 0);
+
+	// Replaces visible with the index of every object that
+	// might be seen through the given (transposed) matrices
+	void Cull(const DirectX::XMFLOAT4X4& view, const DirectX::XMFLOAT4X4& projection, std::vector<unsigned int>& visible);
+
+	size_t GetCount() { return transformIds.size(); }
+
+private:
+	struct Node
+	{
+		DirectX::XMFLOAT3 Center;
+		DirectX::XMFLOAT3 Extents;
+		unsigned int Parent;
+		unsigned int Right;   // Zero for leaves - the left child is always the next node
+		unsigned int First;   // Objects under this node are objectOrder[First, First + Count)
+		unsigned int Count;
+	};
+
+	// Objects
+	std::vector<DirectX::BoundingBox> localBounds;
+	std::vector<TransformId> transformIds;
+	std::vector<DirectX::XMFLOAT3> worldCenters;
+	std::vector<DirectX::XMFLOAT3> worldExtents;
+	std::vector<unsigned int> leafOf;
+	std::vector<int> objectOfTransform;
+	std::vector<unsigned int> movedObjects;
+
+	// Tree
+	std::vector<Node> nodes;
+	std::vector<unsigned int> objectOrder;
+	std::vector<unsigned char> nodeDirty;
+	std::vector<unsigned int> refitList;
+	std::vector<unsigned int> stack;
+	bool needsRebuild;
+
+	void UpdateWorldBounds(TransformSystem& transforms, JobSystem* jobs);
+	void UpdateWorldBounds(unsigned int object, TransformSystem& transforms);
+	void Build();
+	unsigned int BuildNode(unsigned int parent, unsigned int first, unsigned int count);
+	void FitNode(unsigned int node);
+};
@@ -0,0 +1,61 @@
+#include "D3D11GeometryBackend.h"
+
+
+D3D11GeometryBackend::D3D11GeometryBackend(ID3D11Device * device)
+{
+	this->device = device;
+}
+
+D3D11GeometryBackend::~D3D11GeometryBackend()
+{
+}
+
+GeometryHandle D3D11GeometryBackend::CreateVertexBuffer(const Vertex * verts, int numVerts)
+{
+	D3D11_BUFFER_DESC vbd;
+	vbd.Usage = D3D11_USAGE_IMMUTABLE;
+	vbd.ByteWidth = sizeof(Vertex) * numVerts; // Number of vertices
+	vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	vbd.CPUAccessFlags = 0;
+	vbd.MiscFlags = 0;
+	vbd.StructureByteStride = 0;
+	D3D11_SUBRESOURCE_DATA initialVertexData;
+	initialVertexData.pSysMem = verts;
+
+	ID3D11Buffer* buffer = 0;
+	device->CreateBuffer(&vbd, &initialVertexData, &buffer);
+	return (GeometryHandle)buffer;
+}
+
+GeometryHandle D3D11GeometryBackend::CreateIndexBuffer(const void * indices, int numIndices, IndexFormat format)
+{
+	D3D11_BUFFER_DESC ibd;
+	ibd.Usage = D3D11_USAGE_IMMUTABLE;
+	ibd.ByteWidth = (format == IndexFormat::UInt16 ? sizeof(unsigned short) : sizeof(unsigned int)) * numIndices; // Number of indices
+	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	ibd.CPUAccessFlags = 0;
+	ibd.MiscFlags = 0;
+	ibd.StructureByteStride = 0;
+	D3D11_SUBRESOURCE_DATA initialIndexData;
+	initialIndexData.pSysMem = indices;
+
+	ID3D11Buffer* buffer = 0;
+	device->CreateBuffer(&ibd, &initialIndexData, &buffer);
+	return (GeometryHandle)buffer;
+}
+
+void D3D11GeometryBackend::ReleaseBuffer(GeometryHandle buffer)
+{
+	if (buffer)
+		GetBuffer(buffer)->Release();
+}
+
+ID3D11Buffer * D3D11GeometryBackend::GetBuffer(GeometryHandle buffer)
+{
+	return (ID3D11Buffer*)buffer;
+}
+
+DXGI_FORMAT D3D11GeometryBackend::GetFormat(IndexFormat format)
+{
+	return format == IndexFormat::UInt16 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include "DXCore.h"
+#include "GeometryBackend.h"
+
+// --------------------------------------------------------
+// Creates immutable Direct3D 11 buffers for meshes
+//
+// Handles are just the ID3D11Buffer pointers, so GetBuffer()
+// is a cast rather than a lookup.
+// --------------------------------------------------------
+class D3D11GeometryBackend : public GeometryBackend
+{
+public:
+	D3D11GeometryBackend(ID3D11Device* device);
+	~D3D11GeometryBackend();
+
+	GeometryHandle CreateVertexBuffer(const Vertex* verts, int numVerts);
+	GeometryHandle CreateIndexBuffer(const void* indices, int numIndices, IndexFormat format);
+	void ReleaseBuffer(GeometryHandle buffer);
+
+	// Converters for use when binding
+	static ID3D11Buffer* GetBuffer(GeometryHandle buffer);
+	static DXGI_FORMAT GetFormat(IndexFormat format);
+
+private:
+	ID3D11Device* device;
+};
@@ -1,4 +1,5 @@
 #include "DXCore.h"
+#include "FrameProfiler.h"
 
 #include <WindowsX.h>
 #include <sstream>
@@ -375,6 +376,7 @@ HRESULT DXCore::Run()
 			// The game loop
 			Update(deltaTime, totalTime);
 			Draw(deltaTime, totalTime);
+			PROFILE_FRAME();
 		}
 	}
 
@@ -446,6 +448,15 @@ void DXCore::UpdateTitleBarStats()
 		"    FPS: "			<< fpsFrameCount <<
 		"    Frame Time: "	<< mspf << "ms";
 
+#if PROFILING_ENABLED
+	// Per frame averages over the profiler's history
+	output.precision(4);
+	output <<
+		"    Draws: "		<< FrameProfiler::GetAverageCount(ProfileCounter::DrawCalls) <<
+		"    Update: "		<< FrameProfiler::GetAverageMilliseconds("Game::Update") << "ms" <<
+		"    Draw: "		<< FrameProfiler::GetAverageMilliseconds("Game::Draw") << "ms";
+#endif
+
 	// Append the version of DirectX the app is using
 	switch (dxFeatureLevel)
 	{
@@ -0,0 +1,363 @@
+#include "FrameProfiler.h"
+
+#if PROFILING_ENABLED
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+	const std::chrono::steady_clock::time_point profilerStart = std::chrono::steady_clock::now();
+
+	// Writes a scope name as a JSON string
+	void WriteName(std::ofstream& out, const char* name)
+	{
+		out << '"';
+		for (const char* c = name; *c; c++)
+		{
+			if (*c == '"' || *c == '\\')
+				out << '\\' << *c;
+			else if ((unsigned char)*c >= 0x20)
+				out << *c;
+		}
+		out << '"';
+	}
+}
+
+FrameProfiler::State::State()
+{
+	for (int i = 0; i < (int)ProfileCounter::Count; i++)
+		Counters[i] = 0;
+
+	HistoryCount = 0;
+	Newest = HistoryFrames - 1;
+	Frame = 0;
+	FrameStart = 0;
+	Dropped = 0;
+	Capturing = false;
+}
+
+FrameProfiler::State::~State()
+{
+	for (size_t i = 0; i < Rings.size(); i++)
+		delete Rings[i];
+}
+
+FrameProfiler::State& FrameProfiler::GetState()
+{
+	static State state;
+	return state;
+}
+
+// --------------------------------------------------------
+// Gets the calling thread's ring the first time it records,
+// reusing the ring of a thread that has exited if there is
+// one.  A reused ring keeps its place in the trace.
+// --------------------------------------------------------
+FrameProfiler::Ring& FrameProfiler::GetRing()
+{
+	thread_local RingOwner owner;
+	if (owner.Owned)
+		return *owner.Owned;
+
+	State& state = GetState();
+	std::lock_guard<std::mutex> lock(state.RingMutex);
+	for (size_t i = 0; i < state.Rings.size(); i++)
+	{
+		if (state.Rings[i]->Free)
+		{
+			owner.Owned = state.Rings[i];
+			owner.Owned->Free = false;
+			owner.Owned->Name = 0;
+			return *owner.Owned;
+		}
+	}
+
+	Ring* ring = new Ring();
+	ring->Head = 0;
+	ring->Tail = 0;
+	ring->Dropped = 0;
+	ring->Thread = (int)state.Rings.size();
+	ring->Name = 0;
+	ring->Free = false;
+	state.Rings.push_back(ring);
+
+	owner.Owned = ring;
+	return *ring;
+}
+
+FrameProfiler::RingOwner::~RingOwner()
+{
+	if (!Owned)
+		return;
+
+	State& state = GetState();
+	std::lock_guard<std::mutex> lock(state.RingMutex);
+	Owned->Free = true;
+}
+
+long long FrameProfiler::Now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - profilerStart).count();
+}
+
+// --------------------------------------------------------
+// Adds a scope to the calling thread's ring, or drops it
+// if EndFrame() hasn't emptied the ring in time
+// --------------------------------------------------------
+void FrameProfiler::Record(const char* name, long long start, long long end)
+{
+	Ring& ring = GetRing();
+	unsigned int head = ring.Head.load(std::memory_order_relaxed);
+	if (head - ring.Tail.load(std::memory_order_acquire) >= RingSize)
+	{
+		ring.Dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	Event& event = ring.Events[head % RingSize];
+	event.Name = name;
+	event.Start = start;
+	event.End = end;
+	ring.Head.store(head + 1, std::memory_order_release);
+}
+
+void FrameProfiler::Count(ProfileCounter counter, long long amount)
+{
+	GetState().Counters[(int)counter].fetch_add(amount, std::memory_order_relaxed);
+}
+
+void FrameProfiler::NameThread(const char* name)
+{
+	GetRing().Name = name;
+}
+
+// --------------------------------------------------------
+// Empties every thread's ring and the counters into the
+// next frame of the history
+// --------------------------------------------------------
+void FrameProfiler::EndFrame()
+{
+	State& state = GetState();
+	long long frameEnd = Now();
+
+	std::vector<Ring*> rings;
+	{
+		std::lock_guard<std::mutex> lock(state.RingMutex);
+		rings = state.Rings;
+	}
+
+	state.Newest = (state.Newest + 1) % HistoryFrames;
+	if (state.HistoryCount < HistoryFrames)
+		state.HistoryCount++;
+
+	ProfileFrameStats& frame = state.History[state.Newest];
+	frame.Frame = state.Frame++;
+	frame.Start = state.FrameStart / 1000000.0;
+	frame.Milliseconds = (frameEnd - state.FrameStart) / 1000000.0;
+	frame.Scopes.clear();
+
+	for (size_t r = 0; r < rings.size(); r++)
+	{
+		Ring& ring = *rings[r];
+		unsigned int head = ring.Head.load(std::memory_order_acquire);
+		unsigned int tail = ring.Tail.load(std::memory_order_relaxed);
+
+		for (; tail != head; tail++)
+		{
+			const Event& event = ring.Events[tail % RingSize];
+			double milliseconds = (event.End - event.Start) / 1000000.0;
+
+			// Frames only have a handful of distinct scopes
+			size_t s = 0;
+			while (s < frame.Scopes.size() &&
+				frame.Scopes[s].Name != event.Name &&
+				strcmp(frame.Scopes[s].Name, event.Name) != 0)
+				s++;
+
+			if (s == frame.Scopes.size())
+			{
+				ProfileScopeStats scope = { event.Name, 0, 0.0 };
+				frame.Scopes.push_back(scope);
+			}
+			frame.Scopes[s].Calls++;
+			frame.Scopes[s].Milliseconds += milliseconds;
+
+			if (state.Capturing)
+			{
+				CapturedEvent captured = { event.Name, event.Start, event.End, ring.Thread };
+				state.CapturedEvents.push_back(captured);
+			}
+		}
+
+		// Hands the slots back to the recording thread
+		ring.Tail.store(head, std::memory_order_release);
+		state.Dropped += ring.Dropped.exchange(0, std::memory_order_relaxed);
+	}
+
+	for (int i = 0; i < (int)ProfileCounter::Count; i++)
+		frame.Counters[i] = state.Counters[i].exchange(0, std::memory_order_relaxed);
+
+	if (state.Capturing)
+	{
+		CapturedCounters counters;
+		counters.Time = frameEnd;
+		memcpy(counters.Counters, frame.Counters, sizeof(counters.Counters));
+		state.CapturedFrames.push_back(counters);
+	}
+
+	state.FrameStart = frameEnd;
+}
+
+int FrameProfiler::GetFrameCount()
+{
+	return GetState().HistoryCount;
+}
+
+const ProfileFrameStats& FrameProfiler::GetFrame(int age)
+{
+	State& state = GetState();
+	return state.History[(state.Newest - age + HistoryFrames) % HistoryFrames];
+}
+
+double FrameProfiler::GetAverageFrameMilliseconds()
+{
+	State& state = GetState();
+	if (state.HistoryCount == 0)
+		return 0.0;
+
+	double total = 0.0;
+	for (int i = 0; i < state.HistoryCount; i++)
+		total += GetFrame(i).Milliseconds;
+	return total / state.HistoryCount;
+}
+
+// --------------------------------------------------------
+// Average time spent in a scope per frame, counting frames
+// it didn't run in as zero
+// --------------------------------------------------------
+double FrameProfiler::GetAverageMilliseconds(const char* scope)
+{
+	State& state = GetState();
+	if (state.HistoryCount == 0)
+		return 0.0;
+
+	double total = 0.0;
+	for (int i = 0; i < state.HistoryCount; i++)
+	{
+		const ProfileFrameStats& frame = GetFrame(i);
+		for (size_t s = 0; s < frame.Scopes.size(); s++)
+		{
+			if (strcmp(frame.Scopes[s].Name, scope) == 0)
+				total += frame.Scopes[s].Milliseconds;
+		}
+	}
+	return total / state.HistoryCount;
+}
+
+double FrameProfiler::GetAverageCount(ProfileCounter counter)
+{
+	State& state = GetState();
+	if (state.HistoryCount == 0)
+		return 0.0;
+
+	double total = 0.0;
+	for (int i = 0; i < state.HistoryCount; i++)
+		total += (double)GetFrame(i).Counters[(int)counter];
+	return total / state.HistoryCount;
+}
+
+unsigned long long FrameProfiler::GetDroppedScopes()
+{
+	return GetState().Dropped;
+}
+
+void FrameProfiler::BeginCapture()
+{
+	State& state = GetState();
+	state.CapturedEvents.clear();
+	state.CapturedFrames.clear();
+	state.Capturing = true;
+}
+
+bool FrameProfiler::IsCapturing()
+{
+	return GetState().Capturing;
+}
+
+// --------------------------------------------------------
+// Stops capturing and writes everything captured as a
+// Chrome trace - scopes as complete events on their
+// thread's track, a counter track per counter, and an
+// instant event at each frame marker
+// --------------------------------------------------------
+bool FrameProfiler::EndCapture(const char* file)
+{
+	State& state = GetState();
+	state.Capturing = false;
+
+	std::ofstream out(file);
+	if (!out)
+		return false;
+
+	// Trace times are in microseconds
+	out.setf(std::ios::fixed);
+	out.precision(3);
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"Game\"}}";
+
+	{
+		std::lock_guard<std::mutex> lock(state.RingMutex);
+		for (size_t i = 0; i < state.Rings.size(); i++)
+		{
+			if (!state.Rings[i]->Name)
+				continue;
+			out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << state.Rings[i]->Thread << ",\"args\":{\"name\":";
+			WriteName(out, state.Rings[i]->Name);
+			out << "}}";
+		}
+	}
+
+	for (size_t i = 0; i < state.CapturedEvents.size(); i++)
+	{
+		const CapturedEvent& event = state.CapturedEvents[i];
+		out << ",\n{\"name\":";
+		WriteName(out, event.Name);
+		out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.Thread <<
+			",\"ts\":" << event.Start / 1000.0 <<
+			",\"dur\":" << (event.End - event.Start) / 1000.0 << "}";
+	}
+
+	for (size_t i = 0; i < state.CapturedFrames.size(); i++)
+	{
+		const CapturedCounters& frame = state.CapturedFrames[i];
+		out << ",\n{\"name\":\"Frame\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":0,\"ts\":" << frame.Time / 1000.0 << "}";
+
+		for (int c = 0; c < (int)ProfileCounter::Count; c++)
+		{
+			out << ",\n{\"name\":\"" << GetCounterName((ProfileCounter)c) << "\",\"ph\":\"C\",\"pid\":1,\"ts\":" << frame.Time / 1000.0 <<
+				",\"args\":{\"value\":" << frame.Counters[c] << "}}";
+		}
+	}
+
+	out << "\n]}\n";
+
+	state.CapturedEvents.clear();
+	state.CapturedFrames.clear();
+	return out.good();
+}
+
+const char* FrameProfiler::GetCounterName(ProfileCounter counter)
+{
+	switch (counter)
+	{
+	case ProfileCounter::DrawCalls: return "Draw calls";
+	case ProfileCounter::StateChanges: return "State changes";
+	case ProfileCounter::ConstantBufferBytes: return "Constant buffer bytes";
+	case ProfileCounter::Indices: return "Indices";
+	default: return "Unknown";
+	}
+}
+
+#endif
@@ -0,0 +1,222 @@
+#pragma once
+
+// --------------------------------------------------------
+// Set to 0 to compile the profiler out entirely - every
+// PROFILE_ macro then expands to nothing
+// --------------------------------------------------------
+#ifndef PROFILING_ENABLED
+#define PROFILING_ENABLED 1
+#endif
+
+#if PROFILING_ENABLED
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+// Things counted over each frame
+enum class ProfileCounter
+{
+	DrawCalls,
+	StateChanges,			// Shaders, materials and meshes bound
+	ConstantBufferBytes,	// Uploaded to the GPU
+	Indices,				// Drawn, times instances
+	Count
+};
+
+// How long a scope took, in total, over one frame
+struct ProfileScopeStats
+{
+	const char* Name;
+	int Calls;
+	double Milliseconds;
+};
+
+// --------------------------------------------------------
+// One finished frame.  Scopes are counted in the frame
+// they end in.
+// --------------------------------------------------------
+struct ProfileFrameStats
+{
+	unsigned long long Frame;
+	double Start;			// Milliseconds since the profiler started
+	double Milliseconds;
+	long long Counters[(int)ProfileCounter::Count];
+	std::vector<ProfileScopeStats> Scopes;
+};
+
+// --------------------------------------------------------
+// Times named scopes on any thread, counts events, and
+// keeps the last few seconds of frames to look back over
+//
+// Each thread writes its scopes into its own fixed size
+// ring buffer, with nothing but an atomic store to publish
+// them, so recording never waits on another thread.  A
+// full ring drops scopes rather than block.  When a thread
+// exits, its ring goes to the next new thread, so there are
+// never more rings than threads alive at once.  Counters
+// are atomic adds.
+//
+// EndFrame() is the frame marker.  It is called from one
+// thread, and empties every ring into that frame's stats.
+// While a capture is running, everything is also kept for
+// a Chrome trace (chrome://tracing or ui.perfetto.dev).
+//
+// Scope names must outlive the profiler - use literals.
+// --------------------------------------------------------
+class FrameProfiler
+{
+public:
+	// Frames kept for GetFrame() and the averages
+	static const int HistoryFrames = 120;
+
+	// Scopes each thread can hold between frames
+	static const unsigned int RingSize = 16384;
+
+	// Nanoseconds since the profiler started
+	static long long Now();
+
+	static void Record(const char* name, long long start, long long end);
+	static void Count(ProfileCounter counter, long long amount);
+
+	// Names the calling thread in traces
+	static void NameThread(const char* name);
+
+	// Ends the current frame
+	static void EndFrame();
+
+	// Frames in the history, and one of them - 0 is the newest
+	static int GetFrameCount();
+	static const ProfileFrameStats& GetFrame(int age);
+
+	// Per frame averages over the history
+	static double GetAverageFrameMilliseconds();
+	static double GetAverageMilliseconds(const char* scope);
+	static double GetAverageCount(ProfileCounter counter);
+
+	// Scopes lost to full rings since the profiler started
+	static unsigned long long GetDroppedScopes();
+
+	// Records every frame until the capture ends, then writes
+	// them out as Chrome trace JSON
+	static void BeginCapture();
+	static bool EndCapture(const char* file);
+	static bool IsCapturing();
+
+	static const char* GetCounterName(ProfileCounter counter);
+
+private:
+	struct Event
+	{
+		const char* Name;
+		long long Start;
+		long long End;
+	};
+
+	// --------------------------------------------------------
+	// One thread's scopes.  Only that thread moves Head, and
+	// only EndFrame() moves Tail.  A free ring's thread has
+	// exited, and any scopes left in it are still emptied.
+	// --------------------------------------------------------
+	struct Ring
+	{
+		Event Events[RingSize];
+		std::atomic<unsigned int> Head;
+		std::atomic<unsigned int> Tail;
+		std::atomic<unsigned int> Dropped;
+		int Thread;
+		const char* Name;
+		bool Free;				// Guarded by the ring mutex
+	};
+
+	// Frees the calling thread's ring as the thread exits
+	struct RingOwner
+	{
+		Ring* Owned;
+
+		RingOwner() : Owned(0) {}
+		~RingOwner();
+	};
+
+	struct CapturedEvent
+	{
+		const char* Name;
+		long long Start;
+		long long End;
+		int Thread;
+	};
+
+	struct CapturedCounters
+	{
+		long long Time;
+		long long Counters[(int)ProfileCounter::Count];
+	};
+
+	// Everything EndFrame() and the stats use
+	struct State
+	{
+		std::mutex RingMutex;
+		std::vector<Ring*> Rings;
+
+		std::atomic<long long> Counters[(int)ProfileCounter::Count];
+
+		ProfileFrameStats History[HistoryFrames];
+		int HistoryCount;
+		int Newest;
+		unsigned long long Frame;
+		long long FrameStart;
+		unsigned long long Dropped;
+
+		bool Capturing;
+		std::vector<CapturedEvent> CapturedEvents;
+		std::vector<CapturedCounters> CapturedFrames;
+
+		State();
+		~State();
+	};
+
+	static State& GetState();
+	static Ring& GetRing();
+};
+
+// --------------------------------------------------------
+// Times itself from construction to destruction
+// --------------------------------------------------------
+class ProfileScope
+{
+public:
+	ProfileScope(const char* name)
+	{
+		this->name = name;
+		start = FrameProfiler::Now();
+	}
+
+	~ProfileScope()
+	{
+		FrameProfiler::Record(name, start, FrameProfiler::Now());
+	}
+
+private:
+	const char* name;
+	long long start;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+// Times the rest of the enclosing block
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+
+// Adds to one of the frame's counters
+#define PROFILE_COUNT(counter, amount) FrameProfiler::Count(ProfileCounter::counter, (long long)(amount))
+
+// Marks the end of a frame
+#define PROFILE_FRAME() FrameProfiler::EndFrame()
+
+#else
+
+#define PROFILE_SCOPE(name)
+#define PROFILE_COUNT(counter, amount)
+#define PROFILE_FRAME()
+
+#endif
@@ -1,7 +1,11 @@
 #include "Game.h"
 #include "Vertex.h"
-#include "WICTextureLoader.h"
 #include "DDSTextureLoader.h"
+#include "ImageDecoder.h"
+#include "IrradianceBaker.h"
+#include "SpecularBaker.h"
+#include <DirectXPackedVector.h>
+#include <memory>
 
 // For the DirectX Math library
 using namespace DirectX;
@@ -24,9 +28,22 @@ Game::Game(HINSTANCE hInstance)
 	skyBoxPixelShader = 0;
 	pbrVertexShader = 0;
 	pbrPixelShader = 0;
-	convolutionPixelShader = 0;
 	pbrMaterialVertexShader = 0;
+	pbrMaterialInstancedVertexShader = 0;
 	pbrMaterialPixelShader = 0;
+	assetCache = 0;
+	sphereMesh = 0;
+	skyMesh = 0;
+	ironrustMat = 0;
+	ironrustAlbedoMapSRV = 0;
+	ironrustNormalMapSRV = 0;
+	ironrustMetallicMapSRV = 0;
+	ironrustRoughnessMapSRV = 0;
+	skyTextureSRV = 0;
+	skyIrradianceMapSRV = 0;
+#if PROFILING_ENABLED
+	captureKeyDown = false;
+#endif
 
 	
 
@@ -41,10 +58,7 @@ Game::Game(HINSTANCE hInstance)
 Game::~Game()
 {
 
-	if (vertexBuffer) 
-		vertexBuffer->Release();
-	if (indexBuffer)
-		indexBuffer->Release();
+	// Buffers belong to the meshes, which release them
 
 	delete camera;
 
@@ -55,12 +69,14 @@ Game::~Game()
 	delete skyBoxPixelShader;
 	delete pbrVertexShader;
 	delete pbrPixelShader;
-	delete convolutionPixelShader;
 	delete pbrMaterialVertexShader;
+	delete pbrMaterialInstancedVertexShader;
 	delete pbrMaterialPixelShader;
 
 	delete sphereMesh;
 	delete skyMesh;
+	delete geometryBackend;
+	delete assetCache;
 
 	delete ironrustMat;
 	
@@ -74,81 +90,113 @@ Game::~Game()
 	
 
 	sampler->Release();
-	ironrustAlbedoMapSRV->Release();
-	ironrustNormalMapSRV->Release();
-	ironrustMetallicMapSRV->Release();
-	ironrustRoughnessMapSRV->Release();
+	clampSampler->Release();
+	if (ironrustAlbedoMapSRV) ironrustAlbedoMapSRV->Release();
+	if (ironrustNormalMapSRV) ironrustNormalMapSRV->Release();
+	if (ironrustMetallicMapSRV) ironrustMetallicMapSRV->Release();
+	if (ironrustRoughnessMapSRV) ironrustRoughnessMapSRV->Release();
 	
-	skyTextureSRV->Release();
-	skyIrradianceMapSRV->Release();
+	if (skyTextureSRV) skyTextureSRV->Release();
+	if (skyIrradianceMapSRV) skyIrradianceMapSRV->Release();
 	skyRasterizerState->Release();
 	skyDepthState->Release();
 
 
 	skyIBLTexture->Release();
-	for (int i = 0; i < 6; i++)
-	{
-		skyIBLRTV[i]->Release();
-	}
 	skyIBLSRV->Release();
+	skyPrefilterSRV->Release();
+	brdfLUTSRV->Release();
 
 
 }
 
 void Game::Init()
 {
+#if PROFILING_ENABLED
+	FrameProfiler::NameThread("Main thread");
+#endif
+
+#if defined(DEBUG) || defined(_DEBUG)
+	// Time startup, to see what a warm cache saves
+	__int64 perfFreq, startTime, endTime;
+	QueryPerformanceFrequency((LARGE_INTEGER*)&perfFreq);
+	QueryPerformanceCounter((LARGE_INTEGER*)&startTime);
+#endif
+
+	assetCache = new AssetCache("Cache");
+
+	// Files are read, parsed and decoded as jobs on every thread,
+	// and Finish() creates what needs the context as each is ready
+	{
+		AssetLoader loader(jobs);
+		AssetHandle textures[4];
+
+		LoadShaders(loader);
+		LoadSkyBox(loader);
+		LoadMesh(loader);
+		LoadTextures(loader, textures);
+		CreateMaterials(loader, textures);
+		loader.Finish();
+
+#if defined(DEBUG) || defined(_DEBUG)
+		loader.PrintTimings();
+#endif
+	}
+
+	// Anything that failed to load is left empty, as before
+	if (!sphereMesh) sphereMesh = new Mesh(MeshData(), geometryBackend);
+	if (!skyMesh) skyMesh = new Mesh(MeshData(), geometryBackend);
+	if (!ironrustMat) ironrustMat = new Material(ironrustAlbedoMapSRV, ironrustNormalMapSRV, ironrustMetallicMapSRV, ironrustRoughnessMapSRV, sampler);
 
-	LoadShaders();
 	CreateMatrices();
-	LoadSkyBox();
-	LoadMesh();
-	LoadTextures();
-	CreateMaterials();	
 	CreateBasicGeometry();
 
 	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
 	SetUpImageBasedLighting();
+
+#if defined(DEBUG) || defined(_DEBUG)
+	QueryPerformanceCounter((LARGE_INTEGER*)&endTime);
+	AssetCacheStats stats = assetCache->GetStats();
+	printf("\nInit took %.1f ms - asset cache: %u hits, %u misses, %u stored",
+		(endTime - startTime) * 1000.0 / perfFreq, stats.Hits, stats.Misses, stats.Stores);
+#endif
 }
 
 
-void Game::LoadShaders()
+// --------------------------------------------------------
+// Shader creation only needs the device, which is free
+// threaded, so each shader loads entirely on a worker
+// --------------------------------------------------------
+void Game::LoadShaders(AssetLoader& loader)
 {
 	vertexShader = new SimpleVertexShader(device, context);
-	if (!vertexShader->LoadShaderFile(L"Debug/VertexShader.cso"))
-		vertexShader->LoadShaderFile(L"VertexShader.cso");		
+	LoadShader(loader, vertexShader, "VertexShader.cso");
 
 	pixelShader = new SimplePixelShader(device, context);
-	if(!pixelShader->LoadShaderFile(L"Debug/PixelShader.cso"))	
-		pixelShader->LoadShaderFile(L"PixelShader.cso");
+	LoadShader(loader, pixelShader, "PixelShader.cso");
 
 	skyBoxVertexShader = new SimpleVertexShader(device, context);
-	if (!skyBoxVertexShader->LoadShaderFile(L"Debug/SkyBoxVertexShader.cso"))
-		skyBoxVertexShader->LoadShaderFile(L"SkyBoxVertexShader.cso");
+	LoadShader(loader, skyBoxVertexShader, "SkyBoxVertexShader.cso");
 
 	skyBoxPixelShader = new SimplePixelShader(device, context);
-	if (!skyBoxPixelShader->LoadShaderFile(L"Debug/SkyBoxPixelShader.cso"))
-		skyBoxPixelShader->LoadShaderFile(L"SkyBoxPixelShader.cso");
+	LoadShader(loader, skyBoxPixelShader, "SkyBoxPixelShader.cso");
 
 	pbrVertexShader = new SimpleVertexShader(device, context);
-	if (!pbrVertexShader->LoadShaderFile(L"Debug/PBRVertexShader.cso"))
-		pbrVertexShader->LoadShaderFile(L"PBRVertexShader.cso");
+	LoadShader(loader, pbrVertexShader, "PBRVertexShader.cso");
 
 	pbrPixelShader = new SimplePixelShader(device, context);
-	if (!pbrPixelShader->LoadShaderFile(L"Debug/PBRPixelShader.cso"))
-		pbrPixelShader->LoadShaderFile(L"PBRPixelShader.cso");
+	LoadShader(loader, pbrPixelShader, "PBRPixelShader.cso");
 
-	convolutionPixelShader = new SimplePixelShader(device, context);
-	if (!convolutionPixelShader->LoadShaderFile(L"Debug/ConvolutionPixelShader.cso"))
-		convolutionPixelShader->LoadShaderFile(L"ConvolutionPixelShader.cso");
 
 	pbrMaterialVertexShader = new SimpleVertexShader(device, context);
-	if (!pbrMaterialVertexShader->LoadShaderFile(L"Debug/PBRMaterialVertexShader.cso"))
-		pbrMaterialVertexShader->LoadShaderFile(L"PBRMaterialVertexShader.cso");
+	LoadShader(loader, pbrMaterialVertexShader, "PBRMaterialVertexShader.cso");
+
+	pbrMaterialInstancedVertexShader = new SimpleVertexShader(device, context);
+	LoadShader(loader, pbrMaterialInstancedVertexShader, "PBRMaterialInstancedVertexShader.cso");
 
 	pbrMaterialPixelShader = new SimplePixelShader(device, context);
-	if (!pbrMaterialPixelShader->LoadShaderFile(L"Debug/PBRMaterialPixelShader.cso"))
-		pbrMaterialPixelShader->LoadShaderFile(L"PBRMaterialPixelShader.cso");
+	LoadShader(loader, pbrMaterialPixelShader, "PBRMaterialPixelShader.cso");
 
 
 
@@ -158,6 +206,18 @@ void Game::LoadShaders()
 
 
 
+// --------------------------------------------------------
+// Queues one compiled shader, from the Debug folder if it's
+// there and the working directory if not
+// --------------------------------------------------------
+void Game::LoadShader(AssetLoader& loader, ISimpleShader* shader, const char* file)
+{
+	loader.Load(file, [shader, file]() {
+		std::wstring name(file, file + strlen(file));
+		return shader->LoadShaderFile((L"Debug/" + name).c_str()) || shader->LoadShaderFile(name.c_str());
+	}, nullptr);
+}
+
 // --------------------------------------------------------
 // Initializes the matrices necessary to represent our geometry's 
 // transformations and our 3D camera
@@ -171,10 +231,10 @@ void Game::CreateMatrices()
 
 
 }
-void Game::LoadSkyBox()
+void Game::LoadSkyBox(AssetLoader& loader)
 {
-	CreateDDSTextureFromFile(device, L"Debug/Textures/SunnyCubeMap.dds", 0, &skyTextureSRV);
-	CreateDDSTextureFromFile(device, L"Debug/Textures/skybox1IR.dds", 0, &skyIrradianceMapSRV);
+	LoadCubeMap(loader, "Debug/Textures/SunnyCubeMap.dds", &skyTextureSRV);
+	LoadCubeMap(loader, "Debug/Textures/skybox1IR.dds", &skyIrradianceMapSRV);
 
 	//Sky Box Setup
 	D3D11_RASTERIZER_DESC rasterizerDesc = {};
@@ -190,21 +250,87 @@ void Game::LoadSkyBox()
 	device->CreateDepthStencilState(&depthStencilDesc, &skyDepthState);
 }
 
-void Game::LoadMesh()
+// --------------------------------------------------------
+// DDS files are read on a worker and created here - there's
+// nothing to decode
+// --------------------------------------------------------
+void Game::LoadCubeMap(AssetLoader& loader, const char* file, ID3D11ShaderResourceView** srv)
+{
+	std::shared_ptr<MappedFile> data = std::make_shared<MappedFile>();
+	loader.Load(file,
+		[data, file]() { return data->Open(file); },
+		[this, data, srv]() { return SUCCEEDED(CreateDDSTextureFromMemory(device, (const uint8_t*)data->GetData(), data->GetSize(), 0, srv)); });
+}
+
+void Game::LoadMesh(AssetLoader& loader)
+{
+	geometryBackend = new D3D11GeometryBackend(device);
+
+	LoadMesh(loader, "Debug/Models/sphere.obj", &sphereMesh);
+	LoadMesh(loader, "Debug/Models/cube.obj", &skyMesh);
+}
+
+// --------------------------------------------------------
+// Parsing, tangents and the cache all happen on a worker,
+// leaving only buffer creation for this thread
+// --------------------------------------------------------
+void Game::LoadMesh(AssetLoader& loader, const char* file, Mesh** mesh)
+{
+	std::shared_ptr<MeshData> data = std::make_shared<MeshData>();
+	loader.Load(file,
+		[this, data, file]() { return Mesh::LoadObj(file, assetCache, *data, &jobs); },
+		[this, data, mesh]() { *mesh = new Mesh(*data, geometryBackend); return true; });
+}
+
+void Game::LoadTextures(AssetLoader& loader, AssetHandle handles[4])
 {
-	sphereMesh = new Mesh("Debug/Models/sphere.obj", device);
-	skyMesh = new Mesh("Debug/Models/cube.obj", device);
+	handles[0] = LoadTexture(loader, "Debug/Textures/golden_albedo.tif", &ironrustAlbedoMapSRV);
+	handles[1] = LoadTexture(loader, "Debug/Textures/golden_normal.tif", &ironrustNormalMapSRV);
+	handles[2] = LoadTexture(loader, "Debug/Textures/golden_metallic.tif", &ironrustMetallicMapSRV);
+	handles[3] = LoadTexture(loader, "Debug/Textures/golden_roughness.tif", &ironrustRoughnessMapSRV);
 }
 
-void Game::LoadTextures()
+// --------------------------------------------------------
+// Images are decoded on a worker, then uploaded here with
+// a full mip chain generated on the GPU
+// --------------------------------------------------------
+AssetHandle Game::LoadTexture(AssetLoader& loader, const char* file, ID3D11ShaderResourceView** srv)
 {
-	CreateWICTextureFromFile(device, context, L"Debug/Textures/golden_albedo.tif", 0, &ironrustAlbedoMapSRV);
-	CreateWICTextureFromFile(device, context, L"Debug/Textures/golden_normal.tif", 0, &ironrustNormalMapSRV);
-	CreateWICTextureFromFile(device, context, L"Debug/Textures/golden_metallic.tif", 0, &ironrustMetallicMapSRV);
-	CreateWICTextureFromFile(device, context, L"Debug/Textures/golden_roughness.tif", 0, &ironrustRoughnessMapSRV);
+	std::shared_ptr<DecodedImage> image = std::make_shared<DecodedImage>();
+	return loader.Load(file,
+		[image, file]() {
+			MappedFile data;
+			return data.Open(file) && ImageDecoder::Decode(data.GetData(), data.GetSize(), *image);
+		},
+		[this, image, srv]() {
+			D3D11_TEXTURE2D_DESC desc = {};
+			desc.Width = image->Width;
+			desc.Height = image->Height;
+			desc.MipLevels = 0;
+			desc.ArraySize = 1;
+			desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+			desc.SampleDesc.Count = 1;
+			desc.Usage = D3D11_USAGE_DEFAULT;
+			desc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET;
+			desc.MiscFlags = D3D11_RESOURCE_MISC_GENERATE_MIPS;
+
+			ID3D11Texture2D* texture;
+			if (FAILED(device->CreateTexture2D(&desc, 0, &texture)))
+				return false;
+
+			context->UpdateSubresource(texture, 0, 0, &image->Pixels[0], image->Width * 4, 0);
+			HRESULT hr = device->CreateShaderResourceView(texture, 0, srv);
+			if (SUCCEEDED(hr))
+				context->GenerateMips(*srv);
+			texture->Release();
+
+			// The pixels aren't needed once they're on the GPU
+			image->Pixels = std::vector<unsigned char>();
+			return SUCCEEDED(hr);
+		});
 }
 
-void Game::CreateMaterials()
+void Game::CreateMaterials(AssetLoader& loader, const AssetHandle textures[4])
 {
 	D3D11_SAMPLER_DESC samplerDesc = {};
 	samplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_WRAP;
@@ -216,8 +342,17 @@ void Game::CreateMaterials()
 
 	device->CreateSamplerState(&samplerDesc, &sampler);
 
+	//The BRDF table mustn't wrap at its edges
+	samplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
+	samplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;
+	samplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
+	device->CreateSamplerState(&samplerDesc, &clampSampler);
 
-	ironrustMat = new Material(ironrustAlbedoMapSRV, ironrustNormalMapSRV, ironrustMetallicMapSRV, ironrustRoughnessMapSRV, sampler);
+	//Waits for its textures
+	loader.Load("ironrust material", nullptr, [this]() {
+		ironrustMat = new Material(ironrustAlbedoMapSRV, ironrustNormalMapSRV, ironrustMetallicMapSRV, ironrustRoughnessMapSRV, sampler);
+		return true;
+	}, { textures[0], textures[1], textures[2], textures[3] });
 
 }
 
@@ -227,14 +362,15 @@ void Game::CreateMaterials()
 // --------------------------------------------------------
 void Game::CreateBasicGeometry()
 {
-	sky = new GameEntity(skyMesh);
+	sky = new GameEntity(skyMesh, &transforms);
 	sky->SetScale(1.0f, 1.0f, 1.0f);
 	sky->SetPosition(0.0f, 0.0f, 0.0f);
 
 	for (size_t row = 0; row < numrows; ++row)
 		for (size_t col = 0; col < numcolumns; ++col)
 		{
-			spheres[row][col] = new GameEntity(sphereMesh, ironrustMat);			
+			spheres[row][col] = new GameEntity(sphereMesh, ironrustMat, &transforms);			
+			culling.Add(sphereMesh->GetBoundingBox(), spheres[row][col]->GetTransform());
 		}
 
 	float x = -4.0f;
@@ -255,55 +391,250 @@ void Game::CreateBasicGeometry()
 		y -= spacing;
 	}
 
+	//The four corner lights.  Their range reaches far enough past
+	//the spheres that the falloff at the edge of it doesn't show.
+	XMFLOAT3 lightPositions[] = { XMFLOAT3(10.0f, 10.0f, -10.0f), XMFLOAT3(10.0f, -10.0f, -10.0f), XMFLOAT3(-10.0f, 10.0f, -10.0f), XMFLOAT3(-10.0f, -10.0f, -10.0f) };
+	for (int i = 0; i < 4; i++)
+	{
+		Light light = {};
+		light.Type = LightType::Point;
+		light.Position = lightPositions[i];
+		light.Color = XMFLOAT3(300.0f, 300.0f, 300.0f);
+		light.Range = 1000.0f;
+		lights.Add(light);
+	}
+
 
 	
 }
 
-void Game::SetUpImageBasedLighting()
+// --------------------------------------------------------
+// Draws the sky into a float cube map and reads it back
+// --------------------------------------------------------
+void Game::CaptureSky(int captureSize, CubeMapData& radiance)
 {
 	XMFLOAT3 position = XMFLOAT3(0, 0, 0);
 	XMFLOAT4X4 viewMatrix;
 	XMFLOAT4X4 projMatrix;
 
-	XMVECTOR tar[] = { XMVectorSet(1,0,0,0), XMVectorSet(-1,0,0,0), XMVectorSet(0,1,0,0), XMVectorSet(0,-1,0,0), XMVectorSet(0,1,0,0), XMVectorSet(0,-1,0,0) };
+	XMVECTOR tar[] = { XMVectorSet(1,0,0,0), XMVectorSet(-1,0,0,0), XMVectorSet(0,1,0,0), XMVectorSet(0,-1,0,0), XMVectorSet(0,0,1,0), XMVectorSet(0,0,-1,0) };
 	XMVECTOR up[] = { XMVectorSet(0,1,0,0), XMVectorSet(0,1,0,0), XMVectorSet(0,0,-1,0), XMVectorSet(0,0,1,0), XMVectorSet(0,1,0,0), XMVectorSet(0,1,0,0) };
 
 	UINT stride = sizeof(Vertex);
 	UINT offset = 0;
 
-	const float color[4] = { 0.6f, 0.6f, 0.6f, 0.0f };
+	const float color[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+
+	//Capture texture, plus a staging copy the CPU can read
+	D3D11_TEXTURE2D_DESC captureDesc = {};
+	captureDesc.Width = captureSize;
+	captureDesc.Height = captureSize;
+	captureDesc.MipLevels = 1;
+	captureDesc.ArraySize = 6;
+	captureDesc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+	captureDesc.Usage = D3D11_USAGE_DEFAULT;
+	captureDesc.BindFlags = D3D11_BIND_RENDER_TARGET;
+	captureDesc.CPUAccessFlags = 0;
+	captureDesc.MiscFlags = 0;
+	captureDesc.SampleDesc.Count = 1;
+	captureDesc.SampleDesc.Quality = 0;
+
+	ID3D11Texture2D* captureTexture;
+	device->CreateTexture2D(&captureDesc, 0, &captureTexture);
+
+	captureDesc.Usage = D3D11_USAGE_STAGING;
+	captureDesc.BindFlags = 0;
+	captureDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+
+	ID3D11Texture2D* stagingTexture;
+	device->CreateTexture2D(&captureDesc, 0, &stagingTexture);
+
+
+	//Render Target View per face
+	D3D11_RENDER_TARGET_VIEW_DESC captureRTVDesc;
+	ZeroMemory(&captureRTVDesc, sizeof(captureRTVDesc));
+	captureRTVDesc.Format = captureDesc.Format;
+	captureRTVDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2DARRAY;
+	captureRTVDesc.Texture2DArray.ArraySize = 1;
+	captureRTVDesc.Texture2DArray.MipSlice = 0;
+
+	D3D11_VIEWPORT captureViewport;
+	captureViewport.Width = (float)captureSize;
+	captureViewport.Height = (float)captureSize;
+	captureViewport.MinDepth = 0.0f;
+	captureViewport.MaxDepth = 1.0f;
+	captureViewport.TopLeftX = 0.0f;
+	captureViewport.TopLeftY = 0.0f;
+
+	for (int i = 0; i < 6; i++)
+	{
+		ID3D11RenderTargetView* captureRTV;
+		captureRTVDesc.Texture2DArray.FirstArraySlice = i;
+		device->CreateRenderTargetView(captureTexture, &captureRTVDesc, &captureRTV);
+
+		XMVECTOR dir = XMVector3Rotate(tar[i], XMQuaternionIdentity());
+		XMMATRIX view = DirectX::XMMatrixLookToLH(XMLoadFloat3(&position), dir, up[i]);
+		XMStoreFloat4x4(&viewMatrix, DirectX::XMMatrixTranspose(view));
+
+		XMMATRIX P = DirectX::XMMatrixPerspectiveFovLH(0.5f * XM_PI, 1.0f, 0.1f, 100.0f);
+		XMStoreFloat4x4(&projMatrix, DirectX::XMMatrixTranspose(P));
+
+		context->OMSetRenderTargets(1, &captureRTV, 0);
+		context->RSSetViewports(1, &captureViewport);
+		context->ClearRenderTargetView(captureRTV, color);
+
+		vertexBuffer = D3D11GeometryBackend::GetBuffer(skyMesh->GetVertexBuffer());
+		indexBuffer = D3D11GeometryBackend::GetBuffer(skyMesh->GetIndexBuffer());
+
+		skyBoxVertexShader->SetMatrix4x4("view", viewMatrix);
+		skyBoxVertexShader->SetMatrix4x4("projection", projMatrix);
+
+		skyBoxVertexShader->CopyAllBufferData();
+		skyBoxVertexShader->SetShader();
+
+		skyBoxPixelShader->SetShaderResourceView("Sky", skyTextureSRV);
+		skyBoxPixelShader->SetSamplerState("basicSampler", sampler);
+
+		skyBoxPixelShader->CopyAllBufferData();
+		skyBoxPixelShader->SetShader();
+
+		context->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
+		context->IASetIndexBuffer(indexBuffer, D3D11GeometryBackend::GetFormat(skyMesh->GetIndexFormat()), 0);
+
+		context->RSSetState(skyRasterizerState);
+		context->OMSetDepthStencilState(skyDepthState, 0);
+
+		context->DrawIndexed(skyMesh->GetIndexCount(), 0, 0);
+
+		//Reset the render states we've changed
+		context->RSSetState(0);
+		context->OMSetDepthStencilState(0, 0);
+
+		captureRTV->Release();
+	}
+	context->OMSetRenderTargets(0, 0, 0);
+
+
+	//Read the faces back
+	context->CopyResource(stagingTexture, captureTexture);
 
+	radiance.Resize(captureSize);
+	for (int i = 0; i < 6; i++)
+	{
+		D3D11_MAPPED_SUBRESOURCE mapped;
+		UINT subresource = D3D11CalcSubresource(0, i, 1);
+		if (FAILED(context->Map(stagingTexture, subresource, D3D11_MAP_READ, 0, &mapped)))
+			continue;
+
+		for (int y = 0; y < captureSize; y++)
+		{
+			const XMFLOAT4* row = (const XMFLOAT4*)((const unsigned char*)mapped.pData + y * mapped.RowPitch);
+			for (int x = 0; x < captureSize; x++)
+				radiance.Faces[i][y * captureSize + x] = XMFLOAT3(row[x].x, row[x].y, row[x].z);
+		}
+		context->Unmap(stagingTexture, subresource);
+	}
+
+	captureTexture->Release();
+	stagingTexture->Release();
+}
+
+// --------------------------------------------------------
+// Bakes the sky's image based lighting on the CPU - the sky
+// is captured with CaptureSky, then
+// - projected onto spherical harmonics, and the irradiance
+//   cube map is rebuilt from those
+// - prefiltered with GGX into a mip per roughness step,
+//   alongside the BRDF table for the split sum
+// Both bakes go through the asset cache as ready to upload
+// half floats, keyed on the sky file and the bake settings,
+// so a warm start skips the capture and the bakes entirely.
+// --------------------------------------------------------
+void Game::SetUpImageBasedLighting()
+{
+	const int captureSize = 128;
+	const int irradianceSize = 32;
+	const int prefilterMips = 6;
+	const int prefilterSamples = 512;
+	const int brdfSize = 256;
+	const int brdfSamples = 512;
+
+	// Bump these whenever the capture or bakes change
+	const int skyLightingVersion = 1;
+	const int brdfVersion = 1;
+
+	const int skySettings[] = { skyLightingVersion, captureSize, irradianceSize, prefilterMips, prefilterSamples };
+	const int brdfSettings[] = { brdfVersion, brdfSize, brdfSamples };
+
+
+	//Sky lighting - irradiance faces, then the prefiltered
+	//cube in subresource order (face by face, mips in order)
+	size_t irradianceTexels = 6 * irradianceSize * irradianceSize;
+	size_t skyTexelCount = irradianceTexels;
+	for (int m = 0; m < prefilterMips; m++)
+		skyTexelCount += 6 * (captureSize >> m) * (captureSize >> m);
+
+	unsigned long long skyKey = 0;
+	AssetCache::HashFile("Debug/Textures/SunnyCubeMap.dds", skyKey);
+	skyKey = AssetCache::Hash(skySettings, sizeof(skySettings), skyKey);
+
+	AssetBlob skyBlob;
+	std::vector<PackedVector::XMHALF4> bakedSky;
+	const PackedVector::XMHALF4* skyTexels;
+	if (assetCache->Load("sky_lighting", skyKey, skyBlob) && skyBlob.GetSize() == skyTexelCount * sizeof(PackedVector::XMHALF4))
+	{
+		skyTexels = (const PackedVector::XMHALF4*)skyBlob.GetData();
+	}
+	else
+	{
+		CubeMapData radiance;
+		CaptureSky(captureSize, radiance);
+
+		SHCoefficients sh;
+		CubeMapData irradiance;
+		IrradianceBaker::Bake(radiance, irradianceSize, sh, irradiance, &jobs);
+
+		std::vector<CubeMapData> prefiltered;
+		SpecularBaker::Prefilter(radiance, prefilterMips, prefilterSamples, prefiltered, &jobs);
+
+		bakedSky.reserve(skyTexelCount);
+		for (int i = 0; i < 6; i++)
+			for (size_t t = 0; t < irradiance.Faces[i].size(); t++)
+				bakedSky.push_back(PackedVector::XMHALF4(irradiance.Faces[i][t].x, irradiance.Faces[i][t].y, irradiance.Faces[i][t].z, 1.0f));
+		for (int i = 0; i < 6; i++)
+			for (int m = 0; m < prefilterMips; m++)
+				for (size_t t = 0; t < prefiltered[m].Faces[i].size(); t++)
+					bakedSky.push_back(PackedVector::XMHALF4(prefiltered[m].Faces[i][t].x, prefiltered[m].Faces[i][t].y, prefiltered[m].Faces[i][t].z, 1.0f));
+
+		assetCache->Store("sky_lighting", skyKey, &bakedSky[0], bakedSky.size() * sizeof(PackedVector::XMHALF4));
+		skyTexels = &bakedSky[0];
+	}
+
+
+	//Irradiance texture
+	D3D11_SUBRESOURCE_DATA faceData[6];
+	for (int i = 0; i < 6; i++)
+	{
+		faceData[i].pSysMem = skyTexels + i * irradianceSize * irradianceSize;
+		faceData[i].SysMemPitch = irradianceSize * sizeof(PackedVector::XMHALF4);
+		faceData[i].SysMemSlicePitch = 0;
+	}
 
-	//Texture
 	D3D11_TEXTURE2D_DESC skyIBLDesc = {};
-	skyIBLDesc.Width = 64;
-	skyIBLDesc.Height = 64;
+	skyIBLDesc.Width = irradianceSize;
+	skyIBLDesc.Height = irradianceSize;
 	skyIBLDesc.MipLevels = 1;
 	skyIBLDesc.ArraySize = 6;
 	skyIBLDesc.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
-	skyIBLDesc.Usage = D3D11_USAGE_DEFAULT;
-	skyIBLDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+	skyIBLDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	skyIBLDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
 	skyIBLDesc.CPUAccessFlags = 0;
-	skyIBLDesc.MiscFlags = D3D11_RESOURCE_MISC_TEXTURECUBE | D3D11_RESOURCE_MISC_GENERATE_MIPS;
+	skyIBLDesc.MiscFlags = D3D11_RESOURCE_MISC_TEXTURECUBE;
 	skyIBLDesc.SampleDesc.Count = 1;
 	skyIBLDesc.SampleDesc.Quality = 0;
 
-	device->CreateTexture2D(&skyIBLDesc, 0, &skyIBLTexture);
-
-
-	//Render Target View
-	D3D11_RENDER_TARGET_VIEW_DESC skyIBLRTVDesc;
-	ZeroMemory(&skyIBLRTVDesc, sizeof(skyIBLRTVDesc));
-	skyIBLRTVDesc.Format = skyIBLDesc.Format;
-	skyIBLRTVDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2DARRAY;
-	skyIBLRTVDesc.Texture2DArray.ArraySize = 1;
-	skyIBLRTVDesc.Texture2DArray.MipSlice = 0;
-	
-	for (int i = 0; i < 6; i++)
-	{
-		skyIBLRTVDesc.Texture2DArray.FirstArraySlice = i;
-		device->CreateRenderTargetView(skyIBLTexture, &skyIBLRTVDesc, &skyIBLRTV[i]);
-	}
+	device->CreateTexture2D(&skyIBLDesc, faceData, &skyIBLTexture);
 
 
 	//Shader Resource Viee
@@ -316,56 +647,83 @@ void Game::SetUpImageBasedLighting()
 
 	device->CreateShaderResourceView(skyIBLTexture, &skyIBLSRVDesc, &skyIBLSRV);
 
-	D3D11_VIEWPORT skyIBLViewport;
-	skyIBLViewport.Width = 64;
-	skyIBLViewport.Height = 64;
-	skyIBLViewport.MinDepth = 0.0f;
-	skyIBLViewport.MaxDepth = 1.0f;
-	skyIBLViewport.TopLeftX = 0.0f;
-	skyIBLViewport.TopLeftY = 0.0f;
-
-
 
+	//Prefiltered cube map, one subresource per face and mip
+	std::vector<D3D11_SUBRESOURCE_DATA> prefilterData(6 * prefilterMips);
+	const PackedVector::XMHALF4* next = skyTexels + irradianceTexels;
 	for (int i = 0; i < 6; i++)
 	{
-		XMVECTOR dir = XMVector3Rotate(tar[i], XMQuaternionIdentity());
-		XMMATRIX view = DirectX::XMMatrixLookToLH(XMLoadFloat3(&position), dir, up[i]);
-		XMStoreFloat4x4(&viewMatrix, DirectX::XMMatrixTranspose(view));
-
-		XMMATRIX P = DirectX::XMMatrixPerspectiveFovLH(0.5f * XM_PI, 1.0f, 0.1f, 100.0f);
-		XMStoreFloat4x4(&projMatrix, DirectX::XMMatrixTranspose(P));
+		for (int m = 0; m < prefilterMips; m++)
+		{
+			int mipSize = captureSize >> m;
 
-		context->OMSetRenderTargets(1, &skyIBLRTV[i], 0);
-		context->RSSetViewports(1, &skyIBLViewport);
-		context->ClearRenderTargetView(skyIBLRTV[i], color);
+			D3D11_SUBRESOURCE_DATA& data = prefilterData[D3D11CalcSubresource(m, i, prefilterMips)];
+			data.pSysMem = next;
+			data.SysMemPitch = mipSize * sizeof(PackedVector::XMHALF4);
+			data.SysMemSlicePitch = 0;
+			next += mipSize * mipSize;
+		}
+	}
 
-		vertexBuffer = skyMesh->GetVertexBuffer();
-		indexBuffer = skyMesh->GetIndexBuffer();
+	D3D11_TEXTURE2D_DESC prefilterDesc = skyIBLDesc;
+	prefilterDesc.Width = captureSize;
+	prefilterDesc.Height = captureSize;
+	prefilterDesc.MipLevels = prefilterMips;
 
-		skyBoxVertexShader->SetMatrix4x4("view", viewMatrix);
-		skyBoxVertexShader->SetMatrix4x4("projection", projMatrix);
+	ID3D11Texture2D* prefilterTexture;
+	device->CreateTexture2D(&prefilterDesc, &prefilterData[0], &prefilterTexture);
 
-		skyBoxVertexShader->CopyAllBufferData();
-		skyBoxVertexShader->SetShader();
+	D3D11_SHADER_RESOURCE_VIEW_DESC prefilterSRVDesc = skyIBLSRVDesc;
+	prefilterSRVDesc.TextureCube.MipLevels = prefilterMips;
+	device->CreateShaderResourceView(prefilterTexture, &prefilterSRVDesc, &skyPrefilterSRV);
+	prefilterTexture->Release();
 
-		convolutionPixelShader->SetShaderResourceView("Sky", skyTextureSRV);
-		convolutionPixelShader->SetSamplerState("basicSampler", sampler);
+	skyPrefilterMaxLod = (float)(prefilterMips - 1);
 
-		convolutionPixelShader->CopyAllBufferData();
-		convolutionPixelShader->SetShader();
 
-		context->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
-		context->IASetIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+	//BRDF table, which only depends on its settings
+	unsigned long long brdfKey = AssetCache::Hash(brdfSettings, sizeof(brdfSettings));
 
-		context->RSSetState(skyRasterizerState);
-		context->OMSetDepthStencilState(skyDepthState, 0);
+	AssetBlob brdfBlob;
+	std::vector<PackedVector::XMHALF2> bakedBRDF;
+	const PackedVector::XMHALF2* brdfTexels;
+	if (assetCache->Load("brdf_lut", brdfKey, brdfBlob) && brdfBlob.GetSize() == brdfSize * brdfSize * sizeof(PackedVector::XMHALF2))
+	{
+		brdfTexels = (const PackedVector::XMHALF2*)brdfBlob.GetData();
+	}
+	else
+	{
+		std::vector<XMFLOAT2> brdf;
+		SpecularBaker::IntegrateBRDF(brdfSize, brdfSamples, brdf, &jobs);
 
-		context->DrawIndexed(skyMesh->GetIndexCount(), 0, 0);
+		bakedBRDF.resize(brdf.size());
+		for (size_t t = 0; t < brdf.size(); t++)
+			bakedBRDF[t] = PackedVector::XMHALF2(brdf[t].x, brdf[t].y);
 
-		//Reset the render states we've changed
-		context->RSSetState(0);
-		context->OMSetDepthStencilState(0, 0);	
+		assetCache->Store("brdf_lut", brdfKey, &bakedBRDF[0], bakedBRDF.size() * sizeof(PackedVector::XMHALF2));
+		brdfTexels = &bakedBRDF[0];
 	}
+
+	D3D11_SUBRESOURCE_DATA brdfData;
+	brdfData.pSysMem = brdfTexels;
+	brdfData.SysMemPitch = brdfSize * sizeof(PackedVector::XMHALF2);
+	brdfData.SysMemSlicePitch = 0;
+
+	D3D11_TEXTURE2D_DESC brdfDesc = {};
+	brdfDesc.Width = brdfSize;
+	brdfDesc.Height = brdfSize;
+	brdfDesc.MipLevels = 1;
+	brdfDesc.ArraySize = 1;
+	brdfDesc.Format = DXGI_FORMAT_R16G16_FLOAT;
+	brdfDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	brdfDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	brdfDesc.SampleDesc.Count = 1;
+	brdfDesc.SampleDesc.Quality = 0;
+
+	ID3D11Texture2D* brdfTexture;
+	device->CreateTexture2D(&brdfDesc, &brdfData, &brdfTexture);
+	device->CreateShaderResourceView(brdfTexture, 0, &brdfLUTSRV);
+	brdfTexture->Release();
 }
 
 
@@ -391,20 +749,45 @@ void Game::OnResize()
 // --------------------------------------------------------
 void Game::Update(float deltaTime, float totalTime)
 {
+	PROFILE_SCOPE("Game::Update");
+
 	// Quit if the escape key is pressed
 	if (GetAsyncKeyState(VK_ESCAPE))
 		Quit();
 
-	camera->Update(deltaTime);
-
-	for (size_t row = 0; row < numrows; row++)
+	// Poll the keys the camera cares about
+	CameraInput input;
+	input.Forward = (GetAsyncKeyState('W') & 0x8000) != 0;
+	input.Back = (GetAsyncKeyState('S') & 0x8000) != 0;
+	input.Left = (GetAsyncKeyState('A') & 0x8000) != 0;
+	input.Right = (GetAsyncKeyState('D') & 0x8000) != 0;
+	input.Down = (GetAsyncKeyState('X') & 0x8000) != 0;
+	input.Up = (GetAsyncKeyState(' ') & 0x8000) != 0;
+	input.Fast = GetAsyncKeyState(VK_SHIFT) != 0;
+	input.Slow = GetAsyncKeyState(VK_CONTROL) != 0;
+	input.Reset = (GetAsyncKeyState('R') & 0x8000) != 0;
+	camera->Update(deltaTime, input);
+
+#if PROFILING_ENABLED
+	// P starts a trace of every frame, and P again writes it out
+	bool captureKey = (GetAsyncKeyState('P') & 0x8000) != 0;
+	if (captureKey && !captureKeyDown)
 	{
-		for (size_t col = 0; col < numcolumns; col++)
-		{
-			spheres[row][col]->UpdateWorldMatrix();
-
-		}
+		if (!FrameProfiler::IsCapturing())
+			FrameProfiler::BeginCapture();
+		else if (FrameProfiler::EndCapture("FrameTrace.json"))
+			printf("\nWrote FrameTrace.json - open it in chrome://tracing");
 	}
+	captureKeyDown = captureKey;
+#endif
+
+	// Last frame's jobs are all done by now
+	jobs.Reset();
+
+	// Rebuild the world matrices and bounds of anything that moved
+	transforms.Update(&jobs);
+	culling.Update(transforms, &jobs);
+	lights.Update(camera->GetView(), camera->GetProjection(), &jobs);
 		
 }
 
@@ -413,6 +796,8 @@ void Game::Update(float deltaTime, float totalTime)
 // --------------------------------------------------------
 void Game::Draw(float deltaTime, float totalTime)
 {
+	PROFILE_SCOPE("Game::Draw");
+
 	const float color[4] = { 0.1f, 0.1f, 0.1f, 1.0f};
 
 	context->OMSetRenderTargets(1, &backBufferRTV, depthStencilView);
@@ -424,48 +809,59 @@ void Game::Draw(float deltaTime, float totalTime)
 		1.0f,
 		0);
 
-	//UINT stride = sizeof(Vertex);
-	//UINT offset = 0;
-
-	//Direct Lighting without textures
-	/*float r = 0.0f;
-	for (size_t i = 0; i < numrows; i++)
-	{
-		float m = 0.0f;
-		for (size_t j = 0; j < numcolumns; j++)
-		{
-			render.RenderPBR(vertexBuffer, indexBuffer, pbrVertexShader, pbrPixelShader, spheres[i][j], camera, m, r, context);			
-			m += 0.10f;
-		}
-
-		r += 0.10f;
-	}*/
-
-	//IBL with textures
-	float r = 0.0f;
-	for (size_t i = 0; i < numrows; i++)
-	{
-		float m = 0.0f;
-		for (size_t j = 0; j < numcolumns; j++)
+	//IBL with textures - only the spheres the camera can see,
+	//sorted by state and then front to back.  They all share a
+	//mesh and material, so they go out as one instanced draw.
+	//Draws are built across the jobs, and everything that uses
+	//the context runs back on this thread.
+	culling.Cull(camera->GetView(), camera->GetProjection(), visibleSpheres);
+	sphereDraws.resize(visibleSpheres.size());
+	sphereDepths.resize(visibleSpheres.size());
+
+	JobHandle build = jobs.ParallelFor("Build sphere draws", visibleSpheres.size(), 16, [this](size_t first, size_t last) {
+		XMFLOAT3 cameraPos = camera->GetPosition();
+		XMVECTOR cameraPosition = XMLoadFloat3(&cameraPos);
+		for (size_t v = first; v < last; v++)
 		{
-			render.RenderRBRMaterial(vertexBuffer, indexBuffer, pbrMaterialVertexShader, pbrMaterialPixelShader, spheres[i][j], camera, m, r, context, sampler, skyIrradianceMapSRV);
-			m += 0.10f;
+			GameEntity* sphere = spheres[visibleSpheres[v] / numcolumns][visibleSpheres[v] % numcolumns];
+
+			DrawCall& draw = sphereDraws[v];
+			draw.VertexShader = pbrMaterialInstancedVertexShader;
+			draw.PixelShader = pbrMaterialPixelShader;
+			draw.DrawMaterial = sphere->GetMaterial();
+			draw.DrawMesh = sphere->GetMesh();
+			draw.World = sphere->GetWorldMatrix();
+
+			XMFLOAT3 position = sphere->GetPosition();
+			float distance = XMVectorGetX(XMVector3Length(XMLoadFloat3(&position) - cameraPosition));
+			sphereDepths[v] = distance / camera->GetFarClip();
 		}
+	});
 
-		r += 0.10f;
-	}
-	
+	JobHandle sort = jobs.Schedule("Sort draws", [this]() {
+		renderQueue.Clear();
+		for (size_t v = 0; v < sphereDraws.size(); v++)
+			renderQueue.Submit(sphereDraws[v], sphereDepths[v]);
+		renderQueue.Sort();
+	}, { build });
 
+	JobHandle execute = jobs.Schedule("Execute draws", [this]() {
+		render.BeginFrame(camera, context, sampler, skyIrradianceMapSRV, clampSampler, skyPrefilterSRV, brdfLUTSRV, skyPrefilterMaxLod, &lights);
+		renderQueue.Execute(&render);
 
-	
-	/******************************************************************************************** /
-	/*DRAW SKYBOX*/
-	/*******************************************************************************************/
+		/******************************************************************************************** /
+		/*DRAW SKYBOX*/
+		/*******************************************************************************************/
 
-	render.RenderSkyBox(vertexBuffer, indexBuffer, skyBoxVertexShader, skyBoxPixelShader, skyMesh, camera, context, skyTextureSRV, skyRasterizerState, skyDepthState);
+		render.RenderSkyBox(vertexBuffer, indexBuffer, skyBoxVertexShader, skyBoxPixelShader, skyMesh, camera, context, skyTextureSRV, skyRasterizerState, skyDepthState);
+	}, { sort }, JobAffinity::MainThread);
 
+	jobs.Wait(execute);
 
-	swapChain->Present(0, 0);
+	{
+		PROFILE_SCOPE("Present");
+		swapChain->Present(0, 0);
+	}
 }
 
 
@@ -3,10 +3,19 @@
 #include "DXCore.h"
 #include "SimpleShader.h"
 #include "Mesh.h"
+#include "D3D11GeometryBackend.h"
 #include "GameEntity.h"
 #include "Camera.h"
+#include "CullingSystem.h"
+#include "LightSystem.h"
 #include "Material.h"
 #include "Render.h"
+#include "RenderQueue.h"
+#include "AssetCache.h"
+#include "AssetLoader.h"
+#include "JobSystem.h"
+#include "CubeMap.h"
+#include "FrameProfiler.h"
 #include <DirectXMath.h>
 
 
@@ -35,13 +44,18 @@ public:
 private:
 
 	// Initialization helper methods - feel free to customize, combine, etc.
-	void LoadShaders(); 
+	void LoadShaders(AssetLoader& loader);
+	void LoadShader(AssetLoader& loader, ISimpleShader* shader, const char* file);
 	void CreateMatrices();
-	void LoadSkyBox();
-	void LoadMesh();
-	void LoadTextures();
-	void CreateMaterials();
+	void LoadSkyBox(AssetLoader& loader);
+	void LoadCubeMap(AssetLoader& loader, const char* file, ID3D11ShaderResourceView** srv);
+	void LoadMesh(AssetLoader& loader);
+	void LoadMesh(AssetLoader& loader, const char* file, Mesh** mesh);
+	void LoadTextures(AssetLoader& loader, AssetHandle handles[4]);
+	AssetHandle LoadTexture(AssetLoader& loader, const char* file, ID3D11ShaderResourceView** srv);
+	void CreateMaterials(AssetLoader& loader, const AssetHandle textures[4]);
 	void CreateBasicGeometry();	
+	void CaptureSky(int captureSize, CubeMapData& radiance);
 	void SetUpImageBasedLighting();
 
 	ID3D11Buffer* vertexBuffer;
@@ -54,8 +68,8 @@ private:
 	SimplePixelShader* skyBoxPixelShader;
 	SimpleVertexShader* pbrVertexShader;
 	SimplePixelShader* pbrPixelShader;
-	SimplePixelShader* convolutionPixelShader;
 	SimpleVertexShader* pbrMaterialVertexShader;
+	SimpleVertexShader* pbrMaterialInstancedVertexShader;
 	SimplePixelShader* pbrMaterialPixelShader;
 
 	//Skybox Stuff
@@ -67,16 +81,31 @@ private:
 
 	//Iamge Based Lighting Stuff
 	ID3D11Texture2D* skyIBLTexture;
-	ID3D11RenderTargetView* skyIBLRTV[6];
 	ID3D11ShaderResourceView* skyIBLSRV;
+	ID3D11ShaderResourceView* skyPrefilterSRV;
+	ID3D11ShaderResourceView* brdfLUTSRV;
+	float skyPrefilterMaxLod;
+
+	//Baked meshes and lighting from earlier runs
+	AssetCache* assetCache;
+
+	//Spreads each frame's work across the cores
+	JobSystem jobs;
 
 	//Mesh
+	D3D11GeometryBackend* geometryBackend;
 	Mesh* sphereMesh;
 	Mesh* skyMesh;
 
 	//GameEntities
+	TransformSystem transforms;
+	CullingSystem culling;
+	std::vector<unsigned int> visibleSpheres;
 	GameEntity* sky;
 	GameEntity* spheres[8][8];
+
+	//Point and spot lights, binned into clusters each frame
+	LightSystem lights;
 	int numrows = 8;
 	int numcolumns = 8;
 	float spacing = 1.0f;
@@ -93,13 +122,21 @@ private:
 	ID3D11ShaderResourceView* ironrustRoughnessMapSRV;
 
 	ID3D11SamplerState* sampler;
+	ID3D11SamplerState* clampSampler;
 
 	//Materials
 	Material* ironrustMat;
 
 	//Render 
 	Render render;
-
+	RenderQueue renderQueue;
+	std::vector<DrawCall> sphereDraws;
+	std::vector<float> sphereDepths;
+
+#if PROFILING_ENABLED
+	//Whether the capture key was down last frame
+	bool captureKeyDown;
+#endif
 
 	// Keeps track of the old mouse position.  Useful for 
 	// determining how far the mouse moved in a single frame.
@@ -2,43 +2,28 @@
 
 using namespace DirectX;
 
-GameEntity::GameEntity(Mesh* mesh, Material* material)
+GameEntity::GameEntity(Mesh* mesh, Material* material, TransformSystem* transforms, TransformId parent)
 {
 	this->mesh = mesh;
 	_material = material;
 
-	XMStoreFloat4x4(&worldMatrix, XMMatrixIdentity());
-	position = XMFLOAT3(0, 0, 0);
-	rotation = XMFLOAT3(0, 0, 0);
-	scale = XMFLOAT3(1, 1, 1);
+	this->transforms = transforms;
+	transform = transforms->Create(parent);
 }
 
-GameEntity::GameEntity(Mesh* mesh)
+GameEntity::GameEntity(Mesh* mesh, TransformSystem* transforms, TransformId parent)
 {
 	this->mesh = mesh;
+	_material = 0;
 
-	XMStoreFloat4x4(&worldMatrix, XMMatrixIdentity());
-	position = XMFLOAT3(0, 0, 0);
-	rotation = XMFLOAT3(0, 0, 0);
-	scale = XMFLOAT3(1, 1, 1);
+	this->transforms = transforms;
+	transform = transforms->Create(parent);
 }
 
 GameEntity::~GameEntity(void)
 {
 }
 
-void GameEntity::UpdateWorldMatrix()
-{
-	XMMATRIX trans = XMMatrixTranslation(position.x, position.y, position.z);
-	XMMATRIX rotX = XMMatrixRotationX(rotation.x);
-	XMMATRIX rotY = XMMatrixRotationY(rotation.y);
-	XMMATRIX rotZ = XMMatrixRotationZ(rotation.z);
-	XMMATRIX sc = XMMatrixScaling(scale.x, scale.y, scale.z);
-
-	XMMATRIX total = sc * rotZ * rotY * rotX * trans;
-	XMStoreFloat4x4(&worldMatrix, XMMatrixTranspose(total));
-}
-
 Material * GameEntity::GetMaterial()
 {
 	return _material;
@@ -51,5 +36,5 @@ DirectX::XMFLOAT3 GameEntity::GetLightColor()
 
 DirectX::XMFLOAT3 GameEntity::GetPosition()
 {
-	return position;
-}
\ No newline at end of file
+	return transforms->GetPosition(transform);
+}
@@ -1,27 +1,28 @@
 #pragma once
 #include <DirectXMath.h>
 #include "Mesh.h"
-#include "Material.h"
+#include "TransformSystem.h"
+
+class Material;
 
 
 class GameEntity
 {
 public:
-	GameEntity(Mesh* mesh, Material* material);
-	GameEntity(Mesh* mesh);
+	GameEntity(Mesh* mesh, Material* material, TransformSystem* transforms, TransformId parent = NoParent);
+	GameEntity(Mesh* mesh, TransformSystem* transforms, TransformId parent = NoParent);
 	~GameEntity(void);
 
-	void UpdateWorldMatrix();
-
-	void Move(float x, float y, float z) { position.x += x;	position.y += y;	position.z += z; }
-	void Rotate(float x, float y, float z) { rotation.x += x;	rotation.y += y;	rotation.z += z; }
+	void Move(float x, float y, float z) { transforms->Move(transform, x, y, z); }
+	void Rotate(float x, float y, float z) { transforms->Rotate(transform, x, y, z); }
 
-	void SetPosition(float x, float y, float z) { position.x = x;	position.y = y;		position.z = z; }
-	void SetRotation(float x, float y, float z) { rotation.x = x;	rotation.y = y;		rotation.z = z; }
-	void SetScale(float x, float y, float z) { scale.x = x;		scale.y = y;		scale.z = z; }
+	void SetPosition(float x, float y, float z) { transforms->SetPosition(transform, x, y, z); }
+	void SetRotation(float x, float y, float z) { transforms->SetRotation(transform, x, y, z); }
+	void SetScale(float x, float y, float z) { transforms->SetScale(transform, x, y, z); }
 
 	Mesh* GetMesh() { return mesh; }
-	DirectX::XMFLOAT4X4 GetWorldMatrix() { return worldMatrix; }
+	TransformId GetTransform() { return transform; }
+	DirectX::XMFLOAT4X4 GetWorldMatrix() { return transforms->GetWorldMatrix(transform); }
 	Material* GetMaterial();
 
 	DirectX::XMFLOAT3 GetLightColor();
@@ -31,10 +32,8 @@ private:
 	Mesh* mesh;
 	Material* _material;
 	DirectX::XMFLOAT3 _lightColor;
-	DirectX::XMFLOAT4X4 worldMatrix;
-	DirectX::XMFLOAT3 position;
-	DirectX::XMFLOAT3 rotation;
-	DirectX::XMFLOAT3 scale;
+	TransformSystem* transforms;
+	TransformId transform;
 
 };
 
@@ -0,0 +1,32 @@
+#pragma once
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// Opaque handle to a buffer owned by a GeometryBackend
+// --------------------------------------------------------
+struct GeometryBuffer;
+typedef GeometryBuffer* GeometryHandle;
+
+// Width of the indices in an index buffer
+enum class IndexFormat
+{
+	UInt16,
+	UInt32
+};
+
+// --------------------------------------------------------
+// The only thing Mesh needs from a graphics API: somewhere
+// to put finished vertex and index data.
+//
+// Keeping this behind an interface means the CPU side of
+// mesh loading has no Windows or Direct3D dependency.
+// --------------------------------------------------------
+class GeometryBackend
+{
+public:
+	virtual ~GeometryBackend() {}
+
+	virtual GeometryHandle CreateVertexBuffer(const Vertex* verts, int numVerts) = 0;
+	virtual GeometryHandle CreateIndexBuffer(const void* indices, int numIndices, IndexFormat format) = 0;
+	virtual void ReleaseBuffer(GeometryHandle buffer) = 0;
+};
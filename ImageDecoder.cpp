@@ -0,0 +1,59 @@
+#include "ImageDecoder.h"
+#include <Windows.h>
+#include <wincodec.h>
+
+#pragma comment(lib, "windowscodecs.lib")
+
+
+bool ImageDecoder::Decode(const void * data, size_t size, DecodedImage & image)
+{
+	image.Width = 0;
+	image.Height = 0;
+	image.Pixels.clear();
+
+	// Worker threads need COM too - S_FALSE means it was already
+	// set up on this thread, and still needs balancing
+	HRESULT hr = CoInitializeEx(0, COINIT_MULTITHREADED);
+	bool uninitialize = SUCCEEDED(hr);
+
+	IWICImagingFactory* factory = 0;
+	IWICStream* stream = 0;
+	IWICBitmapDecoder* decoder = 0;
+	IWICBitmapFrameDecode* frame = 0;
+	IWICFormatConverter* converter = 0;
+
+	hr = CoCreateInstance(CLSID_WICImagingFactory, 0, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&factory));
+	if (SUCCEEDED(hr)) hr = factory->CreateStream(&stream);
+	if (SUCCEEDED(hr)) hr = stream->InitializeFromMemory((BYTE*)data, (DWORD)size);
+	if (SUCCEEDED(hr)) hr = factory->CreateDecoderFromStream(stream, 0, WICDecodeMetadataCacheOnDemand, &decoder);
+	if (SUCCEEDED(hr)) hr = decoder->GetFrame(0, &frame);
+	if (SUCCEEDED(hr)) hr = factory->CreateFormatConverter(&converter);
+	if (SUCCEEDED(hr)) hr = converter->Initialize(frame, GUID_WICPixelFormat32bppRGBA, WICBitmapDitherTypeNone, 0, 0.0, WICBitmapPaletteTypeCustom);
+
+	UINT width = 0, height = 0;
+	if (SUCCEEDED(hr)) hr = converter->GetSize(&width, &height);
+	if (SUCCEEDED(hr) && (width == 0 || height == 0)) hr = E_FAIL;
+	if (SUCCEEDED(hr))
+	{
+		image.Pixels.resize((size_t)width * height * 4);
+		hr = converter->CopyPixels(0, width * 4, (UINT)image.Pixels.size(), &image.Pixels[0]);
+	}
+	if (SUCCEEDED(hr))
+	{
+		image.Width = (int)width;
+		image.Height = (int)height;
+	}
+	else
+	{
+		image.Pixels.clear();
+	}
+
+	if (converter) converter->Release();
+	if (frame) frame->Release();
+	if (decoder) decoder->Release();
+	if (stream) stream->Release();
+	if (factory) factory->Release();
+	if (uninitialize) CoUninitialize();
+
+	return SUCCEEDED(hr);
+}
\ No newline at end of file
@@ -0,0 +1,27 @@
+#pragma once
+#include <vector>
+
+// --------------------------------------------------------
+// An image decoded to 8-bit RGBA, rows packed top to bottom
+// --------------------------------------------------------
+struct DecodedImage
+{
+	int Width;
+	int Height;
+	std::vector<unsigned char> Pixels;
+};
+
+// --------------------------------------------------------
+// Decodes image files through WIC, entirely on the CPU
+//
+// Unlike the WIC texture loader, nothing here touches the
+// device, so images can be decoded on worker threads and
+// handed to texture creation afterwards.
+// --------------------------------------------------------
+class ImageDecoder
+{
+public:
+	// Decodes a whole file already in memory - returns false
+	// if WIC doesn't recognise it
+	static bool Decode(const void* data, size_t size, DecodedImage& image);
+};
\ No newline at end of file
@@ -0,0 +1,220 @@
+#include "ImageWriter.h"
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace
+{
+	// Deflate's stored blocks hold at most this many bytes
+	const size_t MaxStoredBlock = 65535;
+
+	// --------------------------------------------------------
+	// Little helpers for building files in memory
+	// --------------------------------------------------------
+	void PutBigEndian(std::vector<unsigned char>& out, unsigned int value)
+	{
+		out.push_back((unsigned char)(value >> 24));
+		out.push_back((unsigned char)(value >> 16));
+		out.push_back((unsigned char)(value >> 8));
+		out.push_back((unsigned char)value);
+	}
+
+	void PutLittleEndian(std::vector<unsigned char>& out, unsigned long long value, int bytes)
+	{
+		for (int i = 0; i < bytes; i++)
+			out.push_back((unsigned char)(value >> (i * 8)));
+	}
+
+	void PutString(std::vector<unsigned char>& out, const char* text)
+	{
+		out.insert(out.end(), text, text + strlen(text) + 1);
+	}
+
+	// The CRC of every byte value, built on first use
+	struct CrcTable
+	{
+		unsigned int Entries[256];
+
+		CrcTable()
+		{
+			for (unsigned int i = 0; i < 256; i++)
+			{
+				unsigned int c = i;
+				for (int k = 0; k < 8; k++)
+					c = c & 1 ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+				Entries[i] = c;
+			}
+		}
+	};
+
+	unsigned int Crc32(const unsigned char* data, size_t size, unsigned int crc)
+	{
+		static const CrcTable table;
+
+		crc = ~crc;
+		for (size_t i = 0; i < size; i++)
+			crc = table.Entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+		return ~crc;
+	}
+
+	// --------------------------------------------------------
+	// A PNG chunk - length, type, data, then the CRC of the
+	// type and data
+	// --------------------------------------------------------
+	void PutChunk(std::vector<unsigned char>& out, const char* type, const std::vector<unsigned char>& data)
+	{
+		PutBigEndian(out, (unsigned int)data.size());
+		size_t start = out.size();
+		out.insert(out.end(), type, type + 4);
+		out.insert(out.end(), data.begin(), data.end());
+		PutBigEndian(out, Crc32(&out[start], out.size() - start, 0));
+	}
+
+	// --------------------------------------------------------
+	// EXR attributes are a name, a type name, a size and
+	// then the value
+	// --------------------------------------------------------
+	void PutAttribute(std::vector<unsigned char>& out, const char* name, const char* type, const std::vector<unsigned char>& value)
+	{
+		PutString(out, name);
+		PutString(out, type);
+		PutLittleEndian(out, value.size(), 4);
+		out.insert(out.end(), value.begin(), value.end());
+	}
+
+	bool WriteFile(const char* file, const std::vector<unsigned char>& bytes)
+	{
+		std::ofstream out(file, std::ios::binary);
+		if (!out)
+			return false;
+		out.write((const char*)&bytes[0], bytes.size());
+		return out.good();
+	}
+}
+
+
+// --------------------------------------------------------
+// One IDAT chunk holding a zlib stream of stored blocks.
+// Each row starts with filter type 0, so the rows go in as
+// they are.
+// --------------------------------------------------------
+bool ImageWriter::WritePng(const char * file, int width, int height, const unsigned char * rgba)
+{
+	if (width <= 0 || height <= 0)
+		return false;
+
+	size_t rowSize = (size_t)width * 4;
+	std::vector<unsigned char> raw;
+	raw.reserve((rowSize + 1) * height);
+	for (int y = 0; y < height; y++)
+	{
+		raw.push_back(0);
+		raw.insert(raw.end(), rgba + y * rowSize, rgba + (y + 1) * rowSize);
+	}
+
+	std::vector<unsigned char> zlib;
+	zlib.push_back(0x78);
+	zlib.push_back(0x01);
+	for (size_t offset = 0; offset < raw.size(); offset += MaxStoredBlock)
+	{
+		size_t size = raw.size() - offset < MaxStoredBlock ? raw.size() - offset : MaxStoredBlock;
+		bool last = offset + size == raw.size();
+		zlib.push_back(last ? 1 : 0);
+		PutLittleEndian(zlib, size, 2);
+		PutLittleEndian(zlib, ~size & 0xFFFF, 2);
+		zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + size);
+	}
+
+	// Adler-32 of the uncompressed data
+	unsigned int a = 1, b = 0;
+	for (size_t i = 0; i < raw.size(); i++)
+	{
+		a = (a + raw[i]) % 65521;
+		b = (b + a) % 65521;
+	}
+	PutBigEndian(zlib, (b << 16) | a);
+
+	std::vector<unsigned char> header;
+	PutBigEndian(header, (unsigned int)width);
+	PutBigEndian(header, (unsigned int)height);
+	header.push_back(8);	// Bits per channel
+	header.push_back(6);	// RGBA
+	header.push_back(0);	// Deflate
+	header.push_back(0);	// Adaptive filtering
+	header.push_back(0);	// Not interlaced
+
+	const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	std::vector<unsigned char> png(signature, signature + 8);
+	PutChunk(png, "IHDR", header);
+	PutChunk(png, "IDAT", zlib);
+	PutChunk(png, "IEND", std::vector<unsigned char>());
+	return WriteFile(file, png);
+}
+
+// --------------------------------------------------------
+// Uncompressed scanline EXR, one line per block.  Channels
+// have to be listed, and stored, in name order - B, G, R.
+// --------------------------------------------------------
+bool ImageWriter::WriteExr(const char * file, int width, int height, const float * rgb)
+{
+	if (width <= 0 || height <= 0)
+		return false;
+
+	std::vector<unsigned char> exr;
+	PutLittleEndian(exr, 20000630, 4);	// Magic
+	PutLittleEndian(exr, 2, 4);			// Version 2, single part scanlines
+
+	std::vector<unsigned char> channels;
+	const char* names[3] = { "B", "G", "R" };
+	for (int c = 0; c < 3; c++)
+	{
+		PutString(channels, names[c]);
+		PutLittleEndian(channels, 2, 4);	// FLOAT
+		PutLittleEndian(channels, 0, 4);	// Not perceptually linear, and padding
+		PutLittleEndian(channels, 1, 4);	// No subsampling
+		PutLittleEndian(channels, 1, 4);
+	}
+	channels.push_back(0);
+	PutAttribute(exr, "channels", "chlist", channels);
+
+	PutAttribute(exr, "compression", "compression", std::vector<unsigned char>(1, 0));
+
+	std::vector<unsigned char> window;
+	PutLittleEndian(window, 0, 4);
+	PutLittleEndian(window, 0, 4);
+	PutLittleEndian(window, width - 1, 4);
+	PutLittleEndian(window, height - 1, 4);
+	PutAttribute(exr, "dataWindow", "box2i", window);
+	PutAttribute(exr, "displayWindow", "box2i", window);
+
+	PutAttribute(exr, "lineOrder", "lineOrder", std::vector<unsigned char>(1, 0));
+
+	float one = 1.0f;
+	std::vector<unsigned char> aspect((unsigned char*)&one, (unsigned char*)&one + 4);
+	PutAttribute(exr, "pixelAspectRatio", "float", aspect);
+	PutAttribute(exr, "screenWindowCenter", "v2f", std::vector<unsigned char>(8, 0));
+	PutAttribute(exr, "screenWindowWidth", "float", aspect);
+	exr.push_back(0);
+
+	// Offsets of every line, which all have the same size
+	size_t lineSize = 8 + (size_t)width * 3 * sizeof(float);
+	size_t firstLine = exr.size() + (size_t)height * 8;
+	for (int y = 0; y < height; y++)
+		PutLittleEndian(exr, firstLine + y * lineSize, 8);
+
+	for (int y = 0; y < height; y++)
+	{
+		PutLittleEndian(exr, (unsigned int)y, 4);
+		PutLittleEndian(exr, lineSize - 8, 4);
+		for (int c = 2; c >= 0; c--)
+		{
+			for (int x = 0; x < width; x++)
+			{
+				const unsigned char* bytes = (const unsigned char*)&rgb[((size_t)y * width + x) * 3 + c];
+				exr.insert(exr.end(), bytes, bytes + 4);
+			}
+		}
+	}
+
+	return WriteFile(file, exr);
+}
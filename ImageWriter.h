@@ -0,0 +1,17 @@
+#pragma once
+
+// --------------------------------------------------------
+// Writes images without any platform codecs
+//
+// Nothing is compressed, so the same pixels always give the
+// same bytes - handy for comparing against golden images.
+// --------------------------------------------------------
+class ImageWriter
+{
+public:
+	// 8-bit RGBA, rows packed top to bottom
+	static bool WritePng(const char* file, int width, int height, const unsigned char* rgba);
+
+	// 32-bit float RGB, rows packed top to bottom
+	static bool WriteExr(const char* file, int width, int height, const float* rgb);
+};
@@ -0,0 +1,301 @@
+#include "IrradianceBaker.h"
+#include <fstream>
+
+using namespace DirectX;
+
+namespace
+{
+	// Below this many rows per job, jobs cost more than they save
+	const int MinRowsPerJob = 32;
+
+	// Marks the start of a coefficient blob - "SH9\0"
+	const unsigned int BlobMagic = 0x00394853;
+
+	// Constant factors of the nine real SH basis functions
+	const float Y0 = 0.282095f;
+	const float Y1 = 0.488603f;
+	const float Y2 = 1.092548f;
+	const float Y20 = 0.315392f;
+	const float Y22 = 0.546274f;
+
+	// Clamped cosine convolution per band, divided by PI to
+	// match the convolution shader: PI, 2PI/3 and PI/4
+	const float Band0 = 1.0f;
+	const float Band1 = 2.0f / 3.0f;
+	const float Band2 = 0.25f;
+
+	// --------------------------------------------------------
+	// Nine basis functions for four directions at once
+	// --------------------------------------------------------
+	inline void EvaluateBasis(FXMVECTOR x, FXMVECTOR y, FXMVECTOR z, XMVECTOR basis[9])
+	{
+		basis[0] = XMVectorReplicate(Y0);
+		basis[1] = y * Y1;
+		basis[2] = z * Y1;
+		basis[3] = x * Y1;
+		basis[4] = x * y * Y2;
+		basis[5] = y * z * Y2;
+		basis[6] = (z * z * 3.0f - XMVectorSplatOne()) * Y20;
+		basis[7] = x * z * Y2;
+		basis[8] = (x * x - y * y) * Y22;
+	}
+
+	// --------------------------------------------------------
+	// Unit directions and solid angles for texels [x, x + 4)
+	// of one row - texels past the edge get no weight
+	// --------------------------------------------------------
+	inline void RowDirections(const CubeFaceBasis& face, int size, int x, float v,
+		XMVECTOR& dx, XMVECTOR& dy, XMVECTOR& dz, XMVECTOR& weight)
+	{
+		float texel = 2.0f / size;
+		XMVECTOR u = XMVectorSet(
+			(x + 0.5f) * texel - 1.0f,
+			(x + 1.5f) * texel - 1.0f,
+			(x + 2.5f) * texel - 1.0f,
+			(x + 3.5f) * texel - 1.0f);
+		XMVECTOR vv = XMVectorReplicate(v);
+
+		dx = u * face.U[0] + vv * face.V[0] + XMVectorReplicate(face.N[0]);
+		dy = u * face.U[1] + vv * face.V[1] + XMVectorReplicate(face.N[1]);
+		dz = u * face.U[2] + vv * face.V[2] + XMVectorReplicate(face.N[2]);
+
+		// |(u, v, 1)| is the same for every face
+		XMVECTOR lengthSq = u * u + vv * vv + XMVectorSplatOne();
+		XMVECTOR invLength = XMVectorReciprocal(XMVectorSqrt(lengthSq));
+		dx *= invLength;
+		dy *= invLength;
+		dz *= invLength;
+
+		// Solid angle of a texel is its area over distance cubed
+		weight = invLength * invLength * invLength * (texel * texel);
+
+		int valid = size - x;
+		if (valid < 4)
+		{
+			XMVECTOR lane = XMVectorSet(0, 1, 2, 3);
+			weight = XMVectorSelect(XMVectorZero(), weight, XMVectorLess(lane, XMVectorReplicate((float)valid)));
+		}
+	}
+
+	// --------------------------------------------------------
+	// One slice's weighted sums - each holds four partial sums
+	// of one coefficient's channel.  These live in a vector,
+	// which needn't be 16-byte aligned, so they're stored as
+	// plain floats and loaded and stored unaligned.
+	// --------------------------------------------------------
+	struct ProjectionSums
+	{
+		XMFLOAT4 R[9];
+		XMFLOAT4 G[9];
+		XMFLOAT4 B[9];
+	};
+
+	// --------------------------------------------------------
+	// Projects rows [first, last), counting across all six
+	// faces, into one set of sums
+	// --------------------------------------------------------
+	void ProjectRows(const CubeMapData& radiance, int first, int last, ProjectionSums* sums)
+	{
+		XMVECTOR sumR[9], sumG[9], sumB[9];
+		for (int i = 0; i < 9; i++)
+			sumR[i] = sumG[i] = sumB[i] = XMVectorZero();
+
+		int size = radiance.Size;
+		for (int row = first; row < last; row++)
+		{
+			int f = row / size;
+			int y = row % size;
+			float v = (y + 0.5f) * 2.0f / size - 1.0f;
+			const XMFLOAT3* texels = &radiance.Faces[f][y * size];
+
+			for (int x = 0; x < size; x += 4)
+			{
+				XMVECTOR dx, dy, dz, weight;
+				RowDirections(CubeFaces[f], size, x, v, dx, dy, dz, weight);
+
+				// Gather the texels into one vector per channel
+				const XMFLOAT3& t0 = texels[x];
+				const XMFLOAT3& t1 = texels[x + 1 < size ? x + 1 : x];
+				const XMFLOAT3& t2 = texels[x + 2 < size ? x + 2 : x];
+				const XMFLOAT3& t3 = texels[x + 3 < size ? x + 3 : x];
+				XMVECTOR r = XMVectorSet(t0.x, t1.x, t2.x, t3.x) * weight;
+				XMVECTOR g = XMVectorSet(t0.y, t1.y, t2.y, t3.y) * weight;
+				XMVECTOR b = XMVectorSet(t0.z, t1.z, t2.z, t3.z) * weight;
+
+				XMVECTOR basis[9];
+				EvaluateBasis(dx, dy, dz, basis);
+				for (int i = 0; i < 9; i++)
+				{
+					sumR[i] = XMVectorMultiplyAdd(r, basis[i], sumR[i]);
+					sumG[i] = XMVectorMultiplyAdd(g, basis[i], sumG[i]);
+					sumB[i] = XMVectorMultiplyAdd(b, basis[i], sumB[i]);
+				}
+			}
+		}
+
+		for (int i = 0; i < 9; i++)
+		{
+			XMStoreFloat4(&sums->R[i], sumR[i]);
+			XMStoreFloat4(&sums->G[i], sumG[i]);
+			XMStoreFloat4(&sums->B[i], sumB[i]);
+		}
+	}
+
+	// --------------------------------------------------------
+	// Evaluates the convolved coefficients for rows
+	// [first, last) of the irradiance cube map
+	// --------------------------------------------------------
+	void ReconstructRows(const SHCoefficients& convolved, int first, int last, CubeMapData* irradiance)
+	{
+		XMVECTOR cr[9], cg[9], cb[9];
+		for (int i = 0; i < 9; i++)
+		{
+			cr[i] = XMVectorReplicate(convolved.C[i].x);
+			cg[i] = XMVectorReplicate(convolved.C[i].y);
+			cb[i] = XMVectorReplicate(convolved.C[i].z);
+		}
+
+		int size = irradiance->Size;
+		for (int row = first; row < last; row++)
+		{
+			int f = row / size;
+			int y = row % size;
+			float v = (y + 0.5f) * 2.0f / size - 1.0f;
+			XMFLOAT3* texels = &irradiance->Faces[f][y * size];
+
+			for (int x = 0; x < size; x += 4)
+			{
+				XMVECTOR dx, dy, dz, weight;
+				RowDirections(CubeFaces[f], size, x, v, dx, dy, dz, weight);
+
+				XMVECTOR basis[9];
+				EvaluateBasis(dx, dy, dz, basis);
+
+				XMVECTOR r = XMVectorZero();
+				XMVECTOR g = XMVectorZero();
+				XMVECTOR b = XMVectorZero();
+				for (int i = 0; i < 9; i++)
+				{
+					r = XMVectorMultiplyAdd(cr[i], basis[i], r);
+					g = XMVectorMultiplyAdd(cg[i], basis[i], g);
+					b = XMVectorMultiplyAdd(cb[i], basis[i], b);
+				}
+
+				// Ringing can dip below zero where the sky is very uneven
+				r = XMVectorMax(r, XMVectorZero());
+				g = XMVectorMax(g, XMVectorZero());
+				b = XMVectorMax(b, XMVectorZero());
+
+				XMFLOAT4A rs, gs, bs;
+				XMStoreFloat4A(&rs, r);
+				XMStoreFloat4A(&gs, g);
+				XMStoreFloat4A(&bs, b);
+				int count = size - x < 4 ? size - x : 4;
+				for (int i = 0; i < count; i++)
+					texels[x + i] = XMFLOAT3((&rs.x)[i], (&gs.x)[i], (&bs.x)[i]);
+			}
+		}
+	}
+}
+
+
+// --------------------------------------------------------
+// The rows are cut into fixed slices, each summed on its
+// own, so the total doesn't depend on how many threads ran
+// them
+// --------------------------------------------------------
+void IrradianceBaker::Project(const CubeMapData & radiance, SHCoefficients & sh, JobSystem* jobs)
+{
+	int rows = radiance.Size * 6;
+	int sliceCount = rows / MinRowsPerJob;
+	if (sliceCount < 1)
+		sliceCount = 1;
+
+	std::vector<ProjectionSums> sums(sliceCount);
+	auto projectSlices = [&](size_t first, size_t last) {
+		for (size_t i = first; i < last; i++)
+			ProjectRows(radiance, (int)(rows * i / sliceCount), (int)(rows * (i + 1) / sliceCount), &sums[i]);
+	};
+	if (jobs && sliceCount > 1)
+		jobs->Wait(jobs->ParallelFor("Project irradiance", sliceCount, 1, projectSlices));
+	else
+		projectSlices(0, sliceCount);
+
+	// Then add up every slice's lanes
+	for (int c = 0; c < 9; c++)
+	{
+		XMVECTOR r = XMVectorZero();
+		XMVECTOR g = XMVectorZero();
+		XMVECTOR b = XMVectorZero();
+		for (int i = 0; i < sliceCount; i++)
+		{
+			r += XMLoadFloat4(&sums[i].R[c]);
+			g += XMLoadFloat4(&sums[i].G[c]);
+			b += XMLoadFloat4(&sums[i].B[c]);
+		}
+
+		XMFLOAT4A rs, gs, bs;
+		XMStoreFloat4A(&rs, r);
+		XMStoreFloat4A(&gs, g);
+		XMStoreFloat4A(&bs, b);
+		sh.C[c] = XMFLOAT3(
+			rs.x + rs.y + rs.z + rs.w,
+			gs.x + gs.y + gs.z + gs.w,
+			bs.x + bs.y + bs.z + bs.w);
+	}
+}
+
+void IrradianceBaker::Reconstruct(const SHCoefficients & sh, int size, CubeMapData & irradiance, JobSystem* jobs)
+{
+	irradiance.Resize(size);
+
+	// Convolve with the clamped cosine up front
+	const float bands[9] = { Band0, Band1, Band1, Band1, Band2, Band2, Band2, Band2, Band2 };
+	SHCoefficients convolved;
+	for (int i = 0; i < 9; i++)
+		convolved.C[i] = XMFLOAT3(sh.C[i].x * bands[i], sh.C[i].y * bands[i], sh.C[i].z * bands[i]);
+
+	// Every row is independent
+	int rows = size * 6;
+	if (!jobs || rows < MinRowsPerJob * 2)
+	{
+		ReconstructRows(convolved, 0, rows, &irradiance);
+		return;
+	}
+
+	jobs->Wait(jobs->ParallelFor("Reconstruct irradiance", rows, MinRowsPerJob, [&](size_t first, size_t last) {
+		ReconstructRows(convolved, (int)first, (int)last, &irradiance);
+	}));
+}
+
+void IrradianceBaker::Bake(const CubeMapData & radiance, int size, SHCoefficients & sh, CubeMapData & irradiance, JobSystem* jobs)
+{
+	Project(radiance, sh, jobs);
+	Reconstruct(sh, size, irradiance, jobs);
+}
+
+bool IrradianceBaker::SaveCoefficients(const char * file, const SHCoefficients & sh)
+{
+	std::ofstream out(file, std::ios::binary);
+	if (!out)
+		return false;
+
+	out.write((const char*)&BlobMagic, sizeof(BlobMagic));
+	out.write((const char*)sh.C, sizeof(sh.C));
+	return out.good();
+}
+
+bool IrradianceBaker::LoadCoefficients(const char * file, SHCoefficients & sh)
+{
+	std::ifstream in(file, std::ios::binary);
+	if (!in)
+		return false;
+
+	unsigned int magic = 0;
+	in.read((char*)&magic, sizeof(magic));
+	if (!in || magic != BlobMagic)
+		return false;
+
+	in.read((char*)sh.C, sizeof(sh.C));
+	return in.good();
+}
\ No newline at end of file
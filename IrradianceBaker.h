@@ -0,0 +1,44 @@
+#pragma once
+#include <DirectXMath.h>
+#include "CubeMap.h"
+#include "JobSystem.h"
+
+// --------------------------------------------------------
+// Order 3 (nine term) spherical harmonics of RGB radiance
+// --------------------------------------------------------
+struct SHCoefficients
+{
+	DirectX::XMFLOAT3 C[9];
+};
+
+// --------------------------------------------------------
+// Bakes diffuse irradiance from an environment cube map
+//
+// Instead of integrating the hemisphere around every output
+// texel, the environment is projected once onto nine
+// spherical harmonics and the irradiance cube map is then
+// read back off the convolved coefficients.  Both passes
+// work on four texels per DirectXMath vector and, given a
+// job system, split the rows across its threads.
+//
+// Results match ConvolutionPixelShader.hlsl, which outputs
+// irradiance divided by PI.
+// --------------------------------------------------------
+class IrradianceBaker
+{
+public:
+	// Projects radiance onto spherical harmonics, weighting
+	// each texel by the solid angle it covers
+	static void Project(const CubeMapData& radiance, SHCoefficients& sh, JobSystem* jobs = 0);
+
+	// Fills a size x size cube map with the irradiance the
+	// coefficients describe
+	static void Reconstruct(const SHCoefficients& sh, int size, CubeMapData& irradiance, JobSystem* jobs = 0);
+
+	// Both of the above
+	static void Bake(const CubeMapData& radiance, int size, SHCoefficients& sh, CubeMapData& irradiance, JobSystem* jobs = 0);
+
+	// Coefficient blobs, so the projection can be skipped next time
+	static bool SaveCoefficients(const char* file, const SHCoefficients& sh);
+	static bool LoadCoefficients(const char* file, SHCoefficients& sh);
+};
@@ -0,0 +1,436 @@
+#include "JobSystem.h"
+#include "FrameProfiler.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+	// ParallelFor() aims for this many ranges per thread, so
+	// threads that finish early have something left to steal
+	const size_t RangesPerThread = 4;
+}
+
+// --------------------------------------------------------
+// A scheduled piece of work
+// --------------------------------------------------------
+struct Job
+{
+	std::function<void()> Work;
+	const char* Name;
+	JobAffinity Affinity;
+	Job* Parent;							// Completes after this does
+	std::atomic<int> Unfinished;			// This job plus its unfinished children
+	std::atomic<int> PendingDependencies;
+	std::atomic<bool> Finished;
+
+	std::mutex Mutex;						// Guards Continuations against Finished
+	std::vector<Job*> Continuations;
+};
+
+// --------------------------------------------------------
+// One thread's queue, jobs and timings
+// --------------------------------------------------------
+struct JobThread
+{
+	std::mutex QueueMutex;
+	std::deque<Job*> Queue;
+
+	// Only reclaimed by Reset(), so handles stay valid
+	std::mutex JobsMutex;
+	std::deque<Job> Jobs;
+
+	// Only written by this thread
+	std::vector<JobTiming> Timings;
+};
+
+
+JobSystem::JobSystem(int threadCount)
+{
+	start = std::chrono::steady_clock::now();
+	queuedJobs = 0;
+	sleepingWorkers = 0;
+	stopping = false;
+
+	// The main thread runs jobs too, whenever it waits
+	if (threadCount <= 0)
+		threadCount = (int)std::thread::hardware_concurrency() - 1;
+	if (threadCount < 0)
+		threadCount = 0;
+
+	for (int i = 0; i <= threadCount; i++)
+		threads.push_back(new JobThread());
+
+	// Nothing can be scheduled until this returns, so the ids
+	// are all in place before any job looks for its thread
+	threadIds.push_back(std::this_thread::get_id());
+	for (int i = 1; i <= threadCount; i++)
+	{
+		workers.push_back(std::thread(&JobSystem::WorkerLoop, this, i));
+		threadIds.push_back(workers.back().get_id());
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	stopping = true;
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+	}
+	wake.notify_all();
+
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+	for (size_t i = 0; i < threads.size(); i++)
+		delete threads[i];
+}
+
+JobHandle JobSystem::Schedule(const char * name, std::function<void()> work, std::initializer_list<JobHandle> dependencies, JobAffinity affinity)
+{
+	Job* job = Allocate(name, affinity);
+	job->Work = work;
+	Submit(job, dependencies);
+	return job;
+}
+
+// --------------------------------------------------------
+// Queues one job that hands out the ranges once it runs,
+// so the ranges wait on the dependencies without each of
+// them being a continuation
+// --------------------------------------------------------
+JobHandle JobSystem::ParallelFor(const char * name, size_t count, size_t minGrain, std::function<void(size_t first, size_t last)> body, std::initializer_list<JobHandle> dependencies)
+{
+	size_t rangeCount = threads.size() * RangesPerThread;
+	size_t grain = (count + rangeCount - 1) / rangeCount;
+	if (grain < minGrain)
+		grain = minGrain;
+	if (grain < 1)
+		grain = 1;
+
+	Job* job = Allocate(name, JobAffinity::AnyThread);
+	job->Work = [this, job, name, count, grain, body]() {
+		// The body lives as long as this job, so ranges can point at it
+		const std::function<void(size_t, size_t)>* rangeBody = &body;
+
+		// This job runs the last range itself
+		size_t first = 0;
+		for (; first + grain < count; first += grain)
+		{
+			size_t last = first + grain;
+			Job* range = Allocate(name, JobAffinity::AnyThread);
+			range->Work = [rangeBody, first, last]() { (*rangeBody)(first, last); };
+			range->Parent = job;
+			job->Unfinished++;
+			Push(range);
+		}
+		if (first < count)
+			body(first, count);
+	};
+	Submit(job, dependencies);
+	return job;
+}
+
+void JobSystem::Wait(JobHandle job)
+{
+	int thread = GetCurrentThread();
+	while (!job->Finished)
+	{
+		if (thread < 0 || !RunOne(thread))
+			std::this_thread::yield();
+	}
+
+	// The thread that finished it may still be releasing its lock
+	std::lock_guard<std::mutex> lock(job->Mutex);
+}
+
+bool JobSystem::IsFinished(JobHandle job)
+{
+	std::lock_guard<std::mutex> lock(job->Mutex);
+	return job->Finished;
+}
+
+void JobSystem::Reset()
+{
+	for (size_t i = 0; i < threads.size(); i++)
+	{
+		threads[i]->Jobs.clear();
+		threads[i]->Timings.clear();
+	}
+	start = std::chrono::steady_clock::now();
+}
+
+std::vector<JobTiming> JobSystem::GetTimings()
+{
+	std::vector<JobTiming> timings;
+	for (size_t i = 0; i < threads.size(); i++)
+		timings.insert(timings.end(), threads[i]->Timings.begin(), threads[i]->Timings.end());
+
+	std::sort(timings.begin(), timings.end(), [](const JobTiming& a, const JobTiming& b) { return a.Start < b.Start; });
+	return timings;
+}
+
+#if defined(DEBUG) || defined(_DEBUG)
+// --------------------------------------------------------
+// Totals by job name - ranges of one ParallelFor() share
+// a name, so a loop is one line with its wall clock span
+// --------------------------------------------------------
+void JobSystem::PrintTimings()
+{
+	std::vector<JobTiming> timings = GetTimings();
+
+	std::vector<const char*> names;
+	for (size_t i = 0; i < timings.size(); i++)
+	{
+		bool found = false;
+		for (size_t n = 0; n < names.size() && !found; n++)
+			found = strcmp(names[n], timings[i].Name) == 0;
+		if (!found)
+			names.push_back(timings[i].Name);
+	}
+
+	printf("\n%-40s %6s %9s %9s", "Job", "Runs", "Busy ms", "Span ms");
+	for (size_t n = 0; n < names.size(); n++)
+	{
+		int runs = 0;
+		double busy = 0.0;
+		double first = 0.0;
+		double last = 0.0;
+		for (size_t i = 0; i < timings.size(); i++)
+		{
+			const JobTiming& timing = timings[i];
+			if (strcmp(timing.Name, names[n]) != 0)
+				continue;
+			if (runs == 0 || timing.Start < first) first = timing.Start;
+			if (runs == 0 || timing.End > last) last = timing.End;
+			busy += timing.End - timing.Start;
+			runs++;
+		}
+		printf("\n%-40s %6d %9.3f %9.3f", names[n], runs, busy, last - first);
+	}
+
+	for (size_t t = 0; t < threads.size(); t++)
+	{
+		double busy = 0.0;
+		for (size_t i = 0; i < timings.size(); i++)
+		{
+			if (timings[i].Thread == (int)t)
+				busy += timings[i].End - timings[i].Start;
+		}
+		printf("\nThread %d busy %.3f ms", (int)t, busy);
+	}
+}
+#endif
+
+void JobSystem::WorkerLoop(int thread)
+{
+#if PROFILING_ENABLED
+	FrameProfiler::NameThread("Job worker");
+#endif
+
+	while (!stopping)
+	{
+		if (RunOne(thread))
+			continue;
+
+		// Pushers check for sleepers after counting their job,
+		// and sleepers check for jobs after counting themselves,
+		// so one of the two always sees the other
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		sleepingWorkers++;
+		wake.wait(lock, [&]() { return stopping || queuedJobs > 0; });
+		sleepingWorkers--;
+	}
+}
+
+Job * JobSystem::Allocate(const char * name, JobAffinity affinity)
+{
+	// Threads outside the system share the main thread's jobs
+	int thread = GetCurrentThread();
+	JobThread* owner = threads[thread < 0 ? 0 : thread];
+
+	Job* job;
+	{
+		std::lock_guard<std::mutex> lock(owner->JobsMutex);
+		owner->Jobs.emplace_back();
+		job = &owner->Jobs.back();
+	}
+
+	job->Name = name;
+	job->Affinity = affinity;
+	job->Parent = 0;
+	job->Unfinished = 1;
+	job->PendingDependencies = 0;
+	job->Finished = false;
+	return job;
+}
+
+// --------------------------------------------------------
+// Registers the job with each dependency still running.
+// The extra count held meanwhile stops a dependency that
+// finishes partway through from queueing it early.
+// --------------------------------------------------------
+void JobSystem::Submit(Job * job, std::initializer_list<JobHandle> dependencies)
+{
+	job->PendingDependencies = 1;
+	for (JobHandle dependency : dependencies)
+	{
+		if (!dependency)
+			continue;
+
+		std::lock_guard<std::mutex> lock(dependency->Mutex);
+		if (!dependency->Finished)
+		{
+			dependency->Continuations.push_back(job);
+			job->PendingDependencies++;
+		}
+	}
+
+	if (--job->PendingDependencies == 0)
+		Push(job);
+}
+
+void JobSystem::Push(Job * job)
+{
+	if (job->Affinity == JobAffinity::MainThread)
+	{
+		std::lock_guard<std::mutex> lock(mainMutex);
+		mainQueue.push_back(job);
+		return;
+	}
+
+	// Counted before it can be taken, so the count never dips below zero
+	queuedJobs++;
+
+	int thread = GetCurrentThread();
+	JobThread* owner = threads[thread < 0 ? 0 : thread];
+	{
+		std::lock_guard<std::mutex> lock(owner->QueueMutex);
+		owner->Queue.push_back(job);
+	}
+
+	if (sleepingWorkers > 0)
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		wake.notify_one();
+	}
+}
+
+// --------------------------------------------------------
+// Main thread jobs first, then this thread's newest job,
+// then the oldest job of any other thread
+// --------------------------------------------------------
+bool JobSystem::RunOne(int thread)
+{
+	Job* job = 0;
+
+	if (thread == 0)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mainMutex);
+			if (!mainQueue.empty())
+			{
+				job = mainQueue.front();
+				mainQueue.pop_front();
+			}
+		}
+		if (job)
+		{
+			Execute(job, thread);
+			return true;
+		}
+	}
+
+	{
+		JobThread* own = threads[thread];
+		std::lock_guard<std::mutex> lock(own->QueueMutex);
+		if (!own->Queue.empty())
+		{
+			job = own->Queue.back();
+			own->Queue.pop_back();
+		}
+	}
+
+	for (size_t i = 1; !job && i < threads.size(); i++)
+	{
+		JobThread* victim = threads[(thread + i) % threads.size()];
+		std::lock_guard<std::mutex> lock(victim->QueueMutex);
+		if (!victim->Queue.empty())
+		{
+			job = victim->Queue.front();
+			victim->Queue.pop_front();
+		}
+	}
+
+	if (!job)
+		return false;
+
+	queuedJobs--;
+	Execute(job, thread);
+	return true;
+}
+
+void JobSystem::Execute(Job * job, int thread)
+{
+	double jobStart = Now();
+	if (job->Work)
+	{
+		PROFILE_SCOPE(job->Name);
+		job->Work();
+	}
+	double jobEnd = Now();
+
+	JobTiming timing = { job->Name, thread, jobStart, jobEnd };
+	threads[thread]->Timings.push_back(timing);
+
+	Complete(job);
+}
+
+// --------------------------------------------------------
+// Drops one of the job's unfinished counts, and once none
+// are left queues anything that was only waiting on it
+// --------------------------------------------------------
+void JobSystem::Complete(Job * job)
+{
+	if (--job->Unfinished > 0)
+		return;
+
+	Job* parent = job->Parent;
+	std::vector<Job*> continuations;
+	{
+		std::lock_guard<std::mutex> lock(job->Mutex);
+		continuations.swap(job->Continuations);
+		job->Finished = true;
+	}
+
+	// Nothing in the job is touched past here, as a waiter
+	// may reset the system as soon as the lock is free
+	for (size_t i = 0; i < continuations.size(); i++)
+	{
+		if (--continuations[i]->PendingDependencies == 0)
+			Push(continuations[i]);
+	}
+
+	if (parent)
+		Complete(parent);
+}
+
+// --------------------------------------------------------
+// Looked up per system rather than kept in a thread_local,
+// so systems created one after another, or one inside
+// another, each know their own main thread
+// --------------------------------------------------------
+int JobSystem::GetCurrentThread() const
+{
+	std::thread::id id = std::this_thread::get_id();
+	for (size_t i = 0; i < threadIds.size(); i++)
+	{
+		if (threadIds[i] == id)
+			return (int)i;
+	}
+	return -1;
+}
+
+double JobSystem::Now() const
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
@@ -0,0 +1,131 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct Job;
+struct JobThread;
+
+// --------------------------------------------------------
+// Identifies a scheduled job until the next Reset()
+// --------------------------------------------------------
+typedef Job* JobHandle;
+
+// Which threads may run a job
+enum class JobAffinity
+{
+	AnyThread,
+	MainThread		// Only the thread that created the job system
+};
+
+// One run of a job, in milliseconds since the last Reset().
+// Jobs it ran while inside Wait() are counted in its time.
+struct JobTiming
+{
+	const char* Name;
+	int Thread;		// 0 is the main thread
+	double Start;
+	double End;
+};
+
+// --------------------------------------------------------
+// Runs small jobs across a pool of worker threads
+//
+// Every thread has its own queue.  A thread takes its
+// newest job first, which keeps the data it just touched
+// in cache, and when it runs out it steals the oldest job
+// from another thread's queue - usually the biggest piece
+// of work left there.
+//
+// A job can depend on earlier jobs, and is queued by
+// whichever of them finishes last.  ParallelFor() splits a
+// range into a few jobs per thread, never smaller than the
+// grain it is given, and finishes when they all have.
+//
+// Main thread jobs are for anything that has to stay on
+// the thread that owns the immediate context.  They only
+// run while that thread is inside Wait().
+//
+// Wait() runs other jobs until the one it waits for is
+// done, so waiting from inside a job never blocks a worker.
+// Jobs may be scheduled from the main thread and from
+// other jobs.
+//
+// Job memory is only reclaimed by Reset(), which is meant
+// to be called once a frame when nothing is running.  Each
+// run is timed, and the timings are kept until then too.
+// --------------------------------------------------------
+class JobSystem
+{
+public:
+	// Zero threads means one per core, less the main thread
+	JobSystem(int threadCount = 0);
+	~JobSystem();
+
+	JobHandle Schedule(const char* name, std::function<void()> work,
+		std::initializer_list<JobHandle> dependencies = {}, JobAffinity affinity = JobAffinity::AnyThread);
+
+	// Runs body over [0, count) in ranges of at least
+	// minGrain, once the dependencies are done
+	JobHandle ParallelFor(const char* name, size_t count, size_t minGrain, std::function<void(size_t first, size_t last)> body,
+		std::initializer_list<JobHandle> dependencies = {});
+
+	// Runs jobs on this thread until this one is done
+	void Wait(JobHandle job);
+	bool IsFinished(JobHandle job);
+
+	// Frees every job and timing - nothing may be running
+	void Reset();
+
+	// Counting the main thread
+	int GetThreadCount() const { return (int)threads.size(); }
+
+	// The calling thread's index - 0 for the thread that
+	// created the system, -1 for threads outside it
+	int GetCurrentThread() const;
+
+	// Every job run since the last Reset()
+	std::vector<JobTiming> GetTimings();
+
+#if defined(DEBUG) || defined(_DEBUG)
+	// Prints GetTimings() totalled by job name - debug builds
+	// only, which are the ones with a console
+	void PrintTimings();
+#endif
+
+private:
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	// The main thread is threads[0], which has no std::thread
+	std::vector<JobThread*> threads;
+	std::vector<std::thread> workers;
+	std::vector<std::thread::id> threadIds;
+	std::chrono::steady_clock::time_point start;
+
+	// Main thread jobs, which no worker may take
+	std::mutex mainMutex;
+	std::deque<Job*> mainQueue;
+
+	// Idle workers sleep until something is queued
+	std::mutex sleepMutex;
+	std::condition_variable wake;
+	std::atomic<int> queuedJobs;
+	std::atomic<int> sleepingWorkers;
+	std::atomic<bool> stopping;
+
+	void WorkerLoop(int thread);
+	Job* Allocate(const char* name, JobAffinity affinity);
+	void Submit(Job* job, std::initializer_list<JobHandle> dependencies);
+	void Push(Job* job);
+	bool RunOne(int thread);
+	void Execute(Job* job, int thread);
+	void Complete(Job* job);
+	double Now() const;
+};
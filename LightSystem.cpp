@@ -0,0 +1,442 @@
+#include "LightSystem.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace DirectX;
+
+namespace
+{
+	// Below this many lights per job, jobs cost more than they save
+	const size_t MinLightsPerJob = 256;
+
+	// Clusters each slice has
+	const int SliceClusters = LightSystem::ClustersX * LightSystem::ClustersY;
+
+	// --------------------------------------------------------
+	// Grows cluster bounds by a little, so pixels right on an
+	// edge, which the shader may put on either side of it,
+	// are covered by the clusters on both sides
+	// --------------------------------------------------------
+	const float ClusterPadding = 0.001f;
+
+	// A unit normal for the plane through the eye holding every
+	// point where coordinate / z is slope, facing past it
+	XMFLOAT2 EdgePlane(float slope)
+	{
+		float length = sqrtf(1.0f + slope * slope);
+		return XMFLOAT2(1.0f / length, -slope / length);
+	}
+
+	// --------------------------------------------------------
+	// Whether a spot light's cone misses a cluster's bounding
+	// sphere entirely - off to the side, past the end of the
+	// light's range, or behind it
+	// --------------------------------------------------------
+	bool ConeMisses(const XMFLOAT3& apex, const XMFLOAT3& direction, float range, float cosAngle, float sinAngle, const XMFLOAT4& sphere)
+	{
+		XMFLOAT3 v(sphere.x - apex.x, sphere.y - apex.y, sphere.z - apex.z);
+		float lengthSq = v.x * v.x + v.y * v.y + v.z * v.z;
+		float along = v.x * direction.x + v.y * direction.y + v.z * direction.z;
+		float closest = cosAngle * sqrtf(std::max(lengthSq - along * along, 0.0f)) - along * sinAngle;
+
+		return closest > sphere.w || along > sphere.w + range || along < -sphere.w;
+	}
+}
+
+
+LightSystem::LightSystem()
+{
+	nearClip = 0.0f;
+	farClip = 0.0f;
+	sliceScale = 0.0f;
+	sliceBias = 0.0f;
+	clustersBuilt = false;
+
+	minX.resize(ClusterCount); minY.resize(ClusterCount); minZ.resize(ClusterCount);
+	maxX.resize(ClusterCount); maxY.resize(ClusterCount); maxZ.resize(ClusterCount);
+	clusterSpheres.resize(ClusterCount);
+	sliceBins.resize(ClustersZ);
+	clusters.resize(ClusterCount);
+}
+
+LightSystem::~LightSystem()
+{
+}
+
+unsigned int LightSystem::Add(const Light & light)
+{
+	unsigned int index = (unsigned int)lights.size();
+	lights.push_back(light);
+	shaderLights.push_back(ShaderLight());
+	Set(index, light);
+	return index;
+}
+
+// --------------------------------------------------------
+// Replaces a light, working out what the shader needs from
+// it now rather than every frame
+// --------------------------------------------------------
+void LightSystem::Set(unsigned int index, const Light & light)
+{
+	lights[index] = light;
+
+	ShaderLight& shaderLight = shaderLights[index];
+	shaderLight.Position = light.Position;
+	shaderLight.Range = light.Range;
+	shaderLight.Color = light.Color;
+
+	if (light.Type == LightType::Spot)
+	{
+		float cosInner = cosf(light.InnerAngle);
+		float cosOuter = cosf(light.OuterAngle);
+		XMStoreFloat3(&shaderLight.Direction, XMVector3Normalize(XMLoadFloat3(&light.Direction)));
+		shaderLight.SpotScale = 1.0f / std::max(cosInner - cosOuter, 0.0001f);
+		shaderLight.SpotOffset = -cosOuter * shaderLight.SpotScale;
+	}
+	else
+	{
+		shaderLight.Direction = XMFLOAT3(0.0f, 0.0f, 1.0f);
+		shaderLight.SpotScale = 0.0f;
+		shaderLight.SpotOffset = 1.0f;
+	}
+}
+
+void LightSystem::Clear()
+{
+	lights.clear();
+	shaderLights.clear();
+}
+
+void LightSystem::Update(const XMFLOAT4X4 & view, const XMFLOAT4X4 & projection, JobSystem * jobs)
+{
+	if (!clustersBuilt || memcmp(&projection, &builtProjection, sizeof(XMFLOAT4X4)) != 0)
+		BuildClusters(projection);
+
+	size_t count = lights.size();
+	viewLights.resize(count);
+	bool parallel = jobs && count >= MinLightsPerJob;
+
+	// Each light's view space bounds and cluster ranges
+	auto prepare = [this, &view](size_t first, size_t last) {
+		XMMATRIX viewMatrix = XMMatrixTranspose(XMLoadFloat4x4(&view));
+		for (size_t i = first; i < last; i++)
+			PrepareLight((unsigned int)i, viewMatrix);
+	};
+
+	// Lists the lights that reach each slice, in light order
+	auto bucket = [this, count]() {
+		sliceLightOffsets.assign(ClustersZ + 1, 0);
+		for (size_t i = 0; i < count; i++)
+		{
+			for (int z = viewLights[i].FirstZ; z <= viewLights[i].LastZ; z++)
+				sliceLightOffsets[z + 1]++;
+		}
+		for (int z = 0; z < ClustersZ; z++)
+			sliceLightOffsets[z + 1] += sliceLightOffsets[z];
+
+		sliceLights.resize(sliceLightOffsets[ClustersZ]);
+		unsigned int next[ClustersZ];
+		for (int z = 0; z < ClustersZ; z++)
+			next[z] = sliceLightOffsets[z];
+		for (size_t i = 0; i < count; i++)
+		{
+			for (int z = viewLights[i].FirstZ; z <= viewLights[i].LastZ; z++)
+				sliceLights[next[z]++] = (unsigned int)i;
+		}
+	};
+
+	// Where each slice's indices start in the packed list
+	auto place = [this]() {
+		unsigned int total = 0;
+		for (int z = 0; z < ClustersZ; z++)
+		{
+			sliceBins[z].Offset = total;
+			total += (unsigned int)sliceBins[z].Indices.size();
+		}
+		lightIndices.resize(total);
+	};
+
+	if (!parallel)
+	{
+		prepare(0, count);
+		bucket();
+		for (int z = 0; z < ClustersZ; z++)
+			BinSlice(z);
+		place();
+		for (int z = 0; z < ClustersZ; z++)
+			PackSlice(z);
+		return;
+	}
+
+	JobHandle prepared = jobs->ParallelFor("Prepare lights", count, MinLightsPerJob, prepare);
+	JobHandle bucketed = jobs->Schedule("Bucket lights", bucket, { prepared });
+	JobHandle binned = jobs->ParallelFor("Bin lights", ClustersZ, 1, [this](size_t first, size_t last) {
+		for (size_t z = first; z < last; z++)
+			BinSlice((int)z);
+	}, { bucketed });
+	JobHandle placed = jobs->Schedule("Place light clusters", place, { binned });
+	jobs->Wait(jobs->ParallelFor("Pack light clusters", ClustersZ, 1, [this](size_t first, size_t last) {
+		for (size_t z = first; z < last; z++)
+			PackSlice((int)z);
+	}, { placed }));
+}
+
+// --------------------------------------------------------
+// Works out every cluster's view space bounds from the
+// projection's near and far planes and its inverse
+// --------------------------------------------------------
+void LightSystem::BuildClusters(const XMFLOAT4X4 & projection)
+{
+	builtProjection = projection;
+	clustersBuilt = true;
+
+	// A left handed perspective projection keeps its planes in
+	// the z column - z' = z * far / (far - near) - near * far / (far - near)
+	XMMATRIX proj = XMMatrixTranspose(XMLoadFloat4x4(&projection));
+	XMFLOAT4X4 p;
+	XMStoreFloat4x4(&p, proj);
+	nearClip = -p._43 / p._33;
+	farClip = p._43 / (1.0f - p._33);
+
+	float logRatio = logf(farClip / nearClip);
+	sliceScale = ClustersZ / logRatio;
+	sliceBias = -ClustersZ * logf(nearClip) / logRatio;
+
+	float sliceDepths[ClustersZ + 1];
+	for (int z = 0; z <= ClustersZ; z++)
+		sliceDepths[z] = nearClip * powf(farClip / nearClip, (float)z / ClustersZ);
+
+	// Tile edges as x / z and y / z, from the points on the
+	// near plane they pass through.  Rows go down the screen.
+	XMMATRIX inverse = XMMatrixInverse(0, proj);
+	float columnEdges[ClustersX + 1];
+	float rowEdges[ClustersY + 1];
+	for (int x = 0; x <= ClustersX; x++)
+	{
+		XMFLOAT3 point;
+		XMStoreFloat3(&point, XMVector3TransformCoord(XMVectorSet(-1.0f + 2.0f * x / ClustersX, 0.0f, 0.0f, 1.0f), inverse));
+		columnEdges[x] = point.x / point.z;
+		columnPlanes[x] = EdgePlane(columnEdges[x]);
+	}
+	for (int y = 0; y <= ClustersY; y++)
+	{
+		XMFLOAT3 point;
+		XMStoreFloat3(&point, XMVector3TransformCoord(XMVectorSet(0.0f, 1.0f - 2.0f * y / ClustersY, 0.0f, 1.0f), inverse));
+		rowEdges[y] = point.y / point.z;
+		rowPlanes[y] = EdgePlane(rowEdges[y]);
+	}
+
+	for (int z = 0; z < ClustersZ; z++)
+	{
+		float nearDepth = sliceDepths[z];
+		float farDepth = sliceDepths[z + 1];
+		float padding = farDepth * ClusterPadding;
+
+		for (int y = 0; y < ClustersY; y++)
+		{
+			for (int x = 0; x < ClustersX; x++)
+			{
+				// The edges are straight lines through the eye, so
+				// the corners at either depth bound the cluster
+				float xs[4] = { columnEdges[x] * nearDepth, columnEdges[x + 1] * nearDepth, columnEdges[x] * farDepth, columnEdges[x + 1] * farDepth };
+				float ys[4] = { rowEdges[y] * nearDepth, rowEdges[y + 1] * nearDepth, rowEdges[y] * farDepth, rowEdges[y + 1] * farDepth };
+
+				int cluster = (z * ClustersY + y) * ClustersX + x;
+				minX[cluster] = *std::min_element(xs, xs + 4) - padding;
+				maxX[cluster] = *std::max_element(xs, xs + 4) + padding;
+				minY[cluster] = *std::min_element(ys, ys + 4) - padding;
+				maxY[cluster] = *std::max_element(ys, ys + 4) + padding;
+				minZ[cluster] = nearDepth - padding;
+				maxZ[cluster] = farDepth + padding;
+
+				XMFLOAT3 extents(
+					(maxX[cluster] - minX[cluster]) * 0.5f,
+					(maxY[cluster] - minY[cluster]) * 0.5f,
+					(maxZ[cluster] - minZ[cluster]) * 0.5f);
+				clusterSpheres[cluster] = XMFLOAT4(
+					minX[cluster] + extents.x,
+					minY[cluster] + extents.y,
+					minZ[cluster] + extents.z,
+					sqrtf(extents.x * extents.x + extents.y * extents.y + extents.z * extents.z));
+			}
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Moves a light's bounding sphere into view space and
+// narrows down which slices, columns and rows it reaches
+// --------------------------------------------------------
+void LightSystem::PrepareLight(unsigned int index, const XMMATRIX & view)
+{
+	const Light& light = lights[index];
+	ViewLight& viewLight = viewLights[index];
+
+	XMStoreFloat3(&viewLight.Center, XMVector3TransformCoord(XMLoadFloat3(&light.Position), view));
+	viewLight.Radius = light.Range;
+
+	// Nothing reached yet
+	viewLight.FirstX = viewLight.FirstY = viewLight.FirstZ = 1;
+	viewLight.LastX = viewLight.LastY = viewLight.LastZ = 0;
+
+	// Padded like the cluster bounds, for pixels on an edge
+	const XMFLOAT3& c = viewLight.Center;
+	float r = viewLight.Radius + fabsf(c.z + viewLight.Radius) * ClusterPadding;
+	if (c.z + r < nearClip || c.z - r > farClip)
+		return;
+
+	// Most lights are usually off to the side of the frustum
+	if (columnPlanes[0].x * c.x + columnPlanes[0].y * c.z < -r ||
+		columnPlanes[ClustersX].x * c.x + columnPlanes[ClustersX].y * c.z > r ||
+		rowPlanes[0].x * c.y + rowPlanes[0].y * c.z > r ||
+		rowPlanes[ClustersY].x * c.y + rowPlanes[ClustersY].y * c.z < -r)
+		return;
+
+	// A column is reached unless the sphere is entirely past one
+	// of its edges.  The reached ones lie between the first and
+	// last that pass, so scan in from both ends.
+	int firstX = 0, lastX = ClustersX - 1;
+	while (firstX < ClustersX && !ColumnReached(firstX, c, r))
+		firstX++;
+	while (lastX > firstX && !ColumnReached(lastX, c, r))
+		lastX--;
+
+	// Rows run down the screen, from the top edge to the bottom
+	int firstY = 0, lastY = ClustersY - 1;
+	while (firstY < ClustersY && !RowReached(firstY, c, r))
+		firstY++;
+	while (lastY > firstY && !RowReached(lastY, c, r))
+		lastY--;
+
+	if (firstX == ClustersX || firstY == ClustersY)
+		return;
+
+	// The cone test only works for cones narrower than a half space
+	viewLight.Spot = light.Type == LightType::Spot && light.OuterAngle < XM_PIDIV2;
+	if (viewLight.Spot)
+	{
+		XMStoreFloat3(&viewLight.Direction, XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&light.Direction), view)));
+		viewLight.CosOuter = cosf(light.OuterAngle);
+		viewLight.SinOuter = sinf(light.OuterAngle);
+	}
+
+	viewLight.FirstX = (unsigned char)firstX;
+	viewLight.LastX = (unsigned char)lastX;
+	viewLight.FirstY = (unsigned char)firstY;
+	viewLight.LastY = (unsigned char)lastY;
+	viewLight.FirstZ = (unsigned char)SliceOf(std::max(c.z - r, nearClip));
+	viewLight.LastZ = (unsigned char)SliceOf(std::min(c.z + r, farClip));
+}
+
+// Whether a sphere isn't entirely past either of a column's edges
+bool LightSystem::ColumnReached(int x, const XMFLOAT3 & center, float radius)
+{
+	float left = columnPlanes[x].x * center.x + columnPlanes[x].y * center.z;
+	float right = columnPlanes[x + 1].x * center.x + columnPlanes[x + 1].y * center.z;
+	return left >= -radius && right <= radius;
+}
+
+// The same for a row, whose top edge comes first
+bool LightSystem::RowReached(int y, const XMFLOAT3 & center, float radius)
+{
+	float top = rowPlanes[y].x * center.y + rowPlanes[y].y * center.z;
+	float bottom = rowPlanes[y + 1].x * center.y + rowPlanes[y + 1].y * center.z;
+	return top <= radius && bottom >= -radius;
+}
+
+// --------------------------------------------------------
+// Tests each light that reaches a slice against the
+// clusters in its range, four at a time, then sorts what
+// it found by cluster
+// --------------------------------------------------------
+void LightSystem::BinSlice(int slice)
+{
+	SliceBin& bin = sliceBins[slice];
+	bin.Entries.clear();
+
+	XMVECTOR zero = XMVectorZero();
+	for (unsigned int s = sliceLightOffsets[slice]; s < sliceLightOffsets[slice + 1]; s++)
+	{
+		unsigned int index = sliceLights[s];
+		const ViewLight& light = viewLights[index];
+		XMVECTOR cx = XMVectorReplicate(light.Center.x);
+		XMVECTOR cy = XMVectorReplicate(light.Center.y);
+		XMVECTOR cz = XMVectorReplicate(light.Center.z);
+		XMVECTOR radiusSq = XMVectorReplicate(light.Radius * light.Radius);
+
+		for (int y = light.FirstY; y <= light.LastY; y++)
+		{
+			int row = (slice * ClustersY + y) * ClustersX;
+
+			// Rows are a whole number of vectors wide
+			for (int x = light.FirstX & ~3; x <= light.LastX; x += 4)
+			{
+				int first = row + x;
+
+				// Squared distance from the center to each box
+				XMVECTOR dx = XMVectorMax(XMLoadFloat4((const XMFLOAT4*)&minX[first]) - cx, zero) + XMVectorMax(cx - XMLoadFloat4((const XMFLOAT4*)&maxX[first]), zero);
+				XMVECTOR dy = XMVectorMax(XMLoadFloat4((const XMFLOAT4*)&minY[first]) - cy, zero) + XMVectorMax(cy - XMLoadFloat4((const XMFLOAT4*)&maxY[first]), zero);
+				XMVECTOR dz = XMVectorMax(XMLoadFloat4((const XMFLOAT4*)&minZ[first]) - cz, zero) + XMVectorMax(cz - XMLoadFloat4((const XMFLOAT4*)&maxZ[first]), zero);
+				XMVECTOR distanceSq = dx * dx + dy * dy + dz * dz;
+				if (XMVector4Greater(distanceSq, radiusSq))
+					continue;
+
+				uint32_t hits[4];
+				XMStoreInt4(hits, XMVectorLessOrEqual(distanceSq, radiusSq));
+				for (int lane = 0; lane < 4; lane++)
+				{
+					int column = x + lane;
+					if (!hits[lane] || column < light.FirstX || column > light.LastX)
+						continue;
+					if (light.Spot && ConeMisses(light.Center, light.Direction, light.Radius, light.CosOuter, light.SinOuter, clusterSpheres[first + lane]))
+						continue;
+
+					SliceEntry entry = { (unsigned int)(y * ClustersX + column), index };
+					bin.Entries.push_back(entry);
+				}
+			}
+		}
+	}
+
+	// Counting sort by cluster keeps each cluster's lights in order
+	memset(bin.Counts, 0, sizeof(bin.Counts));
+	for (size_t i = 0; i < bin.Entries.size(); i++)
+		bin.Counts[bin.Entries[i].Cluster]++;
+
+	unsigned int next[SliceClusters];
+	unsigned int offset = 0;
+	for (int c = 0; c < SliceClusters; c++)
+	{
+		next[c] = offset;
+		offset += bin.Counts[c];
+	}
+
+	bin.Indices.resize(bin.Entries.size());
+	for (size_t i = 0; i < bin.Entries.size(); i++)
+		bin.Indices[next[bin.Entries[i].Cluster]++] = bin.Entries[i].Light;
+}
+
+// Copies a slice's indices into the packed list
+void LightSystem::PackSlice(int slice)
+{
+	const SliceBin& bin = sliceBins[slice];
+	unsigned int offset = bin.Offset;
+	for (int c = 0; c < SliceClusters; c++)
+	{
+		LightCluster& cluster = clusters[slice * SliceClusters + c];
+		cluster.Offset = offset;
+		cluster.Count = bin.Counts[c];
+		offset += bin.Counts[c];
+	}
+
+	if (!bin.Indices.empty())
+		memcpy(&lightIndices[bin.Offset], &bin.Indices[0], bin.Indices.size() * sizeof(unsigned int));
+}
+
+// The slice holding a view depth, as the pixel shader finds it
+int LightSystem::SliceOf(float depth)
+{
+	int slice = (int)floorf(logf(depth) * sliceScale + sliceBias);
+	return std::min(std::max(slice, 0), ClustersZ - 1);
+}
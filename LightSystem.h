@@ -0,0 +1,173 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+#include "JobSystem.h"
+
+enum class LightType
+{
+	Point,
+	Spot
+};
+
+// --------------------------------------------------------
+// A light as the game describes it.  Nothing is lit past
+// Range, and spot lights fade out between their inner and
+// outer cone angles (half angles, in radians).
+// --------------------------------------------------------
+struct Light
+{
+	LightType Type;
+	DirectX::XMFLOAT3 Position;
+	DirectX::XMFLOAT3 Color;
+	float Range;
+
+	// Spot lights only
+	DirectX::XMFLOAT3 Direction;
+	float InnerAngle;
+	float OuterAngle;
+};
+
+// --------------------------------------------------------
+// A light as the pixel shader reads it from its structured
+// buffer - must match ShaderLight in the HLSL, and the CPU
+// kernels read it as packed floats too.  The cone fades as
+// saturate(cos * SpotScale + SpotOffset), which is always
+// one for point lights.
+// --------------------------------------------------------
+struct ShaderLight
+{
+	DirectX::XMFLOAT3 Position;
+	float Range;
+	DirectX::XMFLOAT3 Color;
+	float SpotScale;
+	DirectX::XMFLOAT3 Direction;
+	float SpotOffset;
+};
+
+// Where a cluster's lights are in the index list
+struct LightCluster
+{
+	unsigned int Offset;
+	unsigned int Count;
+};
+
+// --------------------------------------------------------
+// Sorts lights into the clusters of the view frustum that
+// they can reach, so each pixel only shades its own few
+//
+// The frustum is cut into ClustersX x ClustersY screen
+// tiles and ClustersZ slices of view depth, spaced
+// exponentially between the near and far planes so the
+// clusters stay roughly cube shaped.  Each cluster keeps a
+// view space bounding box, rebuilt only when the
+// projection changes.
+//
+// Binning transforms the lights' bounding spheres to view
+// space, narrows each to the slices, columns and rows it
+// touches, and then tests it against four clusters at a
+// time.  Spot lights are also tested against each
+// cluster's bounding sphere with their cone.  Slices are
+// binned as separate jobs and then packed into one index
+// list, with the lights of each cluster kept in order.
+// --------------------------------------------------------
+class LightSystem
+{
+public:
+	static const int ClustersX = 16;
+	static const int ClustersY = 9;
+	static const int ClustersZ = 24;
+	static const int ClusterCount = ClustersX * ClustersY * ClustersZ;
+
+	LightSystem();
+	~LightSystem();
+
+	// Adds a light and returns its index
+	unsigned int Add(const Light& light);
+	void Set(unsigned int index, const Light& light);
+	const Light& Get(unsigned int index) { return lights[index]; }
+	void Clear();
+
+	size_t GetCount() { return lights.size(); }
+
+	// Bins every light for the given (transposed) camera
+	// matrices, spreading the work across the jobs if given
+	void Update(const DirectX::XMFLOAT4X4& view, const DirectX::XMFLOAT4X4& projection, JobSystem* jobs = 0);
+
+	// What the shaders read - valid until the next Update()
+	const std::vector<ShaderLight>& GetShaderLights() { return shaderLights; }
+	const std::vector<LightCluster>& GetClusters() { return clusters; }
+	const std::vector<unsigned int>& GetLightIndices() { return lightIndices; }
+
+	// A pixel's slice is floor(log(view depth) * scale + bias)
+	float GetSliceScale() { return sliceScale; }
+	float GetSliceBias() { return sliceBias; }
+
+private:
+	// A light's bounds in view space, and the clusters they
+	// might touch - an empty range if it can't be seen
+	struct ViewLight
+	{
+		DirectX::XMFLOAT3 Center;
+		float Radius;
+		DirectX::XMFLOAT3 Direction;
+		float CosOuter;
+		float SinOuter;
+		bool Spot;
+		unsigned char FirstX, LastX;
+		unsigned char FirstY, LastY;
+		unsigned char FirstZ, LastZ;
+	};
+
+	// One light reaching one cluster of a slice
+	struct SliceEntry
+	{
+		unsigned int Cluster;
+		unsigned int Light;
+	};
+
+	// What one slice's job found, before it is packed
+	struct SliceBin
+	{
+		std::vector<SliceEntry> Entries;
+		std::vector<unsigned int> Indices;
+		unsigned int Counts[ClustersX * ClustersY];
+		unsigned int Offset;
+	};
+
+	std::vector<Light> lights;
+	std::vector<ShaderLight> shaderLights;
+
+	// Cluster bounds, one component per array, in cluster order
+	std::vector<float> minX, minY, minZ;
+	std::vector<float> maxX, maxY, maxZ;
+	std::vector<DirectX::XMFLOAT4> clusterSpheres;
+
+	// The planes through the eye along each column and row
+	// edge, as unit (x, z) and (y, z) normals
+	DirectX::XMFLOAT2 columnPlanes[ClustersX + 1];
+	DirectX::XMFLOAT2 rowPlanes[ClustersY + 1];
+	float nearClip;
+	float farClip;
+	float sliceScale;
+	float sliceBias;
+	DirectX::XMFLOAT4X4 builtProjection;
+	bool clustersBuilt;
+
+	// Binning
+	std::vector<ViewLight> viewLights;
+	std::vector<unsigned int> sliceLightOffsets;
+	std::vector<unsigned int> sliceLights;
+	std::vector<SliceBin> sliceBins;
+
+	// Output
+	std::vector<LightCluster> clusters;
+	std::vector<unsigned int> lightIndices;
+
+	void BuildClusters(const DirectX::XMFLOAT4X4& projection);
+	void PrepareLight(unsigned int index, const DirectX::XMMATRIX& view);
+	bool ColumnReached(int x, const DirectX::XMFLOAT3& center, float radius);
+	bool RowReached(int y, const DirectX::XMFLOAT3& center, float radius);
+	void BinSlice(int slice);
+	void PackSlice(int slice);
+	int SliceOf(float depth);
+};
@@ -1,6 +1,7 @@
 
 #include <Windows.h>
 #include "Game.h"
+#include <cstring>
 
 // --------------------------------------------------------
 // Entry point for a graphical (non-console) Windows application
@@ -35,6 +36,14 @@ int WINAPI WinMain(
 	hr = dxGame.InitDirectX();
 	if(FAILED(hr)) return hr;
 
+	// "-prewarm" fills the asset cache and exits without
+	// running the game, so the next launch starts warm
+	if (strstr(lpCmdLine, "-prewarm"))
+	{
+		dxGame.Init();
+		return 0;
+	}
+
 	// Begin the message and game loop, and then return
 	// whatever we get back once the game loop is over
 	return dxGame.Run();
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+
+// --------------------------------------------------------
+// A read-only view of a whole file, mapped into memory
+//
+// Pages are only read from disk when they're touched, and
+// the data can be handed straight to buffer and texture
+// creation without copying it out first.
+// --------------------------------------------------------
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	// Maps the file, closing whatever was open before
+	bool Open(const char* file);
+	void Close();
+
+	// Null for an empty or unopened file
+	const void* GetData() const { return data; }
+	size_t GetSize() const { return size; }
+
+private:
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	const void* data;
+	size_t size;
+
+	// The file and mapping handles on Windows
+	void* fileHandle;
+	void* mappingHandle;
+};
\ No newline at end of file
@@ -1,200 +1,159 @@
 #include "Mesh.h"
+#include "FrameProfiler.h"
+#include "ObjLoader.h"
+#include "TangentGenerator.h"
 #include <DirectXMath.h>
+#include <cstdio>
+#include <string>
 #include <vector>
-#include <fstream>
 
 using namespace DirectX;
 
+namespace
+{
+	// Bumped whenever loading or tangent generation changes
+	// what ends up in the buffers, so cached meshes rebuild
+	const unsigned int MeshBlobVersion = 1;
+
+	// --------------------------------------------------------
+	// Start of a cached mesh, followed by the vertices and
+	// then the indices in the format they're drawn with
+	// --------------------------------------------------------
+	struct MeshBlobHeader
+	{
+		int NumVerts;
+		int NumIndices;
+		int Format;
+		int Padding;
+		BoundingBox Box;
+		BoundingSphere Sphere;
+	};
+}
 
-Mesh::Mesh(Vertex * vertexArray, int numVerts, unsigned int * indexArray, int numIndices, ID3D11Device * device)
+
+Mesh::Mesh(Vertex * vertexArray, int numVerts, unsigned int * indexArray, int numIndices, GeometryBackend * backend)
 {
-	CreateBuffers(vertexArray, numVerts, indexArray, numIndices, device);
+	this->backend = backend;
+	vertexBuffer = 0;
+	indexBuffer = 0;
+	this->numIndices = 0;
+	indexFormat = IndexFormat::UInt32;
+
+	// No triangles means nothing to put in a buffer
+	if (numIndices <= 0)
+		return;
+
+	MeshData data;
+	PrepareData(vertexArray, numVerts, indexArray, numIndices, data);
+	CreateBuffers(data);
 }
 
-Mesh::Mesh(const char * objFile, ID3D11Device * device)
+Mesh::Mesh(const char * objFile, GeometryBackend * backend, AssetCache * cache)
 {
-	// File input object
-	std::ifstream obj(objFile);
+	this->backend = backend;
+	vertexBuffer = 0;
+	indexBuffer = 0;
+	numIndices = 0;
+	indexFormat = IndexFormat::UInt32;
+
+	MeshData data;
+	if (LoadObj(objFile, cache, data))
+		CreateBuffers(data);
+}
 
-	// Check for successful open
-	if (!obj.is_open())
-	{
-		// Check the debug folder
-		char debugFolder[256] = {};
-		strcat_s(debugFolder, "Debug/");
-		strcat_s(debugFolder, objFile);
+Mesh::Mesh(const MeshData & data, GeometryBackend * backend)
+{
+	this->backend = backend;
+	vertexBuffer = 0;
+	indexBuffer = 0;
+	numIndices = 0;
+	indexFormat = IndexFormat::UInt32;
+
+	if (data.NumIndices > 0)
+		CreateBuffers(data);
+}
 
-		// Attempt to open again
-		obj.open(debugFolder);
 
-		// If not found, give up
-		if (!obj.is_open())
-			return;
+bool Mesh::LoadObj(const char * objFile, AssetCache * cache, MeshData & data, JobSystem * jobs)
+{
+	PROFILE_SCOPE("Mesh::LoadObj");
+
+	// Check for the file, then the debug folder, and if not found, give up
+	MappedFile source;
+	if (!source.Open(objFile))
+	{
+		std::string debugFolder = std::string("Debug/") + objFile;
+		if (!source.Open(debugFolder.c_str()))
+			return false;
 	}
 
-	// Variables used while reading the file
-	std::vector<XMFLOAT3> positions;     // Positions from the file
-	std::vector<XMFLOAT3> normals;       // Normals from the file
-	std::vector<XMFLOAT2> uvs;           // UVs from the file
-	std::vector<Vertex> verts;           // Verts we're assembling
-	std::vector<UINT> indices;           // Indices of these verts
-	unsigned int vertCounter = 0;        // Count of vertices/indices
-	char chars[100];                     // String for line reading
-
-										 // Still have data left?
-	while (obj.good())
+	// Keyed on the file's contents, so edits are picked up
+	std::string blobName = std::string("mesh_") + objFile;
+	unsigned long long key = AssetCache::Hash(source.GetData(), source.GetSize(), AssetCache::HashValue(MeshBlobVersion));
+	if (cache && cache->Load(blobName.c_str(), key, data.Blob) && ReadBlob(data))
+		return true;
+
+	// Verts and indices we're assembling
+	std::vector<Vertex>& verts = data.VertexStorage;
+	std::vector<unsigned int>& indices = data.IndexStorage;
 	{
-		// Get the line (100 characters should be more than enough)
-		obj.getline(chars, 100);
+		PROFILE_SCOPE("Parse OBJ");
+		ObjLoader::Parse((const char*)source.GetData(), source.GetSize(), verts, indices);
+	}
+	source.Close();
 
-		// Check the type of line
-		if (chars[0] == 'v' && chars[1] == 'n')
-		{
-			// Read the 3 numbers directly into an XMFLOAT3
-			XMFLOAT3 norm;
-			sscanf_s(
-				chars,
-				"vn %f %f %f",
-				&norm.x, &norm.y, &norm.z);
-
-			// Add to the list of normals
-			normals.push_back(norm);
-		}
-		else if (chars[0] == 'v' && chars[1] == 't')
-		{
-			// Read the 2 numbers directly into an XMFLOAT2
-			XMFLOAT2 uv;
-			sscanf_s(
-				chars,
-				"vt %f %f",
-				&uv.x, &uv.y);
-
-			// Add to the list of uv's
-			uvs.push_back(uv);
-		}
-		else if (chars[0] == 'v')
-		{
-			// Read the 3 numbers directly into an XMFLOAT3
-			XMFLOAT3 pos;
-			sscanf_s(
-				chars,
-				"v %f %f %f",
-				&pos.x, &pos.y, &pos.z);
-
-			// Add to the positions
-			positions.push_back(pos);
-		}
-		else if (chars[0] == 'f')
+	// Nothing to put in a buffer
+	if (indices.empty())
+		return false;
+
+	PrepareData(&verts[0], (int)verts.size(), &indices[0], (int)indices.size(), data, jobs);
+
+	// Save the finished mesh, with indices as they'll go to the buffer
+	if (cache)
+	{
+		MeshBlobHeader header = {};
+		header.NumVerts = data.NumVerts;
+		header.NumIndices = data.NumIndices;
+		header.Format = (int)data.Format;
+		header.Box = data.Box;
+		header.Sphere = data.Sphere;
+
+		AssetChunk chunks[3] =
 		{
-			// Read the face indices into an array
-			unsigned int i[12];
-			int facesRead = sscanf_s(
-				chars,
-				"f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d",
-				&i[0], &i[1], &i[2],
-				&i[3], &i[4], &i[5],
-				&i[6], &i[7], &i[8],
-				&i[9], &i[10], &i[11]);
-
-			// - Create the verts by looking up
-			//    corresponding data from vectors
-			// - OBJ File indices are 1-based, so
-			//    they need to be adusted
-			Vertex v1;
-			v1.Position = positions[i[0] - 1];
-			v1.UV = uvs[i[1] - 1];
-			v1.Normal = normals[i[2] - 1];
-
-			Vertex v2;
-			v2.Position = positions[i[3] - 1];
-			v2.UV = uvs[i[4] - 1];
-			v2.Normal = normals[i[5] - 1];
-
-			Vertex v3;
-			v3.Position = positions[i[6] - 1];
-			v3.UV = uvs[i[7] - 1];
-			v3.Normal = normals[i[8] - 1];
-
-			// The model is most likely in a right-handed space,
-			// especially if it came from Maya.  We want to convert
-			// to a left-handed space for DirectX.  This means we 
-			// need to:
-			//  - Invert the Z position
-			//  - Invert the normal's Z
-			//  - Flip the winding order
-			// We also need to flip the UV coordinate since DirectX
-			// defines (0,0) as the top left of the texture, and many
-			// 3D modeling packages use the bottom left as (0,0)
-
-			// Flip the UV's since they're probably "upside down"
-			v1.UV.y = 1.0f - v1.UV.y;
-			v2.UV.y = 1.0f - v2.UV.y;
-			v3.UV.y = 1.0f - v3.UV.y;
-
-			// Flip Z (LH vs. RH)
-			v1.Position.z *= -1.0f;
-			v2.Position.z *= -1.0f;
-			v3.Position.z *= -1.0f;
-
-			// Flip normal Z
-			v1.Normal.z *= -1.0f;
-			v2.Normal.z *= -1.0f;
-			v3.Normal.z *= -1.0f;
-
-			// Add the verts to the vector (flipping the winding order)
-			verts.push_back(v1);
-			verts.push_back(v3);
-			verts.push_back(v2);
-
-			// Add three more indices
-			indices.push_back(vertCounter); vertCounter += 1;
-			indices.push_back(vertCounter); vertCounter += 1;
-			indices.push_back(vertCounter); vertCounter += 1;
-
-			// Was there a 4th face?
-			if (facesRead == 12)
-			{
-				// Make the last vertex
-				Vertex v4;
-				v4.Position = positions[i[9] - 1];
-				v4.UV = uvs[i[10] - 1];
-				v4.Normal = normals[i[11] - 1];
-
-				// Flip the UV, Z pos and normal
-				v4.UV.y = 1.0f - v4.UV.y;
-				v4.Position.z *= -1.0f;
-				v4.Normal.z *= -1.0f;
-
-				// Add a whole triangle (flipping the winding order)
-				verts.push_back(v1);
-				verts.push_back(v4);
-				verts.push_back(v3);
-
-				// Add three more indices
-				indices.push_back(vertCounter); vertCounter += 1;
-				indices.push_back(vertCounter); vertCounter += 1;
-				indices.push_back(vertCounter); vertCounter += 1;
-			}
-		}
+			{ &header, sizeof(header) },
+			{ data.Verts, data.NumVerts * sizeof(Vertex) },
+			{ data.Indices, data.NumIndices * (data.Format == IndexFormat::UInt16 ? sizeof(unsigned short) : sizeof(unsigned int)) }
+		};
+		cache->Store(blobName.c_str(), key, chunks, 3);
 	}
 
-	// Close the file and create the actual buffers
-	obj.close();
-	CreateBuffers(&verts[0], vertCounter, &indices[0], vertCounter, device);
+#if defined(DEBUG) || defined(_DEBUG)
+	// Compare against one vertex per corner and 32-bit indices
+	size_t unweldedBytes = indices.size() * (sizeof(Vertex) + sizeof(unsigned int));
+	size_t weldedBytes = verts.size() * sizeof(Vertex) +
+		indices.size() * (data.Format == IndexFormat::UInt16 ? sizeof(unsigned short) : sizeof(unsigned int));
+	printf("\n%s: %u verts (%u before welding), %u bytes saved",
+		objFile,
+		(unsigned int)verts.size(),
+		(unsigned int)indices.size(),
+		(unsigned int)(unweldedBytes - weldedBytes));
+#endif
+	return true;
 }
 
 
 Mesh::~Mesh()
 {
-
+	backend->ReleaseBuffer(vertexBuffer);
+	backend->ReleaseBuffer(indexBuffer);
 }
 
-ID3D11Buffer * Mesh::GetVertexBuffer()
+GeometryHandle Mesh::GetVertexBuffer()
 {
 	return vertexBuffer;
 }
 
-ID3D11Buffer * Mesh::GetIndexBuffer()
+GeometryHandle Mesh::GetIndexBuffer()
 {
 	return indexBuffer;
 }
@@ -204,107 +163,80 @@ int Mesh::GetIndexCount()
 	return numIndices;
 }
 
-void Mesh::CalculateTangents(Vertex * vertexArray, int numVerts, unsigned int * indexArray, int numIndices)
+IndexFormat Mesh::GetIndexFormat()
 {
-	// Reset tangents
-	for (int i = 0; i < numVerts; i++)
-	{
-		vertexArray[i].Tangent = XMFLOAT3(0, 0, 0);
-	}
+	return indexFormat;
+}
 
-	// Calculate tangents one whole triangle at a time
-	for (int i = 0; i < numVerts;)
-	{
-		// Grab indices and vertices of first triangle
-		unsigned int i1 = indexArray[i++];
-		unsigned int i2 = indexArray[i++];
-		unsigned int i3 = indexArray[i++];
-		Vertex* v1 = &vertexArray[i1];
-		Vertex* v2 = &vertexArray[i2];
-		Vertex* v3 = &vertexArray[i3];
-
-		// Calculate vectors relative to triangle positions
-		float x1 = v2->Position.x - v1->Position.x;
-		float y1 = v2->Position.y - v1->Position.y;
-		float z1 = v2->Position.z - v1->Position.z;
-
-		float x2 = v3->Position.x - v1->Position.x;
-		float y2 = v3->Position.y - v1->Position.y;
-		float z2 = v3->Position.z - v1->Position.z;
-
-		// Do the same for vectors relative to triangle uv's
-		float s1 = v2->UV.x - v1->UV.x;
-		float t1 = v2->UV.y - v1->UV.y;
-
-		float s2 = v3->UV.x - v1->UV.x;
-		float t2 = v3->UV.y - v1->UV.y;
-
-		// Create vectors for tangent calculation
-		float r = 1.0f / (s1 * t2 - s2 * t1);
-
-		float tx = (t2 * x1 - t1 * x2) * r;
-		float ty = (t2 * y1 - t1 * y2) * r;
-		float tz = (t2 * z1 - t1 * z2) * r;
-
-		// Adjust tangents of each vert of the triangle
-		v1->Tangent.x += tx;
-		v1->Tangent.y += ty;
-		v1->Tangent.z += tz;
-
-		v2->Tangent.x += tx;
-		v2->Tangent.y += ty;
-		v2->Tangent.z += tz;
-
-		v3->Tangent.x += tx;
-		v3->Tangent.y += ty;
-		v3->Tangent.z += tz;
-	}
+// --------------------------------------------------------
+// Tangents, bounds and index width for a freshly built mesh.
+// Tangents are written into the vertex array in place.
+// --------------------------------------------------------
+void Mesh::PrepareData(Vertex * vertexArray, int numVerts, unsigned int * indexArray, int numIndices, MeshData & data, JobSystem * jobs)
+{
+	PROFILE_SCOPE("Mesh::PrepareData");
 
-	// Ensure all of the tangents are orthogonal to the normals
-	for (int i = 0; i < numVerts; i++)
-	{
-		// Grab the two vectors
-		XMVECTOR normal = XMLoadFloat3(&vertexArray[i].Normal);
-		XMVECTOR tangent = XMLoadFloat3(&vertexArray[i].Tangent);
+	TangentGenerator::Generate(vertexArray, numVerts, indexArray, numIndices, jobs);
 
-		// Use Gram-Schmidt orthogonalize
-		tangent = XMVector3Normalize(
-			tangent - normal * XMVector3Dot(normal, tangent));
+	// Bounds for culling
+	BoundingBox::CreateFromPoints(data.Box, numVerts, &vertexArray[0].Position, sizeof(Vertex));
+	BoundingSphere::CreateFromPoints(data.Sphere, numVerts, &vertexArray[0].Position, sizeof(Vertex));
 
-		// Store the tangent
-		XMStoreFloat3(&vertexArray[i].Tangent, tangent);
+	data.Verts = vertexArray;
+	data.NumVerts = numVerts;
+	data.NumIndices = numIndices;
+
+	// Use 16-bit indices when every vertex can be addressed with them
+	if (numVerts <= 0xFFFF)
+	{
+		data.ShortIndexStorage.assign(indexArray, indexArray + numIndices);
+		data.Indices = data.ShortIndexStorage.data();
+		data.Format = IndexFormat::UInt16;
+	}
+	else
+	{
+		data.Indices = indexArray;
+		data.Format = IndexFormat::UInt32;
 	}
 }
 
-void Mesh::CreateBuffers(Vertex * vertexArray, int numVerts, unsigned int * indexArray, int numIndices, ID3D11Device * device)
+// --------------------------------------------------------
+// Points the data into its cached blob - returns false if
+// the blob doesn't hold what its header says
+// --------------------------------------------------------
+bool Mesh::ReadBlob(MeshData & data)
 {
-	// Calculate the tangents before copying to buffer
-	CalculateTangents(vertexArray, numVerts, indexArray, numIndices);
-
-	// Create the vertex buffer
-	D3D11_BUFFER_DESC vbd;
-	vbd.Usage = D3D11_USAGE_IMMUTABLE;
-	vbd.ByteWidth = sizeof(Vertex) * numVerts; // Number of vertices
-	vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-	vbd.CPUAccessFlags = 0;
-	vbd.MiscFlags = 0;
-	vbd.StructureByteStride = 0;
-	D3D11_SUBRESOURCE_DATA initialVertexData;
-	initialVertexData.pSysMem = vertexArray;
-	device->CreateBuffer(&vbd, &initialVertexData, &vertexBuffer);
-
-	// Create the index buffer
-	D3D11_BUFFER_DESC ibd;
-	ibd.Usage = D3D11_USAGE_IMMUTABLE;
-	ibd.ByteWidth = sizeof(unsigned int) * numIndices; // Number of indices
-	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
-	ibd.CPUAccessFlags = 0;
-	ibd.MiscFlags = 0;
-	ibd.StructureByteStride = 0;
-	D3D11_SUBRESOURCE_DATA initialIndexData;
-	initialIndexData.pSysMem = indexArray;
-	device->CreateBuffer(&ibd, &initialIndexData, &indexBuffer);
-
-	// Save the indices
-	this->numIndices = numIndices;
+	const AssetBlob& blob = data.Blob;
+	if (blob.GetSize() < sizeof(MeshBlobHeader))
+		return false;
+
+	const MeshBlobHeader* header = (const MeshBlobHeader*)blob.GetData();
+	size_t indexSize = header->Format == (int)IndexFormat::UInt16 ? sizeof(unsigned short) : sizeof(unsigned int);
+	if (header->NumVerts <= 0 || header->NumIndices <= 0 ||
+		blob.GetSize() != sizeof(MeshBlobHeader) + header->NumVerts * sizeof(Vertex) + header->NumIndices * indexSize)
+		return false;
+
+	data.Verts = (const Vertex*)(header + 1);
+	data.Indices = data.Verts + header->NumVerts;
+	data.NumVerts = header->NumVerts;
+	data.NumIndices = header->NumIndices;
+	data.Format = (IndexFormat)header->Format;
+	data.Box = header->Box;
+	data.Sphere = header->Sphere;
+	return true;
 }
+
+void Mesh::CreateBuffers(const MeshData & data)
+{
+	PROFILE_SCOPE("Mesh::CreateBuffers");
+
+	// Create the vertex and index buffers
+	vertexBuffer = backend->CreateVertexBuffer(data.Verts, data.NumVerts);
+	indexBuffer = backend->CreateIndexBuffer(data.Indices, data.NumIndices, data.Format);
+
+	// Save the indices and bounds
+	numIndices = data.NumIndices;
+	indexFormat = data.Format;
+	boundingBox = data.Box;
+	boundingSphere = data.Sphere;
+}
\ No newline at end of file
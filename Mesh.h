@@ -1,25 +1,73 @@
 #pragma once
-#include "DXCore.h"
 #include "Vertex.h"
+#include "GeometryBackend.h"
+#include "AssetCache.h"
+#include <DirectXCollision.h>
+#include <vector>
+
+class JobSystem;
+
+// --------------------------------------------------------
+// A finished mesh waiting for its buffers
+//
+// Verts and Indices point either into the storage vectors
+// or straight into a cached blob.
+// --------------------------------------------------------
+struct MeshData
+{
+	const Vertex* Verts;
+	const void* Indices;
+	int NumVerts;
+	int NumIndices;
+	IndexFormat Format;
+	DirectX::BoundingBox Box;
+	DirectX::BoundingSphere Sphere;
+
+	std::vector<Vertex> VertexStorage;
+	std::vector<unsigned int> IndexStorage;
+	std::vector<unsigned short> ShortIndexStorage;
+	AssetBlob Blob;
+
+	MeshData() : Verts(0), Indices(0), NumVerts(0), NumIndices(0), Format(IndexFormat::UInt32) {}
+};
 
 class Mesh
 {
 public:
-	Mesh(Vertex* vertexArray, int numVerts, unsigned int * indexArray, int numIndices, ID3D11Device* device);
-	Mesh(const char* objFile, ID3D11Device* device);
+	Mesh(Vertex* vertexArray, int numVerts, unsigned int * indexArray, int numIndices, GeometryBackend* backend);
+	// With a cache, the welded, tangent-space mesh is stored
+	// the first time and mapped straight into buffers after
+	Mesh(const char* objFile, GeometryBackend* backend, AssetCache* cache = 0);
+	Mesh(const MeshData& data, GeometryBackend* backend);
 	~Mesh();
 
-	ID3D11Buffer* GetVertexBuffer();
-	ID3D11Buffer* GetIndexBuffer();
+	// Everything up to buffer creation, which needs no graphics
+	// API and so can run on any thread - returns false if the
+	// file can't be read or holds no triangles.  Given a job
+	// system, tangents are built across its threads.
+	static bool LoadObj(const char* objFile, AssetCache* cache, MeshData& data, JobSystem* jobs = 0);
+
+	GeometryHandle GetVertexBuffer();
+	GeometryHandle GetIndexBuffer();
 	int GetIndexCount();
+	IndexFormat GetIndexFormat();
+
+	// Object space bounds, worked out when the mesh is created
+	const DirectX::BoundingBox& GetBoundingBox() { return boundingBox; }
+	const DirectX::BoundingSphere& GetBoundingSphere() { return boundingSphere; }
 
 private:
-	ID3D11Buffer* vertexBuffer;
-	ID3D11Buffer* indexBuffer;
+	GeometryBackend* backend;
+	GeometryHandle vertexBuffer;
+	GeometryHandle indexBuffer;
 	int numIndices;
+	IndexFormat indexFormat;
+	DirectX::BoundingBox boundingBox;
+	DirectX::BoundingSphere boundingSphere;
 
-	void CalculateTangents(Vertex* vertexArray, int numVerts, unsigned int* indexArray, int numIndices);
-	void CreateBuffers(Vertex* vertexArray, int numVerts, unsigned int * indexArray, int numIndices, ID3D11Device* device);
+	static void PrepareData(Vertex* vertexArray, int numVerts, unsigned int* indexArray, int numIndices, MeshData& data, JobSystem* jobs = 0);
+	static bool ReadBlob(MeshData& data);
+	void CreateBuffers(const MeshData& data);
 
 
 };
@@ -0,0 +1,509 @@
+#include "ObjLoader.h"
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+using namespace DirectX;
+
+namespace
+{
+	// Powers of ten for the fractional part of a number
+	const double PowersOfTen[] =
+	{
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+		1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18
+	};
+
+	inline bool IsSpace(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+	inline bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+
+	inline const char* SkipSpaces(const char* p, const char* end)
+	{
+		while (p < end && IsSpace(*p))
+			p++;
+		return p;
+	}
+
+	inline const char* SkipToken(const char* p, const char* end)
+	{
+		while (p < end && !IsSpace(*p))
+			p++;
+		return p;
+	}
+
+	inline const char* FindLineEnd(const char* p, const char* end)
+	{
+		const char* lineEnd = (const char*)memchr(p, '\n', end - p);
+		return lineEnd ? lineEnd : end;
+	}
+
+	// --------------------------------------------------------
+	// Reads a decimal number (with optional sign, fraction and
+	// exponent) starting at p.  Returns the first unread character.
+	// --------------------------------------------------------
+	const char* ParseFloat(const char* p, const char* end, float& out)
+	{
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+'))
+		{
+			negative = (*p == '-');
+			p++;
+		}
+
+		// Past 18 digits the rest of the integer part only
+		// moves the decimal point
+		double value = 0.0;
+		int exponent = 0;
+		int digits = 0;
+		while (p < end && IsDigit(*p))
+		{
+			if (digits < 18)
+			{
+				value = value * 10.0 + (*p - '0');
+				if (value > 0.0)
+					digits++;
+			}
+			else
+				exponent++;
+			p++;
+		}
+
+		if (p < end && *p == '.')
+		{
+			p++;
+			double fraction = 0.0;
+			int fractionDigits = 0;
+			while (p < end && IsDigit(*p))
+			{
+				// Anything past 18 digits is below float precision anyway
+				if (fractionDigits < 18)
+				{
+					fraction = fraction * 10.0 + (*p - '0');
+					fractionDigits++;
+				}
+				p++;
+			}
+			value += fraction / PowersOfTen[fractionDigits];
+		}
+
+		if (p < end && (*p == 'e' || *p == 'E'))
+		{
+			p++;
+			bool negativeExp = false;
+			if (p < end && (*p == '-' || *p == '+'))
+			{
+				negativeExp = (*p == '-');
+				p++;
+			}
+
+			// Saturates - anything this big is out of range anyway
+			int fileExponent = 0;
+			while (p < end && IsDigit(*p))
+			{
+				if (fileExponent < 1000)
+					fileExponent = fileExponent * 10 + (*p - '0');
+				p++;
+			}
+			exponent += negativeExp ? -fileExponent : fileExponent;
+		}
+
+		// The mantissa is between 1e-18 and 1e19 when it isn't zero,
+		// so past +/-300 the result is already out of float range and
+		// the scale stays finite.  Zero stays zero whatever the exponent.
+		if (value != 0.0 && exponent != 0)
+		{
+			if (exponent > 300) exponent = 300;
+			if (exponent < -300) exponent = -300;
+
+			int magnitude = exponent < 0 ? -exponent : exponent;
+			double scale = 1.0;
+			while (magnitude >= 18) { scale *= PowersOfTen[18]; magnitude -= 18; }
+			scale *= PowersOfTen[magnitude];
+			value = exponent < 0 ? value / scale : value * scale;
+		}
+
+		// Converting a double beyond float range is undefined
+		if (value > FLT_MAX)
+			out = negative ? -HUGE_VALF : HUGE_VALF;
+		else
+			out = (float)(negative ? -value : value);
+		return p;
+	}
+
+	// --------------------------------------------------------
+	// Reads a signed integer starting at p.  Values too big for
+	// an int saturate, so they can never wrap around into a
+	// valid index.
+	// --------------------------------------------------------
+	const char* ParseInt(const char* p, const char* end, int& out)
+	{
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+'))
+		{
+			negative = (*p == '-');
+			p++;
+		}
+
+		int value = 0;
+		while (p < end && IsDigit(*p))
+		{
+			int digit = *p++ - '0';
+			if (value > (INT_MAX - digit) / 10)
+				value = INT_MAX;
+			else
+				value = value * 10 + digit;
+		}
+
+		out = negative ? -value : value;
+		return p;
+	}
+
+	// --------------------------------------------------------
+	// Hashes three 32-bit values.  Float bit patterns and small
+	// ids differ mostly in a few bits, so everything is folded
+	// through a 64-bit finalizer to spread them over the table.
+	// --------------------------------------------------------
+	inline size_t MixHash(unsigned int a, unsigned int b, unsigned int c)
+	{
+		unsigned long long h = ((unsigned long long)a << 32 | b) ^ ((unsigned long long)c * 0x9E3779B97F4A7C15ULL);
+		h ^= h >> 33;
+		h *= 0xFF51AFD7ED558CCDULL;
+		h ^= h >> 33;
+		h *= 0xC4CEB9FE1A85EC53ULL;
+		h ^= h >> 33;
+		return (size_t)h;
+	}
+
+	// --------------------------------------------------------
+	// Key to index map with open addressing.  Every key goes in
+	// once and nothing is removed, so entries sit in one flat
+	// array instead of a node per key - most lookups touch a
+	// single cache line.  Kept at most half full.
+	// --------------------------------------------------------
+	template<typename Key, typename Hash>
+	class FlatTable
+	{
+	public:
+		FlatTable() : count(0) { Resize(64); }
+
+		void Reserve(size_t keys)
+		{
+			size_t size = slots.size();
+			while (size < keys * 2)
+				size *= 2;
+			if (size != slots.size())
+				Resize(size);
+		}
+
+		// Returns the index stored for the key, or inserts the
+		// given one and returns that
+		unsigned int FindOrInsert(const Key& key, unsigned int index)
+		{
+			size_t mask = slots.size() - 1;
+			for (size_t i = Hash()(key) & mask;; i = (i + 1) & mask)
+			{
+				Slot& slot = slots[i];
+				if (slot.Index == Empty)
+				{
+					slot.Entry = key;
+					slot.Index = index;
+					if (++count * 2 > slots.size())
+						Resize(slots.size() * 2);
+					return index;
+				}
+				if (slot.Entry == key)
+					return slot.Index;
+			}
+		}
+
+	private:
+		static const unsigned int Empty = 0xFFFFFFFF;
+
+		struct Slot
+		{
+			Key Entry;
+			unsigned int Index;
+		};
+
+		std::vector<Slot> slots;
+		size_t count;
+
+		void Resize(size_t size)
+		{
+			std::vector<Slot> old(size);
+			old.swap(slots);
+			for (size_t i = 0; i < slots.size(); i++)
+				slots[i].Index = Empty;
+
+			size_t mask = size - 1;
+			for (size_t i = 0; i < old.size(); i++)
+			{
+				if (old[i].Index == Empty)
+					continue;
+				size_t j = Hash()(old[i].Entry) & mask;
+				while (slots[j].Index != Empty)
+					j = (j + 1) & mask;
+				slots[j] = old[i];
+			}
+		}
+	};
+
+	// --------------------------------------------------------
+	// Exact bit pattern of a position, uv or normal from the file
+	// --------------------------------------------------------
+	struct ValueKey
+	{
+		unsigned int X;
+		unsigned int Y;
+		unsigned int Z;
+
+		bool operator==(const ValueKey& other) const
+		{
+			return X == other.X && Y == other.Y && Z == other.Z;
+		}
+	};
+
+	struct ValueKeyHash
+	{
+		size_t operator()(const ValueKey& key) const
+		{
+			return MixHash(key.X, key.Y, key.Z);
+		}
+	};
+
+	// --------------------------------------------------------
+	// One channel (v, vt or vn) of the file.  Exporters often write
+	// the same normal or uv once per corner, so identical values
+	// share an id - otherwise no two corners would ever weld.
+	// --------------------------------------------------------
+	struct Channel
+	{
+		std::vector<XMFLOAT3> Values;   // Unique values
+		std::vector<int> Ids;           // File order -> unique value
+		FlatTable<ValueKey, ValueKeyHash> Lookup;
+
+		void Reserve(size_t count)
+		{
+			Ids.reserve(count);
+			Lookup.Reserve(count);
+		}
+
+		void Add(const XMFLOAT3& value)
+		{
+			ValueKey key;
+			memcpy(&key.X, &value.x, sizeof(float));
+			memcpy(&key.Y, &value.y, sizeof(float));
+			memcpy(&key.Z, &value.z, sizeof(float));
+
+			int id = (int)Lookup.FindOrInsert(key, (unsigned int)Values.size());
+			if (id == (int)Values.size())
+				Values.push_back(value);
+			Ids.push_back(id);
+		}
+
+		// Turns a 1-based (or negative, relative) OBJ index into
+		// a unique value id.  Returns -1 for missing or invalid indices.
+		int Resolve(int index) const
+		{
+			size_t count = Ids.size();
+			if (index > 0 && (size_t)index <= count)
+				return Ids[index - 1];
+			if (index < 0 && (size_t)(-index) <= count)
+				return Ids[count + index];
+			return -1;
+		}
+	};
+
+	// --------------------------------------------------------
+	// A face corner's (position, uv, normal) value ids - corners
+	// with the same triple share one output vertex
+	// --------------------------------------------------------
+	struct CornerKey
+	{
+		int Position;
+		int UV;
+		int Normal;
+
+		bool operator==(const CornerKey& other) const
+		{
+			return Position == other.Position && UV == other.UV && Normal == other.Normal;
+		}
+	};
+
+	struct CornerKeyHash
+	{
+		size_t operator()(const CornerKey& key) const
+		{
+			return MixHash((unsigned int)key.Position, (unsigned int)key.UV, (unsigned int)key.Normal);
+		}
+	};
+}
+
+// --------------------------------------------------------
+// Reads the whole file into memory and parses it
+// --------------------------------------------------------
+bool ObjLoader::Load(const char * objFile, std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+{
+	std::ifstream obj(objFile, std::ios::binary | std::ios::ate);
+	if (!obj.is_open())
+		return false;
+
+	// Grab the whole file with a single read
+	std::streamoff size = obj.tellg();
+	std::vector<char> data((size_t)size);
+	obj.seekg(0, std::ios::beg);
+	if (size > 0)
+		obj.read(&data[0], size);
+	obj.close();
+
+	Parse(data.empty() ? 0 : &data[0], data.size(), verts, indices);
+	return true;
+}
+
+// --------------------------------------------------------
+// Builds the vertex and index arrays from OBJ text
+// --------------------------------------------------------
+void ObjLoader::Parse(const char * data, size_t size, std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+{
+	const char* end = data + size;
+
+	// Counting pass - find out how big everything will be
+	size_t positionCount = 0;
+	size_t uvCount = 0;
+	size_t normalCount = 0;
+	size_t triangleCount = 0;
+	for (const char* p = data; p < end;)
+	{
+		p = SkipSpaces(p, end);
+		const char* lineEnd = FindLineEnd(p, end);
+
+		if (lineEnd - p > 1 && p[0] == 'v')
+		{
+			if (IsSpace(p[1])) positionCount++;
+			else if (p[1] == 't') uvCount++;
+			else if (p[1] == 'n') normalCount++;
+		}
+		else if (lineEnd - p > 1 && p[0] == 'f' && IsSpace(p[1]))
+		{
+			// Each corner past the second adds a triangle
+			int corners = 0;
+			for (const char* t = SkipSpaces(p + 1, lineEnd); t < lineEnd; t = SkipSpaces(SkipToken(t, lineEnd), lineEnd))
+				corners++;
+			if (corners > 2)
+				triangleCount += corners - 2;
+		}
+
+		p = lineEnd + 1;
+	}
+
+	Channel positions;                   // Positions from the file
+	Channel normals;                     // Normals from the file
+	Channel uvs;                         // UVs from the file
+	std::vector<unsigned int> corners;   // Vertex indices of the current face
+	positions.Reserve(positionCount);
+	normals.Reserve(normalCount);
+	uvs.Reserve(uvCount);
+	indices.reserve(indices.size() + triangleCount * 3);
+
+	// Every unique corner needs at least one of each channel, so the
+	// biggest channel is a good guess for the welded vertex count
+	size_t uniqueGuess = positionCount;
+	if (uvCount > uniqueGuess) uniqueGuess = uvCount;
+	if (normalCount > uniqueGuess) uniqueGuess = normalCount;
+	verts.reserve(verts.size() + uniqueGuess);
+
+	// Maps each corner we've seen to the vertex made for it
+	FlatTable<CornerKey, CornerKeyHash> weldTable;
+	weldTable.Reserve(uniqueGuess);
+
+	// Parsing pass
+	for (const char* p = data; p < end;)
+	{
+		p = SkipSpaces(p, end);
+		const char* lineEnd = FindLineEnd(p, end);
+
+		if (lineEnd - p > 1 && p[0] == 'v' && p[1] == 'n')
+		{
+			XMFLOAT3 norm;
+			const char* t = SkipSpaces(p + 2, lineEnd);
+			t = SkipSpaces(ParseFloat(t, lineEnd, norm.x), lineEnd);
+			t = SkipSpaces(ParseFloat(t, lineEnd, norm.y), lineEnd);
+			ParseFloat(t, lineEnd, norm.z);
+			normals.Add(norm);
+		}
+		else if (lineEnd - p > 1 && p[0] == 'v' && p[1] == 't')
+		{
+			XMFLOAT3 uv(0, 0, 0);
+			const char* t = SkipSpaces(p + 2, lineEnd);
+			t = SkipSpaces(ParseFloat(t, lineEnd, uv.x), lineEnd);
+			ParseFloat(t, lineEnd, uv.y);
+			uvs.Add(uv);
+		}
+		else if (lineEnd - p > 1 && p[0] == 'v' && IsSpace(p[1]))
+		{
+			XMFLOAT3 pos;
+			const char* t = SkipSpaces(p + 1, lineEnd);
+			t = SkipSpaces(ParseFloat(t, lineEnd, pos.x), lineEnd);
+			t = SkipSpaces(ParseFloat(t, lineEnd, pos.y), lineEnd);
+			ParseFloat(t, lineEnd, pos.z);
+			positions.Add(pos);
+		}
+		else if (lineEnd - p > 1 && p[0] == 'f' && IsSpace(p[1]))
+		{
+			// Gather every corner of the face
+			corners.clear();
+			for (const char* t = SkipSpaces(p + 1, lineEnd); t < lineEnd; t = SkipSpaces(t, lineEnd))
+			{
+				int v = 0, vt = 0, vn = 0;
+				t = ParseInt(t, lineEnd, v);
+				if (t < lineEnd && *t == '/')
+				{
+					t++;
+					if (t < lineEnd && *t != '/')
+						t = ParseInt(t, lineEnd, vt);
+					if (t < lineEnd && *t == '/')
+						t = ParseInt(t + 1, lineEnd, vn);
+				}
+				t = SkipToken(t, lineEnd);
+
+				CornerKey key;
+				key.Position = positions.Resolve(v);
+				key.UV = uvs.Resolve(vt);
+				key.Normal = normals.Resolve(vn);
+
+				// Reuse the vertex if this corner was already seen
+				unsigned int index = weldTable.FindOrInsert(key, (unsigned int)verts.size());
+				corners.push_back(index);
+				if (index != verts.size())
+					continue;
+
+				// - Create the vert by looking up the corresponding
+				//    data, leaving missing channels zeroed
+				// - Convert to a left-handed space for DirectX by
+				//    inverting the Z position and the normal's Z
+				// - Flip the UV since DirectX puts (0,0) at the top left
+				Vertex vert = {};
+				if (key.Position >= 0) vert.Position = positions.Values[key.Position];
+				if (key.Normal >= 0) vert.Normal = normals.Values[key.Normal];
+				if (key.UV >= 0) vert.UV = XMFLOAT2(uvs.Values[key.UV].x, uvs.Values[key.UV].y);
+				vert.UV.y = 1.0f - vert.UV.y;
+				vert.Position.z *= -1.0f;
+				vert.Normal.z *= -1.0f;
+
+				verts.push_back(vert);
+			}
+
+			// Fan triangulate, flipping the winding order
+			for (size_t c = 2; c < corners.size(); c++)
+			{
+				indices.push_back(corners[0]);
+				indices.push_back(corners[c]);
+				indices.push_back(corners[c - 1]);
+			}
+		}
+
+		p = lineEnd + 1;
+	}
+}
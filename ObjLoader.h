@@ -0,0 +1,27 @@
+#pragma once
+#include "Vertex.h"
+#include <vector>
+
+// --------------------------------------------------------
+// Reads Wavefront OBJ files into flat vertex and index arrays
+//
+// The whole file is read in one block and tokenized in place,
+// so there are no per-line copies or length limits.  A quick
+// counting pass reserves every array up front.
+//
+// Supports faces with any number of corners (fan triangulated)
+// and all four index forms: v, v/vt, v//vn and v/vt/vn.
+// Negative (relative) indices are resolved as well.
+//
+// Corners that share the same position/uv/normal values are
+// welded into a single vertex, so the output is truly indexed.
+// --------------------------------------------------------
+class ObjLoader
+{
+public:
+	// Loads the file from disk - returns false if it can't be opened
+	static bool Load(const char* objFile, std::vector<Vertex>& verts, std::vector<unsigned int>& indices);
+
+	// Parses OBJ text that is already in memory
+	static void Parse(const char* data, size_t size, std::vector<Vertex>& verts, std::vector<unsigned int>& indices);
+};
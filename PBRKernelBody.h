@@ -0,0 +1,290 @@
+#pragma once
+#include "PBRKernels.h"
+
+// A ShaderLight read as floats: position, range, color,
+// spot scale, direction and spot offset
+const int ShaderLightFloats = 12;
+
+// --------------------------------------------------------
+// The kernels for one instruction set, as PBRKernels calls
+// them.  Lights are packed ShaderLight records.
+// --------------------------------------------------------
+struct PBRKernelTable
+{
+	void(*DistributionGGX)(size_t count, KernelFloat3 n, KernelFloat3 h, const float* roughness, float* ndf);
+	void(*GeometrySchlickGGX)(size_t count, const float* NdotV, const float* roughness, float* g);
+	void(*GeometrySmith)(size_t count, KernelFloat3 n, KernelFloat3 v, KernelFloat3 l, const float* roughness, float* g);
+	void(*FresnelSchlick)(size_t count, const float* cosTheta, KernelFloat3 f0, KernelFloat3Out f);
+	void(*FresnelSchlickRoughness)(size_t count, const float* cosTheta, KernelFloat3 f0, const float* roughness, KernelFloat3Out f);
+	void(*AccumulateRadiance)(size_t count, KernelFloat3 worldPos, KernelFloat3 v, KernelFloat3 n, KernelFloat3 albedo,
+		const float* metallic, const float* roughness, KernelFloat3 f0,
+		const float* lights, int lightCount, bool accumulate, KernelFloat3Out radiance);
+};
+
+// --------------------------------------------------------
+// One table per instruction set, each in its own file so
+// it can be built with its own compiler flags
+// --------------------------------------------------------
+class PBRKernelPaths
+{
+public:
+	static const PBRKernelTable& Scalar();
+	static const PBRKernelTable& AVX2();
+	static const PBRKernelTable& AVX512();
+};
+
+// --------------------------------------------------------
+// The kernels, written once over a lane type L holding
+// L::Width floats.  L needs Load() and Store() of the
+// first n lanes, Splat(), the arithmetic operators, and
+// Max(), Min() and Sqrt() found by argument lookup.
+//
+// Each instruction set's file gives this a lane type in an
+// anonymous namespace, so every copy stays in its own file.
+// Nothing else with inline code may be included alongside
+// it - the linker could pick up a copy built for a wider
+// instruction set than the CPU has.
+// --------------------------------------------------------
+template<class L>
+class PBRKernelBody
+{
+public:
+	static const PBRKernelTable Table;
+
+private:
+	struct Vector
+	{
+		L X, Y, Z;
+	};
+
+	static size_t LanesAt(size_t count, size_t i)
+	{
+		return count - i < L::Width ? count - i : L::Width;
+	}
+
+	static Vector Load(const KernelFloat3& v, size_t i, size_t lanes)
+	{
+		Vector result = { L::Load(v.X + i, lanes), L::Load(v.Y + i, lanes), L::Load(v.Z + i, lanes) };
+		return result;
+	}
+
+	static void Store(const KernelFloat3Out& v, size_t i, size_t lanes, const Vector& value)
+	{
+		L::Store(v.X + i, lanes, value.X);
+		L::Store(v.Y + i, lanes, value.Y);
+		L::Store(v.Z + i, lanes, value.Z);
+	}
+
+	static L Dot(const Vector& a, const Vector& b)
+	{
+		return a.X * b.X + a.Y * b.Y + a.Z * b.Z;
+	}
+
+	static Vector Normalize(const Vector& v)
+	{
+		L invLength = L::Splat(1.0f) / Sqrt(Dot(v, v));
+		Vector result = { v.X * invLength, v.Y * invLength, v.Z * invLength };
+		return result;
+	}
+
+	static L Saturate(L x)
+	{
+		return Min(Max(x, L::Splat(0.0f)), L::Splat(1.0f));
+	}
+
+	// x to the fifth, as pow(x, 5.0)
+	static L Pow5(L x)
+	{
+		L x2 = x * x;
+		return x2 * x2 * x;
+	}
+
+	// --------------------------------------------------------
+	// Per lane versions of the shader functions
+	// --------------------------------------------------------
+	static L Distribution(L NdotH, L roughness)
+	{
+		L a = roughness * roughness;
+		L a2 = a * a;
+		L NdotH2 = NdotH * NdotH;
+
+		L num = a2;
+		L denom = (NdotH2 * (a2 - L::Splat(1.0f)) + L::Splat(1.0f));
+		denom = L::Splat(3.14159235359f) * denom * denom;
+
+		return num / denom;
+	}
+
+	static L SchlickGGX(L NdotV, L roughness)
+	{
+		L r = roughness + L::Splat(1.0f);
+		L k = (r * r) / L::Splat(8.0f);
+
+		L num = NdotV;
+		L denom = NdotV * (L::Splat(1.0f) - k) + k;
+
+		return num / denom;
+	}
+
+	static L Smith(L NdotV, L NdotL, L roughness)
+	{
+		return SchlickGGX(NdotV, roughness) * SchlickGGX(NdotL, roughness);
+	}
+
+	static L Fresnel(L cosTheta, L f0)
+	{
+		return f0 + (L::Splat(1.0f) - f0) * Pow5(L::Splat(1.0f) - cosTheta);
+	}
+
+	static L FresnelRoughness(L cosTheta, L f0, L roughness)
+	{
+		return f0 + (Max(L::Splat(1.0f) - roughness, f0) - f0) * Pow5(L::Splat(1.0f) - cosTheta);
+	}
+
+	// --------------------------------------------------------
+	// The array kernels
+	// --------------------------------------------------------
+	static void DistributionGGX(size_t count, KernelFloat3 n, KernelFloat3 h, const float* roughness, float* ndf)
+	{
+		for (size_t i = 0; i < count; i += L::Width)
+		{
+			size_t lanes = LanesAt(count, i);
+			L NdotH = Max(Dot(Load(n, i, lanes), Load(h, i, lanes)), L::Splat(0.0f));
+			L::Store(ndf + i, lanes, Distribution(NdotH, L::Load(roughness + i, lanes)));
+		}
+	}
+
+	static void GeometrySchlickGGX(size_t count, const float* NdotV, const float* roughness, float* g)
+	{
+		for (size_t i = 0; i < count; i += L::Width)
+		{
+			size_t lanes = LanesAt(count, i);
+			L::Store(g + i, lanes, SchlickGGX(L::Load(NdotV + i, lanes), L::Load(roughness + i, lanes)));
+		}
+	}
+
+	static void GeometrySmith(size_t count, KernelFloat3 n, KernelFloat3 v, KernelFloat3 l, const float* roughness, float* g)
+	{
+		for (size_t i = 0; i < count; i += L::Width)
+		{
+			size_t lanes = LanesAt(count, i);
+			Vector N = Load(n, i, lanes);
+			L NdotV = Max(Dot(N, Load(v, i, lanes)), L::Splat(0.0f));
+			L NdotL = Max(Dot(N, Load(l, i, lanes)), L::Splat(0.0f));
+			L::Store(g + i, lanes, Smith(NdotV, NdotL, L::Load(roughness + i, lanes)));
+		}
+	}
+
+	static void FresnelSchlick(size_t count, const float* cosTheta, KernelFloat3 f0, KernelFloat3Out f)
+	{
+		for (size_t i = 0; i < count; i += L::Width)
+		{
+			size_t lanes = LanesAt(count, i);
+			L c = L::Load(cosTheta + i, lanes);
+			Vector F0 = Load(f0, i, lanes);
+			Vector F = { Fresnel(c, F0.X), Fresnel(c, F0.Y), Fresnel(c, F0.Z) };
+			Store(f, i, lanes, F);
+		}
+	}
+
+	static void FresnelSchlickRoughness(size_t count, const float* cosTheta, KernelFloat3 f0, const float* roughness, KernelFloat3Out f)
+	{
+		for (size_t i = 0; i < count; i += L::Width)
+		{
+			size_t lanes = LanesAt(count, i);
+			L c = L::Load(cosTheta + i, lanes);
+			L r = L::Load(roughness + i, lanes);
+			Vector F0 = Load(f0, i, lanes);
+			Vector F = { FresnelRoughness(c, F0.X, r), FresnelRoughness(c, F0.Y, r), FresnelRoughness(c, F0.Z, r) };
+			Store(f, i, lanes, F);
+		}
+	}
+
+	// --------------------------------------------------------
+	// CalculateRadiance for each light in turn, with the
+	// surface loaded once.  Adds to what radiance held when
+	// accumulating, or starts from zero.
+	// --------------------------------------------------------
+	static void AccumulateRadiance(size_t count, KernelFloat3 worldPos, KernelFloat3 v, KernelFloat3 n, KernelFloat3 albedo,
+		const float* metallic, const float* roughness, KernelFloat3 f0,
+		const float* lights, int lightCount, bool accumulate, KernelFloat3Out radiance)
+	{
+		KernelFloat3 previous = { radiance.X, radiance.Y, radiance.Z };
+		for (size_t i = 0; i < count; i += L::Width)
+		{
+			size_t lanes = LanesAt(count, i);
+			Vector P = Load(worldPos, i, lanes);
+			Vector V = Load(v, i, lanes);
+			Vector N = Load(n, i, lanes);
+			Vector A = Load(albedo, i, lanes);
+			Vector F0 = Load(f0, i, lanes);
+			L r = L::Load(roughness + i, lanes);
+			L oneMinusMetallic = L::Splat(1.0f) - L::Load(metallic + i, lanes);
+			L NdotV = Max(Dot(N, V), L::Splat(0.0f));
+			L ggxV = SchlickGGX(NdotV, r);
+
+			Vector total = { L::Splat(0.0f), L::Splat(0.0f), L::Splat(0.0f) };
+			if (accumulate)
+				total = Load(previous, i, lanes);
+
+			for (int light = 0; light < lightCount; light++)
+			{
+				const float* record = lights + light * ShaderLightFloats;
+				const float* position = record;
+				const float* color = record + 4;
+				const float* direction = record + 8;
+
+				//Calculate per-light radiance
+				Vector toLight = { L::Splat(position[0]) - P.X, L::Splat(position[1]) - P.Y, L::Splat(position[2]) - P.Z };
+				Vector Ld = Normalize(toLight);
+				Vector sum = { V.X + Ld.X, V.Y + Ld.Y, V.Z + Ld.Z };
+				Vector H = Normalize(sum);
+
+				L distance = Sqrt(Dot(toLight, toLight));
+				L attenuation = L::Splat(1.0f) / (distance * distance);
+
+				//Fade to nothing at the light's range, and outside a spot light's cone
+				L ratio = distance / L::Splat(record[3]);
+				L ratio2 = ratio * ratio;
+				L window = Saturate(L::Splat(1.0f) - ratio2 * ratio2);
+				L cosAngle = L::Splat(0.0f) - (Ld.X * L::Splat(direction[0]) + Ld.Y * L::Splat(direction[1]) + Ld.Z * L::Splat(direction[2]));
+				L spot = Saturate(cosAngle * L::Splat(record[7]) + L::Splat(record[11]));
+				attenuation = attenuation * window * window * spot * spot;
+
+				//Cook-Torrance BRDF
+				L NdotL = Max(Dot(N, Ld), L::Splat(0.0f));
+				L NDF = Distribution(Max(Dot(N, H), L::Splat(0.0f)), r);
+				L G = ggxV * SchlickGGX(NdotL, r);
+				L HdotV = Max(Dot(H, V), L::Splat(0.0f));
+
+				L denominator = Max(L::Splat(4.0f) * NdotV * NdotL, L::Splat(0.001f));
+				L specularScale = NDF * G / denominator;
+				L weight = attenuation * NdotL;
+
+				L* channels[3] = { &total.X, &total.Y, &total.Z };
+				const L* albedos[3] = { &A.X, &A.Y, &A.Z };
+				const L* f0s[3] = { &F0.X, &F0.Y, &F0.Z };
+				for (int c = 0; c < 3; c++)
+				{
+					L F = Fresnel(HdotV, *f0s[c]);
+					L kD = (L::Splat(1.0f) - F) * oneMinusMetallic;
+					L diffuse = kD * *albedos[c] / L::Splat(3.14159235359f);
+					*channels[c] = *channels[c] + (diffuse + specularScale * F) * L::Splat(color[c]) * weight;
+				}
+			}
+
+			Store(radiance, i, lanes, total);
+		}
+	}
+};
+
+template<class L>
+const PBRKernelTable PBRKernelBody<L>::Table =
+{
+	&PBRKernelBody<L>::DistributionGGX,
+	&PBRKernelBody<L>::GeometrySchlickGGX,
+	&PBRKernelBody<L>::GeometrySmith,
+	&PBRKernelBody<L>::FresnelSchlick,
+	&PBRKernelBody<L>::FresnelSchlickRoughness,
+	&PBRKernelBody<L>::AccumulateRadiance
+};
@@ -0,0 +1,201 @@
+#include "PBRKernels.h"
+#include "PBRKernelBody.h"
+#include "LightSystem.h"
+#include <DirectXMath.h>
+#include <atomic>
+#include <cmath>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+using namespace DirectX;
+
+// The kernels read lights as packed floats
+static_assert(sizeof(ShaderLight) == ShaderLightFloats * sizeof(float), "ShaderLight must be packed floats");
+
+namespace
+{
+	// --------------------------------------------------------
+	// One float at a time, for CPUs without AVX2
+	// --------------------------------------------------------
+	struct ScalarLanes
+	{
+		static const size_t Width = 1;
+		float V;
+
+		static ScalarLanes Load(const float* p, size_t) { ScalarLanes l = { *p }; return l; }
+		static void Store(float* p, size_t, ScalarLanes l) { *p = l.V; }
+		static ScalarLanes Splat(float x) { ScalarLanes l = { x }; return l; }
+	};
+
+	inline ScalarLanes operator+(ScalarLanes a, ScalarLanes b) { return ScalarLanes::Splat(a.V + b.V); }
+	inline ScalarLanes operator-(ScalarLanes a, ScalarLanes b) { return ScalarLanes::Splat(a.V - b.V); }
+	inline ScalarLanes operator*(ScalarLanes a, ScalarLanes b) { return ScalarLanes::Splat(a.V * b.V); }
+	inline ScalarLanes operator/(ScalarLanes a, ScalarLanes b) { return ScalarLanes::Splat(a.V / b.V); }
+	inline ScalarLanes Max(ScalarLanes a, ScalarLanes b) { return ScalarLanes::Splat(a.V > b.V ? a.V : b.V); }
+	inline ScalarLanes Min(ScalarLanes a, ScalarLanes b) { return ScalarLanes::Splat(a.V < b.V ? a.V : b.V); }
+	inline ScalarLanes Sqrt(ScalarLanes a) { return ScalarLanes::Splat(sqrtf(a.V)); }
+
+	void CpuId(int leaf, unsigned int registers[4])
+	{
+#ifdef _MSC_VER
+		__cpuidex((int*)registers, leaf, 0);
+#else
+		__cpuid_count(leaf, 0, registers[0], registers[1], registers[2], registers[3]);
+#endif
+	}
+
+	// Which register sets the OS saves on a context switch
+	unsigned long long EnabledRegisterState()
+	{
+#ifdef _MSC_VER
+		return _xgetbv(0);
+#else
+		unsigned int low, high;
+		__asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+		return ((unsigned long long)high << 32) | low;
+#endif
+	}
+
+	// --------------------------------------------------------
+	// The CPU has to have the instructions, and the OS has to
+	// save the wider registers, for a path to be usable
+	// --------------------------------------------------------
+	KernelPath DetectPath()
+	{
+		unsigned int registers[4];
+		CpuId(0, registers);
+		if (registers[0] < 7)
+			return KernelPath::Scalar;
+
+		CpuId(1, registers);
+		bool fma = (registers[2] & (1 << 12)) != 0;
+		bool osxsave = (registers[2] & (1 << 27)) != 0;
+		bool avx = (registers[2] & (1 << 28)) != 0;
+		if (!fma || !osxsave || !avx)
+			return KernelPath::Scalar;
+
+		// SSE and AVX state, then the AVX-512 mask and upper registers
+		unsigned long long state = EnabledRegisterState();
+		if ((state & 0x6) != 0x6)
+			return KernelPath::Scalar;
+
+		CpuId(7, registers);
+		bool avx2 = (registers[1] & (1 << 5)) != 0;
+		bool avx512 = (registers[1] & (1 << 16)) != 0;
+		if (!avx2)
+			return KernelPath::Scalar;
+		if (avx512 && (state & 0xE6) == 0xE6)
+			return KernelPath::AVX512;
+		return KernelPath::AVX2;
+	}
+
+	const PBRKernelTable& TableFor(KernelPath path)
+	{
+		switch (path)
+		{
+		case KernelPath::AVX512: return PBRKernelPaths::AVX512();
+		case KernelPath::AVX2: return PBRKernelPaths::AVX2();
+		default: return PBRKernelPaths::Scalar();
+		}
+	}
+
+	// Null until the first kernel runs
+	std::atomic<const PBRKernelTable*> currentTable(0);
+	std::atomic<KernelPath> currentPath(KernelPath::Scalar);
+}
+
+
+const PBRKernelTable & PBRKernelPaths::Scalar()
+{
+	return PBRKernelBody<ScalarLanes>::Table;
+}
+
+KernelPath PBRKernels::GetBestPath()
+{
+	static const KernelPath best = DetectPath();
+	return best;
+}
+
+bool PBRKernels::SetPath(KernelPath path)
+{
+	if ((int)path > (int)GetBestPath())
+		return false;
+
+	currentPath = path;
+	currentTable = &TableFor(path);
+	return true;
+}
+
+KernelPath PBRKernels::GetPath()
+{
+	GetTable();
+	return currentPath;
+}
+
+const char * PBRKernels::GetPathName(KernelPath path)
+{
+	switch (path)
+	{
+	case KernelPath::AVX512: return "AVX-512";
+	case KernelPath::AVX2: return "AVX2";
+	default: return "Scalar";
+	}
+}
+
+const PBRKernelTable & PBRKernels::GetTable()
+{
+	const PBRKernelTable* table = currentTable;
+	if (!table)
+	{
+		SetPath(GetBestPath());
+		table = currentTable;
+	}
+	return *table;
+}
+
+void PBRKernels::DistributionGGX(size_t count, KernelFloat3 n, KernelFloat3 h, const float * roughness, float * ndf)
+{
+	GetTable().DistributionGGX(count, n, h, roughness, ndf);
+}
+
+void PBRKernels::GeometrySchlickGGX(size_t count, const float * NdotV, const float * roughness, float * g)
+{
+	GetTable().GeometrySchlickGGX(count, NdotV, roughness, g);
+}
+
+void PBRKernels::GeometrySmith(size_t count, KernelFloat3 n, KernelFloat3 v, KernelFloat3 l, const float * roughness, float * g)
+{
+	GetTable().GeometrySmith(count, n, v, l, roughness, g);
+}
+
+void PBRKernels::FresnelSchlick(size_t count, const float * cosTheta, KernelFloat3 f0, KernelFloat3Out f)
+{
+	GetTable().FresnelSchlick(count, cosTheta, f0, f);
+}
+
+void PBRKernels::FresnelSchlickRoughness(size_t count, const float * cosTheta, KernelFloat3 f0, const float * roughness, KernelFloat3Out f)
+{
+	GetTable().FresnelSchlickRoughness(count, cosTheta, f0, roughness, f);
+}
+
+void PBRKernels::CalculateRadiance(size_t count, KernelFloat3 worldPos, KernelFloat3 v, KernelFloat3 n, KernelFloat3 albedo,
+	const float * metallic, const float * roughness, KernelFloat3 f0,
+	const ShaderLight & light, KernelFloat3Out radiance)
+{
+	GetTable().AccumulateRadiance(count, worldPos, v, n, albedo, metallic, roughness, f0, &light.Position.x, 1, false, radiance);
+}
+
+void PBRKernels::AccumulateRadiance(size_t count, KernelFloat3 worldPos, KernelFloat3 v, KernelFloat3 n, KernelFloat3 albedo,
+	const float * metallic, const float * roughness, KernelFloat3 f0,
+	const ShaderLight * lights, int lightCount, KernelFloat3Out radiance)
+{
+	if (lightCount <= 0)
+		return;
+
+	GetTable().AccumulateRadiance(count, worldPos, v, n, albedo, metallic, roughness, f0,
+		&lights[0].Position.x, lightCount, true, radiance);
+}
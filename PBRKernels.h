@@ -0,0 +1,82 @@
+#pragma once
+#include <cstddef>
+
+// Only pointers to lights are used here, so the SIMD files
+// that include this never see DirectXMath's inline code
+struct ShaderLight;
+
+struct PBRKernelTable;
+
+// --------------------------------------------------------
+// Structure of arrays input for the kernels - one array per
+// component, either x, y and z or r, g and b
+// --------------------------------------------------------
+struct KernelFloat3
+{
+	const float* X;
+	const float* Y;
+	const float* Z;
+};
+
+// Where three component results go
+struct KernelFloat3Out
+{
+	float* X;
+	float* Y;
+	float* Z;
+};
+
+// Which instructions the kernels run on
+enum class KernelPath
+{
+	Scalar,
+	AVX2,		// 8 samples at a time
+	AVX512		// 16 samples at a time
+};
+
+// --------------------------------------------------------
+// The BRDF from the PBR pixel shaders, evaluated on the CPU
+// for whole arrays of samples at once
+//
+// Every function here matches the HLSL function of the same
+// name, step for step, with each argument given as one array
+// (or three, for vectors) holding a value per sample.  Input
+// and output arrays may be the same array.
+//
+// The same kernels are built for plain scalar code, AVX2
+// and AVX-512, and the widest one the CPU can run is picked
+// the first time any of them is called.
+// --------------------------------------------------------
+class PBRKernels
+{
+public:
+	// The widest path this CPU, and OS, supports
+	static KernelPath GetBestPath();
+
+	// Switches every kernel over, which is only safe while
+	// none are running.  Fails for paths the CPU can't run.
+	static bool SetPath(KernelPath path);
+	static KernelPath GetPath();
+	static const char* GetPathName(KernelPath path);
+
+	static void DistributionGGX(size_t count, KernelFloat3 n, KernelFloat3 h, const float* roughness, float* ndf);
+	static void GeometrySchlickGGX(size_t count, const float* NdotV, const float* roughness, float* g);
+	static void GeometrySmith(size_t count, KernelFloat3 n, KernelFloat3 v, KernelFloat3 l, const float* roughness, float* g);
+	static void FresnelSchlick(size_t count, const float* cosTheta, KernelFloat3 f0, KernelFloat3Out f);
+	static void FresnelSchlickRoughness(size_t count, const float* cosTheta, KernelFloat3 f0, const float* roughness, KernelFloat3Out f);
+
+	// One light's reflected radiance, faded out towards its
+	// range and outside a spot light's cone
+	static void CalculateRadiance(size_t count, KernelFloat3 worldPos, KernelFloat3 v, KernelFloat3 n, KernelFloat3 albedo,
+		const float* metallic, const float* roughness, KernelFloat3 f0,
+		const ShaderLight& light, KernelFloat3Out radiance);
+
+	// Adds up CalculateRadiance over several lights, on top of
+	// what's already in radiance
+	static void AccumulateRadiance(size_t count, KernelFloat3 worldPos, KernelFloat3 v, KernelFloat3 n, KernelFloat3 albedo,
+		const float* metallic, const float* roughness, KernelFloat3 f0,
+		const ShaderLight* lights, int lightCount, KernelFloat3Out radiance);
+
+private:
+	static const PBRKernelTable& GetTable();
+};
@@ -0,0 +1,55 @@
+#include "PBRKernelBody.h"
+#include <immintrin.h>
+
+// Built with AVX2 enabled, and only called once the CPU is
+// known to have it - see PBRKernelBody.h before including
+// anything else here
+
+namespace
+{
+	// --------------------------------------------------------
+	// Eight floats at a time.  Partial loads and stores are
+	// masked, so the ends of arrays are never overrun.
+	// --------------------------------------------------------
+	struct Avx2Lanes
+	{
+		static const size_t Width = 8;
+		__m256 V;
+
+		static __m256i Mask(size_t lanes)
+		{
+			return _mm256_cmpgt_epi32(_mm256_set1_epi32((int)lanes), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+		}
+
+		static Avx2Lanes Load(const float* p, size_t lanes)
+		{
+			Avx2Lanes l = { lanes == Width ? _mm256_loadu_ps(p) : _mm256_maskload_ps(p, Mask(lanes)) };
+			return l;
+		}
+
+		static void Store(float* p, size_t lanes, Avx2Lanes l)
+		{
+			if (lanes == Width)
+				_mm256_storeu_ps(p, l.V);
+			else
+				_mm256_maskstore_ps(p, Mask(lanes), l.V);
+		}
+
+		static Avx2Lanes Splat(float x) { Avx2Lanes l = { _mm256_set1_ps(x) }; return l; }
+	};
+
+	inline Avx2Lanes Make(__m256 v) { Avx2Lanes l = { v }; return l; }
+	inline Avx2Lanes operator+(Avx2Lanes a, Avx2Lanes b) { return Make(_mm256_add_ps(a.V, b.V)); }
+	inline Avx2Lanes operator-(Avx2Lanes a, Avx2Lanes b) { return Make(_mm256_sub_ps(a.V, b.V)); }
+	inline Avx2Lanes operator*(Avx2Lanes a, Avx2Lanes b) { return Make(_mm256_mul_ps(a.V, b.V)); }
+	inline Avx2Lanes operator/(Avx2Lanes a, Avx2Lanes b) { return Make(_mm256_div_ps(a.V, b.V)); }
+	inline Avx2Lanes Max(Avx2Lanes a, Avx2Lanes b) { return Make(_mm256_max_ps(a.V, b.V)); }
+	inline Avx2Lanes Min(Avx2Lanes a, Avx2Lanes b) { return Make(_mm256_min_ps(a.V, b.V)); }
+	inline Avx2Lanes Sqrt(Avx2Lanes a) { return Make(_mm256_sqrt_ps(a.V)); }
+}
+
+
+const PBRKernelTable & PBRKernelPaths::AVX2()
+{
+	return PBRKernelBody<Avx2Lanes>::Table;
+}
@@ -0,0 +1,55 @@
+#include "PBRKernelBody.h"
+#include <immintrin.h>
+
+// Built with AVX-512F enabled, and only called once the CPU
+// is known to have it - see PBRKernelBody.h before including
+// anything else here
+
+namespace
+{
+	// --------------------------------------------------------
+	// Sixteen floats at a time, with the ends of arrays
+	// handled by masked loads and stores
+	// --------------------------------------------------------
+	struct Avx512Lanes
+	{
+		static const size_t Width = 16;
+		__m512 V;
+
+		static __mmask16 Mask(size_t lanes)
+		{
+			return (__mmask16)((1u << lanes) - 1);
+		}
+
+		static Avx512Lanes Load(const float* p, size_t lanes)
+		{
+			Avx512Lanes l = { lanes == Width ? _mm512_loadu_ps(p) : _mm512_maskz_loadu_ps(Mask(lanes), p) };
+			return l;
+		}
+
+		static void Store(float* p, size_t lanes, Avx512Lanes l)
+		{
+			if (lanes == Width)
+				_mm512_storeu_ps(p, l.V);
+			else
+				_mm512_mask_storeu_ps(p, Mask(lanes), l.V);
+		}
+
+		static Avx512Lanes Splat(float x) { Avx512Lanes l = { _mm512_set1_ps(x) }; return l; }
+	};
+
+	inline Avx512Lanes Make(__m512 v) { Avx512Lanes l = { v }; return l; }
+	inline Avx512Lanes operator+(Avx512Lanes a, Avx512Lanes b) { return Make(_mm512_add_ps(a.V, b.V)); }
+	inline Avx512Lanes operator-(Avx512Lanes a, Avx512Lanes b) { return Make(_mm512_sub_ps(a.V, b.V)); }
+	inline Avx512Lanes operator*(Avx512Lanes a, Avx512Lanes b) { return Make(_mm512_mul_ps(a.V, b.V)); }
+	inline Avx512Lanes operator/(Avx512Lanes a, Avx512Lanes b) { return Make(_mm512_div_ps(a.V, b.V)); }
+	inline Avx512Lanes Max(Avx512Lanes a, Avx512Lanes b) { return Make(_mm512_max_ps(a.V, b.V)); }
+	inline Avx512Lanes Min(Avx512Lanes a, Avx512Lanes b) { return Make(_mm512_min_ps(a.V, b.V)); }
+	inline Avx512Lanes Sqrt(Avx512Lanes a) { return Make(_mm512_sqrt_ps(a.V)); }
+}
+
+
+const PBRKernelTable & PBRKernelPaths::AVX512()
+{
+	return PBRKernelBody<Avx512Lanes>::Table;
+}
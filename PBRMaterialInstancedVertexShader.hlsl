@@ -0,0 +1,46 @@
+cbuffer perFrame : register(b0)
+{
+	matrix view;
+	matrix projection;
+};
+
+struct VertexShaderInput
+{
+	float3 position		:POSITION;
+	float2 uv			: TEXCOORD;
+	float3 normal		: NORMAL;
+	float4 tangent		: TANGENT;
+
+	// World matrix rows, from the instance buffer in slot 1.
+	// They arrive transposed, like a cbuffer matrix would.
+	float4 world0		: WORLD_PER_INSTANCE0;
+	float4 world1		: WORLD_PER_INSTANCE1;
+	float4 world2		: WORLD_PER_INSTANCE2;
+	float4 world3		: WORLD_PER_INSTANCE3;
+};
+
+struct VertexToPixel
+{
+	float4 position		: SV_POSITION;
+	float3 normal		: NORMAL;
+	float4 tangent		: TANGENT;
+	float3 worldPos		: POSITION;
+	float2 uv			: TEXCOORD;
+
+};
+
+VertexToPixel main(VertexShaderInput input)
+{
+	VertexToPixel output;
+
+	matrix world = transpose(float4x4(input.world0, input.world1, input.world2, input.world3));
+	matrix worldViewProj = mul(mul(world, view), projection);
+
+	output.position = mul(float4(input.position, 1.0f), worldViewProj);
+	output.normal = mul(input.normal, (float3x3)world);
+	output.tangent = float4(mul(input.tangent.xyz, (float3x3)world), input.tangent.w);
+	output.worldPos = mul(float4(input.position, 1.0f), world).xyz;
+	output.uv = input.uv;
+
+	return output;
+}
\ No newline at end of file
@@ -3,25 +3,54 @@ Texture2D albedoMap				: register(t1);
 Texture2D normalMap				: register(t2);
 Texture2D metallicMap			: register(t3);
 Texture2D roughnessMap			: register(t4);
+TextureCube prefilterMap		: register(t5);
+Texture2D brdfLUT				: register(t6);
 SamplerState basicSampler		: register(s0);
+SamplerState clampSampler		: register(s1);
 
-cbuffer externalData	: register(b0)
+//Every light in the scene - must match ShaderLight in LightSystem.h
+struct ShaderLight
 {
-	float ao;
+	float3 position;
+	float range;
+	float3 color;
+	float spotScale;
+	float3 direction;
+	float spotOffset;
+};
 
-	float3 lightPosition1;
-	float3 lightPosition2;
-	float3 lightPosition3;
-	float3 lightPosition4;
-	float3 lightColor;
+//Each cluster's offset and count in lightIndices, then the lights
+StructuredBuffer<ShaderLight> lights	: register(t7);
+StructuredBuffer<uint2> lightClusters	: register(t8);
+StructuredBuffer<uint> lightIndices		: register(t9);
+
+//Must match LightSystem's cluster counts
+static const uint ClustersX = 16;
+static const uint ClustersY = 9;
+static const uint ClustersZ = 24;
+
+cbuffer perFrame	: register(b0)
+{
+	float ao;
 
 	float3 cameraPos;
+
+	float prefilterMaxLod;
+
+	//Pixels to cluster columns and rows, and the row of the view
+	//matrix that gives view depth
+	float2 clusterScale;
+	float4 viewDepth;
+
+	//A pixel's slice is log(view depth) * sliceScale + sliceBias
+	float sliceScale;
+	float sliceBias;
 }
 struct VertexToPixel
 {
 	float4 position		: SV_POSITION;
 	float3 normal		: NORMAL;
-	float3 tangent		: TANGENT;
+	float4 tangent		: TANGENT;
 	float3 worldPos		: POSITION;
 	float2 uv			: TEXCOORD;
 };
@@ -77,15 +106,22 @@ float3 FresnelSchlickRoughness(float cosTheta, float3 F0, float roughness)
 	return F0 + (max(float3(1.0f - roughness, 1.0f - roughness, 1.0f - roughness), F0) - F0) * pow(1.0f - cosTheta, 5.0f);
 }
 
-void CalculateRadiance(VertexToPixel input, float3 V, float3 N, float3 albedo, float metallic, float roughness, float3 lightPos, float3 lightCol, float3 F0, out float3 radiance)
+void CalculateRadiance(VertexToPixel input, float3 V, float3 N, float3 albedo, float metallic, float roughness, ShaderLight light, float3 F0, out float3 radiance)
 {
 	//Calculate per-light radiance
-	float3 L = normalize(lightPos - input.worldPos);
+	float3 L = normalize(light.position - input.worldPos);
 	float3 H = normalize(V + L);
 
-	float distance = length(lightPos - input.worldPos);
+	float distance = length(light.position - input.worldPos);
 	float attenuation = 1.0f / (distance * distance);
-	float3 rad = lightColor * attenuation;
+
+	//Fade to nothing at the light's range, and outside a spot light's cone
+	float ratio = distance / light.range;
+	float window = saturate(1.0f - ratio * ratio * ratio * ratio);
+	float spot = saturate(dot(-L, light.direction) * light.spotScale + light.spotOffset);
+	attenuation *= window * window * spot * spot;
+
+	float3 rad = light.color * attenuation;
 
 	//Cook-Torrance BRDF
 	float NDF = DistributionGGX(N, H, roughness);
@@ -117,13 +153,13 @@ float4 main(VertexToPixel input) : SV_TARGET
 	float3 albedo = pow(albedoMap.Sample(basicSampler,input.uv).rgb, 2.2f);
 
 	//Normal Map
-	input.tangent = normalize(input.tangent);
+	float3 tangent = normalize(input.tangent.xyz);
 
 	float3 normalFromMap = normalMap.Sample(basicSampler, input.uv).xyz * 2 - 1;
 
 	float3 N = normalize(input.normal);
-	float3 T = normalize(input.tangent - N * dot(input.tangent, N));
-	float3 B = cross(T, N);
+	float3 T = normalize(tangent - N * dot(tangent, N));
+	float3 B = cross(T, N) * input.tangent.w;
 
 	float3x3 TBN = float3x3(T, B, N);
 	input.normal = normalize(mul(normalFromMap, TBN));
@@ -143,21 +179,20 @@ float4 main(VertexToPixel input) : SV_TARGET
 	float3 F0 = float3(0.04f, 0.04f, 0.04f);
 	F0 = lerp(F0, albedo, metallic);
 
-	//Reflectance equation
+	//Reflectance equation, over just the lights binned into this pixel's cluster
 	float3 L0 = float3(0.0f, 0.0f, 0.0f);
 	float3 radiance = float3(0.0f, 0.0f, 0.0f);
 
-	CalculateRadiance(input, viewDir, normalVec, albedo, metallic, roughness, lightPosition1, lightColor, F0, radiance);
-	L0 += radiance;
-	
-	CalculateRadiance(input, viewDir, normalVec, albedo, metallic, roughness, lightPosition2, lightColor, F0, radiance);
-	L0 += radiance;
+	float depth = dot(float4(input.worldPos, 1.0f), viewDepth);
+	uint3 clusterId = uint3(input.position.xy * clusterScale, max(floor(log(depth) * sliceScale + sliceBias), 0.0f));
+	clusterId = min(clusterId, uint3(ClustersX - 1, ClustersY - 1, ClustersZ - 1));
+	uint2 cluster = lightClusters[(clusterId.z * ClustersY + clusterId.y) * ClustersX + clusterId.x];
 
-	CalculateRadiance(input, viewDir, normalVec, albedo, metallic, roughness, lightPosition3, lightColor, F0, radiance);
-	L0 += radiance;
-
-	CalculateRadiance(input, viewDir, normalVec, albedo, metallic, roughness, lightPosition4, lightColor, F0, radiance);
-	L0 += radiance;
+	for (uint i = 0; i < cluster.y; i++)
+	{
+		CalculateRadiance(input, viewDir, normalVec, albedo, metallic, roughness, lights[lightIndices[cluster.x + i]], F0, radiance);
+		L0 += radiance;
+	}
 
 
 	//Direct lighting
@@ -165,7 +200,13 @@ float4 main(VertexToPixel input) : SV_TARGET
 	float3 kS = FresnelSchlickRoughness(max(dot(normalVec, viewDir), 0.0f), F0, roughness);
 	float3 kD = float3(1.0f, 1.0f, 1.0f) - kS;
 	float3 diffuse = albedo * irradiance;
-	float3 ambient = (kD * diffuse) * ao;
+
+	//Split sum specular - the prefiltered sky times the BRDF's scale and bias on F0
+	float3 prefiltered = prefilterMap.SampleLevel(basicSampler, R, roughness * prefilterMaxLod).rgb;
+	float2 envBRDF = brdfLUT.Sample(clampSampler, float2(max(dot(normalVec, viewDir), 0.0f), roughness)).rg;
+	float3 specular = prefiltered * (kS * envBRDF.x + envBRDF.y);
+
+	float3 ambient = (kD * diffuse + specular) * ao;
 
 	float3 color = ambient + L0;
 
@@ -1,23 +1,27 @@
-cbuffer externalData : register(b0)
+cbuffer perFrame : register(b0)
 {
-	matrix world;
 	matrix view;
 	matrix projection;
 };
 
+cbuffer perDraw : register(b1)
+{
+	matrix world;
+};
+
 struct VertexShaderInput
 {
 	float3 position		:POSITION;
 	float2 uv			: TEXCOORD;
 	float3 normal		: NORMAL;
-	float3 tangent		: TANGENT;
+	float4 tangent		: TANGENT;
 };
 
 struct VertexToPixel
 {
 	float4 position		: SV_POSITION;
 	float3 normal		: NORMAL;
-	float3 tangent		: TANGENT;
+	float4 tangent		: TANGENT;
 	float3 worldPos		: POSITION;
 	float2 uv			: TEXCOORD;
 
@@ -31,7 +35,7 @@ VertexToPixel main(VertexShaderInput input)
 
 	output.position = mul(float4(input.position, 1.0f), worldViewProj);
 	output.normal = mul(input.normal, (float3x3)world);
-	output.tangent = mul(input.tangent, (float3x3)world);
+	output.tangent = float4(mul(input.tangent.xyz, (float3x3)world), input.tangent.w);
 	output.worldPos = mul(float4(input.position, 1.0f), world).xyz;
 	output.uv = input.uv;
 
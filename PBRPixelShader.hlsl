@@ -1,10 +1,13 @@
-cbuffer externalData	: register(b0)
+cbuffer perDraw	: register(b0)
 {
 	float3 albedo;
 	float metallic;
 	float roughness;
 	float ao;
+}
 
+cbuffer perFrame	: register(b1)
+{
 	float3 lightPosition1;
 	float3 lightPosition2;
 	float3 lightPosition3;
@@ -1,10 +1,14 @@
-cbuffer externalData : register(b0)
+cbuffer perFrame : register(b0)
 {
-	matrix world;
 	matrix view;
 	matrix projection;
 };
 
+cbuffer perDraw : register(b1)
+{
+	matrix world;
+};
+
 struct VertexShaderInput
 {
 	float3 position		:POSITION;
@@ -1,5 +1,20 @@
 #include "Render.h"
+#include "FrameProfiler.h"
 
+namespace
+{
+	// Shader variable names, hashed at compile time
+	constexpr ShaderName ViewName("view");
+	constexpr ShaderName ProjectionName("projection");
+	constexpr ShaderName WorldName("world");
+	constexpr ShaderName AoName("ao");
+	constexpr ShaderName CameraPosName("cameraPos");
+	constexpr ShaderName PrefilterMaxLodName("prefilterMaxLod");
+	constexpr ShaderName ClusterScaleName("clusterScale");
+	constexpr ShaderName ViewDepthName("viewDepth");
+	constexpr ShaderName SliceScaleName("sliceScale");
+	constexpr ShaderName SliceBiasName("sliceBias");
+}
 
 
 Render::Render()
@@ -9,80 +24,232 @@ Render::Render()
 
 Render::~Render()
 {
+	if (instanceBuffer) { instanceBuffer->Release(); }
+	Release(lightBuffer);
+	Release(clusterBuffer);
+	Release(lightIndexBuffer);
 }
 
 
-void Render::RenderPBR(ID3D11Buffer * vertexBuffer, ID3D11Buffer * indexBuffer, SimpleVertexShader * vertexShader, SimplePixelShader * pixelShader, GameEntity * entity, Camera * camera, float m, float r, ID3D11DeviceContext* context)
+void Render::BeginFrame(Camera * camera, ID3D11DeviceContext * context, ID3D11SamplerState * sampler, ID3D11ShaderResourceView * skyIrradianceMap,
+	ID3D11SamplerState * clampSampler, ID3D11ShaderResourceView * skyPrefilterMap, ID3D11ShaderResourceView * brdfLUT, float skyPrefilterMaxLod,
+	LightSystem* lights)
 {
-	vertexShader->SetMatrix4x4("world", entity->GetWorldMatrix());
-	vertexShader->SetMatrix4x4("view", camera->GetView());
-	vertexShader->SetMatrix4x4("projection", camera->GetProjection());
+	this->camera = camera;
+	this->context = context;
+	this->sampler = sampler;
+	this->skyIrradianceMap = skyIrradianceMap;
+	this->clampSampler = clampSampler;
+	this->skyPrefilterMap = skyPrefilterMap;
+	this->brdfLUT = brdfLUT;
+	this->skyPrefilterMaxLod = skyPrefilterMaxLod;
+	this->lights = lights;
+
+	// Clusters split whatever is being drawn to evenly
+	D3D11_VIEWPORT viewport;
+	UINT viewportCount = 1;
+	context->RSGetViewports(&viewportCount, &viewport);
+	clusterScale = XMFLOAT2(LightSystem::ClustersX / viewport.Width, LightSystem::ClustersY / viewport.Height);
+
+	const std::vector<ShaderLight>& shaderLights = lights->GetShaderLights();
+	const std::vector<LightCluster>& clusters = lights->GetClusters();
+	const std::vector<unsigned int>& indices = lights->GetLightIndices();
+	Upload(lightBuffer, shaderLights.empty() ? 0 : &shaderLights[0], (unsigned int)shaderLights.size(), sizeof(ShaderLight));
+	Upload(clusterBuffer, &clusters[0], (unsigned int)clusters.size(), sizeof(LightCluster));
+	Upload(lightIndexBuffer, indices.empty() ? 0 : &indices[0], (unsigned int)indices.size(), sizeof(unsigned int));
+}
 
-	vertexShader->CopyAllBufferData();
-	vertexShader->SetShader();
+// --------------------------------------------------------
+// Everything that is the same for every draw with these
+// shaders - camera, lights and the sky's lighting maps
+// --------------------------------------------------------
+void Render::BindShaders(SimpleVertexShader * vertexShader, SimplePixelShader * pixelShader)
+{
+	this->vertexShader = vertexShader;
+	this->pixelShader = pixelShader;
+	PROFILE_COUNT(StateChanges, 1);
 
-	pixelShader->SetFloat3("albedo", XMFLOAT3(0.85f, 0.74f, 0.60f));
-	pixelShader->SetFloat("metallic", m);
-	pixelShader->SetFloat("roughness", r);
-	pixelShader->SetFloat("a0", 1.0f);
+	// Resolved once here so each draw can set its world matrix directly
+	worldHandle = vertexShader->GetVariableHandle(WorldName);
+
+	vertexShader->SetMatrix4x4(vertexShader->GetVariableHandle(ViewName), camera->GetView());
+	vertexShader->SetMatrix4x4(vertexShader->GetVariableHandle(ProjectionName), camera->GetProjection());
+	vertexShader->CopyBufferData(UpdateFrequency::PerFrame);
+	vertexShader->SetShader();
 
-	pixelShader->SetFloat3("lightPosition1", XMFLOAT3(10.0f, 10.0f, -10.0f));
-	pixelShader->SetFloat3("lightPosition2", XMFLOAT3(10.0f, -10.0f, -10.0f));
-	pixelShader->SetFloat3("lightPosition3", XMFLOAT3(-10.0f, 10.0f, -10.0f));
-	pixelShader->SetFloat3("lightPosition4", XMFLOAT3(-10.0f, -10.0f, -10.0f));
-	pixelShader->SetFloat3("lightColor", XMFLOAT3(300.0f, 300.0f, 300.0f));
+	pixelShader->SetShaderResourceView("irradianceMap", skyIrradianceMap);
+	pixelShader->SetShaderResourceView("prefilterMap", skyPrefilterMap);
+	pixelShader->SetShaderResourceView("brdfLUT", brdfLUT);
+	pixelShader->SetSamplerState("basicSampler", sampler);
+	pixelShader->SetSamplerState("clampSampler", clampSampler);
 
-	pixelShader->SetFloat3("cameraPos", camera->GetPosition());
+	pixelShader->SetShaderResourceView("lights", lightBuffer.View);
+	pixelShader->SetShaderResourceView("lightClusters", clusterBuffer.View);
+	pixelShader->SetShaderResourceView("lightIndices", lightIndexBuffer.View);
 
-	pixelShader->CopyAllBufferData();
-	pixelShader->SetShader();
+	pixelShader->SetFloat(pixelShader->GetVariableHandle(AoName), 1.0f);
+	pixelShader->SetFloat(pixelShader->GetVariableHandle(PrefilterMaxLodName), skyPrefilterMaxLod);
 
-	vertexBuffer = entity->GetMesh()->GetVertexBuffer();
-	indexBuffer = entity->GetMesh()->GetIndexBuffer();
+	// View depth is the third column of the view matrix, which
+	// is the third row as the camera stores it
+	const XMFLOAT4X4& view = camera->GetView();
+	pixelShader->SetFloat2(pixelShader->GetVariableHandle(ClusterScaleName), clusterScale);
+	pixelShader->SetFloat4(pixelShader->GetVariableHandle(ViewDepthName), XMFLOAT4(view._31, view._32, view._33, view._34));
+	pixelShader->SetFloat(pixelShader->GetVariableHandle(SliceScaleName), lights->GetSliceScale());
+	pixelShader->SetFloat(pixelShader->GetVariableHandle(SliceBiasName), lights->GetSliceBias());
 
-	context->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
-	context->IASetIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+	pixelShader->SetFloat3(pixelShader->GetVariableHandle(CameraPosName), camera->GetPosition());
 
-	context->DrawIndexed(entity->GetMesh()->GetIndexCount(), 0, 0);
+	pixelShader->CopyAllBufferData();
+	pixelShader->SetShader();
 }
 
-void Render::RenderRBRMaterial(ID3D11Buffer *& vertexBuffer, ID3D11Buffer *& indexBuffer, SimpleVertexShader *& vertexShader, SimplePixelShader *& pixelShader, GameEntity *& entity, Camera *& camera, float & m, float & r, ID3D11DeviceContext *& context, ID3D11SamplerState *& sampler, ID3D11ShaderResourceView *& skyIrradianceMap)
+void Render::BindMaterial(Material * material)
 {
-	vertexShader->SetMatrix4x4("world", entity->GetWorldMatrix());
-	vertexShader->SetMatrix4x4("view", camera->GetView());
-	vertexShader->SetMatrix4x4("projection", camera->GetProjection());
+	PROFILE_COUNT(StateChanges, 1);
 
-	vertexShader->CopyAllBufferData();
-	vertexShader->SetShader();
+	pixelShader->SetShaderResourceView("albedoMap", material->GetAlbedoMapSRV());
+	pixelShader->SetShaderResourceView("normalMap", material->GetNormalMapSRV());
+	pixelShader->SetShaderResourceView("metallicMap", material->GetMetallicMapSRV());
+	pixelShader->SetShaderResourceView("roughnessMap", material->GetRoughnessMapSRV());
+}
 
-	pixelShader->SetShaderResourceView("irradianceMap", skyIrradianceMap);
-	pixelShader->SetShaderResourceView("albedoMap", entity->GetMaterial()->GetAlbedoMapSRV());
-	pixelShader->SetShaderResourceView("normalMap", entity->GetMaterial()->GetNormalMapSRV());
-	pixelShader->SetShaderResourceView("metallicMap", entity->GetMaterial()->GetMetallicMapSRV());
-	pixelShader->SetShaderResourceView("roughnessMap", entity ->GetMaterial()->GetRoughnessMapSRV());
-	pixelShader->SetSamplerState("basicSampler", sampler);
+void Render::BindMesh(Mesh * mesh)
+{
+	this->mesh = mesh;
+	PROFILE_COUNT(StateChanges, 1);
 
-	pixelShader->SetFloat("a0", 1.0f);
+	ID3D11Buffer* vertexBuffer = D3D11GeometryBackend::GetBuffer(mesh->GetVertexBuffer());
+	ID3D11Buffer* indexBuffer = D3D11GeometryBackend::GetBuffer(mesh->GetIndexBuffer());
 
-	pixelShader->SetFloat3("lightPosition1", XMFLOAT3(10.0f, 10.0f, -10.0f));
-	pixelShader->SetFloat3("lightPosition2", XMFLOAT3(10.0f, -10.0f, -10.0f));
-	pixelShader->SetFloat3("lightPosition3", XMFLOAT3(-10.0f, 10.0f, -10.0f));
-	pixelShader->SetFloat3("lightPosition4", XMFLOAT3(-10.0f, -10.0f, -10.0f));
-	pixelShader->SetFloat3("lightColor", XMFLOAT3(300.0f, 300.0f, 300.0f));
+	context->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
+	context->IASetIndexBuffer(indexBuffer, D3D11GeometryBackend::GetFormat(mesh->GetIndexFormat()), 0);
+}
 
-	pixelShader->SetFloat3("cameraPos", camera->GetPosition());
+void Render::Draw(const DrawCall & draw)
+{
+	vertexShader->SetMatrix4x4(worldHandle, draw.World);
+	vertexShader->CopyBufferData(UpdateFrequency::PerDraw);
 
-	pixelShader->CopyAllBufferData();
-	pixelShader->SetShader();
+	context->DrawIndexed(mesh->GetIndexCount(), 0, 0);
+	PROFILE_COUNT(DrawCalls, 1);
+	PROFILE_COUNT(Indices, mesh->GetIndexCount());
+}
 
+// Only vertex shaders with _PER_INSTANCE inputs take instances
+bool Render::CanInstance()
+{
+	return vertexShader->GetPerInstanceCompatible();
+}
 
-	vertexBuffer = entity->GetMesh()->GetVertexBuffer();
-	indexBuffer = entity->GetMesh()->GetIndexBuffer();
+// --------------------------------------------------------
+// Streams the instances into a dynamic vertex buffer in
+// slot 1 and draws them all at once
+// --------------------------------------------------------
+bool Render::DrawInstanced(const InstanceData * instances, unsigned int count)
+{
+	// Grow the buffer to the next power of two that fits
+	if (count > instanceCapacity)
+	{
+		if (instanceBuffer) { instanceBuffer->Release(); instanceBuffer = 0; }
+
+		instanceCapacity = 64;
+		while (instanceCapacity < count)
+			instanceCapacity *= 2;
+
+		D3D11_BUFFER_DESC ibd;
+		ibd.Usage = D3D11_USAGE_DYNAMIC;
+		ibd.ByteWidth = sizeof(InstanceData) * instanceCapacity;
+		ibd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		ibd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		ibd.MiscFlags = 0;
+		ibd.StructureByteStride = 0;
+
+		ID3D11Device* device = 0;
+		context->GetDevice(&device);
+		HRESULT hr = device->CreateBuffer(&ibd, 0, &instanceBuffer);
+		device->Release();
+
+		if (FAILED(hr))
+		{
+			instanceBuffer = 0;
+			instanceCapacity = 0;
+			return false;
+		}
+	}
+
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	if (FAILED(context->Map(instanceBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+		return false;
+	memcpy(mapped.pData, instances, sizeof(InstanceData) * count);
+	context->Unmap(instanceBuffer, 0);
+
+	UINT instanceStride = sizeof(InstanceData);
+	UINT instanceOffset = 0;
+	context->IASetVertexBuffers(1, 1, &instanceBuffer, &instanceStride, &instanceOffset);
+
+	context->DrawIndexedInstanced(mesh->GetIndexCount(), count, 0, 0, 0);
+	PROFILE_COUNT(DrawCalls, 1);
+	PROFILE_COUNT(Indices, (long long)mesh->GetIndexCount() * count);
+	return true;
+}
 
-	context->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
-	context->IASetIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+// --------------------------------------------------------
+// Copies an array into a dynamic structured buffer, growing
+// it to the next power of two that fits first
+// --------------------------------------------------------
+bool Render::Upload(StructuredBuffer & buffer, const void * data, unsigned int count, unsigned int elementSize)
+{
+	if (count > buffer.Capacity || !buffer.Buffer)
+	{
+		Release(buffer);
+
+		buffer.Capacity = 64;
+		while (buffer.Capacity < count)
+			buffer.Capacity *= 2;
+
+		D3D11_BUFFER_DESC bd;
+		bd.Usage = D3D11_USAGE_DYNAMIC;
+		bd.ByteWidth = elementSize * buffer.Capacity;
+		bd.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		bd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		bd.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+		bd.StructureByteStride = elementSize;
+
+		D3D11_SHADER_RESOURCE_VIEW_DESC srvd = {};
+		srvd.Format = DXGI_FORMAT_UNKNOWN;
+		srvd.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+		srvd.Buffer.FirstElement = 0;
+		srvd.Buffer.NumElements = buffer.Capacity;
+
+		ID3D11Device* device = 0;
+		context->GetDevice(&device);
+		HRESULT hr = device->CreateBuffer(&bd, 0, &buffer.Buffer);
+		if (SUCCEEDED(hr))
+			hr = device->CreateShaderResourceView(buffer.Buffer, &srvd, &buffer.View);
+		device->Release();
+
+		if (FAILED(hr))
+		{
+			Release(buffer);
+			return false;
+		}
+	}
+
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	if (FAILED(context->Map(buffer.Buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+		return false;
+	if (count > 0)
+		memcpy(mapped.pData, data, elementSize * count);
+	context->Unmap(buffer.Buffer, 0);
+	return true;
+}
 
-	context->DrawIndexed(entity->GetMesh()->GetIndexCount(), 0, 0);
+void Render::Release(StructuredBuffer & buffer)
+{
+	if (buffer.View) { buffer.View->Release(); buffer.View = 0; }
+	if (buffer.Buffer) { buffer.Buffer->Release(); buffer.Buffer = 0; }
+	buffer.Capacity = 0;
 }
 
 void Render::RenderSkyBox(ID3D11Buffer *& vertexBuffer, ID3D11Buffer *& indexBuffer, SimpleVertexShader *& vertexShader, SimplePixelShader *& pixelShader, Mesh *& skyMesh, Camera *& camera, ID3D11DeviceContext *& context, ID3D11ShaderResourceView *& skySRV, ID3D11RasterizerState *& skyRasterizerState, ID3D11DepthStencilState *& skyDepthState)
@@ -90,11 +257,11 @@ void Render::RenderSkyBox(ID3D11Buffer *& vertexBuffer, ID3D11Buffer *& indexBuf
 	context->HSSetShader(0, 0, 0);
 	context->DSSetShader(0, 0, 0);
 
-	vertexBuffer = skyMesh->GetVertexBuffer();
-	indexBuffer = skyMesh->GetIndexBuffer();
+	vertexBuffer = D3D11GeometryBackend::GetBuffer(skyMesh->GetVertexBuffer());
+	indexBuffer = D3D11GeometryBackend::GetBuffer(skyMesh->GetIndexBuffer());
 
 	context->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
-	context->IASetIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+	context->IASetIndexBuffer(indexBuffer, D3D11GeometryBackend::GetFormat(skyMesh->GetIndexFormat()), 0);
 
 	vertexShader->SetMatrix4x4("view", camera->GetView());
 	vertexShader->SetMatrix4x4("projection", camera->GetProjection());
@@ -111,6 +278,9 @@ void Render::RenderSkyBox(ID3D11Buffer *& vertexBuffer, ID3D11Buffer *& indexBuf
 	context->OMSetDepthStencilState(skyDepthState, 0);
 
 	context->DrawIndexed(skyMesh->GetIndexCount(), 0, 0);
+	PROFILE_COUNT(DrawCalls, 1);
+	PROFILE_COUNT(Indices, skyMesh->GetIndexCount());
+	PROFILE_COUNT(StateChanges, 1);
 
 	context->RSSetState(0);
 	context->OMSetDepthStencilState(0, 0);
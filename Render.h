@@ -3,23 +3,82 @@
 #include "SimpleShader.h"
 #include "Vertex.h"
 #include "GameEntity.h"
+#include "Material.h"
 #include "Mesh.h"
+#include "D3D11GeometryBackend.h"
 #include "Camera.h"
+#include "RenderQueue.h"
+#include "LightSystem.h"
 #include <DirectXMath.h>
 
 using namespace DirectX;
-class Render
+
+// --------------------------------------------------------
+// Draws through D3D11 - as a RenderBackend it replays a
+// sorted RenderQueue using the frame state from BeginFrame
+// --------------------------------------------------------
+class Render : public RenderBackend
 {
 public:
 	Render();
 	~Render();
 
-	void RenderPBR(ID3D11Buffer* vertexBuffer, ID3D11Buffer* indexBuffer, SimpleVertexShader* vertexShader, SimplePixelShader* pixelShader, GameEntity* entity, Camera* camera, float m, float r, ID3D11DeviceContext* context);
-	void RenderRBRMaterial(ID3D11Buffer* &vertexBuffer, ID3D11Buffer* &indexBuffer, SimpleVertexShader* &vertexShader, SimplePixelShader* &pixelShader, GameEntity* &entity, Camera* &camera, float &m, float &r, ID3D11DeviceContext* &context, ID3D11SamplerState* &sampler, ID3D11ShaderResourceView* &skyIrradianceMap);
+	// Frame state used by everything the queue draws.  The
+	// lights must already be binned for this camera.
+	void BeginFrame(Camera* camera, ID3D11DeviceContext* context, ID3D11SamplerState* sampler, ID3D11ShaderResourceView* skyIrradianceMap,
+		ID3D11SamplerState* clampSampler, ID3D11ShaderResourceView* skyPrefilterMap, ID3D11ShaderResourceView* brdfLUT, float skyPrefilterMaxLod,
+		LightSystem* lights);
+
+	// RenderBackend
+	void BindShaders(SimpleVertexShader* vertexShader, SimplePixelShader* pixelShader);
+	void BindMaterial(Material* material);
+	void BindMesh(Mesh* mesh);
+	void Draw(const DrawCall& draw);
+	bool CanInstance();
+	bool DrawInstanced(const InstanceData* instances, unsigned int count);
+
 	void RenderSkyBox(ID3D11Buffer* &vertexBuffer, ID3D11Buffer* &indexBuffer, SimpleVertexShader* &vertexShader, SimplePixelShader* &pixelShader, Mesh* &skyMesh, Camera* &camera, ID3D11DeviceContext* &context, ID3D11ShaderResourceView* &skySRV, ID3D11RasterizerState* &skyRasterizerState, ID3D11DepthStencilState* &skyDepthState);
 
 private:
+	// A dynamic structured buffer and its view, grown as needed
+	struct StructuredBuffer
+	{
+		ID3D11Buffer* Buffer = 0;
+		ID3D11ShaderResourceView* View = 0;
+		unsigned int Capacity = 0;
+	};
+
 	UINT stride = sizeof(Vertex);
 	UINT offset = 0;
+
+	// Set by BeginFrame
+	Camera* camera = 0;
+	ID3D11DeviceContext* context = 0;
+	ID3D11SamplerState* sampler = 0;
+	ID3D11ShaderResourceView* skyIrradianceMap = 0;
+	ID3D11SamplerState* clampSampler = 0;
+	ID3D11ShaderResourceView* skyPrefilterMap = 0;
+	ID3D11ShaderResourceView* brdfLUT = 0;
+	float skyPrefilterMaxLod = 0.0f;
+	LightSystem* lights = 0;
+	XMFLOAT2 clusterScale = XMFLOAT2(0.0f, 0.0f);
+
+	// Set by the Bind methods
+	SimpleVertexShader* vertexShader = 0;
+	SimplePixelShader* pixelShader = 0;
+	SimpleShaderHandle worldHandle = InvalidShaderHandle;
+	Mesh* mesh = 0;
+
+	// Per-instance data for slot 1, grown as needed
+	ID3D11Buffer* instanceBuffer = 0;
+	unsigned int instanceCapacity = 0;
+
+	// The lights and their clusters, uploaded by BeginFrame
+	StructuredBuffer lightBuffer;
+	StructuredBuffer clusterBuffer;
+	StructuredBuffer lightIndexBuffer;
+
+	bool Upload(StructuredBuffer& buffer, const void* data, unsigned int count, unsigned int elementSize);
+	void Release(StructuredBuffer& buffer);
 };
 
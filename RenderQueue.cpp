@@ -0,0 +1,180 @@
+#include "RenderQueue.h"
+#include <cstring>
+
+namespace
+{
+	// Bit layout of a sort key, from the top down.  Ids past a
+	// field's range wrap, which only costs sort quality - the
+	// queue compares real pointers when deciding what to bind.
+	const int VertexShaderShift = 56;	// 8 bits
+	const int PixelShaderShift = 48;	// 8 bits
+	const int MaterialShift = 36;		// 12 bits
+	const int MeshShift = 24;			// 12 bits
+	const unsigned long long DepthMask = 0xFFFFFF;	// 24 bits
+}
+
+
+RenderQueue::RenderQueue()
+{
+}
+
+RenderQueue::~RenderQueue()
+{
+}
+
+void RenderQueue::Clear()
+{
+	draws.clear();
+	packets.clear();
+}
+
+void RenderQueue::Submit(const DrawCall & draw, float depth)
+{
+	if (depth < 0.0f) depth = 0.0f;
+	if (depth > 1.0f) depth = 1.0f;
+
+	unsigned long long key = 0;
+	key |= (unsigned long long)(GetId(shaderIds, draw.VertexShader) & 0xFF) << VertexShaderShift;
+	key |= (unsigned long long)(GetId(shaderIds, draw.PixelShader) & 0xFF) << PixelShaderShift;
+	key |= (unsigned long long)(GetId(materialIds, draw.DrawMaterial) & 0xFFF) << MaterialShift;
+	key |= (unsigned long long)(GetId(meshIds, draw.DrawMesh) & 0xFFF) << MeshShift;
+	key |= (unsigned long long)(depth * DepthMask) & DepthMask;
+
+	DrawPacket packet;
+	packet.SortKey = key;
+	packet.DrawIndex = (unsigned int)draws.size();
+	packets.push_back(packet);
+	draws.push_back(draw);
+}
+
+// --------------------------------------------------------
+// LSD radix sort, one byte of the key per pass.  All eight
+// histograms are built in one read of the keys, and a pass
+// is skipped when every key has the same value in its byte.
+// --------------------------------------------------------
+void RenderQueue::Sort()
+{
+	size_t count = packets.size();
+	if (count < 2)
+		return;
+
+	unsigned int histograms[8][256];
+	memset(histograms, 0, sizeof(histograms));
+	for (size_t i = 0; i < count; i++)
+	{
+		unsigned long long key = packets[i].SortKey;
+		for (int b = 0; b < 8; b++)
+			histograms[b][(key >> (b * 8)) & 0xFF]++;
+	}
+
+	sortScratch.resize(count);
+	DrawPacket* source = &packets[0];
+	DrawPacket* dest = &sortScratch[0];
+	for (int b = 0; b < 8; b++)
+	{
+		unsigned int* histogram = histograms[b];
+		int shift = b * 8;
+
+		// Nothing to do if one bucket holds everything
+		if (histogram[(source[0].SortKey >> shift) & 0xFF] == count)
+			continue;
+
+		// Turn counts into starting offsets
+		unsigned int offset = 0;
+		for (int i = 0; i < 256; i++)
+		{
+			unsigned int bucketCount = histogram[i];
+			histogram[i] = offset;
+			offset += bucketCount;
+		}
+
+		for (size_t i = 0; i < count; i++)
+			dest[histogram[(source[i].SortKey >> shift) & 0xFF]++] = source[i];
+
+		DrawPacket* swap = source;
+		source = dest;
+		dest = swap;
+	}
+
+	// An odd number of passes leaves the result in the scratch array
+	if (source != &packets[0])
+		packets.swap(sortScratch);
+}
+
+void RenderQueue::Execute(RenderBackend * backend)
+{
+	SimpleVertexShader* vertexShader = 0;
+	SimplePixelShader* pixelShader = 0;
+	Material* material = 0;
+	Mesh* mesh = 0;
+
+	size_t count = packets.size();
+	size_t i = 0;
+	while (i < count)
+	{
+		const DrawCall& draw = draws[packets[i].DrawIndex];
+
+		// Material resources are bound per shader, so a
+		// shader change means binding the material again
+		if (draw.VertexShader != vertexShader || draw.PixelShader != pixelShader)
+		{
+			vertexShader = draw.VertexShader;
+			pixelShader = draw.PixelShader;
+			backend->BindShaders(vertexShader, pixelShader);
+			material = 0;
+		}
+
+		if (draw.DrawMaterial != material)
+		{
+			material = draw.DrawMaterial;
+			backend->BindMaterial(material);
+		}
+
+		if (draw.DrawMesh != mesh)
+		{
+			mesh = draw.DrawMesh;
+			backend->BindMesh(mesh);
+		}
+
+		// Find the end of the run sharing all of this state
+		size_t end = i + 1;
+		while (end < count)
+		{
+			const DrawCall& next = draws[packets[end].DrawIndex];
+			if (next.VertexShader != vertexShader || next.PixelShader != pixelShader ||
+				next.DrawMaterial != material || next.DrawMesh != mesh)
+				break;
+			end++;
+		}
+
+		// Pack the run's instances, still in front to back order,
+		// if the backend can take them
+		bool instanced = false;
+		if (backend->CanInstance())
+		{
+			instances.resize(end - i);
+			for (size_t j = i; j < end; j++)
+				instances[j - i].World = draws[packets[j].DrawIndex].World;
+			instanced = backend->DrawInstanced(&instances[0], (unsigned int)(end - i));
+		}
+
+		if (!instanced)
+		{
+			for (size_t j = i; j < end; j++)
+				backend->Draw(draws[packets[j].DrawIndex]);
+		}
+
+		i = end;
+	}
+}
+
+unsigned int RenderQueue::GetId(std::unordered_map<const void*, unsigned int>& ids, const void * object)
+{
+	std::unordered_map<const void*, unsigned int>::iterator it = ids.find(object);
+	if (it != ids.end())
+		return it->second;
+
+	unsigned int id = (unsigned int)ids.size();
+	ids[object] = id;
+	return id;
+}
@@ -0,0 +1,145 @@
+#pragma once
+#include <DirectXMath.h>
+#include <unordered_map>
+#include <vector>
+
+class Mesh;
+class Material;
+class SimpleVertexShader;
+class SimplePixelShader;
+
+// --------------------------------------------------------
+// Everything needed to draw one object
+// --------------------------------------------------------
+struct DrawCall
+{
+	SimpleVertexShader* VertexShader;
+	SimplePixelShader* PixelShader;
+	Material* DrawMaterial;
+	Mesh* DrawMesh;
+	DirectX::XMFLOAT4X4 World;
+};
+
+// --------------------------------------------------------
+// One instance in an instanced draw - the world matrix is
+// stored transposed, as it is everywhere else
+// --------------------------------------------------------
+struct InstanceData
+{
+	DirectX::XMFLOAT4X4 World;
+};
+
+// --------------------------------------------------------
+// What the queue records - a sort key and which draw it is
+// --------------------------------------------------------
+struct DrawPacket
+{
+	unsigned long long SortKey;
+	unsigned int DrawIndex;
+};
+
+// --------------------------------------------------------
+// Receives the state changes and draws of a sorted queue.
+// The queue only calls a Bind method when that piece of
+// state differs from the previous draw's.
+// --------------------------------------------------------
+class RenderBackend
+{
+public:
+	virtual ~RenderBackend() {}
+
+	virtual void BindShaders(SimpleVertexShader* vertexShader, SimplePixelShader* pixelShader) = 0;
+	virtual void BindMaterial(Material* material) = 0;
+	virtual void BindMesh(Mesh* mesh) = 0;
+	virtual void Draw(const DrawCall& draw) = 0;
+
+	// Whether the bound shaders can take instances - the
+	// queue only packs a run's instances when they can
+	virtual bool CanInstance() { return false; }
+
+	// Draws a run of draws that share all their state in one
+	// call.  Returns false if it couldn't, and the queue falls
+	// back to Draw().
+	virtual bool DrawInstanced(const InstanceData*, unsigned int) { return false; }
+};
+
+// --------------------------------------------------------
+// A backend that just counts what it was asked to do, for
+// checking how much state the queue saved without a GPU
+// --------------------------------------------------------
+class RecordingRenderBackend : public RenderBackend
+{
+public:
+	RecordingRenderBackend(bool instancing = false) { this->instancing = instancing; Reset(); }
+
+	void BindShaders(SimpleVertexShader*, SimplePixelShader*) { ShaderBinds++; }
+	void BindMaterial(Material*) { MaterialBinds++; }
+	void BindMesh(Mesh*) { MeshBinds++; }
+	void Draw(const DrawCall&) { Draws++; }
+	bool CanInstance() { return instancing; }
+	bool DrawInstanced(const InstanceData*, unsigned int count)
+	{
+		Draws++;
+		Instances += count;
+		return true;
+	}
+
+	void Reset() { ShaderBinds = 0; MaterialBinds = 0; MeshBinds = 0; Draws = 0; Instances = 0; }
+
+	unsigned int ShaderBinds;
+	unsigned int MaterialBinds;
+	unsigned int MeshBinds;
+	unsigned int Draws;
+	unsigned int Instances;
+
+private:
+	bool instancing;
+};
+
+// --------------------------------------------------------
+// Collects a frame's draws and replays them in state order
+//
+// Each draw gets a 64-bit key made of (from the top bits
+// down) its vertex shader, pixel shader, material, mesh and
+// depth, so sorting groups matching state together and
+// draws each group front to back.  Keys are sorted with an
+// 8-bit LSD radix sort that skips bytes every key shares.
+//
+// Sorting leaves draws with the same shaders, material and
+// mesh next to each other, and each such run is offered to
+// the backend as one instanced draw.
+// --------------------------------------------------------
+class RenderQueue
+{
+public:
+	RenderQueue();
+	~RenderQueue();
+
+	// Starts a new frame
+	void Clear();
+
+	// Records a draw - depth is 0 at the camera and 1 at the far plane
+	void Submit(const DrawCall& draw, float depth);
+
+	// Orders the recorded draws by their sort keys
+	void Sort();
+
+	// Replays the sorted draws, skipping redundant state and
+	// instancing runs of identical state where it can
+	void Execute(RenderBackend* backend);
+
+	size_t GetCount() { return packets.size(); }
+
+private:
+	std::vector<DrawCall> draws;
+	std::vector<DrawPacket> packets;
+	std::vector<DrawPacket> sortScratch;
+	std::vector<InstanceData> instances;
+
+	// Small ids for the pointers that go into the keys
+	std::unordered_map<const void*, unsigned int> shaderIds;
+	std::unordered_map<const void*, unsigned int> materialIds;
+	std::unordered_map<const void*, unsigned int> meshIds;
+
+	static unsigned int GetId(std::unordered_map<const void*, unsigned int>& ids, const void* object);
+};
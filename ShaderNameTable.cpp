@@ -0,0 +1,32 @@
+#include "ShaderNameTable.h"
+#include <cstring>
+
+void ShaderNameTable::Add(const std::string & name, SimpleShaderHandle handle)
+{
+	Entry entry;
+	entry.Name = name;
+	entry.Handle = handle;
+	entries.insert(std::pair<unsigned int, Entry>(HashShaderName(name.c_str()), entry));
+}
+
+SimpleShaderHandle ShaderNameTable::Find(const ShaderName & name) const
+{
+	return Find(name.Hash, name.Text);
+}
+
+SimpleShaderHandle ShaderNameTable::Find(const std::string & name) const
+{
+	return Find(HashShaderName(name.c_str()), name.c_str());
+}
+
+SimpleShaderHandle ShaderNameTable::Find(unsigned int hash, const char * name) const
+{
+	typedef std::unordered_multimap<unsigned int, Entry>::const_iterator Iterator;
+	std::pair<Iterator, Iterator> range = entries.equal_range(hash);
+	for (Iterator it = range.first; it != range.second; ++it)
+	{
+		if (strcmp(it->second.Name.c_str(), name) == 0)
+			return it->second.Handle;
+	}
+	return InvalidShaderHandle;
+}
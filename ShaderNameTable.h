@@ -0,0 +1,62 @@
+#pragma once
+#include <string>
+#include <unordered_map>
+
+// --------------------------------------------------------
+// A pre-resolved shader variable - an index into the
+// shader's variable list, or InvalidShaderHandle
+// --------------------------------------------------------
+typedef int SimpleShaderHandle;
+const SimpleShaderHandle InvalidShaderHandle = -1;
+
+// --------------------------------------------------------
+// FNV-1a hash of a variable name, usable at compile time
+// --------------------------------------------------------
+constexpr unsigned int HashShaderName(const char* name)
+{
+	unsigned int hash = 2166136261u;
+	while (*name)
+		hash = (hash ^ (unsigned char)*name++) * 16777619u;
+	return hash;
+}
+
+// --------------------------------------------------------
+// A variable name with its hash worked out ahead of time:
+//   constexpr ShaderName World("world");
+// The name is kept so a lookup can tell apart two names
+// that happen to hash the same.
+// --------------------------------------------------------
+struct ShaderName
+{
+	const char* Text;
+	unsigned int Hash;
+
+	constexpr ShaderName(const char* text) : Text(text), Hash(HashShaderName(text)) {}
+};
+
+// --------------------------------------------------------
+// Finds variable handles by name through their hashes.
+// Names that share a hash are all kept, and every lookup
+// checks the name itself, so a collision can't resolve to
+// the wrong variable.
+// --------------------------------------------------------
+class ShaderNameTable
+{
+public:
+	void Add(const std::string& name, SimpleShaderHandle handle);
+	void Clear() { entries.clear(); }
+
+	// Returns InvalidShaderHandle if the name isn't in the table
+	SimpleShaderHandle Find(const ShaderName& name) const;
+	SimpleShaderHandle Find(const std::string& name) const;
+
+private:
+	struct Entry
+	{
+		std::string Name;
+		SimpleShaderHandle Handle;
+	};
+	std::unordered_multimap<unsigned int, Entry> entries;
+
+	SimpleShaderHandle Find(unsigned int hash, const char* name) const;
+};
@@ -1,4 +1,5 @@
 #include "SimpleShader.h"
+#include "FrameProfiler.h"
 
 ///////////////////////////////////////////////////////////////////////////////
 // ------ BASE SIMPLE SHADER --------------------------------------------------
@@ -17,6 +18,7 @@ ISimpleShader::ISimpleShader(ID3D11Device* device, ID3D11DeviceContext* context)
 	constantBufferCount = 0;
 	constantBuffers = 0;
 	shaderBlob = 0;
+	ResetUploadStats();
 }
 
 // --------------------------------------------------------
@@ -39,7 +41,6 @@ void ISimpleShader::CleanUp()
 	for (unsigned int i = 0; i < constantBufferCount; i++)
 	{
 		constantBuffers[i].ConstantBuffer->Release();
-		delete[] constantBuffers[i].LocalDataBuffer;
 	}
 
 	if (constantBuffers)
@@ -56,6 +57,8 @@ void ISimpleShader::CleanUp()
 
 	// Clean up tables
 	varTable.clear();
+	variables.clear();
+	varNameTable.Clear();
 	cbTable.clear();
 	samplerTable.clear();
 	textureTable.clear();
@@ -116,6 +119,8 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		switch (resourceDesc.Type)
 		{
 		case D3D_SIT_TEXTURE: // A texture resource
+		case D3D_SIT_STRUCTURED: // A structured buffer, bound the same way
+		case D3D_SIT_BYTEADDRESS: // A raw buffer, also bound the same way
 		{
 			// Create the SRV wrapper
 			SimpleSRV* srv = new SimpleSRV();
@@ -160,6 +165,7 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		// Set up the buffer and put its pointer in the table
 		constantBuffers[b].BindIndex = bindDesc.BindPoint;
 		constantBuffers[b].Name = bufferDesc.Name;
+		constantBuffers[b].Frequency = GetUpdateFrequency(constantBuffers[b].Name);
 		cbTable.insert(std::pair<std::string, SimpleConstantBuffer*>(bufferDesc.Name, &constantBuffers[b]));
 
 		// Create this constant buffer
@@ -172,10 +178,10 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		newBuffDesc.StructureByteStride = 0;
 		device->CreateBuffer(&newBuffDesc, 0, &constantBuffers[b].ConstantBuffer);
 
-		// Set up the data buffer for this constant buffer
+		// Set up the data buffer for this constant buffer - it
+		// starts zeroed and dirty, since nothing is uploaded yet
 		constantBuffers[b].Size = bufferDesc.Size;
-		constantBuffers[b].LocalDataBuffer = new unsigned char[bufferDesc.Size];
-		ZeroMemory(constantBuffers[b].LocalDataBuffer, bufferDesc.Size);
+		constantBuffers[b].LocalData.Resize(bufferDesc.Size);
 
 		// Loop through all variables in this buffer
 		for (unsigned int v = 0; v < bufferDesc.Variables; v++)
@@ -200,6 +206,11 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 			// Add this variable to the table and the constant buffer
 			varTable.insert(std::pair<std::string, SimpleShaderVariable>(varName, varStruct));
 			constantBuffers[b].Variables.push_back(varStruct);
+
+			// Give it a handle and make it findable by name
+			SimpleShaderHandle handle = (SimpleShaderHandle)variables.size();
+			variables.push_back(varStruct);
+			varNameTable.Add(varName, handle);
 		}
 	}
 
@@ -270,6 +281,9 @@ void ISimpleShader::SetShader()
 // Copies the relevant data to the all of this 
 // shader's constant buffers.  To just copy one
 // buffer, use CopyBufferData()
+//
+// Buffers whose data hasn't changed since they were last
+// copied are skipped.
 // --------------------------------------------------------
 void ISimpleShader::CopyAllBufferData()
 {
@@ -278,12 +292,7 @@ void ISimpleShader::CopyAllBufferData()
 
 	// Loop through the constant buffers and copy all data
 	for (unsigned int i = 0; i < constantBufferCount; i++)
-	{
-		// Copy the entire local data buffer
-		deviceContext->UpdateSubresource(
-			constantBuffers[i].ConstantBuffer, 0, 0,
-			constantBuffers[i].LocalDataBuffer, 0, 0);
-	}
+		UploadBuffer(&constantBuffers[i]);
 }
 
 // --------------------------------------------------------
@@ -311,9 +320,7 @@ void ISimpleShader::CopyBufferData(unsigned int index)
 	if (!cb) return;
 
 	// Copy the data and get out
-	deviceContext->UpdateSubresource(
-		cb->ConstantBuffer, 0, 0, 
-		cb->LocalDataBuffer, 0, 0);
+	UploadBuffer(cb);
 }
 
 // --------------------------------------------------------
@@ -333,9 +340,55 @@ void ISimpleShader::CopyBufferData(std::string bufferName)
 	if (!cb) return;
 
 	// Copy the data and get out
+	UploadBuffer(cb);
+}
+
+// --------------------------------------------------------
+// Copies local data to every constant buffer with the
+// given update frequency
+//
+// frequency - Which group of buffers to copy, so per draw
+//             data can be sent without checking the rest
+// --------------------------------------------------------
+void ISimpleShader::CopyBufferData(UpdateFrequency frequency)
+{
+	// Ensure the shader is valid
+	if (!shaderValid) return;
+
+	for (unsigned int i = 0; i < constantBufferCount; i++)
+	{
+		if (constantBuffers[i].Frequency == frequency)
+			UploadBuffer(&constantBuffers[i]);
+	}
+}
+
+// --------------------------------------------------------
+// Copies a constant buffer's local data to the GPU if any
+// of it changed since the last copy
+//
+// D3D11 can't update part of a constant buffer, so the
+// whole buffer goes up even when only a range is dirty
+// --------------------------------------------------------
+void ISimpleShader::UploadBuffer(SimpleConstantBuffer* cb)
+{
+	if (!cb->LocalData.BeginUpload(uploadStats))
+		return;
+
 	deviceContext->UpdateSubresource(
-		cb->ConstantBuffer, 0, 0, 
-		cb->LocalDataBuffer, 0, 0);
+		cb->ConstantBuffer, 0, 0,
+		cb->LocalData.GetData(), 0, 0);
+
+	PROFILE_COUNT(ConstantBufferBytes, cb->Size);
+}
+
+// --------------------------------------------------------
+// Zeroes the upload counters
+// --------------------------------------------------------
+void ISimpleShader::ResetUploadStats()
+{
+	uploadStats.BytesUploaded = 0;
+	uploadStats.Uploads = 0;
+	uploadStats.SkippedUploads = 0;
 }
 
 
@@ -357,10 +410,7 @@ bool ISimpleShader::SetData(std::string name, const void* data, unsigned int siz
 		return false;
 
 	// Set the data in the local data buffer
-	memcpy(
-		constantBuffers[var->ConstantBufferIndex].LocalDataBuffer + var->ByteOffset,
-		data,
-		size);
+	WriteVariable(var, data, size);
 
 	// Success
 	return true;
@@ -446,6 +496,106 @@ bool ISimpleShader::SetMatrix4x4(std::string name, const DirectX::XMFLOAT4X4 dat
 	return this->SetData(name, &data, sizeof(float) * 16);
 }
 
+// --------------------------------------------------------
+// Looks up a variable's handle by name
+//
+// Returns InvalidShaderHandle if the variable doesn't exist
+// --------------------------------------------------------
+SimpleShaderHandle ISimpleShader::GetVariableHandle(std::string name)
+{
+	return varNameTable.Find(name);
+}
+
+// --------------------------------------------------------
+// Looks up a variable's handle by a name whose hash was
+// worked out at compile time
+//
+// Returns InvalidShaderHandle if the variable doesn't exist
+// --------------------------------------------------------
+SimpleShaderHandle ISimpleShader::GetVariableHandle(const ShaderName& name)
+{
+	return varNameTable.Find(name);
+}
+
+// --------------------------------------------------------
+// Sets a variable through its handle with arbitrary data
+// of the specified size
+//
+// Returns true if data is copied, false if the handle is
+// invalid or sizes don't match
+// --------------------------------------------------------
+bool ISimpleShader::SetData(SimpleShaderHandle handle, const void* data, unsigned int size)
+{
+	// Validate the handle and size
+	if (handle < 0 || handle >= (SimpleShaderHandle)variables.size())
+		return false;
+
+	const SimpleShaderVariable* var = &variables[handle];
+	if (var->Size != size)
+		return false;
+
+	// Set the data in the local data buffer
+	WriteVariable(var, data, size);
+	return true;
+}
+
+// --------------------------------------------------------
+// Copies a variable's data into its local data buffer and
+// marks those bytes dirty, unless the value is unchanged
+// --------------------------------------------------------
+void ISimpleShader::WriteVariable(const SimpleShaderVariable* var, const void* data, unsigned int size)
+{
+	constantBuffers[var->ConstantBufferIndex].LocalData.Write(var->ByteOffset, data, size);
+}
+
+// --------------------------------------------------------
+// Sets INTEGER data through a handle
+// --------------------------------------------------------
+bool ISimpleShader::SetInt(SimpleShaderHandle handle, int data)
+{
+	return this->SetData(handle, &data, sizeof(int));
+}
+
+// --------------------------------------------------------
+// Sets a FLOAT variable through a handle
+// --------------------------------------------------------
+bool ISimpleShader::SetFloat(SimpleShaderHandle handle, float data)
+{
+	return this->SetData(handle, &data, sizeof(float));
+}
+
+// --------------------------------------------------------
+// Sets a FLOAT2 variable through a handle
+// --------------------------------------------------------
+bool ISimpleShader::SetFloat2(SimpleShaderHandle handle, const DirectX::XMFLOAT2& data)
+{
+	return this->SetData(handle, &data, sizeof(float) * 2);
+}
+
+// --------------------------------------------------------
+// Sets a FLOAT3 variable through a handle
+// --------------------------------------------------------
+bool ISimpleShader::SetFloat3(SimpleShaderHandle handle, const DirectX::XMFLOAT3& data)
+{
+	return this->SetData(handle, &data, sizeof(float) * 3);
+}
+
+// --------------------------------------------------------
+// Sets a FLOAT4 variable through a handle
+// --------------------------------------------------------
+bool ISimpleShader::SetFloat4(SimpleShaderHandle handle, const DirectX::XMFLOAT4& data)
+{
+	return this->SetData(handle, &data, sizeof(float) * 4);
+}
+
+// --------------------------------------------------------
+// Sets a MATRIX (4x4) variable through a handle
+// --------------------------------------------------------
+bool ISimpleShader::SetMatrix4x4(SimpleShaderHandle handle, const DirectX::XMFLOAT4X4& data)
+{
+	return this->SetData(handle, &data, sizeof(float) * 16);
+}
+
 // --------------------------------------------------------
 // Gets info about a shader variable, if it exists
 // --------------------------------------------------------
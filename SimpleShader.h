@@ -5,6 +5,8 @@
 #include <d3d11.h>
 #include <d3dcompiler.h>
 #include <DirectXMath.h>
+#include "ConstantBufferData.h"
+#include "ShaderNameTable.h"
 
 #include <unordered_map>
 #include <vector>
@@ -31,8 +33,9 @@ struct SimpleConstantBuffer
 	std::string Name;
 	unsigned int Size;
 	unsigned int BindIndex;
+	UpdateFrequency Frequency;
 	ID3D11Buffer* ConstantBuffer;
-	unsigned char* LocalDataBuffer;
+	ConstantBufferData LocalData;
 	std::vector<SimpleShaderVariable> Variables;
 };
 
@@ -75,6 +78,7 @@ public:
 	void CopyAllBufferData();
 	void CopyBufferData(unsigned int index);
 	void CopyBufferData(std::string bufferName);
+	void CopyBufferData(UpdateFrequency frequency);
 
 	// Sets arbitrary shader data
 	bool SetData(std::string name, const void* data, unsigned int size);
@@ -90,6 +94,21 @@ public:
 	bool SetMatrix4x4(std::string name, const float data[16]);
 	bool SetMatrix4x4(std::string name, const DirectX::XMFLOAT4X4 data);
 
+	// Resolves a variable once so it can be set without any
+	// string building or hashing - handles are per shader
+	SimpleShaderHandle GetVariableHandle(std::string name);
+	SimpleShaderHandle GetVariableHandle(const ShaderName& name);
+
+	// Sets shader data through a handle
+	bool SetData(SimpleShaderHandle handle, const void* data, unsigned int size);
+
+	bool SetInt(SimpleShaderHandle handle, int data);
+	bool SetFloat(SimpleShaderHandle handle, float data);
+	bool SetFloat2(SimpleShaderHandle handle, const DirectX::XMFLOAT2& data);
+	bool SetFloat3(SimpleShaderHandle handle, const DirectX::XMFLOAT3& data);
+	bool SetFloat4(SimpleShaderHandle handle, const DirectX::XMFLOAT4& data);
+	bool SetMatrix4x4(SimpleShaderHandle handle, const DirectX::XMFLOAT4X4& data);
+
 	// Setting shader resources
 	virtual bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv) = 0;
 	virtual bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState) = 0;
@@ -114,6 +133,10 @@ public:
 	// Misc getters
 	ID3DBlob* GetShaderBlob() { return shaderBlob; }
 
+	// Upload counters
+	const SimpleShaderUploadStats& GetUploadStats() { return uploadStats; }
+	void ResetUploadStats();
+
 protected:
 	
 	bool shaderValid;
@@ -130,9 +153,13 @@ protected:
 	std::vector<SimpleSampler*>	samplerStates;
 	std::unordered_map<std::string, SimpleConstantBuffer*> cbTable;
 	std::unordered_map<std::string, SimpleShaderVariable> varTable;
+	std::vector<SimpleShaderVariable> variables;	// Indexed by handle
+	ShaderNameTable varNameTable;
 	std::unordered_map<std::string, SimpleSRV*> textureTable;
 	std::unordered_map<std::string, SimpleSampler*> samplerTable;
 
+	SimpleShaderUploadStats uploadStats;
+
 	// Pure virtual functions for dealing with shader types
 	virtual bool CreateShader(ID3DBlob* shaderBlob) = 0;
 	virtual void SetShaderAndCBs() = 0;
@@ -142,6 +169,12 @@ protected:
 	// Helpers for finding data by name
 	SimpleShaderVariable* FindVariable(std::string name, int size);
 	SimpleConstantBuffer* FindConstantBuffer(std::string name);
+
+	// Writes a variable into its buffer's local data
+	void WriteVariable(const SimpleShaderVariable* var, const void* data, unsigned int size);
+
+	// Uploads a buffer if its local data has changed
+	void UploadBuffer(SimpleConstantBuffer* cb);
 };
 
 // --------------------------------------------------------
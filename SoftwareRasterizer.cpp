@@ -0,0 +1,751 @@
+#include "SoftwareRasterizer.h"
+#include "ImageWriter.h"
+#include "PBRKernels.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+using namespace DirectX;
+
+namespace
+{
+	// Tiles are square, and a whole number of 2x2 quads across
+	const int TileSize = 32;
+
+	// Positions snap to 1/256th of a pixel, as they do in D3D
+	const int SubpixelBits = 8;
+	const long long SubpixelScale = 1 << SubpixelBits;
+
+	// Triangles are clipped once they reach this far outside
+	// the screen, in NDC units, which keeps the snapped
+	// positions small enough for exact edge functions
+	const float GuardBand = 4.0f;
+
+	// Below this many vertices per job, jobs cost more than they save
+	const size_t MinVerticesPerJob = 4096;
+
+	// --------------------------------------------------------
+	// The planes triangles are clipped against - anything with
+	// a negative dot product with the clip position is outside
+	// --------------------------------------------------------
+	const XMFLOAT4 ClipPlanes[5] =
+	{
+		XMFLOAT4(0, 0, 1, 0),				// Near
+		XMFLOAT4(1, 0, 0, GuardBand),		// Left
+		XMFLOAT4(-1, 0, 0, GuardBand),		// Right
+		XMFLOAT4(0, 1, 0, GuardBand),		// Bottom
+		XMFLOAT4(0, -1, 0, GuardBand)		// Top
+	};
+
+	const unsigned int NoTriangle = 0xFFFFFFFF;
+
+	// --------------------------------------------------------
+	// The shading inputs and results for each visible pixel
+	// of a tile, one array of TileSize * TileSize after another
+	// --------------------------------------------------------
+	enum ShadingChannel
+	{
+		PositionX, PositionY, PositionZ,
+		ViewX, ViewY, ViewZ,
+		NormalX, NormalY, NormalZ,
+		AlbedoR, AlbedoG, AlbedoB,
+		F0R, F0G, F0B,
+		Metallic,
+		Roughness,
+		NdotV,
+		DirectR, DirectG, DirectB,
+		AmbientFresnelR, AmbientFresnelG, AmbientFresnelB,
+		ChannelCount
+	};
+
+	// --------------------------------------------------------
+	// Bilinear, wrapping lookup of an 8-bit map.  A null map
+	// gives the constant instead.
+	// --------------------------------------------------------
+	XMFLOAT4 SampleMap(const DecodedImage* map, float u, float v, const XMFLOAT4& constant)
+	{
+		if (!map || map->Width <= 0 || map->Height <= 0)
+			return constant;
+
+		float tx = u * map->Width - 0.5f;
+		float ty = v * map->Height - 0.5f;
+		float fx0 = floorf(tx);
+		float fy0 = floorf(ty);
+		float fx = tx - fx0;
+		float fy = ty - fy0;
+
+		int x0 = ((int)fx0 % map->Width + map->Width) % map->Width;
+		int y0 = ((int)fy0 % map->Height + map->Height) % map->Height;
+		int x1 = x0 + 1 < map->Width ? x0 + 1 : 0;
+		int y1 = y0 + 1 < map->Height ? y0 + 1 : 0;
+
+		const unsigned char* a = &map->Pixels[((size_t)y0 * map->Width + x0) * 4];
+		const unsigned char* b = &map->Pixels[((size_t)y0 * map->Width + x1) * 4];
+		const unsigned char* c = &map->Pixels[((size_t)y1 * map->Width + x0) * 4];
+		const unsigned char* d = &map->Pixels[((size_t)y1 * map->Width + x1) * 4];
+
+		float wa = (1 - fx) * (1 - fy);
+		float wb = fx * (1 - fy);
+		float wc = (1 - fx) * fy;
+		float wd = fx * fy;
+		float texel[4];
+		for (int i = 0; i < 4; i++)
+			texel[i] = (a[i] * wa + b[i] * wb + c[i] * wc + d[i] * wd) * (1.0f / 255.0f);
+		return XMFLOAT4(texel[0], texel[1], texel[2], texel[3]);
+	}
+
+	// --------------------------------------------------------
+	// A cube map lookup, blending between two mips for a
+	// fractional level
+	// --------------------------------------------------------
+	XMFLOAT3 SampleCube(const CubeMapData* mips, int mipCount, const XMFLOAT3& direction, float level)
+	{
+		level = level < 0.0f ? 0.0f : (level > mipCount - 1 ? (float)(mipCount - 1) : level);
+		int mip0 = (int)level;
+		int mip1 = mip0 + 1 < mipCount ? mip0 + 1 : mip0;
+		float blend = level - mip0;
+
+		XMFLOAT3 texel = mips[mip0].Sample(direction.x, direction.y, direction.z);
+		if (mip1 != mip0 && blend > 0.0f)
+		{
+			XMFLOAT3 next = mips[mip1].Sample(direction.x, direction.y, direction.z);
+			texel.x += (next.x - texel.x) * blend;
+			texel.y += (next.y - texel.y) * blend;
+			texel.z += (next.z - texel.z) * blend;
+		}
+		return texel;
+	}
+
+	// --------------------------------------------------------
+	// Bilinear, clamped lookup of the BRDF table - NdotV
+	// across and roughness down
+	// --------------------------------------------------------
+	XMFLOAT2 SampleLut(const std::vector<XMFLOAT2>& lut, int size, float u, float v)
+	{
+		float maxCoord = (float)(size - 1);
+		float tx = u * size - 0.5f;
+		float ty = v * size - 0.5f;
+		tx = tx < 0.0f ? 0.0f : (tx > maxCoord ? maxCoord : tx);
+		ty = ty < 0.0f ? 0.0f : (ty > maxCoord ? maxCoord : ty);
+
+		int x0 = (int)tx;
+		int y0 = (int)ty;
+		int x1 = x0 + 1 < size ? x0 + 1 : x0;
+		int y1 = y0 + 1 < size ? y0 + 1 : y0;
+		float fx = tx - x0;
+		float fy = ty - y0;
+
+		const XMFLOAT2& a = lut[y0 * size + x0];
+		const XMFLOAT2& b = lut[y0 * size + x1];
+		const XMFLOAT2& c = lut[y1 * size + x0];
+		const XMFLOAT2& d = lut[y1 * size + x1];
+		float wa = (1 - fx) * (1 - fy);
+		float wb = fx * (1 - fy);
+		float wc = (1 - fx) * fy;
+		float wd = fx * fy;
+		return XMFLOAT2(a.x * wa + b.x * wb + c.x * wc + d.x * wd, a.y * wa + b.y * wb + c.y * wc + d.y * wd);
+	}
+}
+
+
+SoftwareRasterizer::SoftwareRasterizer(int width, int height, JobSystem* jobs)
+{
+	this->width = width;
+	this->height = height;
+	this->jobs = jobs;
+
+	tilesX = (width + TileSize - 1) / TileSize;
+	tilesY = (height + TileSize - 1) / TileSize;
+	bins.resize(tilesX * tilesY);
+	tileTimings.resize(tilesX * tilesY);
+
+	color.resize(width * height);
+	depth.resize(width * height);
+	frame = SoftwareFrame();
+}
+
+SoftwareRasterizer::~SoftwareRasterizer()
+{
+}
+
+void SoftwareRasterizer::Begin(const SoftwareFrame & frame)
+{
+	this->frame = frame;
+
+	vertices.clear();
+	triangles.clear();
+	materials.clear();
+	for (size_t i = 0; i < bins.size(); i++)
+		bins[i].clear();
+
+	XMMATRIX view = XMMatrixTranspose(XMLoadFloat4x4(&frame.View));
+	XMMATRIX projection = XMMatrixTranspose(XMLoadFloat4x4(&frame.Projection));
+	XMStoreFloat4x4(&viewProjection, XMMatrixMultiply(view, projection));
+
+	// The sky is drawn as if the camera never moved
+	view.r[3] = XMVectorSet(0, 0, 0, 1);
+	XMStoreFloat4x4(&inverseViewProjection, XMMatrixInverse(0, XMMatrixMultiply(view, projection)));
+
+	color.assign(color.size(), frame.ClearColor);
+	depth.assign(depth.size(), 1.0f);
+}
+
+void SoftwareRasterizer::Draw(const Vertex * input, int vertexCount, const void * indices, IndexFormat format, int indexCount, const XMFLOAT4X4 & world, const SoftwareMaterial & material)
+{
+	unsigned int materialIndex = (unsigned int)materials.size();
+	materials.push_back(material);
+
+	// Same as the material vertex shader
+	unsigned int base = (unsigned int)vertices.size();
+	vertices.resize(base + vertexCount);
+	XMMATRIX worldMatrix = XMMatrixTranspose(XMLoadFloat4x4(&world));
+	XMMATRIX worldViewProjection = XMMatrixMultiply(worldMatrix, XMLoadFloat4x4(&viewProjection));
+
+	auto transform = [&](size_t first, size_t last) {
+		for (size_t i = first; i < last; i++)
+		{
+			const Vertex& in = input[i];
+			RasterVertex& out = vertices[base + i];
+
+			XMVECTOR position = XMVectorSet(in.Position.x, in.Position.y, in.Position.z, 1.0f);
+			XMStoreFloat4(&out.Clip, XMVector4Transform(position, worldViewProjection));
+			XMStoreFloat3(&out.WorldPos, XMVector4Transform(position, worldMatrix));
+			XMStoreFloat3(&out.Normal, XMVector3TransformNormal(XMLoadFloat3(&in.Normal), worldMatrix));
+
+			XMVECTOR tangent = XMVectorSet(in.Tangent.x, in.Tangent.y, in.Tangent.z, 0.0f);
+			XMStoreFloat4(&out.Tangent, XMVectorSetW(XMVector3TransformNormal(tangent, worldMatrix), in.Tangent.w));
+			out.UV = in.UV;
+		}
+	};
+	if (jobs && (size_t)vertexCount >= MinVerticesPerJob * 2)
+		jobs->Wait(jobs->ParallelFor("Transform vertices", vertexCount, MinVerticesPerJob, transform));
+	else
+		transform(0, vertexCount);
+
+	// Triangles go into the bins in order, so this stays on one thread
+	for (int i = 0; i + 2 < indexCount; i += 3)
+	{
+		unsigned int a, b, c;
+		if (format == IndexFormat::UInt16)
+		{
+			const unsigned short* shorts = (const unsigned short*)indices;
+			a = shorts[i]; b = shorts[i + 1]; c = shorts[i + 2];
+		}
+		else
+		{
+			const unsigned int* ints = (const unsigned int*)indices;
+			a = ints[i]; b = ints[i + 1]; c = ints[i + 2];
+		}
+
+		if (a >= (unsigned int)vertexCount || b >= (unsigned int)vertexCount || c >= (unsigned int)vertexCount)
+			continue;
+		ClipTriangle(base + a, base + b, base + c, materialIndex);
+	}
+}
+
+void SoftwareRasterizer::Draw(const MeshData & mesh, const XMFLOAT4X4 & world, const SoftwareMaterial & material)
+{
+	Draw(mesh.Verts, mesh.NumVerts, mesh.Indices, mesh.Format, mesh.NumIndices, world, material);
+}
+
+void SoftwareRasterizer::End()
+{
+	int tileCount = tilesX * tilesY;
+	auto drawTiles = [this](size_t first, size_t last) {
+		for (size_t tile = first; tile < last; tile++)
+			DrawTile((int)tile);
+	};
+
+	if (jobs)
+		jobs->Wait(jobs->ParallelFor("Draw tiles", tileCount, 1, drawTiles));
+	else
+		drawTiles(0, tileCount);
+}
+
+// --------------------------------------------------------
+// Saturated and rounded, as a UNORM render target stores it
+// --------------------------------------------------------
+void SoftwareRasterizer::GetPixels(std::vector<unsigned char>& rgba)
+{
+	rgba.resize(color.size() * 4);
+	for (size_t i = 0; i < color.size(); i++)
+	{
+		const float* channels = &color[i].x;
+		for (int c = 0; c < 3; c++)
+		{
+			float value = channels[c] < 0.0f ? 0.0f : (channels[c] > 1.0f ? 1.0f : channels[c]);
+			rgba[i * 4 + c] = (unsigned char)(value * 255.0f + 0.5f);
+		}
+		rgba[i * 4 + 3] = 255;
+	}
+}
+
+bool SoftwareRasterizer::SavePng(const char * file)
+{
+	std::vector<unsigned char> rgba;
+	GetPixels(rgba);
+	return ImageWriter::WritePng(file, width, height, &rgba[0]);
+}
+
+bool SoftwareRasterizer::SaveExr(const char * file)
+{
+	return ImageWriter::WriteExr(file, width, height, &color[0].x);
+}
+
+void SoftwareRasterizer::PrintTileTimings()
+{
+	double total = 0.0;
+	int slowest = 0;
+	int triangleCount = 0;
+	for (size_t i = 0; i < tileTimings.size(); i++)
+	{
+		total += tileTimings[i].Milliseconds;
+		triangleCount += tileTimings[i].Triangles;
+		if (tileTimings[i].Milliseconds > tileTimings[slowest].Milliseconds)
+			slowest = (int)i;
+	}
+
+	printf("\n%d x %d tiles, %d binned triangles - %.2f ms in total, %.3f ms per tile, slowest %.3f ms at (%d, %d)",
+		tilesX, tilesY, triangleCount, total, total / tileTimings.size(),
+		tileTimings[slowest].Milliseconds, tileTimings[slowest].X, tileTimings[slowest].Y);
+}
+
+// --------------------------------------------------------
+// Clips against the near plane and the guard band, then
+// fans what's left into triangles
+// --------------------------------------------------------
+void SoftwareRasterizer::ClipTriangle(unsigned int a, unsigned int b, unsigned int c, unsigned int material)
+{
+	unsigned int polygon[8] = { a, b, c };
+	int count = 3;
+
+	// Which planes each vertex is outside of
+	unsigned int outside[3] = {};
+	for (int i = 0; i < 3; i++)
+	{
+		XMVECTOR clip = XMLoadFloat4(&vertices[polygon[i]].Clip);
+		for (int p = 0; p < 5; p++)
+		{
+			if (XMVectorGetX(XMVector4Dot(clip, XMLoadFloat4(&ClipPlanes[p]))) < 0.0f)
+				outside[i] |= 1 << p;
+		}
+	}
+
+	// All outside the same plane, or nothing to clip
+	if (outside[0] & outside[1] & outside[2])
+		return;
+	if (!(outside[0] | outside[1] | outside[2]))
+	{
+		SetUpTriangle(a, b, c, material);
+		return;
+	}
+
+	unsigned int crossed = outside[0] | outside[1] | outside[2];
+	for (int p = 0; p < 5 && count >= 3; p++)
+	{
+		if (!(crossed & (1 << p)))
+			continue;
+
+		XMVECTOR plane = XMLoadFloat4(&ClipPlanes[p]);
+		unsigned int clipped[8];
+		int clippedCount = 0;
+		for (int i = 0; i < count; i++)
+		{
+			unsigned int current = polygon[i];
+			unsigned int next = polygon[(i + 1) % count];
+			float currentDistance = XMVectorGetX(XMVector4Dot(XMLoadFloat4(&vertices[current].Clip), plane));
+			float nextDistance = XMVectorGetX(XMVector4Dot(XMLoadFloat4(&vertices[next].Clip), plane));
+
+			if (currentDistance >= 0.0f)
+				clipped[clippedCount++] = current;
+			if ((currentDistance >= 0.0f) == (nextDistance >= 0.0f))
+				continue;
+
+			// Always from the inside vertex out, so triangles
+			// sharing the edge get exactly the same new vertex
+			unsigned int from = currentDistance >= 0.0f ? current : next;
+			unsigned int to = currentDistance >= 0.0f ? next : current;
+			float fromDistance = currentDistance >= 0.0f ? currentDistance : nextDistance;
+			float toDistance = currentDistance >= 0.0f ? nextDistance : currentDistance;
+			float t = fromDistance / (fromDistance - toDistance);
+
+			const RasterVertex& v0 = vertices[from];
+			const RasterVertex& v1 = vertices[to];
+			RasterVertex v;
+			XMStoreFloat4(&v.Clip, XMVectorLerp(XMLoadFloat4(&v0.Clip), XMLoadFloat4(&v1.Clip), t));
+			XMStoreFloat3(&v.WorldPos, XMVectorLerp(XMLoadFloat3(&v0.WorldPos), XMLoadFloat3(&v1.WorldPos), t));
+			XMStoreFloat3(&v.Normal, XMVectorLerp(XMLoadFloat3(&v0.Normal), XMLoadFloat3(&v1.Normal), t));
+			XMStoreFloat4(&v.Tangent, XMVectorLerp(XMLoadFloat4(&v0.Tangent), XMLoadFloat4(&v1.Tangent), t));
+			XMStoreFloat2(&v.UV, XMVectorLerp(XMLoadFloat2(&v0.UV), XMLoadFloat2(&v1.UV), t));
+
+			clipped[clippedCount++] = (unsigned int)vertices.size();
+			vertices.push_back(v);
+		}
+
+		count = clippedCount;
+		for (int i = 0; i < count; i++)
+			polygon[i] = clipped[i];
+	}
+
+	for (int i = 1; i + 1 < count; i++)
+		SetUpTriangle(polygon[0], polygon[i], polygon[i + 1], material);
+}
+
+// --------------------------------------------------------
+// Snaps a clipped triangle to the subpixel grid, works out
+// its edge functions and adds it to every tile it touches
+// --------------------------------------------------------
+void SoftwareRasterizer::SetUpTriangle(unsigned int a, unsigned int b, unsigned int c, unsigned int material)
+{
+	RasterTriangle triangle;
+	triangle.Vertices[0] = a;
+	triangle.Vertices[1] = b;
+	triangle.Vertices[2] = c;
+	triangle.Material = material;
+
+	long long x[3], y[3];
+	for (int i = 0; i < 3; i++)
+	{
+		const XMFLOAT4& clip = vertices[triangle.Vertices[i]].Clip;
+		float invW = 1.0f / clip.w;
+		double screenX = (clip.x * invW * 0.5 + 0.5) * width;
+		double screenY = (0.5 - clip.y * invW * 0.5) * height;
+
+		x[i] = (long long)floor(screenX * SubpixelScale + 0.5);
+		y[i] = (long long)floor(screenY * SubpixelScale + 0.5);
+		triangle.Z[i] = clip.z * invW;
+		triangle.InvW[i] = invW;
+	}
+
+	// Front faces are clockwise on screen, as D3D's default,
+	// and back faces are culled
+	long long area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+	if (area <= 0)
+		return;
+	triangle.InvArea = (float)(1.0 / (double)area);
+
+	for (int i = 0; i < 3; i++)
+	{
+		int j = (i + 1) % 3;
+		int k = (i + 2) % 3;
+		triangle.A[i] = y[j] - y[k];
+		triangle.B[i] = x[k] - x[j];
+		triangle.C[i] = -triangle.A[i] * x[j] - triangle.B[i] * y[j];
+
+		// Pixels exactly on an edge only belong to it if it's a
+		// top edge or a left edge
+		bool topLeft = triangle.A[i] > 0 || (triangle.A[i] == 0 && triangle.B[i] > 0);
+		triangle.Bias[i] = topLeft ? 0 : -1;
+	}
+
+	long long minX = std::min(x[0], std::min(x[1], x[2])) >> SubpixelBits;
+	long long minY = std::min(y[0], std::min(y[1], y[2])) >> SubpixelBits;
+	long long maxX = std::max(x[0], std::max(x[1], x[2])) >> SubpixelBits;
+	long long maxY = std::max(y[0], std::max(y[1], y[2])) >> SubpixelBits;
+	triangle.MinX = (int)std::max(minX, 0LL);
+	triangle.MinY = (int)std::max(minY, 0LL);
+	triangle.MaxX = (int)std::min(maxX, (long long)width - 1);
+	triangle.MaxY = (int)std::min(maxY, (long long)height - 1);
+	if (triangle.MinX > triangle.MaxX || triangle.MinY > triangle.MaxY)
+		return;
+
+	unsigned int index = (unsigned int)triangles.size();
+	triangles.push_back(triangle);
+
+	for (int tileY = triangle.MinY / TileSize; tileY <= triangle.MaxY / TileSize; tileY++)
+		for (int tileX = triangle.MinX / TileSize; tileX <= triangle.MaxX / TileSize; tileX++)
+			bins[tileY * tilesX + tileX].push_back(index);
+}
+
+void SoftwareRasterizer::DrawTile(int tile)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	int tileX = tile % tilesX;
+	int tileY = tile / tilesX;
+	TileBuffer buffer;
+	buffer.Triangles.assign(TileSize * TileSize, NoTriangle);
+	buffer.Weights.resize(TileSize * TileSize * 3);
+
+	const std::vector<unsigned int>& bin = bins[tile];
+	for (size_t i = 0; i < bin.size(); i++)
+		DrawTriangle(triangles[bin[i]], bin[i], tileX, tileY, buffer);
+
+	ShadeTile(tileX, tileY, buffer);
+	if (frame.Sky)
+		FillSky(tileX, tileY);
+
+	RasterTileTiming& timing = tileTimings[tile];
+	timing.X = tileX * TileSize;
+	timing.Y = tileY * TileSize;
+	timing.Triangles = (int)bin.size();
+	timing.Milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// --------------------------------------------------------
+// Walks the 2x2 quads of the triangle's bounds within one
+// tile.  Lanes are the top left, top right, bottom left
+// and bottom right pixels.
+// --------------------------------------------------------
+void SoftwareRasterizer::DrawTriangle(const RasterTriangle & triangle, unsigned int index, int tileX, int tileY, TileBuffer & buffer)
+{
+	int startX = std::max(triangle.MinX, tileX * TileSize) & ~1;
+	int startY = std::max(triangle.MinY, tileY * TileSize) & ~1;
+	int endX = std::min(triangle.MaxX, tileX * TileSize + TileSize - 1);
+	int endY = std::min(triangle.MaxY, tileY * TileSize + TileSize - 1);
+
+	const int laneX[4] = { 0, 1, 0, 1 };
+	const int laneY[4] = { 0, 0, 1, 1 };
+	XMVECTOR z0 = XMVectorReplicate(triangle.Z[0]);
+	XMVECTOR z1 = XMVectorReplicate(triangle.Z[1]);
+	XMVECTOR z2 = XMVectorReplicate(triangle.Z[2]);
+	XMVECTOR invArea = XMVectorReplicate(triangle.InvArea);
+
+	for (int y = startY; y <= endY; y += 2)
+	{
+		for (int x = startX; x <= endX; x += 2)
+		{
+			// Edge functions at each pixel center
+			long long px = ((long long)x << SubpixelBits) + SubpixelScale / 2;
+			long long py = ((long long)y << SubpixelBits) + SubpixelScale / 2;
+			XMFLOAT4A edges[3];
+			int covered[4] = { 1, 1, 1, 1 };
+			for (int e = 0; e < 3; e++)
+			{
+				long long origin = triangle.A[e] * px + triangle.B[e] * py + triangle.C[e];
+				for (int lane = 0; lane < 4; lane++)
+				{
+					long long value = origin + triangle.A[e] * laneX[lane] * SubpixelScale + triangle.B[e] * laneY[lane] * SubpixelScale;
+					covered[lane] &= value + triangle.Bias[e] >= 0;
+					(&edges[e].x)[lane] = (float)value;
+				}
+			}
+
+			int pixels[4];
+			bool any = false;
+			for (int lane = 0; lane < 4; lane++)
+			{
+				int pixelX = x + laneX[lane];
+				int pixelY = y + laneY[lane];
+				covered[lane] &= pixelX < width && pixelY < height;
+				pixels[lane] = covered[lane] ? pixelY * width + pixelX : -1;
+				any |= covered[lane] != 0;
+			}
+			if (!any)
+				continue;
+
+			// Depth is interpolated in screen space
+			XMVECTOR w0 = XMLoadFloat4A(&edges[0]) * invArea;
+			XMVECTOR w1 = XMLoadFloat4A(&edges[1]) * invArea;
+			XMVECTOR w2 = XMLoadFloat4A(&edges[2]) * invArea;
+			XMFLOAT4A z;
+			XMStoreFloat4A(&z, w0 * z0 + w1 * z1 + w2 * z2);
+
+			any = false;
+			for (int lane = 0; lane < 4; lane++)
+			{
+				if (pixels[lane] < 0)
+					continue;
+				float pixelDepth = (&z.x)[lane];
+				if (pixelDepth < 0.0f || pixelDepth >= depth[pixels[lane]])
+					pixels[lane] = -1;
+				else
+					any = true;
+			}
+			if (!any)
+				continue;
+
+			// Everything else is interpolated in perspective, and
+			// only shaded once the tile's visibility is settled
+			XMVECTOR p0 = w0 * triangle.InvW[0];
+			XMVECTOR p1 = w1 * triangle.InvW[1];
+			XMVECTOR p2 = w2 * triangle.InvW[2];
+			XMVECTOR invSum = XMVectorReciprocal(p0 + p1 + p2);
+			XMFLOAT4A weights[3];
+			XMStoreFloat4A(&weights[0], p0 * invSum);
+			XMStoreFloat4A(&weights[1], p1 * invSum);
+			XMStoreFloat4A(&weights[2], p2 * invSum);
+
+			for (int lane = 0; lane < 4; lane++)
+			{
+				if (pixels[lane] < 0)
+					continue;
+				depth[pixels[lane]] = (&z.x)[lane];
+
+				int local = (y + laneY[lane] - tileY * TileSize) * TileSize + x + laneX[lane] - tileX * TileSize;
+				buffer.Triangles[local] = index;
+				for (int i = 0; i < 3; i++)
+					buffer.Weights[local * 3 + i] = (&weights[i].x)[lane];
+			}
+		}
+	}
+}
+
+// --------------------------------------------------------
+// PBRMaterialPixelShader.hlsl for every pixel left visible
+// in the tile.  Surfaces are set up a pixel at a time, then
+// the lights and the ambient Fresnel term go through the
+// BRDF kernels for the whole tile at once.
+// --------------------------------------------------------
+void SoftwareRasterizer::ShadeTile(int tileX, int tileY, TileBuffer & buffer)
+{
+	const size_t tileArea = TileSize * TileSize;
+	buffer.Pixels.clear();
+	buffer.Channels.resize(tileArea * ChannelCount);
+	float* channels[ChannelCount];
+	for (int c = 0; c < ChannelCount; c++)
+		channels[c] = &buffer.Channels[c * tileArea];
+
+	XMVECTOR cameraPosition = XMLoadFloat3(&frame.CameraPosition);
+	for (size_t local = 0; local < tileArea; local++)
+	{
+		if (buffer.Triangles[local] == NoTriangle)
+			continue;
+
+		const RasterTriangle& triangle = triangles[buffer.Triangles[local]];
+		const RasterVertex& va = vertices[triangle.Vertices[0]];
+		const RasterVertex& vb = vertices[triangle.Vertices[1]];
+		const RasterVertex& vc = vertices[triangle.Vertices[2]];
+		const SoftwareMaterial& material = materials[triangle.Material];
+		const float* weights = &buffer.Weights[local * 3];
+		auto interpolate = [weights](float a, float b, float c) { return weights[0] * a + weights[1] * b + weights[2] * c; };
+
+		float u = interpolate(va.UV.x, vb.UV.x, vc.UV.x);
+		float v = interpolate(va.UV.y, vb.UV.y, vc.UV.y);
+
+		//Sampling all the textures
+		XMFLOAT4 albedo = SampleMap(material.AlbedoMap, u, v, XMFLOAT4(material.Albedo.x, material.Albedo.y, material.Albedo.z, 1.0f));
+		XMFLOAT4 normalFromMap = SampleMap(material.NormalMap, u, v, XMFLOAT4(0.5f, 0.5f, 1.0f, 1.0f));
+		float metallic = SampleMap(material.MetallicMap, u, v, XMFLOAT4(material.Metallic, material.Metallic, material.Metallic, 1.0f)).x;
+		float roughness = SampleMap(material.RoughnessMap, u, v, XMFLOAT4(material.Roughness, material.Roughness, material.Roughness, 1.0f)).x;
+
+		//Normal Map
+		XMVECTOR tangent = XMVector3Normalize(XMVectorSet(
+			interpolate(va.Tangent.x, vb.Tangent.x, vc.Tangent.x),
+			interpolate(va.Tangent.y, vb.Tangent.y, vc.Tangent.y),
+			interpolate(va.Tangent.z, vb.Tangent.z, vc.Tangent.z), 0.0f));
+		float handedness = interpolate(va.Tangent.w, vb.Tangent.w, vc.Tangent.w);
+		XMVECTOR N = XMVector3Normalize(XMVectorSet(
+			interpolate(va.Normal.x, vb.Normal.x, vc.Normal.x),
+			interpolate(va.Normal.y, vb.Normal.y, vc.Normal.y),
+			interpolate(va.Normal.z, vb.Normal.z, vc.Normal.z), 0.0f));
+		XMVECTOR T = XMVector3Normalize(tangent - N * XMVector3Dot(tangent, N));
+		XMVECTOR B = XMVector3Cross(T, N) * handedness;
+		XMVECTOR normal = XMVector3Normalize(
+			T * (normalFromMap.x * 2 - 1) +
+			B * (normalFromMap.y * 2 - 1) +
+			N * (normalFromMap.z * 2 - 1));
+
+		XMVECTOR worldPos = XMVectorSet(
+			interpolate(va.WorldPos.x, vb.WorldPos.x, vc.WorldPos.x),
+			interpolate(va.WorldPos.y, vb.WorldPos.y, vc.WorldPos.y),
+			interpolate(va.WorldPos.z, vb.WorldPos.z, vc.WorldPos.z), 1.0f);
+		XMVECTOR view = XMVector3Normalize(cameraPosition - worldPos);
+
+		size_t i = buffer.Pixels.size();
+		buffer.Pixels.push_back((int)local);
+
+		XMFLOAT3 stored;
+		XMStoreFloat3(&stored, worldPos);
+		channels[PositionX][i] = stored.x; channels[PositionY][i] = stored.y; channels[PositionZ][i] = stored.z;
+		XMStoreFloat3(&stored, view);
+		channels[ViewX][i] = stored.x; channels[ViewY][i] = stored.y; channels[ViewZ][i] = stored.z;
+		XMStoreFloat3(&stored, normal);
+		channels[NormalX][i] = stored.x; channels[NormalY][i] = stored.y; channels[NormalZ][i] = stored.z;
+
+		const float* albedoChannels = &albedo.x;
+		for (int c = 0; c < 3; c++)
+		{
+			float linear = powf(albedoChannels[c], 2.2f);
+			channels[AlbedoR + c][i] = linear;
+			channels[F0R + c][i] = 0.04f + (linear - 0.04f) * metallic;
+			channels[DirectR + c][i] = 0.0f;
+		}
+		channels[Metallic][i] = metallic;
+		channels[Roughness][i] = roughness;
+		channels[NdotV][i] = std::max(XMVectorGetX(XMVector3Dot(normal, view)), 0.0f);
+	}
+
+	size_t count = buffer.Pixels.size();
+	if (count == 0)
+		return;
+
+	//Reflectance equation
+	KernelFloat3 worldPos = { channels[PositionX], channels[PositionY], channels[PositionZ] };
+	KernelFloat3 view = { channels[ViewX], channels[ViewY], channels[ViewZ] };
+	KernelFloat3 normal = { channels[NormalX], channels[NormalY], channels[NormalZ] };
+	KernelFloat3 albedo = { channels[AlbedoR], channels[AlbedoG], channels[AlbedoB] };
+	KernelFloat3 f0 = { channels[F0R], channels[F0G], channels[F0B] };
+	KernelFloat3Out direct = { channels[DirectR], channels[DirectG], channels[DirectB] };
+	KernelFloat3Out ambientFresnel = { channels[AmbientFresnelR], channels[AmbientFresnelG], channels[AmbientFresnelB] };
+
+	PBRKernels::AccumulateRadiance(count, worldPos, view, normal, albedo, channels[Metallic], channels[Roughness], f0,
+		frame.Lights, frame.LightCount, direct);
+	PBRKernels::FresnelSchlickRoughness(count, channels[NdotV], f0, channels[Roughness], ambientFresnel);
+
+	//Image based lighting, then Reinhard and gamma
+	int mipCount = frame.Prefiltered ? (int)frame.Prefiltered->size() : 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		XMFLOAT3 n(channels[NormalX][i], channels[NormalY][i], channels[NormalZ][i]);
+		XMFLOAT3 v(channels[ViewX][i], channels[ViewY][i], channels[ViewZ][i]);
+		float roughness = channels[Roughness][i];
+
+		XMFLOAT3 irradiance(0, 0, 0);
+		if (frame.Irradiance)
+			irradiance = SampleCube(frame.Irradiance, 1, n, 0.0f);
+
+		float reflectScale = 2.0f * (n.x * v.x + n.y * v.y + n.z * v.z);
+		XMFLOAT3 reflected(n.x * reflectScale - v.x, n.y * reflectScale - v.y, n.z * reflectScale - v.z);
+		XMFLOAT3 prefiltered(0, 0, 0);
+		if (mipCount > 0)
+			prefiltered = SampleCube(&(*frame.Prefiltered)[0], mipCount, reflected, roughness * (mipCount - 1));
+
+		XMFLOAT2 envBRDF(0, 0);
+		if (frame.BRDFLut && frame.BRDFLutSize > 0)
+			envBRDF = SampleLut(*frame.BRDFLut, frame.BRDFLutSize, channels[NdotV][i], roughness);
+
+		int local = buffer.Pixels[i];
+		float* out = &color[(tileY * TileSize + local / TileSize) * width + tileX * TileSize + local % TileSize].x;
+		const float* irradianceChannels = &irradiance.x;
+		const float* prefilteredChannels = &prefiltered.x;
+		for (int c = 0; c < 3; c++)
+		{
+			float kS = channels[AmbientFresnelR + c][i];
+			float diffuse = channels[AlbedoR + c][i] * irradianceChannels[c];
+			float specular = prefilteredChannels[c] * (kS * envBRDF.x + envBRDF.y);
+			float ambient = ((1.0f - kS) * diffuse + specular) * frame.AO;
+
+			float value = ambient + channels[DirectR + c][i];
+			value = value / (value + 1.0f);
+			out[c] = powf(value, 1.0f / 2.2f);
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Anything in the tile nothing was drawn over gets the sky
+// in the direction through its pixel
+// --------------------------------------------------------
+void SoftwareRasterizer::FillSky(int tileX, int tileY)
+{
+	XMMATRIX inverse = XMLoadFloat4x4(&inverseViewProjection);
+	int endX = std::min(tileX * TileSize + TileSize, width);
+	int endY = std::min(tileY * TileSize + TileSize, height);
+
+	for (int y = tileY * TileSize; y < endY; y++)
+	{
+		float ndcY = 1.0f - (y + 0.5f) * 2.0f / height;
+		for (int x = tileX * TileSize; x < endX; x++)
+		{
+			if (depth[y * width + x] < 1.0f)
+				continue;
+
+			float ndcX = (x + 0.5f) * 2.0f / width - 1.0f;
+			XMFLOAT3 direction;
+			XMStoreFloat3(&direction, XMVector3TransformCoord(XMVectorSet(ndcX, ndcY, 1.0f, 1.0f), inverse));
+			color[y * width + x] = frame.Sky->Sample(direction.x, direction.y, direction.z);
+		}
+	}
+}
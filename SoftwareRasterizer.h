@@ -0,0 +1,195 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+#include "CubeMap.h"
+#include "ImageDecoder.h"
+#include "JobSystem.h"
+#include "LightSystem.h"
+#include "Mesh.h"
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// The camera, lights and sky lighting for a frame - the
+// same values the PBR material shader gets per frame
+// --------------------------------------------------------
+struct SoftwareFrame
+{
+	// Transposed, as the camera stores them
+	DirectX::XMFLOAT4X4 View;
+	DirectX::XMFLOAT4X4 Projection;
+	DirectX::XMFLOAT3 CameraPosition;
+
+	// Every light, as LightSystem hands them to the shader.
+	// The shader only loops over the lights binned into each
+	// pixel's cluster, but binning only leaves out lights that
+	// fade to nothing there, so shading them all matches it.
+	const ShaderLight* Lights;
+	int LightCount;
+	float AO;
+
+	// Drawn wherever nothing else is - left null, the clear
+	// color shows instead
+	const CubeMapData* Sky;
+	DirectX::XMFLOAT3 ClearColor;
+
+	// The baked lighting - irradiance divided by PI, the
+	// prefiltered mips and the BRDF table with its size
+	const CubeMapData* Irradiance;
+	const std::vector<CubeMapData>* Prefiltered;
+	const std::vector<DirectX::XMFLOAT2>* BRDFLut;
+	int BRDFLutSize;
+};
+
+// --------------------------------------------------------
+// What a mesh is drawn with.  Any map left null uses the
+// constant value below it.
+// --------------------------------------------------------
+struct SoftwareMaterial
+{
+	const DecodedImage* AlbedoMap;
+	const DecodedImage* NormalMap;
+	const DecodedImage* MetallicMap;
+	const DecodedImage* RoughnessMap;
+
+	DirectX::XMFLOAT3 Albedo;		// As stored in the map, before gamma
+	float Metallic;
+	float Roughness;
+};
+
+// How long one tile took to draw
+struct RasterTileTiming
+{
+	int X;
+	int Y;
+	int Triangles;
+	double Milliseconds;
+};
+
+// --------------------------------------------------------
+// Draws meshes on the CPU with the PBR material shader
+//
+// Vertices go through the same transforms as the material
+// vertex shader.  Triangles are clipped, snapped to 8 bits
+// of subpixel precision and binned into 32 x 32 tiles,
+// which are drawn in parallel.  Within a tile, coverage
+// uses exact integer edge functions with the D3D top-left
+// rule, and pixels are depth tested a 2x2 quad at a time,
+// one pixel per DirectXMath vector lane.  Only the pixels
+// still visible once a tile is done get shaded.
+//
+// Shading follows PBRMaterialPixelShader.hlsl step by step
+// - GGX / Smith-Schlick / Fresnel for each light, faded by
+// its range and spot cone, run through PBRKernels for the
+// whole tile, then irradiance and split-sum specular from
+// the baked maps, then Reinhard and gamma.  The color
+// buffer holds what that shader (or the sky shader) would
+// have written.
+//
+// Triangles stay in submission order within each tile, so
+// the image doesn't depend on how many threads drew it.
+// Textures are sampled bilinearly from their top mip.
+// --------------------------------------------------------
+class SoftwareRasterizer
+{
+public:
+	SoftwareRasterizer(int width, int height, JobSystem* jobs = 0);
+	~SoftwareRasterizer();
+
+	// Starts a frame, dropping everything drawn before
+	void Begin(const SoftwareFrame& frame);
+
+	// Transforms and bins a mesh, which is shaded in End().
+	// Textures must stay alive until then.
+	void Draw(const Vertex* vertices, int vertexCount, const void* indices, IndexFormat format, int indexCount,
+		const DirectX::XMFLOAT4X4& world, const SoftwareMaterial& material);
+	void Draw(const MeshData& mesh, const DirectX::XMFLOAT4X4& world, const SoftwareMaterial& material);
+
+	// Draws every tile, then fills what's left with the sky
+	void End();
+
+	int GetWidth() { return width; }
+	int GetHeight() { return height; }
+
+	// Row by row from the top
+	const std::vector<DirectX::XMFLOAT3>& GetColor() { return color; }
+	void GetPixels(std::vector<unsigned char>& rgba);
+
+	bool SavePng(const char* file);
+	bool SaveExr(const char* file);
+
+	// One entry per tile, row by row
+	const std::vector<RasterTileTiming>& GetTileTimings() { return tileTimings; }
+	void PrintTileTimings();
+
+private:
+	// A vertex after the vertex shader
+	struct RasterVertex
+	{
+		DirectX::XMFLOAT4 Clip;
+		DirectX::XMFLOAT3 WorldPos;
+		DirectX::XMFLOAT3 Normal;
+		DirectX::XMFLOAT4 Tangent;
+		DirectX::XMFLOAT2 UV;
+	};
+
+	// --------------------------------------------------------
+	// A triangle ready to rasterize.  Edge i is opposite
+	// vertex i, and is A * x + B * y + C in 1/256ths of a
+	// pixel, positive inside.
+	// --------------------------------------------------------
+	struct RasterTriangle
+	{
+		long long A[3];
+		long long B[3];
+		long long C[3];
+		long long Bias[3];		// -1 for edges the top-left rule excludes
+		float Z[3];
+		float InvW[3];
+		float InvArea;
+		int MinX, MinY, MaxX, MaxY;
+		unsigned int Vertices[3];
+		unsigned int Material;
+	};
+
+	// --------------------------------------------------------
+	// Which triangle each pixel of a tile shows, and where on
+	// it, then the visible pixels' shading inputs as one array
+	// per channel
+	// --------------------------------------------------------
+	struct TileBuffer
+	{
+		std::vector<unsigned int> Triangles;
+		std::vector<float> Weights;		// Perspective correct, three per pixel
+		std::vector<int> Pixels;
+		std::vector<float> Channels;
+	};
+
+	SoftwareRasterizer(const SoftwareRasterizer&) = delete;
+	SoftwareRasterizer& operator=(const SoftwareRasterizer&) = delete;
+
+	int width;
+	int height;
+	int tilesX;
+	int tilesY;
+	JobSystem* jobs;
+
+	SoftwareFrame frame;
+	DirectX::XMFLOAT4X4 viewProjection;
+	DirectX::XMFLOAT4X4 inverseViewProjection;
+
+	std::vector<RasterVertex> vertices;
+	std::vector<RasterTriangle> triangles;
+	std::vector<SoftwareMaterial> materials;
+	std::vector<std::vector<unsigned int>> bins;
+
+	std::vector<DirectX::XMFLOAT3> color;
+	std::vector<float> depth;
+	std::vector<RasterTileTiming> tileTimings;
+
+	void SetUpTriangle(unsigned int a, unsigned int b, unsigned int c, unsigned int material);
+	void ClipTriangle(unsigned int a, unsigned int b, unsigned int c, unsigned int material);
+	void DrawTile(int tile);
+	void DrawTriangle(const RasterTriangle& triangle, unsigned int index, int tileX, int tileY, TileBuffer& buffer);
+	void ShadeTile(int tileX, int tileY, TileBuffer& buffer);
+	void FillSky(int tileX, int tileY);
+};
@@ -0,0 +1,303 @@
+#include "SpecularBaker.h"
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	// Below this many samples per job, jobs cost more than they save
+	const int MinSamplesPerJob = 64 * 1024;
+
+	// --------------------------------------------------------
+	// The i-th of count Hammersley points in [0, 1)^2
+	// --------------------------------------------------------
+	inline XMFLOAT2 Hammersley(unsigned int i, unsigned int count)
+	{
+		unsigned int bits = i;
+		bits = (bits << 16) | (bits >> 16);
+		bits = ((bits & 0x55555555) << 1) | ((bits & 0xAAAAAAAA) >> 1);
+		bits = ((bits & 0x33333333) << 2) | ((bits & 0xCCCCCCCC) >> 2);
+		bits = ((bits & 0x0F0F0F0F) << 4) | ((bits & 0xF0F0F0F0) >> 4);
+		bits = ((bits & 0x00FF00FF) << 8) | ((bits & 0xFF00FF00) >> 8);
+		return XMFLOAT2((float)i / count, bits * 2.3283064365386963e-10f);
+	}
+
+	// --------------------------------------------------------
+	// A GGX distributed half vector around +Z.  Roughness is
+	// squared first, as in PBRMaterialPixelShader.hlsl.
+	// --------------------------------------------------------
+	inline XMFLOAT3 ImportanceSampleGGX(XMFLOAT2 xi, float roughness)
+	{
+		float a = roughness * roughness;
+		float phi = XM_2PI * xi.x;
+		float cosTheta = sqrtf((1.0f - xi.y) / (1.0f + (a * a - 1.0f) * xi.y));
+		float sinTheta = sqrtf(1.0f - cosTheta * cosTheta);
+		return XMFLOAT3(cosf(phi) * sinTheta, sinf(phi) * sinTheta, cosTheta);
+	}
+
+	// --------------------------------------------------------
+	// A set of samples in structure of arrays form, padded to
+	// a multiple of four with zero weight samples.  Vectors
+	// needn't be 16-byte aligned, so groups are loaded with
+	// unaligned loads.
+	// --------------------------------------------------------
+	struct SampleTable
+	{
+		std::vector<XMFLOAT4> X;
+		std::vector<XMFLOAT4> Y;
+		std::vector<XMFLOAT4> Z;
+		std::vector<XMFLOAT4> Weight;
+		std::vector<int> Mip;
+
+		void Add(float x, float y, float z, float weight, int mip)
+		{
+			size_t i = Mip.size();
+			if (i % 4 == 0)
+			{
+				XMFLOAT4 pad(0, 0, 0, 0);
+				X.push_back(pad);
+				Y.push_back(pad);
+				Z.push_back(XMFLOAT4(1, 1, 1, 1));
+				Weight.push_back(pad);
+			}
+			(&X.back().x)[i % 4] = x;
+			(&Y.back().x)[i % 4] = y;
+			(&Z.back().x)[i % 4] = z;
+			(&Weight.back().x)[i % 4] = weight;
+			Mip.push_back(mip);
+		}
+
+		size_t Count() const { return Mip.size(); }
+	};
+
+	// --------------------------------------------------------
+	// Light directions around +Z for one roughness, each with
+	// its NdotL weight and the source mip it should read from
+	// so that a sample covers about as much as its texel
+	// --------------------------------------------------------
+	void BuildPrefilterSamples(float roughness, int sampleCount, int sourceSize, int sourceMips, SampleTable& table)
+	{
+		float a = roughness * roughness;
+		float a2 = a * a;
+		float texelSolidAngle = 4.0f * XM_PI / (6.0f * sourceSize * sourceSize);
+
+		for (int i = 0; i < sampleCount; i++)
+		{
+			XMFLOAT3 h = ImportanceSampleGGX(Hammersley(i, sampleCount), roughness);
+
+			// Reflect the view, which is the normal, about H
+			float lx = 2.0f * h.z * h.x;
+			float ly = 2.0f * h.z * h.y;
+			float lz = 2.0f * h.z * h.z - 1.0f;
+			if (lz <= 0.0f)
+				continue;
+
+			// With V = N the pdf is D * NdotH / (4 * VdotH) = D / 4
+			float denom = h.z * h.z * (a2 - 1.0f) + 1.0f;
+			float d = a2 / (XM_PI * denom * denom);
+			float sampleSolidAngle = 1.0f / (sampleCount * d * 0.25f + 0.0001f);
+
+			float lod = 0.5f * log2f(sampleSolidAngle / texelSolidAngle) + 1.0f;
+			int mip = (int)(lod + 0.5f);
+			if (mip < 0) mip = 0;
+			if (mip > sourceMips - 1) mip = sourceMips - 1;
+
+			table.Add(lx, ly, lz, lz, mip);
+		}
+	}
+
+	// --------------------------------------------------------
+	// Prefilters rows [first, last), counting across all six
+	// faces, of one output mip
+	// --------------------------------------------------------
+	void PrefilterRows(const std::vector<CubeMapData>& source, const SampleTable& samples, int first, int last, CubeMapData* output)
+	{
+		int size = output->Size;
+		size_t groups = samples.Weight.size();
+
+		for (int row = first; row < last; row++)
+		{
+			int f = row / size;
+			int y = row % size;
+			XMFLOAT3* texels = &output->Faces[f][y * size];
+
+			for (int x = 0; x < size; x++)
+			{
+				// Tangent frame around this texel's direction
+				XMFLOAT3 n = CubeMapData::TexelDirection(f, size, x, y);
+				XMVECTOR normal = XMLoadFloat3(&n);
+				XMVECTOR up = fabsf(n.z) < 0.999f ? XMVectorSet(0, 0, 1, 0) : XMVectorSet(1, 0, 0, 0);
+				XMVECTOR tangent = XMVector3Normalize(XMVector3Cross(up, normal));
+				XMVECTOR bitangent = XMVector3Cross(normal, tangent);
+
+				XMFLOAT3 t, b;
+				XMStoreFloat3(&t, tangent);
+				XMStoreFloat3(&b, bitangent);
+
+				float r = 0.0f, g = 0.0f, bl = 0.0f, total = 0.0f;
+				for (size_t s = 0; s < groups; s++)
+				{
+					// Four sample directions into world space at once
+					XMVECTOR sx = XMLoadFloat4(&samples.X[s]);
+					XMVECTOR sy = XMLoadFloat4(&samples.Y[s]);
+					XMVECTOR sz = XMLoadFloat4(&samples.Z[s]);
+					XMVECTOR wx = sx * t.x + sy * b.x + sz * n.x;
+					XMVECTOR wy = sx * t.y + sy * b.y + sz * n.y;
+					XMVECTOR wz = sx * t.z + sy * b.z + sz * n.z;
+
+					XMFLOAT4A dx, dy, dz;
+					XMStoreFloat4A(&dx, wx);
+					XMStoreFloat4A(&dy, wy);
+					XMStoreFloat4A(&dz, wz);
+
+					const float* weights = &samples.Weight[s].x;
+					for (int i = 0; i < 4; i++)
+					{
+						float weight = weights[i];
+						if (weight <= 0.0f)
+							continue;
+
+						const CubeMapData& mip = source[samples.Mip[s * 4 + i]];
+						XMFLOAT3 color = mip.Sample((&dx.x)[i], (&dy.x)[i], (&dz.x)[i]);
+						r += color.x * weight;
+						g += color.y * weight;
+						bl += color.z * weight;
+						total += weight;
+					}
+				}
+
+				float scale = total > 0.0f ? 1.0f / total : 0.0f;
+				texels[x] = XMFLOAT3(r * scale, g * scale, bl * scale);
+			}
+		}
+	}
+
+	// --------------------------------------------------------
+	// Integrates rows [first, last) of the BRDF table
+	// --------------------------------------------------------
+	void IntegrateRows(int size, int sampleCount, int first, int last, std::vector<XMFLOAT2>* lut)
+	{
+		SampleTable halfVectors;
+		for (int y = first; y < last; y++)
+		{
+			float roughness = (y + 0.5f) / size;
+
+			// Every texel in a row shares its half vectors
+			halfVectors = SampleTable();
+			for (int i = 0; i < sampleCount; i++)
+			{
+				XMFLOAT3 h = ImportanceSampleGGX(Hammersley(i, sampleCount), roughness);
+				halfVectors.Add(h.x, h.y, h.z, 1.0f, 0);
+			}
+
+			// Smith G with the image based lighting k
+			float k = roughness * roughness * 0.5f;
+			XMVECTOR kv = XMVectorReplicate(k);
+			XMVECTOR oneMinusK = XMVectorReplicate(1.0f - k);
+			XMVECTOR one = XMVectorSplatOne();
+			XMVECTOR zero = XMVectorZero();
+
+			for (int x = 0; x < size; x++)
+			{
+				float nDotV = (x + 0.5f) / size;
+				XMVECTOR vx = XMVectorReplicate(sqrtf(1.0f - nDotV * nDotV));
+				XMVECTOR vz = XMVectorReplicate(nDotV);
+				XMVECTOR gv = vz / (vz * oneMinusK + kv);
+
+				XMVECTOR scale = zero;
+				XMVECTOR bias = zero;
+				for (size_t s = 0; s < halfVectors.Weight.size(); s++)
+				{
+					XMVECTOR hx = XMLoadFloat4(&halfVectors.X[s]);
+					XMVECTOR hz = XMLoadFloat4(&halfVectors.Z[s]);
+					XMVECTOR valid = XMLoadFloat4(&halfVectors.Weight[s]);
+
+					XMVECTOR vDotH = XMVectorMax(vx * hx + vz * hz, zero);
+					XMVECTOR nDotL = vDotH * hz * 2.0f - vz;
+					XMVECTOR nDotLClamped = XMVectorMax(nDotL, zero);
+
+					XMVECTOR gl = nDotLClamped / (nDotLClamped * oneMinusK + kv);
+					XMVECTOR visibility = gv * gl * vDotH / (hz * vz);
+					visibility = XMVectorSelect(zero, visibility * valid, XMVectorGreater(nDotL, zero));
+
+					XMVECTOR fc = one - vDotH;
+					XMVECTOR fc2 = fc * fc;
+					fc = fc2 * fc2 * fc;
+
+					scale = XMVectorMultiplyAdd(one - fc, visibility, scale);
+					bias = XMVectorMultiplyAdd(fc, visibility, bias);
+				}
+
+				XMFLOAT4A a, b;
+				XMStoreFloat4A(&a, scale);
+				XMStoreFloat4A(&b, bias);
+				(*lut)[y * size + x] = XMFLOAT2(
+					(a.x + a.y + a.z + a.w) / sampleCount,
+					(b.x + b.y + b.z + b.w) / sampleCount);
+			}
+		}
+	}
+
+	// --------------------------------------------------------
+	// Runs rows [0, rows) of this many samples each through
+	// body, across the jobs if there are enough of them
+	// --------------------------------------------------------
+	template<typename Body>
+	void ForEachRow(JobSystem* jobs, const char* name, int rows, long long samplesPerRow, Body body)
+	{
+		long long rowsPerJob = (MinSamplesPerJob + samplesPerRow - 1) / samplesPerRow;
+		if (rowsPerJob < 1)
+			rowsPerJob = 1;
+		if (!jobs || rows < rowsPerJob * 2)
+		{
+			body(0, rows);
+			return;
+		}
+
+		jobs->Wait(jobs->ParallelFor(name, rows, (size_t)rowsPerJob, [&](size_t first, size_t last) {
+			body((int)first, (int)last);
+		}));
+	}
+}
+
+
+void SpecularBaker::Prefilter(const CubeMapData & radiance, int mipCount, int sampleCount, std::vector<CubeMapData>& mips, JobSystem* jobs)
+{
+	// Box filtered copies of the source, so wide lobes can read
+	// from small mips instead of aliasing on the full one
+	std::vector<CubeMapData> source(1, radiance);
+	while (source.back().Size > 1)
+	{
+		source.push_back(CubeMapData());
+		source[source.size() - 2].Downsample(source.back());
+	}
+
+	mips.resize(mipCount);
+	mips[0] = radiance;
+
+	for (int m = 1; m < mipCount; m++)
+	{
+		int size = radiance.Size >> m;
+		if (size < 1)
+			size = 1;
+		mips[m].Resize(size);
+
+		float roughness = (float)m / (mipCount - 1);
+		SampleTable samples;
+		BuildPrefilterSamples(roughness, sampleCount, radiance.Size, (int)source.size(), samples);
+
+		CubeMapData* mip = &mips[m];
+		ForEachRow(jobs, "Prefilter specular", size * 6, (long long)size * samples.Count(), [&](int first, int last) {
+			PrefilterRows(source, samples, first, last, mip);
+		});
+	}
+}
+
+void SpecularBaker::IntegrateBRDF(int size, int sampleCount, std::vector<XMFLOAT2>& lut, JobSystem* jobs)
+{
+	lut.assign(size * size, XMFLOAT2(0, 0));
+
+	ForEachRow(jobs, "Integrate BRDF", size, (long long)size * sampleCount, [&](int first, int last) {
+		IntegrateRows(size, sampleCount, first, last, &lut);
+	});
+}
\ No newline at end of file
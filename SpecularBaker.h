@@ -0,0 +1,28 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+#include "CubeMap.h"
+#include "JobSystem.h"
+
+// --------------------------------------------------------
+// Bakes the two halves of split-sum specular lighting
+//
+// Prefilter convolves an environment cube map with the GGX
+// lobe at increasing roughness, one mip per roughness step,
+// and IntegrateBRDF builds the scale and bias applied to F0,
+// indexed by NdotV across and roughness down.  Both use
+// Hammersley points importance sampled by GGX, evaluate four
+// samples per DirectXMath vector and, given a job system,
+// split rows across its threads.
+// --------------------------------------------------------
+class SpecularBaker
+{
+public:
+	// Fills mipCount cube maps, each half the size of the one
+	// before, with roughness going from 0 at mip 0 to 1 at
+	// the last mip
+	static void Prefilter(const CubeMapData& radiance, int mipCount, int sampleCount, std::vector<CubeMapData>& mips, JobSystem* jobs = 0);
+
+	// Fills a size x size table of (scale, bias) pairs
+	static void IntegrateBRDF(int size, int sampleCount, std::vector<DirectX::XMFLOAT2>& lut, JobSystem* jobs = 0);
+};
\ No newline at end of file
@@ -0,0 +1,225 @@
+#include "TangentGenerator.h"
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// Below this many triangles per slice, slices cost more than they save
+	const int MinTrianglesPerSlice = 16384;
+
+	// Below this many vertices per job, resolving isn't worth splitting
+	const int MinVerticesPerJob = 16384;
+
+	// --------------------------------------------------------
+	// Positions and UVs split into one array per component
+	// --------------------------------------------------------
+	struct SourceArrays
+	{
+		std::vector<float> X, Y, Z;
+		std::vector<float> U, V;
+	};
+
+	// --------------------------------------------------------
+	// One slice's running tangent and bitangent sums
+	// --------------------------------------------------------
+	struct Accumulator
+	{
+		std::vector<float> TX, TY, TZ;
+		std::vector<float> BX, BY, BZ;
+
+		void Resize(int numVerts)
+		{
+			TX.assign(numVerts, 0.0f); TY.assign(numVerts, 0.0f); TZ.assign(numVerts, 0.0f);
+			BX.assign(numVerts, 0.0f); BY.assign(numVerts, 0.0f); BZ.assign(numVerts, 0.0f);
+		}
+
+		void Add(unsigned int v, float tx, float ty, float tz, float bx, float by, float bz)
+		{
+			TX[v] += tx; TY[v] += ty; TZ[v] += tz;
+			BX[v] += bx; BY[v] += by; BZ[v] += bz;
+		}
+	};
+
+	// --------------------------------------------------------
+	// Adds the tangent and bitangent of triangles [first, last)
+	// to each of their corners.  Four triangles go through the
+	// math at once, one per vector lane.
+	// --------------------------------------------------------
+	void AccumulateTriangles(const SourceArrays& src, const unsigned int* indices, int first, int last, Accumulator& acc)
+	{
+		const float* X = &src.X[0];
+		const float* Y = &src.Y[0];
+		const float* Z = &src.Z[0];
+		const float* U = &src.U[0];
+		const float* V = &src.V[0];
+
+		int t = first;
+		for (; t + 4 <= last; t += 4)
+		{
+			const unsigned int* tri = indices + t * 3;
+			unsigned int a0 = tri[0], b0 = tri[1], c0 = tri[2];
+			unsigned int a1 = tri[3], b1 = tri[4], c1 = tri[5];
+			unsigned int a2 = tri[6], b2 = tri[7], c2 = tri[8];
+			unsigned int a3 = tri[9], b3 = tri[10], c3 = tri[11];
+
+			// Edges relative to the first corner, one triangle per lane
+			XMVECTOR ax = XMVectorSet(X[a0], X[a1], X[a2], X[a3]);
+			XMVECTOR ay = XMVectorSet(Y[a0], Y[a1], Y[a2], Y[a3]);
+			XMVECTOR az = XMVectorSet(Z[a0], Z[a1], Z[a2], Z[a3]);
+			XMVECTOR x1 = XMVectorSet(X[b0], X[b1], X[b2], X[b3]) - ax;
+			XMVECTOR y1 = XMVectorSet(Y[b0], Y[b1], Y[b2], Y[b3]) - ay;
+			XMVECTOR z1 = XMVectorSet(Z[b0], Z[b1], Z[b2], Z[b3]) - az;
+			XMVECTOR x2 = XMVectorSet(X[c0], X[c1], X[c2], X[c3]) - ax;
+			XMVECTOR y2 = XMVectorSet(Y[c0], Y[c1], Y[c2], Y[c3]) - ay;
+			XMVECTOR z2 = XMVectorSet(Z[c0], Z[c1], Z[c2], Z[c3]) - az;
+
+			// Same for the uv's
+			XMVECTOR au = XMVectorSet(U[a0], U[a1], U[a2], U[a3]);
+			XMVECTOR av = XMVectorSet(V[a0], V[a1], V[a2], V[a3]);
+			XMVECTOR s1 = XMVectorSet(U[b0], U[b1], U[b2], U[b3]) - au;
+			XMVECTOR t1 = XMVectorSet(V[b0], V[b1], V[b2], V[b3]) - av;
+			XMVECTOR s2 = XMVectorSet(U[c0], U[c1], U[c2], U[c3]) - au;
+			XMVECTOR t2 = XMVectorSet(V[c0], V[c1], V[c2], V[c3]) - av;
+
+			// Triangles with no uv area contribute nothing
+			XMVECTOR det = s1 * t2 - s2 * t1;
+			XMVECTOR zero = XMVectorZero();
+			XMVECTOR r = XMVectorSelect(XMVectorReciprocal(det), zero, XMVectorEqual(det, zero));
+
+			XMFLOAT4A tx, ty, tz, bx, by, bz;
+			XMStoreFloat4A(&tx, (t2 * x1 - t1 * x2) * r);
+			XMStoreFloat4A(&ty, (t2 * y1 - t1 * y2) * r);
+			XMStoreFloat4A(&tz, (t2 * z1 - t1 * z2) * r);
+			XMStoreFloat4A(&bx, (s1 * x2 - s2 * x1) * r);
+			XMStoreFloat4A(&by, (s1 * y2 - s2 * y1) * r);
+			XMStoreFloat4A(&bz, (s1 * z2 - s2 * z1) * r);
+
+			// Scatter back to the corners
+			const float* lanesTX = &tx.x; const float* lanesTY = &ty.x; const float* lanesTZ = &tz.x;
+			const float* lanesBX = &bx.x; const float* lanesBY = &by.x; const float* lanesBZ = &bz.x;
+			for (int lane = 0; lane < 4; lane++)
+			{
+				for (int corner = 0; corner < 3; corner++)
+				{
+					acc.Add(tri[lane * 3 + corner],
+						lanesTX[lane], lanesTY[lane], lanesTZ[lane],
+						lanesBX[lane], lanesBY[lane], lanesBZ[lane]);
+				}
+			}
+		}
+
+		// Leftover triangles, one at a time
+		for (; t < last; t++)
+		{
+			unsigned int a = indices[t * 3];
+			unsigned int b = indices[t * 3 + 1];
+			unsigned int c = indices[t * 3 + 2];
+
+			float x1 = X[b] - X[a], y1 = Y[b] - Y[a], z1 = Z[b] - Z[a];
+			float x2 = X[c] - X[a], y2 = Y[c] - Y[a], z2 = Z[c] - Z[a];
+			float s1 = U[b] - U[a], t1 = V[b] - V[a];
+			float s2 = U[c] - U[a], t2 = V[c] - V[a];
+
+			float det = s1 * t2 - s2 * t1;
+			float r = det != 0.0f ? 1.0f / det : 0.0f;
+
+			float tx = (t2 * x1 - t1 * x2) * r;
+			float ty = (t2 * y1 - t1 * y2) * r;
+			float tz = (t2 * z1 - t1 * z2) * r;
+			float bx = (s1 * x2 - s2 * x1) * r;
+			float by = (s1 * y2 - s2 * y1) * r;
+			float bz = (s1 * z2 - s2 * z1) * r;
+
+			acc.Add(a, tx, ty, tz, bx, by, bz);
+			acc.Add(b, tx, ty, tz, bx, by, bz);
+			acc.Add(c, tx, ty, tz, bx, by, bz);
+		}
+	}
+
+	// --------------------------------------------------------
+	// Sums every slice's contribution for verts [first, last),
+	// makes the tangent orthogonal to the normal and works out
+	// which way the bitangent points
+	// --------------------------------------------------------
+	void ResolveVertices(Vertex* verts, const std::vector<Accumulator>& accs, int first, int last)
+	{
+		for (int i = first; i < last; i++)
+		{
+			float tx = 0, ty = 0, tz = 0;
+			float bx = 0, by = 0, bz = 0;
+			for (size_t a = 0; a < accs.size(); a++)
+			{
+				tx += accs[a].TX[i]; ty += accs[a].TY[i]; tz += accs[a].TZ[i];
+				bx += accs[a].BX[i]; by += accs[a].BY[i]; bz += accs[a].BZ[i];
+			}
+
+			XMVECTOR normal = XMLoadFloat3(&verts[i].Normal);
+			XMVECTOR tangent = XMVectorSet(tx, ty, tz, 0);
+			XMVECTOR bitangent = XMVectorSet(bx, by, bz, 0);
+
+			// Use Gram-Schmidt orthogonalize
+			tangent = XMVector3Normalize(
+				tangent - normal * XMVector3Dot(normal, tangent));
+
+			// Flip when the uv's are mirrored relative to N x T
+			float sign = XMVectorGetX(XMVector3Dot(XMVector3Cross(normal, tangent), bitangent)) < 0.0f ? -1.0f : 1.0f;
+
+			XMStoreFloat4(&verts[i].Tangent, XMVectorSetW(tangent, sign));
+		}
+	}
+}
+
+void TangentGenerator::Generate(Vertex * verts, int numVerts, const unsigned int * indices, int numIndices, JobSystem* jobs)
+{
+	if (numVerts <= 0)
+		return;
+
+	// Split the data the triangle loop reads into flat arrays
+	SourceArrays src;
+	src.X.resize(numVerts); src.Y.resize(numVerts); src.Z.resize(numVerts);
+	src.U.resize(numVerts); src.V.resize(numVerts);
+	for (int i = 0; i < numVerts; i++)
+	{
+		src.X[i] = verts[i].Position.x;
+		src.Y[i] = verts[i].Position.y;
+		src.Z[i] = verts[i].Position.z;
+		src.U[i] = verts[i].UV.x;
+		src.V[i] = verts[i].UV.y;
+	}
+
+	// Only cut as many slices as there is work and threads for,
+	// since each one carries a full set of per-vertex sums
+	int numTriangles = numIndices / 3;
+	int sliceCount = jobs ? jobs->GetThreadCount() : 1;
+	if (sliceCount > numTriangles / MinTrianglesPerSlice)
+		sliceCount = numTriangles / MinTrianglesPerSlice;
+	if (sliceCount < 1)
+		sliceCount = 1;
+
+	std::vector<Accumulator> accs(sliceCount);
+
+	// Each slice of the triangles gets its own sums
+	auto accumulateSlices = [&](size_t firstSlice, size_t lastSlice) {
+		for (size_t i = firstSlice; i < lastSlice; i++)
+		{
+			int first = (int)((long long)numTriangles * i / sliceCount);
+			int last = (int)((long long)numTriangles * (i + 1) / sliceCount);
+			accs[i].Resize(numVerts);
+			AccumulateTriangles(src, indices, first, last, accs[i]);
+		}
+	};
+	if (sliceCount == 1)
+		accumulateSlices(0, 1);
+	else
+		jobs->Wait(jobs->ParallelFor("Accumulate tangents", sliceCount, 1, accumulateSlices));
+
+	// Then reduce, a range of the vertices per job
+	auto resolve = [&](size_t first, size_t last) {
+		ResolveVertices(verts, accs, (int)first, (int)last);
+	};
+	if (!jobs || numVerts < MinVerticesPerJob * 2)
+		resolve(0, numVerts);
+	else
+		jobs->Wait(jobs->ParallelFor("Resolve tangents", numVerts, MinVerticesPerJob, resolve));
+}
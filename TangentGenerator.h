@@ -0,0 +1,24 @@
+#pragma once
+#include "JobSystem.h"
+#include "Vertex.h"
+
+// --------------------------------------------------------
+// Builds per-vertex tangents for an indexed triangle list
+//
+// Positions and UVs are copied into separate x/y/z/u/v arrays
+// so four triangles can be processed per DirectXMath vector.
+// Given a job system, triangles are split into one slice per
+// thread, each accumulating into its own arrays, and the
+// per-slice sums are then reduced and orthogonalized across
+// its threads one vertex range at a time.
+//
+// The tangent's W holds the bitangent sign (+1 or -1), so
+// shaders can rebuild the bitangent as cross(T, N) * W and
+// mirrored UVs still shade correctly.
+// --------------------------------------------------------
+class TangentGenerator
+{
+public:
+	// Overwrites the Tangent of every vertex in the array
+	static void Generate(Vertex* verts, int numVerts, const unsigned int* indices, int numIndices, JobSystem* jobs = 0);
+};
@@ -0,0 +1,206 @@
+#include "AssetCache.h"
+#include "Mesh.h"
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+namespace
+{
+	// Under the test's working directory, which is the build folder
+	const char* CacheDirectory = "AssetCacheTests";
+
+	// Bumped by hand whenever the "processing" below changes
+	const int BakeVersion = 3;
+
+	struct BakeSettings
+	{
+		int Size;
+		float Roughness;
+	};
+
+	// --------------------------------------------------------
+	// Builds a key the way the loaders do: the source bytes,
+	// then the settings and the version of the code
+	// --------------------------------------------------------
+	unsigned long long MakeKey(const std::string& source, const BakeSettings& settings, int version)
+	{
+		unsigned long long key = AssetCache::Hash(source.c_str(), source.size());
+		key = AssetCache::HashValue(settings, key);
+		return AssetCache::HashValue(version, key);
+	}
+
+	void WriteFile(const std::string& path, const std::string& text)
+	{
+		FILE* f = fopen(path.c_str(), "wb");
+		ASSERT_TRUE(f != 0);
+		fwrite(text.c_str(), 1, text.size(), f);
+		fclose(f);
+	}
+
+	// Each test starts without the blobs it uses
+	void RemoveBlob(const char* name)
+	{
+		remove((std::string(CacheDirectory) + "/" + name + ".blob").c_str());
+	}
+
+	std::string AsString(const AssetBlob& blob)
+	{
+		return std::string((const char*)blob.GetData(), blob.GetSize());
+	}
+}
+
+// --------------------------------------------------------
+// The same source, settings and version load what was
+// stored, with the payload intact
+// --------------------------------------------------------
+TEST(AssetCacheTests, HitsOnMatchingKey)
+{
+	RemoveBlob("hit");
+	AssetCache cache(CacheDirectory);
+	BakeSettings settings = { 64, 0.5f };
+	unsigned long long key = MakeKey("source", settings, BakeVersion);
+
+	AssetBlob blob;
+	EXPECT_FALSE(cache.Load("hit", key, blob));
+	ASSERT_TRUE(cache.Store("hit", key, "baked", 5));
+	ASSERT_TRUE(cache.Load("hit", MakeKey("source", settings, BakeVersion), blob));
+	EXPECT_EQ("baked", AsString(blob));
+	EXPECT_EQ(0u, (size_t)blob.GetData() % 16);
+
+	AssetCacheStats stats = cache.GetStats();
+	EXPECT_EQ(1u, stats.Hits);
+	EXPECT_EQ(1u, stats.Misses);
+	EXPECT_EQ(1u, stats.Stores);
+	EXPECT_EQ(5u, stats.BytesLoaded);
+	EXPECT_EQ(5u, stats.BytesStored);
+}
+
+// --------------------------------------------------------
+// Editing the source changes the key, so the old blob is a
+// miss, and storing the new result replaces it - the old
+// key misses from then on
+// --------------------------------------------------------
+TEST(AssetCacheTests, MissesWhenSourceChanges)
+{
+	RemoveBlob("source");
+	AssetCache cache(CacheDirectory);
+	BakeSettings settings = { 64, 0.5f };
+	unsigned long long oldKey = MakeKey("v 0 0 0", settings, BakeVersion);
+	unsigned long long newKey = MakeKey("v 0 0 1", settings, BakeVersion);
+	ASSERT_NE(oldKey, newKey);
+
+	AssetBlob blob;
+	ASSERT_TRUE(cache.Store("source", oldKey, "old", 3));
+	EXPECT_FALSE(cache.Load("source", newKey, blob));
+	EXPECT_EQ(0u, blob.GetSize());
+
+	ASSERT_TRUE(cache.Store("source", newKey, "newer", 5));
+	ASSERT_TRUE(cache.Load("source", newKey, blob));
+	EXPECT_EQ("newer", AsString(blob));
+	EXPECT_FALSE(cache.Load("source", oldKey, blob));
+}
+
+// --------------------------------------------------------
+// Unchanged source still misses when a setting or the
+// version of the processing code changes
+// --------------------------------------------------------
+TEST(AssetCacheTests, MissesWhenSettingsOrVersionChange)
+{
+	RemoveBlob("settings");
+	AssetCache cache(CacheDirectory);
+	BakeSettings settings = { 64, 0.5f };
+	BakeSettings smaller = { 32, 0.5f };
+	BakeSettings rougher = { 64, 0.75f };
+	ASSERT_TRUE(cache.Store("settings", MakeKey("source", settings, BakeVersion), "baked", 5));
+
+	AssetBlob blob;
+	EXPECT_FALSE(cache.Load("settings", MakeKey("source", smaller, BakeVersion), blob));
+	EXPECT_FALSE(cache.Load("settings", MakeKey("source", rougher, BakeVersion), blob));
+	EXPECT_FALSE(cache.Load("settings", MakeKey("source", settings, BakeVersion + 1), blob));
+	EXPECT_TRUE(cache.Load("settings", MakeKey("source", settings, BakeVersion), blob));
+}
+
+// --------------------------------------------------------
+// A blob cut short or overwritten with junk is a miss, not
+// a crash or a short payload
+// --------------------------------------------------------
+TEST(AssetCacheTests, MissesOnDamagedBlobs)
+{
+	AssetCache cache(CacheDirectory);
+	std::string path = std::string(CacheDirectory) + "/damaged.blob";
+	unsigned long long key = MakeKey("source", BakeSettings(), BakeVersion);
+	ASSERT_TRUE(cache.Store("damaged", key, "0123456789", 10));
+
+	// Header intact, payload cut short
+	std::string whole;
+	{
+		AssetBlob blob;
+		ASSERT_TRUE(cache.Load("damaged", key, blob));
+		whole.assign((const char*)blob.GetData() - 32, blob.GetSize() + 32);
+	}
+	WriteFile(path, whole.substr(0, whole.size() - 4));
+	AssetBlob blob;
+	EXPECT_FALSE(cache.Load("damaged", key, blob));
+
+	// Shorter than a header
+	WriteFile(path, "BLOB");
+	EXPECT_FALSE(cache.Load("damaged", key, blob));
+
+	remove(path.c_str());
+}
+
+// --------------------------------------------------------
+// Names that are source paths turn into file names inside
+// the cache directory, and different names don't collide
+// --------------------------------------------------------
+TEST(AssetCacheTests, KeepsPathNamesApart)
+{
+	RemoveBlob("Models_cube.obj");
+	RemoveBlob("Models_sphere.obj");
+	AssetCache cache(CacheDirectory);
+	ASSERT_TRUE(cache.Store("Models/cube.obj", 1, "cube", 4));
+	ASSERT_TRUE(cache.Store("Models/sphere.obj", 1, "sphere", 6));
+
+	AssetBlob blob;
+	ASSERT_TRUE(cache.Load("Models/cube.obj", 1, blob));
+	EXPECT_EQ("cube", AsString(blob));
+	ASSERT_TRUE(cache.Load("Models/sphere.obj", 1, blob));
+	EXPECT_EQ("sphere", AsString(blob));
+}
+
+// --------------------------------------------------------
+// Mesh loading end to end: the second load comes from the
+// cache, and editing the OBJ makes the next load parse the
+// new contents instead of returning the stale mesh
+// --------------------------------------------------------
+TEST(AssetCacheTests, ReloadsEditedObj)
+{
+	const char* file = "AssetCacheTests_mesh.obj";
+	RemoveBlob("mesh_AssetCacheTests_mesh.obj");
+	AssetCache cache(CacheDirectory);
+
+	WriteFile(file, "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\n");
+	{
+		MeshData data;
+		ASSERT_TRUE(Mesh::LoadObj(file, &cache, data));
+		EXPECT_EQ(3, data.NumIndices);
+	}
+	{
+		MeshData data;
+		ASSERT_TRUE(Mesh::LoadObj(file, &cache, data));
+		EXPECT_EQ(3, data.NumIndices);
+	}
+	EXPECT_EQ(1u, cache.GetStats().Hits);
+	EXPECT_EQ(1u, cache.GetStats().Stores);
+
+	WriteFile(file, "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nf 1 2 3 4\n");
+	{
+		MeshData data;
+		ASSERT_TRUE(Mesh::LoadObj(file, &cache, data));
+		EXPECT_EQ(6, data.NumIndices);
+	}
+	EXPECT_EQ(1u, cache.GetStats().Hits);
+	EXPECT_EQ(2u, cache.GetStats().Stores);
+	remove(file);
+}
@@ -0,0 +1,208 @@
+#include "AssetLoader.h"
+#include "Mesh.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace
+{
+	// --------------------------------------------------------
+	// The order steps ran in, as "work a", "finish a" and so
+	// on, from whichever thread ran them
+	// --------------------------------------------------------
+	class StepLog
+	{
+	public:
+		void Add(const std::string& step)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			steps.push_back(step);
+		}
+
+		// Where a step ran, or -1 if it never did
+		int IndexOf(const std::string& step)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			for (size_t i = 0; i < steps.size(); i++)
+			{
+				if (steps[i] == step)
+					return (int)i;
+			}
+			return -1;
+		}
+
+	private:
+		std::mutex mutex;
+		std::vector<std::string> steps;
+	};
+
+	std::function<bool()> Step(StepLog& log, const std::string& step, bool succeeds = true)
+	{
+		return [&log, step, succeeds]() {
+			log.Add(step);
+			return succeeds;
+		};
+	}
+}
+
+// --------------------------------------------------------
+// Work starts only once every dependency's work is done, and
+// finish steps run after their dependencies' finish steps,
+// on the thread that called Finish()
+// --------------------------------------------------------
+TEST(AssetLoaderTests, RunsDependenciesFirst)
+{
+	JobSystem jobs(3);
+	StepLog log;
+	std::atomic<int> wrongThreadFinishes(0);
+	auto finish = [&](const char* name) -> std::function<bool()> {
+		return [&, name]() {
+			wrongThreadFinishes += jobs.GetCurrentThread() != 0;
+			log.Add(std::string("finish ") + name);
+			return true;
+		};
+	};
+
+	{
+		AssetLoader loader(jobs);
+		AssetHandle a = loader.Load("a", Step(log, "work a"), finish("a"));
+		AssetHandle b = loader.Load("b", Step(log, "work b"), finish("b"));
+		AssetHandle c = loader.Load("c", Step(log, "work c"), finish("c"), { a, b });
+		AssetHandle d = loader.Load("d", nullptr, finish("d"), { c });
+		AssetHandle e = loader.Load("e", Step(log, "work e"), finish("e"), { d, a });
+		loader.Finish();
+
+		AssetHandle all[] = { a, b, c, d, e };
+		for (AssetHandle handle : all)
+			EXPECT_TRUE(loader.Succeeded(handle)) << "asset " << handle;
+
+		std::vector<AssetTiming> timings = loader.GetTimings();
+		ASSERT_EQ(5u, timings.size());
+		EXPECT_EQ("c", timings[c].Name);
+		EXPECT_GE(timings[c].WorkStart, timings[a].WorkEnd);
+		EXPECT_GE(timings[c].WorkStart, timings[b].WorkEnd);
+		EXPECT_EQ(-1, timings[d].WorkerThread);
+	}
+
+	EXPECT_LT(log.IndexOf("work a"), log.IndexOf("work c"));
+	EXPECT_LT(log.IndexOf("work b"), log.IndexOf("work c"));
+	EXPECT_LT(log.IndexOf("work c"), log.IndexOf("work e"));
+	EXPECT_LT(log.IndexOf("finish a"), log.IndexOf("finish c"));
+	EXPECT_LT(log.IndexOf("finish b"), log.IndexOf("finish c"));
+	EXPECT_LT(log.IndexOf("finish c"), log.IndexOf("finish d"));
+	EXPECT_LT(log.IndexOf("finish d"), log.IndexOf("finish e"));
+	EXPECT_EQ(0, wrongThreadFinishes);
+}
+
+// --------------------------------------------------------
+// A failed step fails everything depending on it, directly
+// or not, without running their steps - and nothing else
+// --------------------------------------------------------
+TEST(AssetLoaderTests, PropagatesFailures)
+{
+	JobSystem jobs(3);
+	StepLog log;
+	AssetLoader loader(jobs);
+
+	AssetHandle badWork = loader.Load("bad work", Step(log, "work bad work", false), Step(log, "finish bad work"));
+	AssetHandle afterWork = loader.Load("after work", Step(log, "work after work"), Step(log, "finish after work"), { badWork });
+	AssetHandle chained = loader.Load("chained", Step(log, "work chained"), Step(log, "finish chained"), { afterWork });
+
+	AssetHandle badFinish = loader.Load("bad finish", Step(log, "work bad finish"), Step(log, "finish bad finish", false));
+	AssetHandle afterFinish = loader.Load("after finish", Step(log, "work after finish"), Step(log, "finish after finish"), { badFinish });
+
+	AssetHandle missing = loader.Load("missing", Step(log, "work missing"), nullptr, { InvalidAssetHandle });
+	AssetHandle fine = loader.Load("fine", Step(log, "work fine"), Step(log, "finish fine"));
+
+	EXPECT_FALSE(loader.Wait(chained));
+	EXPECT_TRUE(loader.Wait(fine));
+	loader.Finish();
+
+	EXPECT_FALSE(loader.Succeeded(badWork));
+	EXPECT_FALSE(loader.Succeeded(afterWork));
+	EXPECT_FALSE(loader.Succeeded(chained));
+	EXPECT_FALSE(loader.Succeeded(badFinish));
+	EXPECT_FALSE(loader.Succeeded(afterFinish));
+	EXPECT_FALSE(loader.Succeeded(missing));
+	EXPECT_TRUE(loader.Succeeded(fine));
+
+	EXPECT_EQ(-1, log.IndexOf("finish bad work"));
+	EXPECT_EQ(-1, log.IndexOf("work after work"));
+	EXPECT_EQ(-1, log.IndexOf("work chained"));
+	EXPECT_EQ(-1, log.IndexOf("finish after finish"));
+	EXPECT_EQ(-1, log.IndexOf("work missing"));
+	EXPECT_NE(-1, log.IndexOf("finish fine"));
+
+	// Queued after its dependency already failed
+	AssetHandle late = loader.Load("late", Step(log, "work late"), nullptr, { badWork });
+	EXPECT_FALSE(loader.Wait(late));
+	EXPECT_EQ(-1, log.IndexOf("work late"));
+
+	std::vector<AssetTiming> timings = loader.GetTimings();
+	EXPECT_FALSE(timings[afterWork].Succeeded);
+	EXPECT_TRUE(timings[fine].Succeeded);
+}
+
+// --------------------------------------------------------
+// Without a device, finish steps are skipped and assets
+// succeed on their work alone - here, OBJ files parsed into
+// meshes with tangents built on the same jobs
+// --------------------------------------------------------
+TEST(AssetLoaderTests, LoadsHeadless)
+{
+	const char* file = "AssetLoaderTests_quad.obj";
+	const char* obj =
+		"v -1 -1 0\nv -1 1 0\nv 1 1 0\nv 1 -1 0\n"
+		"vt 0 1\nvt 0 0\nvt 1 0\nvt 1 1\n"
+		"vn 0 0 -1\n"
+		"f 1/1/1 2/2/1 3/3/1 4/4/1\n";
+	FILE* f = fopen(file, "wb");
+	ASSERT_TRUE(f != 0);
+	fwrite(obj, 1, strlen(obj), f);
+	fclose(f);
+
+	JobSystem jobs(3);
+	std::atomic<int> finishes(0);
+	const int meshCount = 16;
+	std::vector<MeshData> meshes(meshCount);
+	{
+		AssetLoader loader(jobs, true);
+		std::vector<AssetHandle> handles;
+		for (int i = 0; i < meshCount; i++)
+		{
+			MeshData* data = &meshes[i];
+			handles.push_back(loader.Load(file,
+				[file, data, &jobs]() { return Mesh::LoadObj(file, 0, *data, &jobs); },
+				[&finishes]() { finishes++; return true; }));
+		}
+		AssetHandle missing = loader.Load("missing",
+			[]() { MeshData data; return Mesh::LoadObj("AssetLoaderTests_missing.obj", 0, data); },
+			nullptr);
+		loader.Finish();
+
+		for (int i = 0; i < meshCount; i++)
+			EXPECT_TRUE(loader.Succeeded(handles[i])) << "mesh " << i;
+		EXPECT_FALSE(loader.Succeeded(missing));
+
+		std::vector<AssetTiming> timings = loader.GetTimings();
+		for (int i = 0; i < meshCount; i++)
+		{
+			EXPECT_GE(timings[i].WorkerThread, 0);
+			EXPECT_LT(timings[i].WorkerThread, jobs.GetThreadCount());
+			EXPECT_GE(timings[i].WorkEnd, timings[i].WorkStart);
+			EXPECT_GE(timings[i].WorkStart, timings[i].Queued);
+		}
+	}
+	remove(file);
+
+	EXPECT_EQ(0, finishes);
+	for (int i = 0; i < meshCount; i++)
+	{
+		EXPECT_EQ(4, meshes[i].NumVerts) << "mesh " << i;
+		EXPECT_EQ(6, meshes[i].NumIndices) << "mesh " << i;
+	}
+}
@@ -0,0 +1,161 @@
+#include "ConstantBufferData.h"
+#include <gtest/gtest.h>
+#include <cstring>
+
+namespace
+{
+	SimpleShaderUploadStats NoUploads()
+	{
+		SimpleShaderUploadStats stats;
+		memset(&stats, 0, sizeof(stats));
+		return stats;
+	}
+}
+
+// --------------------------------------------------------
+// A new buffer is zeroed and goes up on the first upload,
+// even with nothing written
+// --------------------------------------------------------
+TEST(ConstantBufferDataTests, UploadsNewBufferOnce)
+{
+	ConstantBufferData data;
+	data.Resize(64);
+	ASSERT_EQ(64u, data.GetSize());
+	for (unsigned int i = 0; i < 64; i++)
+		EXPECT_EQ(0, data.GetData()[i]);
+	EXPECT_TRUE(data.IsDirty());
+
+	SimpleShaderUploadStats stats = NoUploads();
+	EXPECT_TRUE(data.BeginUpload(stats));
+	EXPECT_FALSE(data.IsDirty());
+	EXPECT_FALSE(data.BeginUpload(stats));
+	EXPECT_FALSE(data.BeginUpload(stats));
+
+	EXPECT_EQ(1u, stats.Uploads);
+	EXPECT_EQ(64u, stats.BytesUploaded);
+	EXPECT_EQ(2u, stats.SkippedUploads);
+}
+
+// --------------------------------------------------------
+// Writing the value already there leaves the buffer clean,
+// so the next upload is skipped
+// --------------------------------------------------------
+TEST(ConstantBufferDataTests, SkipsUnchangedWrites)
+{
+	ConstantBufferData data;
+	data.Resize(32);
+	SimpleShaderUploadStats stats = NoUploads();
+	data.BeginUpload(stats);
+
+	float zero = 0.0f;
+	EXPECT_FALSE(data.Write(8, &zero, sizeof(zero)));
+	EXPECT_FALSE(data.IsDirty());
+
+	float value = 2.5f;
+	EXPECT_TRUE(data.Write(8, &value, sizeof(value)));
+	EXPECT_TRUE(data.BeginUpload(stats));
+	EXPECT_FALSE(data.Write(8, &value, sizeof(value)));
+	EXPECT_FALSE(data.BeginUpload(stats));
+
+	float stored;
+	memcpy(&stored, data.GetData() + 8, sizeof(stored));
+	EXPECT_EQ(2.5f, stored);
+	EXPECT_EQ(2u, stats.Uploads);
+	EXPECT_EQ(64u, stats.BytesUploaded);
+	EXPECT_EQ(1u, stats.SkippedUploads);
+}
+
+// --------------------------------------------------------
+// The dirty range covers every changed write since the last
+// upload, and an upload clears it
+// --------------------------------------------------------
+TEST(ConstantBufferDataTests, TracksDirtyRange)
+{
+	ConstantBufferData data;
+	data.Resize(128);
+	SimpleShaderUploadStats stats = NoUploads();
+	data.BeginUpload(stats);
+
+	float matrix[16];
+	for (int i = 0; i < 16; i++)
+		matrix[i] = (float)i;
+	EXPECT_TRUE(data.Write(64, matrix, sizeof(matrix)));
+	EXPECT_EQ(64u, data.GetDirtyStart());
+	EXPECT_EQ(128u, data.GetDirtyEnd());
+
+	float value = 1.0f;
+	EXPECT_TRUE(data.Write(16, &value, sizeof(value)));
+	EXPECT_EQ(16u, data.GetDirtyStart());
+	EXPECT_EQ(128u, data.GetDirtyEnd());
+
+	// Unchanged writes outside the range don't grow it
+	float zero = 0.0f;
+	EXPECT_FALSE(data.Write(0, &zero, sizeof(zero)));
+	EXPECT_EQ(16u, data.GetDirtyStart());
+
+	EXPECT_TRUE(data.BeginUpload(stats));
+	EXPECT_FALSE(data.IsDirty());
+	EXPECT_EQ(0, memcmp(data.GetData() + 64, matrix, sizeof(matrix)));
+}
+
+// --------------------------------------------------------
+// Writes that would run past the end are refused
+// --------------------------------------------------------
+TEST(ConstantBufferDataTests, RejectsWritesPastTheEnd)
+{
+	ConstantBufferData data;
+	data.Resize(16);
+	SimpleShaderUploadStats stats = NoUploads();
+	data.BeginUpload(stats);
+
+	float values[4] = { 1, 2, 3, 4 };
+	EXPECT_FALSE(data.Write(4, values, sizeof(values)));
+	EXPECT_FALSE(data.Write(0xFFFFFFF0u, values, sizeof(values)));
+	EXPECT_FALSE(data.IsDirty());
+	EXPECT_TRUE(data.Write(0, values, sizeof(values)));
+}
+
+// --------------------------------------------------------
+// The PBR shaders' per-frame camera data is set on every
+// draw but only changes once per frame, so 64 draws upload
+// it once and the per-draw world matrix 64 times
+// --------------------------------------------------------
+TEST(ConstantBufferDataTests, UploadsFrameDataOncePerFrame)
+{
+	ConstantBufferData perFrame;
+	ConstantBufferData perDraw;
+	perFrame.Resize(128);
+	perDraw.Resize(64);
+
+	SimpleShaderUploadStats stats = NoUploads();
+	for (int frame = 0; frame < 3; frame++)
+	{
+		float viewProjection[32];
+		for (int i = 0; i < 32; i++)
+			viewProjection[i] = (float)(frame * 32 + i);
+
+		for (int draw = 0; draw < 64; draw++)
+		{
+			perFrame.Write(0, viewProjection, sizeof(viewProjection));
+			float world[16] = {};
+			world[0] = world[5] = world[10] = world[15] = 1.0f;
+			world[12] = (float)draw;
+			perDraw.Write(0, world, sizeof(world));
+
+			perFrame.BeginUpload(stats);
+			perDraw.BeginUpload(stats);
+		}
+	}
+
+	EXPECT_EQ(3u + 3u * 64u, stats.Uploads);
+	EXPECT_EQ(3u * 63u, stats.SkippedUploads);
+	EXPECT_EQ(3ull * 128ull + 3ull * 64ull * 64ull, stats.BytesUploaded);
+}
+
+TEST(ConstantBufferDataTests, ReadsFrequencyFromBufferName)
+{
+	EXPECT_EQ(UpdateFrequency::PerFrame, GetUpdateFrequency("perFrame"));
+	EXPECT_EQ(UpdateFrequency::PerMaterial, GetUpdateFrequency("perMaterial"));
+	EXPECT_EQ(UpdateFrequency::PerDraw, GetUpdateFrequency("perDraw"));
+	EXPECT_EQ(UpdateFrequency::PerDraw, GetUpdateFrequency("externalData"));
+}
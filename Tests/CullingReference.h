@@ -0,0 +1,105 @@
+#pragma once
+#include "TransformSystem.h"
+#include <DirectXCollision.h>
+#include <DirectXMath.h>
+#include <cmath>
+#include <vector>
+
+// --------------------------------------------------------
+// Frustum culling the brute-force way: every object's world
+// box tested against all six planes, in doubles.  Used by
+// the tests as the expected result and by the benchmarks as
+// the baseline.
+// --------------------------------------------------------
+namespace CullingReference
+{
+	struct Frustum
+	{
+		double Planes[6][4];
+	};
+
+	// --------------------------------------------------------
+	// Planes of (view * projection), from the transposed matrices
+	// the camera keeps.  Points in front of a plane are positive.
+	// --------------------------------------------------------
+	inline Frustum MakeFrustum(const DirectX::XMFLOAT4X4& view, const DirectX::XMFLOAT4X4& projection)
+	{
+		// Transposed view * projection is projection^T * view^T
+		double m[4][4];
+		for (int r = 0; r < 4; r++)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				m[r][c] = 0.0;
+				for (int k = 0; k < 4; k++)
+					m[r][c] += (double)projection.m[r][k] * view.m[k][c];
+			}
+		}
+
+		Frustum f;
+		for (int c = 0; c < 4; c++)
+		{
+			f.Planes[0][c] = m[3][c] + m[0][c];   // Left
+			f.Planes[1][c] = m[3][c] - m[0][c];   // Right
+			f.Planes[2][c] = m[3][c] + m[1][c];   // Bottom
+			f.Planes[3][c] = m[3][c] - m[1][c];   // Top
+			f.Planes[4][c] = m[2][c];             // Near
+			f.Planes[5][c] = m[3][c] - m[2][c];   // Far
+		}
+		return f;
+	}
+
+	// --------------------------------------------------------
+	// How far the box reaches in front of the plane it is most
+	// behind - negative means culled.  The distances aren't
+	// normalized, so tests compare them against a tolerance
+	// scaled the same way.
+	// --------------------------------------------------------
+	inline double Slack(const Frustum& f, const DirectX::XMFLOAT3& center, const DirectX::XMFLOAT3& extents)
+	{
+		double slack = 1e30;
+		for (int p = 0; p < 6; p++)
+		{
+			const double* plane = f.Planes[p];
+			double distance = plane[0] * center.x + plane[1] * center.y + plane[2] * center.z + plane[3];
+			double radius = fabs(plane[0]) * extents.x + fabs(plane[1]) * extents.y + fabs(plane[2]) * extents.z;
+			double length = sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+			double reach = (distance + radius) / length;
+			if (reach < slack)
+				slack = reach;
+		}
+		return slack;
+	}
+
+	inline void WorldBounds(const DirectX::BoundingBox& local, const DirectX::XMFLOAT4X4& transposedWorld, DirectX::BoundingBox& world)
+	{
+		using namespace DirectX;
+		local.Transform(world, XMMatrixTranspose(XMLoadFloat4x4(&transposedWorld)));
+	}
+
+	// --------------------------------------------------------
+	// Every object whose world box isn't behind a plane
+	// --------------------------------------------------------
+	inline void Cull(const Frustum& f, const std::vector<DirectX::BoundingBox>& worldBounds, std::vector<unsigned int>& visible)
+	{
+		visible.clear();
+		for (size_t i = 0; i < worldBounds.size(); i++)
+		{
+			if (Slack(f, worldBounds[i].Center, worldBounds[i].Extents) >= 0.0)
+				visible.push_back((unsigned int)i);
+		}
+	}
+
+	// --------------------------------------------------------
+	// A transposed camera looking from eye along direction
+	// --------------------------------------------------------
+	inline void MakeCamera(DirectX::XMFLOAT3 eye, DirectX::XMFLOAT3 direction, float farClip,
+		DirectX::XMFLOAT4X4& view, DirectX::XMFLOAT4X4& projection)
+	{
+		using namespace DirectX;
+		XMMATRIX v = XMMatrixLookToLH(XMLoadFloat3(&eye), XMLoadFloat3(&direction), XMVectorSet(0, 1, 0, 0));
+		XMMATRIX p = XMMatrixPerspectiveFovLH(0.25f * XM_PI, 16.0f / 9.0f, 0.1f, farClip);
+		XMStoreFloat4x4(&view, XMMatrixTranspose(v));
+		XMStoreFloat4x4(&projection, XMMatrixTranspose(p));
+	}
+}
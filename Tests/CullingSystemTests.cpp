@@ -0,0 +1,155 @@
+#include "CullingSystem.h"
+#include "CullingReference.h"
+#include "TransformReference.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// Boxes this close to a plane, relative to the far clip
+	// distance, may land either side of it after float rounding
+	// and aren't checked.  The far plane is the least precise -
+	// it comes from two columns of the view-projection matrix
+	// that almost cancel.
+	const double BoundaryTolerance = 1e-4;
+
+	struct Scene
+	{
+		TransformSystem Transforms;
+		CullingSystem Culling;
+		std::vector<BoundingBox> LocalBounds;
+		unsigned int Seed;
+
+		Scene() : Seed(777) {}
+
+		void Add(size_t count)
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				TransformId id = Transforms.Create();
+				Transforms.SetPosition(id, Random(-100, 100), Random(-20, 20), Random(-100, 100));
+				Transforms.SetRotation(id, Random(-3, 3), Random(-3, 3), Random(-3, 3));
+				Transforms.SetScale(id, Random(0.5f, 2), Random(0.5f, 2), Random(0.5f, 2));
+
+				BoundingBox local(XMFLOAT3(Random(-1, 1), Random(-1, 1), Random(-1, 1)), XMFLOAT3(Random(0.1f, 2), Random(0.1f, 2), Random(0.1f, 2)));
+				LocalBounds.push_back(local);
+				EXPECT_EQ(LocalBounds.size() - 1, Culling.Add(local, id));
+			}
+		}
+
+		float Random(float low, float high)
+		{
+			return TransformReference::Random(Seed, low, high);
+		}
+	};
+
+	// --------------------------------------------------------
+	// Culls from a handful of cameras and compares against
+	// testing every object, ignoring only objects touching a
+	// plane to within rounding
+	// --------------------------------------------------------
+	void CheckAgainstReference(Scene& scene)
+	{
+		std::vector<BoundingBox> world(scene.LocalBounds.size());
+		for (size_t i = 0; i < world.size(); i++)
+			CullingReference::WorldBounds(scene.LocalBounds[i], scene.Transforms.GetWorldMatrix((TransformId)i), world[i]);
+
+		XMFLOAT3 eyes[] = { XMFLOAT3(0, 0, -150), XMFLOAT3(0, 0, 0), XMFLOAT3(50, 10, 20), XMFLOAT3(-120, 60, 120) };
+		XMFLOAT3 directions[] = { XMFLOAT3(0, 0, 1), XMFLOAT3(1, 0, 0), XMFLOAT3(-1, -0.2f, 0.3f), XMFLOAT3(1, -0.5f, -1) };
+		float farClips[] = { 400.0f, 60.0f, 100.0f, 250.0f };
+
+		for (int c = 0; c < 4; c++)
+		{
+			SCOPED_TRACE(c);
+			XMFLOAT4X4 view, projection;
+			CullingReference::MakeCamera(eyes[c], directions[c], farClips[c], view, projection);
+			CullingReference::Frustum frustum = CullingReference::MakeFrustum(view, projection);
+
+			std::vector<unsigned int> visible;
+			scene.Culling.Cull(view, projection, visible);
+			std::sort(visible.begin(), visible.end());
+			EXPECT_TRUE(std::adjacent_find(visible.begin(), visible.end()) == visible.end()) << "object reported twice";
+
+			size_t seen = 0;
+			for (unsigned int i = 0; i < world.size(); i++)
+			{
+				double slack = CullingReference::Slack(frustum, world[i].Center, world[i].Extents);
+				if (fabs(slack) < BoundaryTolerance * farClips[c])
+					continue;
+
+				bool culled = !std::binary_search(visible.begin(), visible.end(), i);
+				EXPECT_EQ(slack < 0.0, culled) << "object " << i << ", slack " << slack;
+				seen += !culled;
+			}
+
+			// Every camera sees some of the scene but not all of it
+			EXPECT_GT(seen, 0u);
+			EXPECT_LT(seen, world.size());
+		}
+	}
+}
+
+TEST(CullingSystemTests, MatchesBruteForce)
+{
+	Scene scene;
+	scene.Add(5003);
+	scene.Transforms.Update();
+	scene.Culling.Update(scene.Transforms);
+	CheckAgainstReference(scene);
+}
+
+// --------------------------------------------------------
+// Refitting after moves and rebuilding after adds both keep
+// the tree correct
+// --------------------------------------------------------
+TEST(CullingSystemTests, MatchesBruteForceAfterChanges)
+{
+	Scene scene;
+	scene.Add(3000);
+	scene.Transforms.Update();
+	scene.Culling.Update(scene.Transforms);
+
+	// A few objects jump right across the scene
+	for (TransformId id = 0; id < 3000; id += 37)
+		scene.Transforms.SetPosition(id, scene.Random(-100, 100), scene.Random(-20, 20), scene.Random(-100, 100));
+	scene.Transforms.Update();
+	scene.Culling.Update(scene.Transforms);
+	CheckAgainstReference(scene);
+
+	scene.Add(500);
+	scene.Transforms.Update();
+	scene.Culling.Update(scene.Transforms);
+	EXPECT_EQ(3500u, scene.Culling.GetCount());
+	CheckAgainstReference(scene);
+}
+
+TEST(CullingSystemTests, MatchesBruteForceOnJobs)
+{
+	JobSystem jobs(4);
+	Scene scene;
+	scene.Add(20000);
+	scene.Transforms.Update(&jobs);
+	scene.Culling.Update(scene.Transforms, &jobs);
+
+	for (TransformId id = 0; id < 20000; id += 3)
+		scene.Transforms.Move(id, scene.Random(-5, 5), 0.0f, scene.Random(-5, 5));
+	scene.Transforms.Update(&jobs);
+	scene.Culling.Update(scene.Transforms, &jobs);
+	CheckAgainstReference(scene);
+}
+
+TEST(CullingSystemTests, HandlesEmptyScene)
+{
+	TransformSystem transforms;
+	CullingSystem culling;
+	culling.Update(transforms);
+
+	XMFLOAT4X4 view, projection;
+	CullingReference::MakeCamera(XMFLOAT3(0, 0, 0), XMFLOAT3(0, 0, 1), 100.0f, view, projection);
+	std::vector<unsigned int> visible(3, 0);
+	culling.Cull(view, projection, visible);
+	EXPECT_TRUE(visible.empty());
+}
@@ -0,0 +1,250 @@
+#include "FrameProfiler.h"
+#include <gtest/gtest.h>
+
+#if PROFILING_ENABLED
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	// A scope recorded as lasting this long, in nanoseconds
+	const long long Millisecond = 1000000;
+
+	// The profiler is shared by every test in the process, so
+	// each test starts by ending whatever frame was open
+	void StartFrame()
+	{
+		FrameProfiler::EndFrame();
+	}
+
+	// One scope's stats in the newest frame, or 0
+	const ProfileScopeStats* FindScope(const char* name)
+	{
+		const ProfileFrameStats& frame = FrameProfiler::GetFrame(0);
+		for (size_t i = 0; i < frame.Scopes.size(); i++)
+		{
+			if (strcmp(frame.Scopes[i].Name, name) == 0)
+				return &frame.Scopes[i];
+		}
+		return 0;
+	}
+
+	std::string ReadFile(const char* file)
+	{
+		std::ifstream in(file);
+		std::stringstream text;
+		text << in.rdbuf();
+		return text.str();
+	}
+
+	// --------------------------------------------------------
+	// The thread id of every complete event with this name in
+	// a trace
+	// --------------------------------------------------------
+	std::vector<int> TraceThreads(const std::string& trace, const char* name)
+	{
+		std::string prefix = std::string("{\"name\":\"") + name + "\",\"ph\":\"X\",\"pid\":1,\"tid\":";
+		std::vector<int> threads;
+		for (size_t at = trace.find(prefix); at != std::string::npos; at = trace.find(prefix, at + 1))
+			threads.push_back(atoi(trace.c_str() + at + prefix.size()));
+		return threads;
+	}
+}
+
+// --------------------------------------------------------
+// Threads record into their own rings, and the frame sums
+// them all under one name
+// --------------------------------------------------------
+TEST(FrameProfilerTests, SumsScopesFromEveryThread)
+{
+	StartFrame();
+
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 4; t++)
+	{
+		threads.push_back(std::thread([]() {
+			for (int i = 0; i < 1000; i++)
+				FrameProfiler::Record("ProfilerTest thread", 0, Millisecond);
+		}));
+	}
+	for (size_t t = 0; t < threads.size(); t++)
+		threads[t].join();
+
+	// Same text at another address still counts as the same scope
+	char copy[] = "ProfilerTest thread";
+	FrameProfiler::Record(copy, 0, 2 * Millisecond);
+	FrameProfiler::EndFrame();
+
+	const ProfileScopeStats* scope = FindScope("ProfilerTest thread");
+	ASSERT_TRUE(scope != 0);
+	EXPECT_EQ(4001, scope->Calls);
+	EXPECT_DOUBLE_EQ(4002.0, scope->Milliseconds);
+}
+
+// --------------------------------------------------------
+// A ring filled faster than frames end drops the extra
+// scopes, and takes new ones once the frame has emptied it
+// --------------------------------------------------------
+TEST(FrameProfilerTests, DropsScopesWhenRingIsFull)
+{
+	StartFrame();
+	unsigned long long dropped = FrameProfiler::GetDroppedScopes();
+
+	for (unsigned int i = 0; i < FrameProfiler::RingSize + 100; i++)
+		FrameProfiler::Record("ProfilerTest overflow", 0, Millisecond);
+	FrameProfiler::EndFrame();
+
+	const ProfileScopeStats* scope = FindScope("ProfilerTest overflow");
+	ASSERT_TRUE(scope != 0);
+	EXPECT_EQ((int)FrameProfiler::RingSize, scope->Calls);
+	EXPECT_EQ(dropped + 100, FrameProfiler::GetDroppedScopes());
+
+	FrameProfiler::Record("ProfilerTest overflow", 0, Millisecond);
+	FrameProfiler::EndFrame();
+	scope = FindScope("ProfilerTest overflow");
+	ASSERT_TRUE(scope != 0);
+	EXPECT_EQ(1, scope->Calls);
+	EXPECT_EQ(dropped + 100, FrameProfiler::GetDroppedScopes());
+}
+
+// --------------------------------------------------------
+// Each EndFrame() starts a new frame of the history, with
+// the scopes and counters since the last one, and the
+// averages run over the whole history
+// --------------------------------------------------------
+TEST(FrameProfilerTests, AggregatesEachFrame)
+{
+	StartFrame();
+	unsigned long long first = FrameProfiler::GetFrame(0).Frame + 1;
+
+	FrameProfiler::Record("ProfilerTest a", 0, 2 * Millisecond);
+	FrameProfiler::Record("ProfilerTest a", 0, 2 * Millisecond);
+	FrameProfiler::Record("ProfilerTest b", 0, Millisecond);
+	PROFILE_COUNT(DrawCalls, 5);
+	PROFILE_COUNT(DrawCalls, 7);
+	PROFILE_COUNT(Indices, 300);
+	FrameProfiler::EndFrame();
+
+	const ProfileFrameStats& frame = FrameProfiler::GetFrame(0);
+	EXPECT_EQ(first, frame.Frame);
+	EXPECT_EQ(2, FindScope("ProfilerTest a")->Calls);
+	EXPECT_DOUBLE_EQ(4.0, FindScope("ProfilerTest a")->Milliseconds);
+	EXPECT_EQ(1, FindScope("ProfilerTest b")->Calls);
+	EXPECT_EQ(12, frame.Counters[(int)ProfileCounter::DrawCalls]);
+	EXPECT_EQ(300, frame.Counters[(int)ProfileCounter::Indices]);
+	EXPECT_EQ(0, frame.Counters[(int)ProfileCounter::StateChanges]);
+	EXPECT_GE(frame.Milliseconds, 0.0);
+
+	// Counters start again from zero
+	FrameProfiler::EndFrame();
+	EXPECT_EQ(first + 1, FrameProfiler::GetFrame(0).Frame);
+	EXPECT_EQ(0, FrameProfiler::GetFrame(0).Counters[(int)ProfileCounter::DrawCalls]);
+	EXPECT_TRUE(FindScope("ProfilerTest a") == 0);
+	EXPECT_EQ(first, FrameProfiler::GetFrame(1).Frame);
+
+	// A full history of identical frames averages to one of them
+	for (int i = 0; i < FrameProfiler::HistoryFrames + 10; i++)
+	{
+		FrameProfiler::Record("ProfilerTest a", 0, 3 * Millisecond);
+		PROFILE_COUNT(DrawCalls, 4);
+		FrameProfiler::EndFrame();
+	}
+	EXPECT_EQ((int)FrameProfiler::HistoryFrames, FrameProfiler::GetFrameCount());
+	EXPECT_DOUBLE_EQ(3.0, FrameProfiler::GetAverageMilliseconds("ProfilerTest a"));
+	EXPECT_DOUBLE_EQ(4.0, FrameProfiler::GetAverageCount(ProfileCounter::DrawCalls));
+	EXPECT_GE(FrameProfiler::GetAverageFrameMilliseconds(), 0.0);
+}
+
+// --------------------------------------------------------
+// Threads that exit hand their rings on, so a run of short
+// lived threads shares a ring or two instead of one each
+// --------------------------------------------------------
+TEST(FrameProfilerTests, ReusesRingsOfExitedThreads)
+{
+	StartFrame();
+	FrameProfiler::BeginCapture();
+	for (int t = 0; t < 50; t++)
+	{
+		std::thread thread([]() { FrameProfiler::Record("ProfilerTest short", 0, Millisecond); });
+		thread.join();
+	}
+	FrameProfiler::EndFrame();
+
+	const char* file = "FrameProfilerTests_rings.json";
+	ASSERT_TRUE(FrameProfiler::EndCapture(file));
+	std::string trace = ReadFile(file);
+	remove(file);
+
+	std::vector<int> threads = TraceThreads(trace, "ProfilerTest short");
+	ASSERT_EQ(50u, threads.size());
+	std::set<int> distinct(threads.begin(), threads.end());
+	EXPECT_LE(distinct.size(), 2u);
+}
+
+// --------------------------------------------------------
+// A capture writes scopes, thread names, counters and frame
+// markers as Chrome trace JSON, with names escaped
+// --------------------------------------------------------
+TEST(FrameProfilerTests, WritesChromeTrace)
+{
+	StartFrame();
+	EXPECT_FALSE(FrameProfiler::IsCapturing());
+	FrameProfiler::BeginCapture();
+	EXPECT_TRUE(FrameProfiler::IsCapturing());
+
+	FrameProfiler::NameThread("ProfilerTest main");
+	FrameProfiler::Record("ProfilerTest traced", 2 * Millisecond, 5 * Millisecond);
+	FrameProfiler::Record("ProfilerTest \"quoted\"", 0, Millisecond);
+	PROFILE_COUNT(DrawCalls, 9);
+	FrameProfiler::EndFrame();
+
+	const char* file = "FrameProfilerTests_trace.json";
+	ASSERT_TRUE(FrameProfiler::EndCapture(file));
+	EXPECT_FALSE(FrameProfiler::IsCapturing());
+	std::string trace = ReadFile(file);
+	remove(file);
+
+	EXPECT_EQ(0u, trace.find("{\"displayTimeUnit\":\"ms\",\"traceEvents\":["));
+	EXPECT_NE(std::string::npos, trace.find("\"ph\":\"M\",\"pid\":1,\"tid\":"));
+	EXPECT_NE(std::string::npos, trace.find("\"args\":{\"name\":\"ProfilerTest main\"}"));
+	EXPECT_NE(std::string::npos, trace.find("{\"name\":\"ProfilerTest traced\",\"ph\":\"X\""));
+	EXPECT_NE(std::string::npos, trace.find("\"ts\":2000.000,\"dur\":3000.000}"));
+	EXPECT_NE(std::string::npos, trace.find("{\"name\":\"ProfilerTest \\\"quoted\\\"\",\"ph\":\"X\""));
+	EXPECT_NE(std::string::npos, trace.find("{\"name\":\"Frame\",\"ph\":\"i\""));
+	EXPECT_NE(std::string::npos, trace.find("{\"name\":\"Draw calls\",\"ph\":\"C\""));
+	EXPECT_NE(std::string::npos, trace.find("\"args\":{\"value\":9}}"));
+
+	// Brackets balance outside of strings
+	int depth = 0;
+	bool inString = false;
+	for (size_t i = 0; i < trace.size(); i++)
+	{
+		char c = trace[i];
+		if (inString)
+		{
+			if (c == '\\')
+				i++;
+			else if (c == '"')
+				inString = false;
+			continue;
+		}
+		if (c == '"')
+			inString = true;
+		else if (c == '{' || c == '[')
+			depth++;
+		else if (c == '}' || c == ']')
+			EXPECT_GE(--depth, 0);
+	}
+	EXPECT_EQ(0, depth);
+	EXPECT_FALSE(inString);
+}
+
+#endif
@@ -0,0 +1,276 @@
+#include "IrradianceBaker.h"
+#include "JobSystem.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	const double Pi = 3.14159265358979323846;
+
+	// An environment as a function of a unit direction
+	typedef void (*Environment)(double x, double y, double z, double rgb[3]);
+
+	// --------------------------------------------------------
+	// Only uses the first nine spherical harmonics, so the
+	// nine-term bake should be exact up to discretization
+	// --------------------------------------------------------
+	void BandLimitedSky(double x, double y, double z, double rgb[3])
+	{
+		rgb[0] = 1.0 + 0.5 * y;
+		rgb[1] = 0.8 + 0.3 * x * z + 0.1 * (3.0 * z * z - 1.0);
+		rgb[2] = 0.5 + 0.25 * (x * x - y * y) + 0.1 * x;
+	}
+
+	// --------------------------------------------------------
+	// A blue sky over brown ground, with a crease at the
+	// horizon that nine terms can only approximate
+	// --------------------------------------------------------
+	void GradientSky(double x, double y, double z, double rgb[3])
+	{
+		double up = std::max(0.0, y);
+		double down = std::max(0.0, -y);
+		rgb[0] = 0.3 * up + 0.2 * down + 0.05;
+		rgb[1] = 0.5 * up + 0.15 * down + 0.05;
+		rgb[2] = 1.0 * up + 0.1 * down + 0.05;
+	}
+
+	void MakeCubeMap(Environment environment, int size, CubeMapData& cube)
+	{
+		cube.Resize(size);
+		for (int f = 0; f < 6; f++)
+		{
+			for (int y = 0; y < size; y++)
+			{
+				for (int x = 0; x < size; x++)
+				{
+					XMFLOAT3 d = CubeMapData::TexelDirection(f, size, x, y);
+					double rgb[3];
+					environment(d.x, d.y, d.z, rgb);
+					cube.Faces[f][y * size + x] = XMFLOAT3((float)rgb[0], (float)rgb[1], (float)rgb[2]);
+				}
+			}
+		}
+	}
+
+	void Basis(double x, double y, double z, double basis[9])
+	{
+		basis[0] = 0.282094792;
+		basis[1] = 0.488602512 * y;
+		basis[2] = 0.488602512 * z;
+		basis[3] = 0.488602512 * x;
+		basis[4] = 1.092548431 * x * y;
+		basis[5] = 1.092548431 * y * z;
+		basis[6] = 0.315391565 * (3.0 * z * z - 1.0);
+		basis[7] = 1.092548431 * x * z;
+		basis[8] = 0.546274215 * (x * x - y * y);
+	}
+
+	// --------------------------------------------------------
+	// Integrates over the sphere on a latitude/longitude grid
+	// in doubles, straight from the environment function
+	// --------------------------------------------------------
+	const int GridRows = 256;
+	const int GridColumns = 512;
+
+	template<typename Visit>
+	void ForEachGridDirection(Visit visit)
+	{
+		for (int i = 0; i < GridRows; i++)
+		{
+			double theta = (i + 0.5) * Pi / GridRows;
+			double solidAngle = sin(theta) * (Pi / GridRows) * (2.0 * Pi / GridColumns);
+			for (int j = 0; j < GridColumns; j++)
+			{
+				double phi = (j + 0.5) * 2.0 * Pi / GridColumns;
+				visit(sin(theta) * cos(phi), cos(theta), sin(theta) * sin(phi), solidAngle);
+			}
+		}
+	}
+
+	void ReferenceCoefficients(Environment environment, double sh[9][3])
+	{
+		for (int i = 0; i < 9; i++)
+			sh[i][0] = sh[i][1] = sh[i][2] = 0.0;
+
+		ForEachGridDirection([&](double x, double y, double z, double solidAngle) {
+			double rgb[3], basis[9];
+			environment(x, y, z, rgb);
+			Basis(x, y, z, basis);
+			for (int i = 0; i < 9; i++)
+				for (int c = 0; c < 3; c++)
+					sh[i][c] += rgb[c] * basis[i] * solidAngle;
+		});
+	}
+
+	// --------------------------------------------------------
+	// Cosine-weighted radiance over the hemisphere around n,
+	// divided by PI like the convolution shader's output
+	// --------------------------------------------------------
+	void ReferenceIrradiance(Environment environment, double nx, double ny, double nz, double rgb[3])
+	{
+		rgb[0] = rgb[1] = rgb[2] = 0.0;
+		ForEachGridDirection([&](double x, double y, double z, double solidAngle) {
+			double cosine = x * nx + y * ny + z * nz;
+			if (cosine <= 0.0)
+				return;
+			double radiance[3];
+			environment(x, y, z, radiance);
+			for (int c = 0; c < 3; c++)
+				rgb[c] += radiance[c] * cosine * solidAngle / Pi;
+		});
+	}
+
+	// --------------------------------------------------------
+	// Bakes the environment and checks the coefficients and
+	// every output texel against the brute-force integrals,
+	// relative to the largest of each
+	// --------------------------------------------------------
+	void CheckBake(Environment environment, int inputSize, int outputSize, double coefficientTolerance, double irradianceTolerance)
+	{
+		CubeMapData radiance, irradiance;
+		MakeCubeMap(environment, inputSize, radiance);
+
+		SHCoefficients sh;
+		IrradianceBaker::Bake(radiance, outputSize, sh, irradiance);
+		ASSERT_EQ(outputSize, irradiance.Size);
+
+		double expected[9][3];
+		ReferenceCoefficients(environment, expected);
+		double largest = 0.0;
+		for (int i = 0; i < 9; i++)
+			for (int c = 0; c < 3; c++)
+				largest = std::max(largest, fabs(expected[i][c]));
+
+		for (int i = 0; i < 9; i++)
+		{
+			EXPECT_NEAR(expected[i][0], sh.C[i].x, coefficientTolerance * largest) << "coefficient " << i;
+			EXPECT_NEAR(expected[i][1], sh.C[i].y, coefficientTolerance * largest) << "coefficient " << i;
+			EXPECT_NEAR(expected[i][2], sh.C[i].z, coefficientTolerance * largest) << "coefficient " << i;
+		}
+
+		// Every texel of a small output cube - the integrals are slow
+		std::vector<double> reference;
+		double brightest = 0.0;
+		for (int f = 0; f < 6; f++)
+		{
+			for (int y = 0; y < outputSize; y++)
+			{
+				for (int x = 0; x < outputSize; x++)
+				{
+					XMFLOAT3 n = CubeMapData::TexelDirection(f, outputSize, x, y);
+					double rgb[3];
+					ReferenceIrradiance(environment, n.x, n.y, n.z, rgb);
+					reference.insert(reference.end(), rgb, rgb + 3);
+					brightest = std::max(brightest, std::max(rgb[0], std::max(rgb[1], rgb[2])));
+				}
+			}
+		}
+
+		size_t r = 0;
+		for (int f = 0; f < 6; f++)
+		{
+			for (int t = 0; t < outputSize * outputSize; t++, r += 3)
+			{
+				const XMFLOAT3& baked = irradiance.Faces[f][t];
+				EXPECT_NEAR(reference[r], baked.x, irradianceTolerance * brightest) << "face " << f << " texel " << t;
+				EXPECT_NEAR(reference[r + 1], baked.y, irradianceTolerance * brightest) << "face " << f << " texel " << t;
+				EXPECT_NEAR(reference[r + 2], baked.z, irradianceTolerance * brightest) << "face " << f << " texel " << t;
+			}
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Nine terms describe this sky exactly, so all that's left
+// is texel and grid discretization: 0.1% of the largest
+// value.  The input size isn't a multiple of four, so the
+// last vector of every row is partly empty.
+// --------------------------------------------------------
+TEST(IrradianceBakerTests, MatchesBruteForceOnBandLimitedSky)
+{
+	CheckBake(BandLimitedSky, 62, 6, 1e-3, 1e-3);
+}
+
+// --------------------------------------------------------
+// Nine terms can't follow the horizon crease exactly - the
+// usual bound for irradiance from nine terms is a few
+// percent, so this allows 3% of the brightest texel
+// --------------------------------------------------------
+TEST(IrradianceBakerTests, ApproximatesBruteForceOnGradientSky)
+{
+	CheckBake(GradientSky, 64, 5, 1e-3, 3e-2);
+}
+
+// --------------------------------------------------------
+// A constant sky has only the first coefficient, and its
+// irradiance over PI is the sky's value everywhere.  Texel
+// solid angles are approximated, so the total is within
+// 0.1% of 4 PI at this size.
+// --------------------------------------------------------
+TEST(IrradianceBakerTests, BakesConstantSky)
+{
+	CubeMapData radiance, irradiance;
+	radiance.Resize(64);
+	for (int f = 0; f < 6; f++)
+		std::fill(radiance.Faces[f].begin(), radiance.Faces[f].end(), XMFLOAT3(2.0f, 1.0f, 0.5f));
+
+	SHCoefficients sh;
+	IrradianceBaker::Bake(radiance, 4, sh, irradiance);
+
+	double c0 = sqrt(4.0 * Pi);
+	EXPECT_NEAR(2.0 * c0, sh.C[0].x, 2.0 * c0 * 1e-3);
+	EXPECT_NEAR(1.0 * c0, sh.C[0].y, 1.0 * c0 * 1e-3);
+	EXPECT_NEAR(0.5 * c0, sh.C[0].z, 0.5 * c0 * 1e-3);
+	for (int i = 1; i < 9; i++)
+	{
+		EXPECT_NEAR(0.0f, sh.C[i].x, 1e-4) << "coefficient " << i;
+		EXPECT_NEAR(0.0f, sh.C[i].y, 1e-4) << "coefficient " << i;
+		EXPECT_NEAR(0.0f, sh.C[i].z, 1e-4) << "coefficient " << i;
+	}
+
+	for (int f = 0; f < 6; f++)
+	{
+		for (size_t t = 0; t < irradiance.Faces[f].size(); t++)
+		{
+			EXPECT_NEAR(2.0f, irradiance.Faces[f][t].x, 2e-3);
+			EXPECT_NEAR(1.0f, irradiance.Faces[f][t].y, 1e-3);
+			EXPECT_NEAR(0.5f, irradiance.Faces[f][t].z, 0.5e-3);
+		}
+	}
+}
+
+// --------------------------------------------------------
+// The projection sums fixed slices of rows, so splitting
+// them across jobs gives exactly the serial bake
+// --------------------------------------------------------
+TEST(IrradianceBakerTests, JobsMatchSerialBake)
+{
+	CubeMapData radiance;
+	MakeCubeMap(GradientSky, 128, radiance);
+
+	SHCoefficients serialSH, jobsSH;
+	CubeMapData serial, parallel;
+	IrradianceBaker::Bake(radiance, 64, serialSH, serial);
+
+	JobSystem jobs(3);
+	IrradianceBaker::Bake(radiance, 64, jobsSH, parallel, &jobs);
+
+	for (int i = 0; i < 9; i++)
+	{
+		EXPECT_EQ(serialSH.C[i].x, jobsSH.C[i].x) << "coefficient " << i;
+		EXPECT_EQ(serialSH.C[i].y, jobsSH.C[i].y) << "coefficient " << i;
+		EXPECT_EQ(serialSH.C[i].z, jobsSH.C[i].z) << "coefficient " << i;
+	}
+	for (int f = 0; f < 6; f++)
+	{
+		for (size_t t = 0; t < serial.Faces[f].size(); t++)
+		{
+			EXPECT_EQ(serial.Faces[f][t].x, parallel.Faces[f][t].x) << "face " << f << " texel " << t;
+			EXPECT_EQ(serial.Faces[f][t].y, parallel.Faces[f][t].y) << "face " << f << " texel " << t;
+			EXPECT_EQ(serial.Faces[f][t].z, parallel.Faces[f][t].z) << "face " << f << " texel " << t;
+		}
+	}
+}
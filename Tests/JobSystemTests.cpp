@@ -0,0 +1,291 @@
+#include "JobSystem.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	// --------------------------------------------------------
+	// Spins until count reaches target or a few seconds pass,
+	// so a scheduling bug fails the test instead of hanging it
+	// --------------------------------------------------------
+	bool WaitForCount(const std::atomic<int>& count, int target)
+	{
+		std::chrono::steady_clock::time_point giveUp = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+		while (count < target)
+		{
+			if (std::chrono::steady_clock::now() > giveUp)
+				return false;
+			std::this_thread::yield();
+		}
+		return true;
+	}
+}
+
+TEST(JobSystemTests, RunsEveryJob)
+{
+	JobSystem jobs(3);
+	std::atomic<int> runs(0);
+
+	std::vector<JobHandle> handles;
+	for (int i = 0; i < 1000; i++)
+		handles.push_back(jobs.Schedule("Count", [&]() { runs++; }));
+	for (size_t i = 0; i < handles.size(); i++)
+		jobs.Wait(handles[i]);
+
+	EXPECT_EQ(1000, runs);
+	for (size_t i = 0; i < handles.size(); i++)
+		EXPECT_TRUE(jobs.IsFinished(handles[i]));
+}
+
+// --------------------------------------------------------
+// Every index is visited exactly once, for counts that
+// don't divide into the ranges and for a grain bigger than
+// the whole count
+// --------------------------------------------------------
+TEST(JobSystemTests, ParallelForVisitsEachIndexOnce)
+{
+	JobSystem jobs(3);
+	size_t counts[] = { 0, 1, 7, 1000, 10007 };
+	size_t grains[] = { 1, 64, 100000 };
+
+	for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++)
+	{
+		for (size_t g = 0; g < sizeof(grains) / sizeof(grains[0]); g++)
+		{
+			std::vector<std::atomic<int>> visits(counts[c]);
+			for (size_t i = 0; i < visits.size(); i++)
+				visits[i] = 0;
+
+			std::atomic<int> ranges(0);
+			JobHandle loop = jobs.ParallelFor("Visit", counts[c], grains[g], [&](size_t first, size_t last) {
+				EXPECT_LT(first, last);
+				EXPECT_LE(last, counts[c]);
+				EXPECT_TRUE(last - first >= grains[g] || last == counts[c]);
+				for (size_t i = first; i < last; i++)
+					visits[i]++;
+				ranges++;
+			});
+			jobs.Wait(loop);
+
+			for (size_t i = 0; i < visits.size(); i++)
+				ASSERT_EQ(1, visits[i]) << "index " << i << " of " << counts[c] << ", grain " << grains[g];
+			if (counts[c] > 0 && grains[g] >= counts[c])
+				EXPECT_EQ(1, ranges) << counts[c] << " with grain " << grains[g];
+			jobs.Reset();
+		}
+	}
+}
+
+// --------------------------------------------------------
+// A diamond: two jobs after the first, and a last one after
+// both of them, with a loop that waits on the last
+// --------------------------------------------------------
+TEST(JobSystemTests, RunsDependenciesFirst)
+{
+	JobSystem jobs(3);
+	for (int repeat = 0; repeat < 100; repeat++)
+	{
+		std::atomic<int> clock(0);
+		int top = -1, left = -1, right = -1, bottom = -1;
+		std::atomic<int> loopStart(-1);
+
+		JobHandle a = jobs.Schedule("Top", [&]() { std::this_thread::yield(); top = clock++; });
+		JobHandle b = jobs.Schedule("Left", [&]() { left = clock++; }, { a });
+		JobHandle c = jobs.Schedule("Right", [&]() { right = clock++; }, { a });
+		JobHandle d = jobs.Schedule("Bottom", [&]() { bottom = clock++; }, { b, c });
+		JobHandle loop = jobs.ParallelFor("After", 64, 1, [&](size_t first, size_t) {
+			if (first == 0)
+				loopStart = clock++;
+		}, { d });
+		jobs.Wait(loop);
+
+		EXPECT_LT(top, left);
+		EXPECT_LT(top, right);
+		EXPECT_LT(left, bottom);
+		EXPECT_LT(right, bottom);
+		EXPECT_LT(bottom, (int)loopStart);
+		jobs.Reset();
+	}
+}
+
+// --------------------------------------------------------
+// Depending on a job that already finished, or on nothing,
+// queues straight away
+// --------------------------------------------------------
+TEST(JobSystemTests, StartsAfterFinishedDependencies)
+{
+	JobSystem jobs(1);
+	JobHandle first = jobs.Schedule("First", []() {});
+	jobs.Wait(first);
+
+	bool ran = false;
+	JobHandle second = jobs.Schedule("Second", [&]() { ran = true; }, { first, 0 });
+	jobs.Wait(second);
+	EXPECT_TRUE(ran);
+}
+
+// --------------------------------------------------------
+// Main thread jobs scheduled from workers still run on the
+// thread that created the system
+// --------------------------------------------------------
+TEST(JobSystemTests, KeepsMainThreadJobsOnMainThread)
+{
+	JobSystem jobs(3);
+	std::thread::id mainThread = std::this_thread::get_id();
+	std::atomic<int> wrongThread(0);
+	std::atomic<int> runs(0);
+
+	JobHandle loop = jobs.ParallelFor("Record", 256, 1, [&](size_t first, size_t last) {
+		for (size_t i = first; i < last; i++)
+		{
+			jobs.Schedule("Submit", [&]() {
+				if (std::this_thread::get_id() != mainThread)
+					wrongThread++;
+				runs++;
+			}, {}, JobAffinity::MainThread);
+		}
+	});
+	jobs.Wait(loop);
+
+	// Everything above is queued by now, and only this thread
+	// can run it
+	JobHandle last = jobs.Schedule("Last", []() {}, {}, JobAffinity::MainThread);
+	jobs.Wait(last);
+	EXPECT_TRUE(WaitForCount(runs, 256));
+	EXPECT_EQ(0, wrongThread);
+}
+
+// --------------------------------------------------------
+// A job that waits on work it scheduled keeps its thread
+// busy with other jobs instead of blocking - even with one
+// worker, and with the main thread waiting too
+// --------------------------------------------------------
+TEST(JobSystemTests, WaitsInsideJobs)
+{
+	JobSystem jobs(1);
+	std::atomic<long long> sum(0);
+
+	std::vector<JobHandle> outers;
+	for (int o = 0; o < 8; o++)
+	{
+		outers.push_back(jobs.Schedule("Outer", [&]() {
+			JobHandle inner = jobs.ParallelFor("Inner", 1000, 1, [&](size_t first, size_t last) {
+				for (size_t i = first; i < last; i++)
+					sum += (long long)i;
+			});
+			jobs.Wait(inner);
+		}));
+	}
+	for (size_t o = 0; o < outers.size(); o++)
+		jobs.Wait(outers[o]);
+
+	EXPECT_EQ(8LL * 999 * 1000 / 2, (long long)sum);
+}
+
+// --------------------------------------------------------
+// Jobs left in the main thread's queue get stolen: each of
+// these only finishes once all four are running at once,
+// which needs the main thread and all three workers
+// --------------------------------------------------------
+TEST(JobSystemTests, StealsQueuedJobs)
+{
+	JobSystem jobs(3);
+	std::atomic<int> started(0);
+	std::atomic<int> timedOut(0);
+
+	std::vector<JobHandle> handles;
+	for (int i = 0; i < 4; i++)
+	{
+		handles.push_back(jobs.Schedule("Meet", [&]() {
+			started++;
+			if (!WaitForCount(started, 4))
+				timedOut++;
+		}));
+	}
+	for (size_t i = 0; i < handles.size(); i++)
+		jobs.Wait(handles[i]);
+	EXPECT_EQ(0, timedOut);
+
+	std::set<int> threads;
+	std::vector<JobTiming> timings = jobs.GetTimings();
+	for (size_t i = 0; i < timings.size(); i++)
+		threads.insert(timings[i].Thread);
+	EXPECT_EQ(4u, threads.size());
+}
+
+// --------------------------------------------------------
+// Every run is timed under its name and thread, and Reset()
+// drops the timings
+// --------------------------------------------------------
+TEST(JobSystemTests, TimesEveryRun)
+{
+	JobSystem jobs(2);
+	EXPECT_EQ(3, jobs.GetThreadCount());
+
+	JobHandle single = jobs.Schedule("Single", []() { std::this_thread::sleep_for(std::chrono::milliseconds(2)); });
+	JobHandle loop = jobs.ParallelFor("Loop", 8, 1, [](size_t, size_t) {}, { single });
+	jobs.Wait(loop);
+
+	std::vector<JobTiming> timings = jobs.GetTimings();
+	int singles = 0, loops = 0;
+	for (size_t i = 0; i < timings.size(); i++)
+	{
+		EXPECT_LE(timings[i].Start, timings[i].End);
+		EXPECT_GE(timings[i].Thread, 0);
+		EXPECT_LT(timings[i].Thread, jobs.GetThreadCount());
+		if (i > 0)
+			EXPECT_LE(timings[i - 1].Start, timings[i].Start);
+
+		if (strcmp(timings[i].Name, "Single") == 0)
+		{
+			singles++;
+			EXPECT_GE(timings[i].End - timings[i].Start, 1.0);
+		}
+		else if (strcmp(timings[i].Name, "Loop") == 0)
+			loops++;
+	}
+	EXPECT_EQ(1, singles);
+	EXPECT_GE(loops, 1);
+	EXPECT_EQ(timings.size(), (size_t)(singles + loops));
+
+	jobs.Reset();
+	EXPECT_TRUE(jobs.GetTimings().empty());
+}
+
+// --------------------------------------------------------
+// Each system knows its own main thread: creating and
+// destroying another one on the same thread, or inside a
+// job, leaves the first able to run main thread jobs
+// --------------------------------------------------------
+TEST(JobSystemTests, KeepsMainThreadAcrossSystems)
+{
+	JobSystem outer(1);
+	EXPECT_EQ(0, outer.GetCurrentThread());
+	{
+		JobSystem sequential(1);
+		EXPECT_EQ(0, sequential.GetCurrentThread());
+		sequential.Wait(sequential.Schedule("Inner main", []() {}, {}, JobAffinity::MainThread));
+	}
+	EXPECT_EQ(0, outer.GetCurrentThread());
+
+	std::atomic<int> runs(0);
+	JobHandle nested = outer.Schedule("Nested system", [&]() {
+		JobSystem inner(1);
+		EXPECT_EQ(0, inner.GetCurrentThread());
+		inner.Wait(inner.Schedule("Inner main", [&]() { runs++; }, {}, JobAffinity::MainThread));
+	});
+	outer.Wait(nested);
+
+	JobHandle main = outer.Schedule("Outer main", [&]() { runs++; }, {}, JobAffinity::MainThread);
+	outer.Wait(main);
+	EXPECT_EQ(2, runs);
+	EXPECT_EQ(0, outer.GetCurrentThread());
+
+	std::thread other([&]() { EXPECT_EQ(-1, outer.GetCurrentThread()); });
+	other.join();
+}
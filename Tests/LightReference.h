@@ -0,0 +1,215 @@
+#pragma once
+#include "LightSystem.h"
+#include "TransformReference.h"
+#include <DirectXMath.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// --------------------------------------------------------
+// Light binning the brute-force way: every light tested
+// against every cluster's view space box, in doubles, with
+// spot lights also tested against the box's bounding sphere
+// with their cone.  Used by the tests as the expected result
+// and by the benchmarks as the baseline.
+// --------------------------------------------------------
+namespace LightReference
+{
+	// --------------------------------------------------------
+	// One cluster of the view frustum: the view depths it
+	// spans, its edges as x / z and y / z, and its box
+	// --------------------------------------------------------
+	struct Cluster
+	{
+		double Near, Far;
+		double Left, Right;
+		double Top, Bottom;
+		double Min[3], Max[3];
+	};
+
+	// A light moved into view space
+	struct ViewLight
+	{
+		double Center[3];
+		double Direction[3];
+		double Range;
+		double CosOuter, SinOuter;
+		bool Spot;
+	};
+
+	// --------------------------------------------------------
+	// Clusters from the transposed projection, in the order
+	// LightSystem keeps them - slices, then rows down the
+	// screen, then columns
+	// --------------------------------------------------------
+	inline void MakeClusters(const DirectX::XMFLOAT4X4& projection, std::vector<Cluster>& clusters)
+	{
+		// Transposed, so row r holds column r of the projection
+		double nearClip = -(double)projection.m[2][3] / projection.m[2][2];
+		double farClip = (double)projection.m[2][3] / (1.0 - projection.m[2][2]);
+
+		clusters.resize(LightSystem::ClusterCount);
+		for (int z = 0; z < LightSystem::ClustersZ; z++)
+		{
+			for (int y = 0; y < LightSystem::ClustersY; y++)
+			{
+				for (int x = 0; x < LightSystem::ClustersX; x++)
+				{
+					Cluster& c = clusters[(z * LightSystem::ClustersY + y) * LightSystem::ClustersX + x];
+					c.Near = nearClip * pow(farClip / nearClip, (double)z / LightSystem::ClustersZ);
+					c.Far = nearClip * pow(farClip / nearClip, (double)(z + 1) / LightSystem::ClustersZ);
+					c.Left = (-1.0 + 2.0 * x / LightSystem::ClustersX) / projection.m[0][0];
+					c.Right = (-1.0 + 2.0 * (x + 1) / LightSystem::ClustersX) / projection.m[0][0];
+					c.Top = (1.0 - 2.0 * y / LightSystem::ClustersY) / projection.m[1][1];
+					c.Bottom = (1.0 - 2.0 * (y + 1) / LightSystem::ClustersY) / projection.m[1][1];
+
+					c.Min[0] = std::min(c.Left * c.Near, c.Left * c.Far);
+					c.Max[0] = std::max(c.Right * c.Near, c.Right * c.Far);
+					c.Min[1] = std::min(c.Bottom * c.Near, c.Bottom * c.Far);
+					c.Max[1] = std::max(c.Top * c.Near, c.Top * c.Far);
+					c.Min[2] = c.Near;
+					c.Max[2] = c.Far;
+				}
+			}
+		}
+	}
+
+	// Through the transposed view matrix
+	inline ViewLight MakeViewLight(const Light& light, const DirectX::XMFLOAT4X4& view)
+	{
+		const float* position = &light.Position.x;
+		const float* direction = &light.Direction.x;
+
+		ViewLight v;
+		double length = 0.0;
+		for (int r = 0; r < 3; r++)
+		{
+			v.Center[r] = view.m[r][3];
+			v.Direction[r] = 0.0;
+			for (int k = 0; k < 3; k++)
+			{
+				v.Center[r] += (double)view.m[r][k] * position[k];
+				v.Direction[r] += (double)view.m[r][k] * direction[k];
+			}
+			length += v.Direction[r] * v.Direction[r];
+		}
+		for (int r = 0; r < 3; r++)
+			v.Direction[r] /= sqrt(length);
+
+		v.Range = light.Range;
+		v.CosOuter = cos((double)light.OuterAngle);
+		v.SinOuter = sin((double)light.OuterAngle);
+		v.Spot = light.Type == LightType::Spot && light.OuterAngle < DirectX::XM_PIDIV2;
+		return v;
+	}
+
+	// --------------------------------------------------------
+	// Whether the light can reach the cluster's box, grown by
+	// slack times the cluster's far depth.  Spot lights are
+	// then tested against the grown box's bounding sphere.
+	// --------------------------------------------------------
+	inline bool Reaches(const Cluster& cluster, const ViewLight& light, double slack = 0.0)
+	{
+		double grow = slack * cluster.Far;
+		double distanceSq = 0.0;
+		double sphere[4] = { 0.0, 0.0, 0.0, 0.0 };
+		for (int a = 0; a < 3; a++)
+		{
+			double low = cluster.Min[a] - grow;
+			double high = cluster.Max[a] + grow;
+			double outside = std::max(low - light.Center[a], 0.0) + std::max(light.Center[a] - high, 0.0);
+			distanceSq += outside * outside;
+
+			sphere[a] = (low + high) * 0.5;
+			sphere[3] += (high - low) * (high - low) * 0.25;
+		}
+		if (distanceSq > light.Range * light.Range)
+			return false;
+		if (!light.Spot)
+			return true;
+
+		// The cone against the box's bounding sphere
+		double v[3] = { sphere[0] - light.Center[0], sphere[1] - light.Center[1], sphere[2] - light.Center[2] };
+		double radius = sqrt(sphere[3]);
+		double lengthSq = v[0] * v[0] + v[1] * v[1] + v[2] * v[2];
+		double along = v[0] * light.Direction[0] + v[1] * light.Direction[1] + v[2] * light.Direction[2];
+		double closest = light.CosOuter * sqrt(std::max(lengthSq - along * along, 0.0)) - along * light.SinOuter;
+		return closest <= radius && along <= radius + light.Range && along >= -radius;
+	}
+
+	// --------------------------------------------------------
+	// Whether the light lights any of a grid of points strictly
+	// inside the cluster - if it does, the cluster has to list
+	// it, however the cluster is bounded
+	// --------------------------------------------------------
+	inline bool Lights(const Cluster& cluster, const ViewLight& light, int steps = 4)
+	{
+		for (int k = 0; k < steps; k++)
+		{
+			double depth = cluster.Near + (cluster.Far - cluster.Near) * (k + 0.5) / steps;
+			for (int j = 0; j < steps; j++)
+			{
+				double y = (cluster.Top + (cluster.Bottom - cluster.Top) * (j + 0.5) / steps) * depth;
+				for (int i = 0; i < steps; i++)
+				{
+					double x = (cluster.Left + (cluster.Right - cluster.Left) * (i + 0.5) / steps) * depth;
+					double v[3] = { x - light.Center[0], y - light.Center[1], depth - light.Center[2] };
+					double length = sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+					if (length >= light.Range)
+						continue;
+					if (light.Spot && v[0] * light.Direction[0] + v[1] * light.Direction[1] + v[2] * light.Direction[2] < light.CosOuter * length)
+						continue;
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	// --------------------------------------------------------
+	// Every light each cluster's box is reached by, in order
+	// --------------------------------------------------------
+	inline void Bin(const std::vector<Light>& lights, const DirectX::XMFLOAT4X4& view, const std::vector<Cluster>& clusters,
+		std::vector<std::vector<unsigned int> >& binned)
+	{
+		std::vector<ViewLight> viewLights(lights.size());
+		for (size_t i = 0; i < lights.size(); i++)
+			viewLights[i] = MakeViewLight(lights[i], view);
+
+		binned.resize(clusters.size());
+		for (size_t c = 0; c < clusters.size(); c++)
+		{
+			binned[c].clear();
+			for (size_t i = 0; i < viewLights.size(); i++)
+			{
+				if (Reaches(clusters[c], viewLights[i]))
+					binned[c].push_back((unsigned int)i);
+			}
+		}
+	}
+
+	// --------------------------------------------------------
+	// Pseudo-random point and spot lights through a cube of
+	// the given half size around the origin - a few spots are
+	// wider than a half space
+	// --------------------------------------------------------
+	inline void MakeLights(size_t count, float extent, unsigned int seed, std::vector<Light>& lights)
+	{
+		using TransformReference::Random;
+
+		lights.resize(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			Light& light = lights[i];
+			light.Type = i % 2 ? LightType::Spot : LightType::Point;
+			light.Position = DirectX::XMFLOAT3(Random(seed, -extent, extent), Random(seed, -extent, extent), Random(seed, -extent, extent));
+			light.Color = DirectX::XMFLOAT3(Random(seed, 0, 1), Random(seed, 0, 1), Random(seed, 0, 1));
+			light.Range = Random(seed, 1.0f, 15.0f);
+			light.Direction = DirectX::XMFLOAT3(Random(seed, -1, 1), Random(seed, -1, 1), Random(seed, -1, 1));
+			if (fabsf(light.Direction.x) + fabsf(light.Direction.y) + fabsf(light.Direction.z) < 0.1f)
+				light.Direction.z = 1.0f;
+			light.OuterAngle = Random(seed, 0.1f, 1.7f);
+			light.InnerAngle = light.OuterAngle * 0.75f;
+		}
+	}
+}
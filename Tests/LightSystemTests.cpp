@@ -0,0 +1,170 @@
+#include "LightSystem.h"
+#include "CullingReference.h"
+#include "LightReference.h"
+#include <gtest/gtest.h>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// LightSystem pads its cluster boxes by a thousandth of
+	// their far depth, so lights this close to a box, relative
+	// to that depth, may be listed without reaching it
+	const double BoxSlack = 2e-3;
+
+	void AddLights(const std::vector<Light>& lights, LightSystem& system)
+	{
+		for (size_t i = 0; i < lights.size(); i++)
+			EXPECT_EQ(i, system.Add(lights[i]));
+	}
+
+	// --------------------------------------------------------
+	// Bins from a handful of cameras and checks every cluster's
+	// list against testing every light: it has to hold each
+	// light that lights a point inside the cluster, and nothing
+	// that can't reach the cluster's box, in light order
+	// --------------------------------------------------------
+	void CheckAgainstReference(const std::vector<Light>& lights)
+	{
+		LightSystem system;
+		AddLights(lights, system);
+
+		XMFLOAT3 eyes[] = { XMFLOAT3(0, 0, -60), XMFLOAT3(0, 0, 0), XMFLOAT3(20, 5, 10), XMFLOAT3(-40, 30, 40) };
+		XMFLOAT3 directions[] = { XMFLOAT3(0, 0, 1), XMFLOAT3(1, 0.2f, 0.5f), XMFLOAT3(-1, -0.3f, 0), XMFLOAT3(1, -0.6f, -1) };
+		for (int e = 0; e < 4; e++)
+		{
+			SCOPED_TRACE(e);
+			XMFLOAT4X4 view, projection;
+			CullingReference::MakeCamera(eyes[e], directions[e], 120.0f, view, projection);
+			system.Update(view, projection);
+
+			std::vector<LightReference::Cluster> clusters;
+			LightReference::MakeClusters(projection, clusters);
+			std::vector<LightReference::ViewLight> viewLights(lights.size());
+			for (size_t i = 0; i < lights.size(); i++)
+				viewLights[i] = LightReference::MakeViewLight(lights[i], view);
+
+			const std::vector<LightCluster>& binned = system.GetClusters();
+			const std::vector<unsigned int>& indices = system.GetLightIndices();
+			ASSERT_EQ((size_t)LightSystem::ClusterCount, binned.size());
+
+			size_t listed = 0;
+			for (int c = 0; c < LightSystem::ClusterCount; c++)
+			{
+				std::vector<bool> inCluster(lights.size(), false);
+				for (unsigned int k = 0; k < binned[c].Count; k++)
+				{
+					unsigned int index = indices[binned[c].Offset + k];
+					ASSERT_LT(index, lights.size());
+					if (k > 0)
+						EXPECT_LT(indices[binned[c].Offset + k - 1], index) << "cluster " << c;
+					inCluster[index] = true;
+
+					EXPECT_TRUE(LightReference::Reaches(clusters[c], viewLights[index], BoxSlack)) << "cluster " << c << " light " << index;
+				}
+				listed += binned[c].Count;
+
+				for (size_t i = 0; i < lights.size(); i++)
+				{
+					if (!inCluster[i] && LightReference::Reaches(clusters[c], viewLights[i]))
+						EXPECT_FALSE(LightReference::Lights(clusters[c], viewLights[i])) << "cluster " << c << " light " << i;
+				}
+			}
+
+			// Enough lights were in view to mean something
+			EXPECT_GT(listed, lights.size());
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Point lights only need their spheres binned
+// --------------------------------------------------------
+TEST(LightSystemTests, PointLightsMatchBruteForce)
+{
+	std::vector<Light> lights;
+	LightReference::MakeLights(300, 60.0f, 31, lights);
+	for (size_t i = 0; i < lights.size(); i++)
+		lights[i].Type = LightType::Point;
+
+	CheckAgainstReference(lights);
+}
+
+// --------------------------------------------------------
+// Spot lights, including cones wider than a half space,
+// which are binned as spheres
+// --------------------------------------------------------
+TEST(LightSystemTests, SpotLightsMatchBruteForce)
+{
+	std::vector<Light> lights;
+	LightReference::MakeLights(300, 60.0f, 47, lights);
+	for (size_t i = 0; i < lights.size(); i++)
+		lights[i].Type = LightType::Spot;
+
+	CheckAgainstReference(lights);
+}
+
+// --------------------------------------------------------
+// A cone pointing away from a cluster inside its sphere
+// leaves that cluster out
+// --------------------------------------------------------
+TEST(LightSystemTests, SpotLightSkipsClustersBehindIt)
+{
+	XMFLOAT4X4 view, projection;
+	CullingReference::MakeCamera(XMFLOAT3(0, 0, 0), XMFLOAT3(0, 0, 1), 120.0f, view, projection);
+
+	Light light = {};
+	light.Type = LightType::Spot;
+	light.Position = XMFLOAT3(0, 0, 20);
+	light.Range = 10.0f;
+	light.Direction = XMFLOAT3(0, 0, 1);
+	light.OuterAngle = 0.3f;
+	light.InnerAngle = 0.2f;
+
+	LightSystem spot, point;
+	spot.Add(light);
+	light.Type = LightType::Point;
+	point.Add(light);
+	spot.Update(view, projection);
+	point.Update(view, projection);
+
+	EXPECT_GT(point.GetLightIndices().size(), spot.GetLightIndices().size());
+	EXPECT_GT(spot.GetLightIndices().size(), 0u);
+}
+
+// --------------------------------------------------------
+// Slices binned as jobs pack into exactly the serial result
+// --------------------------------------------------------
+TEST(LightSystemTests, JobsMatchSerialBinning)
+{
+	std::vector<Light> lights;
+	LightReference::MakeLights(4000, 80.0f, 59, lights);
+
+	LightSystem serial, parallel;
+	AddLights(lights, serial);
+	AddLights(lights, parallel);
+
+	JobSystem jobs(3);
+	XMFLOAT3 eyes[] = { XMFLOAT3(0, 0, -100), XMFLOAT3(10, 5, 0) };
+	XMFLOAT3 directions[] = { XMFLOAT3(0, 0, 1), XMFLOAT3(-1, 0.1f, 0.4f) };
+	for (int e = 0; e < 2; e++)
+	{
+		SCOPED_TRACE(e);
+		XMFLOAT4X4 view, projection;
+		CullingReference::MakeCamera(eyes[e], directions[e], 200.0f, view, projection);
+		serial.Update(view, projection);
+		parallel.Update(view, projection, &jobs);
+		jobs.Reset();
+
+		ASSERT_EQ(serial.GetLightIndices(), parallel.GetLightIndices());
+		const std::vector<LightCluster>& a = serial.GetClusters();
+		const std::vector<LightCluster>& b = parallel.GetClusters();
+		ASSERT_EQ(a.size(), b.size());
+		for (size_t c = 0; c < a.size(); c++)
+		{
+			EXPECT_EQ(a[c].Offset, b[c].Offset) << "cluster " << c;
+			EXPECT_EQ(a[c].Count, b[c].Count) << "cluster " << c;
+		}
+	}
+}
@@ -0,0 +1,216 @@
+#include "Mesh.h"
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// --------------------------------------------------------
+	// Keeps copies of everything Mesh hands it, so tests can
+	// check what would have gone to the GPU
+	// --------------------------------------------------------
+	class RecordingBackend : public GeometryBackend
+	{
+	public:
+		std::vector<Vertex> Verts;
+		std::vector<unsigned char> Indices;
+		int NumIndices;
+		IndexFormat Format;
+		int LiveBuffers;
+
+		RecordingBackend() : NumIndices(0), Format(IndexFormat::UInt32), LiveBuffers(0) {}
+
+		GeometryHandle CreateVertexBuffer(const Vertex* verts, int numVerts) override
+		{
+			Verts.assign(verts, verts + numVerts);
+			return NewHandle();
+		}
+
+		GeometryHandle CreateIndexBuffer(const void* indices, int numIndices, IndexFormat format) override
+		{
+			size_t size = numIndices * (format == IndexFormat::UInt16 ? sizeof(unsigned short) : sizeof(unsigned int));
+			Indices.assign((const unsigned char*)indices, (const unsigned char*)indices + size);
+			NumIndices = numIndices;
+			Format = format;
+			return NewHandle();
+		}
+
+		void ReleaseBuffer(GeometryHandle buffer) override
+		{
+			if (buffer)
+				LiveBuffers--;
+		}
+
+		unsigned int GetIndex(int i) const
+		{
+			if (Format == IndexFormat::UInt16)
+				return ((const unsigned short*)&Indices[0])[i];
+			return ((const unsigned int*)&Indices[0])[i];
+		}
+
+	private:
+		GeometryHandle NewHandle()
+		{
+			LiveBuffers++;
+			return (GeometryHandle)(size_t)LiveBuffers;
+		}
+	};
+
+	Vertex MakeVertex(float x, float y, float z, float u, float v)
+	{
+		Vertex vert = {};
+		vert.Position = XMFLOAT3(x, y, z);
+		vert.UV = XMFLOAT2(u, v);
+		vert.Normal = XMFLOAT3(0, 0, -1);
+		return vert;
+	}
+}
+
+// --------------------------------------------------------
+// A quad built from arrays goes through with 16-bit indices,
+// tangents and bounds, and its buffers are released after
+// --------------------------------------------------------
+TEST(MeshTests, BuildsBuffersFromArrays)
+{
+	Vertex verts[] =
+	{
+		MakeVertex(-1, -1, 0, 0, 1),
+		MakeVertex(-1,  1, 0, 0, 0),
+		MakeVertex( 1,  1, 0, 1, 0),
+		MakeVertex( 1, -1, 0, 1, 1)
+	};
+	unsigned int indices[] = { 0, 1, 2, 0, 2, 3 };
+
+	RecordingBackend backend;
+	{
+		Mesh mesh(verts, 4, indices, 6, &backend);
+		EXPECT_EQ(2, backend.LiveBuffers);
+		EXPECT_EQ(6, mesh.GetIndexCount());
+		EXPECT_EQ(IndexFormat::UInt16, mesh.GetIndexFormat());
+
+		ASSERT_EQ(4u, backend.Verts.size());
+		ASSERT_EQ(6, backend.NumIndices);
+		for (int i = 0; i < 6; i++)
+			EXPECT_EQ(indices[i], backend.GetIndex(i));
+
+		// U runs along +X on this quad
+		for (size_t i = 0; i < backend.Verts.size(); i++)
+		{
+			EXPECT_NEAR(1.0f, backend.Verts[i].Tangent.x, 1e-5f);
+			EXPECT_NEAR(0.0f, backend.Verts[i].Tangent.y, 1e-5f);
+			EXPECT_NEAR(1.0f, fabsf(backend.Verts[i].Tangent.w), 1e-5f);
+		}
+
+		const BoundingBox& box = mesh.GetBoundingBox();
+		EXPECT_NEAR(0.0f, box.Center.x, 1e-5f);
+		EXPECT_NEAR(1.0f, box.Extents.x, 1e-5f);
+		EXPECT_NEAR(1.0f, box.Extents.y, 1e-5f);
+		EXPECT_NEAR(0.0f, box.Extents.z, 1e-5f);
+	}
+	EXPECT_EQ(0, backend.LiveBuffers);
+}
+
+// --------------------------------------------------------
+// More vertices than 16 bits can address keeps 32-bit indices
+// --------------------------------------------------------
+TEST(MeshTests, KeepsWideIndicesForLargeMeshes)
+{
+	const int numVerts = 0x10002;
+	std::vector<Vertex> verts;
+	std::vector<unsigned int> indices;
+	for (int i = 0; i < numVerts; i++)
+		verts.push_back(MakeVertex((float)(i % 256), (float)(i / 256), 0, (float)(i % 256), (float)(i / 256)));
+	for (int i = 0; i + 2 < numVerts; i += 3)
+	{
+		indices.push_back(i);
+		indices.push_back(i + 1);
+		indices.push_back(i + 2);
+	}
+
+	RecordingBackend backend;
+	Mesh mesh(&verts[0], numVerts, &indices[0], (int)indices.size(), &backend);
+	EXPECT_EQ(IndexFormat::UInt32, mesh.GetIndexFormat());
+	ASSERT_EQ((int)indices.size(), backend.NumIndices);
+	EXPECT_EQ(indices.back(), backend.GetIndex(backend.NumIndices - 1));
+}
+
+// --------------------------------------------------------
+// LoadObj needs nothing from the graphics API, and its result
+// can be turned into buffers later
+// --------------------------------------------------------
+TEST(MeshTests, LoadsObjWithoutBackend)
+{
+	const char* file = "MeshTests_quad.obj";
+	const char* obj =
+		"v -1 -1 0\nv -1 1 0\nv 1 1 0\nv 1 -1 0\n"
+		"vt 0 1\nvt 0 0\nvt 1 0\nvt 1 1\n"
+		"vn 0 0 -1\n"
+		"f 1/1/1 2/2/1 3/3/1 4/4/1\n";
+	FILE* f = fopen(file, "wb");
+	ASSERT_TRUE(f != 0);
+	fwrite(obj, 1, strlen(obj), f);
+	fclose(f);
+
+	MeshData data;
+	ASSERT_TRUE(Mesh::LoadObj(file, 0, data));
+	remove(file);
+	EXPECT_EQ(4, data.NumVerts);
+	EXPECT_EQ(6, data.NumIndices);
+
+	RecordingBackend backend;
+	Mesh mesh(data, &backend);
+	EXPECT_EQ(6, mesh.GetIndexCount());
+	EXPECT_EQ(4u, backend.Verts.size());
+}
+
+// --------------------------------------------------------
+// Missing files fail instead of producing an empty mesh
+// --------------------------------------------------------
+TEST(MeshTests, FailsOnMissingFile)
+{
+	MeshData data;
+	EXPECT_FALSE(Mesh::LoadObj("MeshTests_missing.obj", 0, data));
+}
+
+// --------------------------------------------------------
+// A mesh with no triangles creates no buffers
+// --------------------------------------------------------
+TEST(MeshTests, SkipsBuffersWithoutIndices)
+{
+	Vertex verts[] = { MakeVertex(0, 0, 0, 0, 0) };
+
+	RecordingBackend backend;
+	{
+		Mesh mesh(verts, 1, 0, 0, &backend);
+		EXPECT_EQ(0, backend.LiveBuffers);
+		EXPECT_EQ(0, mesh.GetIndexCount());
+		EXPECT_TRUE(mesh.GetVertexBuffer() == 0);
+		EXPECT_TRUE(mesh.GetIndexBuffer() == 0);
+	}
+	EXPECT_EQ(0, backend.LiveBuffers);
+
+	MeshData empty;
+	Mesh fromData(empty, &backend);
+	EXPECT_EQ(0, backend.LiveBuffers);
+}
+
+// --------------------------------------------------------
+// An OBJ without faces fails to load instead of making an
+// empty mesh
+// --------------------------------------------------------
+TEST(MeshTests, RejectsObjWithoutFaces)
+{
+	const char* file = "MeshTests_points.obj";
+	const char* obj = "v 0 0 0\nv 1 0 0\nv 0 1 0\n";
+	FILE* f = fopen(file, "wb");
+	ASSERT_TRUE(f != 0);
+	fwrite(obj, 1, strlen(obj), f);
+	fclose(f);
+
+	MeshData data;
+	EXPECT_FALSE(Mesh::LoadObj(file, 0, data));
+	remove(file);
+}
@@ -0,0 +1,165 @@
+#include "ObjLoader.h"
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace
+{
+	struct ParsedObj
+	{
+		std::vector<Vertex> Verts;
+		std::vector<unsigned int> Indices;
+	};
+
+	ParsedObj Parse(const std::string& text)
+	{
+		ParsedObj obj;
+		ObjLoader::Parse(text.c_str(), text.size(), obj.Verts, obj.Indices);
+		return obj;
+	}
+
+	// Parses a single position line and returns its x
+	float ParseX(const char* number)
+	{
+		ParsedObj obj = Parse(std::string("v ") + number + " 0 0\nf 1 1 1\n");
+		EXPECT_EQ(1u, obj.Verts.size());
+		return obj.Verts.empty() ? 0.0f : obj.Verts[0].Position.x;
+	}
+}
+
+// --------------------------------------------------------
+// Numbers in all the forms exporters write them
+// --------------------------------------------------------
+TEST(ObjLoaderTests, ParsesNumbers)
+{
+	EXPECT_EQ(1.0f, ParseX("1"));
+	EXPECT_EQ(-2.5f, ParseX("-2.5"));
+	EXPECT_EQ(0.25f, ParseX("+.25"));
+	EXPECT_EQ(150.0f, ParseX("1.5e2"));
+	EXPECT_EQ(-0.25f, ParseX("-2.5E-1"));
+	EXPECT_EQ(3.0f, ParseX("0003"));
+	EXPECT_FLOAT_EQ(0.123456789f, ParseX("0.12345678901234567890123"));
+	EXPECT_FLOAT_EQ(1.2345678e25f, ParseX("12345678901234567890123456"));
+	EXPECT_FLOAT_EQ(1.5f, ParseX("15000000000000000000000000e-25"));
+}
+
+// --------------------------------------------------------
+// Huge exponents clamp to infinity or zero, never NaN
+// --------------------------------------------------------
+TEST(ObjLoaderTests, ClampsOutOfRangeNumbers)
+{
+	EXPECT_EQ(0.0f, ParseX("0e400"));
+	EXPECT_EQ(0.0f, ParseX("0.0e99999999999"));
+	EXPECT_EQ(0.0f, ParseX("1e-400"));
+	EXPECT_EQ(0.0f, ParseX("-1e-99999999999"));
+	EXPECT_EQ(HUGE_VALF, ParseX("1e400"));
+	EXPECT_EQ(HUGE_VALF, ParseX("1e39"));
+	EXPECT_EQ(-HUGE_VALF, ParseX("-1e99999999999"));
+	EXPECT_EQ(0.0f, ParseX("1e-50"));
+	EXPECT_FLOAT_EQ(1.0f, ParseX("100000000000000000000000000000000000000000e-41"));
+	EXPECT_FLOAT_EQ(1.0f, ParseX("0.00000000000000001e17"));
+}
+
+// --------------------------------------------------------
+// Indices too big for an int are invalid, not wrapped around
+// onto a real vertex
+// --------------------------------------------------------
+TEST(ObjLoaderTests, RejectsOverflowingIndices)
+{
+	ParsedObj obj = Parse(
+		"v 1 2 3\nv 4 5 6\nv 7 8 9\n"
+		"f 4294967297 2 3\n"
+		"f -4294967297 2 3\n");
+
+	ASSERT_EQ(6u, obj.Indices.size());
+	const Vertex& first = obj.Verts[obj.Indices[0]];
+	EXPECT_EQ(0.0f, first.Position.x);
+	EXPECT_EQ(0.0f, first.Position.y);
+	const Vertex& second = obj.Verts[obj.Indices[3]];
+	EXPECT_EQ(0.0f, second.Position.x);
+}
+
+// --------------------------------------------------------
+// All four corner forms, with Z, the normal's Z and V flipped
+// --------------------------------------------------------
+TEST(ObjLoaderTests, ReadsAllIndexForms)
+{
+	const char* header =
+		"v 1 2 3\nv 4 5 6\nv 7 8 9\n"
+		"vt 0.25 0.75\nvt 0.5 0.5\nvt 1 0\n"
+		"vn 0 0 1\n";
+	const char* faces[] =
+	{
+		"f 1 2 3\n",
+		"f 1/1 2/2 3/3\n",
+		"f 1//1 2//1 3//1\n",
+		"f 1/1/1 2/2/1 3/3/1\n",
+		"f -3/-3/-1 -2/-2/-1 -1/-1/-1\n"
+	};
+
+	for (size_t i = 0; i < sizeof(faces) / sizeof(faces[0]); i++)
+	{
+		SCOPED_TRACE(faces[i]);
+		ParsedObj obj = Parse(std::string(header) + faces[i]);
+		ASSERT_EQ(3u, obj.Verts.size());
+		ASSERT_EQ(3u, obj.Indices.size());
+
+		// Winding is flipped to 1, 3, 2
+		const Vertex& v = obj.Verts[obj.Indices[0]];
+		EXPECT_EQ(1.0f, v.Position.x);
+		EXPECT_EQ(-3.0f, v.Position.z);
+		EXPECT_EQ(7.0f, obj.Verts[obj.Indices[1]].Position.x);
+		EXPECT_EQ(4.0f, obj.Verts[obj.Indices[2]].Position.x);
+
+		// Three slashes for v/vt, six for v//vn and v/vt/vn
+		int slashes = 0;
+		for (const char* c = faces[i]; *c; c++)
+			slashes += *c == '/';
+		bool hasUV = slashes > 0 && !strstr(faces[i], "//");
+		bool hasNormal = slashes == 6;
+		EXPECT_EQ(hasUV ? 0.25f : 0.0f, v.UV.x);
+		EXPECT_EQ(hasUV ? 0.25f : 1.0f, v.UV.y);
+		EXPECT_EQ(hasNormal ? -1.0f : 0.0f, v.Normal.z);
+	}
+}
+
+// --------------------------------------------------------
+// N-gons are fan triangulated and shared corners are welded
+// --------------------------------------------------------
+TEST(ObjLoaderTests, TriangulatesAndWelds)
+{
+	ParsedObj obj = Parse(
+		"v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nv -1 0.5 0\n"
+		"vn 0 0 1\nvn 0 0 1\n"
+		"f 1//1 2//1 3//1 4//1 5//2\n"
+		"# a comment with f and v in it\n"
+		"\t f 1//2 3//1 4//2\r\n");
+
+	ASSERT_EQ(12u, obj.Indices.size());
+	EXPECT_EQ(5u, obj.Verts.size());
+
+	unsigned int expected[] = { 0, 2, 1, 0, 3, 2, 0, 4, 3, 0, 3, 2 };
+	for (size_t i = 0; i < obj.Indices.size(); i++)
+		EXPECT_EQ(expected[i], obj.Indices[i]);
+}
+
+// --------------------------------------------------------
+// Lines longer than the old 100 character limit still parse
+// --------------------------------------------------------
+TEST(ObjLoaderTests, ReadsLongLines)
+{
+	std::string text = "v 1.000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000001 2 3\n";
+	text += "f 1 1 1";
+	for (int i = 0; i < 100; i++)
+		text += " 1";
+	text += "\n";
+
+	ParsedObj obj = Parse(text);
+	ASSERT_EQ(1u, obj.Verts.size());
+	EXPECT_EQ(1.0f, obj.Verts[0].Position.x);
+	EXPECT_EQ(2.0f, obj.Verts[0].Position.y);
+	EXPECT_EQ(-3.0f, obj.Verts[0].Position.z);
+	EXPECT_EQ(101u * 3, obj.Indices.size());
+}
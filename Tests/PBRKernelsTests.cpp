@@ -0,0 +1,443 @@
+#include "PBRKernels.h"
+#include "LightSystem.h"
+#include <gtest/gtest.h>
+#include <DirectXMath.h>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// The shaders' value of PI, which the kernels copy
+	const double ShaderPi = 3.14159235359;
+
+	// Written past the end of every output, and checked after
+	const float Sentinel = -12345.0f;
+
+	// Lengths around the 8 and 16 lane widths, so every path
+	// runs full vectors, partial tails and tails alone
+	const size_t Lengths[] = { 1, 3, 7, 8, 9, 15, 16, 17, 23, 31, 33, 100, 1021 };
+
+	// --------------------------------------------------------
+	// The HLSL functions again, in doubles
+	// --------------------------------------------------------
+	double Dot(const double a[3], const double b[3])
+	{
+		return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+	}
+
+	void Normalize(double v[3])
+	{
+		double length = sqrt(Dot(v, v));
+		v[0] /= length; v[1] /= length; v[2] /= length;
+	}
+
+	double DistributionGGX(double NdotH, double roughness)
+	{
+		double a2 = roughness * roughness * roughness * roughness;
+		double denom = NdotH * NdotH * (a2 - 1.0) + 1.0;
+		return a2 / (ShaderPi * denom * denom);
+	}
+
+	double GeometrySchlickGGX(double NdotV, double roughness)
+	{
+		double k = (roughness + 1.0) * (roughness + 1.0) / 8.0;
+		return NdotV / (NdotV * (1.0 - k) + k);
+	}
+
+	double FresnelSchlick(double cosTheta, double f0)
+	{
+		return f0 + (1.0 - f0) * pow(1.0 - cosTheta, 5.0);
+	}
+
+	double FresnelSchlickRoughness(double cosTheta, double f0, double roughness)
+	{
+		return f0 + (std::max(1.0 - roughness, f0) - f0) * pow(1.0 - cosTheta, 5.0);
+	}
+
+	// --------------------------------------------------------
+	// Random surfaces seen from random directions, as arrays
+	// of floats with a sentinel past the end of each
+	// --------------------------------------------------------
+	struct Samples
+	{
+		size_t Count;
+		std::vector<float> Position[3], View[3], Normal[3], Half[3], Light[3];
+		std::vector<float> Albedo[3], F0[3];
+		std::vector<float> Metallic, Roughness, Cosine;
+
+		Samples(size_t count, unsigned int seed) : Count(count)
+		{
+			std::mt19937 random(seed);
+			std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+			std::uniform_real_distribution<float> signedUnit(-1.0f, 1.0f);
+
+			std::vector<float>* directions[] = { View, Normal, Half, Light };
+			for (size_t i = 0; i < count + 16; i++)
+			{
+				for (int d = 0; d < 4; d++)
+				{
+					float v[3] = { signedUnit(random), signedUnit(random), signedUnit(random) + 1.5f };
+					float length = sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+					for (int c = 0; c < 3; c++)
+						directions[d][c].push_back(v[c] / length);
+				}
+				for (int c = 0; c < 3; c++)
+				{
+					Position[c].push_back(signedUnit(random) * 3.0f);
+					Albedo[c].push_back(unit(random));
+					F0[c].push_back(0.04f + unit(random) * 0.96f);
+				}
+				Metallic.push_back(unit(random));
+				Roughness.push_back(0.2f + unit(random) * 0.8f);
+				Cosine.push_back(unit(random));
+			}
+		}
+
+		static KernelFloat3 In(const std::vector<float> v[3])
+		{
+			KernelFloat3 k = { &v[0][0], &v[1][0], &v[2][0] };
+			return k;
+		}
+
+		void Get(const std::vector<float> v[3], size_t i, double out[3]) const
+		{
+			for (int c = 0; c < 3; c++)
+				out[c] = v[c][i];
+		}
+	};
+
+	// Outputs with room for the sentinels
+	struct Output
+	{
+		std::vector<float> Values[3];
+
+		Output(size_t count, float initial = 0.0f)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				Values[c].assign(count, initial);
+				Values[c].resize(count + 16, Sentinel);
+			}
+		}
+
+		KernelFloat3Out Out()
+		{
+			KernelFloat3Out k = { &Values[0][0], &Values[1][0], &Values[2][0] };
+			return k;
+		}
+
+		void ExpectSentinels(size_t count) const
+		{
+			for (int c = 0; c < 3; c++)
+				for (size_t i = count; i < Values[c].size(); i++)
+					EXPECT_EQ(Sentinel, Values[c][i]) << "written past " << count << " at " << i;
+		}
+	};
+
+	// Within a relative tolerance, or an absolute one near zero
+	void ExpectClose(double expected, float actual, double tolerance, size_t i)
+	{
+		EXPECT_NEAR(expected, actual, tolerance * std::max(1.0, fabs(expected))) << "sample " << i;
+	}
+
+	// Runs the test body once per kernel path this CPU supports
+	template<typename Check>
+	void ForEachPath(Check check)
+	{
+		KernelPath original = PBRKernels::GetPath();
+		KernelPath paths[] = { KernelPath::Scalar, KernelPath::AVX2, KernelPath::AVX512 };
+		for (int p = 0; p < 3; p++)
+		{
+			if (!PBRKernels::SetPath(paths[p]))
+				continue;
+			for (size_t l = 0; l < sizeof(Lengths) / sizeof(Lengths[0]); l++)
+			{
+				SCOPED_TRACE(testing::Message() << PBRKernels::GetPathName(paths[p]) << ", " << Lengths[l] << " samples");
+				check(Lengths[l]);
+			}
+		}
+		PBRKernels::SetPath(original);
+	}
+
+	// --------------------------------------------------------
+	// Point and spot lights of different colors and ranges,
+	// set up the way the game sets them up.  Some samples are
+	// out of range or outside a cone, and some are partway.
+	// --------------------------------------------------------
+	void MakeLights(LightSystem& lights)
+	{
+		Light light = {};
+		light.Type = LightType::Point;
+		light.Position = XMFLOAT3(10, 10, -10);
+		light.Color = XMFLOAT3(300, 300, 300);
+		light.Range = 1000.0f;
+		lights.Add(light);
+
+		light.Position = XMFLOAT3(4, -4, -4);
+		light.Color = XMFLOAT3(300, 100, 50);
+		light.Range = 9.0f;
+		lights.Add(light);
+
+		light.Type = LightType::Spot;
+		light.Position = XMFLOAT3(0, 0, -4);
+		light.Direction = XMFLOAT3(0, 0, 1);
+		light.Color = XMFLOAT3(20, 40, 300);
+		light.Range = 10.0f;
+		light.InnerAngle = 0.2f;
+		light.OuterAngle = 0.5f;
+		lights.Add(light);
+
+		light.Position = XMFLOAT3(-3, 2, -3);
+		light.Direction = XMFLOAT3(1, -0.5f, 1);
+		light.Color = XMFLOAT3(50, 50, 50);
+		light.Range = 8.0f;
+		light.InnerAngle = 0.4f;
+		light.OuterAngle = 0.45f;
+		lights.Add(light);
+	}
+
+	// --------------------------------------------------------
+	// CalculateRadiance from the material shader in doubles,
+	// for sample i
+	// --------------------------------------------------------
+	void ReferenceRadiance(const Samples& s, size_t i, const ShaderLight& light, double radiance[3])
+	{
+		double p[3], v[3], n[3];
+		s.Get(s.Position, i, p);
+		s.Get(s.View, i, v);
+		s.Get(s.Normal, i, n);
+
+		double l[3] = { light.Position.x - p[0], light.Position.y - p[1], light.Position.z - p[2] };
+		double distance = sqrt(Dot(l, l));
+		Normalize(l);
+		double h[3] = { v[0] + l[0], v[1] + l[1], v[2] + l[2] };
+		Normalize(h);
+
+		double attenuation = 1.0 / (distance * distance);
+		double ratio = distance / light.Range;
+		double window = std::min(std::max(1.0 - ratio * ratio * ratio * ratio, 0.0), 1.0);
+		double direction[3] = { light.Direction.x, light.Direction.y, light.Direction.z };
+		double spot = std::min(std::max(-Dot(l, direction) * light.SpotScale + light.SpotOffset, 0.0), 1.0);
+		attenuation *= window * window * spot * spot;
+
+		double NdotV = std::max(Dot(n, v), 0.0);
+		double NdotL = std::max(Dot(n, l), 0.0);
+		double NDF = DistributionGGX(std::max(Dot(n, h), 0.0), s.Roughness[i]);
+		double G = GeometrySchlickGGX(NdotV, s.Roughness[i]) * GeometrySchlickGGX(NdotL, s.Roughness[i]);
+		double denominator = std::max(4.0 * NdotV * NdotL, 0.001);
+
+		const float* color = &light.Color.x;
+		for (int c = 0; c < 3; c++)
+		{
+			double F = FresnelSchlick(std::max(Dot(h, v), 0.0), s.F0[c][i]);
+			double kD = (1.0 - F) * (1.0 - s.Metallic[i]);
+			radiance[c] = (kD * s.Albedo[c][i] / ShaderPi + NDF * G * F / denominator) * color[c] * attenuation * NdotL;
+		}
+	}
+}
+
+TEST(PBRKernelsTests, PicksASupportedPath)
+{
+	KernelPath best = PBRKernels::GetBestPath();
+	EXPECT_TRUE(PBRKernels::SetPath(KernelPath::Scalar));
+	EXPECT_EQ(KernelPath::Scalar, PBRKernels::GetPath());
+	EXPECT_TRUE(PBRKernels::SetPath(best));
+	EXPECT_EQ(best, PBRKernels::GetPath());
+	if (best != KernelPath::AVX512)
+		EXPECT_FALSE(PBRKernels::SetPath(KernelPath::AVX512));
+}
+
+// --------------------------------------------------------
+// NDF precision is limited by NdotH squared cancelling
+// against one, which costs more the smoother the surface -
+// roughness starts at 0.2 to keep that under 1e-4
+// --------------------------------------------------------
+TEST(PBRKernelsTests, DistributionGGXMatchesReference)
+{
+	ForEachPath([](size_t count) {
+		Samples s(count, 1);
+		Output ndf(count);
+		PBRKernels::DistributionGGX(count, Samples::In(s.Normal), Samples::In(s.Half), &s.Roughness[0], &ndf.Values[0][0]);
+
+		for (size_t i = 0; i < count; i++)
+		{
+			double n[3], h[3];
+			s.Get(s.Normal, i, n);
+			s.Get(s.Half, i, h);
+			ExpectClose(DistributionGGX(std::max(Dot(n, h), 0.0), s.Roughness[i]), ndf.Values[0][i], 1e-4, i);
+		}
+		ndf.ExpectSentinels(count);
+	});
+}
+
+TEST(PBRKernelsTests, GeometryMatchesReference)
+{
+	ForEachPath([](size_t count) {
+		Samples s(count, 2);
+		Output schlick(count), smith(count);
+		PBRKernels::GeometrySchlickGGX(count, &s.Cosine[0], &s.Roughness[0], &schlick.Values[0][0]);
+		PBRKernels::GeometrySmith(count, Samples::In(s.Normal), Samples::In(s.View), Samples::In(s.Light), &s.Roughness[0], &smith.Values[0][0]);
+
+		for (size_t i = 0; i < count; i++)
+		{
+			ExpectClose(GeometrySchlickGGX(s.Cosine[i], s.Roughness[i]), schlick.Values[0][i], 1e-5, i);
+
+			double n[3], v[3], l[3];
+			s.Get(s.Normal, i, n);
+			s.Get(s.View, i, v);
+			s.Get(s.Light, i, l);
+			double expected = GeometrySchlickGGX(std::max(Dot(n, v), 0.0), s.Roughness[i]) *
+				GeometrySchlickGGX(std::max(Dot(n, l), 0.0), s.Roughness[i]);
+			ExpectClose(expected, smith.Values[0][i], 1e-5, i);
+		}
+		schlick.ExpectSentinels(count);
+		smith.ExpectSentinels(count);
+	});
+}
+
+TEST(PBRKernelsTests, FresnelMatchesReference)
+{
+	ForEachPath([](size_t count) {
+		Samples s(count, 3);
+		Output fresnel(count), rough(count);
+		PBRKernels::FresnelSchlick(count, &s.Cosine[0], Samples::In(s.F0), fresnel.Out());
+		PBRKernels::FresnelSchlickRoughness(count, &s.Cosine[0], Samples::In(s.F0), &s.Roughness[0], rough.Out());
+
+		for (size_t i = 0; i < count; i++)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				ExpectClose(FresnelSchlick(s.Cosine[i], s.F0[c][i]), fresnel.Values[c][i], 1e-5, i);
+				ExpectClose(FresnelSchlickRoughness(s.Cosine[i], s.F0[c][i], s.Roughness[i]), rough.Values[c][i], 1e-5, i);
+			}
+		}
+		fresnel.ExpectSentinels(count);
+		rough.ExpectSentinels(count);
+	});
+}
+
+// --------------------------------------------------------
+// Every light added on top of what the output already
+// held, and each light on its own through CalculateRadiance,
+// which overwrites instead
+// --------------------------------------------------------
+TEST(PBRKernelsTests, RadianceMatchesReference)
+{
+	LightSystem lights;
+	MakeLights(lights);
+	const std::vector<ShaderLight>& shaderLights = lights.GetShaderLights();
+
+	ForEachPath([&](size_t count) {
+		Samples s(count, 4);
+		Output accumulated(count, 0.25f);
+		PBRKernels::AccumulateRadiance(count, Samples::In(s.Position), Samples::In(s.View), Samples::In(s.Normal), Samples::In(s.Albedo),
+			&s.Metallic[0], &s.Roughness[0], Samples::In(s.F0), &shaderLights[0], (int)shaderLights.size(), accumulated.Out());
+
+		std::vector<double> total(count * 3, 0.25);
+		for (size_t light = 0; light < shaderLights.size(); light++)
+		{
+			Output single(count, 7.0f);
+			PBRKernels::CalculateRadiance(count, Samples::In(s.Position), Samples::In(s.View), Samples::In(s.Normal), Samples::In(s.Albedo),
+				&s.Metallic[0], &s.Roughness[0], Samples::In(s.F0), shaderLights[light], single.Out());
+
+			for (size_t i = 0; i < count; i++)
+			{
+				double radiance[3];
+				ReferenceRadiance(s, i, shaderLights[light], radiance);
+				for (int c = 0; c < 3; c++)
+				{
+					ExpectClose(radiance[c], single.Values[c][i], 1e-4, i);
+					total[i * 3 + c] += radiance[c];
+				}
+			}
+			single.ExpectSentinels(count);
+		}
+
+		for (size_t i = 0; i < count; i++)
+			for (int c = 0; c < 3; c++)
+				ExpectClose(total[i * 3 + c], accumulated.Values[c][i], 1e-4, i);
+		accumulated.ExpectSentinels(count);
+	});
+}
+
+// --------------------------------------------------------
+// Nothing reaches past a light's range or outside a spot
+// light's outer cone, and inside the inner cone a spot
+// light is the same as a point light
+// --------------------------------------------------------
+TEST(PBRKernelsTests, FadesAtRangeAndCone)
+{
+	Light spot = {};
+	spot.Type = LightType::Spot;
+	spot.Position = XMFLOAT3(0, 0, -5);
+	spot.Direction = XMFLOAT3(0, 0, 1);
+	spot.Color = XMFLOAT3(100, 100, 100);
+	spot.Range = 8.0f;
+	spot.InnerAngle = 0.3f;
+	spot.OuterAngle = 0.6f;
+	Light point = spot;
+	point.Type = LightType::Point;
+
+	LightSystem lights;
+	lights.Add(spot);
+	lights.Add(point);
+	const std::vector<ShaderLight>& shaderLights = lights.GetShaderLights();
+
+	// On the axis, past the range, outside the cone, and
+	// between the cones - all facing the light
+	float positions[4][3] = { { 0, 0, 0 }, { 0, 0, 3.5f }, { 4, 0, 0 }, { 2, 0, 0 } };
+	Samples s(4, 6);
+	for (int i = 0; i < 4; i++)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			s.Position[c][i] = positions[i][c];
+			s.Normal[c][i] = c == 2 ? -1.0f : 0.0f;
+			s.View[c][i] = c == 2 ? -1.0f : 0.0f;
+		}
+	}
+
+	ForEachPath([&](size_t) {
+		Output fromSpot(4), fromPoint(4);
+		PBRKernels::CalculateRadiance(4, Samples::In(s.Position), Samples::In(s.View), Samples::In(s.Normal), Samples::In(s.Albedo),
+			&s.Metallic[0], &s.Roughness[0], Samples::In(s.F0), shaderLights[0], fromSpot.Out());
+		PBRKernels::CalculateRadiance(4, Samples::In(s.Position), Samples::In(s.View), Samples::In(s.Normal), Samples::In(s.Albedo),
+			&s.Metallic[0], &s.Roughness[0], Samples::In(s.F0), shaderLights[1], fromPoint.Out());
+
+		for (int c = 0; c < 3; c++)
+		{
+			EXPECT_GT(fromSpot.Values[c][0], 0.0f);
+			EXPECT_EQ(fromPoint.Values[c][0], fromSpot.Values[c][0]);
+			EXPECT_EQ(0.0f, fromSpot.Values[c][1]);
+			EXPECT_EQ(0.0f, fromPoint.Values[c][1]);
+			EXPECT_EQ(0.0f, fromSpot.Values[c][2]);
+			EXPECT_GT(fromPoint.Values[c][2], 0.0f);
+			EXPECT_GT(fromSpot.Values[c][3], 0.0f);
+			EXPECT_LT(fromSpot.Values[c][3], fromPoint.Values[c][3]);
+		}
+	});
+}
+
+// --------------------------------------------------------
+// Nothing to do is fine: no samples, or no lights, which
+// leaves the output as it was
+// --------------------------------------------------------
+TEST(PBRKernelsTests, HandlesEmptyInput)
+{
+	LightSystem lights;
+	MakeLights(lights);
+	Samples s(1, 5);
+	Output radiance(1, 3.0f);
+	ForEachPath([&](size_t) {
+		PBRKernels::AccumulateRadiance(0, Samples::In(s.Position), Samples::In(s.View), Samples::In(s.Normal), Samples::In(s.Albedo),
+			&s.Metallic[0], &s.Roughness[0], Samples::In(s.F0), &lights.GetShaderLights()[0], 1, radiance.Out());
+		PBRKernels::AccumulateRadiance(1, Samples::In(s.Position), Samples::In(s.View), Samples::In(s.Normal), Samples::In(s.Albedo),
+			&s.Metallic[0], &s.Roughness[0], Samples::In(s.F0), &lights.GetShaderLights()[0], 0, radiance.Out());
+		EXPECT_EQ(3.0f, radiance.Values[0][0]);
+		radiance.ExpectSentinels(1);
+	});
+}
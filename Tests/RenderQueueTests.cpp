@@ -0,0 +1,467 @@
+#include "RenderQueue.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// Stand-ins for the objects a draw points at - the queue
+	// only ever compares the pointers
+	char shaderObjects[300];
+	char materialObjects[300];
+	char meshObjects[300];
+
+	SimpleVertexShader* VertexShaderAt(int i) { return (SimpleVertexShader*)&shaderObjects[i]; }
+	SimplePixelShader* PixelShaderAt(int i) { return (SimplePixelShader*)&shaderObjects[i]; }
+	Material* MaterialAt(int i) { return (Material*)&materialObjects[i]; }
+	Mesh* MeshAt(int i) { return (Mesh*)&meshObjects[i]; }
+
+	// One instanced draw the backend was given
+	struct InstancedRun
+	{
+		SimpleVertexShader* VertexShader;
+		Material* DrawMaterial;
+		Mesh* DrawMesh;
+		size_t First;	// Position of its first instance in Order
+		unsigned int Count;
+	};
+
+	// --------------------------------------------------------
+	// Logs the order draws arrive in (each draw's number is in
+	// its world matrix) and checks every draw goes out with its
+	// own state bound.  With instancing on, it takes runs for
+	// every vertex shader but refuseShader, and is only offered
+	// runs it says it can take.
+	// --------------------------------------------------------
+	class CheckingBackend : public RecordingRenderBackend
+	{
+	public:
+		std::vector<int> Order;
+		std::vector<InstancedRun> Runs;
+
+		CheckingBackend(bool instancing = false, SimpleVertexShader* refuseShader = 0)
+			: instancing(instancing), refuseShader(refuseShader), vertexShader(0), pixelShader(0), material(0), mesh(0) {}
+
+		void BindShaders(SimpleVertexShader* vertexShader, SimplePixelShader* pixelShader)
+		{
+			RecordingRenderBackend::BindShaders(vertexShader, pixelShader);
+			this->vertexShader = vertexShader;
+			this->pixelShader = pixelShader;
+			material = 0;
+		}
+
+		void BindMaterial(Material* material)
+		{
+			RecordingRenderBackend::BindMaterial(material);
+			EXPECT_TRUE(vertexShader != 0) << "material bound before any shader";
+			this->material = material;
+		}
+
+		void BindMesh(Mesh* mesh)
+		{
+			RecordingRenderBackend::BindMesh(mesh);
+			this->mesh = mesh;
+		}
+
+		void Draw(const DrawCall& draw)
+		{
+			RecordingRenderBackend::Draw(draw);
+			EXPECT_EQ(draw.VertexShader, vertexShader);
+			EXPECT_EQ(draw.PixelShader, pixelShader);
+			EXPECT_EQ(draw.DrawMaterial, material);
+			EXPECT_EQ(draw.DrawMesh, mesh);
+			Order.push_back((int)draw.World._11);
+		}
+
+		bool CanInstance()
+		{
+			return instancing && vertexShader != refuseShader;
+		}
+
+		bool DrawInstanced(const InstanceData* instances, unsigned int count)
+		{
+			EXPECT_TRUE(CanInstance()) << "instances packed for shaders that can't take them";
+			if (!CanInstance())
+				return false;
+
+			Draws++;
+			Instances += count;
+			InstancedRun run = { vertexShader, material, mesh, Order.size(), count };
+			Runs.push_back(run);
+			for (unsigned int i = 0; i < count; i++)
+				Order.push_back((int)instances[i].World._11);
+			return true;
+		}
+
+	private:
+		bool instancing;
+		SimpleVertexShader* refuseShader;
+		SimpleVertexShader* vertexShader;
+		SimplePixelShader* pixelShader;
+		Material* material;
+		Mesh* mesh;
+	};
+
+	// A submitted draw as the reference sees it - state as
+	// first-seen ids, the order the queue gives them out
+	struct Submitted
+	{
+		int VertexShader;
+		int PixelShader;
+		int Material;
+		int Mesh;
+		int Depth;		// In thousandths, so no two land in one key step
+		int Number;
+
+		bool operator<(const Submitted& other) const
+		{
+			if (VertexShader != other.VertexShader) return VertexShader < other.VertexShader;
+			if (PixelShader != other.PixelShader) return PixelShader < other.PixelShader;
+			if (Material != other.Material) return Material < other.Material;
+			if (Mesh != other.Mesh) return Mesh < other.Mesh;
+			return Depth < other.Depth;
+		}
+	};
+
+	unsigned int Next(unsigned int& seed)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		return seed >> 8;
+	}
+
+	// Picks one of the objects used so far or the next unused
+	// one, so objects are first used in index order
+	int Pick(unsigned int& seed, int& used, int limit)
+	{
+		int id = (int)(Next(seed) % (unsigned int)std::min(used + 1, limit));
+		if (id == used)
+			used++;
+		return id;
+	}
+
+	// --------------------------------------------------------
+	// Submits count draws spread over the given numbers of
+	// shaders, materials and meshes.  The queue numbers objects
+	// by first use, so its ids match the indices used here.
+	// --------------------------------------------------------
+	void SubmitRandom(RenderQueue& queue, std::vector<Submitted>& submitted, int count,
+		int shaders, int materials, int meshes, unsigned int seed)
+	{
+		int used[3] = { 0, 0, 0 };
+		for (int i = 0; i < count; i++)
+		{
+			Submitted s;
+			s.VertexShader = Pick(seed, used[0], shaders);
+			s.PixelShader = s.VertexShader;
+			s.Material = Pick(seed, used[1], materials);
+			s.Mesh = Pick(seed, used[2], meshes);
+			s.Depth = Next(seed) % 1001;
+			s.Number = (int)submitted.size();
+			submitted.push_back(s);
+
+			DrawCall draw = {};
+			draw.VertexShader = VertexShaderAt(s.VertexShader);
+			draw.PixelShader = PixelShaderAt(s.PixelShader);
+			draw.DrawMaterial = MaterialAt(s.Material);
+			draw.DrawMesh = MeshAt(s.Mesh);
+			draw.World._11 = (float)s.Number;
+			queue.Submit(draw, s.Depth / 1000.0f);
+		}
+	}
+
+	// Bind counts for replaying draws in the given order
+	void CountBinds(const std::vector<Submitted>& order, unsigned int& shaderBinds, unsigned int& materialBinds, unsigned int& meshBinds)
+	{
+		shaderBinds = materialBinds = meshBinds = 0;
+		for (size_t i = 0; i < order.size(); i++)
+		{
+			bool newShader = i == 0 || order[i].VertexShader != order[i - 1].VertexShader || order[i].PixelShader != order[i - 1].PixelShader;
+			shaderBinds += newShader;
+			materialBinds += newShader || order[i].Material != order[i - 1].Material;
+			meshBinds += i == 0 || order[i].Mesh != order[i - 1].Mesh;
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Draws come out grouped by shader, material and mesh, front
+// to back within a group, and in submission order on ties -
+// the same as a stable sort on those fields
+// --------------------------------------------------------
+TEST(RenderQueueTests, SortsLikeStableSortOnState)
+{
+	int counts[] = { 1, 2, 7, 255, 256, 257, 5000 };
+	for (int c = 0; c < 7; c++)
+	{
+		SCOPED_TRACE(counts[c]);
+		RenderQueue queue;
+		std::vector<Submitted> submitted;
+		SubmitRandom(queue, submitted, counts[c], 5, 12, 9, 1234 + c);
+		EXPECT_EQ((size_t)counts[c], queue.GetCount());
+
+		std::vector<Submitted> expected = submitted;
+		std::stable_sort(expected.begin(), expected.end());
+
+		queue.Sort();
+		CheckingBackend backend;
+		queue.Execute(&backend);
+
+		ASSERT_EQ(expected.size(), backend.Order.size());
+		for (size_t i = 0; i < expected.size(); i++)
+			EXPECT_EQ(expected[i].Number, backend.Order[i]) << "position " << i;
+	}
+}
+
+// --------------------------------------------------------
+// Keys that only differ in depth take an odd number of radix
+// passes, which leaves the result in the scratch array
+// --------------------------------------------------------
+TEST(RenderQueueTests, SortsDepthOnlyKeys)
+{
+	RenderQueue queue;
+	std::vector<Submitted> submitted;
+	SubmitRandom(queue, submitted, 3000, 1, 1, 1, 42);
+
+	std::vector<Submitted> expected = submitted;
+	std::stable_sort(expected.begin(), expected.end());
+
+	queue.Sort();
+	CheckingBackend backend;
+	queue.Execute(&backend);
+
+	ASSERT_EQ(expected.size(), backend.Order.size());
+	for (size_t i = 0; i < expected.size(); i++)
+		EXPECT_EQ(expected[i].Number, backend.Order[i]) << "position " << i;
+	EXPECT_EQ(1u, backend.ShaderBinds);
+	EXPECT_EQ(1u, backend.MaterialBinds);
+	EXPECT_EQ(1u, backend.MeshBinds);
+}
+
+// --------------------------------------------------------
+// Only state that differs from the previous draw is bound,
+// and sorting binds no more than the submission order would
+// --------------------------------------------------------
+TEST(RenderQueueTests, SkipsRedundantState)
+{
+	RenderQueue queue;
+	std::vector<Submitted> submitted;
+	SubmitRandom(queue, submitted, 2000, 3, 6, 4, 7);
+
+	std::vector<Submitted> expected = submitted;
+	std::stable_sort(expected.begin(), expected.end());
+	unsigned int shaderBinds, materialBinds, meshBinds;
+	CountBinds(expected, shaderBinds, materialBinds, meshBinds);
+
+	// Unsorted, the same draws would rebind nearly every time
+	unsigned int unsortedShaders, unsortedMaterials, unsortedMeshes;
+	CountBinds(submitted, unsortedShaders, unsortedMaterials, unsortedMeshes);
+
+	CheckingBackend backend;
+	queue.Execute(&backend);
+	EXPECT_EQ(unsortedShaders, backend.ShaderBinds);
+	EXPECT_EQ(unsortedMaterials, backend.MaterialBinds);
+	EXPECT_EQ(unsortedMeshes, backend.MeshBinds);
+
+	queue.Sort();
+	backend.Reset();
+	queue.Execute(&backend);
+	EXPECT_EQ(shaderBinds, backend.ShaderBinds);
+	EXPECT_EQ(materialBinds, backend.MaterialBinds);
+	EXPECT_EQ(meshBinds, backend.MeshBinds);
+	EXPECT_EQ(2000u, backend.Draws);
+
+	EXPECT_EQ(3u, backend.ShaderBinds);
+	EXPECT_LE(backend.MaterialBinds, 3u * 6u);
+	EXPECT_LT(backend.ShaderBinds + backend.MaterialBinds + backend.MeshBinds,
+		unsortedShaders + unsortedMaterials + unsortedMeshes);
+}
+
+// --------------------------------------------------------
+// The sphere scene: one shader, material and mesh for every
+// draw binds each of them once
+// --------------------------------------------------------
+TEST(RenderQueueTests, BindsSharedStateOnce)
+{
+	RenderQueue queue;
+	for (int i = 0; i < 64; i++)
+	{
+		DrawCall draw = {};
+		draw.VertexShader = VertexShaderAt(0);
+		draw.PixelShader = PixelShaderAt(1);
+		draw.DrawMaterial = MaterialAt(0);
+		draw.DrawMesh = MeshAt(0);
+		draw.World._11 = (float)i;
+		queue.Submit(draw, (63 - i) / 64.0f);
+	}
+	queue.Sort();
+
+	CheckingBackend backend;
+	queue.Execute(&backend);
+	EXPECT_EQ(1u, backend.ShaderBinds);
+	EXPECT_EQ(1u, backend.MaterialBinds);
+	EXPECT_EQ(1u, backend.MeshBinds);
+	ASSERT_EQ(64u, backend.Order.size());
+	for (int i = 0; i < 64; i++)
+		EXPECT_EQ(63 - i, backend.Order[i]);
+}
+
+// --------------------------------------------------------
+// More objects than a key field holds wrap their ids, which
+// may cost extra binds but never a draw with the wrong state
+// --------------------------------------------------------
+TEST(RenderQueueTests, BindsCorrectStateWhenIdsWrap)
+{
+	RenderQueue queue;
+	std::vector<Submitted> submitted;
+	SubmitRandom(queue, submitted, 20000, 300, 300, 300, 99);
+	queue.Sort();
+
+	CheckingBackend backend;
+	queue.Execute(&backend);
+	std::vector<int> order = backend.Order;
+	std::sort(order.begin(), order.end());
+	ASSERT_EQ(20000u, order.size());
+	for (int i = 0; i < 20000; i++)
+		EXPECT_EQ(i, order[i]);
+}
+
+TEST(RenderQueueTests, ClearStartsAFreshFrame)
+{
+	RenderQueue queue;
+	std::vector<Submitted> submitted;
+	SubmitRandom(queue, submitted, 100, 2, 2, 2, 5);
+	queue.Clear();
+	EXPECT_EQ(0u, queue.GetCount());
+
+	CheckingBackend backend;
+	queue.Sort();
+	queue.Execute(&backend);
+	EXPECT_EQ(0u, backend.Draws);
+	EXPECT_EQ(0u, backend.ShaderBinds);
+}
+
+// --------------------------------------------------------
+// Each run of identical shaders, material and mesh in the
+// sorted order becomes one instanced draw, with its world
+// matrices packed front to back
+// --------------------------------------------------------
+TEST(RenderQueueTests, InstancesRunsOfIdenticalState)
+{
+	RenderQueue queue;
+	std::vector<Submitted> submitted;
+	SubmitRandom(queue, submitted, 5000, 4, 5, 6, 321);
+	queue.Sort();
+
+	std::vector<Submitted> expected = submitted;
+	std::stable_sort(expected.begin(), expected.end());
+
+	CheckingBackend backend(true);
+	queue.Execute(&backend);
+
+	ASSERT_EQ(expected.size(), backend.Order.size());
+	for (size_t i = 0; i < expected.size(); i++)
+		EXPECT_EQ(expected[i].Number, backend.Order[i]) << "position " << i;
+
+	// Runs tile the sorted order and split exactly where state changes
+	size_t position = 0;
+	for (size_t r = 0; r < backend.Runs.size(); r++)
+	{
+		const InstancedRun& run = backend.Runs[r];
+		ASSERT_EQ(position, run.First);
+		ASSERT_GT(run.Count, 0u);
+		for (size_t i = run.First; i < run.First + run.Count; i++)
+		{
+			EXPECT_EQ(VertexShaderAt(expected[i].VertexShader), run.VertexShader);
+			EXPECT_EQ(MaterialAt(expected[i].Material), run.DrawMaterial);
+			EXPECT_EQ(MeshAt(expected[i].Mesh), run.DrawMesh);
+		}
+
+		size_t end = run.First + run.Count;
+		if (end < expected.size())
+		{
+			bool sameState = expected[end].VertexShader == expected[end - 1].VertexShader &&
+				expected[end].Material == expected[end - 1].Material &&
+				expected[end].Mesh == expected[end - 1].Mesh;
+			EXPECT_FALSE(sameState) << "run " << r << " split without a state change";
+		}
+		position = end;
+	}
+	EXPECT_EQ(expected.size(), position);
+	EXPECT_EQ(backend.Runs.size(), backend.Draws);
+	EXPECT_EQ(5000u, backend.Instances);
+	EXPECT_LE(backend.Draws, 4u * 5u * 6u);
+}
+
+// --------------------------------------------------------
+// The sphere scene goes out as one draw, and a second mesh
+// or material splits off a draw of its own
+// --------------------------------------------------------
+TEST(RenderQueueTests, SplitsInstancesOnMeshAndMaterial)
+{
+	RenderQueue queue;
+	for (int i = 0; i < 64; i++)
+	{
+		DrawCall draw = {};
+		draw.VertexShader = VertexShaderAt(0);
+		draw.PixelShader = PixelShaderAt(0);
+		draw.DrawMaterial = MaterialAt(i == 10 ? 1 : 0);
+		draw.DrawMesh = MeshAt(i == 20 || i == 30 ? 1 : 0);
+		draw.World._11 = (float)i;
+		queue.Submit(draw, i / 64.0f);
+	}
+	queue.Sort();
+
+	CheckingBackend backend(true);
+	queue.Execute(&backend);
+
+	// Material 0 with mesh 0, then mesh 1, then material 1
+	ASSERT_EQ(3u, backend.Runs.size());
+	EXPECT_EQ(61u, backend.Runs[0].Count);
+	EXPECT_EQ(MeshAt(0), backend.Runs[0].DrawMesh);
+	EXPECT_EQ(2u, backend.Runs[1].Count);
+	EXPECT_EQ(MeshAt(1), backend.Runs[1].DrawMesh);
+	EXPECT_EQ(1u, backend.Runs[2].Count);
+	EXPECT_EQ(MaterialAt(1), backend.Runs[2].DrawMaterial);
+	EXPECT_EQ(10, backend.Order[63]);
+	EXPECT_EQ(1u, backend.ShaderBinds);
+	EXPECT_EQ(2u, backend.MaterialBinds);
+	EXPECT_EQ(3u, backend.MeshBinds);
+}
+
+// --------------------------------------------------------
+// Runs the backend won't instance are drawn one at a time
+// in the same order, without touching the other runs
+// --------------------------------------------------------
+TEST(RenderQueueTests, FallsBackToSingleDraws)
+{
+	RenderQueue queue;
+	std::vector<Submitted> submitted;
+	SubmitRandom(queue, submitted, 3000, 3, 4, 4, 555);
+	queue.Sort();
+
+	std::vector<Submitted> expected = submitted;
+	std::stable_sort(expected.begin(), expected.end());
+
+	CheckingBackend backend(true, VertexShaderAt(1));
+	queue.Execute(&backend);
+
+	ASSERT_EQ(expected.size(), backend.Order.size());
+	for (size_t i = 0; i < expected.size(); i++)
+		EXPECT_EQ(expected[i].Number, backend.Order[i]) << "position " << i;
+
+	unsigned int refused = 0;
+	for (size_t i = 0; i < expected.size(); i++)
+		refused += expected[i].VertexShader == 1;
+	ASSERT_GT(refused, 0u);
+
+	unsigned int instanced = 0;
+	for (size_t r = 0; r < backend.Runs.size(); r++)
+	{
+		EXPECT_NE(VertexShaderAt(1), backend.Runs[r].VertexShader);
+		instanced += backend.Runs[r].Count;
+	}
+	EXPECT_EQ(3000u - refused, instanced);
+	EXPECT_EQ(backend.Runs.size() + refused, backend.Draws);
+}
@@ -0,0 +1,58 @@
+#include "ShaderNameTable.h"
+#include <gtest/gtest.h>
+
+namespace
+{
+	// FNV-1a hashes these pairs to the same value
+	constexpr ShaderName Costarring("costarring");
+	constexpr ShaderName Liquid("liquid");
+	constexpr ShaderName Declinate("declinate");
+	constexpr ShaderName Macallums("macallums");
+}
+
+TEST(ShaderNameTableTests, HashesAtCompileTime)
+{
+	constexpr ShaderName world("world");
+	static_assert(world.Hash == HashShaderName("world"), "hash not worked out at compile time");
+	EXPECT_EQ(HashShaderName("world"), world.Hash);
+	EXPECT_NE(HashShaderName("world"), HashShaderName("view"));
+}
+
+TEST(ShaderNameTableTests, FindsVariablesByName)
+{
+	ShaderNameTable table;
+	table.Add("view", 0);
+	table.Add("projection", 1);
+	table.Add("world", 2);
+
+	EXPECT_EQ(0, table.Find(ShaderName("view")));
+	EXPECT_EQ(1, table.Find(std::string("projection")));
+	EXPECT_EQ(2, table.Find(ShaderName("world")));
+	EXPECT_EQ(InvalidShaderHandle, table.Find(ShaderName("cameraPos")));
+	EXPECT_EQ(InvalidShaderHandle, table.Find(std::string("")));
+
+	table.Clear();
+	EXPECT_EQ(InvalidShaderHandle, table.Find(ShaderName("view")));
+}
+
+// --------------------------------------------------------
+// Two variables whose names share a hash each resolve to
+// their own handle, and a name that only matches the hash
+// of a variable resolves to nothing
+// --------------------------------------------------------
+TEST(ShaderNameTableTests, SeparatesNamesThatShareAHash)
+{
+	ASSERT_EQ(Costarring.Hash, Liquid.Hash);
+	ASSERT_EQ(Declinate.Hash, Macallums.Hash);
+
+	ShaderNameTable table;
+	table.Add("costarring", 4);
+	table.Add("liquid", 7);
+	table.Add("declinate", 9);
+
+	EXPECT_EQ(4, table.Find(Costarring));
+	EXPECT_EQ(7, table.Find(Liquid));
+	EXPECT_EQ(7, table.Find(std::string("liquid")));
+	EXPECT_EQ(9, table.Find(Declinate));
+	EXPECT_EQ(InvalidShaderHandle, table.Find(Macallums));
+}
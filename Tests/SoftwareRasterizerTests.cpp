@@ -0,0 +1,491 @@
+#include "SoftwareRasterizer.h"
+#include "ImageWriter.h"
+#include "IrradianceBaker.h"
+#include "LightSystem.h"
+#include "PBRKernels.h"
+#include "SpecularBaker.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Golden images live in Tests/Golden.  Running the tests with
+// DX11STARTER_UPDATE_GOLDEN set rewrites them from the
+// current output instead of comparing - look over the new
+// images before committing them.
+// --------------------------------------------------------
+namespace
+{
+	const int ImageWidth = 160;
+	const int ImageHeight = 120;
+
+	// Kernel paths and compilers round differently, so a
+	// channel may be off by a couple of steps of 255, but only
+	// on a sliver of the image
+	const int PixelTolerance = 2;
+	const double MismatchedShare = 0.001;
+
+	std::string SourcePath(const char* file)
+	{
+		return std::string(DX11STARTER_SOURCE_DIR) + "/" + file;
+	}
+
+	unsigned int ReadBigEndian(const unsigned char* bytes)
+	{
+		return ((unsigned int)bytes[0] << 24) | ((unsigned int)bytes[1] << 16) | ((unsigned int)bytes[2] << 8) | bytes[3];
+	}
+
+	// --------------------------------------------------------
+	// Reads back what ImageWriter::WritePng writes - RGBA,
+	// stored deflate blocks and no row filters - which is all
+	// the golden images ever are
+	// --------------------------------------------------------
+	bool ReadPng(const std::string& file, int& width, int& height, std::vector<unsigned char>& rgba)
+	{
+		std::ifstream in(file.c_str(), std::ios::binary);
+		std::vector<unsigned char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+		if (bytes.size() < 8)
+			return false;
+
+		std::vector<unsigned char> zlib;
+		width = height = 0;
+		for (size_t at = 8; at + 12 <= bytes.size();)
+		{
+			unsigned int length = ReadBigEndian(&bytes[at]);
+			std::string type((const char*)&bytes[at + 4], 4);
+			const unsigned char* data = &bytes[at + 8];
+			if (at + 12 + length > bytes.size())
+				return false;
+
+			if (type == "IHDR")
+			{
+				width = (int)ReadBigEndian(data);
+				height = (int)ReadBigEndian(data + 4);
+				if (data[8] != 8 || data[9] != 6)
+					return false;
+			}
+			else if (type == "IDAT")
+				zlib.insert(zlib.end(), data, data + length);
+			at += 12 + length;
+		}
+
+		std::vector<unsigned char> raw;
+		size_t at = 2;
+		for (bool last = false; !last;)
+		{
+			if (at + 5 > zlib.size() || (zlib[at] & 6) != 0)
+				return false;
+			last = (zlib[at] & 1) != 0;
+			size_t size = zlib[at + 1] | (zlib[at + 2] << 8);
+			at += 5;
+			if (at + size > zlib.size())
+				return false;
+			raw.insert(raw.end(), zlib.begin() + at, zlib.begin() + at + size);
+			at += size;
+		}
+
+		size_t rowSize = (size_t)width * 4;
+		if (width <= 0 || height <= 0 || raw.size() != (rowSize + 1) * height)
+			return false;
+		rgba.clear();
+		for (int y = 0; y < height; y++)
+		{
+			if (raw[y * (rowSize + 1)] != 0)
+				return false;
+			rgba.insert(rgba.end(), raw.begin() + y * (rowSize + 1) + 1, raw.begin() + (y + 1) * (rowSize + 1));
+		}
+		return true;
+	}
+
+	// --------------------------------------------------------
+	// Compares the finished frame with Tests/Golden/<name>.png.
+	// A mismatch leaves the frame beside the test binary as
+	// <name>_actual.png.
+	// --------------------------------------------------------
+	void ExpectMatchesGolden(SoftwareRasterizer& rasterizer, const char* name)
+	{
+		std::string golden = SourcePath("Tests/Golden/") + name + ".png";
+		if (getenv("DX11STARTER_UPDATE_GOLDEN"))
+		{
+			ASSERT_TRUE(rasterizer.SavePng(golden.c_str()));
+			return;
+		}
+
+		int width, height;
+		std::vector<unsigned char> expected;
+		ASSERT_TRUE(ReadPng(golden, width, height, expected)) << "can't read " << golden;
+		ASSERT_EQ(rasterizer.GetWidth(), width);
+		ASSERT_EQ(rasterizer.GetHeight(), height);
+
+		std::vector<unsigned char> actual;
+		rasterizer.GetPixels(actual);
+
+		int mismatched = 0;
+		int worst = 0;
+		for (size_t p = 0; p < actual.size(); p += 4)
+		{
+			int difference = 0;
+			for (int c = 0; c < 4; c++)
+				difference = std::max(difference, abs((int)actual[p + c] - (int)expected[p + c]));
+			if (difference > PixelTolerance)
+				mismatched++;
+			worst = std::max(worst, difference);
+		}
+
+		EXPECT_LE(mismatched, (int)(MismatchedShare * width * height))
+			<< name << ": " << mismatched << " pixels off by more than " << PixelTolerance << ", worst by " << worst;
+		if (mismatched > (int)(MismatchedShare * width * height))
+			rasterizer.SavePng((std::string(name) + "_actual.png").c_str());
+	}
+
+	void LoadModel(const char* name, MeshData& data)
+	{
+		std::string path = SourcePath((std::string("Debug/Models/") + name).c_str());
+		ASSERT_TRUE(Mesh::LoadObj(path.c_str(), 0, data)) << path;
+	}
+
+	XMFLOAT4X4 World(float x, float y, float z, float scale, float yaw = 0.0f)
+	{
+		XMFLOAT4X4 world;
+		XMMATRIX matrix = XMMatrixScaling(scale, scale, scale) * XMMatrixRotationRollPitchYaw(0.4f, yaw, 0.0f) * XMMatrixTranslation(x, y, z);
+		XMStoreFloat4x4(&world, XMMatrixTranspose(matrix));
+		return world;
+	}
+
+	// The game's four corner point lights
+	void AddCornerLights(LightSystem& lights)
+	{
+		XMFLOAT3 positions[4] = { XMFLOAT3(10.0f, 10.0f, -10.0f), XMFLOAT3(10.0f, -10.0f, -10.0f), XMFLOAT3(-10.0f, 10.0f, -10.0f), XMFLOAT3(-10.0f, -10.0f, -10.0f) };
+		for (int i = 0; i < 4; i++)
+		{
+			Light light = {};
+			light.Type = LightType::Point;
+			light.Position = positions[i];
+			light.Color = XMFLOAT3(300.0f, 300.0f, 300.0f);
+			light.Range = 1000.0f;
+			lights.Add(light);
+		}
+	}
+
+	// --------------------------------------------------------
+	// Looking from eye along direction, shaded with every
+	// light added so far, with nothing baked.  The frame
+	// points into the lights, so add no more after this.
+	// --------------------------------------------------------
+	SoftwareFrame MakeFrame(const XMFLOAT3& eye, const XMFLOAT3& direction, LightSystem& lights)
+	{
+		SoftwareFrame frame = {};
+		XMMATRIX view = XMMatrixLookToLH(XMLoadFloat3(&eye), XMLoadFloat3(&direction), XMVectorSet(0, 1, 0, 0));
+		XMMATRIX projection = XMMatrixPerspectiveFovLH(0.25f * 3.1415926535f, (float)ImageWidth / ImageHeight, 0.1f, 100.0f);
+		XMStoreFloat4x4(&frame.View, XMMatrixTranspose(view));
+		XMStoreFloat4x4(&frame.Projection, XMMatrixTranspose(projection));
+		frame.CameraPosition = eye;
+
+		frame.Lights = lights.GetCount() > 0 ? &lights.GetShaderLights()[0] : 0;
+		frame.LightCount = (int)lights.GetCount();
+		frame.AO = 1.0f;
+		frame.ClearColor = XMFLOAT3(0.1f, 0.1f, 0.15f);
+		return frame;
+	}
+
+	SoftwareMaterial MakeMaterial(float r, float g, float b, float metallic, float roughness)
+	{
+		SoftwareMaterial material = {};
+		material.Albedo = XMFLOAT3(r, g, b);
+		material.Metallic = metallic;
+		material.Roughness = roughness;
+		return material;
+	}
+
+	// --------------------------------------------------------
+	// A grid of spheres from smooth to rough across and from
+	// dielectric to metal down, like the game's scene, with a
+	// tilted cube in front of the middle one
+	// --------------------------------------------------------
+	void DrawSphereGrid(SoftwareRasterizer& rasterizer, const MeshData& sphere, const MeshData& cube)
+	{
+		for (int row = 0; row < 3; row++)
+		{
+			for (int column = 0; column < 4; column++)
+			{
+				SoftwareMaterial material = MakeMaterial(0.9f, 0.4f, 0.2f, row * 0.5f, 0.1f + column * 0.3f);
+				rasterizer.Draw(sphere, World(column * 1.1f - 1.65f, 1.1f - row * 1.1f, 0.0f, 1.0f), material);
+			}
+		}
+		rasterizer.Draw(cube, World(0.0f, 0.0f, -1.5f, 0.5f, 0.7f), MakeMaterial(0.3f, 0.7f, 0.9f, 0.0f, 0.5f));
+	}
+
+	// --------------------------------------------------------
+	// Sky for the baked lighting tests: blue above, brown
+	// below, and a bright patch for reflections to pick up
+	// --------------------------------------------------------
+	void MakeSky(int size, CubeMapData& sky)
+	{
+		sky.Resize(size);
+		for (int f = 0; f < 6; f++)
+		{
+			for (int y = 0; y < size; y++)
+			{
+				for (int x = 0; x < size; x++)
+				{
+					XMFLOAT3 d = CubeMapData::TexelDirection(f, size, x, y);
+					float length = sqrtf(d.x * d.x + d.y * d.y + d.z * d.z);
+					float up = d.y / length;
+					float sun = std::max(0.0f, (d.x - d.z) / length - 0.8f) * 20.0f;
+					XMFLOAT3& texel = sky.Faces[f][y * size + x];
+					texel = up > 0.0f ? XMFLOAT3(0.3f + 0.2f * up, 0.5f + 0.2f * up, 0.9f) : XMFLOAT3(0.3f, 0.2f, 0.1f);
+					texel.x += sun;
+					texel.y += sun;
+					texel.z += sun * 0.8f;
+				}
+			}
+		}
+	}
+
+	// Draws the sphere grid on every kernel path this CPU has
+	void ExpectGridMatchesGolden(const SoftwareFrame& frame, const char* name)
+	{
+		MeshData sphere, cube;
+		LoadModel("sphere.obj", sphere);
+		LoadModel("cube.obj", cube);
+
+		KernelPath original = PBRKernels::GetPath();
+		KernelPath paths[] = { KernelPath::Scalar, KernelPath::AVX2, KernelPath::AVX512 };
+		for (int p = 0; p < 3; p++)
+		{
+			// Only the best path writes golden images
+			if (!PBRKernels::SetPath(paths[p]) || (getenv("DX11STARTER_UPDATE_GOLDEN") && paths[p] != original))
+				continue;
+
+			SCOPED_TRACE(PBRKernels::GetPathName(paths[p]));
+			SoftwareRasterizer rasterizer(ImageWidth, ImageHeight);
+			rasterizer.Begin(frame);
+			DrawSphereGrid(rasterizer, sphere, cube);
+			rasterizer.End();
+			ExpectMatchesGolden(rasterizer, name);
+		}
+		PBRKernels::SetPath(original);
+	}
+}
+
+// --------------------------------------------------------
+// The corner lights alone, over the clear color
+// --------------------------------------------------------
+TEST(SoftwareRasterizerTests, MatchesGoldenDirectLighting)
+{
+	LightSystem lights;
+	AddCornerLights(lights);
+	ExpectGridMatchesGolden(MakeFrame(XMFLOAT3(0, 0, -5), XMFLOAT3(0, 0, 1), lights), "DirectLighting");
+}
+
+// --------------------------------------------------------
+// The corner lights plus irradiance and split-sum reflections
+// baked from a sky, which fills the background
+// --------------------------------------------------------
+TEST(SoftwareRasterizerTests, MatchesGoldenImageBasedLighting)
+{
+	CubeMapData sky, irradiance;
+	MakeSky(32, sky);
+	SHCoefficients sh;
+	IrradianceBaker::Bake(sky, 8, sh, irradiance);
+	std::vector<CubeMapData> prefiltered;
+	SpecularBaker::Prefilter(sky, 5, 64, prefiltered);
+	std::vector<XMFLOAT2> lut;
+	SpecularBaker::IntegrateBRDF(32, 64, lut);
+
+	LightSystem lights;
+	AddCornerLights(lights);
+	SoftwareFrame frame = MakeFrame(XMFLOAT3(0, 0, -5), XMFLOAT3(0, 0, 1), lights);
+	frame.Sky = &sky;
+	frame.Irradiance = &irradiance;
+	frame.Prefiltered = &prefiltered;
+	frame.BRDFLut = &lut;
+	frame.BRDFLutSize = 32;
+	ExpectGridMatchesGolden(frame, "ImageBasedLighting");
+}
+
+// --------------------------------------------------------
+// Every map sampled: a checkered albedo, ridges in the
+// normal map, and metal and roughness in stripes.  The
+// camera sits inside the floor's bounds, so the floor is
+// clipped against the near plane.
+// --------------------------------------------------------
+TEST(SoftwareRasterizerTests, MatchesGoldenTexturedFloor)
+{
+	const int mapSize = 16;
+	DecodedImage albedo, normal, metallic, roughness;
+	DecodedImage* maps[] = { &albedo, &normal, &metallic, &roughness };
+	for (int m = 0; m < 4; m++)
+	{
+		maps[m]->Width = maps[m]->Height = mapSize;
+		maps[m]->Pixels.resize(mapSize * mapSize * 4);
+	}
+	for (int y = 0; y < mapSize; y++)
+	{
+		for (int x = 0; x < mapSize; x++)
+		{
+			size_t p = (y * mapSize + x) * 4;
+			bool light = ((x / 4) + (y / 4)) % 2 == 0;
+			unsigned char checker[4] = { (unsigned char)(light ? 230 : 40), (unsigned char)(light ? 200 : 60), (unsigned char)(light ? 160 : 90), 255 };
+			float slope = sinf(x * 3.1415926535f / 4.0f) * 0.5f;
+			unsigned char ridge[4] = { (unsigned char)(128 + 127 * slope), 128, (unsigned char)(255 * sqrtf(1.0f - slope * slope)), 255 };
+			unsigned char metal = (unsigned char)(y < mapSize / 2 ? 255 : 0);
+			unsigned char rough = (unsigned char)(40 + x * 12);
+			for (int c = 0; c < 4; c++)
+			{
+				albedo.Pixels[p + c] = checker[c];
+				normal.Pixels[p + c] = ridge[c];
+				metallic.Pixels[p + c] = c < 3 ? metal : 255;
+				roughness.Pixels[p + c] = c < 3 ? rough : 255;
+			}
+		}
+	}
+
+	SoftwareMaterial material = MakeMaterial(1, 1, 1, 0, 1);
+	material.AlbedoMap = &albedo;
+	material.NormalMap = &normal;
+	material.MetallicMap = &metallic;
+	material.RoughnessMap = &roughness;
+
+	// A floor 20 units across with the UVs repeating four times
+	Vertex floor[4] = {};
+	float corners[4][2] = { { -10, -10 }, { -10, 10 }, { 10, 10 }, { 10, -10 } };
+	for (int i = 0; i < 4; i++)
+	{
+		floor[i].Position = XMFLOAT3(corners[i][0], 0.0f, corners[i][1]);
+		floor[i].UV = XMFLOAT2(corners[i][0] / 5.0f, -corners[i][1] / 5.0f);
+		floor[i].Normal = XMFLOAT3(0, 1, 0);
+		floor[i].Tangent = XMFLOAT4(1, 0, 0, 1);
+	}
+	unsigned int indices[6] = { 0, 1, 2, 0, 2, 3 };
+
+	// A warm point light that fades out before the far corner,
+	// and a blue spot light pooled on the floor to the left
+	LightSystem lights;
+	Light light = {};
+	light.Type = LightType::Point;
+	light.Position = XMFLOAT3(3.0f, 3.0f, 2.0f);
+	light.Color = XMFLOAT3(40.0f, 32.0f, 20.0f);
+	light.Range = 9.0f;
+	lights.Add(light);
+
+	light.Type = LightType::Spot;
+	light.Position = XMFLOAT3(-2.0f, 3.0f, 3.0f);
+	light.Direction = XMFLOAT3(0.0f, -1.0f, 0.2f);
+	light.Color = XMFLOAT3(20.0f, 50.0f, 120.0f);
+	light.Range = 12.0f;
+	light.InnerAngle = 0.3f;
+	light.OuterAngle = 0.5f;
+	lights.Add(light);
+
+	SoftwareFrame frame = MakeFrame(XMFLOAT3(0, 1.5f, -4), XMFLOAT3(0, -0.4f, 1), lights);
+
+	XMFLOAT4X4 identity;
+	XMStoreFloat4x4(&identity, XMMatrixIdentity());
+	SoftwareRasterizer rasterizer(ImageWidth, ImageHeight);
+	rasterizer.Begin(frame);
+	rasterizer.Draw(floor, 4, indices, IndexFormat::UInt32, 6, identity, material);
+	rasterizer.End();
+	ExpectMatchesGolden(rasterizer, "TexturedFloor");
+}
+
+// --------------------------------------------------------
+// Tiles keep their triangles in submission order, so the
+// image is the same however many threads draw it
+// --------------------------------------------------------
+TEST(SoftwareRasterizerTests, SameImageOnAnyThreadCount)
+{
+	MeshData sphere, cube;
+	LoadModel("sphere.obj", sphere);
+	LoadModel("cube.obj", cube);
+	LightSystem lights;
+	AddCornerLights(lights);
+	SoftwareFrame frame = MakeFrame(XMFLOAT3(0, 0, -5), XMFLOAT3(0, 0, 1), lights);
+
+	SoftwareRasterizer single(ImageWidth, ImageHeight);
+	single.Begin(frame);
+	DrawSphereGrid(single, sphere, cube);
+	single.End();
+
+	JobSystem jobs(3);
+	SoftwareRasterizer threaded(ImageWidth, ImageHeight, &jobs);
+	threaded.Begin(frame);
+	DrawSphereGrid(threaded, sphere, cube);
+	threaded.End();
+
+	const std::vector<XMFLOAT3>& a = single.GetColor();
+	const std::vector<XMFLOAT3>& b = threaded.GetColor();
+	ASSERT_EQ(a.size(), b.size());
+	int different = 0;
+	for (size_t i = 0; i < a.size(); i++)
+		different += a[i].x != b[i].x || a[i].y != b[i].y || a[i].z != b[i].z;
+	EXPECT_EQ(0, different);
+
+	// Every tile was drawn and timed
+	const std::vector<RasterTileTiming>& timings = threaded.GetTileTimings();
+	EXPECT_EQ((size_t)(((ImageWidth + 31) / 32) * ((ImageHeight + 31) / 32)), timings.size());
+	for (size_t t = 0; t < timings.size(); t++)
+		EXPECT_GE(timings[t].Milliseconds, 0.0);
+}
+
+// --------------------------------------------------------
+// A fan of thin triangles sharing edges covers every pixel
+// inside it - the top-left rule leaves no cracks of clear
+// color between neighbours
+// --------------------------------------------------------
+TEST(SoftwareRasterizerTests, SharedEdgesLeaveNoGaps)
+{
+	LightSystem lights;
+	AddCornerLights(lights);
+	SoftwareFrame frame = MakeFrame(XMFLOAT3(0, 0, -5), XMFLOAT3(0, 0, 1), lights);
+	frame.ClearColor = XMFLOAT3(1, 0, 1);
+
+	// A fan of thin triangles around a center, filling a square
+	std::vector<Vertex> verts;
+	std::vector<unsigned int> indices;
+	Vertex center = {};
+	center.Normal = XMFLOAT3(0, 0, -1);
+	center.Tangent = XMFLOAT4(1, 0, 0, 1);
+	verts.push_back(center);
+	const int spokes = 37;
+	for (int i = 0; i <= spokes; i++)
+	{
+		float angle = i * 2.0f * 3.1415926535f / spokes;
+		Vertex v = center;
+		v.Position = XMFLOAT3(cosf(angle) * 1.9f, sinf(angle) * 1.9f, 0.0f);
+		verts.push_back(v);
+		if (i > 0)
+		{
+			indices.push_back(0);
+			indices.push_back(i + 1);
+			indices.push_back(i);
+		}
+	}
+
+	XMFLOAT4X4 identity;
+	XMStoreFloat4x4(&identity, XMMatrixIdentity());
+	SoftwareRasterizer rasterizer(ImageWidth, ImageHeight);
+	rasterizer.Begin(frame);
+	rasterizer.Draw(&verts[0], (int)verts.size(), &indices[0], IndexFormat::UInt32, (int)indices.size(), identity,
+		MakeMaterial(0.5f, 0.5f, 0.5f, 0.0f, 0.5f));
+	rasterizer.End();
+
+	// Everything within the disc's inner radius is covered
+	const std::vector<XMFLOAT3>& color = rasterizer.GetColor();
+	int gaps = 0;
+	for (int y = ImageHeight / 2 - 25; y < ImageHeight / 2 + 25; y++)
+	{
+		for (int x = ImageWidth / 2 - 25; x < ImageWidth / 2 + 25; x++)
+		{
+			const XMFLOAT3& c = color[y * ImageWidth + x];
+			gaps += c.x == 1.0f && c.y == 0.0f && c.z == 1.0f;
+		}
+	}
+	EXPECT_EQ(0, gaps);
+}
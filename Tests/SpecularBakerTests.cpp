@@ -0,0 +1,234 @@
+#include "SpecularBaker.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	const double Pi = 3.14159265358979323846;
+
+	double DistributionGGX(double nDotH, double roughness)
+	{
+		double a = roughness * roughness;
+		double a2 = a * a;
+		double denom = nDotH * nDotH * (a2 - 1.0) + 1.0;
+		return a2 / (Pi * denom * denom);
+	}
+
+	// --------------------------------------------------------
+	// Midpoint rule over the hemisphere around +Z
+	// --------------------------------------------------------
+	template<typename Visit>
+	void ForEachHemisphereDirection(int rows, int columns, Visit visit)
+	{
+		for (int i = 0; i < rows; i++)
+		{
+			double theta = (i + 0.5) * 0.5 * Pi / rows;
+			double solidAngle = sin(theta) * (0.5 * Pi / rows) * (2.0 * Pi / columns);
+			for (int j = 0; j < columns; j++)
+			{
+				double phi = (j + 0.5) * 2.0 * Pi / columns;
+				visit(sin(theta) * cos(phi), sin(theta) * sin(phi), cos(theta), solidAngle);
+			}
+		}
+	}
+
+	// --------------------------------------------------------
+	// The split-sum BRDF terms by integrating over half vectors
+	// rather than importance sampling:
+	//   scale = integral of D * G * (1 - Fc) * VdotH / NdotV
+	//   bias  = integral of D * G * Fc * VdotH / NdotV
+	// over H where L lands above the surface, with G the
+	// Smith-Schlick term at k = roughness^2 / 2.  The GGX lobe
+	// sits around the pole in H, where the grid is finest, so
+	// this holds up at grazing angles where a grid over L
+	// doesn't.
+	// --------------------------------------------------------
+	void ReferenceBRDF(double nDotV, double roughness, double& scale, double& bias)
+	{
+		double vx = sqrt(1.0 - nDotV * nDotV);
+		double vz = nDotV;
+		double k = roughness * roughness * 0.5;
+		double gv = nDotV / (nDotV * (1.0 - k) + k);
+
+		scale = bias = 0.0;
+		ForEachHemisphereDirection(1024, 512, [&](double hx, double hy, double hz, double solidAngle) {
+			double vDotH = vx * hx + vz * hz;
+			double nDotL = 2.0 * vDotH * hz - vz;
+			if (vDotH <= 0.0 || nDotL <= 0.0)
+				return;
+
+			double gl = nDotL / (nDotL * (1.0 - k) + k);
+			double brdf = DistributionGGX(hz, roughness) * gv * gl * vDotH / nDotV * solidAngle;
+			double fc = pow(1.0 - vDotH, 5.0);
+			scale += (1.0 - fc) * brdf;
+			bias += fc * brdf;
+		});
+	}
+
+	// A smooth sky that's brighter and bluer towards +Y, with a warm glow towards +X
+	void Sky(double x, double y, double z, double rgb[3])
+	{
+		double glow = std::max(0.0, x);
+		rgb[0] = 0.4 + 0.2 * y + 0.6 * glow * glow;
+		rgb[1] = 0.5 + 0.3 * y + 0.3 * glow * glow;
+		rgb[2] = 0.7 + 0.4 * y + 0.1 * x * z;
+	}
+
+	// --------------------------------------------------------
+	// The prefiltered radiance in direction n, taking V = N:
+	// radiance weighted by D * NdotL over the hemisphere, as
+	// the GGX samples weighted by NdotL estimate it
+	// --------------------------------------------------------
+	void ReferencePrefilter(double nx, double ny, double nz, double roughness, double rgb[3])
+	{
+		// The lobe is symmetric about n, so any tangent frame will do
+		double ux = fabs(nz) < 0.999 ? 0.0 : 1.0;
+		double uz = 1.0 - ux;
+		double tx = -uz * ny, ty = uz * nx - ux * nz, tz = ux * ny;
+		double tl = sqrt(tx * tx + ty * ty + tz * tz);
+		tx /= tl; ty /= tl; tz /= tl;
+		double bx = ny * tz - nz * ty, by = nz * tx - nx * tz, bz = nx * ty - ny * tx;
+
+		double sum[3] = { 0, 0, 0 };
+		double total = 0.0;
+		ForEachHemisphereDirection(128, 256, [&](double lx, double ly, double lz, double solidAngle) {
+			// Half vector of V = N = +Z and L
+			double nDotH = (lz + 1.0) / sqrt(lx * lx + ly * ly + (lz + 1.0) * (lz + 1.0));
+			double weight = DistributionGGX(nDotH, roughness) * lz * solidAngle;
+
+			double wx = lx * tx + ly * bx + lz * nx;
+			double wy = lx * ty + ly * by + lz * ny;
+			double wz = lx * tz + ly * bz + lz * nz;
+			double radiance[3];
+			Sky(wx, wy, wz, radiance);
+			for (int c = 0; c < 3; c++)
+				sum[c] += radiance[c] * weight;
+			total += weight;
+		});
+
+		for (int c = 0; c < 3; c++)
+			rgb[c] = sum[c] / total;
+	}
+}
+
+// --------------------------------------------------------
+// Entries of the table against integrating over half
+// vectors in doubles.  The smoothest row is left out - its
+// lobe is narrower than the reference grid.  With the 512
+// Hammersley samples the app uses, entries land within 0.01.
+// --------------------------------------------------------
+TEST(SpecularBakerTests, BRDFMatchesIntegral)
+{
+	const int size = 16;
+	std::vector<XMFLOAT2> lut;
+	SpecularBaker::IntegrateBRDF(size, 512, lut);
+	ASSERT_EQ((size_t)(size * size), lut.size());
+
+	for (int y = 1; y < size; y++)
+	{
+		double roughness = (y + 0.5) / size;
+		for (int x = 0; x < size; x += 3)
+		{
+			double nDotV = (x + 0.5) / size;
+			double scale, bias;
+			ReferenceBRDF(nDotV, roughness, scale, bias);
+			EXPECT_NEAR(scale, lut[y * size + x].x, 0.01) << "roughness " << roughness << ", NdotV " << nDotV;
+			EXPECT_NEAR(bias, lut[y * size + x].y, 0.01) << "roughness " << roughness << ", NdotV " << nDotV;
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Properties that hold for every entry: scale and bias are
+// in [0, 1] and add up to at most one (the BRDF can't reflect
+// more than comes in), and rougher surfaces reflect less
+// head on
+// --------------------------------------------------------
+TEST(SpecularBakerTests, BRDFIsBounded)
+{
+	const int size = 32;
+	std::vector<XMFLOAT2> lut;
+	SpecularBaker::IntegrateBRDF(size, 256, lut);
+
+	for (int i = 0; i < size * size; i++)
+	{
+		EXPECT_GE(lut[i].x, 0.0f) << "entry " << i;
+		EXPECT_GE(lut[i].y, 0.0f) << "entry " << i;
+		EXPECT_LE(lut[i].x + lut[i].y, 1.0f + 1e-3f) << "entry " << i;
+	}
+	for (int y = 1; y < size; y++)
+	{
+		const XMFLOAT2& smoother = lut[(y - 1) * size + size - 1];
+		const XMFLOAT2& rougher = lut[y * size + size - 1];
+		EXPECT_LE(rougher.x + rougher.y, smoother.x + smoother.y + 1e-3f) << "row " << y;
+	}
+}
+
+// --------------------------------------------------------
+// Every texel of the mip chain against the GGX weighted
+// hemisphere integral of the sky.  The baker reads box
+// filtered mips of a cube map where the reference reads
+// the sky itself, so this allows 0.025, about 2% of the
+// brightest value.
+// --------------------------------------------------------
+TEST(SpecularBakerTests, PrefilterMatchesIntegral)
+{
+	const int size = 32;
+	const int mipCount = 5;
+	CubeMapData radiance;
+	radiance.Resize(size);
+	for (int f = 0; f < 6; f++)
+	{
+		for (int y = 0; y < size; y++)
+		{
+			for (int x = 0; x < size; x++)
+			{
+				XMFLOAT3 d = CubeMapData::TexelDirection(f, size, x, y);
+				double rgb[3];
+				Sky(d.x, d.y, d.z, rgb);
+				radiance.Faces[f][y * size + x] = XMFLOAT3((float)rgb[0], (float)rgb[1], (float)rgb[2]);
+			}
+		}
+	}
+
+	std::vector<CubeMapData> mips;
+	SpecularBaker::Prefilter(radiance, mipCount, 512, mips);
+	ASSERT_EQ((size_t)mipCount, mips.size());
+
+	// Mip 0 is the mirror reflection, which is the sky itself
+	for (int f = 0; f < 6; f++)
+	{
+		ASSERT_EQ(radiance.Faces[f].size(), mips[0].Faces[f].size());
+		for (size_t t = 0; t < radiance.Faces[f].size(); t++)
+			EXPECT_EQ(radiance.Faces[f][t].x, mips[0].Faces[f][t].x);
+	}
+
+	const double tolerance = 0.025;
+	for (int m = 1; m < mipCount; m++)
+	{
+		int mipSize = size >> m;
+		ASSERT_EQ(mipSize, mips[m].Size);
+		double roughness = (double)m / (mipCount - 1);
+
+		for (int f = 0; f < 6; f++)
+		{
+			for (int y = 0; y < mipSize; y++)
+			{
+				for (int x = 0; x < mipSize; x++)
+				{
+					XMFLOAT3 n = CubeMapData::TexelDirection(f, mipSize, x, y);
+					double expected[3];
+					ReferencePrefilter(n.x, n.y, n.z, roughness, expected);
+
+					const XMFLOAT3& baked = mips[m].Faces[f][y * mipSize + x];
+					EXPECT_NEAR(expected[0], baked.x, tolerance) << "mip " << m << " face " << f << " texel " << x << "," << y;
+					EXPECT_NEAR(expected[1], baked.y, tolerance) << "mip " << m << " face " << f << " texel " << x << "," << y;
+					EXPECT_NEAR(expected[2], baked.z, tolerance) << "mip " << m << " face " << f << " texel " << x << "," << y;
+				}
+			}
+		}
+	}
+}
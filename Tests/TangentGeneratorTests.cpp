@@ -0,0 +1,98 @@
+#include "JobSystem.h"
+#include "TangentGenerator.h"
+#include "TangentReference.h"
+#include <gtest/gtest.h>
+#include <vector>
+
+namespace
+{
+	// --------------------------------------------------------
+	// Runs both generators on the same surface and checks every
+	// tangent matches the double precision reference
+	// --------------------------------------------------------
+	void CheckAgainstReference(int triangles, JobSystem* jobs = 0)
+	{
+		std::vector<Vertex> verts;
+		std::vector<unsigned int> indices;
+		TangentReference::MakeSurface(triangles, verts, indices);
+		ASSERT_EQ((size_t)triangles * 3, indices.size());
+
+		std::vector<Vertex> expected = verts;
+		TangentReference::Generate(&expected[0], (int)expected.size(), &indices[0], (int)indices.size());
+		TangentGenerator::Generate(&verts[0], (int)verts.size(), &indices[0], (int)indices.size(), jobs);
+
+		int mirrored = 0;
+		for (size_t i = 0; i < verts.size(); i++)
+		{
+			const DirectX::XMFLOAT4& t = verts[i].Tangent;
+			const DirectX::XMFLOAT4& e = expected[i].Tangent;
+			EXPECT_NEAR(e.x, t.x, 1e-4f) << "vertex " << i;
+			EXPECT_NEAR(e.y, t.y, 1e-4f) << "vertex " << i;
+			EXPECT_NEAR(e.z, t.z, 1e-4f) << "vertex " << i;
+			EXPECT_EQ(e.w, t.w) << "vertex " << i;
+			mirrored += t.w < 0.0f;
+		}
+
+		// Both halves of the surface were exercised
+		EXPECT_GT(mirrored, 0);
+		EXPECT_LT(mirrored, (int)verts.size());
+	}
+}
+
+// --------------------------------------------------------
+// Counts that leave 1, 2 and 3 triangles after the groups of
+// four, as well as exact multiples
+// --------------------------------------------------------
+TEST(TangentGeneratorTests, MatchesReferenceOnSmallMeshes)
+{
+	int counts[] = { 8, 9, 10, 11, 12, 101, 1002 };
+	for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); i++)
+	{
+		SCOPED_TRACE(counts[i]);
+		CheckAgainstReference(counts[i]);
+	}
+}
+
+// --------------------------------------------------------
+// Big enough to be split into a slice per thread
+// --------------------------------------------------------
+TEST(TangentGeneratorTests, MatchesReferenceAcrossThreads)
+{
+	JobSystem jobs(3);
+	CheckAgainstReference(200003, &jobs);
+}
+
+// --------------------------------------------------------
+// Triangles without uv area add nothing instead of NaNs
+// --------------------------------------------------------
+TEST(TangentGeneratorTests, IgnoresDegenerateUVs)
+{
+	std::vector<Vertex> verts;
+	std::vector<unsigned int> indices;
+	TangentReference::MakeSurface(8, verts, indices);
+
+	// Collapse one triangle's uv's onto a point
+	verts.push_back(verts[indices[0]]);
+	verts.push_back(verts[indices[1]]);
+	verts.push_back(verts[indices[2]]);
+	unsigned int first = (unsigned int)verts.size() - 3;
+	verts[first + 1].UV = verts[first].UV;
+	verts[first + 2].UV = verts[first].UV;
+	indices.push_back(first); indices.push_back(first + 1); indices.push_back(first + 2);
+
+	// And share one of them with a real triangle
+	indices.push_back(first); indices.push_back(indices[1]); indices.push_back(indices[2]);
+
+	TangentGenerator::Generate(&verts[0], (int)verts.size(), &indices[0], (int)indices.size());
+	for (size_t i = 0; i < verts.size(); i++)
+	{
+		EXPECT_FALSE(std::isnan(verts[i].Tangent.x)) << "vertex " << i;
+		EXPECT_FALSE(std::isnan(verts[i].Tangent.y)) << "vertex " << i;
+		EXPECT_FALSE(std::isnan(verts[i].Tangent.z)) << "vertex " << i;
+	}
+
+	std::vector<Vertex> expected = verts;
+	TangentReference::Generate(&expected[0], (int)expected.size(), &indices[0], (int)indices.size());
+	EXPECT_NEAR(expected[first].Tangent.x, verts[first].Tangent.x, 1e-4f);
+	EXPECT_NEAR(expected[first].Tangent.y, verts[first].Tangent.y, 1e-4f);
+}
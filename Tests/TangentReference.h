@@ -0,0 +1,143 @@
+#pragma once
+#include "Vertex.h"
+#include <cmath>
+#include <vector>
+
+// --------------------------------------------------------
+// The straightforward tangent generator TangentGenerator
+// replaced: whole vertices, one triangle at a time, summed
+// in doubles.  Used by the tests as the expected result and
+// by the benchmarks as the baseline.
+// --------------------------------------------------------
+namespace TangentReference
+{
+	inline void Generate(Vertex* verts, int numVerts, const unsigned int* indices, int numIndices)
+	{
+		std::vector<double> tan(numVerts * 3, 0.0);
+		std::vector<double> bitan(numVerts * 3, 0.0);
+
+		for (int i = 0; i + 2 < numIndices; i += 3)
+		{
+			unsigned int corner[3] = { indices[i], indices[i + 1], indices[i + 2] };
+			const Vertex& v1 = verts[corner[0]];
+			const Vertex& v2 = verts[corner[1]];
+			const Vertex& v3 = verts[corner[2]];
+
+			double x1 = (double)v2.Position.x - v1.Position.x;
+			double y1 = (double)v2.Position.y - v1.Position.y;
+			double z1 = (double)v2.Position.z - v1.Position.z;
+			double x2 = (double)v3.Position.x - v1.Position.x;
+			double y2 = (double)v3.Position.y - v1.Position.y;
+			double z2 = (double)v3.Position.z - v1.Position.z;
+			double s1 = (double)v2.UV.x - v1.UV.x;
+			double t1 = (double)v2.UV.y - v1.UV.y;
+			double s2 = (double)v3.UV.x - v1.UV.x;
+			double t2 = (double)v3.UV.y - v1.UV.y;
+
+			double det = s1 * t2 - s2 * t1;
+			if (det == 0.0)
+				continue;
+			double r = 1.0 / det;
+
+			for (int c = 0; c < 3; c++)
+			{
+				double* t = &tan[corner[c] * 3];
+				double* b = &bitan[corner[c] * 3];
+				t[0] += (t2 * x1 - t1 * x2) * r;
+				t[1] += (t2 * y1 - t1 * y2) * r;
+				t[2] += (t2 * z1 - t1 * z2) * r;
+				b[0] += (s1 * x2 - s2 * x1) * r;
+				b[1] += (s1 * y2 - s2 * y1) * r;
+				b[2] += (s1 * z2 - s2 * z1) * r;
+			}
+		}
+
+		for (int i = 0; i < numVerts; i++)
+		{
+			double n[3] = { verts[i].Normal.x, verts[i].Normal.y, verts[i].Normal.z };
+			double* t = &tan[i * 3];
+			double* b = &bitan[i * 3];
+
+			// Gram-Schmidt, then normalize
+			double d = n[0] * t[0] + n[1] * t[1] + n[2] * t[2];
+			double o[3] = { t[0] - n[0] * d, t[1] - n[1] * d, t[2] - n[2] * d };
+			double len = sqrt(o[0] * o[0] + o[1] * o[1] + o[2] * o[2]);
+			if (len > 0.0)
+			{
+				o[0] /= len; o[1] /= len; o[2] /= len;
+			}
+
+			// Bitangent sign from (N x T) . B
+			double c[3] = { n[1] * o[2] - n[2] * o[1], n[2] * o[0] - n[0] * o[2], n[0] * o[1] - n[1] * o[0] };
+			double sign = c[0] * b[0] + c[1] * b[1] + c[2] * b[2] < 0.0 ? -1.0 : 1.0;
+
+			verts[i].Tangent = DirectX::XMFLOAT4((float)o[0], (float)o[1], (float)o[2], (float)sign);
+		}
+	}
+
+	// --------------------------------------------------------
+	// A wavy, indexed grid of exactly the given triangle count.
+	// The right half is a separate patch with U mirrored, like a
+	// mirrored texture, so its bitangent sign flips.
+	// --------------------------------------------------------
+	inline void MakeSurface(int triangles, std::vector<Vertex>& verts, std::vector<unsigned int>& indices)
+	{
+		int side = (int)sqrt(triangles / 2.0);
+		if (side < 2)
+			side = 2;
+		int half = side / 2;
+
+		verts.clear();
+		indices.clear();
+		for (int patch = 0; patch < 2; patch++)
+		{
+			int firstColumn = patch == 0 ? 0 : half;
+			int lastColumn = patch == 0 ? half : side;
+			int columns = lastColumn - firstColumn + 1;
+			unsigned int base = (unsigned int)verts.size();
+
+			for (int y = 0; y <= side; y++)
+			{
+				for (int x = firstColumn; x <= lastColumn; x++)
+				{
+					float fx = (float)x / side, fy = (float)y / side;
+					float h = 0.1f * sinf(fx * 9.0f) * cosf(fy * 7.0f);
+
+					// Normal of the height field
+					float dx = 0.9f * cosf(fx * 9.0f) * cosf(fy * 7.0f);
+					float dy = -0.7f * sinf(fx * 9.0f) * sinf(fy * 7.0f);
+					float len = sqrtf(dx * dx + dy * dy + 1.0f);
+
+					Vertex v = {};
+					v.Position = DirectX::XMFLOAT3(fx, fy, h);
+					v.Normal = DirectX::XMFLOAT3(-dx / len, -dy / len, 1.0f / len);
+					v.UV = DirectX::XMFLOAT2(patch == 0 ? fx : 1.0f - fx, 1.0f - fy);
+					verts.push_back(v);
+				}
+			}
+
+			for (int y = 0; y < side; y++)
+			{
+				for (int x = 0; x + 1 < columns; x++)
+				{
+					unsigned int a = base + y * columns + x;
+					unsigned int b = a + 1;
+					unsigned int c = a + columns + 1;
+					unsigned int d = a + columns;
+					indices.push_back(a); indices.push_back(b); indices.push_back(c);
+					indices.push_back(a); indices.push_back(c); indices.push_back(d);
+				}
+			}
+		}
+
+		// Top up to the exact count with triangles reusing the left
+		// patch, so the count needn't be a multiple of anything
+		int extra = triangles - (int)indices.size() / 3;
+		for (int i = 0; i < extra; i++)
+		{
+			unsigned int a = (i % side) * (half + 1);
+			indices.push_back(a); indices.push_back(a + 1); indices.push_back(a + half + 2);
+		}
+		indices.resize(triangles * 3);
+	}
+}
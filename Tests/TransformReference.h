@@ -0,0 +1,79 @@
+#pragma once
+#include "TransformSystem.h"
+#include <DirectXMath.h>
+#include <vector>
+
+// --------------------------------------------------------
+// Transforms the way GameEntity used to keep them: one
+// struct per entity, every matrix rebuilt from separate
+// DirectXMath matrices on every update.  Used by the tests
+// as the expected result and by the benchmarks as the
+// baseline.
+// --------------------------------------------------------
+namespace TransformReference
+{
+	struct Transform
+	{
+		DirectX::XMFLOAT3 Position;
+		DirectX::XMFLOAT3 Rotation;
+		DirectX::XMFLOAT3 Scale;
+		TransformId Parent;
+		DirectX::XMFLOAT4X4 World;
+	};
+
+	// Parents must come before their children, as in TransformSystem
+	inline void Update(std::vector<Transform>& transforms)
+	{
+		using namespace DirectX;
+		for (size_t i = 0; i < transforms.size(); i++)
+		{
+			Transform& t = transforms[i];
+			XMMATRIX trans = XMMatrixTranslation(t.Position.x, t.Position.y, t.Position.z);
+			XMMATRIX rotX = XMMatrixRotationX(t.Rotation.x);
+			XMMATRIX rotY = XMMatrixRotationY(t.Rotation.y);
+			XMMATRIX rotZ = XMMatrixRotationZ(t.Rotation.z);
+			XMMATRIX sc = XMMatrixScaling(t.Scale.x, t.Scale.y, t.Scale.z);
+			XMMATRIX total = sc * rotZ * rotY * rotX * trans;
+
+			// Stored transposed, so the parent's world is transposed back
+			if (t.Parent != NoParent)
+				total = total * XMMatrixTranspose(XMLoadFloat4x4(&transforms[t.Parent].World));
+			XMStoreFloat4x4(&t.World, XMMatrixTranspose(total));
+		}
+	}
+
+	// Same numbers on every platform, unlike rand()
+	inline float Random(unsigned int& seed, float low, float high)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		return low + (high - low) * ((seed >> 8) / 16777216.0f);
+	}
+
+	// --------------------------------------------------------
+	// Fills both with the same pseudo-random transforms.  Every
+	// transform past the first roots gets a parent when
+	// withParents is set, picked from the ones before it.
+	// --------------------------------------------------------
+	inline void MakeTransforms(size_t count, bool withParents, std::vector<Transform>& reference, TransformSystem& system)
+	{
+		unsigned int seed = 12345;
+
+		reference.resize(count);
+		system.Reserve(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			Transform& t = reference[i];
+			t.Parent = NoParent;
+			if (withParents && i >= 4)
+				t.Parent = (TransformId)(Random(seed, 0.0f, 1.0f) * i);
+			t.Position = DirectX::XMFLOAT3(Random(seed, -10, 10), Random(seed, -10, 10), Random(seed, -10, 10));
+			t.Rotation = DirectX::XMFLOAT3(Random(seed, -3.2f, 3.2f), Random(seed, -3.2f, 3.2f), Random(seed, -3.2f, 3.2f));
+			t.Scale = DirectX::XMFLOAT3(Random(seed, 0.5f, 2), Random(seed, 0.5f, 2), Random(seed, 0.5f, 2));
+
+			TransformId id = system.Create(t.Parent);
+			system.SetPosition(id, t.Position.x, t.Position.y, t.Position.z);
+			system.SetRotation(id, t.Rotation.x, t.Rotation.y, t.Rotation.z);
+			system.SetScale(id, t.Scale.x, t.Scale.y, t.Scale.z);
+		}
+	}
+}
@@ -0,0 +1,240 @@
+#include "TransformSystem.h"
+#include "TransformReference.h"
+#include "scene.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// Relative to the biggest element, since world matrices down
+	// a hierarchy get large and their translations cancel out
+	void ExpectMatrixNear(const XMFLOAT4X4& expected, const XMFLOAT4X4& actual, size_t id)
+	{
+		float largest = 1.0f;
+		for (int r = 0; r < 4; r++)
+			for (int c = 0; c < 4; c++)
+				largest = std::max(largest, fabsf(expected.m[r][c]));
+
+		float tolerance = 1e-5f * largest;
+		for (int r = 0; r < 4; r++)
+		{
+			for (int c = 0; c < 4; c++)
+				EXPECT_NEAR(expected.m[r][c], actual.m[r][c], tolerance) << "transform " << id << " [" << r << "][" << c << "]";
+		}
+	}
+
+	void ExpectMatchesReference(std::vector<TransformReference::Transform>& reference, TransformSystem& system)
+	{
+		TransformReference::Update(reference);
+		ASSERT_EQ(reference.size(), system.GetCount());
+		for (size_t i = 0; i < reference.size(); i++)
+			ExpectMatrixNear(reference[i].World, system.GetWorldMatrix((TransformId)i), i);
+	}
+
+	// --------------------------------------------------------
+	// A node scaled, then rotated about an axis, then moved.
+	// Assimp's own scale/rotation/position constructor scales
+	// after rotating, so the product is built here instead.
+	// --------------------------------------------------------
+	aiNode* MakeNode(const char* name, aiVector3D scaling, aiVector3D axis, float angle, aiVector3D position)
+	{
+		aiMatrix4x4 scale, rotation, translation;
+		aiMatrix4x4::Scaling(scaling, scale);
+		aiMatrix4x4::Rotation(angle, axis.Normalize(), rotation);
+		aiMatrix4x4::Translation(position, translation);
+
+		aiNode* node = new aiNode(name);
+		node->mTransformation = translation * rotation * scale;
+		return node;
+	}
+
+	void AddChildren(aiNode* parent, std::initializer_list<aiNode*> children)
+	{
+		parent->mNumChildren = (unsigned int)children.size();
+		parent->mChildren = new aiNode*[children.size()];
+		unsigned int i = 0;
+		for (aiNode* child : children)
+		{
+			child->mParent = parent;
+			parent->mChildren[i++] = child;
+		}
+	}
+
+	// Assimp matrices are column-major, like the transposed world
+	// matrices TransformSystem keeps
+	XMFLOAT4X4 ToFloat4x4(const aiMatrix4x4& m)
+	{
+		XMFLOAT4X4 result;
+		for (unsigned int r = 0; r < 4; r++)
+			for (unsigned int c = 0; c < 4; c++)
+				result.m[r][c] = m[r][c];
+		return result;
+	}
+
+	aiMatrix4x4 ToAiMatrix(const XMFLOAT4X4& m)
+	{
+		aiMatrix4x4 result;
+		for (unsigned int r = 0; r < 4; r++)
+			for (unsigned int c = 0; c < 4; c++)
+				result[r][c] = m.m[r][c];
+		return result;
+	}
+
+	// --------------------------------------------------------
+	// Walks the nodes depth-first, as Import() numbers them,
+	// checking each one's parent and that its world matrix is
+	// the product of the node matrices down to it
+	// --------------------------------------------------------
+	void ExpectImported(TransformSystem& system, const aiNode* node, TransformId parent, const aiMatrix4x4& parentWorld, TransformId& next)
+	{
+		TransformId id = next++;
+		SCOPED_TRACE(node->mName.C_Str());
+		EXPECT_EQ(parent, system.GetParent(id));
+
+		aiMatrix4x4 world = parentWorld * node->mTransformation;
+		ExpectMatrixNear(ToFloat4x4(world), system.GetWorldMatrix(id), id);
+
+		for (unsigned int i = 0; i < node->mNumChildren; i++)
+			ExpectImported(system, node->mChildren[i], id, world, next);
+	}
+}
+
+// --------------------------------------------------------
+// Flat transforms, with a count that leaves a partial group
+// of four at the end
+// --------------------------------------------------------
+TEST(TransformSystemTests, MatchesReference)
+{
+	std::vector<TransformReference::Transform> reference;
+	TransformSystem system;
+	TransformReference::MakeTransforms(1003, false, reference, system);
+
+	system.Update();
+	EXPECT_EQ(1003u, system.GetChanged().size());
+	ExpectMatchesReference(reference, system);
+}
+
+// --------------------------------------------------------
+// Changes reach every descendant, however deep
+// --------------------------------------------------------
+TEST(TransformSystemTests, MatchesReferenceWithParents)
+{
+	std::vector<TransformReference::Transform> reference;
+	TransformSystem system;
+	TransformReference::MakeTransforms(1001, true, reference, system);
+	system.Update();
+	ExpectMatchesReference(reference, system);
+
+	// Move one root and check only it and its descendants changed
+	reference[1].Position.x += 3.0f;
+	system.Move(1, 3.0f, 0.0f, 0.0f);
+	system.Update();
+	ExpectMatchesReference(reference, system);
+
+	std::vector<bool> below(reference.size(), false);
+	below[1] = true;
+	size_t expectedChanged = 1;
+	for (size_t i = 2; i < reference.size(); i++)
+	{
+		if (reference[i].Parent != NoParent && below[reference[i].Parent])
+		{
+			below[i] = true;
+			expectedChanged++;
+		}
+	}
+	const std::vector<TransformId>& changed = system.GetChanged();
+	EXPECT_EQ(expectedChanged, changed.size());
+	for (size_t i = 0; i < changed.size(); i++)
+		EXPECT_TRUE(below[changed[i]]) << "transform " << changed[i];
+}
+
+// --------------------------------------------------------
+// A few changes take the sparse path, and nothing else is
+// rebuilt or reported
+// --------------------------------------------------------
+TEST(TransformSystemTests, OnlyRebuildsDirtyTransforms)
+{
+	std::vector<TransformReference::Transform> reference;
+	TransformSystem system;
+	TransformReference::MakeTransforms(100, false, reference, system);
+	system.Update();
+
+	system.Update();
+	EXPECT_TRUE(system.GetChanged().empty());
+
+	TransformId ids[] = { 3, 50, 51, 97, 99 };
+	for (size_t i = 0; i < 5; i++)
+	{
+		reference[ids[i]].Rotation.y += 0.5f;
+		reference[ids[i]].Scale.z = 3.0f;
+		system.Rotate(ids[i], 0.0f, 0.5f, 0.0f);
+		system.SetScale(ids[i], reference[ids[i]].Scale.x, reference[ids[i]].Scale.y, 3.0f);
+	}
+	system.Update();
+
+	std::vector<TransformId> changed = system.GetChanged();
+	std::sort(changed.begin(), changed.end());
+	ASSERT_EQ(5u, changed.size());
+	for (size_t i = 0; i < 5; i++)
+		EXPECT_EQ(ids[i], changed[i]);
+	ExpectMatchesReference(reference, system);
+}
+
+// --------------------------------------------------------
+// Spreading the work across jobs gives the same matrices
+// --------------------------------------------------------
+TEST(TransformSystemTests, MatchesReferenceOnJobs)
+{
+	JobSystem jobs(4);
+
+	std::vector<TransformReference::Transform> flat;
+	TransformSystem flatSystem;
+	TransformReference::MakeTransforms(20001, false, flat, flatSystem);
+	flatSystem.Update(&jobs);
+	ExpectMatchesReference(flat, flatSystem);
+
+	std::vector<TransformReference::Transform> nested;
+	TransformSystem nestedSystem;
+	TransformReference::MakeTransforms(20001, true, nested, nestedSystem);
+	nestedSystem.Update(&jobs);
+	ExpectMatchesReference(nested, nestedSystem);
+}
+
+// --------------------------------------------------------
+// A small Assimp hierarchy, imported under an existing
+// transform.  One node is turned a quarter about Y, which
+// leaves its rotation in gimbal lock.
+// --------------------------------------------------------
+TEST(TransformSystemTests, ImportsNodeHierarchy)
+{
+	aiNode* root = MakeNode("root", aiVector3D(2, 2, 2), aiVector3D(0, 1, 0), 0.5f, aiVector3D(1, 2, 3));
+	aiNode* arm = MakeNode("arm", aiVector3D(1, 1, 1), aiVector3D(1, 0, 0), -0.7f, aiVector3D(0, 4, 0));
+	aiNode* hand = MakeNode("hand", aiVector3D(0.5f, 0.5f, 0.5f), aiVector3D(1, 1, 0), 1.1f, aiVector3D(0, 0, 2));
+	aiNode* finger = MakeNode("finger", aiVector3D(1.5f, 1, 0.75f), aiVector3D(0, 0, 1), 0.3f, aiVector3D(0.25f, 0, 0));
+	aiNode* elbow = MakeNode("elbow", aiVector3D(1, 1, 1), aiVector3D(0, 1, 0), (float)AI_MATH_HALF_PI, aiVector3D(-1, 0, 0));
+	aiNode* leg = MakeNode("leg", aiVector3D(1, 3, 1), aiVector3D(-1, 2, 1), -2.0f, aiVector3D(0, -5, 1));
+	AddChildren(root, { arm, leg });
+	AddChildren(arm, { hand, elbow });
+	AddChildren(hand, { finger });
+
+	TransformSystem system;
+	TransformId base = system.Create();
+	system.SetPosition(base, 10, 0, -5);
+	system.SetRotation(base, 0, 0.25f, 0);
+
+	TransformId imported = system.Import(root, base);
+	EXPECT_EQ(base + 1, imported);
+	ASSERT_EQ(7u, system.GetCount());
+	system.Update();
+
+	// Depth-first: root, arm, hand, finger, elbow, leg
+	TransformId next = imported;
+	ExpectImported(system, root, base, ToAiMatrix(system.GetWorldMatrix(base)), next);
+	EXPECT_EQ(system.GetCount(), next);
+
+	delete root;
+}
@@ -0,0 +1,337 @@
+#include "TransformSystem.h"
+#include "scene.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	// Below this many transforms per job, jobs cost more than they save
+	const size_t MinTransformsPerJob = 2048;
+}
+
+
+TransformSystem::TransformSystem()
+{
+	maxDepth = 0;
+}
+
+TransformSystem::~TransformSystem()
+{
+}
+
+TransformId TransformSystem::Create(TransformId parent)
+{
+	TransformId id = (TransformId)worldMatrices.size();
+
+	unsigned int depth = parent == NoParent ? 0 : depths[parent] + 1;
+	parents.push_back(parent);
+	depths.push_back(depth);
+	if (depth > maxDepth)
+		maxDepth = depth;
+
+	positionX.push_back(0); positionY.push_back(0); positionZ.push_back(0);
+	rotationX.push_back(0); rotationY.push_back(0); rotationZ.push_back(0);
+	scaleX.push_back(1); scaleY.push_back(1); scaleZ.push_back(1);
+
+	XMFLOAT4X4 identity;
+	XMStoreFloat4x4(&identity, XMMatrixIdentity());
+	localMatrices.push_back(identity);
+	worldMatrices.push_back(identity);
+
+	// Children start out with their parent's world matrix
+	dirty.push_back(0);
+	moved.push_back(0);
+	if (parent != NoParent)
+		MarkDirty(id);
+	return id;
+}
+
+void TransformSystem::Reserve(size_t count)
+{
+	positionX.reserve(count); positionY.reserve(count); positionZ.reserve(count);
+	rotationX.reserve(count); rotationY.reserve(count); rotationZ.reserve(count);
+	scaleX.reserve(count); scaleY.reserve(count); scaleZ.reserve(count);
+	parents.reserve(count);
+	depths.reserve(count);
+	localMatrices.reserve(count);
+	worldMatrices.reserve(count);
+	dirty.reserve(count);
+	moved.reserve(count);
+}
+
+// --------------------------------------------------------
+// Recursively adds a node and its children
+// --------------------------------------------------------
+TransformId TransformSystem::Import(const aiNode * root, TransformId parent)
+{
+	TransformId id = Create(parent);
+
+	// Split the node's matrix into the parts we store
+	aiVector3D scaling;
+	aiQuaternion rotation;
+	aiVector3D position;
+	root->mTransformation.Decompose(scaling, rotation, position);
+
+	// Assimp matrices are column-major, so the row-vector
+	// rotZ * rotY * rotX product is the transpose of this
+	aiMatrix3x3 r = rotation.GetMatrix();
+
+	// Y from atan2 rather than asin, which loses half its
+	// precision as the angle nears a quarter turn
+	float x, y, z;
+	float cosY = sqrtf(r.a1 * r.a1 + r.a2 * r.a2);
+	y = atan2f(r.a3, cosY);
+	if (cosY > 1e-4f)
+	{
+		x = atan2f(-r.b3, r.c3);
+		z = atan2f(-r.a2, r.a1);
+	}
+	else
+	{
+		// Gimbal lock - put all of the remaining spin on X
+		x = atan2f(r.b1 * r.a3, r.b2);
+		z = 0.0f;
+	}
+
+	SetPosition(id, position.x, position.y, position.z);
+	SetRotation(id, x, y, z);
+	SetScale(id, scaling.x, scaling.y, scaling.z);
+
+	for (unsigned int i = 0; i < root->mNumChildren; i++)
+		Import(root->mChildren[i], id);
+
+	return id;
+}
+
+void TransformSystem::Move(TransformId id, float x, float y, float z)
+{
+	positionX[id] += x; positionY[id] += y; positionZ[id] += z;
+	MarkDirty(id);
+}
+
+void TransformSystem::Rotate(TransformId id, float x, float y, float z)
+{
+	rotationX[id] += x; rotationY[id] += y; rotationZ[id] += z;
+	MarkDirty(id);
+}
+
+void TransformSystem::SetPosition(TransformId id, float x, float y, float z)
+{
+	positionX[id] = x; positionY[id] = y; positionZ[id] = z;
+	MarkDirty(id);
+}
+
+void TransformSystem::SetRotation(TransformId id, float x, float y, float z)
+{
+	rotationX[id] = x; rotationY[id] = y; rotationZ[id] = z;
+	MarkDirty(id);
+}
+
+void TransformSystem::SetScale(TransformId id, float x, float y, float z)
+{
+	scaleX[id] = x; scaleY[id] = y; scaleZ[id] = z;
+	MarkDirty(id);
+}
+
+XMFLOAT3 TransformSystem::GetPosition(TransformId id)
+{
+	return XMFLOAT3(positionX[id], positionY[id], positionZ[id]);
+}
+
+XMFLOAT3 TransformSystem::GetRotation(TransformId id)
+{
+	return XMFLOAT3(rotationX[id], rotationY[id], rotationZ[id]);
+}
+
+XMFLOAT3 TransformSystem::GetScale(TransformId id)
+{
+	return XMFLOAT3(scaleX[id], scaleY[id], scaleZ[id]);
+}
+
+void TransformSystem::MarkDirty(TransformId id)
+{
+	if (dirty[id])
+		return;
+	dirty[id] = 1;
+	dirtyList.push_back(id);
+}
+
+// --------------------------------------------------------
+// Rebuilds every transform touched since the last call,
+// then every transform below one of those
+// --------------------------------------------------------
+void TransformSystem::Update(JobSystem* jobs)
+{
+	changed.clear();
+
+	size_t dirtyCount = dirtyList.size();
+	if (dirtyCount == 0)
+		return;
+
+	// Most things moved - a straight sweep beats chasing ids
+	size_t count = worldMatrices.size();
+	const TransformId* buildIds = dirtyCount * 2 > count ? 0 : &dirtyList[0];
+	size_t buildCount = buildIds ? dirtyCount : count;
+	if (jobs && buildCount >= MinTransformsPerJob * 2)
+	{
+		jobs->Wait(jobs->ParallelFor("Build local matrices", buildCount, MinTransformsPerJob, [this, buildIds](size_t first, size_t last) {
+			BuildLocalMatrices(buildIds, first, last);
+		}));
+	}
+	else
+	{
+		BuildLocalMatrices(buildIds, 0, buildCount);
+	}
+
+	movedByDepth.resize(maxDepth + 1);
+	if (maxDepth == 0)
+	{
+		// No hierarchy at all, so only the dirty ones moved
+		movedByDepth[0].swap(dirtyList);
+	}
+	else
+	{
+		// Parents come before children, so one pass from the first
+		// dirty transform finds every transform whose parent moved
+		TransformId first = *std::min_element(dirtyList.begin(), dirtyList.end());
+		for (TransformId i = first; i < (TransformId)count; i++)
+		{
+			TransformId parent = parents[i];
+			if (dirty[i] || (parent != NoParent && moved[parent]))
+			{
+				moved[i] = 1;
+				movedByDepth[depths[i]].push_back(i);
+			}
+		}
+	}
+
+	// Each depth only reads the one above it, so everything
+	// within a depth can be done at the same time
+	for (size_t depth = 0; depth < movedByDepth.size(); depth++)
+	{
+		std::vector<TransformId>& ids = movedByDepth[depth];
+		if (ids.empty())
+			continue;
+
+		if (!jobs || ids.size() < MinTransformsPerJob * 2)
+		{
+			ComposeWorldMatrices(&ids[0], ids.size());
+			continue;
+		}
+
+		const TransformId* composeIds = &ids[0];
+		jobs->Wait(jobs->ParallelFor("Compose world matrices", ids.size(), MinTransformsPerJob, [this, composeIds](size_t first, size_t last) {
+			ComposeWorldMatrices(composeIds + first, last - first);
+		}));
+	}
+
+	// Reset the change tracking
+	for (size_t depth = 0; depth < movedByDepth.size(); depth++)
+	{
+		std::vector<TransformId>& ids = movedByDepth[depth];
+		for (size_t i = 0; i < ids.size(); i++)
+		{
+			dirty[ids[i]] = 0;
+			moved[ids[i]] = 0;
+		}
+		changed.insert(changed.end(), ids.begin(), ids.end());
+		ids.clear();
+	}
+	dirtyList.clear();
+}
+
+// --------------------------------------------------------
+// World = local * parent's world, which is parent * local
+// since both are stored transposed
+// --------------------------------------------------------
+void TransformSystem::ComposeWorldMatrices(const TransformId * ids, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		TransformId id = ids[i];
+		TransformId parent = parents[id];
+		if (parent == NoParent)
+		{
+			worldMatrices[id] = localMatrices[id];
+			continue;
+		}
+
+		XMMATRIX world = XMMatrixMultiply(
+			XMLoadFloat4x4(&worldMatrices[parent]),
+			XMLoadFloat4x4(&localMatrices[id]));
+		XMStoreFloat4x4(&worldMatrices[id], world);
+	}
+}
+
+// --------------------------------------------------------
+// Builds the local matrices of ids [first, last), four at
+// a time - null ids means transforms [first, last)
+// --------------------------------------------------------
+void TransformSystem::BuildLocalMatrices(const TransformId * ids, size_t first, size_t last)
+{
+	size_t i = first;
+	if (!ids)
+	{
+		for (; i + 4 <= last; i += 4)
+			BuildLocalMatrices((TransformId)i, (TransformId)i + 1, (TransformId)i + 2, (TransformId)i + 3);
+		for (; i < last; i++)
+			BuildLocalMatrices((TransformId)i, (TransformId)i, (TransformId)i, (TransformId)i);
+		return;
+	}
+
+	for (; i + 4 <= last; i += 4)
+		BuildLocalMatrices(ids[i], ids[i + 1], ids[i + 2], ids[i + 3]);
+	for (; i < last; i++)
+		BuildLocalMatrices(ids[i], ids[i], ids[i], ids[i]);
+}
+
+// --------------------------------------------------------
+// Builds scale * rotZ * rotY * rotX * translation for four
+// transforms at once, one per vector lane.  This is the
+// product GameEntity used to build, expanded by hand so no
+// intermediate matrices are needed.
+// --------------------------------------------------------
+void TransformSystem::BuildLocalMatrices(TransformId a, TransformId b, TransformId c, TransformId d)
+{
+	XMVECTOR sinX, cosX, sinY, cosY, sinZ, cosZ;
+	XMVectorSinCos(&sinX, &cosX, XMVectorSet(rotationX[a], rotationX[b], rotationX[c], rotationX[d]));
+	XMVectorSinCos(&sinY, &cosY, XMVectorSet(rotationY[a], rotationY[b], rotationY[c], rotationY[d]));
+	XMVectorSinCos(&sinZ, &cosZ, XMVectorSet(rotationZ[a], rotationZ[b], rotationZ[c], rotationZ[d]));
+
+	XMVECTOR sx = XMVectorSet(scaleX[a], scaleX[b], scaleX[c], scaleX[d]);
+	XMVECTOR sy = XMVectorSet(scaleY[a], scaleY[b], scaleY[c], scaleY[d]);
+	XMVECTOR sz = XMVectorSet(scaleZ[a], scaleZ[b], scaleZ[c], scaleZ[d]);
+
+	// Rows of rotZ * rotY * rotX, each scaled by its axis
+	XMVECTOR sinYsinX = sinY * sinX;
+	XMVECTOR sinYcosX = sinY * cosX;
+	XMFLOAT4A m[12];
+	XMStoreFloat4A(&m[0], cosZ * cosY * sx);
+	XMStoreFloat4A(&m[1], (sinZ * cosX + cosZ * sinYsinX) * sx);
+	XMStoreFloat4A(&m[2], (sinZ * sinX - cosZ * sinYcosX) * sx);
+	XMStoreFloat4A(&m[3], -sinZ * cosY * sy);
+	XMStoreFloat4A(&m[4], (cosZ * cosX - sinZ * sinYsinX) * sy);
+	XMStoreFloat4A(&m[5], (cosZ * sinX + sinZ * sinYcosX) * sy);
+	XMStoreFloat4A(&m[6], sinY * sz);
+	XMStoreFloat4A(&m[7], -cosY * sinX * sz);
+	XMStoreFloat4A(&m[8], cosY * cosX * sz);
+
+	// Translation is the last row
+	XMStoreFloat4A(&m[9], XMVectorSet(positionX[a], positionX[b], positionX[c], positionX[d]));
+	XMStoreFloat4A(&m[10], XMVectorSet(positionY[a], positionY[b], positionY[c], positionY[d]));
+	XMStoreFloat4A(&m[11], XMVectorSet(positionZ[a], positionZ[b], positionZ[c], positionZ[d]));
+
+	// Write out transposed for HLSL, one lane per transform
+	TransformId ids[4] = { a, b, c, d };
+	for (int lane = 0; lane < 4; lane++)
+	{
+		const float* r0 = &m[0].x + lane; const float* r1 = &m[3].x + lane; const float* r2 = &m[6].x + lane;
+		XMFLOAT4X4& local = localMatrices[ids[lane]];
+		local._11 = r0[0]; local._12 = r1[0]; local._13 = r2[0]; local._14 = (&m[9].x)[lane];
+		local._21 = r0[4]; local._22 = r1[4]; local._23 = r2[4]; local._24 = (&m[10].x)[lane];
+		local._31 = r0[8]; local._32 = r1[8]; local._33 = r2[8]; local._34 = (&m[11].x)[lane];
+		local._41 = 0;     local._42 = 0;     local._43 = 0;     local._44 = 1;
+	}
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+#include "JobSystem.h"
+
+struct aiNode;
+
+typedef unsigned int TransformId;
+
+// Parent of a transform with no parent
+const TransformId NoParent = 0xFFFFFFFF;
+
+// --------------------------------------------------------
+// Owns the position, rotation and scale of every entity
+//
+// Each component lives in its own array so Update() can
+// build four local matrices at once from plain loads.
+// Only transforms that changed since the last Update()
+// are rebuilt.
+//
+// Transforms can have a parent, which must be created
+// first - so ids are always in topological order and one
+// forward pass pushes parent changes down to children.
+// Only dirty transforms and their descendants are touched,
+// and everything at the same depth is composed in parallel
+// when a job system is given.
+//
+// World matrices are stored transposed, ready for HLSL,
+// in one contiguous array.
+// --------------------------------------------------------
+class TransformSystem
+{
+public:
+	TransformSystem();
+	~TransformSystem();
+
+	// Adds an identity transform
+	TransformId Create(TransformId parent = NoParent);
+	void Reserve(size_t count);
+
+	// Adds a transform for every node under (and including)
+	// root in depth-first order, so the root's id is returned
+	// and its descendants follow it.  The node matrices are
+	// split into position, rotation and scale.
+	TransformId Import(const aiNode* root, TransformId parent = NoParent);
+
+	void Move(TransformId id, float x, float y, float z);
+	void Rotate(TransformId id, float x, float y, float z);
+
+	void SetPosition(TransformId id, float x, float y, float z);
+	void SetRotation(TransformId id, float x, float y, float z);
+	void SetScale(TransformId id, float x, float y, float z);
+
+	DirectX::XMFLOAT3 GetPosition(TransformId id);
+	DirectX::XMFLOAT3 GetRotation(TransformId id);
+	DirectX::XMFLOAT3 GetScale(TransformId id);
+	TransformId GetParent(TransformId id) { return parents[id]; }
+
+	// Rebuilds the world matrix of every changed transform
+	// and everything below it, spread across the jobs if given
+	void Update(JobSystem* jobs = 0);
+
+	// Every transform whose world matrix the last Update() rebuilt
+	const std::vector<TransformId>& GetChanged() { return changed; }
+
+	const DirectX::XMFLOAT4X4& GetWorldMatrix(TransformId id) { return worldMatrices[id]; }
+	const DirectX::XMFLOAT4X4* GetWorldMatrices() { return worldMatrices.empty() ? 0 : &worldMatrices[0]; }
+	size_t GetCount() { return worldMatrices.size(); }
+
+private:
+	// Transform components
+	std::vector<float> positionX, positionY, positionZ;
+	std::vector<float> rotationX, rotationY, rotationZ;
+	std::vector<float> scaleX, scaleY, scaleZ;
+
+	// Hierarchy
+	std::vector<TransformId> parents;
+	std::vector<unsigned int> depths;
+	unsigned int maxDepth;
+
+	// Change tracking
+	std::vector<unsigned char> dirty;
+	std::vector<unsigned char> moved;
+	std::vector<TransformId> dirtyList;
+	std::vector<std::vector<TransformId>> movedByDepth;
+	std::vector<TransformId> changed;
+
+	std::vector<DirectX::XMFLOAT4X4> localMatrices;
+	std::vector<DirectX::XMFLOAT4X4> worldMatrices;
+
+	void MarkDirty(TransformId id);
+	void BuildLocalMatrices(const TransformId* ids, size_t first, size_t last);
+	void BuildLocalMatrices(TransformId a, TransformId b, TransformId c, TransformId d);
+	void ComposeWorldMatrices(const TransformId* ids, size_t count);
+};
@@ -46,14 +46,39 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <assimp/DefaultLogger.hpp>
 #include <assimp/scene.h>
 #include "Importer.h"
+#include "ThreadPool.h"
 
 using namespace Assimp;
 
+namespace {
+
+// ------------------------------------------------------------------------------------------------
+// Runs a step's per-mesh work for each mesh the thread pool hands out
+class MeshTask : public ThreadPool::Task
+{
+public:
+    MeshTask(BaseProcess* process, aiScene* scene)
+    : mProcess(process)
+    , mScene(scene)
+    {}
+
+    void Run(unsigned int index) {
+        mProcess->ExecuteOnMesh(mScene, index);
+    }
+
+private:
+    BaseProcess* mProcess;
+    aiScene* mScene;
+};
+
+}
+
 // ------------------------------------------------------------------------------------------------
 // Constructor to be privately used by Importer
 BaseProcess::BaseProcess()
 : shared()
 , progress()
+, threadPool()
 {
 }
 
@@ -73,6 +98,7 @@ void BaseProcess::ExecuteOnScene( Importer* pImp)
     ai_assert(progress);
 
     SetupProperties( pImp );
+    threadPool = pImp->Pimpl()->mThreadPool;
 
     // catch exceptions thrown inside the PostProcess-Step
     try
@@ -89,6 +115,30 @@ void BaseProcess::ExecuteOnScene( Importer* pImp)
         delete pImp->Pimpl()->mScene;
         pImp->Pimpl()->mScene = NULL;
     }
+
+    threadPool = NULL;
+}
+
+// ------------------------------------------------------------------------------------------------
+void BaseProcess::ExecuteOnMesh( aiScene* /*pScene*/, unsigned int /*meshIndex*/)
+{
+    // only called by steps that override it
+    ai_assert(false);
+}
+
+// ------------------------------------------------------------------------------------------------
+// Run the per-mesh work of the step, on the worker threads if there are any
+void BaseProcess::ExecuteOnMeshes( aiScene* pScene)
+{
+    if (threadPool && pScene->mNumMeshes > 1) {
+        MeshTask task(this, pScene);
+        threadPool->ForEach(pScene->mNumMeshes, task);
+        return;
+    }
+
+    for (unsigned int a = 0; a < pScene->mNumMeshes; ++a) {
+        ExecuteOnMesh(pScene, a);
+    }
 }
 
 // ------------------------------------------------------------------------------------------------
@@ -52,6 +52,7 @@ struct aiScene;
 namespace Assimp    {
 
 class Importer;
+class ThreadPool;
 
 // ---------------------------------------------------------------------------
 /** Helper class to allow post-processing steps to interact with each other.
@@ -262,6 +263,17 @@ public:
     */
     virtual void Execute( aiScene* pScene) = 0;
 
+    // -------------------------------------------------------------------
+    /** Does the per-mesh work of a step that processes each mesh on its
+    * own. Steps override this to declare that their meshes can be
+    * processed concurrently, and call ExecuteOnMeshes() from Execute().
+    * An override may only touch the given mesh, and may store results
+    * in its own per-mesh slots.
+    * @param pScene The imported data to work at.
+    * @param meshIndex Index of the mesh to process.
+    */
+    virtual void ExecuteOnMesh( aiScene* pScene, unsigned int meshIndex);
+
 
     // -------------------------------------------------------------------
     /** Assign a new SharedPostProcessInfo to the step. This object
@@ -281,11 +293,23 @@ public:
 
 protected:
 
+    // -------------------------------------------------------------------
+    /** Calls ExecuteOnMesh() once for every mesh in the scene. If the
+    * importer's #AI_CONFIG_PP_NUM_THREADS property asks for more than
+    * one thread, the meshes are spread across its worker threads.
+    * Results stored per mesh come out the same either way.
+    * @param pScene The imported data to work at.
+    */
+    void ExecuteOnMeshes( aiScene* pScene);
+
     /** See the doc of #SharedPostProcessInfo for more details */
     SharedPostProcessInfo* shared;
 
     /** Currently active progress handler */
     ProgressHandler* progress;
+
+    /** Worker threads of the importer running the step, or NULL */
+    ThreadPool* threadPool;
 };
 
 
@@ -95,9 +95,12 @@ void CalcTangentsProcess::Execute( aiScene* pScene)
 
     DefaultLogger::get()->debug("CalcTangentsProcess begin");
 
+    meshChanged.assign(pScene->mNumMeshes,0);
+    ExecuteOnMeshes(pScene);
+
     bool bHas = false;
     for ( unsigned int a = 0; a < pScene->mNumMeshes; a++ ) {
-        if(ProcessMesh( pScene->mMeshes[a],a))bHas = true;
+        if(meshChanged[a])bHas = true;
     }
 
     if ( bHas ) {
@@ -107,6 +110,13 @@ void CalcTangentsProcess::Execute( aiScene* pScene)
     }
 }
 
+// ------------------------------------------------------------------------------------------------
+// Calculates tangents and bi-tangents for one mesh of the scene
+void CalcTangentsProcess::ExecuteOnMesh( aiScene* pScene, unsigned int meshIndex)
+{
+    meshChanged[meshIndex] = ProcessMesh( pScene->mMeshes[meshIndex],meshIndex);
+}
+
 // ------------------------------------------------------------------------------------------------
 // Calculates tangents and bi-tangents for the given mesh
 bool CalcTangentsProcess::ProcessMesh( aiMesh* pMesh, unsigned int meshIndex)
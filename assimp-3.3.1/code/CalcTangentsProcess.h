@@ -45,6 +45,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define AI_CALCTANGENTSPROCESS_H_INC
 
 #include "BaseProcess.h"
+#include <vector>
 
 struct aiMesh;
 
@@ -103,11 +104,22 @@ protected:
     */
     void Execute( aiScene* pScene);
 
+public:
+    // -------------------------------------------------------------------
+    /** Runs ProcessMesh() on one mesh of the scene, for ExecuteOnMeshes().
+     * @param pScene The imported data to work at.
+     * @param meshIndex Index of the mesh to process.
+     */
+    void ExecuteOnMesh( aiScene* pScene, unsigned int meshIndex);
+
 private:
 
     /** Configuration option: maximum smoothing angle, in radians*/
     float configMaxAngle;
     unsigned int configSourceUV;
+
+    /** Whether tangents were computed for each mesh, filled by ExecuteOnMesh() */
+    std::vector<unsigned char> meshChanged;
 };
 
 } // end of namespace Assimp
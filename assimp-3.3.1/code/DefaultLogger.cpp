@@ -61,6 +61,10 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #   include <mutex>
 
 std::mutex loggerMutex;
+
+// Guards the repeated-message check and the streams while post-processing
+// steps log from several threads
+std::mutex loggerWriteMutex;
 #endif
 
 namespace Assimp    {
@@ -379,6 +383,10 @@ void DefaultLogger::WriteToStreams(const char *message, ErrorSeverity ErrorSev )
 {
     ai_assert(NULL != message);
 
+#ifndef ASSIMP_BUILD_SINGLETHREADED
+    std::lock_guard<std::mutex> lock(loggerWriteMutex);
+#endif
+
     // Check whether this is a repeated message
     if (! ::strncmp( message,lastMsg, lastLen-1))
     {
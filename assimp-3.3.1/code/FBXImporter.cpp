@@ -151,11 +151,18 @@ void FBXImporter::InternReadFile( const std::string& pFile,
     // then becomes very large, too. Assimp doesn't support
     // streaming for its output data structures so the net win with
     // streaming input data would be very low.
+    // Binary files are tokenized in place if the stream already holds
+    // them in memory, the tokens then point into the stream's data.
     std::vector<char> contents;
-    contents.resize(stream->FileSize()+1);
-    stream->Read( &*contents.begin(), 1, contents.size()-1 );
-    contents[ contents.size() - 1 ] = 0;
-    const char* const begin = &*contents.begin();
+    const char* begin = static_cast<const char*>(stream->GetContents());
+    size_t length = stream->FileSize();
+    if (!begin || length < 18 || strncmp(begin,"Kaydara FBX Binary",18)) {
+        contents.resize(stream->FileSize()+1);
+        stream->Read( &*contents.begin(), 1, contents.size()-1 );
+        contents[ contents.size() - 1 ] = 0;
+        begin = &*contents.begin();
+        length = contents.size();
+    }
 
     // broadphase tokenizing pass in which we identify the core
     // syntax elements of FBX (brackets, commas, key:value mappings)
@@ -165,7 +172,7 @@ void FBXImporter::InternReadFile( const std::string& pFile,
         bool is_binary = false;
         if (!strncmp(begin,"Kaydara FBX Binary",18)) {
             is_binary = true;
-            TokenizeBinary(tokens,begin,contents.size());
+            TokenizeBinary(tokens,begin,static_cast<unsigned int>(length));
         }
         else {
             Tokenize(tokens,begin);
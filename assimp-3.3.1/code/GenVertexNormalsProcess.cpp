@@ -91,10 +91,13 @@ void GenVertexNormalsProcess::Execute( aiScene* pScene)
     if (pScene->mFlags & AI_SCENE_FLAGS_NON_VERBOSE_FORMAT)
         throw DeadlyImportError("Post-processing order mismatch: expecting pseudo-indexed (\"verbose\") vertices here");
 
+    meshChanged.assign(pScene->mNumMeshes,0);
+    ExecuteOnMeshes(pScene);
+
     bool bHas = false;
     for( unsigned int a = 0; a < pScene->mNumMeshes; a++)
     {
-        if(GenMeshVertexNormals( pScene->mMeshes[a],a))
+        if(meshChanged[a])
             bHas = true;
     }
 
@@ -106,6 +109,13 @@ void GenVertexNormalsProcess::Execute( aiScene* pScene)
         "Normals are already there");
 }
 
+// ------------------------------------------------------------------------------------------------
+// Computes normals for one mesh of the scene
+void GenVertexNormalsProcess::ExecuteOnMesh( aiScene* pScene, unsigned int meshIndex)
+{
+    meshChanged[meshIndex] = GenMeshVertexNormals( pScene->mMeshes[meshIndex],meshIndex);
+}
+
 // ------------------------------------------------------------------------------------------------
 // Executes the post processing step on the given imported data.
 bool GenVertexNormalsProcess::GenMeshVertexNormals (aiMesh* pMesh, unsigned int meshIndex)
@@ -206,15 +216,17 @@ bool GenVertexNormalsProcess::GenMeshVertexNormals (aiMesh* pMesh, unsigned int
     // the effect, this one is the most straightforward one.
     else    {
         const float fLimit = std::cos(configMaxAngle);
-        for (unsigned int i = 0; i < pMesh->mNumVertices;++i)   {
-            // Get all vertices that share this one ...
-            vertexFinder->FindPositions( pMesh->mVertices[i] , posEpsilon, verticesFound);
 
+        // Every vertex needs its neighbours, so get all of them at once
+        std::vector<unsigned int> foundOffsets;
+        vertexFinder->FindAllPositions( posEpsilon, foundOffsets, verticesFound);
+
+        for (unsigned int i = 0; i < pMesh->mNumVertices;++i)   {
             aiVector3D vr = pMesh->mNormals[i];
             float vrlen = vr.Length();
 
             aiVector3D pcNor;
-            for (unsigned int a = 0; a < verticesFound.size(); ++a) {
+            for (unsigned int a = foundOffsets[i]; a < foundOffsets[i+1]; ++a) {
                 aiVector3D v = pMesh->mNormals[verticesFound[a]];
 
                 // check whether the angle between the two normals is not too large
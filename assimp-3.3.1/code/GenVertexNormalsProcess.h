@@ -45,6 +45,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "BaseProcess.h"
 #include <assimp/mesh.h>
+#include <vector>
 
 class GenNormalsTest;
 
@@ -101,10 +102,21 @@ public:
     */
     bool GenMeshVertexNormals (aiMesh* pcMesh, unsigned int meshIndex);
 
+    // -------------------------------------------------------------------
+    /** Runs GenMeshVertexNormals() on one mesh of the scene, for
+    *  ExecuteOnMeshes().
+    *  @param pScene The imported data to work at.
+    *  @param meshIndex Index of the mesh to process.
+    */
+    void ExecuteOnMesh( aiScene* pScene, unsigned int meshIndex);
+
 private:
 
     /** Configuration option: maximum smoothing angle, in radians*/
     float configMaxAngle;
+
+    /** Whether normals were computed for each mesh, filled by ExecuteOnMesh() */
+    std::vector<unsigned char> meshChanged;
 };
 
 } // end of namespace Assimp
@@ -76,6 +76,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "TinyFormatter.h"
 #include "Exceptional.h"
 #include "Profiler.h"
+#include "ThreadPool.h"
 #include <set>
 #include <memory>
 #include <cctype>
@@ -99,6 +100,45 @@ namespace Assimp {
 using namespace Assimp;
 using namespace Assimp::Intern;
 
+namespace {
+
+// ------------------------------------------------------------------------------------------------
+// Create a profiler if timings are logged or a profile handler wants them
+Profiler* CreateProfiler(const Importer* pImp, ProfileHandler* pHandler)
+{
+    const bool log = pImp->GetPropertyInteger(AI_CONFIG_GLOB_MEASURE_TIME,0) != 0;
+    if (!log && !pHandler) {
+        return NULL;
+    }
+    return new Profiler(pHandler,log);
+}
+
+// ------------------------------------------------------------------------------------------------
+// Create, resize or drop the worker threads to match AI_CONFIG_PP_NUM_THREADS
+void SetupThreadPool(const Importer* pImp, ImporterPimpl* pimpl)
+{
+#ifndef ASSIMP_BUILD_SINGLETHREADED
+    int numThreads = pImp->GetPropertyInteger(AI_CONFIG_PP_NUM_THREADS,1);
+    if (0 == numThreads) {
+        numThreads = static_cast<int>(std::thread::hardware_concurrency());
+    }
+#else
+    (void)pImp;
+    const int numThreads = 1;
+#endif
+
+    if (numThreads <= 1) {
+        delete pimpl->mThreadPool;
+        pimpl->mThreadPool = NULL;
+    }
+    else if (!pimpl->mThreadPool || pimpl->mThreadPool->GetNumThreads() != static_cast<unsigned int>(numThreads)) {
+        delete pimpl->mThreadPool;
+        pimpl->mThreadPool = new ThreadPool(numThreads);
+    }
+}
+
+}
+
 // ------------------------------------------------------------------------------------------------
 // Intern::AllocateFromAssimpHeap serves as abstract base class. It overrides
 // new and delete (and their array counterparts) of public API classes (e.g. Logger) to
@@ -157,6 +197,9 @@ Importer::Importer()
     pimpl->mProgressHandler = new DefaultProgressHandler();
     pimpl->mIsDefaultProgressHandler = true;
 
+    pimpl->mProfileHandler = NULL;
+    pimpl->mThreadPool = NULL;
+
     GetImporterInstanceList(pimpl->mImporter);
     GetPostProcessingStepInstanceList(pimpl->mPostProcessingSteps);
 
@@ -191,6 +234,9 @@ Importer::~Importer()
     // Delete shared post-processing data
     delete pimpl->mPPShared;
 
+    // Stop the post-processing threads
+    delete pimpl->mThreadPool;
+
     // and finally the pimpl itself
     delete pimpl;
 }
@@ -377,6 +423,20 @@ bool Importer::IsDefaultProgressHandler() const
     return pimpl->mIsDefaultProgressHandler;
 }
 
+// ------------------------------------------------------------------------------------------------
+// Supplies a custom profile handler to receive the time spent in each import stage
+void Importer::SetProfileHandler ( ProfileHandler* pHandler )
+{
+    pimpl->mProfileHandler = pHandler;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Get the currently set profile handler
+ProfileHandler* Importer::GetProfileHandler() const
+{
+    return pimpl->mProfileHandler;
+}
+
 // ------------------------------------------------------------------------------------------------
 // Validate post process step flags
 bool _ValidateFlags(unsigned int pFlags)
@@ -612,7 +672,7 @@ const aiScene* Importer::ReadFile( const char* _pFile, unsigned int pFlags)
             return NULL;
         }
 
-        std::unique_ptr<Profiler> profiler(GetPropertyInteger(AI_CONFIG_GLOB_MEASURE_TIME,0)?new Profiler():NULL);
+        std::unique_ptr<Profiler> profiler(CreateProfiler(this,pimpl->mProfileHandler));
         if (profiler) {
             profiler->BeginRegion("total");
         }
@@ -785,7 +845,9 @@ const aiScene* Importer::ApplyPostProcessing(unsigned int pFlags)
     }
 #endif // ! DEBUG
 
-    std::unique_ptr<Profiler> profiler(GetPropertyInteger(AI_CONFIG_GLOB_MEASURE_TIME,0)?new Profiler():NULL);
+    SetupThreadPool(this,pimpl);
+
+    std::unique_ptr<Profiler> profiler(CreateProfiler(this,pimpl->mProfileHandler));
     for( unsigned int a = 0; a < pimpl->mPostProcessingSteps.size(); a++)   {
 
         BaseProcess* process = pimpl->mPostProcessingSteps[a];
@@ -880,7 +942,9 @@ const aiScene* Importer::ApplyCustomizedPostProcessing( BaseProcess *rootProcess
     }
 #endif // ! DEBUG
 
-    std::unique_ptr<Profiler> profiler( GetPropertyInteger( AI_CONFIG_GLOB_MEASURE_TIME, 0 ) ? new Profiler() : NULL );
+    SetupThreadPool( this, pimpl );
+
+    std::unique_ptr<Profiler> profiler( CreateProfiler( this, pimpl->mProfileHandler ) );
 
     if ( profiler ) {
         profiler->BeginRegion( "postprocess" );
@@ -51,10 +51,12 @@ struct aiScene;
 
 namespace Assimp    {
     class ProgressHandler;
+    class ProfileHandler;
     class IOSystem;
     class BaseImporter;
     class BaseProcess;
     class SharedPostProcessInfo;
+    class ThreadPool;
 
 
 //! @cond never
@@ -89,6 +91,13 @@ public:
     ProgressHandler* mProgressHandler;
     bool mIsDefaultProgressHandler;
 
+    /** Receives the import timings, if set. Not owned by the importer. */
+    ProfileHandler* mProfileHandler;
+
+    /** Worker threads for per-mesh post-processing, NULL unless
+     *  AI_CONFIG_PP_NUM_THREADS asks for more than one thread. */
+    ThreadPool* mThreadPool;
+
     /** Format-specific importer worker objects - one for each format we can read.*/
     std::vector< BaseImporter* > mImporter;
 
@@ -43,7 +43,9 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  * <br>
  * The algorithm is roughly basing on this paper:
  * http://www.cs.princeton.edu/gfx/pubs/Sander_2007_%3ETR/tipsy.pdf
- *   .. although overdraw rduction isn't implemented yet ...
+ * .. including the overdraw reduction described there. For LRU caches the faces are
+ * ordered after Tom Forsyth's 'Linear-Speed Vertex Cache Optimisation' instead:
+ * https://tomforsyth1000.github.io/papers/fast_vert_cache_opt.html
  */
 
 
@@ -56,14 +58,289 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <assimp/scene.h>
 #include <assimp/DefaultLogger.hpp>
 #include <stdio.h>
+#include <math.h>
 #include <stack>
+#include <limits>
+#include <algorithm>
 
 using namespace Assimp;
 
+namespace {
+
+    // Marks triangles and vertices which haven't been picked
+    const unsigned int NoIndex = 0xffffffff;
+
+    // --------------------------------------------------------------------------------------------
+    // Simulates a post-transform vertex cache, either a FIFO or an LRU one
+    class VertexCacheSimulator
+    {
+    public:
+        VertexCacheSimulator( bool pLRU, unsigned int pSize, unsigned int pNumVertices)
+            : mLRU( pLRU)
+            , mSize( pSize)
+            , mStamp( pSize + 1)
+            , mStamps( pLRU ? 0 : pNumVertices, 0u)
+            , mEntries( pLRU ? pSize : 0)
+            , mNumEntries( 0)
+        {}
+
+        // Empties the cache
+        void Clear()
+        {
+            // the FIFO holds the vertices stamped in the last mSize steps
+            mStamp += mSize + 1;
+            mNumEntries = 0;
+        }
+
+        // Transforms the vertices of a triangle, returns the number of cache misses
+        unsigned int Access( const unsigned int* pTriangle)
+        {
+            unsigned int misses = 0;
+            for (unsigned int i = 0; i < 3; ++i) {
+                if (!(mLRU ? AccessLRU( pTriangle[i]) : AccessFIFO( pTriangle[i]))) {
+                    ++misses;
+                }
+            }
+            return misses;
+        }
+
+    private:
+        bool AccessFIFO( unsigned int pVertex)
+        {
+            if (mStamp - mStamps[pVertex] <= mSize) {
+                return true;
+            }
+            mStamps[pVertex] = mStamp++;
+            return false;
+        }
+
+        bool AccessLRU( unsigned int pVertex)
+        {
+            // move the vertex to the front, evicting the last one if it wasn't cached
+            unsigned int pos = 0;
+            while (pos < mNumEntries && mEntries[pos] != pVertex) {
+                ++pos;
+            }
+            const bool hit = pos < mNumEntries;
+            if (!hit) {
+                pos = std::min( mNumEntries, mSize - 1);
+                mNumEntries = std::min( mNumEntries + 1, mSize);
+            }
+            for (; pos > 0; --pos) {
+                mEntries[pos] = mEntries[pos - 1];
+            }
+            mEntries[0] = pVertex;
+            return hit;
+        }
+
+        bool mLRU;
+        unsigned int mSize;
+
+        //! FIFO: current time stamp and the time stamp of each vertex
+        unsigned int mStamp;
+        std::vector<unsigned int> mStamps;
+
+        //! LRU: the cached vertices, most recently used first
+        std::vector<unsigned int> mEntries;
+        unsigned int mNumEntries;
+    };
+
+    // --------------------------------------------------------------------------------------------
+    // Counts the cache misses of an index buffer, starting with an empty cache
+    unsigned int CountCacheMisses( bool pLRU, unsigned int pCacheSize, unsigned int pNumVertices,
+        const unsigned int* pIndices, unsigned int pNumFaces)
+    {
+        VertexCacheSimulator cache( pLRU, pCacheSize, pNumVertices);
+        unsigned int misses = 0;
+        for (unsigned int a = 0; a < pNumFaces; ++a) {
+            misses += cache.Access( pIndices + a * 3);
+        }
+        return misses;
+    }
+
+    // --------------------------------------------------------------------------------------------
+    // Estimates the overdraw of an index buffer: the number of pixels shaded per pixel covered,
+    // rendering the mesh with depth test and backface culling along the axes from both sides
+    float EstimateOverdraw( const aiVector3D* pPositions, const unsigned int* pIndices, unsigned int pNumFaces)
+    {
+        const int resolution = 256;
+        const float farDepth = std::numeric_limits<float>::max();
+
+        aiVector3D min( farDepth), max( -farDepth);
+        for (unsigned int a = 0; a < pNumFaces * 3; ++a) {
+            const aiVector3D& p = pPositions[pIndices[a]];
+            min.x = std::min( min.x, p.x); max.x = std::max( max.x, p.x);
+            min.y = std::min( min.y, p.y); max.y = std::max( max.y, p.y);
+            min.z = std::min( min.z, p.z); max.z = std::max( max.z, p.z);
+        }
+
+        std::vector<float> depthBuffer( resolution * resolution);
+        double shaded = 0.0, covered = 0.0;
+        for (unsigned int axis = 0; axis < 3; ++axis) {
+
+            // the signed area of the projected triangles is their normal along the axis
+            const unsigned int u = (axis + 1) % 3, v = (axis + 2) % 3;
+            const float extent = std::max( max[u] - min[u], max[v] - min[v]);
+            if (!(extent > 0.f)) {
+                continue;
+            }
+            const float scale = resolution / extent;
+
+            for (int side = 0; side < 2; ++side) {
+                // look down the axis from its positive end, then from the negative end
+                const float dir = side ? -1.f : 1.f;
+                std::fill( depthBuffer.begin(), depthBuffer.end(), farDepth);
+
+                for (unsigned int a = 0; a < pNumFaces; ++a) {
+                    float x[3], y[3], z[3];
+                    for (unsigned int i = 0; i < 3; ++i) {
+                        const aiVector3D& p = pPositions[pIndices[a * 3 + i]];
+                        x[i] = (p[u] - min[u]) * scale;
+                        y[i] = (p[v] - min[v]) * scale;
+                        z[i] = -dir * p[axis];
+                    }
+
+                    // skip faces pointing away from the viewer
+                    const float area = (x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0]);
+                    if (!(area * dir > 0.f)) {
+                        continue;
+                    }
+
+                    // visit the centers of all pixels in the bounding box
+                    const int x0 = std::max( 0, (int)ceil( std::min( x[0], std::min( x[1], x[2])) - 0.5f));
+                    const int x1 = std::min( resolution - 1, (int)floor( std::max( x[0], std::max( x[1], x[2])) - 0.5f));
+                    const int y0 = std::max( 0, (int)ceil( std::min( y[0], std::min( y[1], y[2])) - 0.5f));
+                    const int y1 = std::min( resolution - 1, (int)floor( std::max( y[0], std::max( y[1], y[2])) - 0.5f));
+                    for (int py = y0; py <= y1; ++py) {
+                        const float cy = py + 0.5f;
+                        for (int px = x0; px <= x1; ++px) {
+                            const float cx = px + 0.5f;
+                            const float w0 = ((x[2] - x[1]) * (cy - y[1]) - (y[2] - y[1]) * (cx - x[1])) * dir;
+                            const float w1 = ((x[0] - x[2]) * (cy - y[2]) - (y[0] - y[2]) * (cx - x[2])) * dir;
+                            const float w2 = ((x[1] - x[0]) * (cy - y[0]) - (y[1] - y[0]) * (cx - x[0])) * dir;
+                            if (w0 < 0.f || w1 < 0.f || w2 < 0.f) {
+                                continue;
+                            }
+
+                            const float depth = (w0 * z[0] + w1 * z[1] + w2 * z[2]) / (area * dir);
+                            float& stored = depthBuffer[py * resolution + px];
+                            if (depth < stored) {
+                                stored = depth;
+                                ++shaded;
+                            }
+                        }
+                    }
+                }
+
+                for (size_t i = 0; i < depthBuffer.size(); ++i) {
+                    if (depthBuffer[i] != farDepth) {
+                        ++covered;
+                    }
+                }
+            }
+        }
+        return covered ? (float)(shaded / covered) : 0.f;
+    }
+
+    // --------------------------------------------------------------------------------------------
+    // Replaces a vertex component array by the same values in a new order
+    template <typename T>
+    void ReorderArray( T*& pArray, const std::vector<unsigned int>& pOldIndices)
+    {
+        if (!pArray) {
+            return;
+        }
+        T* old = pArray;
+        pArray = new T[pOldIndices.size()];
+        for (size_t a = 0; a < pOldIndices.size(); ++a) {
+            pArray[a] = old[pOldIndices[a]];
+        }
+        delete[] old;
+    }
+
+    // --------------------------------------------------------------------------------------------
+    // Renumbers the vertices of a mesh in the order its faces use them
+    void ReorderVertices( aiMesh* pMesh)
+    {
+        std::vector<unsigned int> newIndices( pMesh->mNumVertices, NoIndex), oldIndices;
+        oldIndices.reserve( pMesh->mNumVertices);
+        for (unsigned int a = 0; a < pMesh->mNumFaces; ++a) {
+            aiFace& face = pMesh->mFaces[a];
+            for (unsigned int i = 0; i < face.mNumIndices; ++i) {
+                unsigned int& newIndex = newIndices[face.mIndices[i]];
+                if (NoIndex == newIndex) {
+                    newIndex = (unsigned int)oldIndices.size();
+                    oldIndices.push_back( face.mIndices[i]);
+                }
+                face.mIndices[i] = newIndex;
+            }
+        }
+
+        // unused vertices go behind all others
+        for (unsigned int a = 0; a < pMesh->mNumVertices; ++a) {
+            if (NoIndex == newIndices[a]) {
+                newIndices[a] = (unsigned int)oldIndices.size();
+                oldIndices.push_back( a);
+            }
+        }
+
+        ReorderArray( pMesh->mVertices, oldIndices);
+        ReorderArray( pMesh->mNormals, oldIndices);
+        ReorderArray( pMesh->mTangents, oldIndices);
+        ReorderArray( pMesh->mBitangents, oldIndices);
+        for (unsigned int a = 0; a < AI_MAX_NUMBER_OF_COLOR_SETS; ++a) {
+            ReorderArray( pMesh->mColors[a], oldIndices);
+        }
+        for (unsigned int a = 0; a < AI_MAX_NUMBER_OF_TEXTURECOORDS; ++a) {
+            ReorderArray( pMesh->mTextureCoords[a], oldIndices);
+        }
+
+        for (unsigned int m = 0; m < pMesh->mNumAnimMeshes; ++m) {
+            aiAnimMesh* anim = pMesh->mAnimMeshes[m];
+            ReorderArray( anim->mVertices, oldIndices);
+            ReorderArray( anim->mNormals, oldIndices);
+            ReorderArray( anim->mTangents, oldIndices);
+            ReorderArray( anim->mBitangents, oldIndices);
+            for (unsigned int a = 0; a < AI_MAX_NUMBER_OF_COLOR_SETS; ++a) {
+                ReorderArray( anim->mColors[a], oldIndices);
+            }
+            for (unsigned int a = 0; a < AI_MAX_NUMBER_OF_TEXTURECOORDS; ++a) {
+                ReorderArray( anim->mTextureCoords[a], oldIndices);
+            }
+        }
+
+        for (unsigned int b = 0; b < pMesh->mNumBones; ++b) {
+            aiBone* bone = pMesh->mBones[b];
+            for (unsigned int w = 0; w < bone->mNumWeights; ++w) {
+                bone->mWeights[w].mVertexId = newIndices[bone->mWeights[w].mVertexId];
+            }
+        }
+    }
+
+    // --------------------------------------------------------------------------------------------
+    // Orders clusters of faces by their sort key, the largest first
+    struct ClusterOrder
+    {
+        explicit ClusterOrder( const std::vector<float>& pKeys)
+            : mKeys( pKeys)
+        {}
+
+        bool operator()( unsigned int pCluster0, unsigned int pCluster1) const {
+            return mKeys[pCluster0] > mKeys[pCluster1];
+        }
+
+        const std::vector<float>& mKeys;
+    };
+
+} // namespace
+
 // ------------------------------------------------------------------------------------------------
 // Constructor to be privately used by Importer
 ImproveCacheLocalityProcess::ImproveCacheLocalityProcess() {
     configCacheDepth = PP_ICL_PTCACHE_SIZE;
+    configCacheModel = PP_ICL_CACHE_MODEL;
+    configOverdrawThreshold = PP_ICL_OVERDRAW_THRESHOLD;
+    configReorderVertices = false;
 }
 
 // ------------------------------------------------------------------------------------------------
@@ -86,6 +363,18 @@ void ImproveCacheLocalityProcess::SetupProperties(const Importer* pImp)
 {
     // AI_CONFIG_PP_ICL_PTCACHE_SIZE controls the target cache size for the optimizer
     configCacheDepth = pImp->GetPropertyInteger(AI_CONFIG_PP_ICL_PTCACHE_SIZE,PP_ICL_PTCACHE_SIZE);
+    configCacheModel = pImp->GetPropertyInteger(AI_CONFIG_PP_ICL_CACHE_MODEL,PP_ICL_CACHE_MODEL);
+    configOverdrawThreshold = pImp->GetPropertyFloat(AI_CONFIG_PP_ICL_OVERDRAW_THRESHOLD,PP_ICL_OVERDRAW_THRESHOLD);
+    configReorderVertices = pImp->GetPropertyBool(AI_CONFIG_PP_ICL_REORDER_VERTICES,false);
+
+    if (!configCacheDepth) {
+        DefaultLogger::get()->warn("ImproveCacheLocalityProcess: cache size must be at least 1");
+        configCacheDepth = 1;
+    }
+    if (configCacheModel != aiVertexCacheModel_FIFO && configCacheModel != aiVertexCacheModel_LRU) {
+        DefaultLogger::get()->warn("ImproveCacheLocalityProcess: unknown cache model, using FIFO");
+        configCacheModel = aiVertexCacheModel_FIFO;
+    }
 }
 
 // ------------------------------------------------------------------------------------------------
@@ -99,31 +388,46 @@ void ImproveCacheLocalityProcess::Execute( aiScene* pScene)
 
     DefaultLogger::get()->debug("ImproveCacheLocalityProcess begin");
 
+    meshACMR.assign(pScene->mNumMeshes,0.f);
+    ExecuteOnMeshes(pScene);
+
     float out = 0.f;
-    unsigned int numf = 0, numm = 0;
+    unsigned int numf = 0, numm = 0, numv = 0;
     for( unsigned int a = 0; a < pScene->mNumMeshes; a++){
-        const float res = ProcessMesh( pScene->mMeshes[a],a);
+        const float res = meshACMR[a];
         if (res) {
             numf += pScene->mMeshes[a]->mNumFaces;
+            numv += pScene->mMeshes[a]->mNumVertices;
             out  += res;
             ++numm;
         }
     }
     if (!DefaultLogger::isNullLogger()) {
-        char szBuff[128]; // should be sufficiently large in every case
-        ai_snprintf(szBuff,128,"Cache relevant are %u meshes (%u faces). Average output ACMR is %f",
-            numm,numf,out/numf);
+        if (numm) {
+            char szBuff[160]; // should be sufficiently large in every case
+            ai_snprintf(szBuff,160,"Cache relevant are %u meshes (%u faces). Average output ACMR is %f, ATVR is %f",
+                numm,numf,out/numf,out/numv);
 
-        DefaultLogger::get()->info(szBuff);
+            DefaultLogger::get()->info(szBuff);
+        }
+        else {
+            DefaultLogger::get()->info("Cache relevant are 0 meshes");
+        }
         DefaultLogger::get()->debug("ImproveCacheLocalityProcess finished. ");
     }
 }
 
+// ------------------------------------------------------------------------------------------------
+// Improves the cache coherency of one mesh of the scene
+void ImproveCacheLocalityProcess::ExecuteOnMesh( aiScene* pScene, unsigned int meshIndex)
+{
+    meshACMR[meshIndex] = ProcessMesh( pScene->mMeshes[meshIndex],meshIndex);
+}
+
 // ------------------------------------------------------------------------------------------------
 // Improves the cache coherency of a specific mesh
 float ImproveCacheLocalityProcess::ProcessMesh( aiMesh* pMesh, unsigned int meshNum)
 {
-    // TODO: rewrite this to use std::vector or boost::shared_array
     ai_assert(NULL != pMesh);
 
     // Check whether the input data is valid
@@ -141,42 +445,26 @@ float ImproveCacheLocalityProcess::ProcessMesh( aiMesh* pMesh, unsigned int mesh
         return 0.f;
     }
 
-    float fACMR = 3.f;
+    const bool lru = aiVertexCacheModel_LRU == configCacheModel;
+    const bool verbose = !DefaultLogger::isNullLogger() && DefaultLogger::get()->getLogSeverity() == Logger::VERBOSE;
+
+    // We store the indices in one large array. Since the number of triangles won't change
+    // the input faces can be reused. This is how we save thousands of redundant mini
+    // allocations for aiFace::mIndices
+    const unsigned int iIdxCnt = pMesh->mNumFaces*3;
+    std::vector<unsigned int> indices(iIdxCnt);
     const aiFace* const pcEnd = pMesh->mFaces+pMesh->mNumFaces;
+    unsigned int* piCSIter = &indices[0];
+    for (const aiFace* pcFace = pMesh->mFaces; pcFace != pcEnd;++pcFace)  {
+        *piCSIter++ = pcFace->mIndices[0];
+        *piCSIter++ = pcFace->mIndices[1];
+        *piCSIter++ = pcFace->mIndices[2];
+    }
 
     // Input ACMR is for logging purposes only
+    float fACMR = 3.f, fOverdraw = 0.f;
     if (!DefaultLogger::isNullLogger())     {
-
-        unsigned int* piFIFOStack = new unsigned int[configCacheDepth];
-        memset(piFIFOStack,0xff,configCacheDepth*sizeof(unsigned int));
-        unsigned int* piCur = piFIFOStack;
-        const unsigned int* const piCurEnd = piFIFOStack + configCacheDepth;
-
-        // count the number of cache misses
-        unsigned int iCacheMisses = 0;
-        for (const aiFace* pcFace = pMesh->mFaces;pcFace != pcEnd;++pcFace) {
-
-            for (unsigned int qq = 0; qq < 3;++qq) {
-                bool bInCache = false;
-
-                for (unsigned int* pp = piFIFOStack;pp < piCurEnd;++pp) {
-                    if (*pp == pcFace->mIndices[qq])    {
-                        // the vertex is in cache
-                        bInCache = true;
-                        break;
-                    }
-                }
-                if (!bInCache)  {
-                    ++iCacheMisses;
-                    if (piCurEnd == piCur) {
-                        piCur = piFIFOStack;
-                    }
-                    *piCur++ = pcFace->mIndices[qq];
-                }
-            }
-        }
-        delete[] piFIFOStack;
-        fACMR = (float)iCacheMisses / pMesh->mNumFaces;
+        fACMR = (float)CountCacheMisses(lru,configCacheDepth,pMesh->mNumVertices,&indices[0],pMesh->mNumFaces) / pMesh->mNumFaces;
         if (3.0 == fACMR)   {
             char szBuff[128]; // should be sufficiently large in every case
 
@@ -187,20 +475,68 @@ float ImproveCacheLocalityProcess::ProcessMesh( aiMesh* pMesh, unsigned int mesh
             DefaultLogger::get()->warn(szBuff);
             return 0.f;
         }
+        if (verbose) {
+            fOverdraw = EstimateOverdraw(pMesh->mVertices,&indices[0],pMesh->mNumFaces);
+        }
+    }
+
+    // reorder the faces for the vertex cache, then for overdraw
+    if (lru) {
+        ReorderForsyth(pMesh,&indices[0]);
+    }
+    else {
+        ReorderTipsify(pMesh,&indices[0]);
     }
+    if (configOverdrawThreshold >= 1.f) {
+        ReduceOverdraw(pMesh,&indices[0]);
+    }
+
+    float fACMR2 = 0.0f;
+    if (!DefaultLogger::isNullLogger()) {
+        const unsigned int iCacheMisses = CountCacheMisses(lru,configCacheDepth,pMesh->mNumVertices,&indices[0],pMesh->mNumFaces);
+        fACMR2 = (float)iCacheMisses / pMesh->mNumFaces;
 
+        // very intense verbose logging ... prepare for much text if there are many meshes
+        if (verbose) {
+            char szBuff[256]; // should be sufficiently large in every case
+
+            // ATVR is the number of vertices transformed per vertex, 1 at best
+            const float fVertsPerFace = (float)pMesh->mNumFaces / pMesh->mNumVertices;
+            ai_snprintf(szBuff,256,"Mesh %u | ACMR in: %f out: %f | ~%.1f%% | ATVR in: %f out: %f | overdraw in: %f out: %f",
+                meshNum,fACMR,fACMR2,((fACMR - fACMR2) / fACMR) * 100.f,
+                fACMR * fVertsPerFace,fACMR2 * fVertsPerFace,
+                fOverdraw,EstimateOverdraw(pMesh->mVertices,&indices[0],pMesh->mNumFaces));
+            DefaultLogger::get()->debug(szBuff);
+        }
+
+        fACMR2 *= pMesh->mNumFaces;
+    }
+    // sort the output index buffer back to the input array
+    piCSIter = &indices[0];
+    for (aiFace* pcFace = pMesh->mFaces; pcFace != pcEnd;++pcFace)  {
+        pcFace->mIndices[0] = *piCSIter++;
+        pcFace->mIndices[1] = *piCSIter++;
+        pcFace->mIndices[2] = *piCSIter++;
+    }
+
+    // renumber the vertices in the new order, for better locality of the vertex fetches
+    if (configReorderVertices) {
+        ReorderVertices(pMesh);
+    }
+
+    return fACMR2;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Reorders the faces of a mesh for a FIFO cache
+void ImproveCacheLocalityProcess::ReorderTipsify( aiMesh* pMesh, unsigned int* piIBOutput) const
+{
     // first we need to build a vertex-triangle adjacency list
     VertexTriangleAdjacency adj(pMesh->mFaces,pMesh->mNumFaces, pMesh->mNumVertices,true);
 
     // build a list to store per-vertex caching time stamps
-    unsigned int* const piCachingStamps = new unsigned int[pMesh->mNumVertices];
-    memset(piCachingStamps,0x0,pMesh->mNumVertices*sizeof(unsigned int));
+    std::vector<unsigned int> piCachingStamps(pMesh->mNumVertices,0);
 
-    // allocate an empty output index buffer. We store the output indices in one large array.
-    // Since the number of triangles won't change the input faces can be reused. This is how
-    // we save thousands of redundant mini allocations for aiFace::mIndices
-    const unsigned int iIdxCnt = pMesh->mNumFaces*3;
-    unsigned int* const piIBOutput = new unsigned int[iIdxCnt];
     unsigned int* piCSIter = piIBOutput;
 
     // allocate the flag array to hold the information
@@ -222,8 +558,7 @@ float ImproveCacheLocalityProcess::ProcessMesh( aiMesh* pMesh, unsigned int mesh
             iMaxRefTris = std::max(iMaxRefTris,*piCur);
         }
     }
-    unsigned int* piCandidates = new unsigned int[iMaxRefTris*3];
-    unsigned int iCacheMisses = 0;
+    std::vector<unsigned int> piCandidates(iMaxRefTris*3+1);
 
     // ...................................................................................
     /** PSEUDOCODE for the algorithm
@@ -262,7 +597,7 @@ float ImproveCacheLocalityProcess::ProcessMesh( aiMesh* pMesh, unsigned int mesh
 
         unsigned int icnt = piNumTriPtrNoModify[ivdx];
         unsigned int* piList = adj.GetAdjacentTriangles(ivdx);
-        unsigned int* piCurCandidate = piCandidates;
+        unsigned int* piCurCandidate = &piCandidates[0];
 
         // get all triangles in the neighborhood
         for (unsigned int tri = 0; tri < icnt;++tri)    {
@@ -294,7 +629,6 @@ float ImproveCacheLocalityProcess::ProcessMesh( aiMesh* pMesh, unsigned int mesh
                     // if the vertex is not yet in cache, set its cache count
                     if (iStampCnt-piCachingStamps[dp] > configCacheDepth) {
                         piCachingStamps[dp] = iStampCnt++;
-                        ++iCacheMisses;
                     }
                 }
                 // flag triangle as emitted
@@ -308,7 +642,7 @@ float ImproveCacheLocalityProcess::ProcessMesh( aiMesh* pMesh, unsigned int mesh
         // get next fanning vertex
         ivdx = -1;
         int max_priority = -1;
-        for (unsigned int* piCur = piCandidates;piCur != piCurCandidate;++piCur)    {
+        for (unsigned int* piCur = &piCandidates[0];piCur != piCurCandidate;++piCur)    {
             const unsigned int dp = *piCur;
 
             // must have live triangles
@@ -354,33 +688,229 @@ float ImproveCacheLocalityProcess::ProcessMesh( aiMesh* pMesh, unsigned int mesh
             }
         }
     }
-    float fACMR2 = 0.0f;
-    if (!DefaultLogger::isNullLogger()) {
-        fACMR2 = (float)iCacheMisses / pMesh->mNumFaces;
+}
 
-        // very intense verbose logging ... prepare for much text if there are many meshes
-        if ( DefaultLogger::get()->getLogSeverity() == Logger::VERBOSE) {
-            char szBuff[128]; // should be sufficiently large in every case
+// ------------------------------------------------------------------------------------------------
+// Reorders the faces of a mesh for an LRU cache
+void ImproveCacheLocalityProcess::ReorderForsyth( aiMesh* pMesh, unsigned int* piIBOutput) const
+{
+    // the scores need at least one position behind the last triangle's vertices
+    const unsigned int cacheSize = std::max(configCacheDepth,4u);
+
+    // Vertices score by their position in the cache and by the number of triangles still using
+    // them, so that lone triangles aren't left behind. The vertices of the last triangle get a
+    // fixed score, which doesn't favour using the same vertices for the next triangle.
+    std::vector<float> cacheScores(cacheSize);
+    for (unsigned int a = 0; a < cacheSize; ++a) {
+        cacheScores[a] = a < 3 ? 0.75f : powf(1.f - (a - 3) / (float)(cacheSize - 3),1.5f);
+    }
+    std::vector<float> valenceScores(32);
+    for (unsigned int a = 1; a < valenceScores.size(); ++a) {
+        valenceScores[a] = 2.f * powf((float)a,-0.5f);
+    }
 
-            ai_snprintf(szBuff,128,"Mesh %u | ACMR in: %f out: %f | ~%.1f%%",meshNum,fACMR,fACMR2,
-                ((fACMR - fACMR2) / fACMR) * 100.f);
-            DefaultLogger::get()->debug(szBuff);
+    // the triangles of each vertex, the live ones first
+    VertexTriangleAdjacency adj(pMesh->mFaces,pMesh->mNumFaces, pMesh->mNumVertices,true);
+    unsigned int* const piNumTriPtr = adj.mLiveTriangles;
+
+    std::vector<float> vertexScores(pMesh->mNumVertices);
+    for (unsigned int a = 0; a < pMesh->mNumVertices; ++a) {
+        const unsigned int live = piNumTriPtr[a];
+        vertexScores[a] = live < valenceScores.size() ? valenceScores[live] : 2.f * powf((float)live,-0.5f);
+    }
+
+    // start with the best triangle of all
+    std::vector<bool> abEmitted(pMesh->mNumFaces,false);
+    unsigned int best = NoIndex;
+    float bestScore = -1.f;
+    for (unsigned int a = 0; a < pMesh->mNumFaces; ++a) {
+        const unsigned int* idx = pMesh->mFaces[a].mIndices;
+        const float score = vertexScores[idx[0]] + vertexScores[idx[1]] + vertexScores[idx[2]];
+        if (score > bestScore) {
+            bestScore = score;
+            best = a;
         }
+    }
 
-        fACMR2 *= pMesh->mNumFaces;
+    // the cache before and after the current triangle, with room for the vertices pushed out
+    std::vector<unsigned int> cache, newCache;
+    cache.reserve(cacheSize + 3);
+    newCache.reserve(cacheSize + 3);
+
+    unsigned int iCursor = 0;
+    unsigned int* piCSIter = piIBOutput;
+    for (unsigned int n = 0; n < pMesh->mNumFaces; ++n) {
+
+        // at a dead end, simply continue with the next triangle in input order
+        if (NoIndex == best) {
+            while (abEmitted[iCursor]) {
+                ++iCursor;
+            }
+            best = iCursor;
+        }
+
+        const unsigned int* idx = pMesh->mFaces[best].mIndices;
+        abEmitted[best] = true;
+        for (unsigned int i = 0; i < 3; ++i) {
+            *piCSIter++ = idx[i];
+
+            // remove the triangle from the live ones of its vertices
+            unsigned int* piList = adj.GetAdjacentTriangles(idx[i]);
+            unsigned int& live = piNumTriPtr[idx[i]];
+            for (unsigned int t = 0; t < live; ++t) {
+                if (piList[t] == best) {
+                    std::swap(piList[t],piList[live - 1]);
+                    --live;
+                    break;
+                }
+            }
+        }
+
+        // the triangle's vertices move to the front of the cache
+        newCache.clear();
+        for (unsigned int i = 0; i < 3; ++i) {
+            if (std::find(newCache.begin(),newCache.end(),idx[i]) == newCache.end()) {
+                newCache.push_back(idx[i]);
+            }
+        }
+        for (size_t i = 0; i < cache.size(); ++i) {
+            if (cache[i] != idx[0] && cache[i] != idx[1] && cache[i] != idx[2]) {
+                newCache.push_back(cache[i]);
+            }
+        }
+
+        // update the scores of all vertices which were or are in the cache
+        for (size_t i = 0; i < newCache.size(); ++i) {
+            const unsigned int v = newCache[i];
+            const unsigned int live = piNumTriPtr[v];
+
+            float score = 0.f;
+            if (live) {
+                score = live < valenceScores.size() ? valenceScores[live] : 2.f * powf((float)live,-0.5f);
+                if (i < cacheSize) {
+                    score += cacheScores[i];
+                }
+            }
+            vertexScores[v] = score;
+        }
+
+        // and pick the next triangle among theirs
+        best = NoIndex;
+        bestScore = -1.f;
+        for (size_t i = 0; i < newCache.size(); ++i) {
+            const unsigned int v = newCache[i];
+            const unsigned int* piList = adj.GetAdjacentTriangles(v);
+            for (unsigned int t = 0; t < piNumTriPtr[v]; ++t) {
+                const unsigned int* tidx = pMesh->mFaces[piList[t]].mIndices;
+                const float score = vertexScores[tidx[0]] + vertexScores[tidx[1]] + vertexScores[tidx[2]];
+                if (score > bestScore) {
+                    bestScore = score;
+                    best = piList[t];
+                }
+            }
+        }
+
+        if (newCache.size() > cacheSize) {
+            newCache.resize(cacheSize);
+        }
+        cache.swap(newCache);
     }
-    // sort the output index buffer back to the input array
-    piCSIter = piIBOutput;
-    for (aiFace* pcFace = pMesh->mFaces; pcFace != pcEnd;++pcFace)  {
-        pcFace->mIndices[0] = *piCSIter++;
-        pcFace->mIndices[1] = *piCSIter++;
-        pcFace->mIndices[2] = *piCSIter++;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Splits the faces into clusters and sorts them to reduce overdraw
+void ImproveCacheLocalityProcess::ReduceOverdraw( const aiMesh* pMesh, unsigned int* piIndices) const
+{
+    const bool lru = aiVertexCacheModel_LRU == configCacheModel;
+    VertexCacheSimulator cache(lru,configCacheDepth,pMesh->mNumVertices);
+
+    // Clusters may start where none of the vertices of a face are in the cache, reordering them
+    // doesn't cost any cache misses
+    std::vector<unsigned int> hardClusters(1,0);
+    cache.Access(piIndices);
+    for (unsigned int a = 1; a < pMesh->mNumFaces; ++a) {
+        if (3 == cache.Access(piIndices + a * 3)) {
+            hardClusters.push_back(a);
+        }
     }
+    hardClusters.push_back(pMesh->mNumFaces);
 
-    // delete temporary storage
-    delete[] piCachingStamps;
-    delete[] piIBOutput;
-    delete[] piCandidates;
+    // Within these, clusters may start as soon as the faces since the start of the cluster are
+    // not much worse than the whole, emptying the cache again
+    std::vector<unsigned int> clusters;
+    for (size_t c = 0; c + 1 < hardClusters.size(); ++c) {
+        const unsigned int start = hardClusters[c], end = hardClusters[c + 1];
 
-    return fACMR2;
+        cache.Clear();
+        unsigned int iCacheMisses = 0;
+        for (unsigned int a = start; a < end; ++a) {
+            iCacheMisses += cache.Access(piIndices + a * 3);
+        }
+        const float fThreshold = configOverdrawThreshold * iCacheMisses / (end - start);
+
+        cache.Clear();
+        clusters.push_back(start);
+        unsigned int clusterStart = start;
+        iCacheMisses = 0;
+        for (unsigned int a = start; a + 1 < end; ++a) {
+            iCacheMisses += cache.Access(piIndices + a * 3);
+            if (iCacheMisses <= fThreshold * (a + 1 - clusterStart)) {
+                clusterStart = a + 1;
+                clusters.push_back(clusterStart);
+                iCacheMisses = 0;
+                cache.Clear();
+            }
+        }
+    }
+    clusters.push_back(pMesh->mNumFaces);
+
+    const unsigned int numClusters = (unsigned int)clusters.size() - 1;
+    if (numClusters < 2) {
+        return;
+    }
+
+    // Clusters pointing away from the center of the mesh are more likely to occlude the
+    // others, so they are sorted by their distance from the center along their normal.
+    // Centers and normals are weighted with the area of the faces.
+    std::vector<aiVector3D> centers(numClusters), normals(numClusters);
+    std::vector<float> areas(numClusters,0.f);
+    aiVector3D meshCenter;
+    float meshArea = 0.f;
+    for (unsigned int c = 0; c < numClusters; ++c) {
+        for (unsigned int a = clusters[c]; a < clusters[c + 1]; ++a) {
+            const aiVector3D& v0 = pMesh->mVertices[piIndices[a * 3]];
+            const aiVector3D& v1 = pMesh->mVertices[piIndices[a * 3 + 1]];
+            const aiVector3D& v2 = pMesh->mVertices[piIndices[a * 3 + 2]];
+
+            const aiVector3D normal = (v1 - v0) ^ (v2 - v0);
+            const float area = normal.Length();
+            centers[c] += (v0 + v1 + v2) * (area / 3.f);
+            normals[c] += normal;
+            areas[c] += area;
+        }
+        meshCenter += centers[c];
+        meshArea += areas[c];
+    }
+    if (!(meshArea > 0.f)) {
+        return;
+    }
+    meshCenter /= meshArea;
+
+    std::vector<float> keys(numClusters,0.f);
+    std::vector<unsigned int> order(numClusters);
+    for (unsigned int c = 0; c < numClusters; ++c) {
+        order[c] = c;
+        const float length = normals[c].Length();
+        if (areas[c] > 0.f && length > 0.f) {
+            keys[c] = (centers[c] / areas[c] - meshCenter) * (normals[c] / length);
+        }
+    }
+    std::stable_sort(order.begin(),order.end(),ClusterOrder(keys));
+
+    const std::vector<unsigned int> input(piIndices,piIndices + pMesh->mNumFaces * 3);
+    unsigned int* piCSIter = piIndices;
+    for (unsigned int c = 0; c < numClusters; ++c) {
+        const unsigned int start = clusters[order[c]], end = clusters[order[c] + 1];
+        piCSIter = std::copy(input.begin() + start * 3,input.begin() + end * 3,piCSIter);
+    }
 }
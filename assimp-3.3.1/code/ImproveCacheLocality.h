@@ -45,6 +45,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "BaseProcess.h"
 #include <assimp/types.h>
+#include <vector>
 
 struct aiMesh;
 
@@ -56,9 +57,14 @@ namespace Assimp
  *  cache locality. It tries to arrange all faces to fans and to render
  *  faces which share vertices directly one after the other.
  *
+ *  If configured, the faces are then grouped into clusters, which are
+ *  sorted to reduce overdraw, and finally the vertices are renumbered in
+ *  the order the faces use them. The ACMR, ATVR and overdraw of each mesh
+ *  before and after the step are logged in verbose mode.
+ *
  *  @note This step expects triagulated input data.
  */
-class ImproveCacheLocalityProcess : public BaseProcess
+class ASSIMP_API ImproveCacheLocalityProcess : public BaseProcess
 {
 public:
 
@@ -87,10 +93,55 @@ protected:
      */
     float ProcessMesh( aiMesh* pMesh, unsigned int meshNum);
 
+    // -------------------------------------------------------------------
+    /** Reorders the faces of a mesh for a FIFO cache, using 'tipsify'
+     * @param pMesh The mesh to process.
+     * @param piIBOutput Receives the new index buffer.
+     */
+    void ReorderTipsify( aiMesh* pMesh, unsigned int* piIBOutput) const;
+
+    // -------------------------------------------------------------------
+    /** Reorders the faces of a mesh for an LRU cache, using Forsyth's
+     *  vertex scores.
+     * @param pMesh The mesh to process.
+     * @param piIBOutput Receives the new index buffer.
+     */
+    void ReorderForsyth( aiMesh* pMesh, unsigned int* piIBOutput) const;
+
+    // -------------------------------------------------------------------
+    /** Splits a reordered index buffer into clusters and sorts them to
+     *  reduce overdraw.
+     * @param pMesh The mesh the index buffer belongs to.
+     * @param piIndices The index buffer to sort in place.
+     */
+    void ReduceOverdraw( const aiMesh* pMesh, unsigned int* piIndices) const;
+
+public:
+    // -------------------------------------------------------------------
+    /** Runs ProcessMesh() on one mesh of the scene, for ExecuteOnMeshes().
+     * @param pScene The imported data to work at.
+     * @param meshIndex Index of the mesh to process.
+     */
+    void ExecuteOnMesh( aiScene* pScene, unsigned int meshIndex);
+
 private:
     //! Configuration parameter: specifies the size of the cache to
     //! optimize the vertex data for.
     unsigned int configCacheDepth;
+
+    //! Configuration parameter: the cache model to optimize for,
+    //! one of the #aiVertexCacheModel values.
+    unsigned int configCacheModel;
+
+    //! Configuration parameter: the factor by which the ACMR may grow
+    //! to reduce overdraw, below 1 to skip it.
+    float configOverdrawThreshold;
+
+    //! Configuration parameter: renumber the vertices in the order of use?
+    bool configReorderVertices;
+
+    //! Output ACMR of each mesh, filled by ExecuteOnMesh()
+    std::vector<float> meshACMR;
 };
 
 } // end of namespace Assimp
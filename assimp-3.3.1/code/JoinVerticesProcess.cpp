@@ -48,11 +48,235 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "JoinVerticesProcess.h"
 #include "ProcessHelper.h"
-#include "Vertex.h"
 #include "TinyFormatter.h"
+#include "qnan.h"
 #include <stdio.h>
+#include <string.h>
 
 using namespace Assimp;
+
+namespace {
+
+    // Marks empty slots of a VertexHashTable and the end of a chain of unique vertices
+    const unsigned int NoVertex = 0xffffffff;
+
+    // --------------------------------------------------------------------------------------------
+    // Open addressing hash table of unique vertices, which keeps the hash of each entry so
+    // vertices only need to be compared if their hashes match. The caller compares them,
+    // walking the slots from First() with Next() until it reaches an empty one.
+    class VertexHashTable
+    {
+    public:
+        VertexHashTable()
+            : mSlots( 64)
+            , mCount( 0)
+        {}
+
+        unsigned int First( unsigned int pHash) const {
+            return pHash & (static_cast<unsigned int>( mSlots.size()) - 1);
+        }
+
+        unsigned int Next( unsigned int pSlot) const {
+            return (pSlot + 1) & (static_cast<unsigned int>( mSlots.size()) - 1);
+        }
+
+        bool IsEmpty( unsigned int pSlot) const {
+            return mSlots[pSlot].mValue == NoVertex;
+        }
+
+        unsigned int GetHash( unsigned int pSlot) const {
+            return mSlots[pSlot].mHash;
+        }
+
+        unsigned int GetValue( unsigned int pSlot) const {
+            return mSlots[pSlot].mValue;
+        }
+
+        void SetValue( unsigned int pSlot, unsigned int pValue) {
+            mSlots[pSlot].mValue = pValue;
+        }
+
+        // Adds an entry, which moves all entries to new slots if the table grows
+        void Insert( unsigned int pHash, unsigned int pValue)
+        {
+            // keep the table at most half full, so chains of used slots stay short
+            if( 2 * (mCount + 1) > mSlots.size()) {
+                std::vector<Slot> old( mSlots.size() * 2);
+                old.swap( mSlots);
+                for( size_t i = 0; i < old.size(); ++i) {
+                    if( old[i].mValue != NoVertex) {
+                        Place( old[i].mHash, old[i].mValue);
+                    }
+                }
+            }
+            Place( pHash, pValue);
+            ++mCount;
+        }
+
+    private:
+        void Place( unsigned int pHash, unsigned int pValue)
+        {
+            unsigned int slot = First( pHash);
+            while( !IsEmpty( slot)) {
+                slot = Next( slot);
+            }
+            mSlots[slot].mHash = pHash;
+            mSlots[slot].mValue = pValue;
+        }
+
+        struct Slot
+        {
+            Slot() : mHash( 0), mValue( NoVertex) {}
+
+            unsigned int mHash;
+            unsigned int mValue;
+        };
+
+        std::vector<Slot> mSlots;
+        size_t mCount;
+    };
+
+    // --------------------------------------------------------------------------------------------
+    // Mixes the bit patterns of some floats into a hash, FNV-1a style one 32 bit word at a time
+    inline unsigned int HashFloats( unsigned int pHash, const float* pValues, unsigned int pCount)
+    {
+        for( unsigned int i = 0; i < pCount; ++i) {
+            unsigned int bits;
+            ::memcpy( &bits, &pValues[i], sizeof(bits));
+            pHash = (pHash ^ bits) * 16777619u;
+        }
+        return pHash;
+    }
+
+    // --------------------------------------------------------------------------------------------
+    // Spreads all bits of a hash over its lowest bits, which pick the slot
+    inline unsigned int FinishHash( unsigned int pHash)
+    {
+        pHash ^= pHash >> 16;
+        pHash *= 0x85ebca6bu;
+        pHash ^= pHash >> 13;
+        pHash *= 0xc2b2ae35u;
+        pHash ^= pHash >> 16;
+        return pHash;
+    }
+
+    // --------------------------------------------------------------------------------------------
+    // All components of the vertices of a mesh, as arrays of floats with a fixed number of
+    // floats per vertex. The position comes first.
+    class VertexComponents
+    {
+    public:
+        explicit VertexComponents( const aiMesh* pMesh)
+            : mNum( 0)
+        {
+            Add( reinterpret_cast<const float*>( pMesh->mVertices), 3);
+            if( pMesh->HasNormals()) {
+                Add( reinterpret_cast<const float*>( pMesh->mNormals), 3);
+            }
+            if( pMesh->HasTangentsAndBitangents()) {
+                Add( reinterpret_cast<const float*>( pMesh->mTangents), 3);
+                Add( reinterpret_cast<const float*>( pMesh->mBitangents), 3);
+            }
+            for( unsigned int i = 0; pMesh->HasTextureCoords( i); ++i) {
+                Add( reinterpret_cast<const float*>( pMesh->mTextureCoords[i]), 3);
+            }
+            for( unsigned int i = 0; pMesh->HasVertexColors( i); ++i) {
+                Add( reinterpret_cast<const float*>( pMesh->mColors[i]), 4);
+            }
+        }
+
+        // Hash of the bit patterns of all components of a vertex
+        unsigned int Hash( unsigned int pVertex) const
+        {
+            unsigned int hash = 2166136261u;
+            for( unsigned int c = 0; c < mNum; ++c) {
+                hash = HashFloats( hash, mArrays[c] + pVertex * mSizes[c], mSizes[c]);
+            }
+            return FinishHash( hash);
+        }
+
+        // Hash of the position of a vertex, which is the same for positions comparing equal
+        unsigned int HashPosition( unsigned int pVertex) const
+        {
+            const float* pos = mArrays[0] + pVertex * 3;
+
+            // adding zero turns -0 into +0
+            const float values[3] = { pos[0] + 0.f, pos[1] + 0.f, pos[2] + 0.f };
+            return FinishHash( HashFloats( 2166136261u, values, 3));
+        }
+
+        // Checks whether all components of two vertices have the same bit patterns
+        bool AreIdentical( unsigned int pVertex0, unsigned int pVertex1) const
+        {
+            for( unsigned int c = 0; c < mNum; ++c) {
+                if( ::memcmp( mArrays[c] + pVertex0 * mSizes[c], mArrays[c] + pVertex1 * mSizes[c],
+                    mSizes[c] * sizeof(float))) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // Checks whether two vertices have the same position
+        bool HaveSamePosition( unsigned int pVertex0, unsigned int pVertex1) const
+        {
+            const float* pos0 = mArrays[0] + pVertex0 * 3;
+            const float* pos1 = mArrays[0] + pVertex1 * 3;
+            return pos0[0] == pos1[0] && pos0[1] == pos1[1] && pos0[2] == pos1[2];
+        }
+
+        // Checks whether all components but the position differ by no more than an epsilon.
+        // The squared differences are summed up in the same order as by aiVector3D::SquareLength()
+        // and GetColorDifference().
+        bool AreSimilar( unsigned int pVertex0, unsigned int pVertex1, float pSquareEpsilon) const
+        {
+            for( unsigned int c = 1; c < mNum; ++c) {
+                const float* v0 = mArrays[c] + pVertex0 * mSizes[c];
+                const float* v1 = mArrays[c] + pVertex1 * mSizes[c];
+
+                float squareDiff = 0.f;
+                for( unsigned int i = 0; i < mSizes[c]; ++i) {
+                    const float diff = v0[i] - v1[i];
+                    squareDiff += diff * diff;
+                }
+                if( squareDiff > pSquareEpsilon) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+    private:
+        void Add( const float* pArray, unsigned int pSize)
+        {
+            mArrays[mNum] = pArray;
+            mSizes[mNum] = pSize;
+            ++mNum;
+        }
+
+        // position, normal, tangent, bitangent and all texture coordinates and colors
+        const float* mArrays[4 + AI_MAX_NUMBER_OF_TEXTURECOORDS + AI_MAX_NUMBER_OF_COLOR_SETS];
+        unsigned int mSizes[4 + AI_MAX_NUMBER_OF_TEXTURECOORDS + AI_MAX_NUMBER_OF_COLOR_SETS];
+        unsigned int mNum;
+    };
+
+    // --------------------------------------------------------------------------------------------
+    // Replaces a vertex component array by the values of the unique vertices
+    template <typename T>
+    void KeepUniqueVertices( T*& pArray, const std::vector<unsigned int>& pUniqueVertices)
+    {
+        if( !pArray) {
+            return;
+        }
+        T* old = pArray;
+        pArray = new T[pUniqueVertices.size()];
+        for( size_t a = 0; a < pUniqueVertices.size(); a++) {
+            pArray[a] = old[pUniqueVertices[a]];
+        }
+        delete [] old;
+    }
+
+} // namespace
 // ------------------------------------------------------------------------------------------------
 // Constructor to be privately used by Importer
 JoinVerticesProcess::JoinVerticesProcess()
@@ -88,9 +312,12 @@ void JoinVerticesProcess::Execute( aiScene* pScene)
     }
 
     // execute the step
+    meshVertices.assign(pScene->mNumMeshes,0);
+    ExecuteOnMeshes(pScene);
+
     int iNumVertices = 0;
     for( unsigned int a = 0; a < pScene->mNumMeshes; a++)
-        iNumVertices += ProcessMesh( pScene->mMeshes[a],a);
+        iNumVertices += meshVertices[a];
 
     // if logging is active, print detailed statistics
     if (!DefaultLogger::isNullLogger())
@@ -112,6 +339,13 @@ void JoinVerticesProcess::Execute( aiScene* pScene)
     pScene->mFlags |= AI_SCENE_FLAGS_NON_VERBOSE_FORMAT;
 }
 
+// ------------------------------------------------------------------------------------------------
+// Unites identical vertices in one mesh of the scene
+void JoinVerticesProcess::ExecuteOnMesh( aiScene* pScene, unsigned int meshIndex)
+{
+    meshVertices[meshIndex] = ProcessMesh( pScene->mMeshes[meshIndex],meshIndex);
+}
+
 // ------------------------------------------------------------------------------------------------
 // Unites identical vertices in the given mesh
 int JoinVerticesProcess::ProcessMesh( aiMesh* pMesh, unsigned int meshIndex)
@@ -124,8 +358,8 @@ int JoinVerticesProcess::ProcessMesh( aiMesh* pMesh, unsigned int meshIndex)
         return 0;
     }
 
-    // We'll never have more vertices afterwards.
-    std::vector<Vertex> uniqueVertices;
+    // For each unique vertex the vertex it was taken from. We'll never have more vertices afterwards.
+    std::vector<unsigned int> uniqueVertices;
     uniqueVertices.reserve( pMesh->mNumVertices);
 
     // For each vertex the index of the vertex it was replaced by.
@@ -136,138 +370,83 @@ int JoinVerticesProcess::ProcessMesh( aiMesh* pMesh, unsigned int meshIndex)
     static_assert(AI_MAX_VERTICES == 0x7fffffff, "AI_MAX_VERTICES == 0x7fffffff");
     std::vector<unsigned int> replaceIndex( pMesh->mNumVertices, 0xffffffff);
 
-    // A little helper to find locally close vertices faster.
-    // Try to reuse the lookup table from the last step.
+    // Vertices are joined if they have the same position, and all other components differ by
+    // no more than an epsilon.
     const static float epsilon = 1e-5f;
-    // float posEpsilonSqr;
-    SpatialSort* vertexFinder = NULL;
-    SpatialSort _vertexFinder;
-
-    typedef std::pair<SpatialSort,float> SpatPair;
-    if (shared) {
-        std::vector<SpatPair >* avf;
-        shared->GetProperty(AI_SPP_SPATIAL_SORT,avf);
-        if (avf)    {
-            SpatPair& blubb = (*avf)[meshIndex];
-            vertexFinder  = &blubb.first;
-            // posEpsilonSqr = blubb.second;
-        }
-    }
-    if (!vertexFinder)  {
-        // bad, need to compute it.
-        _vertexFinder.Fill(pMesh->mVertices, pMesh->mNumVertices, sizeof( aiVector3D));
-        vertexFinder = &_vertexFinder;
-        // posEpsilonSqr = ComputePositionEpsilon(pMesh);
-    }
 
     // Squared because we check against squared length of the vector difference
     static const float squareEpsilon = epsilon * epsilon;
 
-    // Again, better waste some bytes than a realloc ...
-    std::vector<unsigned int> verticesFound;
-    verticesFound.reserve(10);
-
-    // Run an optimized code path if we don't have multiple UVs or vertex colors.
-    // This should yield false in more than 99% of all imports ...
-    const bool complex = ( pMesh->GetNumColorChannels() > 0 || pMesh->GetNumUVChannels() > 1);
+    // Usually joined vertices are copies of each other, so the unique vertices are hashed with all
+    // their components first. Only if a vertex has no copy among them, it is compared with an
+    // epsilon to the unique vertices at its position, which are chained from the newest to the
+    // oldest one and hashed by the position.
+    const VertexComponents components( pMesh);
+    VertexHashTable identical, samePosition;
+    std::vector<unsigned int> nextAtPosition;
+    nextAtPosition.reserve( pMesh->mNumVertices);
 
     // Now check each vertex if it brings something new to the table
     for( unsigned int a = 0; a < pMesh->mNumVertices; a++)  {
-        // collect the vertex data
-        Vertex v(pMesh,a);
-
-        // collect all vertices that are close enough to the given position
-        vertexFinder->FindIdenticalPositions( v.position, verticesFound);
-        unsigned int matchIndex = 0xffffffff;
-
-        // check all unique vertices close to the position if this vertex is already present among them
-        for( unsigned int b = 0; b < verticesFound.size(); b++) {
-
-            const unsigned int vidx = verticesFound[b];
-            const unsigned int uidx = replaceIndex[ vidx];
-            if( uidx & 0x80000000)
-                continue;
-
-            const Vertex& uv = uniqueVertices[ uidx];
-            // Position mismatch is impossible - the vertex finder already discarded all non-matching positions
-
-            // We just test the other attributes even if they're not present in the mesh.
-            // In this case they're initialized to 0 so the comparison succeeds.
-            // By this method the non-present attributes are effectively ignored in the comparison.
-            if( (uv.normal - v.normal).SquareLength() > squareEpsilon)
-                continue;
-            if( (uv.texcoords[0] - v.texcoords[0]).SquareLength() > squareEpsilon)
-                continue;
-            if( (uv.tangent - v.tangent).SquareLength() > squareEpsilon)
-                continue;
-            if( (uv.bitangent - v.bitangent).SquareLength() > squareEpsilon)
-                continue;
-
-            // Usually we won't have vertex colors or multiple UVs, so we can skip from here
-            // Actually this increases runtime performance slightly, at least if branch
-            // prediction is on our side.
-            if (complex){
-                // manually unrolled because continue wouldn't work as desired in an inner loop,
-                // also because some compilers seem to fail the task. Colors and UV coords
-                // are interleaved since the higher entries are most likely to be
-                // zero and thus useless. By interleaving the arrays, vertices are,
-                // on average, rejected earlier.
-
-                if( (uv.texcoords[1] - v.texcoords[1]).SquareLength() > squareEpsilon)
-                    continue;
-                if( GetColorDifference( uv.colors[0], v.colors[0]) > squareEpsilon)
-                    continue;
-
-                if( (uv.texcoords[2] - v.texcoords[2]).SquareLength() > squareEpsilon)
-                    continue;
-                if( GetColorDifference( uv.colors[1], v.colors[1]) > squareEpsilon)
-                    continue;
-
-                if( (uv.texcoords[3] - v.texcoords[3]).SquareLength() > squareEpsilon)
-                    continue;
-                if( GetColorDifference( uv.colors[2], v.colors[2]) > squareEpsilon)
-                    continue;
-
-                if( (uv.texcoords[4] - v.texcoords[4]).SquareLength() > squareEpsilon)
-                    continue;
-                if( GetColorDifference( uv.colors[3], v.colors[3]) > squareEpsilon)
-                    continue;
-
-                if( (uv.texcoords[5] - v.texcoords[5]).SquareLength() > squareEpsilon)
-                    continue;
-                if( GetColorDifference( uv.colors[4], v.colors[4]) > squareEpsilon)
-                    continue;
-
-                if( (uv.texcoords[6] - v.texcoords[6]).SquareLength() > squareEpsilon)
-                    continue;
-                if( GetColorDifference( uv.colors[5], v.colors[5]) > squareEpsilon)
-                    continue;
-
-                if( (uv.texcoords[7] - v.texcoords[7]).SquareLength() > squareEpsilon)
-                    continue;
-                if( GetColorDifference( uv.colors[6], v.colors[6]) > squareEpsilon)
-                    continue;
-
-                if( GetColorDifference( uv.colors[7], v.colors[7]) > squareEpsilon)
-                    continue;
+        // NaNs and infinities are never at the same position as anything, not even themselves
+        const aiVector3D& pos = pMesh->mVertices[a];
+        const bool valid = !is_special_float( pos.x) && !is_special_float( pos.y) && !is_special_float( pos.z);
+
+        unsigned int matchIndex = NoVertex, hash = 0, positionHash = 0, positionSlot = 0;
+        bool havePosition = false;
+        if( valid) {
+            hash = components.Hash( a);
+            for( unsigned int slot = identical.First( hash); !identical.IsEmpty( slot); slot = identical.Next( slot)) {
+                if( identical.GetHash( slot) == hash && components.AreIdentical( uniqueVertices[identical.GetValue( slot)], a)) {
+                    matchIndex = identical.GetValue( slot);
+                    break;
+                }
             }
+        }
 
-            // we're still here -> this vertex perfectly matches our given vertex
-            matchIndex = uidx;
-            break;
+        if( valid && matchIndex == NoVertex) {
+            positionHash = components.HashPosition( a);
+            for( unsigned int slot = samePosition.First( positionHash); !samePosition.IsEmpty( slot); slot = samePosition.Next( slot)) {
+                if( samePosition.GetHash( slot) == positionHash && components.HaveSamePosition( uniqueVertices[samePosition.GetValue( slot)], a)) {
+                    positionSlot = slot;
+                    havePosition = true;
+                    break;
+                }
+            }
+
+            // the oldest unique vertex that is close enough wins
+            if( havePosition) {
+                for( unsigned int u = samePosition.GetValue( positionSlot); u != NoVertex; u = nextAtPosition[u]) {
+                    if( components.AreSimilar( uniqueVertices[u], a, squareEpsilon)) {
+                        matchIndex = u;
+                    }
+                }
+            }
         }
 
         // found a replacement vertex among the uniques?
-        if( matchIndex != 0xffffffff)
+        if( matchIndex != NoVertex)
         {
             // store where to found the matching unique vertex
             replaceIndex[a] = matchIndex | 0x80000000;
+            continue;
         }
-        else
-        {
-            // no unique vertex matches it up to now -> so add it
-            replaceIndex[a] = (unsigned int)uniqueVertices.size();
-            uniqueVertices.push_back( v);
+
+        // no unique vertex matches it up to now -> so add it
+        const unsigned int uniqueIndex = (unsigned int)uniqueVertices.size();
+        replaceIndex[a] = uniqueIndex;
+        uniqueVertices.push_back( a);
+        nextAtPosition.push_back( NoVertex);
+
+        if( valid) {
+            identical.Insert( hash, uniqueIndex);
+            if( havePosition) {
+                nextAtPosition[uniqueIndex] = samePosition.GetValue( positionSlot);
+                samePosition.SetValue( positionSlot, uniqueIndex);
+            }
+            else {
+                samePosition.Insert( positionHash, uniqueIndex);
+            }
         }
     }
 
@@ -288,62 +467,15 @@ int JoinVerticesProcess::ProcessMesh( aiMesh* pMesh, unsigned int meshIndex)
     // replace vertex data with the unique data sets
     pMesh->mNumVertices = (unsigned int)uniqueVertices.size();
 
-    // ----------------------------------------------------------------------------
-    // NOTE - we're *not* calling Vertex::SortBack() because it would check for
-    // presence of every single vertex component once PER VERTEX. And our CPU
-    // dislikes branches, even if they're easily predictable.
-    // ----------------------------------------------------------------------------
-
-    // Position
-    delete [] pMesh->mVertices;
-    pMesh->mVertices = new aiVector3D[pMesh->mNumVertices];
-    for( unsigned int a = 0; a < pMesh->mNumVertices; a++)
-        pMesh->mVertices[a] = uniqueVertices[a].position;
-
-    // Normals, if present
-    if( pMesh->mNormals)
-    {
-        delete [] pMesh->mNormals;
-        pMesh->mNormals = new aiVector3D[pMesh->mNumVertices];
-        for( unsigned int a = 0; a < pMesh->mNumVertices; a++) {
-            pMesh->mNormals[a] = uniqueVertices[a].normal;
-        }
+    KeepUniqueVertices( pMesh->mVertices, uniqueVertices);
+    KeepUniqueVertices( pMesh->mNormals, uniqueVertices);
+    KeepUniqueVertices( pMesh->mTangents, uniqueVertices);
+    KeepUniqueVertices( pMesh->mBitangents, uniqueVertices);
+    for( unsigned int a = 0; pMesh->HasVertexColors(a); a++) {
+        KeepUniqueVertices( pMesh->mColors[a], uniqueVertices);
     }
-    // Tangents, if present
-    if( pMesh->mTangents)
-    {
-        delete [] pMesh->mTangents;
-        pMesh->mTangents = new aiVector3D[pMesh->mNumVertices];
-        for( unsigned int a = 0; a < pMesh->mNumVertices; a++) {
-            pMesh->mTangents[a] = uniqueVertices[a].tangent;
-        }
-    }
-    // Bitangents as well
-    if( pMesh->mBitangents)
-    {
-        delete [] pMesh->mBitangents;
-        pMesh->mBitangents = new aiVector3D[pMesh->mNumVertices];
-        for( unsigned int a = 0; a < pMesh->mNumVertices; a++) {
-            pMesh->mBitangents[a] = uniqueVertices[a].bitangent;
-        }
-    }
-    // Vertex colors
-    for( unsigned int a = 0; pMesh->HasVertexColors(a); a++)
-    {
-        delete [] pMesh->mColors[a];
-        pMesh->mColors[a] = new aiColor4D[pMesh->mNumVertices];
-        for( unsigned int b = 0; b < pMesh->mNumVertices; b++) {
-            pMesh->mColors[a][b] = uniqueVertices[b].colors[a];
-        }
-    }
-    // Texture coords
-    for( unsigned int a = 0; pMesh->HasTextureCoords(a); a++)
-    {
-        delete [] pMesh->mTextureCoords[a];
-        pMesh->mTextureCoords[a] = new aiVector3D[pMesh->mNumVertices];
-        for( unsigned int b = 0; b < pMesh->mNumVertices; b++) {
-            pMesh->mTextureCoords[a][b] = uniqueVertices[b].texcoords[a];
-        }
+    for( unsigned int a = 0; pMesh->HasTextureCoords(a); a++) {
+        KeepUniqueVertices( pMesh->mTextureCoords[a], uniqueVertices);
     }
 
     // adjust the indices in all faces
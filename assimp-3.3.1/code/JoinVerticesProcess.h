@@ -45,6 +45,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "BaseProcess.h"
 #include <assimp/types.h>
+#include <vector>
 
 struct aiMesh;
 
@@ -58,6 +59,10 @@ namespace Assimp
  * times. The JoinVerticesProcess finds these identical vertices and
  * erases all but one of the copies. This usually reduces the number of vertices
  * in a mesh by a serious amount and is the standard form to render a mesh.
+ *
+ * Vertices are looked up in hash tables, first by all of their components and
+ * then, if there's no exact copy, by their position only. Vertices at the same
+ * position are joined if their other components differ by less than an epsilon.
  */
 class ASSIMP_API JoinVerticesProcess : public BaseProcess
 {
@@ -90,7 +95,16 @@ public:
      */
     int ProcessMesh( aiMesh* pMesh, unsigned int meshIndex);
 
+    // -------------------------------------------------------------------
+    /** Runs ProcessMesh() on one mesh of the scene, for ExecuteOnMeshes().
+     * @param pScene The imported data to work at.
+     * @param meshIndex Index of the mesh to process.
+     */
+    void ExecuteOnMesh( aiScene* pScene, unsigned int meshIndex);
+
 private:
+    /** Vertices left in each mesh, filled by ExecuteOnMesh() */
+    std::vector<int> meshVertices;
 };
 
 } // end of namespace Assimp
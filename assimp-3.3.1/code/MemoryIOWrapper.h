@@ -135,6 +135,12 @@ public:
         ai_assert(false); // won't be needed
     }
 
+    // -------------------------------------------------------------------
+    // The buffer itself
+    const void* GetContents() const {
+        return buffer;
+    }
+
 private:
     const uint8_t* buffer;
     size_t length,pos;
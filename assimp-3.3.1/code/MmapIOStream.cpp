@@ -0,0 +1,202 @@
+/*
+Open Asset Import Library (assimp)
+----------------------------------------------------------------------
+
+Copyright (c) 2006-2016, assimp team
+All rights reserved.
+
+Redistribution and use of this software in source and binary forms,
+with or without modification, are permitted provided that the
+following conditions are met:
+
+* Redistributions of source code must retain the above
+  copyright notice, this list of conditions and the
+  following disclaimer.
+
+* Redistributions in binary form must reproduce the above
+  copyright notice, this list of conditions and the
+  following disclaimer in the documentation and/or other
+  materials provided with the distribution.
+
+* Neither the name of the assimp team, nor the names of its
+  contributors may be used to endorse or promote products
+  derived from this software without specific prior
+  written permission of the assimp team.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------
+*/
+
+/** @file  MmapIOStream.cpp
+ *  @brief Memory mapped file input for #MmapIOSystem
+ */
+
+#include <assimp/ai_assert.h>
+#include "MmapIOStream.h"
+#include <stdint.h>
+#include <string.h>
+
+#ifdef _WIN32
+#   include <windows.h>
+#else
+#   include <sys/types.h>
+#   include <sys/stat.h>
+#   include <sys/mman.h>
+#   include <fcntl.h>
+#   include <unistd.h>
+#endif
+
+using namespace Assimp;
+
+// ----------------------------------------------------------------------------------
+// Maps the whole file read-only. Only regular, non-empty files that fit into the
+// address space can be mapped.
+MmapIOStream* MmapIOStream::Map(const char* pFile)
+{
+    ai_assert(NULL != pFile);
+
+#ifdef _WIN32
+    HANDLE file = ::CreateFileA(pFile, GENERIC_READ, FILE_SHARE_READ, NULL,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (INVALID_HANDLE_VALUE == file) {
+        return NULL;
+    }
+
+    LARGE_INTEGER size;
+    if (!::GetFileSizeEx(file, &size) || size.QuadPart <= 0 ||
+        static_cast<unsigned long long>(size.QuadPart) > SIZE_MAX) {
+        ::CloseHandle(file);
+        return NULL;
+    }
+
+    // the view keeps the mapping, and the mapping the file, alive - so
+    // both handles can be closed right away
+    HANDLE mapping = ::CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    ::CloseHandle(file);
+    if (NULL == mapping) {
+        return NULL;
+    }
+
+    void* data = ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    ::CloseHandle(mapping);
+    if (NULL == data) {
+        return NULL;
+    }
+
+    return new MmapIOStream(static_cast<const char*>(data), static_cast<size_t>(size.QuadPart));
+#else
+    const int file = ::open(pFile, O_RDONLY);
+    if (-1 == file) {
+        return NULL;
+    }
+
+    struct stat fileStat;
+    if (0 != ::fstat(file, &fileStat) || !S_ISREG(fileStat.st_mode) || fileStat.st_size <= 0 ||
+        static_cast<unsigned long long>(fileStat.st_size) > SIZE_MAX) {
+        ::close(file);
+        return NULL;
+    }
+
+    // the mapping keeps the file alive, the descriptor isn't needed anymore
+    const size_t size = static_cast<size_t>(fileStat.st_size);
+    void* data = ::mmap(NULL, size, PROT_READ, MAP_PRIVATE, file, 0);
+    ::close(file);
+    if (MAP_FAILED == data) {
+        return NULL;
+    }
+
+    return new MmapIOStream(static_cast<const char*>(data), size);
+#endif
+}
+
+// ----------------------------------------------------------------------------------
+MmapIOStream::~MmapIOStream()
+{
+#ifdef _WIN32
+    ::UnmapViewOfFile(mData);
+#else
+    ::munmap(const_cast<char*>(mData), mSize);
+#endif
+}
+
+// ----------------------------------------------------------------------------------
+size_t MmapIOStream::Read(void* pvBuffer,
+    size_t pSize,
+    size_t pCount)
+{
+    ai_assert(NULL != pvBuffer && 0 != pSize && 0 != pCount);
+
+    const size_t available = (mSize - mPos) / pSize;
+    if (pCount > available) {
+        pCount = available;
+    }
+
+    ::memcpy(pvBuffer, mData + mPos, pSize * pCount);
+    mPos += pSize * pCount;
+    return pCount;
+}
+
+// ----------------------------------------------------------------------------------
+size_t MmapIOStream::Write(const void* /*pvBuffer*/,
+    size_t /*pSize*/,
+    size_t /*pCount*/)
+{
+    return 0;
+}
+
+// ----------------------------------------------------------------------------------
+aiReturn MmapIOStream::Seek(size_t pOffset,
+     aiOrigin pOrigin)
+{
+    // same as fseek(), negative offsets wrap around
+    size_t target = pOffset;
+    if (aiOrigin_CUR == pOrigin) {
+        target += mPos;
+    }
+    else if (aiOrigin_END == pOrigin) {
+        target += mSize;
+    }
+
+    if (target > mSize) {
+        return AI_FAILURE;
+    }
+    mPos = target;
+    return AI_SUCCESS;
+}
+
+// ----------------------------------------------------------------------------------
+size_t MmapIOStream::Tell() const
+{
+    return mPos;
+}
+
+// ----------------------------------------------------------------------------------
+size_t MmapIOStream::FileSize() const
+{
+    return mSize;
+}
+
+// ----------------------------------------------------------------------------------
+void MmapIOStream::Flush()
+{
+    // nothing to do here
+}
+
+// ----------------------------------------------------------------------------------
+const void* MmapIOStream::GetContents() const
+{
+    return mData;
+}
+
+// ----------------------------------------------------------------------------------
@@ -0,0 +1,128 @@
+/*
+Open Asset Import Library (assimp)
+----------------------------------------------------------------------
+
+Copyright (c) 2006-2016, assimp team
+All rights reserved.
+
+Redistribution and use of this software in source and binary forms,
+with or without modification, are permitted provided that the
+following conditions are met:
+
+* Redistributions of source code must retain the above
+  copyright notice, this list of conditions and the
+  following disclaimer.
+
+* Redistributions in binary form must reproduce the above
+  copyright notice, this list of conditions and the
+  following disclaimer in the documentation and/or other
+  materials provided with the distribution.
+
+* Neither the name of the assimp team, nor the names of its
+  contributors may be used to endorse or promote products
+  derived from this software without specific prior
+  written permission of the assimp team.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------
+*/
+
+
+/** @file MmapIOStream.h
+ *  @brief Read-only file stream over a memory mapped file
+ */
+#ifndef AI_MMAPIOSTREAM_H_INC
+#define AI_MMAPIOSTREAM_H_INC
+
+#include <assimp/IOStream.hpp>
+
+namespace Assimp    {
+
+// ----------------------------------------------------------------------------------
+//! @class  MmapIOStream
+//! @brief  Read-only stream over a file mapped into memory
+//!
+//! Reads copy out of the mapping, and GetContents() returns the mapping itself.
+//! The mapping is released when the stream is destroyed.
+class MmapIOStream : public IOStream
+{
+    friend class MmapIOSystem;
+
+protected:
+    MmapIOStream(const char* pData, size_t pSize);
+
+    // -------------------------------------------------------------------
+    /** Maps a file, returns NULL if it can't be mapped */
+    static MmapIOStream* Map(const char* pFile);
+
+public:
+    /** Destructor public to allow simple deletion to close the file. */
+    ~MmapIOStream ();
+
+    // -------------------------------------------------------------------
+    /// Read from stream
+    size_t Read(void* pvBuffer,
+        size_t pSize,
+        size_t pCount);
+
+    // -------------------------------------------------------------------
+    /// Fails, the stream is read-only
+    size_t Write(const void* pvBuffer,
+        size_t pSize,
+        size_t pCount);
+
+    // -------------------------------------------------------------------
+    /// Seek specific position
+    aiReturn Seek(size_t pOffset,
+        aiOrigin pOrigin);
+
+    // -------------------------------------------------------------------
+    /// Get current seek position
+    size_t Tell() const;
+
+    // -------------------------------------------------------------------
+    /// Get size of file
+    size_t FileSize() const;
+
+    // -------------------------------------------------------------------
+    /// Does nothing, the stream is read-only
+    void Flush();
+
+    // -------------------------------------------------------------------
+    /// Get the mapped file
+    const void* GetContents() const;
+
+private:
+    //  Start of the mapping
+    const char* mData;
+    //  File size
+    size_t mSize;
+    //  Read cursor
+    size_t mPos;
+};
+
+// ----------------------------------------------------------------------------------
+inline MmapIOStream::MmapIOStream (const char* pData,
+        size_t pSize) :
+    mData   (pData),
+    mSize   (pSize),
+    mPos    (0)
+{
+    // empty
+}
+// ----------------------------------------------------------------------------------
+
+} // ns assimp
+
+#endif //!!AI_MMAPIOSTREAM_H_INC
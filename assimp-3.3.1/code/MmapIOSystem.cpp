@@ -0,0 +1,111 @@
+/*
+Open Asset Import Library (assimp)
+----------------------------------------------------------------------
+
+Copyright (c) 2006-2016, assimp team
+All rights reserved.
+
+Redistribution and use of this software in source and binary forms,
+with or without modification, are permitted provided that the
+following conditions are met:
+
+* Redistributions of source code must retain the above
+  copyright notice, this list of conditions and the
+  following disclaimer.
+
+* Redistributions in binary form must reproduce the above
+  copyright notice, this list of conditions and the
+  following disclaimer in the documentation and/or other
+  materials provided with the distribution.
+
+* Neither the name of the assimp team, nor the names of its
+  contributors may be used to endorse or promote products
+  derived from this software without specific prior
+  written permission of the assimp team.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------
+*/
+
+/** @file MmapIOSystem.cpp
+ *  @brief Implementation of the memory mapping file system
+ */
+
+#include <assimp/MmapIOSystem.hpp>
+#include "MmapIOStream.h"
+#include "DefaultIOSystem.h"
+
+#include <assimp/ai_assert.h>
+#include <string.h>
+
+using namespace Assimp;
+
+// ------------------------------------------------------------------------------------------------
+// Constructor.
+MmapIOSystem::MmapIOSystem()
+    : mDefault(new DefaultIOSystem())
+{
+    // empty
+}
+
+// ------------------------------------------------------------------------------------------------
+// Destructor.
+MmapIOSystem::~MmapIOSystem()
+{
+    delete mDefault;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Tests for the existence of a file at the given path.
+bool MmapIOSystem::Exists( const char* pFile) const
+{
+    return mDefault->Exists(pFile);
+}
+
+// ------------------------------------------------------------------------------------------------
+// Returns the operation specific directory separator
+char MmapIOSystem::getOsSeparator() const
+{
+    return mDefault->getOsSeparator();
+}
+
+// ------------------------------------------------------------------------------------------------
+// Open a new file with a given path. Read-only files are mapped, everything else - and any
+// file that can't be mapped - is opened by the default file system.
+IOStream* MmapIOSystem::Open( const char* strFile, const char* strMode)
+{
+    ai_assert(NULL != strFile);
+    ai_assert(NULL != strMode);
+
+    if (strMode[0] == 'r' && !::strchr(strMode, '+')) {
+        if (IOStream* stream = MmapIOStream::Map(strFile)) {
+            return stream;
+        }
+    }
+    return mDefault->Open(strFile, strMode);
+}
+
+// ------------------------------------------------------------------------------------------------
+// Closes the given file and releases all resources associated with it.
+void MmapIOSystem::Close( IOStream* pFile)
+{
+    delete pFile;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Compare two paths
+bool MmapIOSystem::ComparePaths (const char* one, const char* second) const
+{
+    return mDefault->ComparePaths(one, second);
+}
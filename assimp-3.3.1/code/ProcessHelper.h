@@ -53,6 +53,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "ParsingUtils.h"
 
 #include <list>
+#include <memory>
 
 // -------------------------------------------------------------------------------
 // Some extensions to std namespace. Mainly std::min and std::max for all
@@ -340,26 +341,33 @@ class ComputeSpatialSortProcess : public BaseProcess
     bool IsActive( unsigned int pFlags) const
     {
         return NULL != shared && 0 != (pFlags & (aiProcess_CalcTangentSpace |
-            aiProcess_GenNormals | aiProcess_JoinIdenticalVertices));
+            aiProcess_GenNormals));
     }
 
+    typedef std::pair<SpatialSort, float> _Type;
+
     void Execute( aiScene* pScene)
     {
-        typedef std::pair<SpatialSort, float> _Type;
         DefaultLogger::get()->debug("Generate spatially-sorted vertex cache");
 
-        std::vector<_Type>* p = new std::vector<_Type>(pScene->mNumMeshes);
-        std::vector<_Type>::iterator it = p->begin();
+        // the spatial sorts of different meshes are independent, build them concurrently
+        // owned here until every mesh is done, so nothing leaks if one throws
+        mSorts.reset(new std::vector<_Type>(pScene->mNumMeshes));
+        ExecuteOnMeshes(pScene);
 
-        for (unsigned int i = 0; i < pScene->mNumMeshes; ++i, ++it) {
-            aiMesh* mesh = pScene->mMeshes[i];
-            _Type& blubb = *it;
-            blubb.first.Fill(mesh->mVertices,mesh->mNumVertices,sizeof(aiVector3D));
-            blubb.second = ComputePositionEpsilon(mesh);
-        }
+        shared->AddProperty(AI_SPP_SPATIAL_SORT,mSorts.release());
+    }
 
-        shared->AddProperty(AI_SPP_SPATIAL_SORT,p);
+    void ExecuteOnMesh( aiScene* pScene, unsigned int meshIndex)
+    {
+        aiMesh* mesh = pScene->mMeshes[meshIndex];
+        _Type& blubb = (*mSorts)[meshIndex];
+        blubb.first.Fill(mesh->mVertices,mesh->mNumVertices,sizeof(aiVector3D));
+        blubb.second = ComputePositionEpsilon(mesh);
     }
+
+    /** Spatial sorts being built by Execute() */
+    std::unique_ptr<std::vector<_Type> > mSorts;
 };
 
 // -------------------------------------------------------------------------------
@@ -369,7 +377,7 @@ class DestroySpatialSortProcess : public BaseProcess
     bool IsActive( unsigned int pFlags) const
     {
         return NULL != shared && 0 != (pFlags & (aiProcess_CalcTangentSpace |
-            aiProcess_GenNormals | aiProcess_JoinIdenticalVertices));
+            aiProcess_GenNormals));
     }
 
     void Execute( aiScene* /*pScene*/)
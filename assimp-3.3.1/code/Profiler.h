@@ -46,6 +46,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <chrono>
 #include <assimp/DefaultLogger.hpp>
+#include <assimp/ProfileHandler.hpp>
 #include "TinyFormatter.h"
 
 #include <map>
@@ -57,40 +58,54 @@ namespace Assimp {
 
 
 // ------------------------------------------------------------------------------------------------
-/** Simple wrapper around boost::timer to simplify reporting. Timings are automatically
- *  dumped to the log file.
+/** Simple wrapper around std::chrono to simplify reporting. Timings are dumped to the log
+ *  file if requested, and passed on to the application's ProfileHandler if it set one.
  */
 class Profiler
 {
 
 public:
 
-    Profiler() {}
+    Profiler(ProfileHandler* handler = NULL, bool log = true)
+        : handler(handler)
+        , log(log) {}
 
 public:
 
-    /** Start a named timer */
-    void BeginRegion(const std::string& region) {
-        regions[region] = std::chrono::system_clock::now();
-        DefaultLogger::get()->debug((format("START `"),region,"`"));
+    /** Start a named timer. Region names must be string literals. */
+    void BeginRegion(const char* region) {
+        regions[region] = std::chrono::steady_clock::now();
+        if (log) {
+            DefaultLogger::get()->debug((format("START `"),region,"`"));
+        }
+        if (handler) {
+            handler->BeginRegion(region);
+        }
     }
 
 
     /** End a specific named timer and write its end time to the log */
-    void EndRegion(const std::string& region) {
+    void EndRegion(const char* region) {
         RegionMap::const_iterator it = regions.find(region);
         if (it == regions.end()) {
             return;
         }
 
-        auto elapsedSeconds = std::chrono::system_clock::now() - regions[region];
-        DefaultLogger::get()->debug((format("END   `"),region,"`, dt= ", elapsedSeconds.count()," s"));
+        const double elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - it->second).count();
+        if (log) {
+            DefaultLogger::get()->debug((format("END   `"),region,"`, dt= ", elapsedSeconds," s"));
+        }
+        if (handler) {
+            handler->EndRegion(region, elapsedSeconds);
+        }
     }
 
 private:
 
-    typedef std::map<std::string,std::chrono::time_point<std::chrono::system_clock>> RegionMap;
+    typedef std::map<std::string,std::chrono::time_point<std::chrono::steady_clock>> RegionMap;
     RegionMap regions;
+    ProfileHandler* handler;
+    bool log;
 };
 
     }
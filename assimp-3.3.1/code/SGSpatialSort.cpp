@@ -51,10 +51,6 @@ using namespace Assimp;
 // ------------------------------------------------------------------------------------------------
 SGSpatialSort::SGSpatialSort()
 {
-    // define the reference plane. We choose some arbitrary vector away from all basic axises
-    // in the hope that no model spreads all its vertices along this plane.
-    mPlaneNormal.Set( 0.8523f, 0.34321f, 0.5736f);
-    mPlaneNormal.Normalize();
 }
 // ------------------------------------------------------------------------------------------------
 // Destructor
@@ -66,16 +62,17 @@ SGSpatialSort::~SGSpatialSort()
 void SGSpatialSort::Add(const aiVector3D& vPosition, unsigned int index,
     unsigned int smoothingGroup)
 {
-    // store position by index and distance
-    float distance = vPosition * mPlaneNormal;
-    mPositions.push_back( Entry( index, vPosition,
-        distance, smoothingGroup));
+    // store position, index and smoothing groups - SpatialSort refers to them by their place
+    mPositions.push_back( vPosition);
+    mIndices.push_back( index);
+    mSmoothGroups.push_back( smoothingGroup);
 }
 // ------------------------------------------------------------------------------------------------
 void SGSpatialSort::Prepare()
 {
-    // now sort the array ascending by distance.
-    std::sort( this->mPositions.begin(), this->mPositions.end());
+    // now sort the positions into the spatial sort.
+    mSort.Fill( mPositions.empty() ? NULL : &mPositions[0],
+        static_cast<unsigned int>( mPositions.size()), sizeof(aiVector3D));
 }
 // ------------------------------------------------------------------------------------------------
 // Returns an iterator for all positions close to the given position.
@@ -85,84 +82,26 @@ void SGSpatialSort::FindPositions( const aiVector3D& pPosition,
     std::vector<unsigned int>& poResults,
     bool exactMatch /*= false*/) const
 {
-    float dist = pPosition * mPlaneNormal;
-    float minDist = dist - pRadius, maxDist = dist + pRadius;
+    // find all close positions, then keep those with matching smoothing groups and replace
+    // them by their vertex indices
+    mSort.FindPositions( pPosition, pRadius, poResults);
 
-    // clear the array in this strange fashion because a simple clear() would also deallocate
-    // the array which we want to avoid
-    poResults.erase( poResults.begin(), poResults.end());
-
-    // quick check for positions outside the range
-    if( mPositions.size() == 0)
-        return;
-    if( maxDist < mPositions.front().mDistance)
-        return;
-    if( minDist > mPositions.back().mDistance)
-        return;
-
-    // do a binary search for the minimal distance to start the iteration there
-    unsigned int index = (unsigned int)mPositions.size() / 2;
-    unsigned int binaryStepSize = (unsigned int)mPositions.size() / 4;
-    while( binaryStepSize > 1)
-    {
-        if( mPositions[index].mDistance < minDist)
-            index += binaryStepSize;
-        else
-            index -= binaryStepSize;
-
-        binaryStepSize /= 2;
-    }
-
-    // depending on the direction of the last step we need to single step a bit back or forth
-    // to find the actual beginning element of the range
-    while( index > 0 && mPositions[index].mDistance > minDist)
-        index--;
-    while( index < (mPositions.size() - 1) && mPositions[index].mDistance < minDist)
-        index++;
-
-    // Mow start iterating from there until the first position lays outside of the distance range.
-    // Add all positions inside the distance range within the given radius to the result aray
-
-    float squareEpsilon = pRadius * pRadius;
-    std::vector<Entry>::const_iterator it  = mPositions.begin() + index;
-    std::vector<Entry>::const_iterator end = mPositions.end();
-
-    if (exactMatch)
+    size_t kept = 0;
+    for (size_t i = 0; i < poResults.size(); ++i)
     {
-        while( it->mDistance < maxDist)
-        {
-            if((it->mPosition - pPosition).SquareLength() < squareEpsilon && it->mSmoothGroups == pSG)
-            {
-                poResults.push_back( it->mIndex);
-            }
-            ++it;
-            if( end == it )break;
+        const uint32_t sg = mSmoothGroups[poResults[i]];
+        bool match;
+        if (exactMatch) {
+            match = sg == pSG;
         }
-    }
-    else
-    {
-        // if the given smoothing group is 0, we'll return all surrounding vertices
-        if (!pSG)
-        {
-            while( it->mDistance < maxDist)
-            {
-                if((it->mPosition - pPosition).SquareLength() < squareEpsilon)
-                    poResults.push_back( it->mIndex);
-                ++it;
-                if( end == it)break;
-            }
+        else {
+            // if the given smoothing group is 0, we'll return all surrounding vertices
+            match = !pSG || (sg & pSG) || !sg;
         }
-        else while( it->mDistance < maxDist)
-        {
-            if((it->mPosition - pPosition).SquareLength() < squareEpsilon &&
-                (it->mSmoothGroups & pSG || !it->mSmoothGroups))
-            {
-                poResults.push_back( it->mIndex);
-            }
-            ++it;
-            if( end == it)break;
+
+        if (match) {
+            poResults[kept++] = mIndices[poResults[i]];
         }
     }
+    poResults.resize( kept);
 }
-
-
@@ -43,6 +43,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifndef AI_D3DSSPATIALSORT_H_INC
 #define AI_D3DSSPATIALSORT_H_INC
 
+#include "SpatialSort.h"
 #include <assimp/types.h>
 #include <vector>
 #include <stdint.h>
@@ -78,7 +79,7 @@ public:
         unsigned int smoothingGroup);
 
     // -------------------------------------------------------------------
-    /** Prepare the spatial sorter for use. This step runs in O(logn)
+    /** Prepare the spatial sorter for use. This step runs in O(n)
      */
     void Prepare();
 
@@ -104,35 +105,15 @@ public:
         bool exactMatch = false) const;
 
 protected:
-    /** Normal of the sorting plane, normalized. The center is always at (0, 0, 0) */
-    aiVector3D mPlaneNormal;
+    /** Positions in the order they were added */
+    std::vector<aiVector3D> mPositions;
 
-    // -------------------------------------------------------------------
-    /** An entry in a spatially sorted position array. Consists of a
-     *  vertex index, its position and its precalculated distance from
-     *  the reference plane */
-    // -------------------------------------------------------------------
-    struct Entry
-    {
-        unsigned int mIndex;    ///< The vertex referred by this entry
-        aiVector3D mPosition;   ///< Position
-        uint32_t mSmoothGroups;
-        float mDistance;        ///< Distance of this vertex to the sorting plane
-
-        Entry() { /** intentionally not initialized.*/ }
-        Entry( unsigned int pIndex, const aiVector3D& pPosition, float pDistance,uint32_t pSG)
-            :
-            mIndex( pIndex),
-            mPosition( pPosition),
-            mSmoothGroups (pSG),
-            mDistance( pDistance)
-            {   }
-
-        bool operator < (const Entry& e) const { return mDistance < e.mDistance; }
-    };
-
-    // all positions, sorted by distance to the sorting plane
-    std::vector<Entry> mPositions;
+    /** Vertex index and smoothing groups of each added position */
+    std::vector<unsigned int> mIndices;
+    std::vector<uint32_t> mSmoothGroups;
+
+    /** Spatial sort of all added positions, created by Prepare() */
+    SpatialSort mSort;
 };
 
 } // end of namespace Assimp
@@ -180,13 +180,19 @@ void STLImporter::InternReadFile( const std::string& pFile,
 
     fileSize = (unsigned int)file->FileSize();
 
-    // allocate storage and copy the contents of the file to a memory buffer
-    // (terminate it with zero)
+    // binary files are parsed in place if the stream holds them in memory,
+    // everything else is copied to a memory buffer (terminated with zero)
     std::vector<char> mBuffer2;
-    TextFileToBuffer(file.get(),mBuffer2);
+    const char* contents = static_cast<const char*>(file->GetContents());
+    if (contents && IsBinarySTL(contents, fileSize)) {
+        this->mBuffer = contents;
+    }
+    else {
+        TextFileToBuffer(file.get(),mBuffer2);
+        this->mBuffer = &mBuffer2[0];
+    }
 
     this->pScene = pScene;
-    this->mBuffer = &mBuffer2[0];
 
     // the default vertex color is light gray.
     clrColorDefault.r = clrColorDefault.g = clrColorDefault.b = clrColorDefault.a = 0.6f;
@@ -43,32 +43,139 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "SpatialSort.h"
 #include <assimp/ai_assert.h>
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstring>
+
+// SSE2 is part of every x86-64 CPU, so it is used without a runtime check
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   define AI_SPATIALSORT_SSE2
+#   include <emmintrin.h>
+#endif
 
 using namespace Assimp;
 
-// CHAR_BIT seems to be defined under MVSC, but not under GCC. Pray that the correct value is 8.
-#ifndef CHAR_BIT
-#   define CHAR_BIT 8
+namespace {
+
+    // Maximum number of cells along each axis of the grid
+    const float MaxCells = 1048576.f;
+
+    // Two positions are identical if their squared distance is at most this number of
+    // floating-point units above zero. See FindIdenticalPositions() for the details.
+    const unsigned int IdenticalToleranceInULPs = 6;
+
+    // Coordinates of identical positions can't differ by more than about 3e-22, so all of them
+    // lay in the cells touched by a box of this size.
+    const float IdenticalRadius = 1e-21f;
+
+    // --------------------------------------------------------------------------------------------
+    // Converts a coordinate to the coordinate of its cell. Coordinates outside the grid, including
+    // infinities and NaNs, are clamped to its border.
+    inline unsigned int ToCell( float pValue, float pMin, float pInvCellSize)
+    {
+        const float cell = (pValue - pMin) * pInvCellSize;
+        return cell > 0.f ? static_cast<unsigned int>(cell < MaxCells ? cell : MaxCells) : 0u;
+    }
+
+    // --------------------------------------------------------------------------------------------
+    // Returns the bit pattern of a floating-point number. For positive numbers, it is ordered the
+    // same way as the numbers and counts the units in the last place above zero.
+    inline unsigned int ToBinary( float pValue)
+    {
+        unsigned int binValue;
+        ::memcpy( &binValue, &pValue, sizeof(binValue));
+        return binValue;
+    }
+
+    // --------------------------------------------------------------------------------------------
+    // Appends the indices of the entries [pBegin, pEnd) of the sorted arrays whose squared distance
+    // to the position is below pSquared, or within the tolerance if Identical is set.
+    template <bool Identical>
+    void ScanEntries( const float* pX, const float* pY, const float* pZ, const unsigned int* pIndices,
+        unsigned int pBegin, unsigned int pEnd, const aiVector3D& pPosition, float pSquared,
+        std::vector<unsigned int>& poResults)
+    {
+        unsigned int i = pBegin;
+
+#ifdef AI_SPATIALSORT_SSE2
+        // four entries at a time - the squared distance is summed up in the same order as
+        // aiVector3D::SquareLength() does, so both paths give the same results
+        const __m128 px = _mm_set1_ps( pPosition.x);
+        const __m128 py = _mm_set1_ps( pPosition.y);
+        const __m128 pz = _mm_set1_ps( pPosition.z);
+        const __m128 squared = _mm_set1_ps( pSquared);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128i tolerance = _mm_set1_epi32( IdenticalToleranceInULPs + 1);
+
+        for( ; i + 4 <= pEnd; i += 4)
+        {
+            const __m128 dx = _mm_sub_ps( _mm_loadu_ps( pX + i), px);
+            const __m128 dy = _mm_sub_ps( _mm_loadu_ps( pY + i), py);
+            const __m128 dz = _mm_sub_ps( _mm_loadu_ps( pZ + i), pz);
+            const __m128 dist = _mm_add_ps( _mm_add_ps( _mm_mul_ps( dx, dx), _mm_mul_ps( dy, dy)),
+                _mm_mul_ps( dz, dz));
+
+            __m128 close;
+            if( Identical) {
+                // not NaN and few enough units above zero
+                close = _mm_and_ps( _mm_cmpge_ps( dist, zero),
+                    _mm_castsi128_ps( _mm_cmplt_epi32( _mm_castps_si128( dist), tolerance)));
+            } else {
+                close = _mm_cmplt_ps( dist, squared);
+            }
+
+            const int mask = _mm_movemask_ps( close);
+            if( mask) {
+                for( unsigned int k = 0; k < 4; ++k) {
+                    if( mask & (1 << k))
+                        poResults.push_back( pIndices[i + k]);
+                }
+            }
+        }
 #endif
 
+        for( ; i < pEnd; ++i)
+        {
+            const aiVector3D diff( pX[i] - pPosition.x, pY[i] - pPosition.y, pZ[i] - pPosition.z);
+            const float dist = diff.SquareLength();
+
+            const bool close = Identical
+                ? dist >= 0.f && ToBinary( dist) <= IdenticalToleranceInULPs
+                : dist < pSquared;
+            if( close)
+                poResults.push_back( pIndices[i]);
+        }
+    }
+
+    // --------------------------------------------------------------------------------------------
+    // Sorts query results by index and removes the duplicates from buckets visited twice
+    inline void SortResults( std::vector<unsigned int>& poResults)
+    {
+        if( poResults.size() > 1) {
+            std::sort( poResults.begin(), poResults.end());
+            poResults.erase( std::unique( poResults.begin(), poResults.end()), poResults.end());
+        }
+    }
+
+} // namespace
+
 // ------------------------------------------------------------------------------------------------
 // Constructs a spatially sorted representation from the given position array.
 SpatialSort::SpatialSort( const aiVector3D* pPositions, unsigned int pNumPositions,
     unsigned int pElementOffset)
-
-    // define the reference plane. We choose some arbitrary vector away from all basic axises
-    // in the hope that no model spreads all its vertices along this plane.
-    : mPlaneNormal(0.8523f, 0.34321f, 0.5736f)
+: mInvCellSize( 1.f)
+, mBucketMask( 0)
 {
-    mPlaneNormal.Normalize();
     Fill(pPositions,pNumPositions,pElementOffset);
 }
 
 // ------------------------------------------------------------------------------------------------
 SpatialSort :: SpatialSort()
-: mPlaneNormal(0.8523f, 0.34321f, 0.5736f)
+: mInvCellSize( 1.f)
+, mBucketMask( 0)
 {
-    mPlaneNormal.Normalize();
 }
 
 // ------------------------------------------------------------------------------------------------
@@ -88,9 +195,83 @@ void SpatialSort::Fill( const aiVector3D* pPositions, unsigned int pNumPositions
 }
 
 // ------------------------------------------------------------------------------------------------
+// Chooses the grid and sorts all positions into its buckets
 void SpatialSort :: Finalize()
 {
-    std::sort( mPositions.begin(), mPositions.end());
+    const unsigned int count = static_cast<unsigned int>( mPositions.size());
+
+    // get the bounds of all finite coordinates
+    aiVector3D minVec( FLT_MAX, FLT_MAX, FLT_MAX), maxVec( -FLT_MAX, -FLT_MAX, -FLT_MAX);
+    for( unsigned int a = 0; a < count; a++)
+    {
+        for( unsigned int c = 0; c < 3; c++)
+        {
+            const float v = mPositions[a][c];
+            if( v >= -FLT_MAX && v <= FLT_MAX) {
+                minVec[c] = std::min( minVec[c], v);
+                maxVec[c] = std::max( maxVec[c], v);
+            }
+        }
+    }
+
+    double extent[3];
+    for( unsigned int c = 0; c < 3; c++)
+    {
+        if( minVec[c] > maxVec[c])
+            minVec[c] = maxVec[c] = 0.f;
+        extent[c] = static_cast<double>( maxVec[c]) - minVec[c];
+    }
+    std::sort( extent, extent + 3);
+
+    // Meshes are surfaces, so aim for about one position per cell of the plane spanned by the two
+    // largest extents. If the positions lay along a line, aim for one per cell along the line.
+    // Cells are cubes, so positions on a plane - even one along the grid's axes - end up in a
+    // single layer of cells instead of sharing a few of them.
+    double cellSize = 1.0;
+    if( count && extent[2] > 0.0)
+    {
+        cellSize = std::sqrt( extent[2] * extent[1] / count);
+        if( extent[1] < cellSize)
+            cellSize = extent[2] / count;
+        cellSize = std::max( cellSize, extent[2] / MaxCells);
+    }
+    mGridMin = minVec;
+    mInvCellSize = static_cast<float>( 1.0 / cellSize);
+
+    // use about as many buckets as positions
+    unsigned int numBuckets = 1;
+    while( numBuckets < count && numBuckets < 0x80000000u)
+        numBuckets <<= 1;
+    mBucketMask = numBuckets - 1;
+
+    // counting sort of all positions by bucket, which keeps them in index order within a bucket
+    std::vector<unsigned int> buckets( count);
+    mBucketStart.assign( numBuckets + 1, 0);
+    for( unsigned int a = 0; a < count; a++)
+    {
+        const aiVector3D& pos = mPositions[a];
+        buckets[a] = GetBucket( ToCell( pos.x, mGridMin.x, mInvCellSize),
+            ToCell( pos.y, mGridMin.y, mInvCellSize),
+            ToCell( pos.z, mGridMin.z, mInvCellSize));
+        ++mBucketStart[buckets[a] + 1];
+    }
+    for( unsigned int b = 0; b < numBuckets; b++)
+        mBucketStart[b + 1] += mBucketStart[b];
+
+    mSortedX.resize( count);
+    mSortedY.resize( count);
+    mSortedZ.resize( count);
+    mSortedIndices.resize( count);
+
+    std::vector<unsigned int> next( mBucketStart.begin(), mBucketStart.end() - 1);
+    for( unsigned int a = 0; a < count; a++)
+    {
+        const unsigned int s = next[buckets[a]]++;
+        mSortedX[s] = mPositions[a].x;
+        mSortedY[s] = mPositions[a].y;
+        mSortedZ[s] = mPositions[a].z;
+        mSortedIndices[s] = a;
+    }
 }
 
 // ------------------------------------------------------------------------------------------------
@@ -98,140 +279,122 @@ void SpatialSort::Append( const aiVector3D* pPositions, unsigned int pNumPositio
     unsigned int pElementOffset,
     bool pFinalize /*= true */)
 {
-    // store references to all given positions along with their distance to the reference plane
-    const size_t initial = mPositions.size();
-    mPositions.reserve(initial + (pFinalize?pNumPositions:pNumPositions*2));
+    // store copies of all given positions, their index is their place in the array
+    mPositions.reserve( mPositions.size() + pNumPositions);
     for( unsigned int a = 0; a < pNumPositions; a++)
     {
         const char* tempPointer = reinterpret_cast<const char*> (pPositions);
         const aiVector3D* vec   = reinterpret_cast<const aiVector3D*> (tempPointer + a * pElementOffset);
-
-        // store position by index and distance
-        float distance = *vec * mPlaneNormal;
-        mPositions.push_back( Entry( a+initial, *vec, distance));
+        mPositions.push_back( *vec);
     }
 
     if (pFinalize) {
-        // now sort the array ascending by distance.
+        // now sort the positions into the grid.
         Finalize();
     }
 }
 
 // ------------------------------------------------------------------------------------------------
-// Returns an iterator for all positions close to the given position.
-void SpatialSort::FindPositions( const aiVector3D& pPosition,
-    float pRadius, std::vector<unsigned int>& poResults) const
+// Looks at the buckets of all cells touched by the box around the given position
+void SpatialSort::Gather( const aiVector3D& pPosition, float pRadius, bool pIdentical,
+    std::vector<unsigned int>& poResults) const
 {
-    const float dist = pPosition * mPlaneNormal;
-    const float minDist = dist - pRadius, maxDist = dist + pRadius;
-
-    // clear the array in this strange fashion because a simple clear() would also deallocate
-    // the array which we want to avoid
-    poResults.erase( poResults.begin(), poResults.end());
-
-    // quick check for positions outside the range
-    if( mPositions.size() == 0)
-        return;
-    if( maxDist < mPositions.front().mDistance)
-        return;
-    if( minDist > mPositions.back().mDistance)
+    const unsigned int count = static_cast<unsigned int>( mSortedIndices.size());
+    if( count == 0)
         return;
 
-    // do a binary search for the minimal distance to start the iteration there
-    unsigned int index = (unsigned int)mPositions.size() / 2;
-    unsigned int binaryStepSize = (unsigned int)mPositions.size() / 4;
-    while( binaryStepSize > 1)
+    // widen the box a little so rounding can't lose positions right at the radius
+    const float reach = pRadius * 1.001f;
+    const unsigned int minX = ToCell( pPosition.x - reach, mGridMin.x, mInvCellSize);
+    const unsigned int maxX = ToCell( pPosition.x + reach, mGridMin.x, mInvCellSize);
+    const unsigned int minY = ToCell( pPosition.y - reach, mGridMin.y, mInvCellSize);
+    const unsigned int maxY = ToCell( pPosition.y + reach, mGridMin.y, mInvCellSize);
+    const unsigned int minZ = ToCell( pPosition.z - reach, mGridMin.z, mInvCellSize);
+    const unsigned int maxZ = ToCell( pPosition.z + reach, mGridMin.z, mInvCellSize);
+
+    const float squared = pRadius * pRadius;
+    const float* x = &mSortedX[0];
+    const float* y = &mSortedY[0];
+    const float* z = &mSortedZ[0];
+    const unsigned int* indices = &mSortedIndices[0];
+
+    // if the box touches more cells than there are buckets, it's cheaper to look at all positions
+    const unsigned long long numCells = static_cast<unsigned long long>( maxX - minX + 1) *
+        (maxY - minY + 1) * (maxZ - minZ + 1);
+    if( numCells > mBucketMask + 1ull)
     {
-        if( mPositions[index].mDistance < minDist)
-            index += binaryStepSize;
+        if( pIdentical)
+            ScanEntries<true>( x, y, z, indices, 0, count, pPosition, squared, poResults);
         else
-            index -= binaryStepSize;
-
-        binaryStepSize /= 2;
+            ScanEntries<false>( x, y, z, indices, 0, count, pPosition, squared, poResults);
+        return;
     }
 
-    // depending on the direction of the last step we need to single step a bit back or forth
-    // to find the actual beginning element of the range
-    while( index > 0 && mPositions[index].mDistance > minDist)
-        index--;
-    while( index < (mPositions.size() - 1) && mPositions[index].mDistance < minDist)
-        index++;
-
-    // Mow start iterating from there until the first position lays outside of the distance range.
-    // Add all positions inside the distance range within the given radius to the result aray
-    std::vector<Entry>::const_iterator it = mPositions.begin() + index;
-    const float pSquared = pRadius*pRadius;
-    while( it->mDistance < maxDist)
+    for( unsigned int cz = minZ; cz <= maxZ; cz++)
     {
-        if( (it->mPosition - pPosition).SquareLength() < pSquared)
-            poResults.push_back( it->mIndex);
-        ++it;
-        if( it == mPositions.end())
-            break;
+        for( unsigned int cy = minY; cy <= maxY; cy++)
+        {
+            for( unsigned int cx = minX; cx <= maxX; cx++)
+            {
+                const unsigned int bucket = GetBucket( cx, cy, cz);
+                const unsigned int begin = mBucketStart[bucket], end = mBucketStart[bucket + 1];
+                if( pIdentical)
+                    ScanEntries<true>( x, y, z, indices, begin, end, pPosition, squared, poResults);
+                else
+                    ScanEntries<false>( x, y, z, indices, begin, end, pPosition, squared, poResults);
+            }
+        }
     }
-
-    // that's it
 }
 
-namespace {
+// ------------------------------------------------------------------------------------------------
+// Returns an iterator for all positions close to the given position.
+void SpatialSort::FindPositions( const aiVector3D& pPosition,
+    float pRadius, std::vector<unsigned int>& poResults) const
+{
+    // clear the array in this strange fashion because a simple clear() would also deallocate
+    // the array which we want to avoid
+    poResults.erase( poResults.begin(), poResults.end());
 
-    // Binary, signed-integer representation of a single-precision floating-point value.
-    // IEEE 754 says: "If two floating-point numbers in the same format are ordered then they are
-    //  ordered the same way when their bits are reinterpreted as sign-magnitude integers."
-    // This allows us to convert all floating-point numbers to signed integers of arbitrary size
-    //  and then use them to work with ULPs (Units in the Last Place, for high-precision
-    //  computations) or to compare them (integer comparisons are faster than floating-point
-    //  comparisons on many platforms).
-    typedef signed int BinFloat;
+    Gather( pPosition, pRadius, false, poResults);
+    SortResults( poResults);
+}
 
-    // --------------------------------------------------------------------------------------------
-    // Converts the bit pattern of a floating-point number to its signed integer representation.
-    BinFloat ToBinary( const float & pValue) {
-
-        // If this assertion fails, signed int is not big enough to store a float on your platform.
-        //  Please correct the declaration of BinFloat a few lines above - but do it in a portable,
-        //  #ifdef'd manner!
-        static_assert( sizeof(BinFloat) >= sizeof(float), "sizeof(BinFloat) >= sizeof(float)");
-
-        #if defined( _MSC_VER)
-            // If this assertion fails, Visual C++ has finally moved to ILP64. This means that this
-            //  code has just become legacy code! Find out the current value of _MSC_VER and modify
-            //  the #if above so it evaluates false on the current and all upcoming VC versions (or
-            //  on the current platform, if LP64 or LLP64 are still used on other platforms).
-            static_assert( sizeof(BinFloat) == sizeof(float), "sizeof(BinFloat) == sizeof(float)");
-
-            // This works best on Visual C++, but other compilers have their problems with it.
-            const BinFloat binValue = reinterpret_cast<BinFloat const &>(pValue);
-        #else
-            // On many compilers, reinterpreting a float address as an integer causes aliasing
-            // problems. This is an ugly but more or less safe way of doing it.
-            union {
-                float       asFloat;
-                BinFloat    asBin;
-            } conversion;
-            conversion.asBin    = 0; // zero empty space in case sizeof(BinFloat) > sizeof(float)
-            conversion.asFloat  = pValue;
-            const BinFloat binValue = conversion.asBin;
-        #endif
-
-        // floating-point numbers are of sign-magnitude format, so find out what signed number
-        //  representation we must convert negative values to.
-        // See http://en.wikipedia.org/wiki/Signed_number_representations.
-
-        // Two's complement?
-        if( (-42 == (~42 + 1)) && (binValue & 0x80000000))
-            return BinFloat(1 << (CHAR_BIT * sizeof(BinFloat) - 1)) - binValue;
-        // One's complement?
-        else if( (-42 == ~42) && (binValue & 0x80000000))
-            return BinFloat(-0) - binValue;
-        // Sign-magnitude?
-        else if( (-42 == (42 | (-0))) && (binValue & 0x80000000)) // -0 = 1000... binary
-            return binValue;
-        else
-            return binValue;
+// ------------------------------------------------------------------------------------------------
+// Finds the close positions of all positions, walking them in the order they are stored in
+void SpatialSort::FindAllPositions( float pRadius, std::vector<unsigned int>& poOffsets,
+    std::vector<unsigned int>& poResults) const
+{
+    const unsigned int count = static_cast<unsigned int>( mSortedIndices.size());
+
+    // Positions stored next to each other share their cells, so their queries touch the same
+    // memory. Collect the results in that order first and reorder them by index afterwards.
+    std::vector<unsigned int> found, sortedResults, first( count), num( count);
+    sortedResults.reserve( count);
+    for( unsigned int s = 0; s < count; s++)
+    {
+        found.erase( found.begin(), found.end());
+        Gather( aiVector3D( mSortedX[s], mSortedY[s], mSortedZ[s]), pRadius, false, found);
+        SortResults( found);
+
+        const unsigned int index = mSortedIndices[s];
+        first[index] = static_cast<unsigned int>( sortedResults.size());
+        num[index] = static_cast<unsigned int>( found.size());
+        sortedResults.insert( sortedResults.end(), found.begin(), found.end());
     }
 
-} // namespace
+    poOffsets.resize( count + 1);
+    poOffsets[0] = 0;
+    for( unsigned int i = 0; i < count; i++)
+        poOffsets[i + 1] = poOffsets[i] + num[i];
+
+    poResults.resize( sortedResults.size());
+    for( unsigned int i = 0; i < count; i++)
+    {
+        std::copy( sortedResults.begin() + first[i], sortedResults.begin() + first[i] + num[i],
+            poResults.begin() + poOffsets[i]);
+    }
+}
 
 // ------------------------------------------------------------------------------------------------
 // Fills an array with indices of all positions identical to the given position. In opposite to
@@ -245,98 +408,45 @@ void SpatialSort::FindIdenticalPositions( const aiVector3D& pPosition,
 
     // The best way to overcome this is the unit in the last place (ULP). A precision of 2 ULPs
     //  tells us that a float does not differ more than 2 bits from the "real" value. ULPs are of
-    //  logarithmic precision - around 1, they are 1�(2^24) and around 10000, they are 0.00125.
+    //  logarithmic precision - around 1, they are 1/(2^24) and around 10000, they are 0.00125.
 
     // For standard C math, we can assume a precision of 0.5 ULPs according to IEEE 754. The
     //  incoming vertex positions might have already been transformed, probably using rather
     //  inaccurate SSE instructions, so we assume a tolerance of 4 ULPs to safely identify
-    //  identical vertex positions.
-    static const int toleranceInULPs = 4;
-    // An interesting point is that the inaccuracy grows linear with the number of operations:
-    //  multiplying to numbers, each inaccurate to four ULPs, results in an inaccuracy of four ULPs
-    //  plus 0.5 ULPs for the multiplication.
-    // To compute the distance to the plane, a dot product is needed - that is a multiplication and
-    //  an addition on each number.
-    static const int distanceToleranceInULPs = toleranceInULPs + 1;
-    // The squared distance between two 3D vectors is computed the same way, but with an additional
-    //  subtraction.
-    static const int distance3DToleranceInULPs = distanceToleranceInULPs + 1;
-
-    // Convert the plane distance to its signed integer representation so the ULPs tolerance can be
-    //  applied. For some reason, VC won't optimize two calls of the bit pattern conversion.
-    const BinFloat minDistBinary = ToBinary( pPosition * mPlaneNormal) - distanceToleranceInULPs;
-    const BinFloat maxDistBinary = minDistBinary + 2 * distanceToleranceInULPs;
+    //  identical vertex positions. The squared distance between two 3D vectors needs a
+    //  subtraction, a multiplication and an addition more, which gives the 6 ULPs of
+    //  IdenticalToleranceInULPs.
 
     // clear the array in this strange fashion because a simple clear() would also deallocate
     // the array which we want to avoid
     poResults.erase( poResults.begin(), poResults.end());
 
-    // do a binary search for the minimal distance to start the iteration there
-    unsigned int index = (unsigned int)mPositions.size() / 2;
-    unsigned int binaryStepSize = (unsigned int)mPositions.size() / 4;
-    while( binaryStepSize > 1)
-    {
-        // Ugly, but conditional jumps are faster with integers than with floats
-        if( minDistBinary > ToBinary(mPositions[index].mDistance))
-            index += binaryStepSize;
-        else
-            index -= binaryStepSize;
-
-        binaryStepSize /= 2;
-    }
-
-    // depending on the direction of the last step we need to single step a bit back or forth
-    // to find the actual beginning element of the range
-    while( index > 0 && minDistBinary < ToBinary(mPositions[index].mDistance) )
-        index--;
-    while( index < (mPositions.size() - 1) && minDistBinary > ToBinary(mPositions[index].mDistance))
-        index++;
-
-    // Now start iterating from there until the first position lays outside of the distance range.
-    // Add all positions inside the distance range within the tolerance to the result aray
-    std::vector<Entry>::const_iterator it = mPositions.begin() + index;
-    while( ToBinary(it->mDistance) < maxDistBinary)
-    {
-        if( distance3DToleranceInULPs >= ToBinary((it->mPosition - pPosition).SquareLength()))
-            poResults.push_back(it->mIndex);
-        ++it;
-        if( it == mPositions.end())
-            break;
-    }
-
-    // that's it
+    Gather( pPosition, IdenticalRadius, true, poResults);
+    SortResults( poResults);
 }
 
 // ------------------------------------------------------------------------------------------------
 unsigned int SpatialSort::GenerateMappingTable(std::vector<unsigned int>& fill,float pRadius) const
 {
-    fill.resize(mPositions.size(),UINT_MAX);
-    float dist, maxDist;
+    // every position that isn't mapped yet gets the next output ID, and passes it on to all
+    // unmapped positions close to it
+    fill.assign( mPositions.size(), UINT_MAX);
+    std::vector<unsigned int> found;
 
     unsigned int t=0;
-    const float pSquared = pRadius*pRadius;
-    for (size_t i = 0; i < mPositions.size();) {
-        dist = mPositions[i].mPosition * mPlaneNormal;
-        maxDist = dist + pRadius;
-
-        fill[mPositions[i].mIndex] = t;
-        const aiVector3D& oldpos = mPositions[i].mPosition;
-        for (++i; i < fill.size() && mPositions[i].mDistance < maxDist
-            && (mPositions[i].mPosition - oldpos).SquareLength() < pSquared; ++i)
-        {
-            fill[mPositions[i].mIndex] = t;
+    for (unsigned int i = 0; i < fill.size(); ++i) {
+        if (fill[i] != UINT_MAX) {
+            continue;
         }
-        ++t;
-    }
+        fill[i] = t;
 
-#ifdef ASSIMP_BUILD_DEBUG
-
-    // debug invariant: mPositions[i].mIndex values must range from 0 to mPositions.size()-1
-    for (size_t i = 0; i < fill.size(); ++i) {
-        ai_assert(fill[i]<mPositions.size());
+        FindPositions( mPositions[i], pRadius, found);
+        for (unsigned int a = 0; a < found.size(); ++a) {
+            if (fill[found[a]] == UINT_MAX) {
+                fill[found[a]] = t;
+            }
+        }
+        ++t;
     }
-
-#endif
     return t;
 }
-
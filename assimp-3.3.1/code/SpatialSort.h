@@ -51,12 +51,15 @@ namespace Assimp
 // ------------------------------------------------------------------------------------------------
 /** A little helper class to quickly find all vertices in the epsilon environment of a given
  * position. Construct an instance with an array of positions. The class stores the given positions
- * by their indices and sorts them by their distance to an arbitrary chosen plane.
- * You can then query the instance for all vertices close to a given position in an average O(log n)
- * time, with O(n) worst case complexity when all vertices lay on the plane. The plane is chosen
- * so that it avoids common planes in usual data sets. */
+ * by their indices in a uniform grid of cells, hashed into buckets. You can then query the instance
+ * for all vertices close to a given position, which only looks at the cells the query touches.
+ * The size of the cells is chosen from the extent and the number of the positions, so that flat
+ * or axis-aligned data sets are handled as quickly as any other.
+ *
+ * Once finalized, an instance is not modified by queries and can be used by several threads at
+ * the same time. Query results are returned in ascending index order. */
 // ------------------------------------------------------------------------------------------------
-class SpatialSort
+class ASSIMP_API SpatialSort
 {
 public:
 
@@ -120,6 +123,18 @@ public:
     void FindPositions( const aiVector3D& pPosition, float pRadius,
         std::vector<unsigned int>& poResults) const;
 
+    // ------------------------------------------------------------------------------------
+    /** Finds the close positions of all positions in the SpatialSort at once. This gives
+     *  the same results as calling #FindPositions() for every position, but walks the
+     *  positions cell by cell and stores the results in one array.
+     * @param pRadius Maximal distance from a position a vertex may have to be counted in.
+     * @param poOffsets Will be filled with numPositions+1 entries. The positions close to
+     *   position i are stored in poResults[poOffsets[i]] to poResults[poOffsets[i+1]-1].
+     * @param poResults The container to store the indices of the found positions.
+     *   Will be emptied by the call so it may contain anything. */
+    void FindAllPositions( float pRadius, std::vector<unsigned int>& poOffsets,
+        std::vector<unsigned int>& poResults) const;
+
     // ------------------------------------------------------------------------------------
     /** Fills an array with indices of all positions identical to the given position. In
      *  opposite to FindPositions(), not an epsilon is used but a (very low) tolerance of
@@ -142,27 +157,37 @@ public:
         float pRadius) const;
 
 protected:
-    /** Normal of the sorting plane, normalized. The center is always at (0, 0, 0) */
-    aiVector3D mPlaneNormal;
-
-    /** An entry in a spatially sorted position array. Consists of a vertex index,
-     * its position and its precalculated distance from the reference plane */
-    struct Entry
-    {
-        unsigned int mIndex; ///< The vertex referred by this entry
-        aiVector3D mPosition; ///< Position
-        float mDistance; ///< Distance of this vertex to the sorting plane
-
-        Entry() { /** intentionally not initialized.*/ }
-        Entry( unsigned int pIndex, const aiVector3D& pPosition, float pDistance)
-            : mIndex( pIndex), mPosition( pPosition), mDistance( pDistance)
-        {   }
-
-        bool operator < (const Entry& e) const { return mDistance < e.mDistance; }
-    };
-
-    // all positions, sorted by distance to the sorting plane
-    std::vector<Entry> mPositions;
+
+    // ------------------------------------------------------------------------------------
+    /** Appends the indices of all positions within the radius of the given position to
+     *  poResults, or of all identical positions if pIdentical is set. Positions in buckets
+     *  shared by several of the visited cells are appended more than once. */
+    void Gather( const aiVector3D& pPosition, float pRadius, bool pIdentical,
+        std::vector<unsigned int>& poResults) const;
+
+    /** Returns the bucket of the cell with the given coordinates */
+    unsigned int GetBucket( unsigned int pX, unsigned int pY, unsigned int pZ) const {
+        return ((pX * 73856093u) ^ (pY * 19349663u) ^ (pZ * 83492791u)) & mBucketMask;
+    }
+
+    /** All positions, by index */
+    std::vector<aiVector3D> mPositions;
+
+    /** Minimum corner of the grid and size of its cells */
+    aiVector3D mGridMin;
+    float mInvCellSize;
+
+    /** Number of buckets minus one, the number of buckets is a power of two */
+    unsigned int mBucketMask;
+
+    /** For each bucket, the first entry of the sorted arrays that lays in it.
+     *  Has one more element marking the end of the last bucket. */
+    std::vector<unsigned int> mBucketStart;
+
+    // all positions, sorted by bucket and then by index, split into
+    // their coordinates to be compared four at a time
+    std::vector<float> mSortedX, mSortedY, mSortedZ;
+    std::vector<unsigned int> mSortedIndices;
 };
 
 } // end of namespace Assimp
@@ -0,0 +1,209 @@
+/*
+---------------------------------------------------------------------------
+Open Asset Import Library (assimp)
+---------------------------------------------------------------------------
+
+Copyright (c) 2006-2016, assimp team
+
+All rights reserved.
+
+Redistribution and use of this software in source and binary forms,
+with or without modification, are permitted provided that the following
+conditions are met:
+
+* Redistributions of source code must retain the above
+  copyright notice, this list of conditions and the
+  following disclaimer.
+
+* Redistributions in binary form must reproduce the above
+  copyright notice, this list of conditions and the
+  following disclaimer in the documentation and/or other
+  materials provided with the distribution.
+
+* Neither the name of the assimp team, nor the names of its
+  contributors may be used to endorse or promote products
+  derived from this software without specific prior
+  written permission of the assimp team.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+---------------------------------------------------------------------------
+*/
+
+/** @file ThreadPool.cpp
+ *  @brief Implementation of the ThreadPool class
+ */
+
+#include "ThreadPool.h"
+
+using namespace Assimp;
+
+#ifndef ASSIMP_BUILD_SINGLETHREADED
+
+// ------------------------------------------------------------------------------------------------
+// Constructor - the calling thread is one of the threads
+ThreadPool::ThreadPool(unsigned int numThreads)
+: mTask()
+, mCount()
+, mNext()
+, mBusy()
+, mGeneration()
+, mStopping()
+, mFailed()
+, mErrorIndex()
+{
+    for (unsigned int i = 1; i < numThreads; ++i) {
+        mThreads.push_back(std::thread(&ThreadPool::WorkerLoop, this));
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+// Destructor
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+    mWorkReady.notify_all();
+
+    for (size_t i = 0; i < mThreads.size(); ++i) {
+        mThreads[i].join();
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+unsigned int ThreadPool::GetNumThreads() const
+{
+    return static_cast<unsigned int>(mThreads.size()) + 1;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Runs every item, with the calling thread taking items as well
+void ThreadPool::ForEach(unsigned int count, Task& task)
+{
+    if (!count) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mTask = &task;
+        mCount = count;
+        mNext = 0;
+        mFailed = false;
+        mError = std::exception_ptr();
+        mBusy = static_cast<unsigned int>(mThreads.size());
+        ++mGeneration;
+    }
+    mWorkReady.notify_all();
+
+    RunItems();
+
+    std::exception_ptr error;
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        while (mBusy) {
+            mWorkDone.wait(lock);
+        }
+        mTask = NULL;
+        error = mError;
+        mError = std::exception_ptr();
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+// Runs items until there are none left. Indices are claimed in ascending order, so every index
+// below a failed one has already been claimed and runs to completion.
+void ThreadPool::RunItems()
+{
+    for (;;) {
+        if (mFailed) {
+            return;
+        }
+
+        const unsigned int index = mNext++;
+        if (index >= mCount) {
+            return;
+        }
+
+        try {
+            mTask->Run(index);
+        }
+        catch (...) {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (!mError || index < mErrorIndex) {
+                mError = std::current_exception();
+                mErrorIndex = index;
+            }
+            mFailed = true;
+        }
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+// Waits for each ForEach() call and helps with its items
+void ThreadPool::WorkerLoop()
+{
+    unsigned long generation = 0;
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    for (;;) {
+        while (!mStopping && generation == mGeneration) {
+            mWorkReady.wait(lock);
+        }
+        if (mStopping) {
+            return;
+        }
+        generation = mGeneration;
+
+        lock.unlock();
+        RunItems();
+        lock.lock();
+
+        if (!--mBusy) {
+            mWorkDone.notify_one();
+        }
+    }
+}
+
+#else // ASSIMP_BUILD_SINGLETHREADED
+
+// ------------------------------------------------------------------------------------------------
+ThreadPool::ThreadPool(unsigned int /*numThreads*/)
+{
+}
+
+// ------------------------------------------------------------------------------------------------
+ThreadPool::~ThreadPool()
+{
+}
+
+// ------------------------------------------------------------------------------------------------
+unsigned int ThreadPool::GetNumThreads() const
+{
+    return 1;
+}
+
+// ------------------------------------------------------------------------------------------------
+void ThreadPool::ForEach(unsigned int count, Task& task)
+{
+    for (unsigned int i = 0; i < count; ++i) {
+        task.Run(i);
+    }
+}
+
+#endif // ASSIMP_BUILD_SINGLETHREADED
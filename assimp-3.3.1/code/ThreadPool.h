@@ -0,0 +1,141 @@
+/*
+Open Asset Import Library (assimp)
+----------------------------------------------------------------------
+
+Copyright (c) 2006-2016, assimp team
+All rights reserved.
+
+Redistribution and use of this software in source and binary forms,
+with or without modification, are permitted provided that the
+following conditions are met:
+
+* Redistributions of source code must retain the above
+  copyright notice, this list of conditions and the
+  following disclaimer.
+
+* Redistributions in binary form must reproduce the above
+  copyright notice, this list of conditions and the
+  following disclaimer in the documentation and/or other
+  materials provided with the distribution.
+
+* Neither the name of the assimp team, nor the names of its
+  contributors may be used to endorse or promote products
+  derived from this software without specific prior
+  written permission of the assimp team.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------
+*/
+
+
+/** @file ThreadPool.h
+ *  @brief Defines a small pool of worker threads used to run independent
+ *    pieces of a post processing step concurrently.
+ */
+#ifndef AI_THREADPOOL_H_INC
+#define AI_THREADPOOL_H_INC
+
+#include <assimp/defs.h>
+#include <vector>
+
+#ifndef ASSIMP_BUILD_SINGLETHREADED
+#   include <atomic>
+#   include <condition_variable>
+#   include <exception>
+#   include <mutex>
+#   include <thread>
+#endif
+
+namespace Assimp    {
+
+// ---------------------------------------------------------------------------
+/** A fixed set of worker threads that run numbered work items.
+ *
+ *  ForEach() hands out indices in ascending order to the workers and the
+ *  calling thread, and returns once all of them are done. Items must not
+ *  depend on each other - results that are stored per index come out the
+ *  same however many threads ran them.
+ *
+ *  If Assimp is built with ASSIMP_BUILD_SINGLETHREADED, no threads are
+ *  created and ForEach() runs every item on the calling thread.
+ */
+class ASSIMP_API ThreadPool
+{
+public:
+
+    // -------------------------------------------------------------------
+    /** Work to be run for each index of a ForEach() call */
+    class Task
+    {
+    public:
+        virtual ~Task() {}
+
+        /** Runs one item. May throw - see ForEach(). */
+        virtual void Run(unsigned int index) = 0;
+    };
+
+public:
+
+    // -------------------------------------------------------------------
+    /** @param numThreads Number of threads to spread work across,
+     *    including the thread that calls ForEach(). */
+    explicit ThreadPool(unsigned int numThreads);
+    ~ThreadPool();
+
+    // -------------------------------------------------------------------
+    /** Number of threads work is spread across, including the caller */
+    unsigned int GetNumThreads() const;
+
+    // -------------------------------------------------------------------
+    /** Runs task.Run(i) for every i in [0, count).
+     *
+     *  If any item throws, no further items are started and the
+     *  exception of the lowest failed index is rethrown here, once the
+     *  items still running have finished. Must not be called from within
+     *  a task. */
+    void ForEach(unsigned int count, Task& task);
+
+private:
+
+    ThreadPool(const ThreadPool&);
+    ThreadPool& operator=(const ThreadPool&);
+
+#ifndef ASSIMP_BUILD_SINGLETHREADED
+    void WorkerLoop();
+    void RunItems();
+
+    std::vector<std::thread> mThreads;
+
+    std::mutex mMutex;
+    std::condition_variable mWorkReady;
+    std::condition_variable mWorkDone;
+
+    // The current ForEach() call - guarded by mMutex, except mNext
+    Task* mTask;
+    unsigned int mCount;
+    std::atomic<unsigned int> mNext;
+    unsigned int mBusy;
+    unsigned long mGeneration;
+    bool mStopping;
+
+    // The lowest failed index and its exception
+    std::atomic<bool> mFailed;
+    std::exception_ptr mError;
+    unsigned int mErrorIndex;
+#endif
+};
+
+} // end of namespace Assimp
+
+#endif // AI_THREADPOOL_H_INC
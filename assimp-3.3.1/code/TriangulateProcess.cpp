@@ -103,10 +103,13 @@ void TriangulateProcess::Execute( aiScene* pScene)
 {
     DefaultLogger::get()->debug("TriangulateProcess begin");
 
+    meshChanged.assign(pScene->mNumMeshes,0);
+    ExecuteOnMeshes(pScene);
+
     bool bHas = false;
     for( unsigned int a = 0; a < pScene->mNumMeshes; a++)
     {
-        if( TriangulateMesh( pScene->mMeshes[a]))
+        if( meshChanged[a])
             bHas = true;
     }
     if (bHas)DefaultLogger::get()->info ("TriangulateProcess finished. All polygons have been triangulated.");
@@ -114,6 +117,13 @@ void TriangulateProcess::Execute( aiScene* pScene)
 }
 
 
+// ------------------------------------------------------------------------------------------------
+// Triangulates one mesh of the scene
+void TriangulateProcess::ExecuteOnMesh( aiScene* pScene, unsigned int meshIndex)
+{
+    meshChanged[meshIndex] = TriangulateMesh( pScene->mMeshes[meshIndex]);
+}
+
 // ------------------------------------------------------------------------------------------------
 // Triangulates the given mesh.
 bool TriangulateProcess::TriangulateMesh( aiMesh* pMesh)
@@ -45,6 +45,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define AI_TRIANGULATEPROCESS_H_INC
 
 #include "BaseProcess.h"
+#include <vector>
 
 struct aiMesh;
 
@@ -86,6 +87,18 @@ public:
      * @param pMesh The mesh to triangulate.
      */
     bool TriangulateMesh( aiMesh* pMesh);
+
+    // -------------------------------------------------------------------
+    /** Runs TriangulateMesh() on one mesh of the scene, for
+     * ExecuteOnMeshes().
+     * @param pScene The imported data to work at.
+     * @param meshIndex Index of the mesh to triangulate.
+     */
+    void ExecuteOnMesh( aiScene* pScene, unsigned int meshIndex);
+
+private:
+    /** Whether each mesh was triangulated, filled by ExecuteOnMesh() */
+    std::vector<unsigned char> meshChanged;
 };
 
 } // end of namespace Assimp
@@ -475,7 +475,7 @@ namespace glTF
 
         void Read(Value& obj, Asset& r);
 
-        bool LoadFromStream(IOStream& stream, size_t length = 0, size_t baseOffset = 0);
+        bool LoadFromStream(shared_ptr<IOStream> stream, size_t length = 0, size_t baseOffset = 0);
 
         size_t AppendData(uint8_t* data, size_t length);
         void Grow(size_t amount);
@@ -293,11 +293,10 @@ inline void Buffer::Read(Value& obj, Asset& r)
     }
     else { // Local file
         if (byteLength > 0) {
-            IOStream* file = r.OpenFile(uri, "rb");
+            shared_ptr<IOStream> file(r.OpenFile(uri, "rb"));
             if (file) {
-                bool ok = LoadFromStream(*file, byteLength);
-                delete file;
-                
+                bool ok = LoadFromStream(file, byteLength);
+
                 if (!ok)
                     throw DeadlyImportError("GLTF: error while reading referenced file \"" + std::string(uri) + "\"" );
             }
@@ -308,17 +307,31 @@ inline void Buffer::Read(Value& obj, Asset& r)
     }
 }
 
-inline bool Buffer::LoadFromStream(IOStream& stream, size_t length, size_t baseOffset)
+inline bool Buffer::LoadFromStream(shared_ptr<IOStream> stream, size_t length, size_t baseOffset)
 {
-    byteLength = length ? length : stream.FileSize();
+    byteLength = length ? length : stream->FileSize();
+
+#ifdef ASSIMP_API
+    // Streams that already hold the file in memory lend it to the buffer,
+    // which keeps the stream open for as long as it uses the data. Loaded
+    // buffers are only ever read from.
+    if (const void* contents = stream->GetContents()) {
+        if (baseOffset > stream->FileSize() || byteLength > stream->FileSize() - baseOffset) {
+            return false;
+        }
+        uint8_t* data = static_cast<uint8_t*>(const_cast<void*>(contents));
+        mData = shared_ptr<uint8_t>(stream, data + baseOffset);
+        return true;
+    }
+#endif
 
     if (baseOffset) {
-        stream.Seek(baseOffset, aiOrigin_SET);
+        stream->Seek(baseOffset, aiOrigin_SET);
     }
 
     mData.reset(new uint8_t[byteLength]);
 
-    if (stream.Read(mData.get(), byteLength, 1) != 1) {
+    if (stream->Read(mData.get(), byteLength, 1) != 1) {
         return false;
     }
     return true;
@@ -975,7 +988,7 @@ inline void Asset::Load(const std::string& pFile, bool isBinary)
 
     // Fill the buffer instance for the current file embedded contents
     if (mBodyLength > 0) {
-        if (!mBodyBuffer->LoadFromStream(*stream, mBodyLength, mBodyOffset)) {
+        if (!mBodyBuffer->LoadFromStream(stream, mBodyLength, mBodyOffset)) {
             throw DeadlyImportError("GLTF: Unable to read gltf file");
         }
     }
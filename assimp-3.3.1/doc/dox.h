@@ -1351,7 +1351,17 @@ with 'slow' file formats like X or Collada might scale well with multiple concur
 
 @section automt Internal threading
 
-Internal multi-threading is not currently implemented.
+By default, everything runs on the thread that called #Assimp::Importer::ReadFile. Post processing steps that
+work on each mesh on its own (currently #aiProcess_JoinIdenticalVertices, #aiProcess_ImproveCacheLocality,
+#aiProcess_CalcTangentSpace, #aiProcess_GenNormals / #aiProcess_GenSmoothNormals and #aiProcess_Triangulate) can
+spread the meshes of a scene across several threads instead. Set #AI_CONFIG_PP_NUM_THREADS to the number of threads
+to use, or to 0 to use one per hardware thread. The threads are created by the importer on first use and kept until
+the setting changes or the importer is destroyed.
+
+The output does not depend on the number of threads - the same scene comes out of the same file either way. Only
+scenes with several meshes benefit, since a single mesh is still processed by one thread. Custom log streams must
+be thread-safe when this is enabled, as the steps log from the worker threads. If assimp is built with
+<b>ASSIMP_BUILD_SINGLETHREADED</b>, the setting is ignored.
 */
 
 /**
@@ -545,4 +545,19 @@ There are also some common flags to customize Assimp's logging behaviour:
 	decrease loading performance and result in *very* long logs ... use with caution if you experience strange issues.</td>
   </tr>
  </table>
+
+Input files can be memory mapped instead of read:
+
+<table border="1">
+
+  <tr>
+    <th>Name</th>
+    <th>Description</th>
+  </tr>
+  <tr>
+    <td><tt>-mm</tt> or <tt>--memory-map</tt></td>
+    <td>Opens input files through #Assimp::MmapIOSystem. Importers that can parse a file in place (binary STL,
+	binary FBX and glTF buffers) then use the mapped file instead of loading a copy of it.</td>
+  </tr>
+ </table>
  */
@@ -119,6 +119,19 @@ public:
      *  See fflush() for more details.
      */
     virtual void Flush() = 0;
+
+    // -------------------------------------------------------------------
+    /** @brief Get the whole file as one block of memory, if the stream
+     *  already holds it there
+     *
+     *  Streams over memory mapped files or memory buffers return their
+     *  data here, so importers can parse it in place instead of reading
+     *  it into a buffer of their own. The block is FileSize() bytes long,
+     *  read-only and not zero-terminated. It stays valid until the stream
+     *  is closed and is not affected by the read/write cursor.
+     *  @return NULL if the file must be read using Read() (the default).
+     */
+    virtual const void* GetContents() const;
 }; //! class IOStream
 
 // ----------------------------------------------------------------------------------
@@ -132,6 +145,12 @@ inline IOStream::~IOStream()
 {
     // empty
 }
+
+// ----------------------------------------------------------------------------------
+inline const void* IOStream::GetContents() const
+{
+    return NULL;
+}
 // ----------------------------------------------------------------------------------
 } //!namespace Assimp
 
@@ -61,6 +61,7 @@ namespace Assimp    {
     class IOStream;
     class IOSystem;
     class ProgressHandler;
+    class ProfileHandler;
 
     // =======================================================================
     // Plugin development
@@ -355,6 +356,21 @@ public:
      */
     bool IsDefaultProgressHandler() const;
 
+    // -------------------------------------------------------------------
+    /** Supplies a handler that receives the time spent in each stage of
+     *  every import - reading the file, preprocessing, and each
+     *  post-processing step. Unlike the other handlers, the importer
+     *  does not take ownership of it.
+     *  @param pHandler Profile callback interface. Pass NULL to
+     *    stop reporting timings. */
+    void SetProfileHandler ( ProfileHandler* pHandler );
+
+    // -------------------------------------------------------------------
+    /** Retrieves the profile handler that is currently set.
+     * @return The handler passed to #SetProfileHandler(), or NULL.
+     */
+    ProfileHandler* GetProfileHandler() const;
+
     // -------------------------------------------------------------------
     /** @brief Check whether a given set of postprocessing flags
      *  is supported.
@@ -0,0 +1,112 @@
+/*
+Open Asset Import Library (assimp)
+----------------------------------------------------------------------
+
+Copyright (c) 2006-2016, assimp team
+All rights reserved.
+
+Redistribution and use of this software in source and binary forms,
+with or without modification, are permitted provided that the
+following conditions are met:
+
+* Redistributions of source code must retain the above
+  copyright notice, this list of conditions and the
+  following disclaimer.
+
+* Redistributions in binary form must reproduce the above
+  copyright notice, this list of conditions and the
+  following disclaimer in the documentation and/or other
+  materials provided with the distribution.
+
+* Neither the name of the assimp team, nor the names of its
+  contributors may be used to endorse or promote products
+  derived from this software without specific prior
+  written permission of the assimp team.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------
+*/
+
+
+/** @file MmapIOSystem.hpp
+ *  @brief IOSystem that memory maps the files it opens for reading.
+ */
+#ifndef INCLUDED_AI_MMAPIOSYSTEM_H
+#define INCLUDED_AI_MMAPIOSYSTEM_H
+
+#include "IOSystem.hpp"
+
+namespace Assimp    {
+
+// ------------------------------------------------------------------------------------
+/** @brief CPP-API: File system that maps files into memory instead of reading them.
+ *
+ *  Files opened for reading are memory mapped, and their streams hand out the
+ *  mapping through IOStream::GetContents(). Importers that parse binary data in
+ *  place (binary STL, binary FBX and glTF buffers) then use the mapping directly
+ *  instead of copying the file into memory first, so large files are only held
+ *  once and pages are loaded as the importer reaches them. Importers that need a
+ *  buffer of their own still read through the stream as usual.
+ *
+ *  Files opened for writing, and files that cannot be mapped (such as empty
+ *  files), are handled the same way as by the default file system.
+ *
+ *  @code
+ *  Assimp::Importer importer;
+ *  importer.SetIOHandler(new Assimp::MmapIOSystem());
+ *  @endcode
+ *
+ *  A mapped file must not be truncated by another process while it is being
+ *  imported. */
+class ASSIMP_API MmapIOSystem : public IOSystem
+{
+public:
+    /** @brief  Default constructor */
+    MmapIOSystem();
+
+    /** @brief  Destructor */
+    ~MmapIOSystem();
+
+    // -------------------------------------------------------------------
+    /** Tests for the existence of a file at the given path. */
+    bool Exists( const char* pFile) const;
+
+    // -------------------------------------------------------------------
+    /** Returns the directory separator. */
+    char getOsSeparator() const;
+
+    // -------------------------------------------------------------------
+    /** Open a new file with a given path. Files opened with "r" or "rb"
+     *  are mapped into memory. */
+    IOStream* Open( const char* pFile, const char* pMode = "rb");
+
+    // -------------------------------------------------------------------
+    /** Closes the given file and releases all resources associated with it. */
+    void Close( IOStream* pFile);
+
+    // -------------------------------------------------------------------
+    /** Compare two paths */
+    bool ComparePaths (const char* one, const char* second) const;
+
+private:
+    MmapIOSystem(const MmapIOSystem&);
+    MmapIOSystem& operator=(const MmapIOSystem&);
+
+    /** Handles everything but mapping files */
+    IOSystem* mDefault;
+};
+
+} //!ns Assimp
+
+#endif //!!INCLUDED_AI_MMAPIOSYSTEM_H
@@ -0,0 +1,94 @@
+/*
+Open Asset Import Library (assimp)
+----------------------------------------------------------------------
+
+Copyright (c) 2006-2016, assimp team
+All rights reserved.
+
+Redistribution and use of this software in source and binary forms,
+with or without modification, are permitted provided that the
+following conditions are met:
+
+* Redistributions of source code must retain the above
+  copyright notice, this list of conditions and the
+  following disclaimer.
+
+* Redistributions in binary form must reproduce the above
+  copyright notice, this list of conditions and the
+  following disclaimer in the documentation and/or other
+  materials provided with the distribution.
+
+* Neither the name of the assimp team, nor the names of its
+  contributors may be used to endorse or promote products
+  derived from this software without specific prior
+  written permission of the assimp team.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+----------------------------------------------------------------------
+*/
+
+
+/** @file ProfileHandler.hpp
+ *  @brief Abstract base class 'ProfileHandler'.
+ */
+#ifndef INCLUDED_AI_PROFILEHANDLER_H
+#define INCLUDED_AI_PROFILEHANDLER_H
+#include "types.h"
+namespace Assimp    {
+
+// ------------------------------------------------------------------------------------
+/** @brief CPP-API: Abstract interface for receivers of import timings.
+ *
+ *  An #Importer with a #ProfileHandler reports how long each stage of an
+ *  import took - "total", "import", "preprocess", and "postprocess" once
+ *  per post-processing step that runs. Region names are string literals
+ *  and stay valid for the lifetime of the program. Regions are reported
+ *  from the thread that called the #Importer. */
+class ASSIMP_API ProfileHandler
+#ifndef SWIG
+    : public Intern::AllocateFromAssimpHeap
+#endif
+{
+protected:
+    /** @brief  Default constructor */
+    ProfileHandler () {
+    }
+public:
+    /** @brief  Virtual destructor  */
+    virtual ~ProfileHandler () {
+    }
+
+    // -------------------------------------------------------------------
+    /** @brief Called when a region starts.
+     *  @param region Name of the region.
+     *
+     *  Regions nest - "total" contains all of the others. */
+    virtual void BeginRegion(const char* region) {
+        (void)region;
+    }
+
+    // -------------------------------------------------------------------
+    /** @brief Called when a region ends.
+     *  @param region Name of the region, as passed to #BeginRegion().
+     *  @param seconds Time spent inside the region.
+     *
+     *  No exceptions may be thrown and no non-const #Importer methods
+     *  may be called from within this method. */
+    virtual void EndRegion(const char* region, double seconds) = 0;
+
+}; // !class ProfileHandler
+// ------------------------------------------------------------------------------------
+} // Namespace Assimp
+
+#endif
@@ -117,6 +117,22 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 // ###########################################################################
 
 
+// ---------------------------------------------------------------------------
+/** @brief Number of threads post processing steps may use.
+ *
+ * Steps that work on each mesh independently (such as
+ * #aiProcess_JoinIdenticalVertices, #aiProcess_ImproveCacheLocality,
+ * #aiProcess_CalcTangentSpace, #aiProcess_GenSmoothNormals and
+ * #aiProcess_Triangulate) spread their meshes across this many threads,
+ * including the calling one. The output is the same for any thread
+ * count. 0 uses one thread per hardware thread. The setting is ignored
+ * if Assimp was built with ASSIMP_BUILD_SINGLETHREADED.
+ * Property type: int, default value: 1.
+ */
+#define AI_CONFIG_PP_NUM_THREADS    \
+    "PP_NUM_THREADS"
+
+
 // ---------------------------------------------------------------------------
 /** @brief Maximum bone count per mesh for the SplitbyBoneCount step.
  *
@@ -374,6 +390,82 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 #define AI_CONFIG_PP_ICL_PTCACHE_SIZE   "PP_ICL_PTCACHE_SIZE"
 
+// ---------------------------------------------------------------------------
+/** @brief Enumerates the post-transform vertex cache models the
+ *  #aiProcess_ImproveCacheLocality step can optimize for.
+ *
+ *  See the documentation to #AI_CONFIG_PP_ICL_CACHE_MODEL for more details.
+ */
+enum aiVertexCacheModel
+{
+    /** A first-in-first-out cache, as found in most GPUs up to around 2010.
+     *  Faces are reordered with the 'tipsify' algorithm.
+     */
+    aiVertexCacheModel_FIFO = 0x0,
+
+    /** A least-recently-used cache. Faces are reordered with Tom Forsyth's
+     *  'Linear-Speed Vertex Cache Optimisation', which scores vertices by
+     *  their position in the cache and their number of remaining faces.
+     */
+    aiVertexCacheModel_LRU = 0x1,
+
+    /** This value is not used. It is just there to force the
+     *  compiler to map this enum to a 32 Bit integer. */
+#ifndef SWIG
+    _aiVertexCacheModel_Force32Bit = 0x9fffffff
+#endif
+};
+
+/** @brief Default value for the #AI_CONFIG_PP_ICL_CACHE_MODEL property
+ */
+#ifndef PP_ICL_CACHE_MODEL
+#   define PP_ICL_CACHE_MODEL aiVertexCacheModel_FIFO
+#endif
+
+// ---------------------------------------------------------------------------
+/** @brief Set the post-transform vertex cache model to optimize the
+ *    vertices for. This configures the #aiProcess_ImproveCacheLocality step.
+ *
+ * Specify one of the values of the #aiVertexCacheModel enum. The size of the
+ * cache is set with #AI_CONFIG_PP_ICL_PTCACHE_SIZE for both models.
+ * @note The default value is #PP_ICL_CACHE_MODEL.
+ * Property type: integer.
+ */
+#define AI_CONFIG_PP_ICL_CACHE_MODEL   "PP_ICL_CACHE_MODEL"
+
+/** @brief Default value for the #AI_CONFIG_PP_ICL_OVERDRAW_THRESHOLD property
+ */
+#ifndef PP_ICL_OVERDRAW_THRESHOLD
+#   define PP_ICL_OVERDRAW_THRESHOLD 0.f
+#endif
+
+// ---------------------------------------------------------------------------
+/** @brief Set how much vertex cache efficiency the
+ *    #aiProcess_ImproveCacheLocality step may give up to reduce overdraw.
+ *
+ * After the faces have been reordered for the vertex cache, they are split
+ * into clusters, which are sorted so that clusters facing away from the
+ * center of the mesh, which tend to occlude the others, are drawn first.
+ * Each cluster may have an ACMR up to this factor above the ACMR of the
+ * faces it was cut from. Every cut empties the cache, so even a value of 1
+ * usually costs some cache misses; around 1.05 is a reasonable trade-off.
+ * Values below 1 disable the overdraw reduction.
+ * @note The default value is #PP_ICL_OVERDRAW_THRESHOLD, which disables it.
+ * Property type: float.
+ */
+#define AI_CONFIG_PP_ICL_OVERDRAW_THRESHOLD   "PP_ICL_OVERDRAW_THRESHOLD"
+
+// ---------------------------------------------------------------------------
+/** @brief Configures the #aiProcess_ImproveCacheLocality step to renumber
+ *    the vertices in the order the reordered faces use them.
+ *
+ * This improves the locality of vertex fetches before the post-transform
+ * cache. Vertices which aren't used by any face are moved to the end.
+ * @note The default value is false.
+ * Property type: bool.
+ */
+#define AI_CONFIG_PP_ICL_REORDER_VERTICES   "PP_ICL_REORDER_VERTICES"
+
 // ---------------------------------------------------------------------------
 /** @brief Enumerates components of the aiScene and aiMesh data structures
  *  that can be excluded from the import using the #aiProcess_RemoveComponent step.
@@ -270,11 +270,16 @@ enum aiPostProcessSteps
      * miss ratio) for all meshes. The implementation runs in O(n) and is
      * roughly based on the 'tipsify' algorithm (see <a href="
      * http://www.cs.princeton.edu/gfx/pubs/Sander_2007_%3ETR/tipsy.pdf">this
-     * paper</a>).
+     * paper</a>), or on Tom Forsyth's algorithm for LRU caches. Optionally,
+     * the faces are then clustered and sorted to reduce overdraw, and the
+     * vertices are renumbered in the order they are used.
      *
      * If you intend to render huge models in hardware, this step might
-     * be of interest to you. The <tt>#AI_CONFIG_PP_ICL_PTCACHE_SIZE</tt>
-     * importer property can be used to fine-tune the cache optimization.
+     * be of interest to you. The <tt>#AI_CONFIG_PP_ICL_PTCACHE_SIZE</tt>,
+     * <tt>#AI_CONFIG_PP_ICL_CACHE_MODEL</tt>,
+     * <tt>#AI_CONFIG_PP_ICL_OVERDRAW_THRESHOLD</tt> and
+     * <tt>#AI_CONFIG_PP_ICL_REORDER_VERTICES</tt> importer properties can be
+     * used to fine-tune the cache optimization.
      */
     aiProcess_ImproveCacheLocality = 0x800,
 
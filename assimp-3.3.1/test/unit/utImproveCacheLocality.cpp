@@ -39,4 +39,330 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ---------------------------------------------------------------------------
 */
 
-#include "UnitTestPCH.h"
\ No newline at end of file
+#include "UnitTestPCH.h"
+#include <assimp/scene.h>
+#include <assimp/config.h>
+#include <assimp/postprocess.h>
+#include <assimp/Importer.hpp>
+#include <ImproveCacheLocality.h>
+#include <algorithm>
+#include <limits>
+#include <sstream>
+#include <vector>
+
+
+using namespace std;
+using namespace Assimp;
+
+namespace {
+
+const unsigned int Flags = aiProcess_Triangulate | aiProcess_JoinIdenticalVertices;
+
+// ------------------------------------------------------------------------------------------------
+// Builds a torus as an .obj file, with the quads in scanline order
+string MakeTorus()
+{
+    const unsigned int rings = 32, sides = 16;
+    ostringstream obj;
+    for (unsigned int i = 0; i < rings; ++i) {
+        const float u = i * 2.f * (float)AI_MATH_PI / rings;
+        for (unsigned int j = 0; j < sides; ++j) {
+            const float v = j * 2.f * (float)AI_MATH_PI / sides;
+            obj << "v " << (2.f + 0.5f * cos(v)) * cos(u) << " " << (2.f + 0.5f * cos(v)) * sin(u) <<
+                " " << 0.5f * sin(v) << "\n";
+        }
+    }
+    for (unsigned int i = 0; i < rings; ++i) {
+        for (unsigned int j = 0; j < sides; ++j) {
+            const unsigned int i1 = (i + 1) % rings, j1 = (j + 1) % sides;
+            obj << "f " << i * sides + j + 1 << " " << i1 * sides + j + 1 << " " <<
+                i1 * sides + j1 + 1 << " " << i * sides + j1 + 1 << "\n";
+        }
+    }
+    return obj.str();
+}
+
+// ------------------------------------------------------------------------------------------------
+// Reads the torus, optionally improving the cache locality with the given cache model
+const aiScene* ReadModel(Importer& importer, bool improve, int model = aiVertexCacheModel_FIFO)
+{
+    const string obj = MakeTorus();
+    importer.SetPropertyInteger(AI_CONFIG_PP_ICL_CACHE_MODEL, model);
+    const aiScene* scene = importer.ReadFileFromMemory(obj.c_str(), obj.length(),
+        improve ? Flags | aiProcess_ImproveCacheLocality : Flags, "obj");
+    if (!scene || 1 != scene->mNumMeshes) {
+        return NULL;
+    }
+    return scene;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Computes the ACMR of a mesh for a FIFO cache of the default size
+float ComputeACMR(const aiMesh* mesh)
+{
+    vector<unsigned int> fifo;
+    unsigned int misses = 0;
+    for (unsigned int f = 0; f < mesh->mNumFaces; ++f) {
+        for (unsigned int i = 0; i < 3; ++i) {
+            const unsigned int v = mesh->mFaces[f].mIndices[i];
+            if (find(fifo.begin(), fifo.end(), v) == fifo.end()) {
+                ++misses;
+                fifo.push_back(v);
+                if (fifo.size() > PP_ICL_PTCACHE_SIZE) {
+                    fifo.erase(fifo.begin());
+                }
+            }
+        }
+    }
+    return (float)misses / mesh->mNumFaces;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Gets the positions of the corners of all faces, in a well-defined order
+vector<aiVector3D> GetSortedCorners(const aiMesh* mesh)
+{
+    vector<aiVector3D> corners;
+    for (unsigned int f = 0; f < mesh->mNumFaces; ++f) {
+        for (unsigned int i = 0; i < 3; ++i) {
+            corners.push_back(mesh->mVertices[mesh->mFaces[f].mIndices[i]]);
+        }
+    }
+    sort(corners.begin(), corners.end());
+    return corners;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Estimates the overdraw of a mesh: the number of pixels drawn per pixel covered, rendering it
+// with depth test and backface culling along the axes from both sides
+float EstimateOverdraw(const aiMesh* mesh)
+{
+    const int resolution = 128;
+    const float farDepth = numeric_limits<float>::max();
+
+    aiVector3D min(farDepth), max(-farDepth);
+    for (unsigned int v = 0; v < mesh->mNumVertices; ++v) {
+        const aiVector3D& p = mesh->mVertices[v];
+        for (unsigned int c = 0; c < 3; ++c) {
+            min[c] = std::min(min[c], p[c]);
+            max[c] = std::max(max[c], p[c]);
+        }
+    }
+
+    vector<float> depthBuffer(resolution * resolution);
+    unsigned int drawn = 0, covered = 0;
+    for (unsigned int axis = 0; axis < 3; ++axis) {
+        const unsigned int u = (axis + 1) % 3, v = (axis + 2) % 3;
+        const float scale = resolution / std::max(max[u] - min[u], max[v] - min[v]);
+        for (int side = 0; side < 2; ++side) {
+            const float dir = side ? -1.f : 1.f;
+            fill(depthBuffer.begin(), depthBuffer.end(), farDepth);
+
+            for (unsigned int f = 0; f < mesh->mNumFaces; ++f) {
+                float x[3], y[3], z[3];
+                for (unsigned int i = 0; i < 3; ++i) {
+                    const aiVector3D& p = mesh->mVertices[mesh->mFaces[f].mIndices[i]];
+                    x[i] = (p[u] - min[u]) * scale;
+                    y[i] = (p[v] - min[v]) * scale;
+                    z[i] = -dir * p[axis];
+                }
+                const float area = ((x[1] - x[0]) * (y[2] - y[0]) - (y[1] - y[0]) * (x[2] - x[0])) * dir;
+                if (!(area > 0.f)) {
+                    continue;
+                }
+
+                const int x0 = std::max(0, (int)*min_element(x, x + 3)), x1 = std::min(resolution - 1, (int)*max_element(x, x + 3));
+                const int y0 = std::max(0, (int)*min_element(y, y + 3)), y1 = std::min(resolution - 1, (int)*max_element(y, y + 3));
+                for (int py = y0; py <= y1; ++py) {
+                    for (int px = x0; px <= x1; ++px) {
+                        const float cx = px + 0.5f, cy = py + 0.5f;
+                        const float w0 = ((x[2] - x[1]) * (cy - y[1]) - (y[2] - y[1]) * (cx - x[1])) * dir;
+                        const float w1 = ((x[0] - x[2]) * (cy - y[2]) - (y[0] - y[2]) * (cx - x[2])) * dir;
+                        const float w2 = ((x[1] - x[0]) * (cy - y[0]) - (y[1] - y[0]) * (cx - x[0])) * dir;
+                        if (w0 < 0.f || w1 < 0.f || w2 < 0.f) {
+                            continue;
+                        }
+                        const float depth = (w0 * z[0] + w1 * z[1] + w2 * z[2]) / area;
+                        float& stored = depthBuffer[py * resolution + px];
+                        if (depth < stored) {
+                            stored = depth;
+                            ++drawn;
+                        }
+                    }
+                }
+            }
+            for (size_t i = 0; i < depthBuffer.size(); ++i) {
+                if (depthBuffer[i] != farDepth) {
+                    ++covered;
+                }
+            }
+        }
+    }
+    return (float)drawn / covered;
+}
+
+// ------------------------------------------------------------------------------------------------
+// The weight a vertex at the given position gets from a bone, so it can be checked after reordering
+float BoneWeight(unsigned int bone, const aiVector3D& p)
+{
+    return bone ? 0.5f + 0.1f * p.z : 0.5f + 0.1f * p.x;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Where a vertex at the given position is in the anim mesh
+aiVector3D AnimPosition(const aiVector3D& p)
+{
+    return p * 2.f + aiVector3D(1.f, 2.f, 3.f);
+}
+
+// ------------------------------------------------------------------------------------------------
+// Checks the result of the step against the unprocessed mesh
+void CheckMesh(const aiMesh* in, const aiMesh* out)
+{
+    ASSERT_EQ(in->mNumFaces, out->mNumFaces);
+    ASSERT_EQ(in->mNumVertices, out->mNumVertices);
+
+    // the faces are only reordered
+    EXPECT_TRUE(GetSortedCorners(in) == GetSortedCorners(out));
+
+    // with a better ACMR
+    EXPECT_LT(ComputeACMR(out), ComputeACMR(in));
+
+    // and the vertices are used in order
+    unsigned int next = 0;
+    for (unsigned int f = 0; f < out->mNumFaces; ++f) {
+        for (unsigned int i = 0; i < 3; ++i) {
+            const unsigned int v = out->mFaces[f].mIndices[i];
+            EXPECT_GE(next, v);
+            if (v == next) {
+                ++next;
+            }
+        }
+    }
+}
+
+} // namespace
+
+// ------------------------------------------------------------------------------------------------
+TEST(ImproveCacheLocalityTest, testFIFO)
+{
+    Importer plain, improved;
+    improved.SetPropertyFloat(AI_CONFIG_PP_ICL_OVERDRAW_THRESHOLD, 1.05f);
+    improved.SetPropertyBool(AI_CONFIG_PP_ICL_REORDER_VERTICES, true);
+    const aiScene* in = ReadModel(plain, false);
+    const aiScene* out = ReadModel(improved, true);
+    ASSERT_TRUE(NULL != in);
+    ASSERT_TRUE(NULL != out);
+    CheckMesh(in->mMeshes[0], out->mMeshes[0]);
+}
+
+// ------------------------------------------------------------------------------------------------
+TEST(ImproveCacheLocalityTest, testLRU)
+{
+    Importer plain, improved;
+    improved.SetPropertyFloat(AI_CONFIG_PP_ICL_OVERDRAW_THRESHOLD, 1.05f);
+    improved.SetPropertyBool(AI_CONFIG_PP_ICL_REORDER_VERTICES, true);
+    const aiScene* in = ReadModel(plain, false);
+    const aiScene* out = ReadModel(improved, true, aiVertexCacheModel_LRU);
+    ASSERT_TRUE(NULL != in);
+    ASSERT_TRUE(NULL != out);
+    CheckMesh(in->mMeshes[0], out->mMeshes[0]);
+}
+
+// ------------------------------------------------------------------------------------------------
+// By default, only the faces are reordered
+TEST(ImproveCacheLocalityTest, testKeepVertexOrder)
+{
+    Importer plain, improved;
+    const aiScene* in = ReadModel(plain, false);
+    const aiScene* out = ReadModel(improved, true);
+    ASSERT_TRUE(NULL != in);
+    ASSERT_TRUE(NULL != out);
+
+    const aiMesh* a = in->mMeshes[0];
+    const aiMesh* b = out->mMeshes[0];
+    ASSERT_EQ(a->mNumVertices, b->mNumVertices);
+    for (unsigned int v = 0; v < a->mNumVertices; ++v) {
+        EXPECT_EQ(a->mVertices[v], b->mVertices[v]);
+    }
+    EXPECT_LT(ComputeACMR(b), ComputeACMR(a));
+}
+
+// ------------------------------------------------------------------------------------------------
+TEST(ImproveCacheLocalityTest, testReduceOverdraw)
+{
+    const int models[] = { aiVertexCacheModel_FIFO, aiVertexCacheModel_LRU };
+    for (unsigned int m = 0; m < 2; ++m) {
+        Importer cacheOnly, reduced;
+        reduced.SetPropertyFloat(AI_CONFIG_PP_ICL_OVERDRAW_THRESHOLD, 1.05f);
+        const aiScene* in = ReadModel(cacheOnly, true, models[m]);
+        const aiScene* out = ReadModel(reduced, true, models[m]);
+        ASSERT_TRUE(NULL != in);
+        ASSERT_TRUE(NULL != out);
+
+        // the clusters are only reordered, and don't draw more pixels than before
+        EXPECT_TRUE(GetSortedCorners(in->mMeshes[0]) == GetSortedCorners(out->mMeshes[0]));
+        EXPECT_LE(EstimateOverdraw(out->mMeshes[0]), EstimateOverdraw(in->mMeshes[0]));
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+TEST(ImproveCacheLocalityTest, testReorderBonesAndAnimMeshes)
+{
+    Importer importer;
+    ASSERT_TRUE(NULL != ReadModel(importer, false));
+    aiScene* scene = importer.GetOrphanedScene();
+    aiMesh* mesh = scene->mMeshes[0];
+
+    // every vertex is weighted by the second bone, every other one by the first
+    mesh->mNumBones = 2;
+    mesh->mBones = new aiBone*[2];
+    for (unsigned int b = 0; b < 2; ++b) {
+        aiBone* bone = mesh->mBones[b] = new aiBone();
+        bone->mNumWeights = b ? mesh->mNumVertices : (mesh->mNumVertices + 1) / 2;
+        bone->mWeights = new aiVertexWeight[bone->mNumWeights];
+        for (unsigned int w = 0; w < bone->mNumWeights; ++w) {
+            const unsigned int v = b ? w : w * 2;
+            bone->mWeights[w] = aiVertexWeight(v, BoneWeight(b, mesh->mVertices[v]));
+        }
+    }
+
+    mesh->mNumAnimMeshes = 1;
+    mesh->mAnimMeshes = new aiAnimMesh*[1];
+    aiAnimMesh* anim = mesh->mAnimMeshes[0] = new aiAnimMesh();
+    anim->mNumVertices = mesh->mNumVertices;
+    anim->mVertices = new aiVector3D[mesh->mNumVertices];
+    for (unsigned int v = 0; v < mesh->mNumVertices; ++v) {
+        anim->mVertices[v] = AnimPosition(mesh->mVertices[v]);
+    }
+
+    Importer settings;
+    settings.SetPropertyBool(AI_CONFIG_PP_ICL_REORDER_VERTICES, true);
+    ImproveCacheLocalityProcess process;
+    process.SetupProperties(&settings);
+    process.Execute(scene);
+
+    // the vertices were renumbered ...
+    bool moved = false;
+    for (unsigned int w = 0; w < mesh->mBones[1]->mNumWeights; ++w) {
+        moved = moved || mesh->mBones[1]->mWeights[w].mVertexId != w;
+    }
+    EXPECT_TRUE(moved);
+
+    // ... and the weights and anim mesh still belong to the same positions
+    for (unsigned int b = 0; b < 2; ++b) {
+        const aiBone* bone = mesh->mBones[b];
+        vector<bool> seen(mesh->mNumVertices, false);
+        for (unsigned int w = 0; w < bone->mNumWeights; ++w) {
+            const aiVertexWeight& weight = bone->mWeights[w];
+            ASSERT_LT(weight.mVertexId, mesh->mNumVertices);
+            EXPECT_FALSE(seen[weight.mVertexId]);
+            seen[weight.mVertexId] = true;
+            EXPECT_EQ(BoneWeight(b, mesh->mVertices[weight.mVertexId]), weight.mWeight);
+        }
+    }
+    for (unsigned int v = 0; v < mesh->mNumVertices; ++v) {
+        EXPECT_EQ(AnimPosition(mesh->mVertices[v]), anim->mVertices[v]);
+    }
+
+    delete scene;
+}
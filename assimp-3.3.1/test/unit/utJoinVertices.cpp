@@ -42,6 +42,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <assimp/scene.h>
 #include <JoinVerticesProcess.h>
+#include <limits>
 
 
 using namespace std;
@@ -141,3 +142,38 @@ TEST_F(JoinVerticesTest, testProcess)
     EXPECT_EQ(150.f*299.f*3.f, fSum); // gaussian sum equation
 }
 
+
+// ------------------------------------------------------------------------------------------------
+TEST_F(JoinVerticesTest, testJoinSimilarVertices)
+{
+    // the second copy of each vertex differs a little bit in the normal, the third one too much
+    for (unsigned int i = 0; i < 300;++i)
+    {
+        pcMesh->mNormals[300+i].x = 1e-6f;
+        pcMesh->mNormals[600+i].x = 1.f;
+    }
+
+    // -0 is at the same position as +0
+    pcMesh->mVertices[300] = aiVector3D(-0.f);
+
+    // vertices at NaN positions are never joined
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    pcMesh->mVertices[10] = pcMesh->mVertices[310] = aiVector3D(nan, 0.f, 0.f);
+
+    piProcess->ProcessMesh(pcMesh,0);
+
+    ASSERT_EQ(300U, pcMesh->mNumFaces);
+    ASSERT_EQ(601U, pcMesh->mNumVertices);
+
+    // the second copies are replaced by the first ones
+    for (unsigned int i = 0; i < 200;++i)
+    {
+        const aiFace& face = pcMesh->mFaces[i];
+        for (unsigned int a = 0; a < 3;++a)
+        {
+            if (3*i+a != 310) {
+                EXPECT_EQ(0.f, pcMesh->mNormals[face.mIndices[a]].x);
+            }
+        }
+    }
+}
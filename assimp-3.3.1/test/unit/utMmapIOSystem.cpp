@@ -0,0 +1,119 @@
+/*
+---------------------------------------------------------------------------
+Open Asset Import Library (assimp)
+---------------------------------------------------------------------------
+
+Copyright (c) 2006-2016, assimp team
+
+All rights reserved.
+
+Redistribution and use of this software in source and binary forms,
+with or without modification, are permitted provided that the following
+conditions are met:
+
+* Redistributions of source code must retain the above
+  copyright notice, this list of conditions and the
+  following disclaimer.
+
+* Redistributions in binary form must reproduce the above
+  copyright notice, this list of conditions and the
+  following disclaimer in the documentation and/or other
+  materials provided with the distribution.
+
+* Neither the name of the assimp team, nor the names of its
+  contributors may be used to endorse or promote products
+  derived from this software without specific prior
+  written permission of the assimp team.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+---------------------------------------------------------------------------
+*/
+#include "UnitTestPCH.h"
+
+#include <assimp/MmapIOSystem.hpp>
+#include <assimp/IOStream.hpp>
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <vector>
+
+using namespace std;
+using namespace Assimp;
+
+static const char* MappedFile = ASSIMP_TEST_MODELS_DIR "/STL/Spider_binary.stl";
+
+class MmapIOSystemTest : public ::testing::Test {
+public:
+    virtual void SetUp() { pImp = new MmapIOSystem(); }
+    virtual void TearDown() { delete pImp; }
+
+protected:
+    MmapIOSystem* pImp;
+};
+
+// ------------------------------------------------------------------------------------------------
+TEST_F( MmapIOSystemTest, readMatchesMapping ) {
+    IOStream* file = pImp->Open( MappedFile, "rb" );
+    ASSERT_TRUE( NULL != file );
+
+    const size_t size = file->FileSize();
+    ASSERT_LT( 100U, size );
+    const char* contents = static_cast<const char*>( file->GetContents() );
+    ASSERT_TRUE( NULL != contents );
+
+    vector<char> data( size );
+    EXPECT_EQ( 1U, file->Read( &data[ 0 ], size, 1 ) );
+    EXPECT_EQ( 0, memcmp( &data[ 0 ], contents, size ) );
+    EXPECT_EQ( size, file->Tell() );
+    EXPECT_EQ( 0U, file->Read( &data[ 0 ], 1, 1 ) );
+
+    // seeking moves the cursor but not the contents
+    EXPECT_EQ( aiReturn_SUCCESS, file->Seek( 80, aiOrigin_SET ) );
+    EXPECT_EQ( 80U, file->Tell() );
+    EXPECT_EQ( 4U, file->Read( &data[ 0 ], 1, 4 ) );
+    EXPECT_EQ( 0, memcmp( &data[ 0 ], contents + 80, 4 ) );
+    EXPECT_EQ( aiReturn_SUCCESS, file->Seek( 16, aiOrigin_CUR ) );
+    EXPECT_EQ( 100U, file->Tell() );
+    EXPECT_EQ( aiReturn_FAILURE, file->Seek( size + 1, aiOrigin_SET ) );
+    EXPECT_EQ( 100U, file->Tell() );
+    EXPECT_EQ( contents, file->GetContents() );
+
+    // the stream is read-only
+    EXPECT_EQ( 0U, file->Write( &data[ 0 ], 1, 1 ) );
+
+    pImp->Close( file );
+}
+
+// ------------------------------------------------------------------------------------------------
+TEST_F( MmapIOSystemTest, missingFileFails ) {
+    EXPECT_FALSE( pImp->Exists( ASSIMP_TEST_MODELS_DIR "/STL/doesnotexist.stl" ) );
+    EXPECT_TRUE( NULL == pImp->Open( ASSIMP_TEST_MODELS_DIR "/STL/doesnotexist.stl", "rb" ) );
+    EXPECT_TRUE( pImp->Exists( MappedFile ) );
+}
+
+// ------------------------------------------------------------------------------------------------
+TEST_F( MmapIOSystemTest, importMatchesDefaultIOSystem ) {
+    Importer plain, mapped;
+    mapped.SetIOHandler( new MmapIOSystem() );
+
+    const aiScene* a = plain.ReadFile( MappedFile, 0 );
+    const aiScene* b = mapped.ReadFile( MappedFile, 0 );
+    ASSERT_TRUE( NULL != a );
+    ASSERT_TRUE( NULL != b );
+    ASSERT_EQ( a->mNumMeshes, b->mNumMeshes );
+    for ( unsigned int m = 0; m < a->mNumMeshes; ++m ) {
+        ASSERT_EQ( a->mMeshes[ m ]->mNumVertices, b->mMeshes[ m ]->mNumVertices );
+        EXPECT_EQ( 0, memcmp( a->mMeshes[ m ]->mVertices, b->mMeshes[ m ]->mVertices,
+            a->mMeshes[ m ]->mNumVertices * sizeof( aiVector3D ) ) );
+    }
+}
@@ -0,0 +1,201 @@
+/*
+---------------------------------------------------------------------------
+Open Asset Import Library (assimp)
+---------------------------------------------------------------------------
+
+Copyright (c) 2006-2016, assimp team
+
+All rights reserved.
+
+Redistribution and use of this software in source and binary forms,
+with or without modification, are permitted provided that the following
+conditions are met:
+
+* Redistributions of source code must retain the above
+  copyright notice, this list of conditions and the
+  following disclaimer.
+
+* Redistributions in binary form must reproduce the above
+  copyright notice, this list of conditions and the
+  following disclaimer in the documentation and/or other
+  materials provided with the distribution.
+
+* Neither the name of the assimp team, nor the names of its
+  contributors may be used to endorse or promote products
+  derived from this software without specific prior
+  written permission of the assimp team.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+---------------------------------------------------------------------------
+*/
+#include "UnitTestPCH.h"
+
+#include <SpatialSort.h>
+#include <math.h>
+
+using namespace std;
+using namespace Assimp;
+
+class SpatialSortTest : public ::testing::Test {
+public:
+    virtual void SetUp();
+
+protected:
+    // checks FindPositions() and FindAllPositions() against a brute force search
+    void CheckFindPositions(const vector<aiVector3D>& positions, float radius);
+
+    vector<aiVector3D> randomPositions;
+    vector<aiVector3D> axisGrid;
+    vector<aiVector3D> tiltedGrid;
+};
+
+// ------------------------------------------------------------------------------------------------
+void SpatialSortTest::SetUp()
+{
+    // fixed pseudo random numbers, so failures can be reproduced
+    unsigned int seed = 12345;
+    for (unsigned int i = 0; i < 2000; ++i) {
+        float v[3];
+        for (unsigned int c = 0; c < 3; ++c) {
+            seed = seed * 1103515245u + 12345u;
+            v[c] = static_cast<float>((seed >> 8) & 0xffff) / 6553.6f - 5.f;
+        }
+        randomPositions.push_back(aiVector3D(v[0], v[1], v[2]));
+    }
+    // some positions twice
+    for (unsigned int i = 0; i < 200; ++i) {
+        randomPositions.push_back(randomPositions[i * 7]);
+    }
+
+    // flat grids with every position four times, as in a mesh of quads that don't share
+    // their vertices - one along the axes and one tilted
+    aiVector3D u(0.8523f, 0.34321f, 0.5736f);
+    u.Normalize();
+    aiVector3D right = aiVector3D(u.y, -u.x, 0.f).Normalize();
+    aiVector3D up = u ^ right;
+    for (unsigned int j = 0; j < 40; ++j) {
+        for (unsigned int i = 0; i < 40; ++i) {
+            for (unsigned int k = 0; k < 4; ++k) {
+                axisGrid.push_back(aiVector3D(i * 0.5f, j * 0.5f, 3.f));
+                tiltedGrid.push_back(right * (i * 0.5f) + up * (j * 0.5f));
+            }
+        }
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+void SpatialSortTest::CheckFindPositions(const vector<aiVector3D>& positions, float radius)
+{
+    SpatialSort sort(&positions[0], static_cast<unsigned int>(positions.size()), sizeof(aiVector3D));
+
+    vector<unsigned int> found, offsets, allFound;
+    sort.FindAllPositions(radius, offsets, allFound);
+    ASSERT_EQ(positions.size() + 1, offsets.size());
+
+    for (unsigned int i = 0; i < positions.size(); ++i) {
+        vector<unsigned int> expected;
+        for (unsigned int j = 0; j < positions.size(); ++j) {
+            if ((positions[j] - positions[i]).SquareLength() < radius * radius) {
+                expected.push_back(j);
+            }
+        }
+
+        sort.FindPositions(positions[i], radius, found);
+        ASSERT_EQ(expected, found);
+
+        vector<unsigned int> all(allFound.begin() + offsets[i], allFound.begin() + offsets[i + 1]);
+        ASSERT_EQ(expected, all);
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+TEST_F(SpatialSortTest, findPositionsInRandomPositions)
+{
+    CheckFindPositions(randomPositions, 0.001f);
+    CheckFindPositions(randomPositions, 0.5f);
+    CheckFindPositions(randomPositions, 100.f);
+}
+
+// ------------------------------------------------------------------------------------------------
+TEST_F(SpatialSortTest, findPositionsInFlatGrids)
+{
+    CheckFindPositions(axisGrid, 0.001f);
+    CheckFindPositions(axisGrid, 0.6f);
+    CheckFindPositions(tiltedGrid, 0.001f);
+    CheckFindPositions(tiltedGrid, 0.6f);
+}
+
+// ------------------------------------------------------------------------------------------------
+TEST_F(SpatialSortTest, findPositionsOutsideAndEmpty)
+{
+    SpatialSort empty;
+    vector<unsigned int> found(3, 1);
+    empty.FindPositions(aiVector3D(), 1.f, found);
+    EXPECT_TRUE(found.empty());
+
+    SpatialSort sort(&axisGrid[0], static_cast<unsigned int>(axisGrid.size()), sizeof(aiVector3D));
+    sort.FindPositions(aiVector3D(-100.f, 0.f, 3.f), 1.f, found);
+    EXPECT_TRUE(found.empty());
+    sort.FindPositions(aiVector3D(-0.1f, -0.1f, 3.f), 0.2f, found);
+    ASSERT_EQ(4U, found.size());
+    EXPECT_EQ(0U, found[0]);
+    EXPECT_EQ(3U, found[3]);
+}
+
+// ------------------------------------------------------------------------------------------------
+TEST_F(SpatialSortTest, findIdenticalPositions)
+{
+    SpatialSort sort(&randomPositions[0], static_cast<unsigned int>(randomPositions.size()), sizeof(aiVector3D));
+
+    vector<unsigned int> found;
+    sort.FindIdenticalPositions(randomPositions[14], found);
+    ASSERT_EQ(2U, found.size());
+    EXPECT_EQ(14U, found[0]);
+    EXPECT_EQ(2002U, found[1]);
+
+    sort.FindIdenticalPositions(randomPositions[1], found);
+    ASSERT_EQ(1U, found.size());
+    EXPECT_EQ(1U, found[0]);
+
+    // the tolerance applies to the squared distance, so one unit in the last place of a
+    // coordinate is already too much
+    aiVector3D pos = randomPositions[1];
+    pos.x = nextafterf(pos.x, 100.f);
+    sort.FindIdenticalPositions(pos, found);
+    EXPECT_TRUE(found.empty());
+
+    // except very close to zero
+    vector<aiVector3D> tiny(2, aiVector3D(1e-30f, 0.f, 0.f));
+    tiny[1].x = nextafterf(tiny[1].x, 1.f);
+    SpatialSort tinySort(&tiny[0], 2, sizeof(aiVector3D));
+    tinySort.FindIdenticalPositions(tiny[0], found);
+    EXPECT_EQ(2U, found.size());
+}
+
+// ------------------------------------------------------------------------------------------------
+TEST_F(SpatialSortTest, generateMappingTable)
+{
+    // append the grids in two parts and finalize once
+    SpatialSort sort;
+    sort.Append(&axisGrid[0], 3200, sizeof(aiVector3D), false);
+    sort.Append(&axisGrid[3200], static_cast<unsigned int>(axisGrid.size()) - 3200, sizeof(aiVector3D), false);
+    sort.Finalize();
+
+    vector<unsigned int> table;
+    EXPECT_EQ(axisGrid.size() / 4, sort.GenerateMappingTable(table, 0.01f));
+    ASSERT_EQ(axisGrid.size(), table.size());
+    for (unsigned int i = 0; i < table.size(); ++i) {
+        EXPECT_EQ(i / 4, table[i]);
+    }
+}
@@ -0,0 +1,186 @@
+/*
+---------------------------------------------------------------------------
+Open Asset Import Library (assimp)
+---------------------------------------------------------------------------
+
+Copyright (c) 2006-2016, assimp team
+
+All rights reserved.
+
+Redistribution and use of this software in source and binary forms,
+with or without modification, are permitted provided that the following
+conditions are met:
+
+* Redistributions of source code must retain the above
+  copyright notice, this list of conditions and the
+  following disclaimer.
+
+* Redistributions in binary form must reproduce the above
+  copyright notice, this list of conditions and the
+  following disclaimer in the documentation and/or other
+  materials provided with the distribution.
+
+* Neither the name of the assimp team, nor the names of its
+  contributors may be used to endorse or promote products
+  derived from this software without specific prior
+  written permission of the assimp team.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+---------------------------------------------------------------------------
+*/
+#include "UnitTestPCH.h"
+
+#include <assimp/scene.h>
+#include <assimp/config.h>
+#include <assimp/postprocess.h>
+#include <assimp/Importer.hpp>
+#include <ThreadPool.h>
+#include <stdexcept>
+
+
+using namespace std;
+using namespace Assimp;
+
+namespace {
+
+// ------------------------------------------------------------------------------------------------
+// Counts how often each index was run, optionally failing at some of them
+class CountingTask : public ThreadPool::Task
+{
+public:
+    CountingTask(unsigned int count)
+        : runs(count, 0)
+    {}
+
+    virtual void Run(unsigned int index)
+    {
+        runs[index]++;
+        for (unsigned int i = 0; i < failAt.size(); ++i) {
+            if (failAt[i] == index) {
+                throw runtime_error(index == 7 ? "seven" : "other");
+            }
+        }
+    }
+
+    vector<int> runs;
+    vector<unsigned int> failAt;
+};
+
+// ------------------------------------------------------------------------------------------------
+// Reads a file with the given number of post processing threads
+const aiScene* ReadWithThreads(Importer& importer, const char* file, int numThreads)
+{
+    importer.SetPropertyInteger(AI_CONFIG_PP_NUM_THREADS, numThreads);
+    return importer.ReadFile(file,
+        aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_CalcTangentSpace |
+        aiProcess_JoinIdenticalVertices | aiProcess_ImproveCacheLocality);
+}
+
+// ------------------------------------------------------------------------------------------------
+bool SameVectors(const aiVector3D* a, const aiVector3D* b, unsigned int count)
+{
+    if (!a || !b) {
+        return a == b;
+    }
+    for (unsigned int i = 0; i < count; ++i) {
+        if (a[i] != b[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+// ------------------------------------------------------------------------------------------------
+TEST(ThreadPoolTest, testForEachRunsEveryIndexOnce)
+{
+    ThreadPool pool(4);
+    EXPECT_EQ(4U, pool.GetNumThreads());
+
+    // reuse the pool a few times, with more and fewer items than threads
+    const unsigned int counts[] = { 0, 1, 3, 100, 1000 };
+    for (unsigned int c = 0; c < sizeof(counts) / sizeof(counts[0]); ++c) {
+        CountingTask task(counts[c]);
+        pool.ForEach(counts[c], task);
+        for (unsigned int i = 0; i < counts[c]; ++i) {
+            EXPECT_EQ(1, task.runs[i]);
+        }
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+TEST(ThreadPoolTest, testForEachRethrowsLowestFailure)
+{
+    ThreadPool pool(4);
+
+    CountingTask task(100);
+    task.failAt.push_back(7);
+    task.failAt.push_back(50);
+    try {
+        pool.ForEach(100, task);
+        FAIL() << "ForEach() should have thrown";
+    }
+    catch (const runtime_error& e) {
+        EXPECT_STREQ("seven", e.what());
+    }
+
+    // every item before the failure ran, none ran twice
+    for (unsigned int i = 0; i < 100; ++i) {
+        if (i <= 7) {
+            EXPECT_EQ(1, task.runs[i]);
+        }
+        EXPECT_GE(1, task.runs[i]);
+    }
+
+    // the pool is still usable afterwards
+    CountingTask next(10);
+    pool.ForEach(10, next);
+    for (unsigned int i = 0; i < 10; ++i) {
+        EXPECT_EQ(1, next.runs[i]);
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+TEST(ThreadPoolTest, testPostProcessingIsSameWithThreads)
+{
+    const char* file = ASSIMP_TEST_MODELS_DIR "/ASE/MotionCaptureROM.ase";
+
+    Importer serial, parallel;
+    const aiScene* a = ReadWithThreads(serial, file, 1);
+    const aiScene* b = ReadWithThreads(parallel, file, 4);
+    ASSERT_TRUE(NULL != a);
+    ASSERT_TRUE(NULL != b);
+    ASSERT_LT(1U, a->mNumMeshes);
+    ASSERT_EQ(a->mNumMeshes, b->mNumMeshes);
+
+    for (unsigned int m = 0; m < a->mNumMeshes; ++m) {
+        const aiMesh* ma = a->mMeshes[m];
+        const aiMesh* mb = b->mMeshes[m];
+        ASSERT_EQ(ma->mNumVertices, mb->mNumVertices);
+        ASSERT_EQ(ma->mNumFaces, mb->mNumFaces);
+
+        EXPECT_TRUE(SameVectors(ma->mVertices, mb->mVertices, ma->mNumVertices));
+        EXPECT_TRUE(SameVectors(ma->mNormals, mb->mNormals, ma->mNumVertices));
+        EXPECT_TRUE(SameVectors(ma->mTangents, mb->mTangents, ma->mNumVertices));
+        EXPECT_TRUE(SameVectors(ma->mBitangents, mb->mBitangents, ma->mNumVertices));
+
+        for (unsigned int f = 0; f < ma->mNumFaces; ++f) {
+            ASSERT_EQ(ma->mFaces[f].mNumIndices, mb->mFaces[f].mNumIndices);
+            for (unsigned int i = 0; i < ma->mFaces[f].mNumIndices; ++i) {
+                EXPECT_EQ(ma->mFaces[f].mIndices[i], mb->mFaces[f].mIndices[i]);
+            }
+        }
+    }
+}
@@ -0,0 +1,252 @@
+/*
+---------------------------------------------------------------------------
+Open Asset Import Library (assimp)
+---------------------------------------------------------------------------
+
+Copyright (c) 2006-2016, assimp team
+
+All rights reserved.
+
+Redistribution and use of this software in source and binary forms, 
+with or without modification, are permitted provided that the following 
+conditions are met:
+
+* Redistributions of source code must retain the above
+  copyright notice, this list of conditions and the
+  following disclaimer.
+
+* Redistributions in binary form must reproduce the above
+  copyright notice, this list of conditions and the
+  following disclaimer in the documentation and/or other
+  materials provided with the distribution.
+
+* Neither the name of the assimp team, nor the names of its
+  contributors may be used to endorse or promote products
+  derived from this software without specific prior
+  written permission of the assimp team.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+"AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY 
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+---------------------------------------------------------------------------
+*/
+
+
+/** @file  Benchmark.cpp
+ *  @brief Implementation of the 'assimp benchmark' utility  */
+
+#include "Main.h"
+
+#include <assimp/ProfileHandler.hpp>
+#include <assimp/config.h>
+
+#include <chrono>
+#include <ctype.h>
+#include <vector>
+
+const char* AICMD_MSG_BENCHMARK_HELP =
+"assimp benchmark <file> [<file> ...] [-t<threads>] [-n<runs>] [common parameters]\n"
+"\tImport each file with every thread count and compare post-processing times\n"
+"\t-t<threads>,--threads=<threads>: Comma separated thread counts, default 1,2,4,0\n"
+"\t   (0 uses one thread per hardware thread)\n"
+"\t-n<runs>,--runs=<runs>: Imports per thread count, the fastest counts. Default 3\n"
+"\tWithout post-processing flags, -c=full is used.\n"
+"\tThe output is checked to be the same for every thread count.\n";
+
+
+namespace {
+
+// -----------------------------------------------------------------------------------
+// Adds up the time spent in post-processing steps
+class PostProcessTimer : public ProfileHandler
+{
+public:
+	PostProcessTimer()
+		: seconds()
+	{}
+
+	void EndRegion(const char* region, double elapsed) {
+		if (!strcmp(region,"postprocess")) {
+			seconds += elapsed;
+		}
+	}
+
+	double seconds;
+};
+
+// -----------------------------------------------------------------------------------
+// FNV-1a over a block of memory
+void HashBytes(uint64_t& hash, const void* data, size_t size)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	for (size_t i = 0; i < size; ++i) {
+		hash = (hash ^ bytes[i]) * 1099511628211ull;
+	}
+}
+
+// -----------------------------------------------------------------------------------
+// Hash of the mesh data post-processing produces, to compare thread counts
+uint64_t HashMeshes(const aiScene* scene)
+{
+	uint64_t hash = 14695981039346656037ull;
+	for (unsigned int m = 0; m < scene->mNumMeshes; ++m) {
+		const aiMesh* mesh = scene->mMeshes[m];
+		HashBytes(hash,&mesh->mNumVertices,sizeof(mesh->mNumVertices));
+		HashBytes(hash,mesh->mVertices,sizeof(aiVector3D)*mesh->mNumVertices);
+		if (mesh->mNormals) {
+			HashBytes(hash,mesh->mNormals,sizeof(aiVector3D)*mesh->mNumVertices);
+		}
+		if (mesh->mTangents) {
+			HashBytes(hash,mesh->mTangents,sizeof(aiVector3D)*mesh->mNumVertices);
+			HashBytes(hash,mesh->mBitangents,sizeof(aiVector3D)*mesh->mNumVertices);
+		}
+		for (unsigned int f = 0; f < mesh->mNumFaces; ++f) {
+			const aiFace& face = mesh->mFaces[f];
+			HashBytes(hash,face.mIndices,sizeof(unsigned int)*face.mNumIndices);
+		}
+	}
+	return hash;
+}
+
+}
+
+// -----------------------------------------------------------------------------------
+int Assimp_Benchmark (const char* const* params, unsigned int num)
+{
+	if (num < 1) {
+		printf("assimp benchmark: Invalid number of arguments. "
+			"See \'assimp benchmark --help\'\n");
+		return 1;
+	}
+
+	// --help
+	if (!strcmp( params[0],"-h")||!strcmp( params[0],"--help")||!strcmp( params[0],"-?") ) {
+		printf("%s",AICMD_MSG_BENCHMARK_HELP);
+		return 0;
+	}
+
+	ImportData import;
+	ProcessStandardArguments(import,params,num);
+	if (!import.ppFlags) {
+		import.ppFlags = aiProcessPreset_TargetRealtime_MaxQuality;
+	}
+
+	std::vector<std::string> files;
+	std::vector<int> threads;
+	unsigned int runs = 3;
+	for (unsigned int i = 0; i < num; ++i) {
+		const char* threadList = NULL;
+		if (!strncmp(params[i],"--threads=",10)) {
+			threadList = params[i]+10;
+		}
+		// -tri, -tuv and friends are post-processing flags
+		else if (!strncmp(params[i],"-t",2) && isdigit(static_cast<unsigned char>(params[i][2]))) {
+			threadList = params[i]+2;
+		}
+		else if (!strncmp(params[i],"--runs=",7)) {
+			runs = strtoul(params[i]+7,NULL,10);
+		}
+		else if (!strncmp(params[i],"-n",2) && isdigit(static_cast<unsigned char>(params[i][2]))) {
+			runs = strtoul(params[i]+2,NULL,10);
+		}
+		else if (params[i][0] != '-') {
+			files.push_back(params[i]);
+		}
+
+		while (threadList && *threadList) {
+			char* end;
+			threads.push_back(static_cast<int>(strtol(threadList,&end,10)));
+			threadList = *end == ',' ? end+1 : NULL;
+		}
+	}
+	if (threads.empty()) {
+		threads.push_back(1);
+		threads.push_back(2);
+		threads.push_back(4);
+		threads.push_back(0);
+	}
+	if (!runs) {
+		runs = 1;
+	}
+	if (files.empty()) {
+		printf("assimp benchmark: No input files given\n");
+		return 1;
+	}
+
+	printf("%-40s %7s %8s %12s %12s %8s %s\n","File","Meshes","Threads","Import ms","Postproc ms","Speedup","Output");
+
+	int failures = 0;
+	for (size_t f = 0; f < files.size(); ++f) {
+		double serialSeconds = 0.0;
+		uint64_t serialHash = 0;
+
+		for (size_t t = 0; t < threads.size(); ++t) {
+			double bestImport = 0.0, bestPostProcess = 0.0;
+			unsigned int meshes = 0;
+			uint64_t hash = 0;
+			bool failed = false;
+
+			for (unsigned int r = 0; r < runs && !failed; ++r) {
+				// a fresh importer each time, so no run reuses another's threads
+				Assimp::Importer imp;
+				PostProcessTimer timer;
+				imp.SetProfileHandler(&timer);
+				imp.SetPropertyInteger(AI_CONFIG_PP_NUM_THREADS,threads[t]);
+				if (import.memoryMap) {
+					imp.SetIOHandler(new Assimp::MmapIOSystem());
+				}
+
+				const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+				const aiScene* scene = imp.ReadFile(files[f],import.ppFlags);
+				const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+
+				if (!scene) {
+					printf("%-40s failed: %s\n",files[f].c_str(),imp.GetErrorString());
+					failed = true;
+					break;
+				}
+
+				if (!r || seconds < bestImport) {
+					bestImport = seconds;
+				}
+				if (!r || timer.seconds < bestPostProcess) {
+					bestPostProcess = timer.seconds;
+				}
+				meshes = scene->mNumMeshes;
+				hash = HashMeshes(scene);
+			}
+			if (failed) {
+				++failures;
+				break;
+			}
+
+			if (!t) {
+				serialSeconds = bestPostProcess;
+				serialHash = hash;
+			}
+			const bool same = hash == serialHash;
+			if (!same) {
+				++failures;
+			}
+
+			printf("%-40s %7u %8i %12.2f %12.2f %7.2fx %s\n",
+				files[f].c_str(),
+				meshes,
+				threads[t],
+				bestImport*1000.0,
+				bestPostProcess*1000.0,
+				bestPostProcess > 0.0 ? serialSeconds/bestPostProcess : 1.0,
+				same ? "same" : "DIFFERS");
+		}
+	}
+
+	return failures ? 1 : 0;
+}
@@ -67,6 +67,7 @@ const char* AICMD_MSG_HELP =
 " \textract    - Extract embedded texture images\n"
 " \tdump       - Convert models to a binary or textual dump (ASSBIN/ASSXML)\n"
 " \tcmpdump    - Compare dumps created using \'assimp dump <file> -s ...\'\n"
+" \tbenchmark  - Time post-processing with different thread counts\n"
 " \tversion    - Display Assimp version\n"
 "\n Use \'assimp <verb> --help\' for detailed help on a command.\n"
 ;
@@ -217,6 +218,12 @@ int main (int argc, char* argv[])
 		return Assimp_Extract (&argv[2],argc-2);
 	}
 
+	// assimp benchmark
+	// Compare post-processing times across thread counts
+	if (! strcmp(argv[1], "benchmark")) {
+		return Assimp_Benchmark (&argv[2],argc-2);
+	}
+
 	// assimp testbatchload
 	// Used by /test/other/streamload.py to load a list of files
 	// using the same importer instance to check for incompatible
@@ -278,6 +285,9 @@ const aiScene* ImportModel(
 		return NULL;
 	}
 	printf("Validating postprocessing flags ...  OK\n");
+	if (imp.memoryMap) {
+		globalImporter->SetIOHandler(new Assimp::MmapIOSystem());
+	}
 	if (imp.showLog) {
 		PrintHorBar();
 	}
@@ -385,6 +395,8 @@ int ProcessStandardArguments(
 	// -sbc    --split-by-bone-count
 	//
 	// -c<file> --config-file=<file>
+	//
+	// -mm     --memory-map
 
 	for (unsigned int i = 0; i < num;++i) 
 	{
@@ -486,6 +498,9 @@ int ProcessStandardArguments(
 		else if (! strcmp(params[i], "-v") || ! strcmp(params[i], "--verbose")) { 
 			fill.verbose = true;
 		}
+		else if (! strcmp(params[i], "-mm") || ! strcmp(params[i], "--memory-map")) {
+			fill.memoryMap = true;
+		}
 		else if (! strncmp(params[i], "--log-out=",10) || ! strncmp(params[i], "-lo",3)) { 
 			fill.logFile = std::string(params[i]+(params[i][1] == '-' ? 10 : 3));
 			if (!fill.logFile.length()) {
@@ -59,6 +59,7 @@ OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <assimp/version.h>
 #include <assimp/scene.h>
 #include <assimp/Importer.hpp>
+#include <assimp/MmapIOSystem.hpp>
 #include <assimp/DefaultLogger.hpp>
 
 #ifndef ASSIMP_BUILD_NO_EXPORT
@@ -97,6 +98,7 @@ struct ImportData
 		,	showLog (false)
 		,	verbose (false)
 		,	log	    (false)
+		,	memoryMap (false)
 	{}
 
 	/** Postprocessing flags
@@ -115,6 +117,9 @@ struct ImportData
 
 	// Need to log?
 	bool log;
+
+	// Memory map input files?
+	bool memoryMap;
 };
 
 // ------------------------------------------------------------------------------
@@ -204,5 +209,14 @@ int Assimp_TestBatchLoad (
 	const char* const* params, 
 	unsigned int num);
 
+// ------------------------------------------------------------------------------
+/** @brief assimp benchmark utility
+ *  @param params Command line parameters to 'assimp benchmark'
+ *  @param Number of params
+ *  @return 0 for success */
+int Assimp_Benchmark (
+	const char* const* params, 
+	unsigned int num);
+
 
 #endif // !! AICMD_MAIN_INCLUDED